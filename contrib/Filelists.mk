@@ -53,5 +53,4 @@ CONTRIBAPPFILES=$(CONTRIBDIR)/apps/httpserver/httpserver-netconn.c \
 	$(CONTRIBDIR)/examples/snmp/snmp_example.c \
 	$(CONTRIBDIR)/examples/sntp/sntp_example.c \
 	$(CONTRIBDIR)/examples/tftp/tftp_example.c \
-	$(CONTRIBDIR)/addons/tcp_isn/tcp_isn.c \
-	$(CONTRIBDIR)/addons/ipv6_static_routing/ip6_route_table.c
+	$(CONTRIBDIR)/addons/tcp_isn/tcp_isn.c
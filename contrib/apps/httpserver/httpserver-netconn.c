@@ -20,7 +20,7 @@ http_server_netconn_serve(struct netconn *conn)
 {
   struct netbuf *inbuf;
   char *buf;
-  u16_t buflen;
+  pbuf_len_t buflen;
   err_t err;
 
   /* Read the data from the port, blocking if nothing yet there.
@@ -44,6 +44,7 @@
 #include "lwip/def.h"
 #include "lwip/api.h"
 #include "lwip/stats.h"
+#include "lwip/memp.h"
 
 #if LWIP_SOCKET
 #include "lwip/errno.h"
@@ -104,6 +105,7 @@ idxtoname [index]: outputs interface name from index."NEWLINE"\
 nametoidx [name]: outputs interface index from name."NEWLINE;
 static char help_msg3[] =
 "gethostnm [name]: outputs IP address of host."NEWLINE"\
+memt: prints memory pool telemetry (allocation rate, failures, lifetimes)."NEWLINE"\
 quit: quits"NEWLINE"";
 
 #if LWIP_STATS
@@ -964,6 +966,75 @@ com_usnd(struct command *com)
   return ESUCCESS;
 }
 /*-----------------------------------------------------------------------------------*/
+#if MEMP_TELEMETRY
+/*-----------------------------------------------------------------------------------*/
+static s8_t
+com_memt(struct command *com)
+{
+  struct memp_telemetry t;
+  char buf[100];
+  u16_t len;
+  size_t i;
+  int k;
+
+  for (i = 0; i < MEMP_MAX; i++) {
+    memp_telemetry_get((memp_t)i, &t);
+    if ((t.allocs == 0) && (t.fails == 0)) {
+      continue;
+    }
+#if defined(LWIP_DEBUG) || MEMP_OVERFLOW_CHECK || LWIP_STATS_DISPLAY
+    len = (u16_t)sprintf(buf, "%-10s", memp_pools[i]->desc);
+#else
+    len = (u16_t)sprintf(buf, "%-10d", (int)i);
+#endif
+    netconn_write(com->conn, buf, len, NETCONN_COPY);
+    len = (u16_t)sprintf(buf, " * allocs %"U32_F" frees %"U32_F" fails %"U32_F" rate %"U32_F NEWLINE,
+                         t.allocs, t.frees, t.fails, t.rate);
+    netconn_write(com->conn, buf, len, NETCONN_COPY);
+    /* lifetime buckets: bucket k counts lifetimes below 2^k */
+    sendstr("           * lifetime", com->conn);
+    for (k = 0; k < MEMP_TELEMETRY_HIST_BUCKETS; k++) {
+      if (t.lifetime[k] != 0) {
+        if (k < MEMP_TELEMETRY_HIST_BUCKETS - 1) {
+          len = (u16_t)sprintf(buf, " <%lu:%"U32_F, 1UL << k, t.lifetime[k]);
+        } else {
+          len = (u16_t)sprintf(buf, " >=%lu:%"U32_F, 1UL << (k - 1), t.lifetime[k]);
+        }
+        netconn_write(com->conn, buf, len, NETCONN_COPY);
+      }
+    }
+    sendstr(NEWLINE, com->conn);
+    /* failure bursts, oldest first */
+    for (k = 1; k <= MEMP_TELEMETRY_BURSTS; k++) {
+      struct memp_telemetry_burst *b = &t.bursts[(t.last_burst + k) % MEMP_TELEMETRY_BURSTS];
+      if (b->count != 0) {
+        len = (u16_t)sprintf(buf, "           * fail burst %"U32_F"-%"U32_F": %"U32_F NEWLINE,
+                             b->start, b->end, b->count);
+        netconn_write(com->conn, buf, len, NETCONN_COPY);
+      }
+    }
+  }
+#if MEMP_OVERFLOW_CHECK
+  {
+    static struct memp_telemetry_site sites[MEMP_TELEMETRY_SITES];
+    u16_t num = memp_telemetry_get_sites(sites, MEMP_TELEMETRY_SITES);
+    const char *file;
+
+    sendstr("call sites: allocs fails used max"NEWLINE, com->conn);
+    for (i = 0; i < num; i++) {
+      /* strip the path */
+      file = strrchr(sites[i].file, '/');
+      file = (file != NULL) ? file + 1 : sites[i].file;
+      len = (u16_t)snprintf(buf, sizeof(buf), "%.40s:%d %s %"U32_F" %"U32_F" %"U32_F" %"U32_F NEWLINE,
+                            file, sites[i].line, sites[i].desc->desc, sites[i].allocs,
+                            sites[i].fails, sites[i].used, sites[i].max);
+      netconn_write(com->conn, buf, LWIP_MIN(len, sizeof(buf) - 1), NETCONN_COPY);
+    }
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+  return ESUCCESS;
+}
+#endif /* MEMP_TELEMETRY */
 #if LWIP_SOCKET
 /*-----------------------------------------------------------------------------------*/
 static s8_t
@@ -1084,6 +1155,11 @@ parse_command(struct command *com, u32_t len)
     com->exec = com_gethostbyname;
     com->nargs = 1;
 #endif /* LWIP_DNS */
+#if MEMP_TELEMETRY
+  } else if (strncmp((const char *)buffer, "memt", 4) == 0) {
+    com->exec = com_memt;
+    com->nargs = 0;
+#endif /* MEMP_TELEMETRY */
   } else if (strncmp((const char *)buffer, "help", 4) == 0) {
     com->exec = com_help;
     com->nargs = 0;
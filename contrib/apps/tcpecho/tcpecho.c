@@ -68,7 +68,7 @@ tcpecho_thread(void *arg)
     if (err == ERR_OK) {
       struct netbuf *buf;
       void *data;
-      u16_t len;
+      pbuf_len_t len;
 
       while ((err = netconn_recv(newconn, &buf)) == ERR_OK) {
         /*printf("Recved\n");*/
@@ -35,6 +35,9 @@ SYSARCH?=$(LWIPARCH)/sys_arch.c
 ARCHFILES=$(LWIPARCH)/perf.c \
   $(SYSARCH) \
 	$(LWIPARCH)/netif/tapif.c \
+	$(LWIPARCH)/netif/pktmmapif.c \
+	$(LWIPARCH)/netif/shmif.c \
+	$(LWIPARCH)/netif/pcapreplayif.c \
 	$(LWIPARCH)/netif/list.c \
 	$(LWIPARCH)/netif/sio.c \
 	$(LWIPARCH)/netif/fifo.c
@@ -19,6 +19,9 @@ set(lwipcontribportunix_SRCS
 
 set(lwipcontribportunixnetifs_SRCS
     ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/tapif.c
+    ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/pktmmapif.c
+    ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/shmif.c
+    ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/pcapreplayif.c
     ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/list.c
     ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/sio.c
     ${LWIP_CONTRIB_DIR}/ports/unix/port/netif/fifo.c
@@ -0,0 +1,298 @@
+/**
+ * @file
+ * Bridge forwarding rate over the number of learnt stations (bridgeif FDB)
+ *
+ * A NO_SYS stack runs a bridgeif with several port netifs. A growing number
+ * of stations, spread over the ports, first announce themselves with a
+ * broadcast so that the FDB learns them. Then unicast frames between random
+ * pairs of stations on different ports are passed to the input function of
+ * the source port, as its driver would, and must leave on the destination
+ * port only.
+ *
+ * With -v, the frames are 802.1Q tagged, with the stations in 16 VLANs
+ * (needs BRIDGEIF_FDB_VLAN).
+ *
+ * Reports per number of stations:
+ * - ns per frame from the port input function to the port linkoutput function
+ * - frames/s
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ieee.h"
+#include "netif/bridgeif.h"
+#include "netif/ethernet.h"
+
+#define BENCH_FRAME_LEN   64
+#define BENCH_MAX_STATIONS 0xfff0
+
+static struct netif bench_bridge;
+static struct netif bench_ports[BRIDGEIF_MAX_PORTS];
+static u32_t bench_port_frames[BRIDGEIF_MAX_PORTS];
+static int bench_num_ports = 4;
+static int bench_vlans;
+static u32_t bench_seed = 1;
+
+static u32_t
+bench_rand(void)
+{
+  /* xorshift32: the same traffic for the same seed on every platform */
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* ports: count and discard everything */
+
+static err_t
+bench_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(p);
+  bench_port_frames[netif - bench_ports]++;
+  return ERR_OK;
+}
+
+static err_t
+bench_port_init(struct netif *netif)
+{
+  netif->name[0] = 'p';
+  netif->name[1] = (char)('0' + (netif - bench_ports));
+  netif->linkoutput = bench_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[5] = (u8_t)(netif - bench_ports);
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET;
+  return ERR_OK;
+}
+
+/* station n is at port n % ports and in VLAN 1 + (n / ports) % 16 */
+static int
+bench_station_port(int station)
+{
+  return station % bench_num_ports;
+}
+
+/** Pass a frame from station 'src' to 'dst' (-1: broadcast) to the input
+ * function of the port of 'src' */
+static void
+bench_input(int src, int dst)
+{
+  struct pbuf *p;
+  u8_t *frame;
+  struct netif *port = &bench_ports[bench_station_port(src)];
+
+  p = pbuf_alloc(PBUF_RAW, BENCH_FRAME_LEN, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  frame = (u8_t *)p->payload;
+  memset(frame, 0, BENCH_FRAME_LEN);
+  if (dst < 0) {
+    memset(frame, 0xff, ETH_HWADDR_LEN);
+  } else {
+    frame[0] = 0x02;
+    frame[1] = 0x10;
+    frame[4] = (u8_t)(dst >> 8);
+    frame[5] = (u8_t)dst;
+  }
+  frame[6] = 0x02;
+  frame[7] = 0x10;
+  frame[10] = (u8_t)(src >> 8);
+  frame[11] = (u8_t)src;
+  if (bench_vlans) {
+    u16_t vid = (u16_t)(1 + (src / bench_num_ports) % 16);
+    frame[12] = ETHTYPE_VLAN >> 8;
+    frame[13] = ETHTYPE_VLAN & 0xff;
+    frame[14] = (u8_t)(vid >> 8);
+    frame[15] = (u8_t)vid;
+    frame[16] = ETHTYPE_IP >> 8;
+    frame[17] = ETHTYPE_IP & 0xff;
+  } else {
+    frame[12] = ETHTYPE_IP >> 8;
+    frame[13] = ETHTYPE_IP & 0xff;
+  }
+  if (port->input(p, port) != ERR_OK) {
+    pbuf_free(p);
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-p ports] [-m stations] [-n frames] [-v] [-s seed]\n"
+          "  -p  bridge ports (default: 4, max: %d)\n"
+          "  -m  largest number of stations, doubled from 16 (default: 32768)\n"
+          "  -n  frames per number of stations (default: 1000000)\n"
+          "  -v  802.1Q tagged frames in 16 VLANs\n"
+          "  -s  random seed (default: 1)\n",
+          name, BRIDGEIF_MAX_PORTS);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  bridgeif_initdata_t initdata = BRIDGEIF_INITDATA1(BRIDGEIF_MAX_PORTS, BENCH_MAX_STATIONS, 16, ETH_ADDR(0x02, 0, 0, 0, 0, 0xfe));
+  int *pairs;
+  u64_t ns;
+  u32_t frames, sent;
+  int max_stations = 32768;
+  int packets = 1000000;
+  int opt, i, num;
+
+  while ((opt = getopt(argc, argv, "p:m:n:vs:")) != -1) {
+    switch (opt) {
+      case 'p':
+        bench_num_ports = atoi(optarg);
+        if ((bench_num_ports < 2) || (bench_num_ports > BRIDGEIF_MAX_PORTS)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'm':
+        max_stations = atoi(optarg);
+        if ((max_stations < 16) || (max_stations > BENCH_MAX_STATIONS)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        packets = atoi(optarg);
+        if (packets < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 'v':
+#if BRIDGEIF_FDB_VLAN
+        bench_vlans = 1;
+#else /* BRIDGEIF_FDB_VLAN */
+        fprintf(stderr, "-v needs BRIDGEIF_FDB_VLAN\n");
+        return 1;
+#endif /* BRIDGEIF_FDB_VLAN */
+        break;
+      case 's':
+        bench_seed = (u32_t)strtoul(optarg, NULL, 0);
+        if (bench_seed == 0) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  /* source and destination station of each measured frame */
+  pairs = (int *)malloc(2 * (size_t)packets * sizeof(int));
+  if (pairs == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  lwip_init();
+  initdata.max_ports = (u8_t)bench_num_ports;
+  if (netif_add_noaddr(&bench_bridge, &initdata, bridgeif_init, ethernet_input) == NULL) {
+    fprintf(stderr, "adding the bridge failed\n");
+    return 1;
+  }
+  for (i = 0; i < bench_num_ports; i++) {
+    netif_add_noaddr(&bench_ports[i], NULL, bench_port_init, ethernet_input);
+    if (bridgeif_add_port(&bench_bridge, &bench_ports[i]) != ERR_OK) {
+      fprintf(stderr, "adding port %d failed\n", i);
+      return 1;
+    }
+    netif_set_link_up(&bench_ports[i]);
+    netif_set_up(&bench_ports[i]);
+  }
+  netif_set_up(&bench_bridge);
+
+  printf("%d ports, %s frames\n", bench_num_ports, bench_vlans ? "tagged" : "untagged");
+  printf("%8s %10s %12s\n", "stations", "ns/frame", "frames/s");
+  for (num = 16; ; num = LWIP_MIN(2 * num, max_stations)) {
+    /* learn the stations, then measure */
+    for (i = 0; i < num; i++) {
+      bench_input(i, -1);
+    }
+    for (i = 0; i < packets; i++) {
+      /* a random station and one at another port, in the same VLAN */
+      int src = (int)(bench_rand() % (u32_t)(num - num % bench_num_ports));
+      int port = bench_station_port(src);
+      int dst_port = (port + 1 + (int)(bench_rand() % (u32_t)(bench_num_ports - 1))) % bench_num_ports;
+      pairs[2 * i] = src;
+      pairs[2 * i + 1] = src - port + dst_port;
+    }
+    frames = 0;
+    for (i = 0; i < bench_num_ports; i++) {
+      frames += bench_port_frames[i];
+    }
+    ns = bench_now_ns();
+    for (i = 0; i < packets; i++) {
+      bench_input(pairs[2 * i], pairs[2 * i + 1]);
+    }
+    ns = bench_now_ns() - ns;
+    sent = 0;
+    for (i = 0; i < bench_num_ports; i++) {
+      sent += bench_port_frames[i];
+    }
+    if (sent - frames != (u32_t)packets) {
+      fprintf(stderr, "%d stations: %lu frames sent for %d frames received\n", num,
+              (unsigned long)(sent - frames), packets);
+      return 1;
+    }
+    printf("%8d %10.1f %12.0f\n", num, (double)ns / packets, (double)packets * 1e9 / (double)ns);
+    if (num == max_stations) {
+      break;
+    }
+  }
+
+  free(pairs);
+  return 0;
+}
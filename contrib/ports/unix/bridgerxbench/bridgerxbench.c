@@ -0,0 +1,344 @@
+/**
+ * @file
+ * Bridge switching rate with one RX thread per port (BRIDGEIF_PORT_NETIFS_FAST_PATH)
+ *
+ * The stack runs in tcpip_thread, a bridgeif has several port netifs. The
+ * stations, spread over the ports, first announce themselves with a broadcast
+ * so that the FDB learns them. Then every port gets an RX thread which, as
+ * its driver would, passes unicast frames from its stations to stations at
+ * random other ports to the input function of the port. The number of
+ * ports receiving in parallel is doubled from 1 up to all ports.
+ *
+ * With BRIDGEIF_PORT_NETIFS_FAST_PATH, these frames are switched in the RX
+ * threads; -t passes every frame through tcpip_thread instead (as with
+ * BRIDGEIF_PORT_NETIFS_FAST_PATH==0) for comparison.
+ *
+ * Reports per number of RX threads (ports receiving in parallel):
+ * - frames/s from the port input functions to the port linkoutput functions
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/prot/ethernet.h"
+#include "netif/bridgeif.h"
+#include "netif/ethernet.h"
+
+#define BENCH_FRAME_LEN    64
+#define BENCH_MAX_STATIONS 0xfff0
+
+/* the RX threads count in parallel: keep the counters apart */
+struct bench_port {
+  struct netif netif;
+  pthread_t thread;
+  u32_t seed;
+  int frames;
+  u32_t sent;
+  u8_t pad[64];
+};
+
+static struct netif bench_bridge;
+static struct bench_port bench_ports[BRIDGEIF_MAX_PORTS];
+static int bench_num_ports = BRIDGEIF_MAX_PORTS;
+static int bench_stations = 4096;
+static int bench_tcpip;
+
+static u32_t
+bench_rand(u32_t *seed)
+{
+  /* xorshift32: the same traffic for the same seed on every platform */
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 17;
+  *seed ^= *seed << 5;
+  return *seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+static u32_t
+bench_sent(void)
+{
+  u32_t sent = 0;
+  int i;
+
+  for (i = 0; i < BRIDGEIF_MAX_PORTS; i++) {
+    sent += __atomic_load_n(&bench_ports[i].sent, __ATOMIC_RELAXED);
+  }
+  return sent;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* ports: count and discard everything */
+
+static err_t
+bench_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(p);
+  __atomic_fetch_add(&((struct bench_port *)netif)->sent, 1, __ATOMIC_RELAXED);
+  return ERR_OK;
+}
+
+static err_t
+bench_port_init(struct netif *netif)
+{
+  int idx = (int)((struct bench_port *)netif - bench_ports);
+
+  netif->name[0] = 'p';
+  netif->name[1] = (char)('0' + idx);
+  netif->linkoutput = bench_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[5] = (u8_t)idx;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET;
+  return ERR_OK;
+}
+
+/* station n is at port n % ports */
+static int
+bench_station_port(int station)
+{
+  return station % bench_num_ports;
+}
+
+/** Pass a frame from station 'src' to 'dst' (-1: broadcast) to the input
+ * function of the port of 'src', in the calling (RX) thread */
+static void
+bench_input(int src, int dst)
+{
+  struct pbuf *p;
+  u8_t *frame;
+  struct netif *port = &bench_ports[bench_station_port(src)].netif;
+  err_t err;
+
+  p = pbuf_alloc(PBUF_RAW, BENCH_FRAME_LEN, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  frame = (u8_t *)p->payload;
+  memset(frame, 0, BENCH_FRAME_LEN);
+  if (dst < 0) {
+    memset(frame, 0xff, ETH_HWADDR_LEN);
+  } else {
+    frame[0] = 0x02;
+    frame[1] = 0x10;
+    frame[4] = (u8_t)(dst >> 8);
+    frame[5] = (u8_t)dst;
+  }
+  frame[6] = 0x02;
+  frame[7] = 0x10;
+  frame[10] = (u8_t)(src >> 8);
+  frame[11] = (u8_t)src;
+  frame[12] = ETHTYPE_IP >> 8;
+  frame[13] = ETHTYPE_IP & 0xff;
+  do {
+    if (bench_tcpip) {
+      err = tcpip_inpkt(p, port, port->input);
+    } else {
+      err = port->input(p, port);
+    }
+    if (err == ERR_MEM) {
+      /* tcpip_thread mbox full: the driver would drop, we wait */
+      sched_yield();
+    }
+  } while (err == ERR_MEM);
+  if (err != ERR_OK) {
+    pbuf_free(p);
+  }
+}
+
+/** RX thread of a port: frames from its stations to stations at other ports */
+static void *
+bench_rx_thread(void *arg)
+{
+  struct bench_port *bp = (struct bench_port *)arg;
+  int port = (int)(bp - bench_ports);
+  int i;
+
+  for (i = 0; i < bp->frames; i++) {
+    int src = port + bench_num_ports * (int)(bench_rand(&bp->seed) % (u32_t)(bench_stations / bench_num_ports));
+    int dst_port = (port + 1 + (int)(bench_rand(&bp->seed) % (u32_t)(bench_num_ports - 1))) % bench_num_ports;
+    bench_input(src, src - port + dst_port);
+  }
+  return NULL;
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-p ports] [-m stations] [-n frames] [-t]\n"
+          "  -p  bridge ports, RX threads are doubled from 1 up to this (default: %d)\n"
+          "  -m  number of stations (default: 4096)\n"
+          "  -n  frames per measurement (default: 1000000)\n"
+          "  -t  pass every frame through tcpip_thread\n",
+          name, BRIDGEIF_MAX_PORTS);
+  exit(1);
+}
+
+static void
+bench_tcpip_init_done(void *arg)
+{
+  sys_sem_signal((sys_sem_t *)arg);
+}
+
+int
+main(int argc, char **argv)
+{
+  bridgeif_initdata_t initdata = BRIDGEIF_INITDATA1(BRIDGEIF_MAX_PORTS, BENCH_MAX_STATIONS, 16, ETH_ADDR(0x02, 0, 0, 0, 0, 0xfe));
+  sys_sem_t init_sem;
+  u64_t ns;
+  u32_t sent, expected;
+  int packets = 1000000;
+  int opt, i, threads;
+
+  while ((opt = getopt(argc, argv, "p:m:n:t")) != -1) {
+    switch (opt) {
+      case 'p':
+        bench_num_ports = atoi(optarg);
+        if ((bench_num_ports < 2) || (bench_num_ports > BRIDGEIF_MAX_PORTS)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'm':
+        bench_stations = atoi(optarg);
+        if ((bench_stations < 2 * BRIDGEIF_MAX_PORTS) || (bench_stations > BENCH_MAX_STATIONS)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        packets = atoi(optarg);
+        if (packets < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 't':
+        bench_tcpip = 1;
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  if (sys_sem_new(&init_sem, 0) != ERR_OK) {
+    fprintf(stderr, "sys_sem_new failed\n");
+    return 1;
+  }
+  tcpip_init(bench_tcpip_init_done, &init_sem);
+  sys_sem_wait(&init_sem);
+  sys_sem_free(&init_sem);
+
+  LOCK_TCPIP_CORE();
+  initdata.max_ports = (u8_t)bench_num_ports;
+  if (netif_add_noaddr(&bench_bridge, &initdata, bridgeif_init, ethernet_input) == NULL) {
+    fprintf(stderr, "adding the bridge failed\n");
+    return 1;
+  }
+  for (i = 0; i < bench_num_ports; i++) {
+    netif_add_noaddr(&bench_ports[i].netif, NULL, bench_port_init, ethernet_input);
+    if (bridgeif_add_port(&bench_bridge, &bench_ports[i].netif) != ERR_OK) {
+      fprintf(stderr, "adding port %d failed\n", i);
+      return 1;
+    }
+    netif_set_link_up(&bench_ports[i].netif);
+    netif_set_up(&bench_ports[i].netif);
+  }
+  netif_set_up(&bench_bridge);
+  UNLOCK_TCPIP_CORE();
+
+  /* learn the stations: broadcasts are flooded via tcpip_thread */
+  bench_stations -= bench_stations % bench_num_ports;
+  for (i = 0; i < bench_stations; i++) {
+    bench_input(i, -1);
+  }
+  expected = (u32_t)bench_stations * (u32_t)(bench_num_ports - 1);
+  while (bench_sent() != expected) {
+    sched_yield();
+  }
+
+  printf("%d ports, %d stations, %s\n", bench_num_ports, bench_stations,
+         bench_tcpip ? "all frames through tcpip_thread" :
+         (BRIDGEIF_PORT_NETIFS_FAST_PATH ? "switched in the RX threads" : "BRIDGEIF_PORT_NETIFS_FAST_PATH==0"));
+  printf("%10s %12s\n", "RX threads", "frames/s");
+  for (threads = 1; ; threads = LWIP_MIN(2 * threads, bench_num_ports)) {
+    u32_t frames = 0;
+
+    for (i = 0; i < threads; i++) {
+      bench_ports[i].seed = (u32_t)(i + 1);
+      bench_ports[i].frames = packets / threads;
+      frames += (u32_t)bench_ports[i].frames;
+    }
+    expected = bench_sent() + frames;
+    ns = bench_now_ns();
+    for (i = 0; i < threads; i++) {
+      if (pthread_create(&bench_ports[i].thread, NULL, bench_rx_thread, &bench_ports[i]) != 0) {
+        fprintf(stderr, "pthread_create failed\n");
+        return 1;
+      }
+    }
+    for (i = 0; i < threads; i++) {
+      pthread_join(bench_ports[i].thread, NULL);
+    }
+    /* wait for the frames still queued to tcpip_thread */
+    while ((sent = bench_sent()) < expected) {
+      sched_yield();
+    }
+    ns = bench_now_ns() - ns;
+    if (sent != expected) {
+      fprintf(stderr, "%d RX threads: %lu frames sent for %lu frames received\n", threads,
+              (unsigned long)(sent + frames - expected), (unsigned long)frames);
+      return 1;
+    }
+    printf("%10d %12.0f\n", threads, (double)frames * 1e9 / (double)ns);
+    if (threads == bench_num_ports) {
+      break;
+    }
+  }
+  return 0;
+}
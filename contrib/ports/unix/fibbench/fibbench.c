@@ -0,0 +1,419 @@
+/**
+ * @file
+ * Lookup rate of the IPv4 and IPv6 routing tables (LWIP_IPV4_FIB, LWIP_IPV6_FIB)
+ *
+ * Fills the FIB of a NO_SYS stack with random routes spread over a few
+ * netifs, then looks up random addresses inside those prefixes:
+ * - IPv4: about half of the routes are /24, the rest spread over /8../32,
+ *   like a routing table of the internet
+ * - IPv6 (-6): /48, /56 and /64 prefixes delegated from a few /32
+ *   aggregates, a quarter of the routes with any length from /16 to /128
+ *
+ * Reports per lookup:
+ * - ns of ip4_fib_lookup() or ip6_fib_lookup()
+ * - ns of ip4_route() or ip6_route() (FIB and netif list)
+ * - ns of a linear scan over the same routes, for comparison; it is run with
+ *   fewer lookups and its results are used to check the ones of the FIB
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/ip4.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip6.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define BENCH_NUM_NETIFS     4
+#define BENCH_NUM_AGGREGATES 16
+/* the FIBs count their routes in an u16_t */
+#define BENCH_MAX_ROUTES     60000
+
+/** A route of the linear table, addresses in host byte order */
+struct bench_route {
+  u32_t key[4];
+  u32_t mask[4];
+  u8_t len;
+};
+
+static struct netif bench_netifs[BENCH_NUM_NETIFS];
+static struct bench_route *bench_routes;
+static int bench_num_routes;
+static int bench_words = 1;
+static u32_t *bench_dests;
+static u32_t bench_seed = 1;
+
+static u32_t
+bench_rand(void)
+{
+  /* xorshift32: the same routes for the same seed on every platform */
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* netifs: discard everything */
+
+static err_t
+bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_output_ip6(struct netif *netif, struct pbuf *p, const ip6_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->name[0] = 'f';
+  netif->name[1] = 'b';
+  netif->output = bench_output;
+  netif->output_ip6 = bench_output_ip6;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* route tables */
+
+static void
+bench_set_mask(struct bench_route *r, u8_t len)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    if (len >= 32 * (i + 1)) {
+      r->mask[i] = 0xffffffffUL;
+    } else if (len <= 32 * i) {
+      r->mask[i] = 0;
+    } else {
+      r->mask[i] = (u32_t)(0xffffffffUL << (32 * (i + 1) - len));
+    }
+    r->key[i] &= r->mask[i];
+  }
+  r->len = len;
+}
+
+static void
+bench_to_ip6(ip6_addr_t *addr, const u32_t *words)
+{
+  IP6_ADDR(addr, lwip_htonl(words[0]), lwip_htonl(words[1]), lwip_htonl(words[2]), lwip_htonl(words[3]));
+}
+
+static void
+bench_add_routes(int num)
+{
+  struct bench_route *r;
+  u32_t aggregates[BENCH_NUM_AGGREGATES];
+  ip4_addr_t prefix4, gw4;
+  ip6_addr_t prefix6, gw6;
+  struct netif *netif;
+  err_t err;
+  u32_t rnd;
+  int i;
+
+  for (i = 0; i < BENCH_NUM_AGGREGATES; i++) {
+    /* 2000::/3 */
+    aggregates[i] = 0x20000000UL | (bench_rand() & 0x1fffffffUL);
+  }
+
+  for (i = 0; i < num; i++) {
+    r = &bench_routes[i];
+    netif = &bench_netifs[i % BENCH_NUM_NETIFS];
+    r->key[0] = bench_rand();
+    r->key[1] = bench_rand();
+    r->key[2] = bench_rand();
+    r->key[3] = bench_rand();
+    rnd = bench_rand();
+    if (bench_words == 1) {
+      bench_set_mask(r, (rnd & 1) ? 24 : (u8_t)(8 + (rnd >> 1) % 25));
+      ip4_addr_set_u32(&prefix4, lwip_htonl(r->key[0]));
+      IP4_ADDR(&gw4, 192, 168, (u8_t)(i % BENCH_NUM_NETIFS), 254);
+      err = ip4_fib_add(&prefix4, r->len, &gw4, netif);
+    } else {
+      static const u8_t lens[] = {48, 56, 64};
+      r->key[0] = aggregates[r->key[0] % BENCH_NUM_AGGREGATES];
+      bench_set_mask(r, ((rnd & 3) < 3) ? lens[rnd & 3] : (u8_t)(16 + (rnd >> 2) % 113));
+      bench_to_ip6(&prefix6, r->key);
+      IP6_ADDR(&gw6, PP_HTONL(0xfe800000UL), 0, 0, lwip_htonl((u32_t)(i % BENCH_NUM_NETIFS) + 1));
+      err = ip6_fib_add(&prefix6, r->len, &gw6, netif);
+    }
+    if (err != ERR_OK) {
+      fprintf(stderr, "adding a route failed after %d routes\n", i);
+      exit(1);
+    }
+  }
+  bench_num_routes = num;
+}
+
+/** Longest prefix by looking at every route */
+static int
+bench_linear_lookup(const u32_t *dest)
+{
+  const struct bench_route *r;
+  int i, w, best = -1;
+
+  for (i = 0; i < bench_num_routes; i++) {
+    r = &bench_routes[i];
+    for (w = 0; w < bench_words; w++) {
+      if ((dest[w] & r->mask[w]) != r->key[w]) {
+        break;
+      }
+    }
+    if ((w == bench_words) && ((best < 0) || (r->len > bench_routes[best].len))) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+/** Look up a destination in the FIB, return the prefix length or -1 */
+static int
+bench_fib_lookup(const u32_t *dest, u32_t *prefix)
+{
+  if (bench_words == 1) {
+    ip4_addr_t addr;
+    const struct ip4_fib_route *route;
+
+    ip4_addr_set_u32(&addr, lwip_htonl(dest[0]));
+    route = ip4_fib_lookup(&addr);
+    if (route == NULL) {
+      return -1;
+    }
+    prefix[0] = lwip_ntohl(ip4_addr_get_u32(&route->prefix));
+    return route->prefix_len;
+  } else {
+    ip6_addr_t addr;
+    const struct ip6_fib_route *route;
+    int i;
+
+    bench_to_ip6(&addr, dest);
+    route = ip6_fib_lookup(&addr);
+    if (route == NULL) {
+      return -1;
+    }
+    for (i = 0; i < 4; i++) {
+      prefix[i] = lwip_ntohl(route->prefix.addr[i]);
+    }
+    return route->prefix_len;
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static u64_t
+bench_time_fib(int lookups, u32_t *sum)
+{
+  u64_t start = bench_now_ns();
+  int i;
+
+  if (bench_words == 1) {
+    ip4_addr_t addr;
+    for (i = 0; i < lookups; i++) {
+      ip4_addr_set_u32(&addr, lwip_htonl(bench_dests[i]));
+      *sum += ip4_fib_lookup(&addr)->prefix_len;
+    }
+  } else {
+    ip6_addr_t addr;
+    for (i = 0; i < lookups; i++) {
+      bench_to_ip6(&addr, &bench_dests[4 * i]);
+      *sum += ip6_fib_lookup(&addr)->prefix_len;
+    }
+  }
+  return bench_now_ns() - start;
+}
+
+static u64_t
+bench_time_route(int lookups, u32_t *sum)
+{
+  u64_t start = bench_now_ns();
+  int i;
+
+  if (bench_words == 1) {
+    ip4_addr_t addr;
+    for (i = 0; i < lookups; i++) {
+      ip4_addr_set_u32(&addr, lwip_htonl(bench_dests[i]));
+      *sum += ip4_route(&addr)->num;
+    }
+  } else {
+    ip6_addr_t addr;
+    for (i = 0; i < lookups; i++) {
+      bench_to_ip6(&addr, &bench_dests[4 * i]);
+      *sum += ip6_route(IP6_ADDR_ANY6, &addr)->num;
+    }
+  }
+  return bench_now_ns() - start;
+}
+
+static void
+bench_print(const char *name, u64_t ns, int lookups)
+{
+  printf("%-16s %10.1f ns %10.2f Mlookups/s\n", name,
+         (double)ns / lookups, (double)lookups * 1000.0 / (double)ns);
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-6] [-r routes] [-n lookups] [-s seed]\n"
+          "  -6  IPv6 routes (default: IPv4)\n"
+          "  -r  number of routes (default: 10000, max: %d)\n"
+          "  -n  number of lookups (default: 1000000)\n"
+          "  -s  random seed (default: 1)\n", name, BENCH_MAX_ROUTES);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  const struct bench_route *r;
+  ip4_addr_t addr, netmask;
+  u64_t fib_ns, route_ns, linear_ns, start;
+  u32_t prefix[4];
+  int num_routes = 10000;
+  int lookups = 1000000;
+  int linear_lookups;
+  int opt, i, w, best, len;
+  u32_t sum = 0;
+
+  while ((opt = getopt(argc, argv, "6r:n:s:")) != -1) {
+    switch (opt) {
+      case '6':
+        bench_words = 4;
+        break;
+      case 'r':
+        num_routes = atoi(optarg);
+        if ((num_routes < 1) || (num_routes > BENCH_MAX_ROUTES)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        lookups = atoi(optarg);
+        if (lookups < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 's':
+        bench_seed = (u32_t)strtoul(optarg, NULL, 0);
+        if (bench_seed == 0) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  bench_routes = (struct bench_route *)calloc((size_t)num_routes, sizeof(struct bench_route));
+  bench_dests = (u32_t *)calloc((size_t)lookups * (size_t)bench_words, sizeof(u32_t));
+  if ((bench_routes == NULL) || (bench_dests == NULL)) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  lwip_init();
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  for (i = 0; i < BENCH_NUM_NETIFS; i++) {
+    IP4_ADDR(&addr, 192, 168, (u8_t)i, 1);
+    netif_add(&bench_netifs[i], &addr, &netmask, IP4_ADDR_ANY4, NULL, bench_netif_init, ip4_input);
+    netif_set_up(&bench_netifs[i]);
+  }
+
+  bench_add_routes(num_routes);
+  /* destinations inside the prefixes of random routes */
+  for (i = 0; i < lookups; i++) {
+    r = &bench_routes[bench_rand() % (u32_t)num_routes];
+    for (w = 0; w < bench_words; w++) {
+      bench_dests[bench_words * i + w] = r->key[w] | (bench_rand() & ~r->mask[w]);
+    }
+  }
+
+  fib_ns = bench_time_fib(lookups, &sum);
+  route_ns = bench_time_route(lookups, &sum);
+
+  /* the linear scan is O(routes), don't wait forever for it */
+  linear_lookups = LWIP_MIN(lookups, 100000000 / num_routes + 1);
+  start = bench_now_ns();
+  for (i = 0; i < linear_lookups; i++) {
+    best = bench_linear_lookup(&bench_dests[bench_words * i]);
+    sum += bench_routes[best].len;
+  }
+  linear_ns = bench_now_ns() - start;
+
+  for (i = 0; i < linear_lookups; i++) {
+    best = bench_linear_lookup(&bench_dests[bench_words * i]);
+    len = bench_fib_lookup(&bench_dests[bench_words * i], prefix);
+    if ((len != bench_routes[best].len) ||
+        memcmp(prefix, bench_routes[best].key, (size_t)bench_words * sizeof(u32_t))) {
+      fprintf(stderr, "lookup %d: FIB and linear scan disagree\n", i);
+      return 1;
+    }
+  }
+
+  printf("%u routes (%d added), %d lookups (checksum %08lx)\n",
+         (unsigned)((bench_words == 1) ? ip4_fib_num_routes() : ip6_fib_num_routes()),
+         num_routes, lookups, (unsigned long)sum);
+  bench_print((bench_words == 1) ? "ip4_fib_lookup" : "ip6_fib_lookup", fib_ns, lookups);
+  bench_print((bench_words == 1) ? "ip4_route" : "ip6_route", route_ns, lookups);
+  bench_print("linear scan", linear_ns, linear_lookups);
+
+  free(bench_dests);
+  free(bench_routes);
+  return 0;
+}
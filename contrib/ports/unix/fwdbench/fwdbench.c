@@ -0,0 +1,404 @@
+/**
+ * @file
+ * IPv4 and IPv6 forwarding rate between two netifs (IP_FLOW_CACHE_SIZE)
+ *
+ * A NO_SYS stack forwards UDP packets from one Ethernet netif to another. The
+ * packets are passed to ip4_input()/ip6_input() of the first netif and leave
+ * through the linkoutput function of the second one, towards a router that
+ * is reached by a default route in a FIB filled with random routes.
+ *
+ * The packets belong to a growing number of flows (different source ports),
+ * sent round robin: as long as the flows fit into the flow cache, they take
+ * the fast path; beyond that, most packets miss and take the slow path. With
+ * IP_FLOW_CACHE_SIZE set to 0 in lwipopts.h, plain forwarding is measured.
+ *
+ * Reports per address family and number of flows:
+ * - ns per packet from ip4_input()/ip6_input() to the netif linkoutput function
+ * - packets/s
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/etharp.h"
+#include "lwip/ethip6.h"
+#include "lwip/init.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip4.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip6.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/icmp6.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ip6.h"
+#include "lwip/prot/nd6.h"
+#include "lwip/prot/udp.h"
+#include "netif/ethernet.h"
+
+#define BENCH_PAYLOAD_LEN 64
+#define BENCH_PKT_LEN     (IP6_HLEN + UDP_HLEN + BENCH_PAYLOAD_LEN)
+
+static struct netif bench_in, bench_out;
+static ip4_addr_t bench_router4;
+static ip6_addr_t bench_router6;
+static u32_t bench_frames;
+static u32_t bench_dropped;
+static u32_t bench_seed = 1;
+
+static const u8_t bench_in_mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const u8_t bench_out_mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x02};
+static const u8_t bench_router_mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xfe};
+
+static u32_t
+bench_rand(void)
+{
+  /* xorshift32: the same routes for the same seed on every platform */
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* netifs: count forwarded frames, nothing should go back out of the input netif */
+
+static err_t
+bench_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(p);
+  if (netif == &bench_out) {
+    bench_frames++;
+  } else {
+    bench_dropped++;
+  }
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->name[0] = 'f';
+  netif->name[1] = 'b';
+  netif->output = etharp_output;
+  netif->output_ip6 = ethip6_output;
+  netif->linkoutput = bench_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  MEMCPY(netif->hwaddr, (netif == &bench_in) ? bench_in_mac : bench_out_mac, ETH_HWADDR_LEN);
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_MLD6;
+  return ERR_OK;
+}
+
+static void
+bench_add_netif(struct netif *netif, u8_t net)
+{
+  ip4_addr_t addr, netmask;
+  ip6_addr_t addr6;
+
+  IP4_ADDR(&addr, 10, 0, net, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  netif_add(netif, &addr, &netmask, IP4_ADDR_ANY4, NULL, bench_netif_init, ethernet_input);
+  netif_create_ip6_linklocal_address(netif, 1);
+  IP6_ADDR(&addr6, PP_HTONL(0x20010db8UL), lwip_htonl(net), 0, PP_HTONL(0x00000001UL));
+  netif_add_ip6_address(netif, &addr6, NULL);
+  /* no duplicate address detection */
+  netif_ip6_addr_set_state(netif, 0, IP6_ADDR_PREFERRED);
+  netif_ip6_addr_set_state(netif, 1, IP6_ADDR_PREFERRED);
+  netif_set_link_up(netif);
+  netif_set_up(netif);
+}
+
+/** Answer the neighbor solicitation for the IPv6 router: solicited NA with its MAC */
+static void
+bench_resolve_router6(void)
+{
+  struct pbuf *p;
+  struct ip6_hdr *ip6hdr;
+  struct na_header *na;
+  struct lladdr_option *lladdr;
+  const u16_t icmp_len = sizeof(struct na_header) + sizeof(struct lladdr_option);
+  const ip6_addr_t *src = &bench_router6;
+  const ip6_addr_t *dest = netif_ip6_addr(&bench_out, 0);
+
+  p = pbuf_alloc(PBUF_RAW, IP6_HLEN + icmp_len, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  memset(p->payload, 0, p->len);
+  ip6hdr = (struct ip6_hdr *)p->payload;
+  IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+  IP6H_PLEN_SET(ip6hdr, icmp_len);
+  IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_ICMP6);
+  IP6H_HOPLIM_SET(ip6hdr, 255);
+  ip6_addr_copy_to_packed(ip6hdr->src, *src);
+  ip6_addr_copy_to_packed(ip6hdr->dest, *dest);
+
+  na = (struct na_header *)(ip6hdr + 1);
+  na->type = ICMP6_TYPE_NA;
+  na->flags = ND6_FLAG_SOLICITED | ND6_FLAG_OVERRIDE;
+  ip6_addr_copy_to_packed(na->target_address, *src);
+  lladdr = (struct lladdr_option *)(na + 1);
+  lladdr->type = ND6_OPTION_TYPE_TARGET_LLADDR;
+  lladdr->length = 1;
+  MEMCPY(lladdr->addr, bench_router_mac, ETH_HWADDR_LEN);
+
+  pbuf_remove_header(p, IP6_HLEN);
+  na->chksum = ip6_chksum_pseudo(p, IP6_NEXTH_ICMP6, p->len, src, dest);
+  pbuf_add_header(p, IP6_HLEN);
+
+  if (ip6_input(p, &bench_out) != ERR_OK) {
+    fprintf(stderr, "neighbor advertisement not accepted\n");
+    exit(1);
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+/** Fill in the UDP packet of a flow, starting with the IP header */
+static u16_t
+bench_build(u8_t *buf, int v6, u16_t sport)
+{
+  struct udp_hdr *udphdr;
+  u16_t hlen;
+
+  memset(buf, 0, BENCH_PKT_LEN);
+  if (v6) {
+    struct ip6_hdr *ip6hdr = (struct ip6_hdr *)buf;
+    ip6_addr_t src, dest;
+
+    hlen = IP6_HLEN;
+    IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+    IP6H_PLEN_SET(ip6hdr, UDP_HLEN + BENCH_PAYLOAD_LEN);
+    IP6H_NEXTH_SET(ip6hdr, IP_PROTO_UDP);
+    IP6H_HOPLIM_SET(ip6hdr, 64);
+    /* from a host behind the input netif to one far behind the router */
+    IP6_ADDR(&src, PP_HTONL(0x20010db8UL), 0, 0, PP_HTONL(0x00000002UL));
+    IP6_ADDR(&dest, PP_HTONL(0x3fff0000UL), 0, 0, PP_HTONL(0x00000001UL));
+    ip6_addr_copy_to_packed(ip6hdr->src, src);
+    ip6_addr_copy_to_packed(ip6hdr->dest, dest);
+  } else {
+    struct ip_hdr *iphdr = (struct ip_hdr *)buf;
+
+    hlen = IP_HLEN;
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_LEN_SET(iphdr, lwip_htons(IP_HLEN + UDP_HLEN + BENCH_PAYLOAD_LEN));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    IP4_ADDR(&iphdr->src, 10, 0, 0, 2);
+    IP4_ADDR(&iphdr->dest, 198, 18, 0, 1);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  }
+  udphdr = (struct udp_hdr *)(buf + hlen);
+  udphdr->src = lwip_htons(sport);
+  udphdr->dest = PP_HTONS(9);
+  udphdr->len = PP_HTONS(UDP_HLEN + BENCH_PAYLOAD_LEN);
+  return (u16_t)(hlen + UDP_HLEN + BENCH_PAYLOAD_LEN);
+}
+
+/** Pass one packet to the input netif, as its Ethernet driver would */
+static void
+bench_input(const u8_t *pkt, u16_t len, int v6)
+{
+  struct pbuf *p;
+  err_t err;
+
+  p = pbuf_alloc(PBUF_LINK, len, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  MEMCPY(p->payload, pkt, len);
+  if (v6) {
+    err = ip6_input(p, &bench_in);
+  } else {
+    err = ip4_input(p, &bench_in);
+  }
+  if (err != ERR_OK) {
+    fprintf(stderr, "packet not accepted\n");
+    exit(1);
+  }
+}
+
+static void
+bench_add_routes(int routes)
+{
+  ip4_addr_t prefix;
+  ip6_addr_t prefix6;
+  int i;
+
+  for (i = 0; i < routes; i++) {
+    /* never 198.18/15 and 3fff::/16 used by the packets */
+    ip4_addr_set_u32(&prefix, lwip_htonl(0x0b000000UL + (bench_rand() & 0x7fffff00UL)));
+    ip4_fib_add(&prefix, (u8_t)(16 + bench_rand() % 17), &bench_router4, &bench_out);
+    IP6_ADDR(&prefix6, lwip_htonl(0x24000000UL | (bench_rand() & 0x00ffffffUL)), lwip_htonl(bench_rand()), 0, 0);
+    ip6_fib_add(&prefix6, (u8_t)(32 + bench_rand() % 33), &bench_router6, &bench_out);
+  }
+  ip4_addr_set_zero(&prefix);
+  ip6_addr_set_zero(&prefix6);
+  if ((ip4_fib_add(&prefix, 0, &bench_router4, &bench_out) != ERR_OK) ||
+      (ip6_fib_add(&prefix6, 0, &bench_router6, &bench_out) != ERR_OK)) {
+    fprintf(stderr, "adding the default routes failed\n");
+    exit(1);
+  }
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-f flows] [-r routes] [-n packets] [-s seed]\n"
+          "  -f  largest number of flows, doubled from 1 (default: %d)\n"
+          "  -r  random routes in the FIBs (default: 10000)\n"
+          "  -n  packets per number of flows (default: 1000000)\n"
+          "  -s  random seed (default: 1)\n",
+          name, 16 * LWIP_MAX(IP_FLOW_CACHE_SIZE, 64));
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct eth_addr router_mac;
+  u8_t *pkts;
+  u16_t len = 0;
+  u64_t ns;
+  u32_t frames;
+  int max_flows = 16 * LWIP_MAX(IP_FLOW_CACHE_SIZE, 64);
+  int routes = 10000;
+  int packets = 1000000;
+  int opt, i, num, v6;
+
+  while ((opt = getopt(argc, argv, "f:r:n:s:")) != -1) {
+    switch (opt) {
+      case 'f':
+        max_flows = atoi(optarg);
+        if ((max_flows < 1) || (max_flows > 0xffff)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'r':
+        routes = atoi(optarg);
+        if (routes < 0) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        packets = atoi(optarg);
+        if (packets < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 's':
+        bench_seed = (u32_t)strtoul(optarg, NULL, 0);
+        if (bench_seed == 0) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  pkts = (u8_t *)malloc((size_t)max_flows * BENCH_PKT_LEN);
+  if (pkts == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  lwip_init();
+  bench_add_netif(&bench_in, 0);
+  bench_add_netif(&bench_out, 1);
+
+  IP4_ADDR(&bench_router4, 10, 0, 1, 254);
+  MEMCPY(router_mac.addr, bench_router_mac, ETH_HWADDR_LEN);
+  if (etharp_add_static_entry(&bench_router4, &router_mac) != ERR_OK) {
+    fprintf(stderr, "adding the ARP entry failed\n");
+    return 1;
+  }
+  IP6_ADDR(&bench_router6, PP_HTONL(0xfe800000UL), 0, 0, PP_HTONL(0x000000feUL));
+  ip6_addr_assign_zone(&bench_router6, IP6_UNICAST, &bench_out);
+  bench_add_routes(routes);
+
+  /* the first IPv6 packet is queued until the router is resolved */
+  len = bench_build(pkts, 1, 1024);
+  bench_input(pkts, len, 1);
+  bench_resolve_router6();
+  /* ignore what was sent while setting up */
+  bench_dropped = 0;
+
+  printf("flow cache: %d entries, %d routes\n", IP_FLOW_CACHE_SIZE, routes);
+  printf("%4s %8s %10s %12s\n", "", "flows", "ns/packet", "packets/s");
+  for (v6 = 0; v6 <= 1; v6++) {
+    for (i = 0; i < max_flows; i++) {
+      len = bench_build(&pkts[i * BENCH_PKT_LEN], v6, (u16_t)(1024 + i));
+    }
+    for (num = 1; ; num = LWIP_MIN(2 * num, max_flows)) {
+      /* learn the flows, then measure */
+      for (i = 0; i < num; i++) {
+        bench_input(&pkts[i * BENCH_PKT_LEN], len, v6);
+      }
+      frames = bench_frames;
+      ns = bench_now_ns();
+      for (i = 0; i < packets; i++) {
+        bench_input(&pkts[(i % num) * BENCH_PKT_LEN], len, v6);
+      }
+      ns = bench_now_ns() - ns;
+      if ((bench_frames - frames != (u32_t)packets) || (bench_dropped != 0)) {
+        fprintf(stderr, "%d flows: only %lu of %d packets forwarded\n", num,
+                (unsigned long)(bench_frames - frames), packets);
+        return 1;
+      }
+      printf("%4s %8d %10.1f %12.0f\n", v6 ? "IPv6" : "IPv4", num, (double)ns / packets,
+             (double)packets * 1e9 / (double)ns);
+      if (num == max_flows) {
+        break;
+      }
+    }
+  }
+
+  free(pkts);
+  return 0;
+}
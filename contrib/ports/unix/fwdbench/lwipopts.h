@@ -0,0 +1,57 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_FWDBENCH_LWIPOPTS_H
+#define LWIP_FWDBENCH_LWIPOPTS_H
+
+/* Single-threaded raw API stack forwarding between two Ethernet netifs */
+#define NO_SYS                     1
+#define SYS_LIGHTWEIGHT_PROT       0
+#define LWIP_SOCKET                0
+#define LWIP_NETCONN               0
+
+#define LWIP_IPV4                  1
+#define LWIP_IPV6                  1
+#define LWIP_UDP                   1
+#define LWIP_TCP                   0
+
+#define LWIP_NETIF_LOOPBACK        0
+#define LWIP_HAVE_LOOPIF           0
+#define LWIP_STATS                 0
+
+#define IP_FORWARD                 1
+#define LWIP_IPV6_FORWARD          1
+#define LWIP_IPV4_FIB              1
+#define LWIP_IPV6_FIB              1
+#define ETHARP_SUPPORT_STATIC_ENTRIES 1
+
+/* set IP_FLOW_CACHE_SIZE to 0 to compare with plain forwarding */
+#define IP_FLOW_CACHE_SIZE         1024
+
+#define MEM_LIBC_MALLOC            1
+#define MEMP_MEM_MALLOC            1
+
+#endif /* LWIP_FWDBENCH_LWIPOPTS_H */
@@ -0,0 +1,63 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_MMSGBENCH_LWIPOPTS_H
+#define LWIP_MMSGBENCH_LWIPOPTS_H
+
+/* Sockets over the loopback netif, the stack runs in tcpip_thread */
+#define NO_SYS                     0
+/* each socket call is a message to tcpip_thread, set this to 1 to compare
+   with calls that take the core lock instead */
+#define LWIP_TCPIP_CORE_LOCKING    0
+#define LWIP_SOCKET                1
+#define LWIP_NETCONN               1
+#define LWIP_COMPAT_SOCKETS        0
+#define LWIP_SO_RCVTIMEO           1
+/* set LWIP_SOCKET_MMSG to 0 to build the sendto/recvfrom part only */
+#define LWIP_SOCKET_MMSG           1
+
+#define LWIP_IPV4                  1
+#define LWIP_IPV6                  0
+#define LWIP_UDP                   1
+#define LWIP_TCP                   1
+
+#define LWIP_NETIF_LOOPBACK        1
+#define LWIP_HAVE_LOOPIF           1
+#define LWIP_LOOPBACK_MAX_PBUFS    0
+#define LWIP_STATS                 0
+
+/* a whole burst of the benchmark must fit into the receive queue */
+#define MEMP_NUM_NETBUF            32
+#define DEFAULT_UDP_RECVMBOX_SIZE  32
+#define TCPIP_MBOX_SIZE            64
+
+#define MEM_LIBC_MALLOC            1
+#define MEMP_MEM_MALLOC            1
+
+void sys_check_core_locking(void);
+#define LWIP_ASSERT_CORE_LOCKED()  sys_check_core_locking()
+
+#endif /* LWIP_MMSGBENCH_LWIPOPTS_H */
@@ -0,0 +1,96 @@
+/**
+ * @file
+ * Per-datagram cost of sendto/recvfrom versus sendmmsg/recvmmsg
+ *
+ * Runs test/sockets/sockets_mmsg_bench.c against the loopback netif of a
+ * stack in tcpip_thread: small UDP datagrams are sent to the benchmark's
+ * own socket in bursts, first with one call per datagram, then with one
+ * call per burst.
+ *
+ * Reports per API:
+ * - datagrams/s
+ * - ns per datagram (one send plus one receive)
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "sockets_mmsg_bench.h"
+
+static void
+bench_tcpip_init_done(void *arg)
+{
+  sys_sem_signal((sys_sem_t *)arg);
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-n datagrams]\n"
+          "  -n  datagrams per API (default: 1000000)\n",
+          name);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  sys_sem_t init_sem;
+  long num = 1000000;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:")) != -1) {
+    switch (opt) {
+      case 'n':
+        num = atol(optarg);
+        if ((num < 1) || (num > 0x7fffffffL)) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  if (sys_sem_new(&init_sem, 0) != ERR_OK) {
+    fprintf(stderr, "sys_sem_new failed\n");
+    return 1;
+  }
+  tcpip_init(bench_tcpip_init_done, &init_sem);
+  sys_sem_wait(&init_sem);
+  sys_sem_free(&init_sem);
+
+  sockets_mmsg_bench_loopback((u32_t)num);
+  return 0;
+}
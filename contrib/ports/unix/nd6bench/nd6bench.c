@@ -0,0 +1,313 @@
+/**
+ * @file
+ * IPv6 send rate over the number of distinct destinations (ND6 caches)
+ *
+ * Sends UDP packets from a NO_SYS stack over an Ethernet netif to a growing
+ * number of off-link destinations, round robin. All of them are reached
+ * through one router (a default route in the FIB), so every packet needs a
+ * destination cache lookup and, once the destinations outnumber the cache,
+ * an entry is recycled for each packet.
+ *
+ * The router is resolved once by injecting a neighbor advertisement. With
+ * LWIP_ND6_CACHE_HASH_SIZE set to 0 in lwipopts.h, the linear caches of
+ * plain lwIP are measured instead.
+ *
+ * Reports per number of destinations:
+ * - ns per packet from udp_sendto() to the netif linkoutput function
+ * - packets/s
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/ethip6.h"
+#include "lwip/init.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/ip6.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/nd6.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/prot/icmp6.h"
+#include "lwip/prot/ip6.h"
+#include "lwip/prot/nd6.h"
+#include "netif/ethernet.h"
+
+#define BENCH_PAYLOAD_LEN 64
+
+static struct netif bench_netif;
+static ip6_addr_t bench_router;
+static ip_addr_t *bench_dests;
+static u32_t bench_frames;
+static u32_t bench_seed = 1;
+
+static const u8_t bench_mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const u8_t bench_router_mac[ETH_HWADDR_LEN] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xfe};
+
+static u32_t
+bench_rand(void)
+{
+  /* xorshift32: the same destinations for the same seed on every platform */
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* netif: count and discard everything */
+
+static err_t
+bench_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  bench_frames++;
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->name[0] = 'n';
+  netif->name[1] = 'b';
+  netif->output_ip6 = ethip6_output;
+  netif->linkoutput = bench_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  MEMCPY(netif->hwaddr, bench_mac, ETH_HWADDR_LEN);
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_MLD6;
+  return ERR_OK;
+}
+
+/** Answer the neighbor solicitation for the router: solicited NA with its MAC */
+static void
+bench_resolve_router(void)
+{
+  struct pbuf *p;
+  struct ip6_hdr *ip6hdr;
+  struct na_header *na;
+  struct lladdr_option *lladdr;
+  const u16_t icmp_len = sizeof(struct na_header) + sizeof(struct lladdr_option);
+  const ip6_addr_t *src = &bench_router;
+  const ip6_addr_t *dest = netif_ip6_addr(&bench_netif, 0);
+
+  p = pbuf_alloc(PBUF_RAW, IP6_HLEN + icmp_len, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  memset(p->payload, 0, p->len);
+  ip6hdr = (struct ip6_hdr *)p->payload;
+  IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+  IP6H_PLEN_SET(ip6hdr, icmp_len);
+  IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_ICMP6);
+  IP6H_HOPLIM_SET(ip6hdr, 255);
+  ip6_addr_copy_to_packed(ip6hdr->src, *src);
+  ip6_addr_copy_to_packed(ip6hdr->dest, *dest);
+
+  na = (struct na_header *)(ip6hdr + 1);
+  na->type = ICMP6_TYPE_NA;
+  na->flags = ND6_FLAG_SOLICITED | ND6_FLAG_OVERRIDE;
+  ip6_addr_copy_to_packed(na->target_address, *src);
+  lladdr = (struct lladdr_option *)(na + 1);
+  lladdr->type = ND6_OPTION_TYPE_TARGET_LLADDR;
+  lladdr->length = 1;
+  MEMCPY(lladdr->addr, bench_router_mac, ETH_HWADDR_LEN);
+
+  pbuf_remove_header(p, IP6_HLEN);
+  na->chksum = ip6_chksum_pseudo(p, IP6_NEXTH_ICMP6, p->len, src, dest);
+  pbuf_add_header(p, IP6_HLEN);
+
+  if (ip6_input(p, &bench_netif) != ERR_OK) {
+    fprintf(stderr, "neighbor advertisement not accepted\n");
+    exit(1);
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static void
+bench_send(struct udp_pcb *pcb, const ip_addr_t *dest)
+{
+  struct pbuf *p;
+
+  p = pbuf_alloc(PBUF_TRANSPORT, BENCH_PAYLOAD_LEN, PBUF_RAM);
+  if (p == NULL) {
+    fprintf(stderr, "out of memory\n");
+    exit(1);
+  }
+  if (udp_sendto(pcb, p, dest, 9) != ERR_OK) {
+    fprintf(stderr, "udp_sendto failed\n");
+    exit(1);
+  }
+  pbuf_free(p);
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-d destinations] [-c cache size] [-n packets] [-s seed]\n"
+          "  -d  largest number of destinations, doubled from 1 (default: %d)\n"
+          "  -c  destination cache entries in use (default and max: %d)\n"
+          "  -n  packets per number of destinations (default: 200000)\n"
+          "  -s  random seed (default: 1)\n",
+          name, 2 * LWIP_ND6_NUM_DESTINATIONS, LWIP_ND6_NUM_DESTINATIONS);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct udp_pcb *pcb;
+  ip6_addr_t addr, prefix;
+  u64_t ns;
+  u32_t frames;
+  int max_dests = 2 * LWIP_ND6_NUM_DESTINATIONS;
+  int cache_size = LWIP_ND6_NUM_DESTINATIONS;
+  int packets = 200000;
+  int opt, i, num;
+
+  while ((opt = getopt(argc, argv, "d:c:n:s:")) != -1) {
+    switch (opt) {
+      case 'd':
+        max_dests = atoi(optarg);
+        if (max_dests < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 'c':
+        cache_size = atoi(optarg);
+        if ((cache_size < 1) || (cache_size > LWIP_ND6_NUM_DESTINATIONS)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        packets = atoi(optarg);
+        if (packets < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 's':
+        bench_seed = (u32_t)strtoul(optarg, NULL, 0);
+        if (bench_seed == 0) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  bench_dests = (ip_addr_t *)calloc((size_t)max_dests, sizeof(ip_addr_t));
+  if (bench_dests == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  /* 2001:db8:100::/40, off-link */
+  for (i = 0; i < max_dests; i++) {
+    IP_ADDR6(&bench_dests[i], PP_HTONL(0x20010db8UL), lwip_htonl(0x01000000UL | (bench_rand() & 0xffffff)),
+             lwip_htonl(bench_rand()), lwip_htonl(bench_rand()));
+  }
+
+  lwip_init();
+  if (nd6_set_cache_sizes(LWIP_ND6_NUM_NEIGHBORS, (u16_t)cache_size) != ERR_OK) {
+    fprintf(stderr, "nd6_set_cache_sizes failed\n");
+    return 1;
+  }
+  netif_add(&bench_netif, NULL, bench_netif_init, ethernet_input);
+  netif_create_ip6_linklocal_address(&bench_netif, 1);
+  IP6_ADDR(&addr, PP_HTONL(0x20010db8UL), PP_HTONL(0x00010000UL), 0, PP_HTONL(0x00000001UL));
+  netif_add_ip6_address(&bench_netif, &addr, NULL);
+  /* no duplicate address detection */
+  netif_ip6_addr_set_state(&bench_netif, 0, IP6_ADDR_PREFERRED);
+  netif_ip6_addr_set_state(&bench_netif, 1, IP6_ADDR_PREFERRED);
+  netif_set_link_up(&bench_netif);
+  netif_set_up(&bench_netif);
+
+  ip6_addr_set_zero(&prefix);
+  IP6_ADDR(&bench_router, PP_HTONL(0xfe800000UL), 0, 0, PP_HTONL(0x000000feUL));
+  if (ip6_fib_add(&prefix, 0, &bench_router, &bench_netif) != ERR_OK) {
+    fprintf(stderr, "adding the default route failed\n");
+    return 1;
+  }
+
+  pcb = udp_new_ip_type(IPADDR_TYPE_V6);
+  if (pcb == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  /* the first packet is queued until the router is resolved */
+  bench_send(pcb, &bench_dests[0]);
+  bench_resolve_router();
+
+  printf("destination cache: %d of %d entries, %s\n", cache_size, LWIP_ND6_NUM_DESTINATIONS,
+         LWIP_ND6_CACHE_HASH_SIZE ? "hashed" : "linear");
+  printf("%12s %10s %12s\n", "destinations", "ns/packet", "packets/s");
+  for (num = 1; ; num = LWIP_MIN(2 * num, max_dests)) {
+    /* fill the cache, then measure */
+    for (i = 0; i < num; i++) {
+      bench_send(pcb, &bench_dests[i]);
+    }
+    frames = bench_frames;
+    ns = bench_now_ns();
+    for (i = 0; i < packets; i++) {
+      bench_send(pcb, &bench_dests[i % num]);
+    }
+    ns = bench_now_ns() - ns;
+    if (bench_frames - frames != (u32_t)packets) {
+      fprintf(stderr, "%d destinations: only %lu of %d packets sent\n", num,
+              (unsigned long)(bench_frames - frames), packets);
+      return 1;
+    }
+    printf("%12d %10.1f %12.0f\n", num, (double)ns / packets, (double)packets * 1e9 / (double)ns);
+    if (num == max_dests) {
+      break;
+    }
+  }
+
+  udp_remove(pcb);
+  free(bench_dests);
+  return 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file
+ * Replays a pcap capture of recorded traffic into a NO_SYS lwIP stack
+ *
+ * The frames of the capture (Ethernet link type) are fed to ethernet_input()
+ * through pcapreplayif, either as fast as possible or with their recorded
+ * timing (-r). sys_now() follows the recorded timestamps, so the stack's
+ * timers fire as they would have while the traffic was received.
+ * Frames sent by the stack are counted and discarded; since nobody answers
+ * them, recorded TCP connections do not get past the handshake with lwIP's
+ * sequence numbers: the run measures the receive path.
+ *
+ * Reports:
+ * - packets/s and bytes/s processed
+ * - per-layer time (see arch/perf.h, times include the layers below)
+ * - heap and memp pool high-water marks
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/timeouts.h"
+#include "netif/ethernet.h"
+#include "netif/pcapreplayif.h"
+
+#define REPLAY_MAX_PORTS 16
+
+static struct netif replay_netif;
+
+/*-----------------------------------------------------------------------------------*/
+/* Listeners that accept everything and discard the data */
+
+static err_t
+replay_tcp_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_close(pcb);
+    return ERR_OK;
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+replay_tcp_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  if ((err != ERR_OK) || (pcb == NULL)) {
+    return ERR_VAL;
+  }
+  tcp_recv(pcb, replay_tcp_recv);
+  return ERR_OK;
+}
+
+static void
+replay_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  pbuf_free(p);
+}
+
+static void
+replay_listen(u16_t tcp_port, u16_t udp_port)
+{
+  if (tcp_port != 0) {
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if ((pcb == NULL) || (tcp_bind(pcb, IP_ANY_TYPE, tcp_port) != ERR_OK) ||
+        ((pcb = tcp_listen(pcb)) == NULL)) {
+      fprintf(stderr, "pcapreplay: cannot listen on TCP port %u\n", tcp_port);
+      exit(1);
+    }
+    tcp_accept(pcb, replay_tcp_accept);
+  }
+  if (udp_port != 0) {
+    struct udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if ((pcb == NULL) || (udp_bind(pcb, IP_ANY_TYPE, udp_port) != ERR_OK)) {
+      fprintf(stderr, "pcapreplay: cannot bind UDP port %u\n", udp_port);
+      exit(1);
+    }
+    udp_recv(pcb, replay_udp_recv, NULL);
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static void
+replay_report(const struct pcapreplayif_stats *stats)
+{
+  double secs = (double)stats->elapsed_ns / 1e9;
+  int i;
+
+  printf("replayed %lu frames (%lu bytes, recorded over %lu ms) in %.3f s\n",
+         (unsigned long)stats->packets, (unsigned long)stats->bytes, (unsigned long)stats->recorded_ms, secs);
+  if (secs > 0) {
+    printf("  %.0f packets/s, %.1f Mbit/s\n", (double)stats->packets / secs, (double)stats->bytes * 8 / secs / 1e6);
+  }
+  printf("  %lu dropped by the driver, %lu frames (%lu bytes) sent by the stack\n",
+         (unsigned long)stats->dropped, (unsigned long)stats->tx_packets, (unsigned long)stats->tx_bytes);
+
+  printf("\n");
+  perf_report();
+
+  printf("\n%-16s %8s %8s %8s\n", "pool", "max", "avail", "failed");
+  printf("%-16s %8lu %8lu %8lu\n", "HEAP", (unsigned long)lwip_stats.mem.max,
+         (unsigned long)lwip_stats.mem.avail, (unsigned long)lwip_stats.mem.err);
+  for (i = 0; i < MEMP_MAX; i++) {
+    const struct stats_mem *m = lwip_stats.memp[i];
+    printf("%-16s %8lu %8lu %8lu\n", m->name, (unsigned long)m->max, (unsigned long)m->avail, (unsigned long)m->err);
+  }
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-r] [-n count] [-a addr[/prefixlen]] [-t port] [-u port] file.pcap\n"
+          "  -r  keep the recorded timing (default: as fast as possible)\n"
+          "  -n  replay the capture 'count' times (default: 1)\n"
+          "  -a  IPv4 address of the netif (default: destination of the first IPv4 packet, /24)\n"
+          "  -t  accept TCP connections on 'port' (may be repeated)\n"
+          "  -u  receive UDP datagrams on 'port' (may be repeated)\n", name);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct pcapreplayif_stats stats, total;
+  u16_t tcp_ports[REPLAY_MAX_PORTS], udp_ports[REPLAY_MAX_PORTS];
+  int num_tcp = 0, num_udp = 0;
+  const char *addr = NULL;
+  int realtime = 0, count = 1;
+  int prefixlen = 24;
+  ip4_addr_t ipaddr, netmask;
+  char *slash;
+  int opt, i;
+
+  while ((opt = getopt(argc, argv, "rn:a:t:u:")) != -1) {
+    switch (opt) {
+      case 'r':
+        realtime = 1;
+        break;
+      case 'n':
+        count = atoi(optarg);
+        if (count <= 0) {
+          usage(argv[0]);
+        }
+        break;
+      case 'a':
+        addr = optarg;
+        break;
+      case 't':
+        if (num_tcp == REPLAY_MAX_PORTS) {
+          usage(argv[0]);
+        }
+        tcp_ports[num_tcp++] = (u16_t)atoi(optarg);
+        break;
+      case 'u':
+        if (num_udp == REPLAY_MAX_PORTS) {
+          usage(argv[0]);
+        }
+        udp_ports[num_udp++] = (u16_t)atoi(optarg);
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+  if (optind != argc - 1) {
+    usage(argv[0]);
+  }
+
+  lwip_init();
+
+  if (netif_add(&replay_netif, NULL, NULL, NULL, argv[optind], pcapreplayif_init, ethernet_input) == NULL) {
+    fprintf(stderr, "pcapreplay: cannot open %s\n", argv[optind]);
+    return 1;
+  }
+  if (addr != NULL) {
+    char buf[32];
+    strncpy(buf, addr, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+    slash = strchr(buf, '/');
+    if (slash != NULL) {
+      *slash = 0;
+      prefixlen = atoi(slash + 1);
+    }
+    if (!ip4addr_aton(buf, &ipaddr) || (prefixlen < 0) || (prefixlen > 32)) {
+      usage(argv[0]);
+    }
+  } else if (pcapreplayif_guess_ip4(&replay_netif, &ipaddr) != ERR_OK) {
+    ip4_addr_set_zero(&ipaddr);
+  }
+  ip4_addr_set_u32(&netmask, prefixlen ? lwip_htonl((u32_t)(0xffffffffUL << (32 - prefixlen))) : 0);
+  netif_set_addr(&replay_netif, &ipaddr, &netmask, NULL);
+  netif_create_ip6_linklocal_address(&replay_netif, 1);
+  netif_set_default(&replay_netif);
+  netif_set_up(&replay_netif);
+
+  for (i = 0; i < LWIP_MAX(num_tcp, num_udp); i++) {
+    replay_listen((u16_t)(i < num_tcp ? tcp_ports[i] : 0), (u16_t)(i < num_udp ? udp_ports[i] : 0));
+  }
+
+  printf("pcapreplay: %s as %s/%d%s\n", argv[optind], ip4addr_ntoa(&ipaddr), prefixlen,
+         realtime ? ", recorded timing" : "");
+  memset(&total, 0, sizeof(total));
+  for (i = 0; i < count; i++) {
+    pcapreplayif_replay(&replay_netif, realtime, &stats);
+    total.packets += stats.packets;
+    total.bytes += stats.bytes;
+    total.dropped += stats.dropped;
+    total.tx_packets += stats.tx_packets;
+    total.tx_bytes += stats.tx_bytes;
+    total.recorded_ms += stats.recorded_ms;
+    total.elapsed_ns += stats.elapsed_ns;
+  }
+  replay_report(&total);
+  return 0;
+}
@@ -34,6 +34,8 @@
 
 #include <sys/times.h>
 
+#include "lwip/arch.h"
+
 #ifdef PERF
 #define PERF_START  { \
                          unsigned long __c1l, __c1h, __c2l, __c2h; \
@@ -48,10 +50,21 @@
                      perf_print_times(&__perf_start, &__perf_end, x);\
                      } while(0)*/
 #else /* PERF */
-#define PERF_START    /* null definition */
-#define PERF_STOP(x)  /* null definition */
+/* Accumulate the time spent between PERF_START and PERF_STOP(key) per key,
+   see perf_report(). Like the PERF variant, PERF_START opens a block holding
+   the start time and PERF_STOP closes it: every PERF_START needs exactly one
+   PERF_STOP in the same function, returns in between are not measured.
+   Calls are nested, so times include the layers below. */
+#define PERF_START    { u64_t __perf_start = perf_now()
+#define PERF_STOP(x)  perf_stop(x, __perf_start); }
 #endif /* PERF */
 
+u64_t perf_now(void);
+void perf_stop(const char *key, u64_t start);
+/* Print calls and time per key to stdout */
+void perf_report(void);
+void perf_reset(void);
+
 void perf_print(unsigned long c1l, unsigned long c1h,
 		unsigned long c2l, unsigned long c2h,
 		char *key);
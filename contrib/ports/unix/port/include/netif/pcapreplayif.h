@@ -0,0 +1,66 @@
+/**
+ * @file
+ * Netif replaying a pcap capture file into the stack
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_PCAPREPLAYIF_H
+#define LWIP_PCAPREPLAYIF_H
+
+#include "lwip/netif.h"
+#include "lwip/ip4_addr.h"
+
+/** Counters of one pcapreplayif_replay() run */
+struct pcapreplayif_stats {
+  /** frames passed to netif->input */
+  u32_t packets;
+  u64_t bytes;
+  /** frames that could not be allocated or were rejected by netif->input */
+  u32_t dropped;
+  /** frames sent by the stack (discarded) */
+  u32_t tx_packets;
+  u64_t tx_bytes;
+  /** time between the first and the last record of the capture */
+  u32_t recorded_ms;
+  /** wall clock time the replay took */
+  u64_t elapsed_ns;
+};
+
+/* Pass the name of the pcap file (Ethernet link type) as 'state' to netif_add() */
+err_t pcapreplayif_init(struct netif *netif);
+/* Feed all frames of the capture to netif->input, either as fast as possible or
+   (realtime != 0) with the recorded gaps. If LWIP_VIRTUAL_SYS_NOW is defined,
+   sys_now() follows the recorded timestamps in both cases. */
+err_t pcapreplayif_replay(struct netif *netif, int realtime, struct pcapreplayif_stats *stats);
+#if LWIP_IPV4
+/* Get the destination of the first IPv4 packet in the capture, which is
+   usually a good guess for the address of the recording host */
+err_t pcapreplayif_guess_ip4(struct netif *netif, ip4_addr_t *addr);
+#endif /* LWIP_IPV4 */
+
+#endif /* LWIP_PCAPREPLAYIF_H */
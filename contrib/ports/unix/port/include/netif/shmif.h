@@ -0,0 +1,58 @@
+/**
+ * @file
+ * Shared-memory netif pair (lock-free SPSC rings)
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_SHMIF_H
+#define LWIP_SHMIF_H
+
+#include "lwip/netif.h"
+
+/** Memory shared by the two ends of a link */
+struct shmif_region;
+
+/** Pass a pointer to this as 'state' to netif_add() (only read during init) */
+struct shmif_config {
+  /** region created by shmif_region_create() or shmif_region_attach() */
+  struct shmif_region *region;
+  /** end of the link to attach to: 0 or 1 */
+  u8_t side;
+};
+
+/* Create a new link in a memfd; if 'fd' is not NULL, the descriptor is
+   returned there (e.g. to pass it to another process), otherwise it is closed */
+struct shmif_region *shmif_region_create(int *fd);
+/* Map a link created by another process */
+struct shmif_region *shmif_region_attach(int fd);
+void shmif_region_release(struct shmif_region *region);
+
+err_t shmif_init(struct netif *netif);
+void shmif_poll(struct netif *netif);
+
+#endif /* LWIP_SHMIF_H */
@@ -0,0 +1,336 @@
+/**
+ * @file
+ * Netif replaying a pcap capture file into the stack
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Replays a capture of recorded traffic (classic pcap format, microsecond or
+ * nanosecond timestamps, either byte order) into the stack to measure and
+ * debug it offline. The file is mapped into memory so that reading it does
+ * not show up in the measurement. Frames sent by the stack are counted and
+ * discarded. Define LWIP_VIRTUAL_SYS_NOW to run the stack's timers on the
+ * recorded time.
+ */
+
+#include "lwip/opt.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/pbuf.h"
+#include "lwip/snmp.h"
+#include "lwip/sys.h"
+#include "lwip/timeouts.h"
+#include "netif/etharp.h"
+#include "lwip/ethip6.h"
+
+#include "netif/pcapreplayif.h"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 'p'
+#define IFNAME1 'r'
+
+#ifndef PCAPREPLAYIF_DEBUG
+#define PCAPREPLAYIF_DEBUG LWIP_DBG_OFF
+#endif
+
+#define PCAP_MAGIC_USEC       0xa1b2c3d4UL
+#define PCAP_MAGIC_NSEC       0xa1b23c4dUL
+#define PCAP_FILE_HDR_LEN     24
+#define PCAP_REC_HDR_LEN      16
+#define PCAP_LINKTYPE_ETHERNET 1
+
+struct pcapreplayif {
+  const u8_t *data;
+  size_t size;
+  /* file was written with the other byte order */
+  int swapped;
+  /* timestamp fraction is in nanoseconds instead of microseconds */
+  int nsec;
+  u32_t tx_packets;
+  u64_t tx_bytes;
+};
+
+/*-----------------------------------------------------------------------------------*/
+static u32_t
+pcapreplayif_u32(const struct pcapreplayif *state, const u8_t *ptr)
+{
+  u32_t v;
+
+  memcpy(&v, ptr, sizeof(v));
+  if (state->swapped) {
+    v = ((v & 0xff) << 24) | ((v & 0xff00) << 8) | ((v >> 8) & 0xff00) | (v >> 24);
+  }
+  return v;
+}
+
+/* Get the record at 'offset', returns NULL at the end of the capture and
+   advances 'offset' to the next record */
+static const u8_t *
+pcapreplayif_record(const struct pcapreplayif *state, size_t *offset, u64_t *ts_ns, u32_t *len)
+{
+  const u8_t *rec = state->data + *offset;
+  u32_t frac;
+
+  if (*offset + PCAP_REC_HDR_LEN > state->size) {
+    return NULL;
+  }
+  *len = pcapreplayif_u32(state, rec + 8);
+  if (*len > state->size - *offset - PCAP_REC_HDR_LEN) {
+    LWIP_DEBUGF(PCAPREPLAYIF_DEBUG, ("pcapreplayif: truncated record at offset %lu\n", (unsigned long)*offset));
+    return NULL;
+  }
+  frac = pcapreplayif_u32(state, rec + 4);
+  *ts_ns = (u64_t)pcapreplayif_u32(state, rec) * 1000000000 + (state->nsec ? frac : (u64_t)frac * 1000);
+  *offset += PCAP_REC_HDR_LEN + *len;
+  return rec + PCAP_REC_HDR_LEN;
+}
+
+static u64_t
+pcapreplayif_clock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct pcapreplayif *state = (struct pcapreplayif *)netif->state;
+
+  state->tx_packets++;
+  state->tx_bytes += p->tot_len;
+  MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+err_t
+pcapreplayif_replay(struct netif *netif, int realtime, struct pcapreplayif_stats *stats)
+{
+  struct pcapreplayif *state = (struct pcapreplayif *)netif->state;
+  const u8_t *frame;
+  size_t offset = PCAP_FILE_HDR_LEN;
+  u64_t ts_ns, first_ns = 0, last_ns = 0, start;
+  u32_t len;
+#ifdef LWIP_VIRTUAL_SYS_NOW
+  u32_t base = sys_now();
+#endif /* LWIP_VIRTUAL_SYS_NOW */
+  int first = 1;
+
+  LWIP_ERROR("pcapreplayif_replay: invalid stats", stats != NULL, return ERR_ARG;);
+  memset(stats, 0, sizeof(*stats));
+  state->tx_packets = 0;
+  state->tx_bytes = 0;
+
+  start = pcapreplayif_clock();
+  while ((frame = pcapreplayif_record(state, &offset, &ts_ns, &len)) != NULL) {
+    struct pbuf *p;
+
+    if (first) {
+      first_ns = ts_ns;
+      first = 0;
+    }
+    if (ts_ns > last_ns) {
+      /* captures are not always sorted, never let the time go back */
+      last_ns = ts_ns;
+    }
+#ifdef LWIP_VIRTUAL_SYS_NOW
+    /* recorded time starts at the time the replay starts */
+    sys_now_set_virtual(base + (u32_t)((last_ns - first_ns) / 1000000));
+#endif /* LWIP_VIRTUAL_SYS_NOW */
+
+    if (realtime) {
+      u64_t now = pcapreplayif_clock();
+      u64_t due = start + (last_ns - first_ns);
+      if (due > now) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)((due - now) / 1000000000);
+        ts.tv_nsec = (long)((due - now) % 1000000000);
+        nanosleep(&ts, NULL);
+      }
+    }
+#if NO_SYS
+    /* run the timers that expired before this frame was received */
+    sys_check_timeouts();
+#endif /* NO_SYS */
+
+    if (len > 0xFFFF) {
+      /* cannot be represented in a pbuf */
+      stats->dropped++;
+      continue;
+    }
+    p = pbuf_alloc(PBUF_RAW, (u16_t)len, PBUF_POOL);
+    if (p == NULL) {
+      LWIP_DEBUGF(PCAPREPLAYIF_DEBUG, ("pcapreplayif: could not allocate pbuf\n"));
+      stats->dropped++;
+      continue;
+    }
+    pbuf_take(p, frame, (u16_t)len);
+    MIB2_STATS_NETIF_ADD(netif, ifinoctets, len);
+    stats->packets++;
+    stats->bytes += len;
+    if (netif->input(p, netif) != ERR_OK) {
+      LWIP_DEBUGF(PCAPREPLAYIF_DEBUG, ("pcapreplayif: netif input error\n"));
+      pbuf_free(p);
+      stats->dropped++;
+    }
+  }
+  stats->elapsed_ns = pcapreplayif_clock() - start;
+  stats->recorded_ms = (u32_t)((last_ns - first_ns) / 1000000);
+  stats->tx_packets = state->tx_packets;
+  stats->tx_bytes = state->tx_bytes;
+  return ERR_OK;
+}
+
+#if LWIP_IPV4
+err_t
+pcapreplayif_guess_ip4(struct netif *netif, ip4_addr_t *addr)
+{
+  struct pcapreplayif *state = (struct pcapreplayif *)netif->state;
+  const u8_t *frame;
+  size_t offset = PCAP_FILE_HDR_LEN;
+  u64_t ts_ns;
+  u32_t len;
+
+  while ((frame = pcapreplayif_record(state, &offset, &ts_ns, &len)) != NULL) {
+    u32_t hdr = SIZEOF_ETH_HDR;
+    u16_t type;
+
+    if (len < SIZEOF_ETH_HDR) {
+      continue;
+    }
+    type = (u16_t)((frame[12] << 8) | frame[13]);
+    if ((type == ETHTYPE_VLAN) && (len >= SIZEOF_ETH_HDR + 4)) {
+      type = (u16_t)((frame[16] << 8) | frame[17]);
+      hdr += 4;
+    }
+    if ((type == ETHTYPE_IP) && (len >= hdr + 20) && ((frame[hdr] >> 4) == 4)) {
+      memcpy(addr, frame + hdr + 16, sizeof(*addr));
+      return ERR_OK;
+    }
+  }
+  return ERR_VAL;
+}
+#endif /* LWIP_IPV4 */
+
+/*-----------------------------------------------------------------------------------*/
+err_t
+pcapreplayif_init(struct netif *netif)
+{
+  const char *fname = (const char *)netif->state;
+  struct pcapreplayif *state;
+  struct stat st;
+  u32_t magic;
+  void *data;
+  int fd;
+
+  LWIP_ERROR("pcapreplayif_init: invalid file name", fname != NULL, return ERR_ARG;);
+
+  fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapreplayif_init: cannot open %s\n", fname));
+    return ERR_IF;
+  }
+  if ((fstat(fd, &st) != 0) || (st.st_size < PCAP_FILE_HDR_LEN)) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapreplayif_init: %s is not a pcap file\n", fname));
+    close(fd);
+    return ERR_IF;
+  }
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapreplayif_init: cannot map %s\n", fname));
+    return ERR_IF;
+  }
+
+  state = (struct pcapreplayif *)mem_malloc(sizeof(struct pcapreplayif));
+  if (state == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapreplayif_init: out of memory for pcapreplayif\n"));
+    munmap(data, (size_t)st.st_size);
+    return ERR_MEM;
+  }
+  memset(state, 0, sizeof(struct pcapreplayif));
+  state->data = (const u8_t *)data;
+  state->size = (size_t)st.st_size;
+
+  magic = pcapreplayif_u32(state, state->data);
+  if ((magic != PCAP_MAGIC_USEC) && (magic != PCAP_MAGIC_NSEC)) {
+    state->swapped = 1;
+    magic = pcapreplayif_u32(state, state->data);
+  }
+  state->nsec = (magic == PCAP_MAGIC_NSEC);
+  if (((magic != PCAP_MAGIC_USEC) && (magic != PCAP_MAGIC_NSEC)) ||
+      ((pcapreplayif_u32(state, state->data + 20) & 0xffff) != PCAP_LINKTYPE_ETHERNET)) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pcapreplayif_init: %s is not an Ethernet pcap file\n", fname));
+    munmap(data, state->size);
+    mem_free(state);
+    return ERR_IF;
+  }
+  netif->state = state;
+
+  MIB2_INIT_NETIF(netif, snmp_ifType_ethernet_csmacd, 0);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = low_level_output;
+  netif->mtu = 1500;
+
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 'p';
+  netif->hwaddr[2] = 'c';
+  netif->hwaddr[3] = 'a';
+  netif->hwaddr[4] = 'p';
+  netif->hwaddr[5] = 0x01;
+  netif->hwaddr_len = 6;
+
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6;
+
+  netif_set_link_up(netif);
+
+  return ERR_OK;
+}
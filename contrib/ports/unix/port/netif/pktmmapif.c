@@ -0,0 +1,635 @@
+/**
+ * @file
+ * Linux AF_PACKET (TPACKET_V3 mmap ring) netif
+ *
+ * Attaches lwIP to an existing Linux interface (e.g. one end of a veth pair)
+ * through a packet socket with memory-mapped RX and TX rings:
+ * - RX uses TPACKET_V3 blocks. Frames are passed to the stack as PBUF_REF
+ *   custom pbufs pointing into the ring; a block is handed back to the kernel
+ *   when the last pbuf referencing it is freed. If the stack holds on to too
+ *   many blocks (e.g. TCP out-of-sequence queues, slow applications), frames
+ *   are copied into PBUF_POOL pbufs instead so that the ring cannot run dry.
+ * - TX copies the frame into the next free TX ring slot and kicks the kernel.
+ *   Kernels without TPACKET_V3 TX ring support (< 4.11) fall back to sendmsg()
+ *   with the pbuf chain as iovec.
+ *
+ * The interface is put into promiscuous mode, since lwIP uses its own MAC
+ * address on the link. Needs CAP_NET_RAW.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if defined(LWIP_UNIX_LINUX)
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <net/if.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "netif/etharp.h"
+#include "lwip/ethip6.h"
+
+#include "netif/pktmmapif.h"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 'p'
+#define IFNAME1 'k'
+
+#ifndef PKTMMAPIF_DEBUG
+#define PKTMMAPIF_DEBUG LWIP_DBG_OFF
+#endif
+
+#ifndef PKTMMAPIF_DEFAULT_IF
+#define PKTMMAPIF_DEFAULT_IF "veth1"
+#endif
+
+/* size of one ring block (multiple of the page size) */
+#ifndef PKTMMAPIF_BLOCK_SIZE
+#define PKTMMAPIF_BLOCK_SIZE (1 << 16)
+#endif
+
+/* number of RX blocks */
+#ifndef PKTMMAPIF_RX_BLOCKS
+#define PKTMMAPIF_RX_BLOCKS 32
+#endif
+
+/* ms after which the kernel hands over a partially filled RX block */
+#ifndef PKTMMAPIF_RX_BLOCK_TIMEOUT
+#define PKTMMAPIF_RX_BLOCK_TIMEOUT 1
+#endif
+
+/* number of TX blocks, each split into PKTMMAPIF_TX_FRAME_SIZE slots */
+#ifndef PKTMMAPIF_TX_BLOCKS
+#define PKTMMAPIF_TX_BLOCKS 8
+#endif
+
+#ifndef PKTMMAPIF_TX_FRAME_SIZE
+#define PKTMMAPIF_TX_FRAME_SIZE 2048
+#endif
+
+/* max. number of RX frames passed to the stack together */
+#ifndef PKTMMAPIF_RX_BURST
+#define PKTMMAPIF_RX_BURST 64
+#endif
+
+/* PKTMMAPIF_ZEROCOPY==1: RX frames reference the ring (needs custom pbufs).
+   Note that segmentation offloaded frames (e.g. from a veth peer) then
+   arrive as one pbuf larger than the MTU. */
+#ifndef PKTMMAPIF_ZEROCOPY
+#define PKTMMAPIF_ZEROCOPY LWIP_SUPPORT_CUSTOM_PBUF
+#endif
+
+/* number of RX pbufs that may reference the ring at the same time */
+#ifndef PKTMMAPIF_NUM_RX_PBUFS
+#define PKTMMAPIF_NUM_RX_PBUFS 256
+#endif
+
+#define PKTMMAPIF_TX_FRAMES  (PKTMMAPIF_TX_BLOCKS * (PKTMMAPIF_BLOCK_SIZE / PKTMMAPIF_TX_FRAME_SIZE))
+/* frame data in a TX slot follows the header (without sockaddr_ll) */
+#define PKTMMAPIF_TX_DATA_OFFSET  (TPACKET3_HDRLEN - sizeof(struct sockaddr_ll))
+
+struct pktmmapif {
+  int fd;
+  u8_t *ring;
+  size_t ring_len;
+  u8_t *rx_ring;
+  u8_t *tx_ring;
+  /* next RX block / TX slot to look at */
+  u32_t rx_block;
+  u32_t tx_frame;
+  /* references to each RX block: 1 while it is walked plus 1 per pbuf */
+  u32_t rx_refs[PKTMMAPIF_RX_BLOCKS];
+  /* blocks kept from the kernel by pbufs the stack still holds */
+  u32_t rx_held;
+};
+
+#if PKTMMAPIF_ZEROCOPY
+struct pktmmapif_pbuf {
+  struct pbuf_custom pc;
+  struct pktmmapif *state;
+  u32_t block;
+};
+
+LWIP_MEMPOOL_DECLARE(PKTMMAPIF_RX_PBUF, PKTMMAPIF_NUM_RX_PBUFS, sizeof(struct pktmmapif_pbuf), "pktmmapif RX pbufs")
+static u8_t pktmmapif_pool_initialized;
+#endif /* PKTMMAPIF_ZEROCOPY */
+
+#if !NO_SYS
+static void pktmmapif_thread(void *arg);
+#endif /* !NO_SYS */
+
+/*-----------------------------------------------------------------------------------*/
+static struct tpacket_block_desc *
+pktmmapif_rx_block_desc(struct pktmmapif *state, u32_t block)
+{
+  return (struct tpacket_block_desc *)(state->rx_ring + (size_t)block * PKTMMAPIF_BLOCK_SIZE);
+}
+
+/* Drop one reference to an RX block; the last one hands it back to the kernel */
+static void
+pktmmapif_rx_block_unref(struct pktmmapif *state, u32_t block, u8_t walked)
+{
+  u8_t release;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  LWIP_ASSERT("block not referenced", state->rx_refs[block] > 0);
+  state->rx_refs[block]--;
+  release = (u8_t)(state->rx_refs[block] == 0);
+  if (walked) {
+    if (!release) {
+      /* pbufs keep the block */
+      state->rx_held++;
+    }
+  } else if (release) {
+    state->rx_held--;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (release) {
+    /* make sure all reads from the block are done before the kernel reuses it */
+    __sync_synchronize();
+    pktmmapif_rx_block_desc(state, block)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+  }
+}
+
+#if PKTMMAPIF_ZEROCOPY
+static void
+pktmmapif_pbuf_free(struct pbuf *p)
+{
+  struct pktmmapif_pbuf *pp = (struct pktmmapif_pbuf *)p;
+  struct pktmmapif *state = pp->state;
+  u32_t block = pp->block;
+
+  LWIP_MEMPOOL_FREE(PKTMMAPIF_RX_PBUF, pp);
+  pktmmapif_rx_block_unref(state, block, 0);
+}
+#endif /* PKTMMAPIF_ZEROCOPY */
+
+/*-----------------------------------------------------------------------------------*/
+static void
+low_level_init(struct netif *netif, const char *ifname)
+{
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+  struct tpacket_req3 req;
+  struct sockaddr_ll sll;
+  struct packet_mreq mreq;
+  int ver = TPACKET_V3;
+  int ifindex;
+  size_t rx_len, tx_len;
+  u8_t tx_ring = 1;
+
+  /* (We just fake an address...) */
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 0x12;
+  netif->hwaddr[2] = 0x34;
+  netif->hwaddr[3] = 0x56;
+  netif->hwaddr[4] = 0x78;
+  netif->hwaddr[5] = 0xac;
+  netif->hwaddr_len = 6;
+
+  /* device capabilities */
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6;
+
+  ifindex = (int)if_nametoindex(ifname);
+  if (ifindex == 0) {
+    perror("pktmmapif_init: unknown interface");
+    exit(1);
+  }
+
+  state->fd = socket(AF_PACKET, SOCK_RAW, lwip_htons(ETH_P_ALL));
+  if (state->fd < 0) {
+    perror("pktmmapif_init: socket(AF_PACKET) (needs CAP_NET_RAW)");
+    exit(1);
+  }
+  if (setsockopt(state->fd, SOL_PACKET, PACKET_VERSION, &ver, sizeof(ver)) < 0) {
+    perror("pktmmapif_init: TPACKET_V3 not supported");
+    exit(1);
+  }
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = PKTMMAPIF_BLOCK_SIZE;
+  req.tp_block_nr = PKTMMAPIF_RX_BLOCKS;
+  req.tp_frame_size = PKTMMAPIF_TX_FRAME_SIZE;
+  req.tp_frame_nr = (PKTMMAPIF_BLOCK_SIZE / PKTMMAPIF_TX_FRAME_SIZE) * PKTMMAPIF_RX_BLOCKS;
+  req.tp_retire_blk_tov = PKTMMAPIF_RX_BLOCK_TIMEOUT;
+  if (setsockopt(state->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    perror("pktmmapif_init: PACKET_RX_RING");
+    exit(1);
+  }
+  rx_len = (size_t)PKTMMAPIF_BLOCK_SIZE * PKTMMAPIF_RX_BLOCKS;
+
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = PKTMMAPIF_BLOCK_SIZE;
+  req.tp_block_nr = PKTMMAPIF_TX_BLOCKS;
+  req.tp_frame_size = PKTMMAPIF_TX_FRAME_SIZE;
+  req.tp_frame_nr = PKTMMAPIF_TX_FRAMES;
+  if (setsockopt(state->fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof(req)) < 0) {
+    LWIP_DEBUGF(PKTMMAPIF_DEBUG, ("pktmmapif_init: no TPACKET_V3 TX ring, using sendmsg()\n"));
+    tx_ring = 0;
+  }
+  tx_len = tx_ring ? (size_t)PKTMMAPIF_BLOCK_SIZE * PKTMMAPIF_TX_BLOCKS : 0;
+
+  /* RX and TX ring are mapped together, RX first */
+  state->ring_len = rx_len + tx_len;
+  state->ring = (u8_t *)mmap(NULL, state->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, state->fd, 0);
+  if (state->ring == MAP_FAILED) {
+    /* retry without locking (RLIMIT_MEMLOCK) */
+    state->ring = (u8_t *)mmap(NULL, state->ring_len, PROT_READ | PROT_WRITE, MAP_SHARED, state->fd, 0);
+  }
+  if (state->ring == MAP_FAILED) {
+    perror("pktmmapif_init: mmap");
+    exit(1);
+  }
+  state->rx_ring = state->ring;
+  state->tx_ring = tx_ring ? state->ring + rx_len : NULL;
+
+  memset(&sll, 0, sizeof(sll));
+  sll.sll_family = AF_PACKET;
+  sll.sll_protocol = lwip_htons(ETH_P_ALL);
+  sll.sll_ifindex = ifindex;
+  if (bind(state->fd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+    perror("pktmmapif_init: bind");
+    exit(1);
+  }
+
+  memset(&mreq, 0, sizeof(mreq));
+  mreq.mr_ifindex = ifindex;
+  mreq.mr_type = PACKET_MR_PROMISC;
+  if (setsockopt(state->fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    perror("pktmmapif_init: PACKET_MR_PROMISC");
+    exit(1);
+  }
+
+  netif_set_link_up(netif);
+
+#if !NO_SYS
+  sys_thread_new("pktmmapif_thread", pktmmapif_thread, netif, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+#endif /* !NO_SYS */
+}
+
+/*-----------------------------------------------------------------------------------*/
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+  struct tpacket3_hdr *hdr;
+
+  if (state->tx_ring == NULL) {
+    /* no TX ring: pass the chain to the kernel as it is */
+    struct iovec iov[16];
+    struct msghdr msg;
+    struct pbuf *q;
+    struct pbuf *flat = NULL;
+    ssize_t written;
+    int cnt = 0;
+
+    for (q = p; (q != NULL) && (cnt < (int)LWIP_ARRAYSIZE(iov)); q = q->next) {
+      iov[cnt].iov_base = q->payload;
+      iov[cnt].iov_len = q->len;
+      cnt++;
+    }
+    if (q != NULL) {
+      flat = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+      if (flat == NULL) {
+        MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+        return ERR_MEM;
+      }
+      iov[0].iov_base = flat->payload;
+      iov[0].iov_len = flat->len;
+      cnt = 1;
+    }
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = (size_t)cnt;
+    written = sendmsg(state->fd, &msg, 0);
+    if (flat != NULL) {
+      pbuf_free(flat);
+    }
+    if (written < p->tot_len) {
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      return ERR_IF;
+    }
+    MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+    LINK_STATS_INC(link.xmit);
+    return ERR_OK;
+  }
+
+  if (p->tot_len > PKTMMAPIF_TX_FRAME_SIZE - PKTMMAPIF_TX_DATA_OFFSET) {
+    MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+    LWIP_DEBUGF(PKTMMAPIF_DEBUG, ("pktmmapif: packet too large\n"));
+    return ERR_IF;
+  }
+
+  hdr = (struct tpacket3_hdr *)(state->tx_ring + (size_t)state->tx_frame * PKTMMAPIF_TX_FRAME_SIZE);
+  if (hdr->tp_status != TP_STATUS_AVAILABLE) {
+    /* ring full: the kernel is behind, kick it and drop this one */
+    send(state->fd, NULL, 0, MSG_DONTWAIT);
+    MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+    LINK_STATS_INC(link.drop);
+    return ERR_MEM;
+  }
+  pbuf_copy_partial(p, (u8_t *)hdr + PKTMMAPIF_TX_DATA_OFFSET, p->tot_len, 0);
+  hdr->tp_len = p->tot_len;
+  hdr->tp_snaplen = p->tot_len;
+  /* frame contents must be visible before the kernel sees the status */
+  __sync_synchronize();
+  hdr->tp_status = TP_STATUS_SEND_REQUEST;
+  state->tx_frame = (state->tx_frame + 1) % PKTMMAPIF_TX_FRAMES;
+
+  if ((send(state->fd, NULL, 0, MSG_DONTWAIT) < 0) && (errno != EAGAIN) && (errno != ENOBUFS)) {
+    perror("pktmmapif: send");
+    return ERR_IF;
+  }
+  MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+  LINK_STATS_INC(link.xmit);
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Pass a burst of received frames to the stack */
+static void
+pktmmapif_input_burst(struct netif *netif, struct pbuf **burst, int n)
+{
+  int i;
+
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  if (netif->input == tcpip_input) {
+    /* take the core lock once for the whole burst */
+    LOCK_TCPIP_CORE();
+    for (i = 0; i < n; i++) {
+      if (ethernet_input(burst[i], netif) != ERR_OK) {
+        pbuf_free(burst[i]);
+      }
+    }
+    UNLOCK_TCPIP_CORE();
+    return;
+  }
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
+  for (i = 0; i < n; i++) {
+    if (netif->input(burst[i], netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("pktmmapif_input: netif input error\n"));
+      pbuf_free(burst[i]);
+    }
+  }
+}
+
+/* Turn one received frame into a pbuf (referencing the ring if possible) */
+static struct pbuf *
+low_level_input(struct netif *netif, u32_t block, u8_t *data, u16_t len, u8_t copy)
+{
+  struct pbuf *p;
+#if PKTMMAPIF_ZEROCOPY
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+
+  if (!copy) {
+    struct pktmmapif_pbuf *pp = (struct pktmmapif_pbuf *)LWIP_MEMPOOL_ALLOC(PKTMMAPIF_RX_PBUF);
+    if (pp != NULL) {
+      SYS_ARCH_DECL_PROTECT(lev);
+      pp->pc.custom_free_function = pktmmapif_pbuf_free;
+      pp->state = state;
+      pp->block = block;
+      SYS_ARCH_PROTECT(lev);
+      state->rx_refs[block]++;
+      SYS_ARCH_UNPROTECT(lev);
+      p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &pp->pc, data, len);
+      MIB2_STATS_NETIF_ADD(netif, ifinoctets, len);
+      return p;
+    }
+  }
+#else /* PKTMMAPIF_ZEROCOPY */
+  LWIP_UNUSED_ARG(copy);
+#endif /* PKTMMAPIF_ZEROCOPY */
+  LWIP_UNUSED_ARG(block);
+
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  if (p == NULL) {
+    MIB2_STATS_NETIF_INC(netif, ifindiscards);
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    return NULL;
+  }
+  pbuf_take(p, data, len);
+  MIB2_STATS_NETIF_ADD(netif, ifinoctets, len);
+  return p;
+}
+
+/* Walk all RX blocks the kernel has handed over; returns the number of frames */
+static int
+pktmmapif_input(struct netif *netif)
+{
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+  struct pbuf *burst[PKTMMAPIF_RX_BURST];
+  int n = 0;
+  int total = 0;
+
+  for (;;) {
+    u32_t block = state->rx_block;
+    struct tpacket_block_desc *bd = pktmmapif_rx_block_desc(state, block);
+    struct tpacket3_hdr *hdr;
+    u32_t i, num;
+    u8_t copy;
+    SYS_ARCH_DECL_PROTECT(lev);
+
+    if ((bd->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+      break;
+    }
+    /* read the block only after seeing its status */
+    __sync_synchronize();
+
+    SYS_ARCH_PROTECT(lev);
+    state->rx_refs[block] = 1;
+    /* copy if the stack already keeps half of the ring from the kernel */
+    copy = (u8_t)(state->rx_held >= PKTMMAPIF_RX_BLOCKS / 2);
+    SYS_ARCH_UNPROTECT(lev);
+
+    num = bd->hdr.bh1.num_pkts;
+    hdr = (struct tpacket3_hdr *)((u8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+    for (i = 0; i < num; i++) {
+      const struct sockaddr_ll *sll = (const struct sockaddr_ll *)((u8_t *)hdr + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+      /* skip our own frames and frames truncated to the ring's frame size */
+      if ((sll->sll_pkttype != PACKET_OUTGOING) && (hdr->tp_snaplen == hdr->tp_len) &&
+          (hdr->tp_snaplen <= 0xFFFF)) {
+        struct pbuf *p = low_level_input(netif, block, (u8_t *)hdr + hdr->tp_mac, (u16_t)hdr->tp_snaplen, copy);
+        if (p != NULL) {
+          if (hdr->tp_status & (TP_STATUS_CSUMNOTREADY | TP_STATUS_CSUM_VALID)) {
+            /* locally generated (checksum left to offload) or already verified */
+            p->flags |= PBUF_FLAG_CSUM_VALID;
+          }
+          LINK_STATS_INC(link.recv);
+          burst[n++] = p;
+          if (n == PKTMMAPIF_RX_BURST) {
+            pktmmapif_input_burst(netif, burst, n);
+            total += n;
+            n = 0;
+          }
+        }
+      }
+      hdr = (struct tpacket3_hdr *)((u8_t *)hdr + hdr->tp_next_offset);
+    }
+    state->rx_block = (block + 1) % PKTMMAPIF_RX_BLOCKS;
+    if (n > 0) {
+      pktmmapif_input_burst(netif, burst, n);
+      total += n;
+      n = 0;
+    }
+    pktmmapif_rx_block_unref(state, block, 1);
+  }
+  return total;
+}
+
+/*-----------------------------------------------------------------------------------*/
+err_t
+pktmmapif_init(struct netif *netif)
+{
+  const char *ifname = (const char *)netif->state;
+  struct pktmmapif *state;
+
+  if (ifname == NULL) {
+    ifname = getenv("PKTMMAPIF_IF");
+    if (ifname == NULL) {
+      ifname = PKTMMAPIF_DEFAULT_IF;
+    }
+  }
+
+  state = (struct pktmmapif *)mem_malloc(sizeof(struct pktmmapif));
+  if (state == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("pktmmapif_init: out of memory for pktmmapif\n"));
+    return ERR_MEM;
+  }
+  memset(state, 0, sizeof(struct pktmmapif));
+  netif->state = state;
+
+#if PKTMMAPIF_ZEROCOPY
+  if (!pktmmapif_pool_initialized) {
+    LWIP_MEMPOOL_INIT(PKTMMAPIF_RX_PBUF);
+    pktmmapif_pool_initialized = 1;
+  }
+#endif /* PKTMMAPIF_ZEROCOPY */
+
+  MIB2_INIT_NETIF(netif, snmp_ifType_ethernet_csmacd, 1000000000);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = low_level_output;
+  netif->mtu = 1500;
+
+  low_level_init(netif, ifname);
+
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+#if NO_SYS
+
+void
+pktmmapif_poll(struct netif *netif)
+{
+  pktmmapif_input(netif);
+}
+
+int
+pktmmapif_select(struct netif *netif)
+{
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+  struct pollfd pfd;
+  int ret;
+
+  pfd.fd = state->fd;
+  pfd.events = POLLIN | POLLERR;
+  pfd.revents = 0;
+
+  ret = poll(&pfd, 1, (int)sys_timeouts_sleeptime());
+  if (ret > 0) {
+    pktmmapif_input(netif);
+  }
+  return ret;
+}
+
+#else /* NO_SYS */
+
+static void
+pktmmapif_thread(void *arg)
+{
+  struct netif *netif = (struct netif *)arg;
+  struct pktmmapif *state = (struct pktmmapif *)netif->state;
+  struct pollfd pfd;
+
+  while (1) {
+    /* blocks may be ready without a wakeup (e.g. after a burst filled the ring) */
+    if (pktmmapif_input(netif) > 0) {
+      continue;
+    }
+    pfd.fd = state->fd;
+    pfd.events = POLLIN | POLLERR;
+    pfd.revents = 0;
+    if ((poll(&pfd, 1, -1) < 0) && (errno != EINTR)) {
+      perror("pktmmapif_thread: poll");
+    }
+  }
+}
+
+/* The RX ring is walked by pktmmapif_thread() only: polling (as done by
+   main loops written for NO_SYS) just yields instead of spinning. */
+void
+pktmmapif_poll(struct netif *netif)
+{
+  LWIP_UNUSED_ARG(netif);
+  sys_msleep(10);
+}
+
+#endif /* NO_SYS */
+
+#endif /* LWIP_UNIX_LINUX */
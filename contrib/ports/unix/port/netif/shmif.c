@@ -0,0 +1,530 @@
+/**
+ * @file
+ * Shared-memory netif pair
+ *
+ * Two netifs connected back to back through a pair of lock-free
+ * single-producer/single-consumer rings, meant for measuring the stack
+ * without a kernel network path in between:
+ * - Both ends may live in one process (two netifs on one stack) or in two
+ *   processes (the region is a memfd that can be inherited or passed on).
+ * - Each slot holds a copy of the frame. If both ends are in the same
+ *   process, the pbuf itself is queued instead; the receiving end passes it
+ *   on unchanged if it is the only one left referencing it (otherwise, e.g.
+ *   for TCP segments still on the unacked queue, it is copied there).
+ * - A full ring makes linkoutput return ERR_MEM (no silent drops).
+ * - With NO_SYS==0, every end gets an RX thread sleeping on a futex in the
+ *   shared region while its ring is empty; with NO_SYS==1, call
+ *   shmif_poll() from the main loop (busy polling).
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if defined(LWIP_UNIX_LINUX)
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "lwip/debug.h"
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/snmp.h"
+#include "lwip/sys.h"
+#include "lwip/tcpip.h"
+#include "netif/etharp.h"
+#include "lwip/ethip6.h"
+
+#include "netif/shmif.h"
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 's'
+#define IFNAME1 'h'
+
+#ifndef SHMIF_DEBUG
+#define SHMIF_DEBUG LWIP_DBG_OFF
+#endif
+
+/* MTU of the link (both ends must use the same value) */
+#ifndef SHMIF_MTU
+#define SHMIF_MTU 1500
+#endif
+
+/* number of frames per direction, must be a power of 2 */
+#ifndef SHMIF_RING_SLOTS
+#define SHMIF_RING_SLOTS 256
+#endif
+
+/* max. number of RX frames passed to the stack together */
+#ifndef SHMIF_RX_BURST
+#define SHMIF_RX_BURST 32
+#endif
+
+/* SHMIF_ZEROCOPY==1: queue pbufs instead of copies if both ends are in the same process */
+#ifndef SHMIF_ZEROCOPY
+#define SHMIF_ZEROCOPY 1
+#endif
+
+/* SHMIF_TRUST_CSUM==1: memory does not corrupt frames, skip checksum verification on RX */
+#ifndef SHMIF_TRUST_CSUM
+#define SHMIF_TRUST_CSUM 1
+#endif
+
+#if (SHMIF_RING_SLOTS & (SHMIF_RING_SLOTS - 1)) != 0
+#error "SHMIF_RING_SLOTS must be a power of 2"
+#endif
+
+#define SHMIF_MAGIC       0x73686d31UL
+#define SHMIF_CACHE_LINE  64
+#define SHMIF_SLOT_DATA   (((SHMIF_MTU + SIZEOF_ETH_HDR) + SHMIF_CACHE_LINE - 1) & ~(SHMIF_CACHE_LINE - 1))
+
+struct shmif_slot {
+  u32_t len;
+  u32_t reserved;
+  /* if not NULL, the frame is this pbuf (same process only), not 'data' */
+  struct pbuf *p;
+  u8_t data[SHMIF_SLOT_DATA];
+};
+
+struct shmif_ring {
+  /* written by the producer */
+  u32_t head;
+  u8_t pad0[SHMIF_CACHE_LINE - sizeof(u32_t)];
+  /* written by the consumer ('waiting' is cleared by the producer) */
+  u32_t tail;
+  u32_t waiting;
+  u8_t pad1[SHMIF_CACHE_LINE - 2 * sizeof(u32_t)];
+  struct shmif_slot slot[SHMIF_RING_SLOTS];
+};
+
+struct shmif_region {
+  u32_t magic;
+  u32_t size;
+  /* process driving each end (0: not attached) */
+  s32_t pid[2];
+  u8_t pad[SHMIF_CACHE_LINE - 4 * sizeof(u32_t)];
+  /* ring[n] carries the frames sent by end n */
+  struct shmif_ring ring[2];
+};
+
+struct shmif {
+  struct shmif_region *region;
+  struct shmif_ring *tx;
+  struct shmif_ring *rx;
+  u8_t side;
+  /* own index and last seen index of the other end, per direction */
+  u32_t tx_head;
+  u32_t tx_tail;
+  u32_t rx_tail;
+  u32_t rx_head;
+};
+
+#define SHMIF_LOAD(x)       __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define SHMIF_STORE(x, v)   __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+/* sequentially consistent, for the sleep/wakeup handshake */
+#define SHMIF_LOAD_SC(x)    __atomic_load_n(&(x), __ATOMIC_SEQ_CST)
+#define SHMIF_STORE_SC(x, v) __atomic_store_n(&(x), (v), __ATOMIC_SEQ_CST)
+
+#if !NO_SYS
+static void shmif_thread(void *arg);
+#endif /* !NO_SYS */
+
+/*-----------------------------------------------------------------------------------*/
+static struct shmif_region *
+shmif_region_map(int fd, u8_t init)
+{
+  struct shmif_region *region;
+
+  region = (struct shmif_region *)mmap(NULL, sizeof(struct shmif_region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (region == MAP_FAILED) {
+    perror("shmif: mmap");
+    return NULL;
+  }
+  if (init) {
+    /* a new memfd is zero-filled: rings are empty, no end attached */
+    region->size = sizeof(struct shmif_region);
+    SHMIF_STORE(region->magic, SHMIF_MAGIC);
+  } else if ((SHMIF_LOAD(region->magic) != SHMIF_MAGIC) || (region->size != sizeof(struct shmif_region))) {
+    fprintf(stderr, "shmif: region was created with different settings\n");
+    munmap(region, sizeof(struct shmif_region));
+    return NULL;
+  }
+  return region;
+}
+
+struct shmif_region *
+shmif_region_create(int *fd)
+{
+  struct shmif_region *region;
+  int memfd = (int)syscall(SYS_memfd_create, "lwip-shmif", 0);
+
+  if (memfd < 0) {
+    perror("shmif: memfd_create");
+    return NULL;
+  }
+  if (ftruncate(memfd, (off_t)sizeof(struct shmif_region)) < 0) {
+    perror("shmif: ftruncate");
+    close(memfd);
+    return NULL;
+  }
+  region = shmif_region_map(memfd, 1);
+  if ((fd != NULL) && (region != NULL)) {
+    *fd = memfd;
+  } else {
+    close(memfd);
+  }
+  return region;
+}
+
+struct shmif_region *
+shmif_region_attach(int fd)
+{
+  return shmif_region_map(fd, 0);
+}
+
+void
+shmif_region_release(struct shmif_region *region)
+{
+  munmap(region, sizeof(struct shmif_region));
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Wake up the consumer of 'ring' if it went to sleep */
+static void
+shmif_wakeup(struct shmif_ring *ring)
+{
+  if (SHMIF_LOAD_SC(ring->waiting)) {
+    SHMIF_STORE_SC(ring->waiting, 0);
+    syscall(SYS_futex, &ring->waiting, FUTEX_WAKE, 1, NULL, NULL, 0);
+  }
+}
+
+#if SHMIF_ZEROCOPY
+/* Can the pbuf (chain) be queued instead of a copy? The data must be owned
+   by the pbufs (no PBUF_ROM/PBUF_REF) and the peer must be in this process. */
+static int
+shmif_can_queue_pbuf(struct shmif *state, struct pbuf *p)
+{
+  struct pbuf *q;
+
+  if (SHMIF_LOAD(state->region->pid[state->side ^ 1]) != state->region->pid[state->side]) {
+    return 0;
+  }
+  for (q = p; q != NULL; q = q->next) {
+    if ((q->type_internal & PBUF_TYPE_FLAG_STRUCT_DATA_CONTIGUOUS) == 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/* Is the received pbuf chain referenced by nobody but the ring? */
+static int
+shmif_pbuf_exclusive(struct pbuf *p)
+{
+  struct pbuf *q;
+  int exclusive = 1;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  for (q = p; q != NULL; q = q->next) {
+    if (q->ref != 1) {
+      exclusive = 0;
+      break;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return exclusive;
+}
+#endif /* SHMIF_ZEROCOPY */
+
+/*-----------------------------------------------------------------------------------*/
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+  struct shmif *state = (struct shmif *)netif->state;
+  struct shmif_ring *ring = state->tx;
+  struct shmif_slot *slot;
+  u32_t head = state->tx_head;
+
+  if (head - state->tx_tail == SHMIF_RING_SLOTS) {
+    state->tx_tail = SHMIF_LOAD(ring->tail);
+    if (head - state->tx_tail == SHMIF_RING_SLOTS) {
+      /* ring full: let the caller retry instead of dropping */
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      LINK_STATS_INC(link.memerr);
+      return ERR_MEM;
+    }
+  }
+
+  slot = &ring->slot[head & (SHMIF_RING_SLOTS - 1)];
+#if SHMIF_ZEROCOPY
+  if (shmif_can_queue_pbuf(state, p)) {
+    pbuf_ref(p);
+    slot->p = p;
+    slot->len = p->tot_len;
+  } else
+#endif /* SHMIF_ZEROCOPY */
+  {
+    if (p->tot_len > SHMIF_SLOT_DATA) {
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      LWIP_DEBUGF(SHMIF_DEBUG, ("shmif: packet too large\n"));
+      return ERR_IF;
+    }
+    slot->p = NULL;
+    slot->len = pbuf_copy_partial(p, slot->data, p->tot_len, 0);
+  }
+
+  state->tx_head = head + 1;
+  SHMIF_STORE_SC(ring->head, head + 1);
+  shmif_wakeup(ring);
+
+  MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
+  LINK_STATS_INC(link.xmit);
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Turn the frame in 'slot' into a pbuf owned by the receiving end */
+static struct pbuf *
+low_level_input(struct netif *netif, struct shmif_slot *slot)
+{
+  struct pbuf *p;
+
+  LWIP_UNUSED_ARG(netif); /* without stats */
+#if SHMIF_ZEROCOPY
+  if (slot->p != NULL) {
+    p = slot->p;
+    slot->p = NULL;
+    if (!shmif_pbuf_exclusive(p)) {
+      /* the sender still holds it (e.g. TCP unacked queue): copy */
+      struct pbuf *q = pbuf_clone(PBUF_RAW, PBUF_POOL, p);
+      pbuf_free(p);
+      p = q;
+    } else {
+      p->if_idx = NETIF_NO_INDEX;
+    }
+  } else
+#endif /* SHMIF_ZEROCOPY */
+  {
+    p = pbuf_alloc(PBUF_RAW, (u16_t)slot->len, PBUF_POOL);
+    if (p != NULL) {
+      pbuf_take(p, slot->data, (u16_t)slot->len);
+    }
+  }
+
+  if (p == NULL) {
+    MIB2_STATS_NETIF_INC(netif, ifindiscards);
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    return NULL;
+  }
+#if SHMIF_TRUST_CSUM
+  p->flags |= PBUF_FLAG_CSUM_VALID;
+#endif /* SHMIF_TRUST_CSUM */
+  MIB2_STATS_NETIF_ADD(netif, ifinoctets, p->tot_len);
+  LINK_STATS_INC(link.recv);
+  return p;
+}
+
+/* Pass a burst of received frames to the stack */
+static void
+shmif_input_burst(struct netif *netif, struct pbuf **burst, int n)
+{
+  int i;
+
+#if !NO_SYS && LWIP_TCPIP_CORE_LOCKING
+  if (netif->input == tcpip_input) {
+    /* take the core lock once for the whole burst */
+    LOCK_TCPIP_CORE();
+    for (i = 0; i < n; i++) {
+      if (ethernet_input(burst[i], netif) != ERR_OK) {
+        pbuf_free(burst[i]);
+      }
+    }
+    UNLOCK_TCPIP_CORE();
+    return;
+  }
+#endif /* !NO_SYS && LWIP_TCPIP_CORE_LOCKING */
+
+  for (i = 0; i < n; i++) {
+    if (netif->input(burst[i], netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("shmif_input: netif input error\n"));
+      pbuf_free(burst[i]);
+    }
+  }
+}
+
+/* Receive up to one burst of frames; returns the number of slots consumed */
+static int
+shmif_input(struct netif *netif)
+{
+  struct shmif *state = (struct shmif *)netif->state;
+  struct shmif_ring *ring = state->rx;
+  struct pbuf *burst[SHMIF_RX_BURST];
+  u32_t tail = state->rx_tail;
+  int consumed = 0;
+  int n = 0;
+
+  if (tail == state->rx_head) {
+    state->rx_head = SHMIF_LOAD(ring->head);
+  }
+  while ((tail != state->rx_head) && (consumed < SHMIF_RX_BURST)) {
+    struct pbuf *p = low_level_input(netif, &ring->slot[tail & (SHMIF_RING_SLOTS - 1)]);
+    if (p != NULL) {
+      burst[n++] = p;
+    }
+    tail++;
+    consumed++;
+  }
+  if (consumed > 0) {
+    /* hand the slots back before processing, the stack may reply right away */
+    state->rx_tail = tail;
+    SHMIF_STORE(ring->tail, tail);
+  }
+  if (n > 0) {
+    shmif_input_burst(netif, burst, n);
+  }
+  return consumed;
+}
+
+/*-----------------------------------------------------------------------------------*/
+err_t
+shmif_init(struct netif *netif)
+{
+  const struct shmif_config *cfg = (const struct shmif_config *)netif->state;
+  struct shmif *state;
+
+  LWIP_ERROR("shmif_init: invalid config", (cfg != NULL) && (cfg->region != NULL) && (cfg->side < 2),
+             return ERR_ARG;);
+
+  state = (struct shmif *)mem_malloc(sizeof(struct shmif));
+  if (state == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("shmif_init: out of memory for shmif\n"));
+    return ERR_MEM;
+  }
+  memset(state, 0, sizeof(struct shmif));
+  state->region = cfg->region;
+  state->side = cfg->side;
+  state->tx = &state->region->ring[state->side];
+  state->rx = &state->region->ring[state->side ^ 1];
+  /* continue where a previous user of this end stopped */
+  state->tx_head = SHMIF_LOAD(state->tx->head);
+  state->tx_tail = SHMIF_LOAD(state->tx->tail);
+  state->rx_tail = SHMIF_LOAD(state->rx->tail);
+  state->rx_head = state->rx_tail;
+  SHMIF_STORE(state->region->pid[state->side], (s32_t)getpid());
+  netif->state = state;
+
+  MIB2_INIT_NETIF(netif, snmp_ifType_other, 1000000000);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = low_level_output;
+  netif->mtu = SHMIF_MTU;
+
+  /* locally administered, one address per end */
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[1] = 's';
+  netif->hwaddr[2] = 'h';
+  netif->hwaddr[3] = 'm';
+  netif->hwaddr[4] = 0x00;
+  netif->hwaddr[5] = (u8_t)(state->side + 1);
+  netif->hwaddr_len = 6;
+
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP | NETIF_FLAG_MLD6;
+
+  netif_set_link_up(netif);
+
+#if !NO_SYS
+  sys_thread_new("shmif_thread", shmif_thread, netif, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+#endif /* !NO_SYS */
+
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+#if NO_SYS
+
+void
+shmif_poll(struct netif *netif)
+{
+  shmif_input(netif);
+}
+
+#else /* NO_SYS */
+
+static void
+shmif_thread(void *arg)
+{
+  struct netif *netif = (struct netif *)arg;
+  struct shmif *state = (struct shmif *)netif->state;
+  struct shmif_ring *ring = state->rx;
+
+  while (1) {
+    if (shmif_input(netif) > 0) {
+      continue;
+    }
+    /* announce that we sleep, then check again before doing so */
+    SHMIF_STORE_SC(ring->waiting, 1);
+    if (SHMIF_LOAD_SC(ring->head) != state->rx_tail) {
+      SHMIF_STORE_SC(ring->waiting, 0);
+      continue;
+    }
+    if ((syscall(SYS_futex, &ring->waiting, FUTEX_WAIT, 1, NULL, NULL, 0) < 0) &&
+        (errno != EAGAIN) && (errno != EINTR)) {
+      perror("shmif_thread: futex");
+    }
+  }
+}
+
+/* Frames are received by shmif_thread(); this only keeps main loops that
+   poll every netif from busy waiting. */
+void
+shmif_poll(struct netif *netif)
+{
+  LWIP_UNUSED_ARG(netif);
+  sys_msleep(10);
+}
+
+#endif /* NO_SYS */
+
+#endif /* LWIP_UNIX_LINUX */
@@ -41,6 +41,7 @@
 #include <sys/time.h>
 #include <sys/uio.h>
 #include <sys/socket.h>
+#include <errno.h>
 
 #include "lwip/opt.h"
 
@@ -53,6 +54,9 @@
 #include "lwip/pbuf.h"
 #include "lwip/sys.h"
 #include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ethernet.h"
 #include "netif/etharp.h"
 #include "lwip/ethip6.h"
 
@@ -64,6 +68,8 @@
 #include <sys/ioctl.h>
 #include <linux/if.h>
 #include <linux/if_tun.h>
+#include <linux/virtio_net.h>
+#include <sys/epoll.h>
 /*
  * Creating a tap interface requires special privileges. If the interfaces
  * is created in advance with `tunctl -u <user>` it can be opened as a regular
@@ -98,22 +104,137 @@
 #define TAPIF_DEBUG LWIP_DBG_OFF
 #endif
 
+/* MTU of the interface; frames are read into pbuf chains, so jumbo frames
+   only need a bigger value here (and on the host side of the tap) */
+#ifndef TAPIF_MTU
+#define TAPIF_MTU 1500
+#endif
+
+/* max. number of iovecs per readv()/writev(); longer TX chains are flattened */
+#ifndef TAPIF_MAX_IOV
+#define TAPIF_MAX_IOV 64
+#endif
+
+/* TAPIF_VNET_HDR==1: open the tap with IFF_VNET_HDR (Linux only). Every frame
+   is then prefixed by a struct virtio_net_hdr carrying checksum offload info:
+   frames the host kernel has already verified skip the lwIP checksum check
+   (PBUF_FLAG_CSUM_VALID), and host-generated frames are passed with partial
+   checksums (TUN_F_CSUM) instead of having the kernel complete them. */
+#ifndef TAPIF_VNET_HDR
+#define TAPIF_VNET_HDR 0
+#endif
+
+#if TAPIF_VNET_HDR && !defined(LWIP_UNIX_LINUX)
+#error "TAPIF_VNET_HDR needs a Linux tap device"
+#endif
+
+/* number of tap queues (IFF_MULTI_QUEUE, Linux only). Each queue has its own
+   fd and RX thread; frames are sent through queue 0. */
+#ifndef TAPIF_NUM_QUEUES
+#define TAPIF_NUM_QUEUES 1
+#endif
+
+/* max. number of frames an RX thread reads per wakeup before passing them
+   to the stack together */
+#ifndef TAPIF_RX_BURST
+#define TAPIF_RX_BURST 32
+#endif
+
+/* time tapif_poll() sleeps when RX threads receive the frames (NO_SYS==0) */
+#ifndef TAPIF_POLL_SLEEP_MS
+#define TAPIF_POLL_SLEEP_MS 10
+#endif
+
+#if TAPIF_NUM_QUEUES > 1 && (!defined(LWIP_UNIX_LINUX) || NO_SYS)
+#error "TAPIF_NUM_QUEUES > 1 needs a Linux tap device and NO_SYS==0"
+#endif
+
+/* largest frame on the wire: MTU plus ethernet and VLAN header (no CRC) */
+#define TAPIF_MAX_FRAME (TAPIF_MTU + SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR)
+
+struct tapif_queue {
+  struct netif *netif;
+  int fd;
+#if defined(LWIP_UNIX_LINUX) && !NO_SYS
+  int epfd;
+#endif /* LWIP_UNIX_LINUX && !NO_SYS */
+};
+
 struct tapif {
   /* Add whatever per-interface state that is needed here. */
-  int fd;
+  struct tapif_queue queue[TAPIF_NUM_QUEUES];
 };
 
 /* Forward declarations. */
+#if NO_SYS
 static void tapif_input(struct netif *netif);
-#if !NO_SYS
+#else /* NO_SYS */
 static void tapif_thread(void *arg);
-#endif /* !NO_SYS */
+#endif /* NO_SYS */
+
+/*-----------------------------------------------------------------------------------*/
+/* Open one queue of the tap device, exits on error */
+static int
+tapif_open(const char *ifname)
+{
+  int fd = open(DEVTAP, O_RDWR);
+  LWIP_DEBUGF(TAPIF_DEBUG, ("tapif_init: fd %d\n", fd));
+  if (fd == -1) {
+#ifdef LWIP_UNIX_LINUX
+    perror("tapif_init: try running \"modprobe tun\" or rebuilding your kernel with CONFIG_TUN; cannot open "DEVTAP);
+#else /* LWIP_UNIX_LINUX */
+    perror("tapif_init: cannot open "DEVTAP);
+#endif /* LWIP_UNIX_LINUX */
+    exit(1);
+  }
+
+#ifdef LWIP_UNIX_LINUX
+  {
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+
+    strncpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name));
+    ifr.ifr_name[sizeof(ifr.ifr_name)-1] = 0; /* ensure \0 termination */
+
+    ifr.ifr_flags = IFF_TAP|IFF_NO_PI;
+#if TAPIF_NUM_QUEUES > 1
+    ifr.ifr_flags |= IFF_MULTI_QUEUE;
+#endif /* TAPIF_NUM_QUEUES > 1 */
+#if TAPIF_VNET_HDR
+    ifr.ifr_flags |= IFF_VNET_HDR;
+#endif /* TAPIF_VNET_HDR */
+    if (ioctl(fd, TUNSETIFF, (void *) &ifr) < 0) {
+      perror("tapif_init: "DEVTAP" ioctl TUNSETIFF");
+      exit(1);
+    }
+  }
+#if TAPIF_VNET_HDR
+  {
+    int hdrsz = (int)sizeof(struct virtio_net_hdr);
+    if (ioctl(fd, TUNSETVNETHDRSZ, &hdrsz) < 0) {
+      perror("tapif_init: "DEVTAP" ioctl TUNSETVNETHDRSZ");
+      exit(1);
+    }
+    /* accept partial checksums, but no GSO: frames must fit TAPIF_MAX_FRAME */
+    if (ioctl(fd, TUNSETOFFLOAD, (unsigned long)TUN_F_CSUM) < 0) {
+      perror("tapif_init: "DEVTAP" ioctl TUNSETOFFLOAD");
+      exit(1);
+    }
+  }
+#endif /* TAPIF_VNET_HDR */
+#else /* LWIP_UNIX_LINUX */
+  LWIP_UNUSED_ARG(ifname);
+#endif /* LWIP_UNIX_LINUX */
+
+  return fd;
+}
 
 /*-----------------------------------------------------------------------------------*/
 static void
 low_level_init(struct netif *netif)
 {
   struct tapif *tapif;
+  int i;
 #if LWIP_IPV4
   int ret;
   char buf[1024];
@@ -136,36 +257,36 @@ low_level_init(struct netif *netif)
   /* device capabilities */
   netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_IGMP;
 
-  tapif->fd = open(DEVTAP, O_RDWR);
-  LWIP_DEBUGF(TAPIF_DEBUG, ("tapif_init: fd %d\n", tapif->fd));
-  if (tapif->fd == -1) {
-#ifdef LWIP_UNIX_LINUX
-    perror("tapif_init: try running \"modprobe tun\" or rebuilding your kernel with CONFIG_TUN; cannot open "DEVTAP);
-#else /* LWIP_UNIX_LINUX */
-    perror("tapif_init: cannot open "DEVTAP);
-#endif /* LWIP_UNIX_LINUX */
-    exit(1);
-  }
-
+  for (i = 0; i < TAPIF_NUM_QUEUES; i++) {
+    struct tapif_queue *q = &tapif->queue[i];
+    q->netif = netif;
 #ifdef LWIP_UNIX_LINUX
-  {
-    struct ifreq ifr;
-    memset(&ifr, 0, sizeof(ifr));
-
-    if (preconfigured_tapif) {
-      strncpy(ifr.ifr_name, preconfigured_tapif, sizeof(ifr.ifr_name));
-    } else {
-      strncpy(ifr.ifr_name, DEVTAP_DEFAULT_IF, sizeof(ifr.ifr_name));
+    q->fd = tapif_open(preconfigured_tapif ? preconfigured_tapif : DEVTAP_DEFAULT_IF);
+#if !NO_SYS
+    /* the RX threads drain their queue without blocking */
+    if (fcntl(q->fd, F_SETFL, fcntl(q->fd, F_GETFL) | O_NONBLOCK) < 0) {
+      perror("tapif_init: fcntl O_NONBLOCK");
+      exit(1);
     }
-    ifr.ifr_name[sizeof(ifr.ifr_name)-1] = 0; /* ensure \0 termination */
-
-    ifr.ifr_flags = IFF_TAP|IFF_NO_PI;
-    if (ioctl(tapif->fd, TUNSETIFF, (void *) &ifr) < 0) {
-      perror("tapif_init: "DEVTAP" ioctl TUNSETIFF");
+    q->epfd = epoll_create1(0);
+    if (q->epfd < 0) {
+      perror("tapif_init: epoll_create1");
       exit(1);
+    } else {
+      struct epoll_event ev;
+      memset(&ev, 0, sizeof(ev));
+      ev.events = EPOLLIN;
+      ev.data.ptr = q;
+      if (epoll_ctl(q->epfd, EPOLL_CTL_ADD, q->fd, &ev) < 0) {
+        perror("tapif_init: epoll_ctl");
+        exit(1);
+      }
     }
-  }
+#endif /* !NO_SYS */
+#else /* LWIP_UNIX_LINUX */
+    q->fd = tapif_open(NULL);
 #endif /* LWIP_UNIX_LINUX */
+  }
 
   netif_set_link_up(netif);
 
@@ -201,7 +322,9 @@ low_level_init(struct netif *netif)
   }
 
 #if !NO_SYS
-  sys_thread_new("tapif_thread", tapif_thread, netif, DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+  for (i = 0; i < TAPIF_NUM_QUEUES; i++) {
+    sys_thread_new("tapif_thread", tapif_thread, &tapif->queue[i], DEFAULT_THREAD_STACKSIZE, DEFAULT_THREAD_PRIO);
+  }
 #endif /* !NO_SYS */
 }
 /*-----------------------------------------------------------------------------------*/
@@ -219,8 +342,24 @@ static err_t
 low_level_output(struct netif *netif, struct pbuf *p)
 {
   struct tapif *tapif = (struct tapif *)netif->state;
-  char buf[1518]; /* max packet size including VLAN excluding CRC */
+  struct iovec iov[TAPIF_MAX_IOV];
+  struct pbuf *q;
+  struct pbuf *flat = NULL;
+  int first = 0;
+  int cnt;
+  ssize_t expected = p->tot_len;
   ssize_t written;
+#if TAPIF_VNET_HDR
+  struct virtio_net_hdr vnet_hdr;
+
+  /* lwIP computes its checksums itself and does not produce GSO frames */
+  memset(&vnet_hdr, 0, sizeof(vnet_hdr));
+  vnet_hdr.gso_type = VIRTIO_NET_HDR_GSO_NONE;
+  iov[0].iov_base = &vnet_hdr;
+  iov[0].iov_len = sizeof(vnet_hdr);
+  first = 1;
+  expected += (ssize_t)sizeof(vnet_hdr);
+#endif /* TAPIF_VNET_HDR */
 
 #if 0
   if (((double)rand()/(double)RAND_MAX) < 0.2) {
@@ -229,23 +368,44 @@ low_level_output(struct netif *netif, struct pbuf *p)
   }
 #endif
 
-  if (p->tot_len > sizeof(buf)) {
+  if (p->tot_len > TAPIF_MAX_FRAME) {
     MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
     perror("tapif: packet too large");
     return ERR_IF;
   }
 
-  /* initiate transfer(); */
-  pbuf_copy_partial(p, buf, p->tot_len, 0);
+  /* hand the pbuf chain to the kernel as it is (no copy) */
+  cnt = first;
+  for (q = p; (q != NULL) && (cnt < TAPIF_MAX_IOV); q = q->next) {
+    if (q->len > 0) {
+      iov[cnt].iov_base = q->payload;
+      iov[cnt].iov_len = q->len;
+      cnt++;
+    }
+  }
+  if (q != NULL) {
+    /* chain has more pbufs than we have iovecs: flatten it */
+    flat = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+    if (flat == NULL) {
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      return ERR_MEM;
+    }
+    iov[first].iov_base = flat->payload;
+    iov[first].iov_len = flat->len;
+    cnt = first + 1;
+  }
 
   /* signal that packet should be sent(); */
-  written = write(tapif->fd, buf, p->tot_len);
-  if (written < p->tot_len) {
+  written = writev(tapif->queue[0].fd, iov, cnt);
+  if (flat != NULL) {
+    pbuf_free(flat);
+  }
+  if (written < expected) {
     MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
     perror("tapif: write");
     return ERR_IF;
   } else {
-    MIB2_STATS_NETIF_ADD(netif, ifoutoctets, (u32_t)written);
+    MIB2_STATS_NETIF_ADD(netif, ifoutoctets, (u32_t)p->tot_len);
     return ERR_OK;
   }
 }
@@ -258,47 +418,117 @@ low_level_output(struct netif *netif, struct pbuf *p)
  *
  */
 /*-----------------------------------------------------------------------------------*/
+#if TAPIF_VNET_HDR
+/* Evaluate the checksum offload info the kernel passed with a frame */
+static int
+tapif_vnet_rx(struct pbuf *p, const struct virtio_net_hdr *vnet_hdr)
+{
+  if (vnet_hdr->gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+    /* not negotiated */
+    return -1;
+  }
+  if (vnet_hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+    /* sent by the host itself: the checksum field only holds the pseudo
+       header sum, the data is fine */
+#if IP_FORWARD || LWIP_IPV6_FORWARD
+    /* the frame may leave through another netif: complete the checksum */
+    u16_t chksum;
+    if ((vnet_hdr->csum_start >= p->len) ||
+        ((u32_t)vnet_hdr->csum_start + vnet_hdr->csum_offset + 2 > p->tot_len)) {
+      return -1;
+    }
+    pbuf_remove_header(p, vnet_hdr->csum_start);
+    chksum = inet_chksum_pbuf(p);
+    pbuf_add_header(p, vnet_hdr->csum_start);
+    if (pbuf_take_at(p, &chksum, sizeof(chksum), (u16_t)(vnet_hdr->csum_start + vnet_hdr->csum_offset)) != ERR_OK) {
+      return -1;
+    }
+#endif /* IP_FORWARD || LWIP_IPV6_FORWARD */
+    p->flags |= PBUF_FLAG_CSUM_VALID;
+  } else if (vnet_hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID) {
+    p->flags |= PBUF_FLAG_CSUM_VALID;
+  }
+  return 0;
+}
+#endif /* TAPIF_VNET_HDR */
+
 static struct pbuf *
-low_level_input(struct netif *netif)
+low_level_input(struct netif *netif, int fd)
 {
-  struct pbuf *p;
-  u16_t len;
+  struct pbuf *p, *q;
+  struct iovec iov[TAPIF_MAX_IOV];
+  int cnt = 0;
   ssize_t readlen;
-  char buf[1518]; /* max packet size including VLAN excluding CRC */
-  struct tapif *tapif = (struct tapif *)netif->state;
+#if TAPIF_VNET_HDR
+  struct virtio_net_hdr vnet_hdr;
+  const ssize_t hdrlen = sizeof(vnet_hdr);
+
+  iov[cnt].iov_base = &vnet_hdr;
+  iov[cnt].iov_len = sizeof(vnet_hdr);
+  cnt++;
+#else /* TAPIF_VNET_HDR */
+  const ssize_t hdrlen = 0;
+#endif /* TAPIF_VNET_HDR */
+
+  /* We allocate a pbuf chain for the largest possible frame from the pool
+     and read the frame directly into it. */
+  p = pbuf_alloc(PBUF_RAW, TAPIF_MAX_FRAME, PBUF_POOL);
+  if (p == NULL) {
+    u8_t dummy;
+    /* drop packet(); a short read discards the frame */
+    readlen = read(fd, &dummy, sizeof(dummy));
+    LWIP_UNUSED_ARG(readlen);
+    MIB2_STATS_NETIF_INC(netif, ifindiscards);
+    LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input: could not allocate pbuf\n"));
+    return NULL;
+  }
+  for (q = p; (q != NULL) && (cnt < TAPIF_MAX_IOV); q = q->next) {
+    iov[cnt].iov_base = q->payload;
+    iov[cnt].iov_len = q->len;
+    cnt++;
+  }
 
-  /* Obtain the size of the packet and put it into the "len"
-     variable. */
-  readlen = read(tapif->fd, buf, sizeof(buf));
+  readlen = readv(fd, iov, cnt);
   if (readlen < 0) {
+    pbuf_free(p);
+    if ((errno == EAGAIN) || (errno == EINTR)) {
+      /* queue drained (RX threads use non-blocking fds) */
+      return NULL;
+    }
     perror("read returned -1");
     exit(1);
   }
-  len = (u16_t)readlen;
+  if (readlen <= hdrlen) {
+    pbuf_free(p);
+    MIB2_STATS_NETIF_INC(netif, ifindiscards);
+    return NULL;
+  }
+  /* shrink the chain to the frame length, freeing unused pool pbufs */
+  pbuf_realloc(p, (u16_t)(readlen - hdrlen));
 
-  MIB2_STATS_NETIF_ADD(netif, ifinoctets, len);
+  MIB2_STATS_NETIF_ADD(netif, ifinoctets, p->tot_len);
+
+#if TAPIF_VNET_HDR
+  if (tapif_vnet_rx(p, &vnet_hdr) != 0) {
+    LWIP_DEBUGF(TAPIF_DEBUG, ("tapif_input: bad vnet header, dropped\n"));
+    pbuf_free(p);
+    MIB2_STATS_NETIF_INC(netif, ifindiscards);
+    return NULL;
+  }
+#endif /* TAPIF_VNET_HDR */
 
 #if 0
   if (((double)rand()/(double)RAND_MAX) < 0.2) {
     printf("drop\n");
+    pbuf_free(p);
     return NULL;
   }
 #endif
 
-  /* We allocate a pbuf chain of pbufs from the pool. */
-  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
-  if (p != NULL) {
-    pbuf_take(p, buf, len);
-    /* acknowledge that packet has been read(); */
-  } else {
-    /* drop packet(); */
-    MIB2_STATS_NETIF_INC(netif, ifindiscards);
-    LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input: could not allocate pbuf\n"));
-  }
-
   return p;
 }
 
+#if NO_SYS
 /*-----------------------------------------------------------------------------------*/
 /*
  * tapif_input():
@@ -313,7 +543,8 @@ low_level_input(struct netif *netif)
 static void
 tapif_input(struct netif *netif)
 {
-  struct pbuf *p = low_level_input(netif);
+  struct tapif *tapif = (struct tapif *)netif->state;
+  struct pbuf *p = low_level_input(netif, tapif->queue[0].fd);
 
   if (p == NULL) {
 #if LINK_STATS
@@ -328,6 +559,7 @@ tapif_input(struct netif *netif)
     pbuf_free(p);
   }
 }
+#endif /* NO_SYS */
 /*-----------------------------------------------------------------------------------*/
 /*
  * tapif_init():
@@ -359,7 +591,7 @@ tapif_init(struct netif *netif)
   netif->output_ip6 = ethip6_output;
 #endif /* LWIP_IPV6 */
   netif->linkoutput = low_level_output;
-  netif->mtu = 1500;
+  netif->mtu = TAPIF_MTU;
 
   low_level_init(netif);
 
@@ -368,14 +600,14 @@ tapif_init(struct netif *netif)
 
 
 /*-----------------------------------------------------------------------------------*/
+#if NO_SYS
+
 void
 tapif_poll(struct netif *netif)
 {
   tapif_input(netif);
 }
 
-#if NO_SYS
-
 int
 tapif_select(struct netif *netif)
 {
@@ -391,9 +623,9 @@ tapif_select(struct netif *netif)
   tv.tv_usec = (msecs % 1000) * 1000;
 
   FD_ZERO(&fdset);
-  FD_SET(tapif->fd, &fdset);
+  FD_SET(tapif->queue[0].fd, &fdset);
 
-  ret = select(tapif->fd + 1, &fdset, NULL, NULL, &tv);
+  ret = select(tapif->queue[0].fd + 1, &fdset, NULL, NULL, &tv);
   if (ret > 0) {
     tapif_input(netif);
   }
@@ -402,31 +634,100 @@ tapif_select(struct netif *netif)
 
 #else /* NO_SYS */
 
+/* Pass a burst of received frames to the stack */
 static void
-tapif_thread(void *arg)
+tapif_input_burst(struct netif *netif, struct pbuf **burst, int n)
 {
-  struct netif *netif;
-  struct tapif *tapif;
-  fd_set fdset;
+  int i;
+
+#if LWIP_TCPIP_CORE_LOCKING
+  if (netif->input == tcpip_input) {
+    /* tcpip_input() would lock the core (or post a message) per frame:
+       take the lock once for the whole burst instead */
+    LOCK_TCPIP_CORE();
+    for (i = 0; i < n; i++) {
+      if (ethernet_input(burst[i], netif) != ERR_OK) {
+        LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input: netif input error\n"));
+        pbuf_free(burst[i]);
+      }
+    }
+    UNLOCK_TCPIP_CORE();
+    return;
+  }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+
+  for (i = 0; i < n; i++) {
+    if (netif->input(burst[i], netif) != ERR_OK) {
+      LWIP_DEBUGF(NETIF_DEBUG, ("tapif_input: netif input error\n"));
+      pbuf_free(burst[i]);
+    }
+  }
+}
+
+/* Wait for queue 'q' to become readable, then drain up to one burst of
+   frames and hand them over together */
+static void
+tapif_queue_rx(struct tapif_queue *q)
+{
+  struct netif *netif = q->netif;
+  struct pbuf *burst[TAPIF_RX_BURST];
+  int n;
   int ret;
+#ifdef LWIP_UNIX_LINUX
+  struct epoll_event ev;
 
-  netif = (struct netif *)arg;
-  tapif = (struct tapif *)netif->state;
+  ret = epoll_wait(q->epfd, &ev, 1, -1);
+  if ((ret == -1) && (errno != EINTR)) {
+    perror("tapif_thread: epoll_wait");
+  }
+#else /* LWIP_UNIX_LINUX */
+  fd_set fdset;
 
-  while(1) {
-    FD_ZERO(&fdset);
-    FD_SET(tapif->fd, &fdset);
+  FD_ZERO(&fdset);
+  FD_SET(q->fd, &fdset);
 
-    /* Wait for a packet to arrive. */
-    ret = select(tapif->fd + 1, &fdset, NULL, NULL, NULL);
+  ret = select(q->fd + 1, &fdset, NULL, NULL, NULL);
+  if(ret == -1) {
+    perror("tapif_thread: select");
+  }
+#endif /* LWIP_UNIX_LINUX */
 
-    if(ret == 1) {
-      /* Handle incoming packet. */
-      tapif_input(netif);
-    } else if(ret == -1) {
-      perror("tapif_thread: select");
+  if (ret > 0) {
+    for (n = 0; n < TAPIF_RX_BURST; n++) {
+      burst[n] = low_level_input(netif, q->fd);
+      if (burst[n] == NULL) {
+        break;
+      }
+#ifndef LWIP_UNIX_LINUX
+      /* blocking fd: only one frame is known to be ready */
+      n++;
+      break;
+#endif /* LWIP_UNIX_LINUX */
+    }
+    if (n > 0) {
+      tapif_input_burst(netif, burst, n);
     }
   }
 }
 
+static void
+tapif_thread(void *arg)
+{
+  struct tapif_queue *q = (struct tapif_queue *)arg;
+
+  while(1) {
+    tapif_queue_rx(q);
+  }
+}
+
+/* The RX threads are the only readers of the queues (a second reader could
+   reorder the frames of a flow). Polling (as done by main loops written for
+   NO_SYS) only sleeps instead of spinning. */
+void
+tapif_poll(struct netif *netif)
+{
+  LWIP_UNUSED_ARG(netif);
+  sys_msleep(TAPIF_POLL_SLEEP_MS);
+}
+
 #endif /* NO_SYS */
@@ -33,6 +33,18 @@
 #include "arch/perf.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define PERF_MAX_KEYS  32
+
+struct perf_key {
+  const char *key;
+  u64_t calls;
+  u64_t ns;
+};
+
+static struct perf_key perf_keys[PERF_MAX_KEYS];
 
 static FILE *f;
 
@@ -62,4 +74,64 @@ perf_init(char *fname)
 {
   f = fopen(fname, "w");  
 }
-	
+
+u64_t
+perf_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+static void
+perf_account(const char *key, u64_t ns)
+{
+  int i;
+
+  for (i = 0; i < PERF_MAX_KEYS; i++) {
+    const char *k = __atomic_load_n(&perf_keys[i].key, __ATOMIC_ACQUIRE);
+    if (k == NULL) {
+      /* claim a free entry (another thread may have taken it meanwhile) */
+      if (!__atomic_compare_exchange_n(&perf_keys[i].key, &k, key, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        if (strcmp(k, key) != 0) {
+          continue;
+        }
+      }
+    } else if ((k != key) && (strcmp(k, key) != 0)) {
+      continue;
+    }
+    __atomic_fetch_add(&perf_keys[i].calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&perf_keys[i].ns, ns, __ATOMIC_RELAXED);
+    return;
+  }
+}
+
+void
+perf_stop(const char *key, u64_t start)
+{
+  perf_account(key, perf_now() - start);
+}
+
+void
+perf_report(void)
+{
+  int i;
+
+  printf("%-16s %12s %12s %10s\n", "layer", "calls", "total ms", "ns/call");
+  for (i = 0; (i < PERF_MAX_KEYS) && (perf_keys[i].key != NULL); i++) {
+    printf("%-16s %12lu %12.3f %10.1f\n", perf_keys[i].key, (unsigned long)perf_keys[i].calls,
+           (double)perf_keys[i].ns / 1e6, (double)perf_keys[i].ns / (double)perf_keys[i].calls);
+  }
+}
+
+void
+perf_reset(void)
+{
+  int i;
+
+  for (i = 0; i < PERF_MAX_KEYS; i++) {
+    perf_keys[i].calls = 0;
+    perf_keys[i].ns = 0;
+  }
+}
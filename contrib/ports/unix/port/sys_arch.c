@@ -666,12 +666,32 @@ sys_mutex_free(struct sys_mutex **mutex)
 
 /*-----------------------------------------------------------------------------------*/
 /* Time */
+#ifdef LWIP_VIRTUAL_SYS_NOW
+static int sys_now_is_virtual;
+static u32_t sys_now_virtual;
+
+/** Stop following the monotonic clock and let sys_now() return 'now' from
+ * here on (e.g. to replay recorded traffic with its recorded timing).
+ * Call it again to advance the time. */
+void
+sys_now_set_virtual(u32_t now)
+{
+  sys_now_virtual = now;
+  sys_now_is_virtual = 1;
+}
+#endif /* LWIP_VIRTUAL_SYS_NOW */
+
 u32_t
 sys_now(void)
 {
   struct timespec ts;
   u32_t now;
 
+#ifdef LWIP_VIRTUAL_SYS_NOW
+  if (sys_now_is_virtual) {
+    return sys_now_virtual;
+  }
+#endif /* LWIP_VIRTUAL_SYS_NOW */
   get_monotonic_time(&ts);
   now = (u32_t)(ts.tv_sec * 1000L + ts.tv_nsec / 1000000L);
 #ifdef LWIP_FUZZ_SYS_NOW
@@ -0,0 +1,65 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_REASSBENCH_LWIPOPTS_H
+#define LWIP_REASSBENCH_LWIPOPTS_H
+
+/* Single-threaded raw API stack, only reassembly and UDP input are used */
+#define NO_SYS                     1
+#define SYS_LIGHTWEIGHT_PROT       0
+#define LWIP_SOCKET                0
+#define LWIP_NETCONN               0
+
+#define LWIP_IPV4                  1
+#define LWIP_IPV6                  1
+#define LWIP_UDP                   1
+#define LWIP_TCP                   0
+#define LWIP_ARP                   0
+
+#define LWIP_NETIF_LOOPBACK        0
+#define LWIP_HAVE_LOOPIF           0
+#define LWIP_STATS                 0
+
+/* the fragments are generated without checksums */
+#define CHECKSUM_CHECK_IP          0
+#define CHECKSUM_CHECK_UDP         0
+
+/* many datagrams in reassembly; set IP_REASS_HASH_SIZE and
+   IP_REASS_MAX_PBUFS_PER_SRC to 0 to compare with the linear search */
+#define IP_REASSEMBLY              1
+#define LWIP_IPV6_REASS            1
+/* 64 bit pointers */
+#define IPV6_FRAG_COPYHEADER       1
+#define MEMP_NUM_REASSDATA         1024
+#define MEMP_NUM_IP6_REASSDATA     1024
+#define IP_REASS_MAX_PBUFS         4096
+#define IP_REASS_HASH_SIZE         1024
+#define IP_REASS_MAX_PBUFS_PER_SRC 1024
+
+#define MEM_LIBC_MALLOC            1
+#define MEMP_MEM_MALLOC            1
+
+#endif /* LWIP_REASSBENCH_LWIPOPTS_H */
@@ -0,0 +1,379 @@
+/**
+ * @file
+ * IPv4 and IPv6 reassembly rate with fragments in random order
+ *
+ * Feeds the fragments of UDP datagrams from many sources into a NO_SYS stack,
+ * a window of datagrams at a time with all of their fragments shuffled.
+ * Optionally, one attacking source floods fragments of datagrams that never
+ * complete (-j), which fills the reassembly buffer: with
+ * IP_REASS_MAX_PBUFS_PER_SRC, the attacker only loses its own datagrams,
+ * without it, the oldest datagrams of other sources are freed, too.
+ *
+ * Reports:
+ * - ns per fragment passed to ip4_input() or ip6_input()
+ * - datagrams reassembled and received, datagrams lost
+ *
+ * With IP_REASS_HASH_SIZE and IP_REASS_MAX_PBUFS_PER_SRC set to 0 in
+ * lwipopts.h, the linear reassembly of plain lwIP is measured instead.
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/ip4.h"
+#include "lwip/ip4_frag.h"
+#include "lwip/ip6.h"
+#include "lwip/ip6_frag.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ip6.h"
+#include "lwip/prot/udp.h"
+
+#define BENCH_PORT        9
+#define BENCH_NUM_SOURCES 256
+/* the attacking source */
+#define BENCH_ATTACKER    BENCH_NUM_SOURCES
+
+static struct netif bench_netif;
+static int bench_ip6;
+static int bench_size = 8000;
+static u8_t *bench_payload;
+static struct pbuf **bench_frags;
+static u32_t bench_received;
+static u32_t bench_bad;
+static u32_t bench_seed = 1;
+
+static u32_t
+bench_rand(void)
+{
+  /* xorshift32: the same fragment order for the same seed on every platform */
+  bench_seed ^= bench_seed << 13;
+  bench_seed ^= bench_seed >> 17;
+  bench_seed ^= bench_seed << 5;
+  return bench_seed;
+}
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* netif: discard everything (ICMP time exceeded) */
+
+static err_t
+bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_output_ip6(struct netif *netif, struct pbuf *p, const ip6_addr_t *ipaddr)
+{
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(p);
+  LWIP_UNUSED_ARG(ipaddr);
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->name[0] = 'r';
+  netif->name[1] = 'b';
+  netif->output = bench_output;
+  netif->output_ip6 = bench_output_ip6;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+static void
+bench_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  /* the payload is the same for all datagrams, check a few bytes of it */
+  if ((p->tot_len != bench_size) || (pbuf_get_at(p, 0) != bench_payload[UDP_HLEN]) ||
+      (pbuf_get_at(p, (u16_t)(bench_size / 2)) != bench_payload[UDP_HLEN + bench_size / 2]) ||
+      (pbuf_get_at(p, (u16_t)(bench_size - 1)) != bench_payload[UDP_HLEN + bench_size - 1])) {
+    bench_bad++;
+  }
+  bench_received++;
+  pbuf_free(p);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* fragments */
+
+/** Create one fragment of the datagram 'id' of source 'src' */
+static struct pbuf *
+bench_fragment(u32_t src, u16_t id, u16_t offset, u16_t len, int more)
+{
+  struct pbuf *p;
+
+  if (bench_ip6) {
+    struct ip6_hdr *ip6hdr;
+    struct ip6_frag_hdr *fraghdr;
+    ip6_addr_t src6;
+
+    p = pbuf_alloc(PBUF_RAW, (u16_t)(IP6_HLEN + IP6_FRAG_HLEN + len), PBUF_RAM);
+    if (p == NULL) {
+      return NULL;
+    }
+    ip6hdr = (struct ip6_hdr *)p->payload;
+    IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+    IP6H_PLEN_SET(ip6hdr, (u16_t)(IP6_FRAG_HLEN + len));
+    IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_FRAGMENT);
+    IP6H_HOPLIM_SET(ip6hdr, 64);
+    /* 2001:db8::<src>, to 2001:db8::1 */
+    IP6_ADDR(&src6, PP_HTONL(0x20010db8UL), 0, 0, lwip_htonl(0x100 + src));
+    ip6_addr_copy_to_packed(ip6hdr->src, src6);
+    ip6_addr_copy_to_packed(ip6hdr->dest, *netif_ip6_addr(&bench_netif, 0));
+    fraghdr = (struct ip6_frag_hdr *)(ip6hdr + 1);
+    fraghdr->_nexth = IP6_NEXTH_UDP;
+    fraghdr->reserved = 0;
+    fraghdr->_fragment_offset = lwip_htons((u16_t)(offset | (more ? IP6_FRAG_MORE_FLAG : 0)));
+    fraghdr->_identification = lwip_htonl(id);
+    MEMCPY(fraghdr + 1, &bench_payload[offset], len);
+  } else {
+    struct ip_hdr *iphdr;
+
+    p = pbuf_alloc(PBUF_RAW, (u16_t)(IP_HLEN + len), PBUF_RAM);
+    if (p == NULL) {
+      return NULL;
+    }
+    iphdr = (struct ip_hdr *)p->payload;
+    IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+    IPH_TOS_SET(iphdr, 0);
+    IPH_LEN_SET(iphdr, lwip_htons((u16_t)(IP_HLEN + len)));
+    IPH_ID_SET(iphdr, lwip_htons(id));
+    IPH_OFFSET_SET(iphdr, lwip_htons((u16_t)((offset / 8) | (more ? IP_MF : 0))));
+    IPH_TTL_SET(iphdr, 64);
+    IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+    IPH_CHKSUM_SET(iphdr, 0);
+    /* 10.1.x.x, to 10.0.0.1 */
+    IP4_ADDR(&iphdr->src, 10, 1, (u8_t)(src >> 8), (u8_t)src);
+    ip4_addr_copy(iphdr->dest, *netif_ip4_addr(&bench_netif));
+    MEMCPY(iphdr + 1, &bench_payload[offset], len);
+  }
+  return p;
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-6] [-b bytes] [-w window] [-n datagrams] [-j junk] [-s seed]\n"
+          "  -6  IPv6 (default: IPv4)\n"
+          "  -b  UDP payload bytes per datagram (default: 8000)\n"
+          "  -w  datagrams in reassembly at the same time (default: 256)\n"
+          "  -n  number of datagrams (default: 100000)\n"
+          "  -j  junk fragments of the attacker per datagram (default: 0)\n"
+          "  -s  random seed (default: 1)\n", name);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct udp_pcb *pcb;
+  struct pbuf *p;
+  ip4_addr_t addr, netmask;
+  ip6_addr_t addr6;
+  struct udp_hdr *udphdr;
+  u16_t ids[BENCH_NUM_SOURCES + 1];
+  u64_t ns = 0, start;
+  int window = 256;
+  int datagrams = 100000;
+  int junk = 0;
+  int chunk, frags_per_datagram, max_frags, num_frags, sent;
+  int opt, i, j, d, len;
+  u32_t src;
+
+  while ((opt = getopt(argc, argv, "6b:w:n:j:s:")) != -1) {
+    switch (opt) {
+      case '6':
+        bench_ip6 = 1;
+        break;
+      case 'b':
+        bench_size = atoi(optarg);
+        if ((bench_size < 1) || (bench_size > 60000)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'w':
+        window = atoi(optarg);
+        if (window < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        datagrams = atoi(optarg);
+        if (datagrams < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 'j':
+        junk = atoi(optarg);
+        if (junk < 0) {
+          usage(argv[0]);
+        }
+        break;
+      case 's':
+        bench_seed = (u32_t)strtoul(optarg, NULL, 0);
+        if (bench_seed == 0) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  /* fragment payload of a 1500 bytes MTU, a multiple of 8 */
+  chunk = bench_ip6 ? (1500 - IP6_HLEN - IP6_FRAG_HLEN) & ~7 : (1500 - IP_HLEN) & ~7;
+  frags_per_datagram = (UDP_HLEN + bench_size + chunk - 1) / chunk;
+  max_frags = window * (frags_per_datagram + junk);
+  bench_payload = (u8_t *)malloc((size_t)(UDP_HLEN + bench_size));
+  bench_frags = (struct pbuf **)calloc((size_t)max_frags, sizeof(struct pbuf *));
+  if ((bench_payload == NULL) || (bench_frags == NULL)) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  /* UDP header without checksum, then the payload */
+  udphdr = (struct udp_hdr *)bench_payload;
+  udphdr->src = PP_HTONS(BENCH_PORT);
+  udphdr->dest = PP_HTONS(BENCH_PORT);
+  udphdr->len = lwip_htons((u16_t)(UDP_HLEN + bench_size));
+  udphdr->chksum = 0;
+  for (i = 0; i < bench_size; i++) {
+    bench_payload[UDP_HLEN + i] = (u8_t)bench_rand();
+  }
+  memset(ids, 0, sizeof(ids));
+
+  lwip_init();
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  IP4_ADDR(&netmask, 255, 0, 0, 0);
+  netif_add(&bench_netif, &addr, &netmask, IP4_ADDR_ANY4, NULL, bench_netif_init, ip_input);
+  IP6_ADDR(&addr6, PP_HTONL(0x20010db8UL), 0, 0, PP_HTONL(0x00000001UL));
+  netif_add_ip6_address(&bench_netif, &addr6, NULL);
+  netif_ip6_addr_set_state(&bench_netif, 0, IP6_ADDR_PREFERRED);
+  netif_set_up(&bench_netif);
+
+  pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+  if ((pcb == NULL) || (udp_bind(pcb, IP_ANY_TYPE, BENCH_PORT) != ERR_OK)) {
+    fprintf(stderr, "udp pcb failed\n");
+    return 1;
+  }
+  udp_recv(pcb, bench_recv, NULL);
+
+  for (sent = 0; sent < datagrams; sent += window) {
+    /* fragments of a window of datagrams and the attacker's junk */
+    num_frags = 0;
+    for (d = 0; d < LWIP_MIN(window, datagrams - sent); d++) {
+      src = bench_rand() % BENCH_NUM_SOURCES;
+      ids[src]++;
+      for (i = 0; i < frags_per_datagram; i++) {
+        len = LWIP_MIN(chunk, UDP_HLEN + bench_size - i * chunk);
+        bench_frags[num_frags++] = bench_fragment(src, ids[src], (u16_t)(i * chunk), (u16_t)len,
+                                                  i < frags_per_datagram - 1);
+      }
+      for (j = 0; j < junk; j++) {
+        /* a new datagram each time, never the first or last fragment */
+        ids[BENCH_ATTACKER]++;
+        bench_frags[num_frags++] = bench_fragment(BENCH_ATTACKER, ids[BENCH_ATTACKER], (u16_t)chunk,
+                                                  (u16_t)chunk, 1);
+      }
+    }
+    for (i = 0; i < num_frags; i++) {
+      if (bench_frags[i] == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+      }
+    }
+    /* shuffle */
+    for (i = num_frags - 1; i > 0; i--) {
+      j = (int)(bench_rand() % (u32_t)(i + 1));
+      p = bench_frags[i];
+      bench_frags[i] = bench_frags[j];
+      bench_frags[j] = p;
+    }
+
+    start = bench_now_ns();
+    if (bench_ip6) {
+      for (i = 0; i < num_frags; i++) {
+        ip6_input(bench_frags[i], &bench_netif);
+      }
+    } else {
+      for (i = 0; i < num_frags; i++) {
+        ip4_input(bench_frags[i], &bench_netif);
+      }
+    }
+    ns += bench_now_ns() - start;
+  }
+  num_frags = (frags_per_datagram + junk) * datagrams;
+
+  /* let the incomplete datagrams time out */
+  for (i = 0; i <= LWIP_MAX(IP_REASS_MAXAGE, IPV6_REASS_MAXAGE); i++) {
+    if (bench_ip6) {
+      ip6_reass_tmr();
+    } else {
+      ip_reass_tmr();
+    }
+  }
+
+  printf("%s, %d datagrams of %d bytes (%d fragments), window %d, %d junk fragments per datagram\n",
+         bench_ip6 ? "IPv6" : "IPv4", datagrams, bench_size, frags_per_datagram, window, junk);
+  printf("%10.1f ns/fragment %10.2f Mfragments/s\n", (double)ns / num_frags,
+         (double)num_frags * 1000.0 / (double)ns);
+  printf("received %lu (%lu corrupted), lost %lu\n", (unsigned long)bench_received,
+         (unsigned long)bench_bad, (unsigned long)(datagrams - bench_received));
+
+  udp_remove(pcb);
+  free(bench_frags);
+  free(bench_payload);
+  return bench_bad ? 1 : 0;
+}
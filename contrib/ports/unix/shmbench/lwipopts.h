@@ -0,0 +1,64 @@
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_SHMBENCH_LWIPOPTS_H
+#define LWIP_SHMBENCH_LWIPOPTS_H
+
+/* Single-threaded raw API stack, driven by busy polling the shmif rings */
+#define NO_SYS                     1
+#define SYS_LIGHTWEIGHT_PROT       0
+#define LWIP_SOCKET                0
+#define LWIP_NETCONN               0
+
+#define LWIP_IPV4                  1
+#define LWIP_IPV6                  0
+#define LWIP_ICMP                  1
+#define LWIP_UDP                   1
+#define LWIP_TCP                   1
+#define LWIP_ARP                   1
+
+#define LWIP_NETIF_LOOPBACK        0
+#define LWIP_HAVE_LOOPIF           0
+#define LWIP_STATS                 0
+
+#define MEM_ALIGNMENT              8
+#define MEM_SIZE                   (4 * 1024 * 1024)
+#define MEMP_NUM_PBUF              1024
+#define MEMP_NUM_TCP_PCB           8
+#define MEMP_NUM_UDP_PCB           4
+#define MEMP_NUM_TCP_SEG           1024
+#define PBUF_POOL_SIZE             2048
+#define PBUF_POOL_BUFSIZE          1536
+
+#define TCP_MSS                    1460
+#define TCP_WND                    (44 * TCP_MSS)
+#define TCP_SND_BUF                (44 * TCP_MSS)
+#define TCP_SND_QUEUELEN           (4 * TCP_SND_BUF / TCP_MSS)
+#define TCP_OVERSIZE               TCP_MSS
+#define LWIP_TCP_TIMESTAMPS        0
+#define TCP_LISTEN_BACKLOG         0
+
+#endif /* LWIP_SHMBENCH_LWIPOPTS_H */
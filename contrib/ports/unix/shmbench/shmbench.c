@@ -0,0 +1,619 @@
+/**
+ * @file
+ * Stack-to-stack benchmarks over the shared-memory netif (shmif)
+ *
+ * Runs a client and a server stack connected back to back by shmif, either
+ * in two processes (default: the server is forked off and attaches to the
+ * same memfd region) or as two netifs on one stack in a single process
+ * (-i, which also enables queueing pbufs instead of copies). Both sides are
+ * NO_SYS, raw API and busy poll their rings, so the numbers reflect lwIP
+ * itself and not the kernel or a scheduler.
+ *
+ * Tests:
+ * - tcp_bulk: one-way TCP transfer, reports throughput
+ * - tcp_rr:   TCP request/response ping-pong, reports transactions/s and latency
+ * - udp_pps:  UDP flood, reports packets/s sent and received
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/timeouts.h"
+#include "netif/ethernet.h"
+#include "netif/shmif.h"
+
+#define BENCH_PORT_BULK  5001
+#define BENCH_PORT_RR    5002
+#define BENCH_PORT_UDP   5003
+
+/* latency histogram: BENCH_HIST_NS resolution, last bucket collects the rest */
+#define BENCH_HIST_NS       50
+#define BENCH_HIST_BUCKETS  20000
+
+static struct netif bench_netif[2];
+static int bench_in_process;
+/* netifs used by each end (the same one if the other end is in another process) */
+static struct netif *client_netif;
+static struct netif *server_netif;
+static ip_addr_t server_ip;
+
+static u8_t bench_buf[0xFFFF];
+static u32_t bench_hist[BENCH_HIST_BUCKETS];
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+static void
+bench_poll(void)
+{
+  shmif_poll(&bench_netif[0]);
+  if (bench_in_process) {
+    shmif_poll(&bench_netif[1]);
+  }
+  sys_check_timeouts();
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Server: discards bulk data, echoes RR data, counts UDP datagrams */
+
+static u32_t server_udp_count;
+
+static err_t
+server_bulk_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_close(pcb);
+    return ERR_OK;
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+server_rr_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct pbuf *q;
+
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_close(pcb);
+    return ERR_OK;
+  }
+  if (tcp_sndbuf(pcb) < p->tot_len) {
+    /* the client never has more than one request outstanding */
+    return ERR_MEM;
+  }
+  for (q = p; q != NULL; q = q->next) {
+    tcp_write(pcb, q->payload, q->len, TCP_WRITE_FLAG_COPY);
+  }
+  tcp_output(pcb);
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+server_bulk_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  tcp_recv(pcb, server_bulk_recv);
+  return ERR_OK;
+}
+
+static err_t
+server_rr_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  tcp_nagle_disable(pcb);
+  tcp_recv(pcb, server_rr_recv);
+  return ERR_OK;
+}
+
+static void
+server_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  LWIP_UNUSED_ARG(arg);
+  if (p->tot_len > 0) {
+    server_udp_count++;
+    pbuf_free(p);
+    return;
+  }
+  /* empty datagram: report and reset the count */
+  pbuf_free(p);
+  p = pbuf_alloc(PBUF_TRANSPORT, sizeof(u32_t), PBUF_RAM);
+  if (p != NULL) {
+    u32_t count = lwip_htonl(server_udp_count);
+    pbuf_take(p, &count, sizeof(count));
+    udp_sendto(pcb, p, addr, port);
+    pbuf_free(p);
+  }
+  server_udp_count = 0;
+}
+
+static void
+server_listen(u16_t port, tcp_accept_fn accept)
+{
+  struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+
+  LWIP_ASSERT("out of pcbs", pcb != NULL);
+  tcp_bind_netif(pcb, server_netif);
+  tcp_bind(pcb, IP_ADDR_ANY, port);
+  pcb = tcp_listen(pcb);
+  LWIP_ASSERT("listen failed", pcb != NULL);
+  tcp_accept(pcb, accept);
+}
+
+static void
+server_init(void)
+{
+  struct udp_pcb *upcb;
+
+  server_listen(BENCH_PORT_BULK, server_bulk_accept);
+  server_listen(BENCH_PORT_RR, server_rr_accept);
+
+  upcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  LWIP_ASSERT("out of pcbs", upcb != NULL);
+  udp_bind_netif(upcb, server_netif);
+  udp_bind(upcb, IP_ADDR_ANY, BENCH_PORT_UDP);
+  udp_recv(upcb, server_udp_recv, NULL);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Client side TCP tests */
+
+struct client_tcp {
+  struct tcp_pcb *pcb;
+  u8_t connected;
+  u8_t failed;
+  /* bulk: bytes acknowledged; rr: bytes of the current response */
+  u32_t bytes;
+  u16_t size;
+  u64_t sent_at;
+  u64_t transactions;
+};
+
+static err_t
+client_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  struct client_tcp *c = (struct client_tcp *)arg;
+
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(err);
+  c->connected = 1;
+  return ERR_OK;
+}
+
+static void
+client_err(void *arg, err_t err)
+{
+  struct client_tcp *c = (struct client_tcp *)arg;
+
+  fprintf(stderr, "shmbench: connection failed (%d)\n", err);
+  c->pcb = NULL;
+  c->failed = 1;
+}
+
+static int
+client_connect(struct client_tcp *c, u16_t port)
+{
+  memset(c, 0, sizeof(*c));
+  c->pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+  LWIP_ASSERT("out of pcbs", c->pcb != NULL);
+  tcp_arg(c->pcb, c);
+  tcp_err(c->pcb, client_err);
+  tcp_nagle_disable(c->pcb);
+  tcp_bind_netif(c->pcb, client_netif);
+  tcp_connect(c->pcb, &server_ip, port, client_connected);
+  while (!c->connected && !c->failed) {
+    bench_poll();
+  }
+  return c->connected;
+}
+
+static void
+client_close(struct client_tcp *c)
+{
+  if (c->pcb != NULL) {
+    tcp_arg(c->pcb, NULL);
+    tcp_err(c->pcb, NULL);
+    tcp_recv(c->pcb, NULL);
+    tcp_sent(c->pcb, NULL);
+    if (tcp_close(c->pcb) != ERR_OK) {
+      tcp_abort(c->pcb);
+    }
+    c->pcb = NULL;
+  }
+  /* let the FIN exchange finish */
+  bench_poll();
+}
+
+static void
+client_bulk_fill(struct client_tcp *c)
+{
+  u16_t len;
+
+  while ((len = (u16_t)LWIP_MIN(tcp_sndbuf(c->pcb), sizeof(bench_buf))) > 0) {
+    if (tcp_write(c->pcb, bench_buf, len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+      break;
+    }
+  }
+  tcp_output(c->pcb);
+}
+
+static err_t
+client_bulk_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+  struct client_tcp *c = (struct client_tcp *)arg;
+
+  LWIP_UNUSED_ARG(pcb);
+  c->bytes += len;
+  return ERR_OK;
+}
+
+static void
+bench_tcp_bulk(double duration)
+{
+  struct client_tcp c;
+  u64_t start, end;
+  double secs;
+
+  if (!client_connect(&c, BENCH_PORT_BULK)) {
+    return;
+  }
+  tcp_sent(c.pcb, client_bulk_sent);
+
+  start = bench_now_ns();
+  end = start + (u64_t)(duration * 1e9);
+  while (!c.failed && (bench_now_ns() < end)) {
+    client_bulk_fill(&c);
+    bench_poll();
+  }
+  secs = (double)(bench_now_ns() - start) / 1e9;
+  printf("tcp_bulk: %.1f MB in %.2f s: %.1f Mbit/s\n",
+         (double)c.bytes / 1e6, secs, (double)c.bytes * 8 / secs / 1e6);
+  client_close(&c);
+}
+
+static void
+client_rr_send(struct client_tcp *c)
+{
+  c->bytes = 0;
+  c->sent_at = bench_now_ns();
+  tcp_write(c->pcb, bench_buf, c->size, TCP_WRITE_FLAG_COPY);
+  tcp_output(c->pcb);
+}
+
+static err_t
+client_rr_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  struct client_tcp *c = (struct client_tcp *)arg;
+
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    c->failed = 1;
+    return ERR_OK;
+  }
+  c->bytes += p->tot_len;
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  if (c->bytes >= c->size) {
+    u64_t bucket = (bench_now_ns() - c->sent_at) / BENCH_HIST_NS;
+    bench_hist[LWIP_MIN(bucket, BENCH_HIST_BUCKETS - 1)]++;
+    c->transactions++;
+    /* the next request is sent from the main loop */
+    c->bytes = 0;
+    c->sent_at = 0;
+  }
+  return ERR_OK;
+}
+
+static double
+bench_hist_percentile(u64_t total, double pct)
+{
+  u64_t seen = 0;
+  u32_t i;
+
+  for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+    seen += bench_hist[i];
+    if ((double)seen >= (double)total * pct / 100.0) {
+      break;
+    }
+  }
+  return (double)(i + 1) * BENCH_HIST_NS / 1000.0;
+}
+
+static void
+bench_tcp_rr(double duration, u16_t size)
+{
+  struct client_tcp c;
+  u64_t start, end;
+  double secs;
+
+  if (!client_connect(&c, BENCH_PORT_RR)) {
+    return;
+  }
+  tcp_recv(c.pcb, client_rr_recv);
+  c.size = size;
+  memset(bench_hist, 0, sizeof(bench_hist));
+
+  start = bench_now_ns();
+  end = start + (u64_t)(duration * 1e9);
+  client_rr_send(&c);
+  while (!c.failed) {
+    bench_poll();
+    if (c.sent_at == 0) {
+      if (bench_now_ns() >= end) {
+        break;
+      }
+      client_rr_send(&c);
+    }
+  }
+  secs = (double)(bench_now_ns() - start) / 1e9;
+  if (c.transactions > 0) {
+    printf("tcp_rr: %u byte requests: %.0f transactions/s, latency avg %.2f us, p50 %.2f us, p99 %.2f us\n",
+           size, (double)c.transactions / secs, secs * 1e6 / (double)c.transactions,
+           bench_hist_percentile(c.transactions, 50), bench_hist_percentile(c.transactions, 99));
+  }
+  client_close(&c);
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Client side UDP test */
+
+static s64_t client_udp_report;
+
+static void
+client_udp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+  u32_t count;
+
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+  if (pbuf_copy_partial(p, &count, sizeof(count), 0) == sizeof(count)) {
+    client_udp_report = lwip_ntohl(count);
+  }
+  pbuf_free(p);
+}
+
+/* Ask the server for (and reset) its datagram count; -1 if it does not answer */
+static s64_t
+client_udp_sync(struct udp_pcb *pcb)
+{
+  int tries;
+
+  client_udp_report = -1;
+  for (tries = 0; (tries < 50) && (client_udp_report < 0); tries++) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_RAM);
+    u64_t until = bench_now_ns() + 100000000;
+    if (p != NULL) {
+      udp_sendto(pcb, p, &server_ip, BENCH_PORT_UDP);
+      pbuf_free(p);
+    }
+    while ((client_udp_report < 0) && (bench_now_ns() < until)) {
+      bench_poll();
+    }
+  }
+  return client_udp_report;
+}
+
+static void
+bench_udp_pps(double duration, u16_t size)
+{
+  struct udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+  u64_t start, end, sent = 0;
+  s64_t received;
+  double secs;
+  int i;
+
+  LWIP_ASSERT("out of pcbs", pcb != NULL);
+  udp_bind_netif(pcb, client_netif);
+  udp_bind(pcb, IP_ADDR_ANY, 0);
+  udp_recv(pcb, client_udp_recv, NULL);
+
+  /* resolves ARP and resets the server's count */
+  if (client_udp_sync(pcb) < 0) {
+    fprintf(stderr, "shmbench: udp server does not answer\n");
+    udp_remove(pcb);
+    return;
+  }
+
+  start = bench_now_ns();
+  end = start + (u64_t)(duration * 1e9);
+  while (bench_now_ns() < end) {
+    for (i = 0; i < 32; i++) {
+      struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, size, PBUF_RAM);
+      if (p == NULL) {
+        break;
+      }
+      /* payload contents do not matter */
+      if (udp_sendto(pcb, p, &server_ip, BENCH_PORT_UDP) == ERR_OK) {
+        sent++;
+      }
+      pbuf_free(p);
+    }
+    bench_poll();
+  }
+  secs = (double)(bench_now_ns() - start) / 1e9;
+  received = client_udp_sync(pcb);
+  printf("udp_pps: %u byte datagrams: sent %.0f pps, received %.0f pps\n",
+         size, (double)sent / secs, (received < 0) ? 0.0 : (double)received / secs);
+  udp_remove(pcb);
+}
+
+/*-----------------------------------------------------------------------------------*/
+static void
+bench_netif_add(struct netif *netif, struct shmif_config *cfg, const char *ip)
+{
+  ip4_addr_t addr, mask, gw;
+
+  ip4addr_aton(ip, &addr);
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  ip4_addr_set_zero(&gw);
+  if (netif_add(netif, &addr, &mask, &gw, cfg, shmif_init, ethernet_input) == NULL) {
+    fprintf(stderr, "shmbench: netif_add failed\n");
+    exit(1);
+  }
+  netif_set_up(netif);
+}
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-i] [-d seconds] [-s size] [tcp_bulk|tcp_rr|udp_pps ...]\n"
+          "  -i  run both ends on one stack in this process (default: fork a server process)\n"
+          "  -d  duration of each test (default: 3)\n"
+          "  -s  request (tcp_rr) or datagram (udp_pps) size (default: 1 / 64)\n", name);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct shmif_config cfg[2];
+  struct shmif_region *region;
+  double duration = 3;
+  int size = 0;
+  pid_t server = 0;
+  int opt, i;
+
+  while ((opt = getopt(argc, argv, "id:s:")) != -1) {
+    switch (opt) {
+      case 'i':
+        bench_in_process = 1;
+        break;
+      case 'd':
+        duration = atof(optarg);
+        break;
+      case 's':
+        size = atoi(optarg);
+        if ((size <= 0) || (size > 1400)) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+  for (i = optind; i < argc; i++) {
+    if (strcmp(argv[i], "tcp_bulk") && strcmp(argv[i], "tcp_rr") && strcmp(argv[i], "udp_pps")) {
+      usage(argv[0]);
+    }
+  }
+
+  region = shmif_region_create(NULL);
+  if (region == NULL) {
+    return 1;
+  }
+  cfg[0].region = region;
+  cfg[0].side = 0;
+  cfg[1].region = region;
+  cfg[1].side = 1;
+  IP_ADDR4(&server_ip, 10, 0, 0, 2);
+
+  if (!bench_in_process) {
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+      fprintf(stderr, "shmbench: warning: both processes busy poll, results are meaningless on one CPU\n");
+    }
+    server = fork();
+    if (server < 0) {
+      perror("shmbench: fork");
+      return 1;
+    }
+  }
+
+  lwip_init();
+
+  if (!bench_in_process && (server == 0)) {
+    /* server process: the mapping is inherited */
+    bench_netif_add(&bench_netif[0], &cfg[1], "10.0.0.2");
+    server_netif = &bench_netif[0];
+    server_init();
+    for (;;) {
+      bench_poll();
+    }
+  }
+
+  bench_netif_add(&bench_netif[0], &cfg[0], "10.0.0.1");
+  client_netif = &bench_netif[0];
+  if (bench_in_process) {
+    bench_netif_add(&bench_netif[1], &cfg[1], "10.0.0.2");
+    server_netif = &bench_netif[1];
+    server_init();
+  }
+  netif_set_default(client_netif);
+
+  printf("shmbench: %s, %.1f s per test\n", bench_in_process ? "one process" : "two processes", duration);
+  if (optind == argc) {
+    bench_tcp_bulk(duration);
+    bench_tcp_rr(duration, (u16_t)(size ? size : 1));
+    bench_udp_pps(duration, (u16_t)(size ? size : 64));
+  }
+  for (i = optind; i < argc; i++) {
+    if (!strcmp(argv[i], "tcp_bulk")) {
+      bench_tcp_bulk(duration);
+    } else if (!strcmp(argv[i], "tcp_rr")) {
+      bench_tcp_rr(duration, (u16_t)(size ? size : 1));
+    } else {
+      bench_udp_pps(duration, (u16_t)(size ? size : 64));
+    }
+  }
+
+  if (server > 0) {
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+  }
+  shmif_region_release(region);
+  return 0;
+}
@@ -0,0 +1,425 @@
+/**
+ * @file
+ * Cache behaviour of the TCP receive path
+ *
+ * Opens many connections to a listener of a NO_SYS stack (handshakes are
+ * injected into ip4_input() and the SYN-ACKs are read back from the netif's
+ * output function), then feeds in-sequence data segments to them round-robin.
+ * With enough connections the pcbs do not fit into the caches, so every
+ * segment has to fetch its pcb from memory, which is what the layout of
+ * struct tcp_pcb is about.
+ *
+ * Segments are built in batches outside of the measurement, only ip4_input()
+ * (IP, tcp_input(), tcp_receive(), the recv callback and the ACKs sent) is
+ * counted. Reports per segment:
+ * - ns
+ * - cycles and instructions
+ * - L1 data cache and last level cache read misses
+ *
+ * The counters come from perf_event_open() (user space only) and print as
+ * "n/a" if the kernel or the CPU does not provide them. To compare two
+ * layouts of struct tcp_pcb, build this at both revisions and run both with
+ * the same arguments (pinned to one CPU, e.g. with taskset).
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "lwip/init.h"
+#include "lwip/ip4.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/priv/tcp_priv.h"
+
+#define BENCH_PORT       80
+#define BENCH_PORT_BASE  10000
+#define BENCH_BATCH      256
+
+enum bench_counter {
+  BENCH_CYCLES,
+  BENCH_INSTRUCTIONS,
+  BENCH_L1D_MISSES,
+  BENCH_LLC_MISSES,
+  BENCH_NUM_COUNTERS
+};
+
+static const char *const bench_counter_name[BENCH_NUM_COUNTERS] = {
+  "cycles", "instructions", "L1D read misses", "LLC read misses"
+};
+
+/* per connection state of the injecting side */
+struct bench_conn {
+  u32_t seqno;
+  u32_t ackno;
+};
+
+static struct netif bench_netif;
+static ip4_addr_t bench_local_ip;
+static ip4_addr_t bench_remote_ip;
+static struct bench_conn *bench_conns;
+static int bench_num_conns = 1024;
+static u32_t bench_accepted;
+static u64_t bench_received;
+
+static int bench_fd[BENCH_NUM_COUNTERS];
+static u64_t bench_count[BENCH_NUM_COUNTERS];
+
+static u64_t
+bench_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (u64_t)ts.tv_sec * 1000000000 + (u64_t)ts.tv_nsec;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* perf counters */
+
+static int
+bench_counter_open(u32_t type, u64_t config)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void
+bench_counters_open(void)
+{
+  const u64_t read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+  bench_fd[BENCH_CYCLES] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  bench_fd[BENCH_INSTRUCTIONS] = bench_counter_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  bench_fd[BENCH_L1D_MISSES] = bench_counter_open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss);
+  bench_fd[BENCH_LLC_MISSES] = bench_counter_open(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | read_miss);
+}
+
+static void
+bench_counters_enable(int enable)
+{
+  int i;
+
+  for (i = 0; i < BENCH_NUM_COUNTERS; i++) {
+    if (bench_fd[i] >= 0) {
+      ioctl(bench_fd[i], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+}
+
+static void
+bench_counters_read(void)
+{
+  int i;
+
+  for (i = 0; i < BENCH_NUM_COUNTERS; i++) {
+    if ((bench_fd[i] < 0) || (read(bench_fd[i], &bench_count[i], sizeof(bench_count[i])) != sizeof(bench_count[i]))) {
+      bench_count[i] = 0;
+      if (bench_fd[i] >= 0) {
+        close(bench_fd[i]);
+        bench_fd[i] = -1;
+      }
+    }
+  }
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* netif: reads back the SYN-ACKs, discards everything else */
+
+static err_t
+bench_output(struct netif *netif, struct pbuf *p, const ip4_addr_t *ipaddr)
+{
+  struct tcp_hdr tcphdr;
+  u16_t port;
+
+  LWIP_UNUSED_ARG(netif);
+  LWIP_UNUSED_ARG(ipaddr);
+  if (pbuf_copy_partial(p, &tcphdr, sizeof(tcphdr), IP_HLEN) != sizeof(tcphdr)) {
+    return ERR_OK;
+  }
+  if ((TCPH_FLAGS(&tcphdr) & (TCP_SYN | TCP_ACK)) == (TCP_SYN | TCP_ACK)) {
+    port = (u16_t)(lwip_ntohs(tcphdr.dest) - BENCH_PORT_BASE);
+    if (port < bench_num_conns) {
+      bench_conns[port].ackno = lwip_ntohl(tcphdr.seqno) + 1;
+    }
+  }
+  return ERR_OK;
+}
+
+static err_t
+bench_netif_init(struct netif *netif)
+{
+  netif->name[0] = 'b';
+  netif->name[1] = 'n';
+  netif->output = bench_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Server: accepts everything and discards the data */
+
+static err_t
+bench_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  if (p == NULL) {
+    tcp_close(pcb);
+    return ERR_OK;
+  }
+  bench_received += p->tot_len;
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t
+bench_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(err);
+  tcp_recv(pcb, bench_recv);
+  bench_accepted++;
+  return ERR_OK;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Client side: segments injected into ip4_input() */
+
+static struct pbuf *
+bench_segment(int conn, u8_t flags, u16_t datalen)
+{
+  struct bench_conn *c = &bench_conns[conn];
+  struct ip_hdr *iphdr;
+  struct tcp_hdr *tcphdr;
+  struct pbuf *p;
+  u16_t len = (u16_t)(IP_HLEN + TCP_HLEN + datalen);
+
+  p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+  LWIP_ASSERT("out of pbufs", (p != NULL) && (p->next == NULL));
+  memset(p->payload, 0, len);
+
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, IP_HLEN / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(len));
+  IPH_TTL_SET(iphdr, 64);
+  IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+  ip4_addr_copy(iphdr->src, bench_remote_ip);
+  ip4_addr_copy(iphdr->dest, bench_local_ip);
+
+  tcphdr = (struct tcp_hdr *)(iphdr + 1);
+  tcphdr->src = lwip_htons((u16_t)(BENCH_PORT_BASE + conn));
+  tcphdr->dest = lwip_htons(BENCH_PORT);
+  tcphdr->seqno = lwip_htonl(c->seqno);
+  tcphdr->ackno = lwip_htonl(c->ackno);
+  TCPH_HDRLEN_FLAGS_SET(tcphdr, TCP_HLEN / 4, flags);
+  tcphdr->wnd = lwip_htons(0xFFFF);
+
+  c->seqno += datalen;
+  if (flags & TCP_SYN) {
+    c->seqno++;
+  }
+  return p;
+}
+
+static void
+bench_connect(void)
+{
+  struct pbuf *p;
+  int i;
+
+  for (i = 0; i < bench_num_conns; i++) {
+    bench_conns[i].seqno = (u32_t)i * 0x10000;
+    p = bench_segment(i, TCP_SYN, 0);
+    ip4_input(p, &bench_netif);
+    if (bench_conns[i].ackno == 0) {
+      fprintf(stderr, "no SYN-ACK for connection %d\n", i);
+      exit(1);
+    }
+    p = bench_segment(i, TCP_ACK, 0);
+    ip4_input(p, &bench_netif);
+  }
+  if (bench_accepted != (u32_t)bench_num_conns) {
+    fprintf(stderr, "only %u of %d connections accepted\n", (unsigned)bench_accepted, bench_num_conns);
+    exit(1);
+  }
+}
+
+/* Injects 'rounds' segments into each connection, round-robin, returns ns spent in ip4_input() */
+static u64_t
+bench_run(int rounds, u16_t datalen, int measure)
+{
+  struct pbuf *batch[BENCH_BATCH];
+  u64_t ns = 0;
+  int total = rounds * bench_num_conns;
+  int seg = 0;
+  int n, i;
+
+  while (seg < total) {
+    for (n = 0; (n < BENCH_BATCH) && (seg + n < total); n++) {
+      batch[n] = bench_segment((seg + n) % bench_num_conns, TCP_ACK | TCP_PSH, datalen);
+    }
+    if (measure) {
+      u64_t start;
+      bench_counters_enable(1);
+      start = bench_now_ns();
+      for (i = 0; i < n; i++) {
+        ip4_input(batch[i], &bench_netif);
+      }
+      ns += bench_now_ns() - start;
+      bench_counters_enable(0);
+    } else {
+      for (i = 0; i < n; i++) {
+        ip4_input(batch[i], &bench_netif);
+      }
+    }
+    seg += n;
+  }
+  return ns;
+}
+
+/*-----------------------------------------------------------------------------------*/
+
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-c connections] [-n rounds] [-s size]\n"
+          "  -c  number of connections (default: 1024, max: %d)\n"
+          "  -n  segments per connection (default: 100)\n"
+          "  -s  segment payload size (default: 64)\n", name, MEMP_NUM_TCP_PCB);
+  exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+  struct tcp_pcb *lpcb;
+  ip4_addr_t netmask;
+  u64_t ns, segments;
+  int rounds = 100;
+  int size = 64;
+  int opt, i;
+
+  while ((opt = getopt(argc, argv, "c:n:s:")) != -1) {
+    switch (opt) {
+      case 'c':
+        bench_num_conns = atoi(optarg);
+        if ((bench_num_conns < 1) || (bench_num_conns > MEMP_NUM_TCP_PCB)) {
+          usage(argv[0]);
+        }
+        break;
+      case 'n':
+        rounds = atoi(optarg);
+        if (rounds < 1) {
+          usage(argv[0]);
+        }
+        break;
+      case 's':
+        size = atoi(optarg);
+        if ((size < 1) || (size > TCP_MSS)) {
+          usage(argv[0]);
+        }
+        break;
+      default:
+        usage(argv[0]);
+        break;
+    }
+  }
+
+  bench_conns = (struct bench_conn *)calloc((size_t)bench_num_conns, sizeof(struct bench_conn));
+  if (bench_conns == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  lwip_init();
+  IP4_ADDR(&bench_local_ip, 10, 0, 0, 1);
+  IP4_ADDR(&bench_remote_ip, 10, 0, 0, 2);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  netif_add(&bench_netif, &bench_local_ip, &netmask, IP4_ADDR_ANY4, NULL, bench_netif_init, ip4_input);
+  netif_set_default(&bench_netif);
+  netif_set_up(&bench_netif);
+
+  lpcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+  LWIP_ASSERT("out of pcbs", lpcb != NULL);
+  tcp_bind(lpcb, IP4_ADDR_ANY, BENCH_PORT);
+  lpcb = tcp_listen(lpcb);
+  LWIP_ASSERT("listen failed", lpcb != NULL);
+  tcp_accept(lpcb, bench_accept);
+
+  bench_connect();
+  /* one round to get the window updates and delayed ACKs into a steady state */
+  bench_run(1, (u16_t)size, 0);
+  bench_received = 0;
+
+  bench_counters_open();
+  ns = bench_run(rounds, (u16_t)size, 1);
+  bench_counters_read();
+
+  segments = (u64_t)rounds * (u64_t)bench_num_conns;
+  if (bench_received != segments * (u64_t)size) {
+    fprintf(stderr, "received %lu of %lu bytes\n", (unsigned long)bench_received,
+            (unsigned long)(segments * (u64_t)size));
+    return 1;
+  }
+
+  printf("struct tcp_pcb: %u bytes, per segment part %u bytes, %u cache lines up to its end\n",
+         (unsigned)sizeof(struct tcp_pcb), (unsigned)(TCP_PCB_HOT_END - offsetof(struct tcp_pcb, flags)),
+         (unsigned)((TCP_PCB_HOT_END + LWIP_CACHE_LINE_SIZE - 1) / LWIP_CACHE_LINE_SIZE));
+  printf("%d connections, %lu segments of %d bytes\n", bench_num_conns, (unsigned long)segments, size);
+  printf("%-16s %12.1f\n", "ns", (double)ns / (double)segments);
+  for (i = 0; i < BENCH_NUM_COUNTERS; i++) {
+    if (bench_fd[i] >= 0) {
+      printf("%-16s %12.1f\n", bench_counter_name[i], (double)bench_count[i] / (double)segments);
+    } else {
+      printf("%-16s %12s\n", bench_counter_name[i], "n/a");
+    }
+  }
+  return 0;
+}
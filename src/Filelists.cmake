@@ -41,6 +41,7 @@ set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/dns.c
     ${LWIP_DIR}/src/core/inet_chksum.c
     ${LWIP_DIR}/src/core/ip.c
+    ${LWIP_DIR}/src/core/ip_flow.c
     ${LWIP_DIR}/src/core/mem.c
     ${LWIP_DIR}/src/core/memp.c
     ${LWIP_DIR}/src/core/netif.c
@@ -64,6 +65,7 @@ set(lwipcore4_SRCS
     ${LWIP_DIR}/src/core/ipv4/etharp.c
     ${LWIP_DIR}/src/core/ipv4/icmp.c
     ${LWIP_DIR}/src/core/ipv4/igmp.c
+    ${LWIP_DIR}/src/core/ipv4/ip4_fib.c
     ${LWIP_DIR}/src/core/ipv4/ip4_frag.c
     ${LWIP_DIR}/src/core/ipv4/ip4.c
     ${LWIP_DIR}/src/core/ipv4/ip4_addr.c
@@ -75,6 +77,7 @@ set(lwipcore6_SRCS
     ${LWIP_DIR}/src/core/ipv6/inet6.c
     ${LWIP_DIR}/src/core/ipv6/ip6.c
     ${LWIP_DIR}/src/core/ipv6/ip6_addr.c
+    ${LWIP_DIR}/src/core/ipv6/ip6_fib.c
     ${LWIP_DIR}/src/core/ipv6/ip6_frag.c
     ${LWIP_DIR}/src/core/ipv6/mld6.c
     ${LWIP_DIR}/src/core/ipv6/nd6.c
@@ -98,6 +101,7 @@ set(lwipnetif_SRCS
     ${LWIP_DIR}/src/netif/ethernet.c
     ${LWIP_DIR}/src/netif/bridgeif.c
     ${LWIP_DIR}/src/netif/bridgeif_fdb.c
+    ${LWIP_DIR}/src/netif/vlanif.c
     ${LWIP_DIR}/src/netif/slipif.c
 )
 
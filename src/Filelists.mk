@@ -35,6 +35,7 @@ COREFILES=$(LWIPDIR)/core/init.c \
 	$(LWIPDIR)/core/dns.c \
 	$(LWIPDIR)/core/inet_chksum.c \
 	$(LWIPDIR)/core/ip.c \
+	$(LWIPDIR)/core/ip_flow.c \
 	$(LWIPDIR)/core/mem.c \
 	$(LWIPDIR)/core/memp.c \
 	$(LWIPDIR)/core/netif.c \
@@ -57,6 +58,7 @@ CORE4FILES=$(LWIPDIR)/core/ipv4/acd.c \
 	$(LWIPDIR)/core/ipv4/etharp.c \
 	$(LWIPDIR)/core/ipv4/icmp.c \
 	$(LWIPDIR)/core/ipv4/igmp.c \
+	$(LWIPDIR)/core/ipv4/ip4_fib.c \
 	$(LWIPDIR)/core/ipv4/ip4_frag.c \
 	$(LWIPDIR)/core/ipv4/ip4.c \
 	$(LWIPDIR)/core/ipv4/ip4_addr.c
@@ -67,6 +69,7 @@ CORE6FILES=$(LWIPDIR)/core/ipv6/dhcp6.c \
 	$(LWIPDIR)/core/ipv6/inet6.c \
 	$(LWIPDIR)/core/ipv6/ip6.c \
 	$(LWIPDIR)/core/ipv6/ip6_addr.c \
+	$(LWIPDIR)/core/ipv6/ip6_fib.c \
 	$(LWIPDIR)/core/ipv6/ip6_frag.c \
 	$(LWIPDIR)/core/ipv6/mld6.c \
 	$(LWIPDIR)/core/ipv6/nd6.c
@@ -86,6 +89,7 @@ APIFILES=$(LWIPDIR)/api/api_lib.c \
 NETIFFILES=$(LWIPDIR)/netif/ethernet.c \
 	$(LWIPDIR)/netif/bridgeif.c \
 	$(LWIPDIR)/netif/bridgeif_fdb.c \
+	$(LWIPDIR)/netif/vlanif.c \
 	$(LWIPDIR)/netif/slipif.c
 
 # SIXLOWPAN: 6LoWPAN
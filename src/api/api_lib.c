@@ -579,7 +579,7 @@ static err_t
 netconn_recv_data(struct netconn *conn, void **new_buf, u8_t apiflags)
 {
   void *buf = NULL;
-  u16_t len;
+  pbuf_len_t len;
 
   LWIP_ERROR("netconn_recv: invalid pointer", (new_buf != NULL), return ERR_ARG;);
   *new_buf = NULL;
@@ -665,7 +665,7 @@ netconn_recv_data(struct netconn *conn, void **new_buf, u8_t apiflags)
   /* Register event with callback */
   API_EVENT(conn, NETCONN_EVT_RCVMINUS, len);
 
-  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_recv_data: received %p, len=%"U16_F"\n", buf, len));
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_recv_data: received %p, len=%"PBUFLEN_F"\n", buf, len));
 
   *new_buf = buf;
   /* don't set conn->last_err: it's only ERR_OK, anyway */
@@ -734,7 +734,7 @@ netconn_recv_data_tcp(struct netconn *conn, struct pbuf **new_buf, u8_t apiflags
   buf = *new_buf;
   if (!(apiflags & NETCONN_NOAUTORCVD)) {
     /* Let the stack know that we have taken the data. */
-    u16_t len = buf ? buf->tot_len : 1;
+    pbuf_len_t len = buf ? buf->tot_len : 1;
     /* don't care for the return value of lwip_netconn_do_recv */
     /* @todo: this should really be fixed, e.g. by retrying in poll on error */
     netconn_tcp_recvd_msg(conn, len,  &API_VAR_REF(msg));
@@ -945,7 +945,7 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
 
   LWIP_ERROR("netconn_send: invalid conn",  (conn != NULL), return ERR_ARG;);
 
-  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send: sending %"U16_F" bytes\n", buf->p->tot_len));
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send: sending %"PBUFLEN_F" bytes\n", buf->p->tot_len));
 
   API_MSG_VAR_ALLOC(msg);
   API_MSG_VAR_REF(msg).conn = conn;
@@ -956,6 +956,45 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+#if LWIP_SOCKET_MMSG
+/**
+ * @ingroup netconn_udp
+ * Send several netbufs over a UDP or RAW netconn with a single call into
+ * the tcpip_thread (or a single core lock acquisition).
+ * Sending stops at the first netbuf that cannot be sent.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs array of netbufs containing the data to send
+ * @param num number of netbufs in bufs
+ * @param sent the number of netbufs that were sent is stored here
+ * @return ERR_OK if all netbufs were sent, the error of the first failed
+ *         netbuf otherwise
+ */
+err_t
+netconn_send_multi(struct netconn *conn, struct netbuf *const *bufs, u16_t num, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  LWIP_ERROR("netconn_send_multi: invalid conn", (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_multi: invalid bufs", (bufs != NULL) || (num == 0), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_multi: invalid sent", (sent != NULL), return ERR_ARG;);
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_multi: sending %"U16_F" netbufs\n", num));
+
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).conn = conn;
+  API_MSG_VAR_REF(msg).msg.bm.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.bm.num = num;
+  API_MSG_VAR_REF(msg).msg.bm.sent = 0;
+  err = netconn_apimsg(lwip_netconn_do_send_multi, &API_MSG_VAR_REF(msg));
+  *sent = API_MSG_VAR_REF(msg).msg.bm.sent;
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+#endif /* LWIP_SOCKET_MMSG */
+
 /**
  * @ingroup netconn_tcp
  * Send data over a TCP netconn.
@@ -997,6 +1036,33 @@ err_t
 netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
                              u8_t apiflags, size_t *bytes_written)
 {
+#if LWIP_SOCKET_ZEROCOPY
+  return netconn_write_vectors_ref(conn, vectors, vectorcnt, apiflags, bytes_written, NULL, NULL);
+}
+
+/**
+ * @ingroup netconn_tcp
+ * Send vectorized data atomically over a TCP netconn without copying it:
+ * like netconn_write_vectors_partly() without NETCONN_COPY, but the data is
+ * referenced through pbufs allocated by 'ref_fn' (see tcp_write_ref()), so
+ * the caller learns when the stack has released the data.
+ *
+ * @param conn the TCP netconn over which to send data
+ * @param vectors array of vectors containing data to send
+ * @param vectorcnt number of vectors in the array
+ * @param apiflags NETCONN_MORE and/or NETCONN_DONTBLOCK
+ * @param bytes_written pointer to a location that receives the number of written bytes,
+ *        also if an error occurred after part of the data has been enqueued
+ * @param ref_fn function allocating the pbufs referencing the data
+ * @param ref_arg argument passed to ref_fn
+ * @return ERR_OK if data was sent, any other err_t on error
+ */
+err_t
+netconn_write_vectors_ref(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
+                          u8_t apiflags, size_t *bytes_written,
+                          tcp_ref_pbuf_fn ref_fn, void *ref_arg)
+{
+#endif /* LWIP_SOCKET_ZEROCOPY */
   API_MSG_VAR_DECLARE(msg);
   err_t err;
   u8_t dontblock;
@@ -1048,6 +1114,10 @@ netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u1
   API_MSG_VAR_REF(msg).msg.w.apiflags = apiflags;
   API_MSG_VAR_REF(msg).msg.w.len = size;
   API_MSG_VAR_REF(msg).msg.w.offset = 0;
+#if LWIP_SOCKET_ZEROCOPY
+  API_MSG_VAR_REF(msg).msg.w.ref_fn = ref_fn;
+  API_MSG_VAR_REF(msg).msg.w.ref_arg = ref_arg;
+#endif /* LWIP_SOCKET_ZEROCOPY */
 #if LWIP_SO_SNDTIMEO
   if (conn->send_timeout != 0) {
     /* get the time we started, which is later compared to
@@ -1062,10 +1132,11 @@ netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u1
      but if it is, this is done inside api_msg.c:do_write(), so we can use the
      non-blocking version here. */
   err = netconn_apimsg(lwip_netconn_do_write, &API_MSG_VAR_REF(msg));
+  if (bytes_written != NULL) {
+    /* also on errors: data enqueued before the error is still sent */
+    *bytes_written = API_MSG_VAR_REF(msg).msg.w.offset;
+  }
   if (err == ERR_OK) {
-    if (bytes_written != NULL) {
-      *bytes_written = API_MSG_VAR_REF(msg).msg.w.offset;
-    }
     /* for blocking, check all requested bytes were written, NOTE: send_timeout is
        treated as dontblock (see dontblock assignment above) */
     if (!dontblock) {
@@ -177,7 +177,7 @@ recv_raw(void *arg, struct raw_pcb *pcb, struct pbuf *p,
     /* copy the whole packet into new pbufs */
     q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
     if (q != NULL) {
-      u16_t len;
+      pbuf_len_t len;
       buf = (struct netbuf *)memp_malloc(MEMP_NETBUF);
       if (buf == NULL) {
         pbuf_free(q);
@@ -220,7 +220,7 @@ recv_udp(void *arg, struct udp_pcb *pcb, struct pbuf *p,
 {
   struct netbuf *buf;
   struct netconn *conn;
-  u16_t len;
+  pbuf_len_t len;
   err_t err;
 #if LWIP_SO_RCVBUF
   int recv_avail;
@@ -296,7 +296,7 @@ static err_t
 recv_tcp(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 {
   struct netconn *conn;
-  u16_t len;
+  pbuf_len_t len;
   void *msg;
 
   LWIP_UNUSED_ARG(pcb);
@@ -1527,45 +1527,45 @@ lwip_netconn_do_listen(void *m)
 #endif /* LWIP_TCP */
 
 /**
- * Send some data on a RAW or UDP pcb contained in a netconn
- * Called from netconn_send
+ * Send one netbuf on a RAW or UDP pcb contained in a netconn
  *
- * @param m the api_msg pointing to the connection
+ * @param conn the netconn to send on
+ * @param b the netbuf to send
+ * @return ERR_OK if the netbuf was sent, any other err_t on error
  */
-void
-lwip_netconn_do_send(void *m)
+static err_t
+lwip_netconn_send_netbuf(struct netconn *conn, struct netbuf *b)
 {
-  struct api_msg *msg = (struct api_msg *)m;
-
-  err_t err = netconn_err(msg->conn);
+  err_t err = netconn_err(conn);
+  LWIP_UNUSED_ARG(b); /* in case neither LWIP_RAW nor LWIP_UDP is enabled */
   if (err == ERR_OK) {
-    if (msg->conn->pcb.tcp != NULL) {
-      switch (NETCONNTYPE_GROUP(msg->conn->type)) {
+    if (conn->pcb.tcp != NULL) {
+      switch (NETCONNTYPE_GROUP(conn->type)) {
 #if LWIP_RAW
         case NETCONN_RAW:
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = raw_send(msg->conn->pcb.raw, msg->msg.b->p);
+          if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+            err = raw_send(conn->pcb.raw, b->p);
           } else {
-            err = raw_sendto(msg->conn->pcb.raw, msg->msg.b->p, &msg->msg.b->addr);
+            err = raw_sendto(conn->pcb.raw, b->p, &b->addr);
           }
           break;
 #endif
 #if LWIP_UDP
         case NETCONN_UDP:
 #if LWIP_CHECKSUM_ON_COPY
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                  msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
+          if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+            err = udp_send_chksum(conn->pcb.udp, b->p,
+                                  b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
           } else {
-            err = udp_sendto_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                    &msg->msg.b->addr, msg->msg.b->port,
-                                    msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
+            err = udp_sendto_chksum(conn->pcb.udp, b->p,
+                                    &b->addr, b->port,
+                                    b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
           }
 #else /* LWIP_CHECKSUM_ON_COPY */
-          if (ip_addr_isany_val(msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send(msg->conn->pcb.udp, msg->msg.b->p);
+          if (ip_addr_isany_val(b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+            err = udp_send(conn->pcb.udp, b->p);
           } else {
-            err = udp_sendto(msg->conn->pcb.udp, msg->msg.b->p, &msg->msg.b->addr, msg->msg.b->port);
+            err = udp_sendto(conn->pcb.udp, b->p, &b->addr, b->port);
           }
 #endif /* LWIP_CHECKSUM_ON_COPY */
           break;
@@ -1578,9 +1578,48 @@ lwip_netconn_do_send(void *m)
       err = ERR_CONN;
     }
   }
+  return err;
+}
+
+/**
+ * Send some data on a RAW or UDP pcb contained in a netconn
+ * Called from netconn_send
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+
+  msg->err = lwip_netconn_send_netbuf(msg->conn, msg->msg.b);
+  TCPIP_APIMSG_ACK(msg);
+}
+
+#if LWIP_SOCKET_MMSG
+/**
+ * Send several netbufs on a RAW or UDP pcb contained in a netconn,
+ * stopping at the first error.
+ * Called from netconn_send_multi
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_multi(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+  err_t err = ERR_OK;
+
+  for (msg->msg.bm.sent = 0; msg->msg.bm.sent < msg->msg.bm.num; msg->msg.bm.sent++) {
+    err = lwip_netconn_send_netbuf(msg->conn, msg->msg.bm.bufs[msg->msg.bm.sent]);
+    if (err != ERR_OK) {
+      break;
+    }
+  }
   msg->err = err;
   TCPIP_APIMSG_ACK(msg);
 }
+#endif /* LWIP_SOCKET_MMSG */
 
 #if LWIP_TCP
 /**
@@ -1713,7 +1752,12 @@ lwip_netconn_do_writemore(struct netconn *conn  WRITE_DELAYED_PARAM)
       } else {
         write_more = 0;
       }
+#if LWIP_SOCKET_ZEROCOPY
+      err = tcp_write_ref(conn->pcb.tcp, dataptr, len, apiflags,
+                          conn->current_msg->msg.w.ref_fn, conn->current_msg->msg.w.ref_arg);
+#else /* LWIP_SOCKET_ZEROCOPY */
       err = tcp_write(conn->pcb.tcp, dataptr, len, apiflags);
+#endif /* LWIP_SOCKET_ZEROCOPY */
       if (err == ERR_OK) {
         conn->current_msg->msg.w.offset += len;
         conn->current_msg->msg.w.vector_off += len;
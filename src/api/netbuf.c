@@ -99,7 +99,7 @@ netbuf_delete(struct netbuf *buf)
  *         NULL if no memory could be allocated
  */
 void *
-netbuf_alloc(struct netbuf *buf, u16_t size)
+netbuf_alloc(struct netbuf *buf, pbuf_len_t size)
 {
   LWIP_ERROR("netbuf_alloc: invalid buf", (buf != NULL), return NULL;);
 
@@ -148,7 +148,7 @@ netbuf_free(struct netbuf *buf)
  *         ERR_MEM if data couldn't be referenced due to lack of memory
  */
 err_t
-netbuf_ref(struct netbuf *buf, const void *dataptr, u16_t size)
+netbuf_ref(struct netbuf *buf, const void *dataptr, pbuf_len_t size)
 {
   LWIP_ERROR("netbuf_ref: invalid buf", (buf != NULL), return ERR_ARG;);
   if (buf->p != NULL) {
@@ -188,12 +188,12 @@ netbuf_chain(struct netbuf *head, struct netbuf *tail)
  *
  * @param buf netbuf to get the data from
  * @param dataptr pointer to a void pointer where to store the data pointer
- * @param len pointer to an u16_t where the length of the data is stored
+ * @param len pointer to a pbuf_len_t where the length of the data is stored
  * @return ERR_OK if the information was retrieved,
  *         ERR_BUF on error.
  */
 err_t
-netbuf_data(struct netbuf *buf, void **dataptr, u16_t *len)
+netbuf_data(struct netbuf *buf, void **dataptr, pbuf_len_t *len)
 {
   LWIP_ERROR("netbuf_data: invalid buf", (buf != NULL), return ERR_ARG;);
   LWIP_ERROR("netbuf_data: invalid dataptr", (dataptr != NULL), return ERR_ARG;);
@@ -274,7 +274,10 @@ struct lwip_socket_multicast_pair {
   ip4_addr_t multi_addr;
 };
 
+#if !LWIP_SOCKET_DYNAMIC
 static struct lwip_socket_multicast_pair socket_ipv4_multicast_memberships[LWIP_SOCKET_MAX_MEMBERSHIPS];
+#define LWIP_SOCKET_IPV4_MEMBERSHIP(i) (&socket_ipv4_multicast_memberships[i])
+#endif /* !LWIP_SOCKET_DYNAMIC */
 
 static int  lwip_socket_register_membership(int s, const ip4_addr_t *if_addr, const ip4_addr_t *multi_addr);
 static void lwip_socket_unregister_membership(int s, const ip4_addr_t *if_addr, const ip4_addr_t *multi_addr);
@@ -293,16 +296,53 @@ struct lwip_socket_multicast_mld6_pair {
   ip6_addr_t multi_addr;
 };
 
+#if !LWIP_SOCKET_DYNAMIC
 static struct lwip_socket_multicast_mld6_pair socket_ipv6_multicast_memberships[LWIP_SOCKET_MAX_MEMBERSHIPS];
+#define LWIP_SOCKET_IPV6_MEMBERSHIP(i) (&socket_ipv6_multicast_memberships[i])
+#endif /* !LWIP_SOCKET_DYNAMIC */
 
 static int  lwip_socket_register_mld6_membership(int s, unsigned int if_idx, const ip6_addr_t *multi_addr);
 static void lwip_socket_unregister_mld6_membership(int s, unsigned int if_idx, const ip6_addr_t *multi_addr);
 static void lwip_socket_drop_registered_mld6_memberships(int s);
 #endif /* LWIP_IPV6_MLD */
 
+#if LWIP_SOCKET_DYNAMIC
+/** A chunk of the socket table, allocated when first needed. Chunks are
+ * never freed so that socket pointers stay valid. */
+struct lwip_socket_chunk {
+  struct lwip_sock sockets[LWIP_SOCKET_CHUNK_SIZE];
+#if LWIP_IGMP
+  struct lwip_socket_multicast_pair ipv4_memberships[LWIP_SOCKET_CHUNK_SIZE];
+#endif /* LWIP_IGMP */
+#if LWIP_IPV6_MLD
+  struct lwip_socket_multicast_mld6_pair ipv6_memberships[LWIP_SOCKET_CHUNK_SIZE];
+#endif /* LWIP_IPV6_MLD */
+};
+
+#define LWIP_SOCKET_NUM_CHUNKS ((NUM_SOCKETS + LWIP_SOCKET_CHUNK_SIZE - 1) / LWIP_SOCKET_CHUNK_SIZE)
+
+/** The socket table: chunks 0..socket_num_chunks-1 are allocated */
+static struct lwip_socket_chunk *socket_chunks[LWIP_SOCKET_NUM_CHUNKS];
+static int socket_num_chunks;
+
+#define LWIP_SOCKET_AT(idx) (&socket_chunks[(idx) / LWIP_SOCKET_CHUNK_SIZE]->sockets[(idx) % LWIP_SOCKET_CHUNK_SIZE])
+/* memberships grow with the socket table */
+#define LWIP_SOCKET_NUM_MEMBERSHIPS (socket_num_chunks * LWIP_SOCKET_CHUNK_SIZE)
+#define LWIP_SOCKET_IPV4_MEMBERSHIP(i) (&socket_chunks[(i) / LWIP_SOCKET_CHUNK_SIZE]->ipv4_memberships[(i) % LWIP_SOCKET_CHUNK_SIZE])
+#define LWIP_SOCKET_IPV6_MEMBERSHIP(i) (&socket_chunks[(i) / LWIP_SOCKET_CHUNK_SIZE]->ipv6_memberships[(i) % LWIP_SOCKET_CHUNK_SIZE])
+#else /* LWIP_SOCKET_DYNAMIC */
 /** The global array of available sockets */
 static struct lwip_sock sockets[NUM_SOCKETS];
 
+#define LWIP_SOCKET_AT(idx) (&sockets[idx])
+#define LWIP_SOCKET_NUM_MEMBERSHIPS LWIP_SOCKET_MAX_MEMBERSHIPS
+#endif /* LWIP_SOCKET_DYNAMIC */
+
+/** Top of the stack of free socket indices (linked via lwip_sock.free_next) */
+static int socket_free_top = -1;
+/** Sockets at or above this index have never been used */
+static int socket_high_water;
+
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 #if LWIP_TCPIP_CORE_LOCKING
 /* protect the select_cb_list using core lock */
@@ -322,9 +362,46 @@ static volatile int select_cb_ctr;
 static struct lwip_select_cb *select_cb_list;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** Description of one epoll instance */
+struct lwip_epoll {
+  /** LWIP_EPOLL_USED if this instance has been allocated by lwip_epoll_create */
+  u8_t used;
+  /** don't signal the semaphore twice: set to 1 when signalled */
+  u8_t sem_signalled;
+  /** number of threads waiting in lwip_epoll_wait */
+  SELWAIT_T waiting;
+  /** first registration with pending events */
+  struct lwip_epoll_item *ready_head;
+  /** last registration with pending events */
+  struct lwip_epoll_item *ready_tail;
+  /** semaphore to wake up tasks waiting in lwip_epoll_wait */
+  sys_sem_t sem;
+};
+
+/** lwip_epoll.used: allocated, the descriptor is valid */
+#define LWIP_EPOLL_USED     1
+/** lwip_epoll.used: being closed, not reused before the semaphore is freed */
+#define LWIP_EPOLL_CLOSING  2
+
+/** epoll descriptors are numbered after the socket descriptors */
+#define LWIP_EPOLL_OFFSET (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+#define LWIP_EPOLL_IS_FD(fd) (((fd) >= LWIP_EPOLL_OFFSET) && ((fd) < (LWIP_EPOLL_OFFSET + LWIP_SOCKET_EPOLL_MAX)))
+
+/** The global array of epoll instances */
+static struct lwip_epoll epolls[LWIP_SOCKET_EPOLL_MAX];
+#endif /* LWIP_SOCKET_EPOLL */
+
 /* Forward declaration of some functions */
+#if LWIP_SOCKET_EPOLL
+static int lwip_epoll_close(int epfd);
+static void lwip_epoll_drop_sock(struct lwip_sock *sock);
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_ZEROCOPY
+static void lwip_zc_detach(struct lwip_sock *sock);
+#endif /* LWIP_SOCKET_ZEROCOPY */
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
-static void event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len);
+static void event_callback(struct netconn *conn, enum netconn_evt evt, pbuf_len_t len);
 #define DEFAULT_SOCKET_EVENTCB event_callback
 static void select_check_waiters(int s, int has_recvevent, int has_sendevent, int has_errevent);
 #else
@@ -454,7 +531,13 @@ tryget_socket_unconn_nouse(int fd)
     LWIP_DEBUGF(SOCKETS_DEBUG, ("tryget_socket_unconn(%d): invalid\n", fd));
     return NULL;
   }
-  return &sockets[s];
+#if LWIP_SOCKET_DYNAMIC
+  if (socket_chunks[s / LWIP_SOCKET_CHUNK_SIZE] == NULL) {
+    /* never allocated, so never used */
+    return NULL;
+  }
+#endif /* LWIP_SOCKET_DYNAMIC */
+  return LWIP_SOCKET_AT(s);
 }
 
 struct lwip_sock *
@@ -528,8 +611,50 @@ get_socket(int fd)
   return sock;
 }
 
+#if LWIP_SOCKET_DYNAMIC
+/** Add a chunk to the socket table if all allocated sockets have been used.
+ * Called without SYS_ARCH_PROTECT held.
+ *
+ * @return 1 if the table can provide a never used socket now, 0 if not
+ */
+static int
+lwip_socket_grow(void)
+{
+  struct lwip_socket_chunk *chunk;
+  int ret;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  chunk = (struct lwip_socket_chunk *)LWIP_SOCKET_CHUNK_MALLOC(sizeof(struct lwip_socket_chunk));
+  if (chunk == NULL) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_socket_grow: out of memory\n"));
+    return 0;
+  }
+  memset(chunk, 0, sizeof(struct lwip_socket_chunk));
+
+  SYS_ARCH_PROTECT(lev);
+  if (socket_high_water < socket_num_chunks * LWIP_SOCKET_CHUNK_SIZE) {
+    /* another thread has grown the table in the meantime */
+    ret = 1;
+  } else if (socket_num_chunks < LWIP_SOCKET_NUM_CHUNKS) {
+    socket_chunks[socket_num_chunks++] = chunk;
+    chunk = NULL;
+    ret = 1;
+  } else {
+    ret = 0;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  if (chunk != NULL) {
+    LWIP_SOCKET_CHUNK_FREE(chunk);
+  }
+  return ret;
+}
+#endif /* LWIP_SOCKET_DYNAMIC */
+
 /**
  * Allocate a new socket for a given netconn.
+ * Recently freed sockets are reused first (free-index stack), then sockets
+ * that have never been used. No search over the socket table is needed.
  *
  * @param newconn the netconn for which to allocate a socket
  * @param accepted 1 if socket has been created by accept(),
@@ -540,40 +665,69 @@ static int
 alloc_socket(struct netconn *newconn, int accepted)
 {
   int i;
+  struct lwip_sock *sock;
   SYS_ARCH_DECL_PROTECT(lev);
   LWIP_UNUSED_ARG(accepted);
 
-  /* allocate a new socket identifier */
-  for (i = 0; i < NUM_SOCKETS; ++i) {
-    /* Protect socket array */
-    SYS_ARCH_PROTECT(lev);
-    if (!sockets[i].conn) {
-#if LWIP_NETCONN_FULLDUPLEX
-      if (sockets[i].fd_used) {
-        SYS_ARCH_UNPROTECT(lev);
-        continue;
+  /* Protect socket array */
+  SYS_ARCH_PROTECT(lev);
+#if LWIP_SOCKET_DYNAMIC
+again:
+#endif /* LWIP_SOCKET_DYNAMIC */
+  if (socket_free_top >= 0) {
+    i = socket_free_top;
+    sock = LWIP_SOCKET_AT(i);
+    socket_free_top = sock->free_next;
+  } else {
+#if LWIP_SOCKET_DYNAMIC
+    if ((socket_high_water < NUM_SOCKETS) &&
+        (socket_high_water >= socket_num_chunks * LWIP_SOCKET_CHUNK_SIZE)) {
+      /* all allocated sockets are in use: add a chunk */
+      SYS_ARCH_UNPROTECT(lev);
+      if (!lwip_socket_grow()) {
+        return -1;
       }
-      sockets[i].fd_used    = 1;
-      sockets[i].fd_free_pending = 0;
-#endif
-      sockets[i].conn       = newconn;
-      /* The socket is not yet known to anyone, so no need to protect
-         after having marked it as used. */
+      SYS_ARCH_PROTECT(lev);
+      /* a socket might have been freed in the meantime */
+      goto again;
+    }
+#endif /* LWIP_SOCKET_DYNAMIC */
+    if (socket_high_water >= NUM_SOCKETS) {
       SYS_ARCH_UNPROTECT(lev);
-      sockets[i].lastdata.pbuf = NULL;
-#if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
-      LWIP_ASSERT("sockets[i].select_waiting == 0", sockets[i].select_waiting == 0);
-      sockets[i].rcvevent   = 0;
-      /* TCP sendbuf is empty, but the socket is not yet writable until connected
-       * (unless it has been created by accept()). */
-      sockets[i].sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
-      sockets[i].errevent   = 0;
-#endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
-      return i + LWIP_SOCKET_OFFSET;
+      return -1;
     }
-    SYS_ARCH_UNPROTECT(lev);
+    i = socket_high_water++;
+    sock = LWIP_SOCKET_AT(i);
+    sock->idx = i;
   }
-  return -1;
+  LWIP_ASSERT("sock->conn == NULL", sock->conn == NULL);
+  sock->free_next = -1;
+#if LWIP_NETCONN_FULLDUPLEX
+  /* a concurrent lookup of the free descriptor might still hold a reference,
+     so count ours on top of it */
+  sock->fd_used++;
+  sock->fd_free_pending = 0;
+#endif
+  sock->conn       = newconn;
+  /* The socket is not yet known to anyone, so no need to protect
+     after having marked it as used. */
+  SYS_ARCH_UNPROTECT(lev);
+  sock->lastdata.pbuf = NULL;
+#if LWIP_SOCKET_ZEROCOPY
+  sock->zc_head    = NULL;
+  sock->zc_tail    = NULL;
+  sock->zc_next_id = 0;
+  sock->zc_flags   = 0;
+#endif /* LWIP_SOCKET_ZEROCOPY */
+#if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
+  LWIP_ASSERT("sock->select_waiting == 0", sock->select_waiting == 0);
+  sock->rcvevent   = 0;
+  /* TCP sendbuf is empty, but the socket is not yet writable until connected
+   * (unless it has been created by accept()). */
+  sock->sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
+  sock->errevent   = 0;
+#endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+  return i + LWIP_SOCKET_OFFSET;
 }
 
 /** Free a socket (under lock)
@@ -602,6 +756,9 @@ free_socket_locked(struct lwip_sock *sock, int is_tcp, struct netconn **conn,
   sock->lastdata.pbuf = NULL;
   *conn = sock->conn;
   sock->conn = NULL;
+  /* push the index onto the free-index stack */
+  sock->free_next = socket_free_top;
+  socket_free_top = sock->idx;
   return 1;
 }
 
@@ -697,7 +854,7 @@ lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen)
     return -1;
   }
   LWIP_ASSERT("invalid socket index", (newsock >= LWIP_SOCKET_OFFSET) && (newsock < NUM_SOCKETS + LWIP_SOCKET_OFFSET));
-  nsock = &sockets[newsock - LWIP_SOCKET_OFFSET];
+  nsock = tryget_socket_unconn_nouse(newsock);
 
   /* See event_callback: If data comes in right away after an accept, even
    * though the server task might not have created a new socket yet.
@@ -815,6 +972,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (LWIP_EPOLL_IS_FD(s)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -842,6 +1005,15 @@ lwip_close(int s)
     return -1;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* remove the socket from all epoll interest sets */
+  lwip_epoll_drop_sock(sock);
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_ZEROCOPY
+  /* pending MSG_ZEROCOPY completions have no one to be reported to any more */
+  lwip_zc_detach(sock);
+#endif /* LWIP_SOCKET_ZEROCOPY */
+
   free_socket(sock, is_tcp);
   set_errno(0);
   return 0;
@@ -971,7 +1143,7 @@ lwip_recv_tcp(struct lwip_sock *sock, void *mem, size_t len, int flags)
   do {
     struct pbuf *p;
     err_t err;
-    u16_t copylen;
+    pbuf_len_t copylen;
 
     LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recv_tcp: top while sock->lastdata=%p\n", (void *)sock->lastdata.pbuf));
     /* Check if there is data left from the last recv operation. */
@@ -1004,17 +1176,17 @@ lwip_recv_tcp(struct lwip_sock *sock, void *mem, size_t len, int flags)
       sock->lastdata.pbuf = p;
     }
 
-    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recv_tcp: buflen=%"U16_F" recv_left=%d off=%d\n",
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recv_tcp: buflen=%"PBUFLEN_F" recv_left=%d off=%d\n",
                                 p->tot_len, (int)recv_left, (int)recvd));
 
     if (recv_left > p->tot_len) {
       copylen = p->tot_len;
     } else {
-      copylen = (u16_t)recv_left;
+      copylen = (pbuf_len_t)recv_left;
     }
     if (recvd + copylen < recvd) {
       /* overflow */
-      copylen = (u16_t)(SSIZE_MAX - recvd);
+      copylen = (pbuf_len_t)(SSIZE_MAX - recvd);
     }
 
     /* copy the contents of the received buffer into
@@ -1156,7 +1328,7 @@ lwip_recvfrom_udp_raw(struct lwip_sock *sock, int flags, struct msghdr *msg, u16
     LWIP_ASSERT("buf != NULL", buf != NULL);
     sock->lastdata.netbuf = buf;
   }
-  buflen = buf->p->tot_len;
+  buflen = (u16_t)buf->p->tot_len;
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvfrom_udp_raw: buflen=%"U16_F"\n", buflen));
 
   copied = 0;
@@ -1315,15 +1487,102 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+/* Helper function to check the IO vectors passed to recvmsg.
+ * Returns 1 and stores the total length in *buflen_out if all vectors are valid.
+ */
+static int
+lwip_recvmsg_check_iovs(const struct msghdr *message, ssize_t *buflen_out)
+{
+  msg_iovlen_t i;
+  ssize_t buflen = 0;
+
+  for (i = 0; i < message->msg_iovlen; i++) {
+    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
+        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
+        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
+      return 0;
+    }
+    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  }
+  *buflen_out = buflen;
+  return 1;
+}
+
+#if LWIP_SOCKET_ZEROCOPY
+/* Helper function for lwip_recvmsg(MSG_ERRQUEUE): reports the MSG_ZEROCOPY
+ * sends completed since the last call as one struct sock_extended_err.
+ * Never blocks; fails with EAGAIN if nothing has completed.
+ */
+static ssize_t
+lwip_recvmsg_errqueue(struct lwip_sock *sock, struct msghdr *message)
+{
+  struct sock_extended_err ee;
+  struct cmsghdr *chdr;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  message->msg_flags = MSG_ERRQUEUE;
+  SYS_ARCH_PROTECT(lev);
+  if ((sock->zc_flags & LWIP_SOCK_ZC_DONE) == 0) {
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EAGAIN);
+    return -1;
+  }
+  if ((message->msg_control == NULL) ||
+      (message->msg_controllen < CMSG_SPACE(sizeof(struct sock_extended_err)))) {
+    /* keep the notification for a call with enough buffer space */
+    SYS_ARCH_UNPROTECT(lev);
+    message->msg_flags |= MSG_CTRUNC;
+    message->msg_controllen = 0;
+    return 0;
+  }
+  memset(&ee, 0, sizeof(ee));
+  ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+  ee.ee_code = (sock->zc_flags & LWIP_SOCK_ZC_COPIED) ? SO_EE_CODE_ZEROCOPY_COPIED : 0;
+  ee.ee_info = sock->zc_lo;
+  ee.ee_data = sock->zc_hi;
+  sock->zc_flags = 0;
+  SYS_ARCH_UNPROTECT(lev);
+
+  chdr = CMSG_FIRSTHDR(message);
+#if LWIP_IPV6
+  if (NETCONNTYPE_ISIPV6(netconn_type(sock->conn))) {
+    chdr->cmsg_level = IPPROTO_IPV6;
+    chdr->cmsg_type = IPV6_RECVERR;
+  } else
+#endif /* LWIP_IPV6 */
+  {
+    chdr->cmsg_level = IPPROTO_IP;
+    chdr->cmsg_type = IP_RECVERR;
+  }
+  chdr->cmsg_len = CMSG_LEN(sizeof(struct sock_extended_err));
+  MEMCPY(CMSG_DATA(chdr), &ee, sizeof(ee));
+  message->msg_controllen = CMSG_SPACE(sizeof(struct sock_extended_err));
+  set_errno(0);
+  return 0;
+}
+#endif /* LWIP_SOCKET_ZEROCOPY */
+
 ssize_t
 lwip_recvmsg(int s, struct msghdr *message, int flags)
 {
   struct lwip_sock *sock;
-  msg_iovlen_t i;
   ssize_t buflen;
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg(%d, message=%p, flags=0x%x)\n", s, (void *)message, flags));
   LWIP_ERROR("lwip_recvmsg: invalid message pointer", message != NULL, return ERR_ARG;);
+#if LWIP_SOCKET_ZEROCOPY
+  if (flags & MSG_ERRQUEUE) {
+    LWIP_ERROR("lwip_recvmsg: unsupported flags", (flags & ~(MSG_ERRQUEUE|MSG_DONTWAIT)) == 0,
+               set_errno(EOPNOTSUPP); return -1;);
+    sock = get_socket(s);
+    if (!sock) {
+      return -1;
+    }
+    buflen = lwip_recvmsg_errqueue(sock, message);
+    done_socket(sock);
+    return buflen;
+  }
+#endif /* LWIP_SOCKET_ZEROCOPY */
   LWIP_ERROR("lwip_recvmsg: unsupported flags", (flags & ~(MSG_PEEK|MSG_DONTWAIT)) == 0,
              set_errno(EOPNOTSUPP); return -1;);
 
@@ -1338,21 +1597,16 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
   }
 
   /* check for valid vectors */
-  buflen = 0;
-  for (i = 0; i < message->msg_iovlen; i++) {
-    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
-        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
-        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
-      set_errno(err_to_errno(ERR_VAL));
-      done_socket(sock);
-      return -1;
-    }
-    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  if (!lwip_recvmsg_check_iovs(message, &buflen)) {
+    set_errno(err_to_errno(ERR_VAL));
+    done_socket(sock);
+    return -1;
   }
 
   if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
 #if LWIP_TCP
     int recv_flags = flags;
+    msg_iovlen_t i;
     message->msg_flags = 0;
     /* recv the data */
     buflen = 0;
@@ -1416,6 +1670,183 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
 #endif /* LWIP_UDP || LWIP_RAW */
 }
 
+#if LWIP_SOCKET_ZEROCOPY
+/* Free a list of MSG_ZEROCOPY sends linked via 'next' */
+static void
+lwip_zc_free_sends(struct lwip_zc_send *send)
+{
+  while (send != NULL) {
+    struct lwip_zc_send *next = send->next;
+    memp_free(MEMP_SOCKET_ZC_SEND, send);
+    send = next;
+  }
+}
+
+/* Move the completed sends from the head of a socket's list to the range
+ * reported by MSG_ERRQUEUE. Sends complete in id order (a send finishing
+ * early waits for its predecessors), so the range stays contiguous.
+ * Must be called with SYS_ARCH_PROTECT held.
+ *
+ * @return the sends taken off the list, to be freed after unprotecting
+ */
+static struct lwip_zc_send *
+lwip_zc_collect_locked(struct lwip_sock *sock)
+{
+  struct lwip_zc_send *collected = NULL;
+
+  while ((sock->zc_head != NULL) && sock->zc_head->done) {
+    struct lwip_zc_send *send = sock->zc_head;
+    sock->zc_head = send->next;
+    if (sock->zc_flags & LWIP_SOCK_ZC_DONE) {
+      LWIP_ASSERT("zerocopy ids not contiguous", send->id == (u32_t)(sock->zc_hi + 1));
+    } else {
+      sock->zc_lo = send->id;
+      sock->zc_flags = LWIP_SOCK_ZC_DONE;
+    }
+    sock->zc_hi = send->id;
+    if (!send->referenced) {
+      sock->zc_flags |= LWIP_SOCK_ZC_COPIED;
+    }
+    send->next = collected;
+    collected = send;
+  }
+  if (sock->zc_head == NULL) {
+    sock->zc_tail = NULL;
+  }
+  return collected;
+}
+
+/* Drop one reference to a MSG_ZEROCOPY send, reporting it if it was the last */
+static void
+lwip_zc_send_unref(struct lwip_zc_send *send)
+{
+  struct lwip_zc_send *to_free = NULL;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  LWIP_ASSERT("send->refs > 0", send->refs > 0);
+  send->refs--;
+  if (send->refs == 0) {
+    send->done = 1;
+    if (send->sock != NULL) {
+      to_free = lwip_zc_collect_locked(send->sock);
+    } else {
+      /* not queued (send failed) or socket closed: nothing to report */
+      to_free = send;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  lwip_zc_free_sends(to_free);
+}
+
+/* pbuf_custom free function: the stack does not reference the data any more */
+static void
+lwip_zc_pbuf_free(struct pbuf *p)
+{
+  struct lwip_zc_pbuf *zp = (struct lwip_zc_pbuf *)p;
+  struct lwip_zc_send *send = zp->send;
+
+  memp_free(MEMP_SOCKET_ZC_PBUF, zp);
+  lwip_zc_send_unref(send);
+}
+
+/* tcp_ref_pbuf_fn for MSG_ZEROCOPY: reference the data through a pbuf_custom */
+static struct pbuf *
+lwip_zc_pbuf_alloc(void *arg, const void *dataptr, u16_t len)
+{
+  struct lwip_zc_send *send = (struct lwip_zc_send *)arg;
+  struct lwip_zc_pbuf *zp;
+  struct pbuf *p;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  zp = (struct lwip_zc_pbuf *)memp_malloc(MEMP_SOCKET_ZC_PBUF);
+  if (zp == NULL) {
+    return NULL;
+  }
+  zp->pc.custom_free_function = lwip_zc_pbuf_free;
+  zp->send = send;
+  p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_ROM, &zp->pc, LWIP_CONST_CAST(void *, dataptr), len);
+  LWIP_ASSERT("pbuf_alloced_custom failed", p != NULL);
+
+  SYS_ARCH_PROTECT(lev);
+  send->refs++;
+  send->referenced = 1;
+  SYS_ARCH_UNPROTECT(lev);
+  return p;
+}
+
+/* Write on a TCP socket with MSG_ZEROCOPY. If any data has been enqueued,
+ * the send gets the socket's next id, which is reported via MSG_ERRQUEUE once
+ * the stack has released all references to the data. This includes writes
+ * failing after part of the data has been enqueued: that part still
+ * references the application's buffer.
+ */
+static err_t
+lwip_send_zerocopy(struct lwip_sock *sock, struct netvector *vectors, u16_t vectorcnt,
+                   u8_t write_flags, size_t *written)
+{
+  struct lwip_zc_send *send;
+  err_t err;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  send = (struct lwip_zc_send *)memp_malloc(MEMP_SOCKET_ZC_SEND);
+  if (send == NULL) {
+    return ERR_BUF;
+  }
+  send->next = NULL;
+  send->sock = NULL;
+  send->id = 0;
+  /* our own reference prevents completion while data is being enqueued */
+  send->refs = 1;
+  send->done = 0;
+  send->referenced = 0;
+
+  err = netconn_write_vectors_ref(sock->conn, vectors, vectorcnt, (u8_t)(write_flags & ~NETCONN_COPY),
+                                  written, lwip_zc_pbuf_alloc, send);
+  if (*written > 0) {
+    SYS_ARCH_PROTECT(lev);
+    send->id = sock->zc_next_id++;
+    send->sock = sock;
+    if (sock->zc_tail != NULL) {
+      sock->zc_tail->next = send;
+    } else {
+      sock->zc_head = send;
+    }
+    sock->zc_tail = send;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  lwip_zc_send_unref(send);
+  return err;
+}
+
+/* Called from lwip_close(): pending sends are not reported any more */
+static void
+lwip_zc_detach(struct lwip_sock *sock)
+{
+  struct lwip_zc_send *send, *next, *to_free = NULL;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  for (send = sock->zc_head; send != NULL; send = next) {
+    next = send->next;
+    if (send->done) {
+      /* completed, but waiting for a predecessor */
+      send->next = to_free;
+      to_free = send;
+    } else {
+      /* freed by lwip_zc_send_unref() when the last pbuf is released */
+      send->sock = NULL;
+      send->next = NULL;
+    }
+  }
+  sock->zc_head = NULL;
+  sock->zc_tail = NULL;
+  sock->zc_flags = 0;
+  SYS_ARCH_UNPROTECT(lev);
+  lwip_zc_free_sends(to_free);
+}
+#endif /* LWIP_SOCKET_ZEROCOPY */
+
 ssize_t
 lwip_send(int s, const void *data, size_t size, int flags)
 {
@@ -1447,7 +1878,17 @@ lwip_send(int s, const void *data, size_t size, int flags)
                        ((flags & MSG_MORE)     ? NETCONN_MORE      : 0) |
                        ((flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0));
   written = 0;
-  err = netconn_write_partly(sock->conn, data, size, write_flags, &written);
+#if LWIP_SOCKET_ZEROCOPY
+  if (flags & MSG_ZEROCOPY) {
+    struct netvector vector;
+    vector.ptr = data;
+    vector.len = size;
+    err = lwip_send_zerocopy(sock, &vector, 1, write_flags, &written);
+  } else
+#endif /* LWIP_SOCKET_ZEROCOPY */
+  {
+    err = netconn_write_partly(sock->conn, data, size, write_flags, &written);
+  }
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_send(%d) err=%d written=%"SZT_F"\n", s, err, written));
   set_errno(err_to_errno(err));
@@ -1456,6 +1897,119 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (ssize_t)written : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/**
+ * Helper function to assemble a netbuf from the IO vectors and destination
+ * of a msghdr for sending on a UDP or RAW netconn.
+ *
+ * @param msg the message to send
+ * @param chain_buf the netbuf to fill (must be freed by the caller on success)
+ * @param size_out the number of bytes to send is stored here
+ * @return 0 on success, an errno value on failure (chain_buf is freed then)
+ */
+static int
+lwip_sendmsg_udp_raw_netbuf(const struct msghdr *msg, struct netbuf *chain_buf, ssize_t *size_out)
+{
+  msg_iovlen_t i;
+  ssize_t size = 0;
+  err_t err = ERR_OK;
+
+  LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
+             IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
+             return err_to_errno(ERR_ARG););
+
+  /* initialize chain buffer with destination */
+  memset(chain_buf, 0, sizeof(struct netbuf));
+  if (msg->msg_name) {
+    u16_t remote_port;
+    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf->addr, remote_port);
+    netbuf_fromport(chain_buf) = remote_port;
+  }
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    size += msg->msg_iov[i].iov_len;
+    if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
+      /* overflow */
+      goto emsgsize;
+    }
+  }
+  if (size > 0xFFFF) {
+    /* overflow */
+    goto emsgsize;
+  }
+  /* Allocate a new netbuf and copy the data into it. */
+  if (netbuf_alloc(chain_buf, (u16_t)size) == NULL) {
+    err = ERR_MEM;
+  } else {
+    /* flatten the IO vectors */
+    size_t offset = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      MEMCPY(&((u8_t *)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      offset += msg->msg_iov[i].iov_len;
+    }
+#if LWIP_CHECKSUM_ON_COPY
+    {
+      /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
+      u16_t chksum = ~inet_chksum_pbuf(chain_buf->p);
+      netbuf_set_chksum(chain_buf, chksum);
+    }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+    err = ERR_OK;
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
+     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p;
+    if (msg->msg_iov[i].iov_len > 0xFFFF) {
+      /* overflow */
+      goto emsgsize;
+    }
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
+      break;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    /* netbuf empty, add new pbuf */
+    if (chain_buf->p == NULL) {
+      chain_buf->p = chain_buf->ptr = p;
+      /* add pbuf to existing pbuf chain */
+    } else {
+      if (chain_buf->p->tot_len + p->len > 0xffff) {
+        /* overflow */
+        pbuf_free(p);
+        goto emsgsize;
+      }
+      pbuf_cat(chain_buf->p, p);
+    }
+  }
+  /* save size of total chain */
+  if (err == ERR_OK) {
+    size = netbuf_len(chain_buf);
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+
+  if (err != ERR_OK) {
+    netbuf_free(chain_buf);
+    return err_to_errno(err);
+  }
+#if LWIP_IPV4 && LWIP_IPV6
+  /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
+  if (IP_IS_V6_VAL(chain_buf->addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf->addr))) {
+    unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf->addr), ip_2_ip6(&chain_buf->addr));
+    IP_SET_TYPE_VAL(chain_buf->addr, IPADDR_TYPE_V4);
+  }
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+  *size_out = size;
+  return 0;
+emsgsize:
+  netbuf_free(chain_buf);
+  return EMSGSIZE;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
 ssize_t
 lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 {
@@ -1477,7 +2031,7 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
              set_errno(err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
   LWIP_ERROR("lwip_sendmsg: maximum iovs exceeded", (msg->msg_iovlen > 0) && (msg->msg_iovlen <= IOV_MAX),
              set_errno(EMSGSIZE); done_socket(sock); return -1;);
-  LWIP_ERROR("lwip_sendmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+  LWIP_ERROR("lwip_sendmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE | MSG_ZEROCOPY)) == 0,
              set_errno(EOPNOTSUPP); done_socket(sock); return -1;);
 
   LWIP_UNUSED_ARG(msg->msg_control);
@@ -1491,7 +2045,14 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
                          ((flags & MSG_DONTWAIT) ? NETCONN_DONTBLOCK : 0));
 
     written = 0;
-    err = netconn_write_vectors_partly(sock->conn, (struct netvector *)msg->msg_iov, (u16_t)msg->msg_iovlen, write_flags, &written);
+#if LWIP_SOCKET_ZEROCOPY
+    if (flags & MSG_ZEROCOPY) {
+      err = lwip_send_zerocopy(sock, (struct netvector *)msg->msg_iov, (u16_t)msg->msg_iovlen, write_flags, &written);
+    } else
+#endif /* LWIP_SOCKET_ZEROCOPY */
+    {
+      err = netconn_write_vectors_partly(sock->conn, (struct netvector *)msg->msg_iov, (u16_t)msg->msg_iovlen, write_flags, &written);
+    }
     set_errno(err_to_errno(err));
     done_socket(sock);
     /* casting 'written' to ssize_t is OK here since the netconn API limits it to SSIZE_MAX */
@@ -1506,118 +2067,212 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 #if LWIP_UDP || LWIP_RAW
   {
     struct netbuf chain_buf;
-    msg_iovlen_t i;
     ssize_t size = 0;
+    int sock_err;
 
     LWIP_UNUSED_ARG(flags);
-    LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
-               IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
-               set_errno(err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
+    sock_err = lwip_sendmsg_udp_raw_netbuf(msg, &chain_buf, &size);
+    if (sock_err != 0) {
+      set_errno(sock_err);
+      done_socket(sock);
+      return -1;
+    }
 
-    /* initialize chain buffer with destination */
-    memset(&chain_buf, 0, sizeof(struct netbuf));
-    if (msg->msg_name) {
-      u16_t remote_port;
-      SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf.addr, remote_port);
-      netbuf_fromport(&chain_buf) = remote_port;
+    /* send the data */
+    err = netconn_send(sock->conn, &chain_buf);
+
+    /* deallocated the buffer */
+    netbuf_free(&chain_buf);
+
+    set_errno(err_to_errno(err));
+    done_socket(sock);
+    return (err == ERR_OK ? size : -1);
+  }
+#else /* LWIP_UDP || LWIP_RAW */
+  set_errno(err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+#if LWIP_SOCKET_MMSG
+/**
+ * Receive several datagrams from a UDP or RAW socket with one call.
+ * Compared to calling lwip_recvmsg() in a loop, the socket is looked up and
+ * released only once for the whole batch.
+ *
+ * @param msgvec array of messages to receive into; msg_len is set to the
+ *        length of each received datagram
+ * @param vlen number of entries in msgvec
+ * @param flags MSG_DONTWAIT and/or MSG_WAITFORONE
+ * @return number of messages received or -1 on error (errno is set)
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int n;
+  int recv_flags;
+  int sock_err = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_WAITFORONE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    set_errno(EOPNOTSUPP);
+    done_socket(sock);
+    return -1;
+  }
+
+#if LWIP_UDP || LWIP_RAW
+  recv_flags = flags & MSG_DONTWAIT;
+  for (n = 0; n < vlen; n++) {
+    struct msghdr *message = &msgvec[n].msg_hdr;
+    ssize_t buflen = 0;
+    u16_t datagram_len = 0;
+    err_t err;
+
+    if ((message->msg_iovlen <= 0) || (message->msg_iovlen > IOV_MAX)) {
+      sock_err = EMSGSIZE;
+      break;
     }
-#if LWIP_NETIF_TX_SINGLE_PBUF
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      size += msg->msg_iov[i].iov_len;
-      if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
+    if (!lwip_recvmsg_check_iovs(message, &buflen)) {
+      sock_err = err_to_errno(ERR_VAL);
+      break;
     }
-    if (size > 0xFFFF) {
-      /* overflow */
-      goto sendmsg_emsgsize;
+    err = lwip_recvfrom_udp_raw(sock, recv_flags, message, &datagram_len, s);
+    if (err != ERR_OK) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg[UDP/RAW](%d): message %u: error is \"%s\"!\n",
+                                  s, n, lwip_strerr(err)));
+      sock_err = err_to_errno(err);
+      break;
     }
-    /* Allocate a new netbuf and copy the data into it. */
-    if (netbuf_alloc(&chain_buf, (u16_t)size) == NULL) {
-      err = ERR_MEM;
-    } else {
-      /* flatten the IO vectors */
-      size_t offset = 0;
-      for (i = 0; i < msg->msg_iovlen; i++) {
-        MEMCPY(&((u8_t *)chain_buf.p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
-        offset += msg->msg_iov[i].iov_len;
-      }
-#if LWIP_CHECKSUM_ON_COPY
-      {
-        /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-        u16_t chksum = ~inet_chksum_pbuf(chain_buf.p);
-        netbuf_set_chksum(&chain_buf, chksum);
-      }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-      err = ERR_OK;
+    if (datagram_len > buflen) {
+      message->msg_flags |= MSG_TRUNC;
     }
-#else /* LWIP_NETIF_TX_SINGLE_PBUF */
-    /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
-       manually to avoid having to allocate, chain, and delete a netbuf for each iov */
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      struct pbuf *p;
-      if (msg->msg_iov[i].iov_len > 0xFFFF) {
-        /* overflow */
-        goto sendmsg_emsgsize;
+    msgvec[n].msg_len = datagram_len;
+    if (flags & MSG_WAITFORONE) {
+      recv_flags |= MSG_DONTWAIT;
+    }
+  }
+#else /* LWIP_UDP || LWIP_RAW */
+  n = 0;
+  LWIP_UNUSED_ARG(recv_flags);
+  sock_err = err_to_errno(ERR_ARG);
+#endif /* LWIP_UDP || LWIP_RAW */
+  done_socket(sock);
+
+  if ((n == 0) && (sock_err != 0)) {
+    /* nothing received at all, propagate the error */
+    set_errno(sock_err);
+    return -1;
+  }
+  set_errno(0);
+  return (int)n;
+}
+
+/**
+ * Send several datagrams on a UDP or RAW socket with one call.
+ * The datagrams are passed to the tcpip_thread in batches of up to
+ * LWIP_SOCKET_MMSG_BATCH netbufs per message (or core lock acquisition).
+ * TCP sockets are handled by calling lwip_sendmsg() for each message.
+ *
+ * @param msgvec array of messages to send; msg_len is set to the number of
+ *        bytes sent for each message
+ * @param vlen number of entries in msgvec
+ * @param flags MSG_DONTWAIT and/or MSG_MORE
+ * @return number of messages sent or -1 on error (errno is set)
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int sent = 0;
+  int sock_err = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n", s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(err_to_errno(ERR_ARG)); return -1;);
+  LWIP_ERROR("lwip_sendmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+    done_socket(sock);
+    for (sent = 0; sent < vlen; sent++) {
+      ssize_t ret = lwip_sendmsg(s, &msgvec[sent].msg_hdr, flags);
+      if (ret < 0) {
+        return (sent == 0) ? -1 : (int)sent;
       }
-      p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
-      if (p == NULL) {
-        err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
+      msgvec[sent].msg_len = (unsigned int)ret;
+    }
+    return (int)sent;
+  }
+
+#if LWIP_UDP || LWIP_RAW
+  while ((sent < vlen) && (sock_err == 0)) {
+    struct netbuf bufs[LWIP_SOCKET_MMSG_BATCH];
+    struct netbuf *bufptrs[LWIP_SOCKET_MMSG_BATCH];
+    u16_t num = 0;
+    u16_t batch_sent = 0;
+    u16_t i;
+    err_t err;
+
+    /* assemble up to LWIP_SOCKET_MMSG_BATCH netbufs on the stack */
+    while ((num < LWIP_SOCKET_MMSG_BATCH) && (sent + num < vlen)) {
+      struct mmsghdr *mmsg = &msgvec[sent + num];
+      ssize_t size = 0;
+      if ((mmsg->msg_hdr.msg_iov == NULL) || (mmsg->msg_hdr.msg_iovlen <= 0) ||
+          (mmsg->msg_hdr.msg_iovlen > IOV_MAX)) {
+        sock_err = EMSGSIZE;
         break;
       }
-      p->payload = msg->msg_iov[i].iov_base;
-      p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
-      /* netbuf empty, add new pbuf */
-      if (chain_buf.p == NULL) {
-        chain_buf.p = chain_buf.ptr = p;
-        /* add pbuf to existing pbuf chain */
-      } else {
-        if (chain_buf.p->tot_len + p->len > 0xffff) {
-          /* overflow */
-          pbuf_free(p);
-          goto sendmsg_emsgsize;
-        }
-        pbuf_cat(chain_buf.p, p);
+      sock_err = lwip_sendmsg_udp_raw_netbuf(&mmsg->msg_hdr, &bufs[num], &size);
+      if (sock_err != 0) {
+        break;
       }
+      mmsg->msg_len = (unsigned int)size;
+      bufptrs[num] = &bufs[num];
+      num++;
     }
-    /* save size of total chain */
-    if (err == ERR_OK) {
-      size = netbuf_len(&chain_buf);
+    if (num == 0) {
+      break;
     }
-#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
-    if (err == ERR_OK) {
-#if LWIP_IPV4 && LWIP_IPV6
-      /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
-      if (IP_IS_V6_VAL(chain_buf.addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf.addr))) {
-        unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf.addr), ip_2_ip6(&chain_buf.addr));
-        IP_SET_TYPE_VAL(chain_buf.addr, IPADDR_TYPE_V4);
-      }
-#endif /* LWIP_IPV4 && LWIP_IPV6 */
 
-      /* send the data */
-      err = netconn_send(sock->conn, &chain_buf);
+    /* send the whole batch with one call into the core */
+    err = netconn_send_multi(sock->conn, bufptrs, num, &batch_sent);
+    for (i = 0; i < num; i++) {
+      netbuf_free(&bufs[i]);
+    }
+    sent += batch_sent;
+    if (err != ERR_OK) {
+      sock_err = err_to_errno(err);
     }
-
-    /* deallocated the buffer */
-    netbuf_free(&chain_buf);
-
-    set_errno(err_to_errno(err));
-    done_socket(sock);
-    return (err == ERR_OK ? size : -1);
-sendmsg_emsgsize:
-    set_errno(EMSGSIZE);
-    netbuf_free(&chain_buf);
-    done_socket(sock);
-    return -1;
   }
 #else /* LWIP_UDP || LWIP_RAW */
-  set_errno(err_to_errno(ERR_ARG));
-  done_socket(sock);
-  return -1;
+  sock_err = err_to_errno(ERR_ARG);
 #endif /* LWIP_UDP || LWIP_RAW */
+  done_socket(sock);
+
+  if ((sent == 0) && (sock_err != 0)) {
+    set_errno(sock_err);
+    return -1;
+  }
+  set_errno(0);
+  return (int)sent;
 }
+#endif /* LWIP_SOCKET_MMSG */
 
 ssize_t
 lwip_sendto(int s, const void *data, size_t size, int flags,
@@ -1774,7 +2429,7 @@ lwip_socket(int domain, int type, int protocol)
     return -1;
   }
   conn->callback_arg.socket = i;
-  done_socket(&sockets[i - LWIP_SOCKET_OFFSET]);
+  done_socket(tryget_socket_unconn_nouse(i));
   LWIP_DEBUGF(SOCKETS_DEBUG, ("%d\n", i));
   set_errno(0);
   return i;
@@ -2505,6 +3160,416 @@ lwip_poll_should_wake(const struct lwip_select_cb *scb, int fd, int has_recveven
 }
 #endif /* LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/* Translate an epoll descriptor into a pointer (fails if not allocated) */
+static struct lwip_epoll *
+get_epoll(int epfd)
+{
+  struct lwip_epoll *ep;
+  if (!LWIP_EPOLL_IS_FD(epfd)) {
+    LWIP_DEBUGF(SOCKETS_DEBUG, ("get_epoll(%d): invalid\n", epfd));
+    set_errno(EBADF);
+    return NULL;
+  }
+  ep = &epolls[epfd - LWIP_EPOLL_OFFSET];
+  if (ep->used != LWIP_EPOLL_USED) {
+    set_errno(EBADF);
+    return NULL;
+  }
+  return ep;
+}
+
+/* Current readiness of a socket as EPOLL* bits (called under SYS_ARCH_PROTECT) */
+static u32_t
+lwip_epoll_sock_events(const struct lwip_sock *sock)
+{
+  u32_t events = 0;
+  if ((sock->lastdata.pbuf != NULL) || (sock->rcvevent > 0)) {
+    events |= EPOLLIN;
+  }
+  if (sock->sendevent != 0) {
+    events |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    events |= EPOLLERR;
+  }
+  return events;
+}
+
+/* Events of 'item' that are reportable right now (called under SYS_ARCH_PROTECT) */
+static u32_t
+lwip_epoll_item_revents(const struct lwip_epoll_item *item)
+{
+  if (item->flags & LWIP_EPOLL_ITEM_DISARMED) {
+    return 0;
+  }
+  /* EPOLLERR is always reported, like on Linux */
+  return lwip_epoll_sock_events(item->sock) & (item->events | EPOLLERR);
+}
+
+/* Append an item to the ready list in O(1) and wake up a waiter
+   (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_ready_link(struct lwip_epoll *ep, struct lwip_epoll_item *item)
+{
+  LWIP_ASSERT("item not on ready list", (item->flags & LWIP_EPOLL_ITEM_READY) == 0);
+  item->flags |= LWIP_EPOLL_ITEM_READY;
+  item->next = NULL;
+  item->prev = ep->ready_tail;
+  if (ep->ready_tail != NULL) {
+    ep->ready_tail->next = item;
+  } else {
+    ep->ready_head = item;
+  }
+  ep->ready_tail = item;
+
+  if (ep->waiting && !ep->sem_signalled) {
+    ep->sem_signalled = 1;
+    sys_sem_signal(&ep->sem);
+  }
+}
+
+/* Remove an item from the ready list in O(1) (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_ready_unlink(struct lwip_epoll *ep, struct lwip_epoll_item *item)
+{
+  LWIP_ASSERT("item on ready list", (item->flags & LWIP_EPOLL_ITEM_READY) != 0);
+  if (item->prev != NULL) {
+    item->prev->next = item->next;
+  } else {
+    ep->ready_head = item->next;
+  }
+  if (item->next != NULL) {
+    item->next->prev = item->prev;
+  } else {
+    ep->ready_tail = item->prev;
+  }
+  item->next = item->prev = NULL;
+  item->flags &= (u8_t)~LWIP_EPOLL_ITEM_READY;
+}
+
+/* Unregister a socket from one epoll instance (called under SYS_ARCH_PROTECT) */
+static void
+lwip_epoll_item_remove(struct lwip_epoll *ep, struct lwip_epoll_item *item)
+{
+  if (item->flags & LWIP_EPOLL_ITEM_READY) {
+    lwip_epoll_ready_unlink(ep, item);
+  }
+  item->flags = 0;
+  LWIP_ASSERT("sock->epoll_refs > 0", item->sock->epoll_refs > 0);
+  item->sock->epoll_refs--;
+}
+
+/**
+ * Called by event_callback for events that may make a socket ready:
+ * queue the socket on the ready list of every epoll instance it is
+ * registered with (called under SYS_ARCH_PROTECT).
+ */
+static void
+lwip_epoll_notify(struct lwip_sock *sock)
+{
+  int i;
+  for (i = 0; i < LWIP_SOCKET_EPOLL_MAX; i++) {
+    struct lwip_epoll_item *item = &sock->epoll_items[i];
+    if ((item->flags & (LWIP_EPOLL_ITEM_REGISTERED | LWIP_EPOLL_ITEM_READY)) == LWIP_EPOLL_ITEM_REGISTERED) {
+      if (lwip_epoll_item_revents(item) != 0) {
+        lwip_epoll_ready_link(&epolls[i], item);
+      }
+    }
+  }
+}
+
+/* Remove a socket from all epoll instances (called from lwip_close) */
+static void
+lwip_epoll_drop_sock(struct lwip_sock *sock)
+{
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  for (i = 0; (i < LWIP_SOCKET_EPOLL_MAX) && (sock->epoll_refs > 0); i++) {
+    if (sock->epoll_items[i].flags & LWIP_EPOLL_ITEM_REGISTERED) {
+      lwip_epoll_item_remove(&epolls[i], &sock->epoll_items[i]);
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Create an epoll instance. The returned descriptor is closed with lwip_close().
+ *
+ * @param size ignored (as on Linux), but must be greater than zero
+ * @return epoll descriptor or -1 on error (errno is set)
+ */
+int
+lwip_epoll_create(int size)
+{
+  int i;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_ERROR("lwip_epoll_create: invalid size", size > 0, set_errno(EINVAL); return -1;);
+
+  for (i = 0; i < LWIP_SOCKET_EPOLL_MAX; i++) {
+    SYS_ARCH_PROTECT(lev);
+    if (!epolls[i].used) {
+      epolls[i].used = LWIP_EPOLL_USED;
+      SYS_ARCH_UNPROTECT(lev);
+      epolls[i].sem_signalled = 0;
+      epolls[i].waiting = 0;
+      epolls[i].ready_head = NULL;
+      epolls[i].ready_tail = NULL;
+      if (sys_sem_new(&epolls[i].sem, 0) != ERR_OK) {
+        epolls[i].used = 0;
+        set_errno(ENOMEM);
+        return -1;
+      }
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", i + LWIP_EPOLL_OFFSET));
+      set_errno(0);
+      return i + LWIP_EPOLL_OFFSET;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  set_errno(EMFILE);
+  return -1;
+}
+
+/* Free an epoll instance and drop all registrations (called from lwip_close) */
+static int
+lwip_epoll_close(int epfd)
+{
+  int i;
+  struct lwip_epoll *ep = get_epoll(epfd);
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (ep == NULL) {
+    return -1;
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ep->used != LWIP_EPOLL_USED) {
+    /* closed by another thread meanwhile */
+    SYS_ARCH_UNPROTECT(lev);
+    set_errno(EBADF);
+    return -1;
+  }
+  LWIP_ERROR("lwip_epoll_close: epoll instance still in use", ep->waiting == 0,
+             SYS_ARCH_UNPROTECT(lev); set_errno(EBUSY); return -1;);
+  /* from here on, lwip_epoll_wait() and lwip_epoll_ctl() fail with EBADF */
+  ep->used = LWIP_EPOLL_CLOSING;
+  /* only sockets that have ever been allocated can be registered */
+  for (i = 0; i < socket_high_water; i++) {
+    struct lwip_epoll_item *item = &LWIP_SOCKET_AT(i)->epoll_items[ep - epolls];
+    if (item->flags & LWIP_EPOLL_ITEM_REGISTERED) {
+      lwip_epoll_item_remove(ep, item);
+    }
+  }
+  LWIP_ASSERT("ready list empty", ep->ready_head == NULL);
+  SYS_ARCH_UNPROTECT(lev);
+
+  /* no one can wait on the semaphore any more, and the instance is not
+     reused before it is freed */
+  sys_sem_free(&ep->sem);
+  ep->used = 0;
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Add, modify or remove a socket in the interest set of an epoll instance.
+ * Supported events are EPOLLIN, EPOLLOUT and EPOLLERR (always reported),
+ * optionally combined with EPOLLET (edge-triggered) and EPOLLONESHOT.
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_epoll_item *item;
+  struct lwip_sock *sock;
+  int err = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, %d, %d)\n", epfd, op, fd));
+
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_epoll_ctl: invalid event", (op == EPOLL_CTL_DEL) || (event != NULL),
+             set_errno(EINVAL); return -1;);
+
+  sock = get_socket(fd);
+  if (sock == NULL) {
+    return -1;
+  }
+  item = &sock->epoll_items[ep - epolls];
+
+  SYS_ARCH_PROTECT(lev);
+  if (ep->used != LWIP_EPOLL_USED) {
+    /* closed by another thread meanwhile */
+    err = EBADF;
+  } else {
+    switch (op) {
+      case EPOLL_CTL_ADD:
+        if (item->flags & LWIP_EPOLL_ITEM_REGISTERED) {
+          err = EEXIST;
+          break;
+        }
+        item->sock = sock;
+        item->flags = LWIP_EPOLL_ITEM_REGISTERED;
+        sock->epoll_refs++;
+        /* fall through */
+      case EPOLL_CTL_MOD:
+        if (!(item->flags & LWIP_EPOLL_ITEM_REGISTERED)) {
+          err = ENOENT;
+          break;
+        }
+        item->events = event->events;
+        item->data = event->data;
+        item->flags &= (u8_t)~LWIP_EPOLL_ITEM_DISARMED;
+        /* report events that are already pending */
+        if (!(item->flags & LWIP_EPOLL_ITEM_READY) && (lwip_epoll_item_revents(item) != 0)) {
+          lwip_epoll_ready_link(ep, item);
+        }
+        break;
+      case EPOLL_CTL_DEL:
+        if (!(item->flags & LWIP_EPOLL_ITEM_REGISTERED)) {
+          err = ENOENT;
+          break;
+        }
+        lwip_epoll_item_remove(ep, item);
+        break;
+      default:
+        err = EINVAL;
+        break;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  done_socket(sock);
+
+  if (err != 0) {
+    set_errno(err);
+    return -1;
+  }
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Move up to 'maxevents' entries from the ready list to 'events'.
+ * Level-triggered entries that are still ready are re-queued at the tail
+ * so that they are reported again by the next call.
+ * (called under SYS_ARCH_PROTECT)
+ */
+static int
+lwip_epoll_harvest(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  int nready = 0;
+  struct lwip_epoll_item *item;
+  struct lwip_epoll_item *last = ep->ready_tail;
+
+  while ((nready < maxevents) && ((item = ep->ready_head) != NULL)) {
+    u32_t revents;
+    int was_last = (item == last);
+
+    lwip_epoll_ready_unlink(ep, item);
+    revents = lwip_epoll_item_revents(item);
+    if (revents != 0) {
+      events[nready].events = revents;
+      events[nready].data = item->data;
+      nready++;
+      if (item->events & EPOLLONESHOT) {
+        item->flags |= LWIP_EPOLL_ITEM_DISARMED;
+      } else if (!(item->events & EPOLLET)) {
+        lwip_epoll_ready_link(ep, item);
+      }
+    }
+    if (was_last) {
+      break;
+    }
+  }
+  return nready;
+}
+
+/**
+ * Wait for events on an epoll instance.
+ *
+ * @param timeout in milliseconds, 0 to poll, -1 to wait forever
+ * @return number of entries stored in 'events' or -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  int nready;
+  u32_t start = 0;
+  u32_t msectimeout;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d, %p, %d, %d)\n",
+                              epfd, (void *)events, maxevents, timeout));
+  ep = get_epoll(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_ERROR("lwip_epoll_wait: invalid events", (events != NULL) && (maxevents > 0),
+             set_errno(EINVAL); return -1;);
+
+  if (timeout > 0) {
+    start = sys_now();
+  }
+  for (;;) {
+    SYS_ARCH_PROTECT(lev);
+    if (ep->used != LWIP_EPOLL_USED) {
+      /* closed by another thread (before we were counted as waiting) */
+      SYS_ARCH_UNPROTECT(lev);
+      set_errno(EBADF);
+      return -1;
+    }
+    nready = lwip_epoll_harvest(ep, events, maxevents);
+    if ((nready > 0) || (timeout == 0)) {
+      if ((ep->ready_head != NULL) && ep->waiting && !ep->sem_signalled) {
+        /* more events pending: pass them on to the next waiter */
+        ep->sem_signalled = 1;
+        sys_sem_signal(&ep->sem);
+      }
+      SYS_ARCH_UNPROTECT(lev);
+      break;
+    }
+    if (timeout < 0) {
+      /* Wait forever */
+      msectimeout = 0;
+    } else {
+      u32_t elapsed = sys_now() - start;
+      if (elapsed >= (u32_t)timeout) {
+        SYS_ARCH_UNPROTECT(lev);
+        break;
+      }
+      msectimeout = (u32_t)timeout - elapsed;
+    }
+    ep->waiting++;
+    if (ep->waiting == 0) {
+      /* overflow - too many threads waiting */
+      ep->waiting--;
+      SYS_ARCH_UNPROTECT(lev);
+      set_errno(EBUSY);
+      return -1;
+    }
+    SYS_ARCH_UNPROTECT(lev);
+
+    sys_arch_sem_wait(&ep->sem, msectimeout);
+
+    SYS_ARCH_PROTECT(lev);
+    ep->waiting--;
+    ep->sem_signalled = 0;
+    SYS_ARCH_UNPROTECT(lev);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait: nready=%d\n", nready));
+  set_errno(0);
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
 /**
  * Callback registered in the netconn layer for each socket-netconn.
@@ -2519,7 +3584,7 @@ lwip_poll_should_wake(const struct lwip_select_cb *scb, int fd, int has_recveven
  * This requirement will be asserted in select_check_waiters()
  */
 static void
-event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
+event_callback(struct netconn *conn, enum netconn_evt evt, pbuf_len_t len)
 {
   int s, check_waiters;
   struct lwip_sock *sock;
@@ -2590,6 +3655,13 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
       break;
   }
 
+#if LWIP_SOCKET_EPOLL
+  if ((sock->epoll_refs != 0) && (evt != NETCONN_EVT_RCVMINUS) && (evt != NETCONN_EVT_SENDMINUS)) {
+    /* O(1) per registration: queue the socket on the epoll ready lists */
+    lwip_epoll_notify(sock);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   if (sock->select_waiting && check_waiters) {
     /* Save which events are active */
     int has_recvevent, has_sendevent, has_errevent;
@@ -2914,6 +3986,10 @@ lwip_sockopt_to_ipopt(int optname)
     return SOF_KEEPALIVE;
   case SO_REUSEADDR:
     return SOF_REUSEADDR;
+#if SO_REUSE_PORT
+  case SO_REUSEPORT:
+    return SOF_REUSEPORT;
+#endif /* SO_REUSE_PORT */
   default:
     LWIP_ASSERT("Unknown socket option", 0);
     return 0;
@@ -2965,6 +4041,9 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
 #if SO_REUSE
         case SO_REUSEADDR:
 #endif /* SO_REUSE */
+#if SO_REUSE_PORT
+        case SO_REUSEPORT:
+#endif /* SO_REUSE_PORT */
           if ((optname == SO_BROADCAST) &&
               (NETCONNTYPE_GROUP(sock->conn->type) != NETCONN_UDP)) {
             done_socket(sock);
@@ -3373,6 +4452,9 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
 #if SO_REUSE
         case SO_REUSEADDR:
 #endif /* SO_REUSE */
+#if SO_REUSE_PORT
+        case SO_REUSEPORT:
+#endif /* SO_REUSE_PORT */
           if ((optname == SO_BROADCAST) &&
               (NETCONNTYPE_GROUP(sock->conn->type) != NETCONN_UDP)) {
             done_socket(sock);
@@ -4040,11 +5122,12 @@ lwip_socket_register_membership(int s, const ip4_addr_t *if_addr, const ip4_addr
     return 0;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if (socket_ipv4_multicast_memberships[i].sock == NULL) {
-      socket_ipv4_multicast_memberships[i].sock = sock;
-      ip4_addr_copy(socket_ipv4_multicast_memberships[i].if_addr, *if_addr);
-      ip4_addr_copy(socket_ipv4_multicast_memberships[i].multi_addr, *multi_addr);
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_pair *m = LWIP_SOCKET_IPV4_MEMBERSHIP(i);
+    if (m->sock == NULL) {
+      m->sock = sock;
+      ip4_addr_copy(m->if_addr, *if_addr);
+      ip4_addr_copy(m->multi_addr, *multi_addr);
       done_socket(sock);
       return 1;
     }
@@ -4068,13 +5151,14 @@ lwip_socket_unregister_membership(int s, const ip4_addr_t *if_addr, const ip4_ad
     return;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if ((socket_ipv4_multicast_memberships[i].sock == sock) &&
-        ip4_addr_eq(&socket_ipv4_multicast_memberships[i].if_addr, if_addr) &&
-        ip4_addr_eq(&socket_ipv4_multicast_memberships[i].multi_addr, multi_addr)) {
-      socket_ipv4_multicast_memberships[i].sock = NULL;
-      ip4_addr_set_zero(&socket_ipv4_multicast_memberships[i].if_addr);
-      ip4_addr_set_zero(&socket_ipv4_multicast_memberships[i].multi_addr);
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_pair *m = LWIP_SOCKET_IPV4_MEMBERSHIP(i);
+    if ((m->sock == sock) &&
+        ip4_addr_eq(&m->if_addr, if_addr) &&
+        ip4_addr_eq(&m->multi_addr, multi_addr)) {
+      m->sock = NULL;
+      ip4_addr_set_zero(&m->if_addr);
+      ip4_addr_set_zero(&m->multi_addr);
       break;
     }
   }
@@ -4095,14 +5179,15 @@ lwip_socket_drop_registered_memberships(int s)
     return;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if (socket_ipv4_multicast_memberships[i].sock == sock) {
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_pair *m = LWIP_SOCKET_IPV4_MEMBERSHIP(i);
+    if (m->sock == sock) {
       ip_addr_t multi_addr, if_addr;
-      ip_addr_copy_from_ip4(multi_addr, socket_ipv4_multicast_memberships[i].multi_addr);
-      ip_addr_copy_from_ip4(if_addr, socket_ipv4_multicast_memberships[i].if_addr);
-      socket_ipv4_multicast_memberships[i].sock = NULL;
-      ip4_addr_set_zero(&socket_ipv4_multicast_memberships[i].if_addr);
-      ip4_addr_set_zero(&socket_ipv4_multicast_memberships[i].multi_addr);
+      ip_addr_copy_from_ip4(multi_addr, m->multi_addr);
+      ip_addr_copy_from_ip4(if_addr, m->if_addr);
+      m->sock = NULL;
+      ip4_addr_set_zero(&m->if_addr);
+      ip4_addr_set_zero(&m->multi_addr);
 
       netconn_join_leave_group(sock->conn, &multi_addr, &if_addr, NETCONN_LEAVE);
     }
@@ -4128,11 +5213,12 @@ lwip_socket_register_mld6_membership(int s, unsigned int if_idx, const ip6_addr_
     return 0;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if (socket_ipv6_multicast_memberships[i].sock == NULL) {
-      socket_ipv6_multicast_memberships[i].sock   = sock;
-      socket_ipv6_multicast_memberships[i].if_idx = (u8_t)if_idx;
-      ip6_addr_copy(socket_ipv6_multicast_memberships[i].multi_addr, *multi_addr);
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_mld6_pair *m = LWIP_SOCKET_IPV6_MEMBERSHIP(i);
+    if (m->sock == NULL) {
+      m->sock   = sock;
+      m->if_idx = (u8_t)if_idx;
+      ip6_addr_copy(m->multi_addr, *multi_addr);
       done_socket(sock);
       return 1;
     }
@@ -4156,13 +5242,14 @@ lwip_socket_unregister_mld6_membership(int s, unsigned int if_idx, const ip6_add
     return;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if ((socket_ipv6_multicast_memberships[i].sock   == sock) &&
-        (socket_ipv6_multicast_memberships[i].if_idx == if_idx) &&
-        ip6_addr_eq(&socket_ipv6_multicast_memberships[i].multi_addr, multi_addr)) {
-      socket_ipv6_multicast_memberships[i].sock   = NULL;
-      socket_ipv6_multicast_memberships[i].if_idx = NETIF_NO_INDEX;
-      ip6_addr_set_zero(&socket_ipv6_multicast_memberships[i].multi_addr);
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_mld6_pair *m = LWIP_SOCKET_IPV6_MEMBERSHIP(i);
+    if ((m->sock   == sock) &&
+        (m->if_idx == if_idx) &&
+        ip6_addr_eq(&m->multi_addr, multi_addr)) {
+      m->sock   = NULL;
+      m->if_idx = NETIF_NO_INDEX;
+      ip6_addr_set_zero(&m->multi_addr);
       break;
     }
   }
@@ -4183,17 +5270,18 @@ lwip_socket_drop_registered_mld6_memberships(int s)
     return;
   }
 
-  for (i = 0; i < LWIP_SOCKET_MAX_MEMBERSHIPS; i++) {
-    if (socket_ipv6_multicast_memberships[i].sock == sock) {
+  for (i = 0; i < LWIP_SOCKET_NUM_MEMBERSHIPS; i++) {
+    struct lwip_socket_multicast_mld6_pair *m = LWIP_SOCKET_IPV6_MEMBERSHIP(i);
+    if (m->sock == sock) {
       ip_addr_t multi_addr;
       u8_t if_idx;
 
-      ip_addr_copy_from_ip6(multi_addr, socket_ipv6_multicast_memberships[i].multi_addr);
-      if_idx = socket_ipv6_multicast_memberships[i].if_idx;
+      ip_addr_copy_from_ip6(multi_addr, m->multi_addr);
+      if_idx = m->if_idx;
 
-      socket_ipv6_multicast_memberships[i].sock   = NULL;
-      socket_ipv6_multicast_memberships[i].if_idx = NETIF_NO_INDEX;
-      ip6_addr_set_zero(&socket_ipv6_multicast_memberships[i].multi_addr);
+      m->sock   = NULL;
+      m->if_idx = NETIF_NO_INDEX;
+      ip6_addr_set_zero(&m->multi_addr);
 
       netconn_join_leave_group_netif(sock->conn, &multi_addr, if_idx, NETCONN_LEAVE);
     }
@@ -1070,9 +1070,9 @@ altcp_mbedtls_set_poll(struct altcp_pcb *conn, u8_t interval)
 }
 
 static void
-altcp_mbedtls_recved(struct altcp_pcb *conn, u16_t len)
+altcp_mbedtls_recved(struct altcp_pcb *conn, pbuf_len_t len)
 {
-  u16_t lower_recved;
+  pbuf_len_t lower_recved;
   altcp_mbedtls_state_t *state;
   if (conn == NULL) {
     return;
@@ -1085,10 +1085,10 @@ altcp_mbedtls_recved(struct altcp_pcb *conn, u16_t len)
     return;
   }
   lower_recved = len;
-  if (lower_recved > state->rx_passed_unrecved) {
+  if (lower_recved > (pbuf_len_t)state->rx_passed_unrecved) {
     LWIP_DEBUGF(ALTCP_MBEDTLS_DEBUG, ("bogus recved count (len > state->rx_passed_unrecved / %d / %d)",
                                       len, state->rx_passed_unrecved));
-    lower_recved = (u16_t)state->rx_passed_unrecved;
+    lower_recved = (pbuf_len_t)state->rx_passed_unrecved;
   }
   state->rx_passed_unrecved -= lower_recved;
 
@@ -439,7 +439,7 @@ altcp_proxyconnect_set_poll(struct altcp_pcb *conn, u8_t interval)
 }
 
 static void
-altcp_proxyconnect_recved(struct altcp_pcb *conn, u16_t len)
+altcp_proxyconnect_recved(struct altcp_pcb *conn, pbuf_len_t len)
 {
   altcp_proxyconnect_state_t *state;
   if (conn == NULL) {
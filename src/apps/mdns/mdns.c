@@ -1879,7 +1879,7 @@ mdns_handle_response(struct mdns_packet *pkt, struct netif *netif)
       req = mdns_lookup_request(&ans.info);
     }
     if (req && req->result_fn) {
-      u16_t offset;
+      pbuf_len_t offset;
       struct pbuf *p;
       int flags = (first ? MDNS_SEARCH_RESULT_FIRST : 0) |
           (!total_answers_left ? MDNS_SEARCH_RESULT_LAST : 0);
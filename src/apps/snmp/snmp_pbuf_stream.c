@@ -111,7 +111,7 @@ snmp_pbuf_stream_writeto(struct snmp_pbuf_stream *pbuf_stream, struct snmp_pbuf_
   while (len > 0) {
     u16_t chunk_len;
     err_t err;
-    u16_t target_offset;
+    pbuf_len_t target_offset;
     struct pbuf *pbuf = pbuf_skip(pbuf_stream->pbuf, pbuf_stream->offset, &target_offset);
 
     if ((pbuf == NULL) || (pbuf->len == 0)) {
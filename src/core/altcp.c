@@ -288,7 +288,7 @@ altcp_err(struct altcp_pcb *conn, altcp_err_fn err)
  * @see tcp_recved()
  */
 void
-altcp_recved(struct altcp_pcb *conn, u16_t len)
+altcp_recved(struct altcp_pcb *conn, pbuf_len_t len)
 {
   if (conn && conn->fns && conn->fns->recved) {
     conn->fns->recved(conn, len);
@@ -541,7 +541,7 @@ altcp_default_set_poll(struct altcp_pcb *conn, u8_t interval)
 }
 
 void
-altcp_default_recved(struct altcp_pcb *conn, u16_t len)
+altcp_default_recved(struct altcp_pcb *conn, pbuf_len_t len)
 {
   if (conn && conn->inner_conn) {
     altcp_recved(conn->inner_conn, len);
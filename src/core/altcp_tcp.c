@@ -247,7 +247,7 @@ altcp_tcp_set_poll(struct altcp_pcb *conn, u8_t interval)
 }
 
 static void
-altcp_tcp_recved(struct altcp_pcb *conn, u16_t len)
+altcp_tcp_recved(struct altcp_pcb *conn, pbuf_len_t len)
 {
   if (conn != NULL) {
     struct tcp_pcb *pcb = (struct tcp_pcb *)conn->state;
@@ -740,7 +740,7 @@ dns_skip_name(struct pbuf *p, u16_t query_idx)
       break;
     } else {
       /* Not compressed name */
-      if (offset + n >= p->tot_len) {
+      if ((u32_t)(offset + n) >= p->tot_len) {
         return 0xFFFF;
       }
       offset = (u16_t)(offset + n);
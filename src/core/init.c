@@ -172,6 +172,21 @@ PACK_STRUCT_END
 #if (LWIP_NETIF_API && (NO_SYS==1))
 #error "If you want to use NETIF API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
+#if (LWIP_PBUF_SHARED && !LWIP_SUPPORT_CUSTOM_PBUF)
+#error "LWIP_PBUF_SHARED needs LWIP_SUPPORT_CUSTOM_PBUF enabled in your lwipopts.h"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_ZEROCOPY && !(LWIP_TCP && LWIP_SUPPORT_CUSTOM_PBUF))
+#error "LWIP_SOCKET_ZEROCOPY needs LWIP_TCP and LWIP_SUPPORT_CUSTOM_PBUF enabled in your lwipopts.h"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_EPOLL && !(LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL))
+#error "LWIP_SOCKET_EPOLL needs LWIP_SOCKET_SELECT or LWIP_SOCKET_POLL enabled in your lwipopts.h"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_EPOLL && (LWIP_SOCKET_EPOLL_MAX < 1))
+#error "If you want to use LWIP_SOCKET_EPOLL, you have to define LWIP_SOCKET_EPOLL_MAX>=1 in your lwipopts.h"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_DYNAMIC && (LWIP_SOCKET_CHUNK_SIZE < 1))
+#error "If you want to use LWIP_SOCKET_DYNAMIC, you have to define LWIP_SOCKET_CHUNK_SIZE>=1 in your lwipopts.h"
+#endif
 #if ((LWIP_SOCKET || LWIP_NETCONN) && (NO_SYS==1))
 #error "If you want to use Sequential API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
@@ -187,6 +202,30 @@ PACK_STRUCT_END
 #if (((!LWIP_DHCP) || (!LWIP_ARP) || (!LWIP_ACD)) && LWIP_DHCP_DOES_ACD_CHECK)
 #error "If you want to use DHCP ACD checking, you have to define LWIP_DHCP=1, LWIP_ARP=1 and LWIP_ACD=1 in your lwipopts.h"
 #endif
+#if LWIP_ARP && ETHARP_TABLE_HASH_SIZE && ((ETHARP_TABLE_HASH_SIZE & (ETHARP_TABLE_HASH_SIZE - 1)) || (ETHARP_TABLE_HASH_SIZE > 0x8000))
+#error "ETHARP_TABLE_HASH_SIZE must be a power of 2 (at most 0x8000), you have to change it in your lwipopts.h"
+#endif
+#if LWIP_IPV6 && LWIP_ND6_CACHE_HASH_SIZE && ((LWIP_ND6_CACHE_HASH_SIZE & (LWIP_ND6_CACHE_HASH_SIZE - 1)) || (LWIP_ND6_CACHE_HASH_SIZE > 0x8000))
+#error "LWIP_ND6_CACHE_HASH_SIZE must be a power of 2 (at most 0x8000), you have to change it in your lwipopts.h"
+#endif
+#if (IP_REASSEMBLY || (LWIP_IPV6 && LWIP_IPV6_REASS)) && IP_REASS_HASH_SIZE && ((IP_REASS_HASH_SIZE & (IP_REASS_HASH_SIZE - 1)) || (IP_REASS_HASH_SIZE > 0x8000))
+#error "IP_REASS_HASH_SIZE must be a power of 2 (at most 0x8000), you have to change it in your lwipopts.h"
+#endif
+#if (IP_REASSEMBLY || (LWIP_IPV6 && LWIP_IPV6_REASS)) && IP_REASS_MAX_PBUFS_PER_SRC && !IP_REASS_HASH_SIZE
+#error "IP_REASS_MAX_PBUFS_PER_SRC needs IP_REASS_HASH_SIZE, you have to change it in your lwipopts.h"
+#endif
+#if IP_FLOW_CACHE_SIZE && ((IP_FLOW_CACHE_SIZE & (IP_FLOW_CACHE_SIZE - 1)) || (IP_FLOW_CACHE_SIZE > 0x8000))
+#error "IP_FLOW_CACHE_SIZE must be a power of 2 (at most 0x8000), you have to change it in your lwipopts.h"
+#endif
+#if IP_FLOW_CACHE_SIZE && (!LWIP_ETHERNET || !(IP_FORWARD || (LWIP_IPV6 && LWIP_IPV6_FORWARD)))
+#error "IP_FLOW_CACHE_SIZE needs LWIP_ETHERNET and IP_FORWARD or LWIP_IPV6_FORWARD, you have to change it in your lwipopts.h"
+#endif
+#if (LWIP_FIB_MAX_PATHS < 1) || (LWIP_FIB_MAX_PATHS > 255)
+#error "LWIP_FIB_MAX_PATHS must be in the range 1..255, you have to change it in your lwipopts.h"
+#endif
+#if LWIP_VLANIF && !LWIP_ETHERNET
+#error "LWIP_VLANIF needs LWIP_ETHERNET, you have to change it in your lwipopts.h"
+#endif
 #if (!LWIP_ARP && LWIP_AUTOIP)
 #error "If you want to use AUTOIP, you have to define LWIP_ARP=1 in your lwipopts.h"
 #endif
@@ -293,6 +332,21 @@ PACK_STRUCT_END
 #error "LWIP_HOOK_MEMP_AVAILABLE doesn't make sense with MEMP_MEM_MALLOC"
 #endif
 #endif /* MEMP_MEM_MALLOC */
+#if MEMP_ELASTIC && MEMP_MEM_MALLOC
+#error "MEMP_ELASTIC and MEMP_MEM_MALLOC cannot be enabled at the same time"
+#endif
+#if MEMP_ELASTIC && MEM_USE_POOLS
+#error "MEMP_ELASTIC needs a real heap and cannot be used with MEM_USE_POOLS"
+#endif
+#if MEMP_ELASTIC && (MEMP_ELASTIC_SLAB_NUM < 1)
+#error "MEMP_ELASTIC_SLAB_NUM must be at least 1"
+#endif
+#if MEMP_TELEMETRY && ((MEMP_TELEMETRY_HIST_BUCKETS < 2) || (MEMP_TELEMETRY_BURSTS < 1))
+#error "MEMP_TELEMETRY needs at least 2 histogram buckets and 1 burst"
+#endif
+#if LWIP_IPV6_FIB && (LWIP_IPV6_FIB_STRIDE != 1) && (LWIP_IPV6_FIB_STRIDE != 2) && (LWIP_IPV6_FIB_STRIDE != 4) && (LWIP_IPV6_FIB_STRIDE != 8)
+#error "LWIP_IPV6_FIB_STRIDE must be 1, 2, 4 or 8"
+#endif
 
 /* TCP sanity checks */
 #if !LWIP_DISABLE_TCP_SANITY_CHECKS
@@ -362,6 +416,9 @@ lwip_init(void)
   etharp_init();
 #endif /* LWIP_ARP */
 #endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  nd6_init();
+#endif /* LWIP_IPV6 */
 #if LWIP_RAW
   raw_init();
 #endif /* LWIP_RAW */
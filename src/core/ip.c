@@ -164,4 +164,46 @@ ip_input(struct pbuf *p, struct netif *inp)
 
 #endif /* LWIP_IPV4 && LWIP_IPV6 */
 
+#if SO_REUSE_PORT
+/**
+ * Hash the 4-tuple of the packet currently being processed (addresses are
+ * taken from ip_data, ports are passed in as found in the transport header).
+ * Used to spread flows across pcbs sharing a port via SO_REUSEPORT: all
+ * packets of one flow yield the same value, so they reach the same pcb.
+ *
+ * @param src_port transport layer source port of the current packet
+ * @param dest_port transport layer destination port of the current packet
+ * @return 32-bit flow hash
+ */
+u32_t
+ip_current_flow_hash(u16_t src_port, u16_t dest_port)
+{
+  u32_t h = ((u32_t)src_port << 16) | dest_port;
+#if LWIP_IPV6
+  if (ip_current_is_v6()) {
+    int i;
+    for (i = 0; i < 4; i++) {
+      h ^= ip6_current_src_addr()->addr[i];
+      h *= 0x9e3779b1UL;
+      h ^= ip6_current_dest_addr()->addr[i];
+      h *= 0x85ebca6bUL;
+    }
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    h ^= ip4_addr_get_u32(ip4_current_src_addr());
+    h *= 0x9e3779b1UL;
+    h ^= ip4_addr_get_u32(ip4_current_dest_addr());
+    h *= 0x85ebca6bUL;
+#endif /* LWIP_IPV4 */
+  }
+  /* final avalanche so that the low bits (used for modulo) depend on all input */
+  h ^= h >> 16;
+  h *= 0x7feb352dUL;
+  h ^= h >> 15;
+  return h;
+}
+#endif /* SO_REUSE_PORT */
+
 #endif /* LWIP_IPV4 || LWIP_IPV6 */
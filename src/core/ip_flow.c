@@ -0,0 +1,310 @@
+/**
+ * @file
+ * Flow hash and forwarding flow cache
+ *
+ * @defgroup ip_flow Flow cache
+ * @ingroup ip
+ * A cache of forwarding decisions for IP_FORWARD and LWIP_IPV6_FORWARD
+ * (@ref IP_FLOW_CACHE_SIZE).\n
+ * A flow is identified by source and destination address, protocol and the
+ * TCP/UDP ports. The first packet of a flow is forwarded as usual; the netif
+ * it leaves on and the hardware address that etharp_output() or
+ * ethip6_output() resolved for its next hop are remembered. The following
+ * packets of the flow skip route selection and ARP/ND and are handed to
+ * ethernet_output() directly.\n
+ * Only netifs using etharp_output() or ethip6_output() as their output
+ * function are cached. The whole cache is flushed whenever a forwarding
+ * decision may change: netif state and address changes, FIB routes, ARP
+ * entries being replaced or expiring, ND neighbors and routers changing.
+ * Code that changes decisions made by the routing hooks
+ * (LWIP_HOOK_IP4_ROUTE_SRC, LWIP_HOOK_ETHARP_GET_GW, LWIP_HOOK_ND6_GET_GW,
+ * ...) has to call ip_flow_flush() itself.\n
+ * The hash of a flow (ip_flow_hash()) also selects the next hop of routes
+ * with several paths (@ref LWIP_FIB_MAX_PATHS).\n
+ * To be called from TCPIP thread
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if IP_FLOW_CACHE_SIZE || (LWIP_FIB_MAX_PATHS > 1) /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip_flow.h"
+#include "lwip/ip.h"
+#include "lwip/etharp.h"
+#include "lwip/ethip6.h"
+#include "lwip/def.h"
+
+#include <string.h>
+
+#if IP_FLOW_CACHE_SIZE
+static struct ip_flow ip_flow_cache[IP_FLOW_CACHE_SIZE];
+/** set when an entry has been learned since the last flush */
+static u8_t ip_flow_used;
+
+/* The packet forwarded by the slow path whose next hop is being learned */
+static const struct ip_flow_key *ip_flow_learn_key;
+static struct netif *ip_flow_learn_netif;
+static const struct pbuf *ip_flow_learn_p;
+#endif /* IP_FLOW_CACHE_SIZE */
+
+#define IP_FLOW_HASH_MUL 0x9e3779b1UL
+
+/**
+ * Hash of a flow. The upper bits are the best mixed.
+ *
+ * @param src source address or NULL to leave it out (e.g. for the first
+ *            route lookup of a connection when the local address is not known
+ *            yet)
+ * @param dest destination address
+ * @param proto IP protocol or IPv6 next header, 0 if unknown
+ * @param sport source port (0 for protocols without ports)
+ * @param dport destination port (0 for protocols without ports)
+ * @return the hash
+ */
+u32_t
+ip_flow_hash(const ip_addr_t *src, const ip_addr_t *dest, u8_t proto, u16_t sport, u16_t dport)
+{
+  u32_t h = 0;
+
+#if LWIP_IPV6
+  if (IP_IS_V6(dest)) {
+    const ip6_addr_t *dest6 = ip_2_ip6(dest);
+    if (src != NULL) {
+      const ip6_addr_t *src6 = ip_2_ip6(src);
+      h = (src6->addr[0] ^ src6->addr[1] ^ src6->addr[2] ^ src6->addr[3]) * IP_FLOW_HASH_MUL;
+    }
+    h = (h ^ dest6->addr[0] ^ dest6->addr[1] ^ dest6->addr[2] ^ dest6->addr[3]) * IP_FLOW_HASH_MUL;
+  } else
+#endif /* LWIP_IPV6 */
+  {
+#if LWIP_IPV4
+    if (src != NULL) {
+      h = ip4_addr_get_u32(ip_2_ip4(src)) * IP_FLOW_HASH_MUL;
+    }
+    h = (h ^ ip4_addr_get_u32(ip_2_ip4(dest))) * IP_FLOW_HASH_MUL;
+#endif /* LWIP_IPV4 */
+  }
+  h = (h ^ (((u32_t)sport << 16) | dport)) * IP_FLOW_HASH_MUL;
+  h = (h ^ proto) * IP_FLOW_HASH_MUL;
+  return h;
+}
+
+/**
+ * Hash of a flow key, see ip_flow_hash().
+ */
+u32_t
+ip_flow_key_hash(const struct ip_flow_key *key)
+{
+  return ip_flow_hash(&key->src, &key->dest, key->proto, key->sport, key->dport);
+}
+
+#if IP_FLOW_CACHE_SIZE
+/** Slot of a flow in the direct-mapped cache */
+static u16_t
+ip_flow_index(const struct ip_flow_key *key)
+{
+  return (u16_t)((ip_flow_key_hash(key) >> 16) & (IP_FLOW_CACHE_SIZE - 1));
+}
+
+static int
+ip_flow_key_eq(const struct ip_flow_key *a, const struct ip_flow_key *b)
+{
+  return (a->sport == b->sport) && (a->dport == b->dport) && (a->proto == b->proto) &&
+         ip_addr_eq(&a->dest, &b->dest) && ip_addr_eq(&a->src, &b->src);
+}
+#endif /* IP_FLOW_CACHE_SIZE */
+
+#if LWIP_IPV4 || (LWIP_IPV6 && LWIP_IPV6_FORWARD)
+/** Ports of a TCP or UDP header, 0 for other protocols */
+static void
+ip_flow_key_ports(struct ip_flow_key *key, const struct pbuf *p, u16_t hlen)
+{
+  key->sport = 0;
+  key->dport = 0;
+  if ((key->proto == IP_PROTO_TCP) || (key->proto == IP_PROTO_UDP) ||
+      (key->proto == IP_PROTO_UDPLITE)) {
+    if (p->len >= (u16_t)(hlen + 4)) {
+      const u8_t *ports = (const u8_t *)p->payload + hlen;
+      key->sport = (u16_t)((ports[0] << 8) | ports[1]);
+      key->dport = (u16_t)((ports[2] << 8) | ports[3]);
+    }
+  }
+}
+#endif /* LWIP_IPV4 || (LWIP_IPV6 && LWIP_IPV6_FORWARD) */
+
+#if LWIP_IPV4
+/**
+ * Fill in the key of an IPv4 packet being forwarded or sent.
+ *
+ * @param key the key to fill in
+ * @param p the packet (p->payload points to the IP header)
+ */
+void
+ip4_flow_key(struct ip_flow_key *key, const struct pbuf *p)
+{
+  const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+
+  ip_addr_copy_from_ip4(key->src, iphdr->src);
+  ip_addr_copy_from_ip4(key->dest, iphdr->dest);
+  key->proto = IPH_PROTO(iphdr);
+  if ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0) {
+    /* fragments have no ports, keep all of them in one flow */
+    key->sport = 0;
+    key->dport = 0;
+  } else {
+    ip_flow_key_ports(key, p, IPH_HL_BYTES(iphdr));
+  }
+}
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV6 && LWIP_IPV6_FORWARD
+/**
+ * Fill in the key of the IPv6 packet being forwarded. The ports are only used
+ * if TCP or UDP immediately follows the IPv6 header.
+ *
+ * @param key the key to fill in
+ * @param p the packet (p->payload points to the IPv6 header)
+ */
+void
+ip6_flow_key(struct ip_flow_key *key, const struct pbuf *p)
+{
+  const struct ip6_hdr *ip6hdr = (const struct ip6_hdr *)p->payload;
+
+  ip_addr_copy_from_ip6(key->src, *ip6_current_src_addr());
+  ip_addr_copy_from_ip6(key->dest, *ip6_current_dest_addr());
+  key->proto = IP6H_NEXTH(ip6hdr);
+  ip_flow_key_ports(key, p, IP6_HLEN);
+}
+#endif /* LWIP_IPV6 && LWIP_IPV6_FORWARD */
+
+#if IP_FLOW_CACHE_SIZE
+/**
+ * Look up the cached forwarding decision for a flow.
+ *
+ * @param key the flow
+ * @return the cached flow or NULL if the packet has to take the slow path
+ */
+const struct ip_flow *
+ip_flow_lookup(const struct ip_flow_key *key)
+{
+  const struct ip_flow *flow = &ip_flow_cache[ip_flow_index(key)];
+
+  if ((flow->netif != NULL) && ip_flow_key_eq(&flow->key, key)) {
+    return flow;
+  }
+  return NULL;
+}
+
+/**
+ * Start learning the next hop of a flow while its packet is passed to the
+ * output function of the netif: ethernet_output() reports the hardware
+ * address it is sent to (see ip_flow_learn_hwaddr()).
+ *
+ * @param key the flow (must stay valid until ip_flow_learn_stop())
+ * @param netif the netif the packet is sent on
+ * @param p the packet
+ */
+void
+ip_flow_learn_start(const struct ip_flow_key *key, struct netif *netif, const struct pbuf *p)
+{
+  int cacheable = 0;
+
+#if LWIP_IPV4 && IP_FORWARD && LWIP_ARP
+  if (IP_IS_V4_VAL(key->dest) && (netif->output == etharp_output)) {
+    cacheable = 1;
+  }
+#endif /* LWIP_IPV4 && IP_FORWARD && LWIP_ARP */
+#if LWIP_IPV6 && LWIP_IPV6_FORWARD
+  if (IP_IS_V6_VAL(key->dest) && (netif->output_ip6 == ethip6_output)) {
+    cacheable = 1;
+  }
+#endif /* LWIP_IPV6 && LWIP_IPV6_FORWARD */
+  if (cacheable) {
+    ip_flow_learn_key = key;
+    ip_flow_learn_netif = netif;
+    ip_flow_learn_p = p;
+  }
+}
+
+/**
+ * Stop learning started by ip_flow_learn_start().
+ */
+void
+ip_flow_learn_stop(void)
+{
+  ip_flow_learn_key = NULL;
+  ip_flow_learn_netif = NULL;
+  ip_flow_learn_p = NULL;
+}
+
+/**
+ * Called by ethernet_output() for every frame: if it is the packet of a flow
+ * being learned, the hardware address is cached for the flow.
+ *
+ * @param netif the netif the frame is sent on
+ * @param p the frame
+ * @param dst the destination hardware address of the frame
+ */
+void
+ip_flow_learn_hwaddr(struct netif *netif, const struct pbuf *p, const struct eth_addr *dst)
+{
+  if ((p == ip_flow_learn_p) && (netif == ip_flow_learn_netif)) {
+    struct ip_flow *flow = &ip_flow_cache[ip_flow_index(ip_flow_learn_key)];
+
+    flow->key = *ip_flow_learn_key;
+    flow->netif = netif;
+    SMEMCPY(&flow->dhwaddr, dst, ETH_HWADDR_LEN);
+    ip_flow_used = 1;
+    ip_flow_learn_p = NULL;
+  }
+}
+
+/**
+ * @ingroup ip_flow
+ * Drop all cached forwarding decisions. Called by the stack whenever routes,
+ * netifs or neighbors change; call it when a routing hook changes its mind.
+ */
+void
+ip_flow_flush(void)
+{
+  u16_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (ip_flow_used) {
+    for (i = 0; i < IP_FLOW_CACHE_SIZE; i++) {
+      ip_flow_cache[i].netif = NULL;
+    }
+    ip_flow_used = 0;
+  }
+}
+#endif /* IP_FLOW_CACHE_SIZE */
+
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_FIB_MAX_PATHS > 1) */
@@ -53,6 +53,8 @@
 #include "lwip/dhcp.h"
 #include "lwip/autoip.h"
 #include "lwip/acd.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip_flow.h"
 #include "lwip/prot/iana.h"
 #include "netif/ethernet.h"
 
@@ -101,10 +103,30 @@ struct etharp_entry {
   struct eth_addr ethaddr;
   u16_t ctime;
   u8_t state;
+#if ETHARP_TABLE_HASH_SIZE
+  /** next entry in the same hash bucket (-1: none) */
+  s16_t hash_next;
+  /** neighbours in the LRU list of dynamic entries (-1: none) */
+  s16_t lru_prev;
+  s16_t lru_next;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 };
 
 static struct etharp_entry arp_table[ARP_TABLE_SIZE];
 
+#if ETHARP_TABLE_HASH_SIZE
+/** Number of words in the bitmap of used ARP entries */
+#define ETHARP_USED_WORDS ((ARP_TABLE_SIZE + 31) / 32)
+/** Hash buckets: index of the first entry in each chain (-1: empty) */
+static s16_t arp_hash[ETHARP_TABLE_HASH_SIZE];
+/** Dynamic entries, most recently used first (static entries are not listed) */
+static s16_t arp_lru_head, arp_lru_tail;
+/** Bitmap of entries in use, so that free entries are allocated lowest first */
+static u32_t arp_used[ETHARP_USED_WORDS];
+/** All words in arp_used below this one are full */
+static u16_t arp_free_word;
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 #if !LWIP_NETIF_HWADDRHINT
 static netif_addr_idx_t etharp_cached_entry;
 #endif /* !LWIP_NETIF_HWADDRHINT */
@@ -164,10 +186,206 @@ free_etharp_q(struct etharp_q_entry *q)
 
 #endif /* ARP_QUEUEING */
 
+#if ETHARP_TABLE_HASH_SIZE
+/**
+ * Initialize the hash index and the LRU list of the ARP table.
+ * Called from lwip_init().
+ */
+void
+etharp_init(void)
+{
+  int i;
+
+  for (i = 0; i < ETHARP_TABLE_HASH_SIZE; i++) {
+    arp_hash[i] = -1;
+  }
+  arp_lru_head = -1;
+  arp_lru_tail = -1;
+  for (i = 0; i < ETHARP_USED_WORDS; i++) {
+    arp_used[i] = 0;
+  }
+#if ARP_TABLE_SIZE % 32
+  /* the bits beyond the end of the table are never free */
+  arp_used[ETHARP_USED_WORDS - 1] = ~(((u32_t)1 << (ARP_TABLE_SIZE % 32)) - 1);
+#endif /* ARP_TABLE_SIZE % 32 */
+  arp_free_word = 0;
+}
+
+/** Hash an IP address to its bucket in arp_hash */
+static u16_t
+etharp_hash(const ip4_addr_t *ipaddr)
+{
+  u32_t h = (u32_t)(ip4_addr_get_u32(ipaddr) * 0x9E3779B1UL);
+  return (u16_t)((h ^ (h >> 16)) & (ETHARP_TABLE_HASH_SIZE - 1));
+}
+
+/**
+ * Search the hash chain of an IP address.
+ *
+ * @param ipaddr IP address to find
+ * @param netif netif the entry must belong to (NULL: any netif)
+ * @return index of the pending or stable entry, -1 if not found
+ */
+static s16_t
+etharp_hash_lookup(const ip4_addr_t *ipaddr, struct netif *netif)
+{
+  s16_t i;
+
+  LWIP_UNUSED_ARG(netif);
+
+  for (i = arp_hash[etharp_hash(ipaddr)]; i >= 0; i = arp_table[i].hash_next) {
+    if ((arp_table[i].state != ETHARP_STATE_EMPTY) &&
+        ip4_addr_eq(ipaddr, &arp_table[i].ipaddr)
+#if ETHARP_TABLE_MATCH_NETIF
+        && ((netif == NULL) || (netif == arp_table[i].netif))
+#endif /* ETHARP_TABLE_MATCH_NETIF */
+       ) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Remove an entry from the LRU list */
+static void
+etharp_lru_unlink(s16_t i)
+{
+  s16_t prev = arp_table[i].lru_prev;
+  s16_t next = arp_table[i].lru_next;
+
+  if (prev >= 0) {
+    arp_table[prev].lru_next = next;
+  } else {
+    arp_lru_head = next;
+  }
+  if (next >= 0) {
+    arp_table[next].lru_prev = prev;
+  } else {
+    arp_lru_tail = prev;
+  }
+}
+
+/** Insert an entry at the head (most recently used end) of the LRU list */
+static void
+etharp_lru_push(s16_t i)
+{
+  arp_table[i].lru_prev = -1;
+  arp_table[i].lru_next = arp_lru_head;
+  if (arp_lru_head >= 0) {
+    arp_table[arp_lru_head].lru_prev = i;
+  } else {
+    arp_lru_tail = i;
+  }
+  arp_lru_head = i;
+}
+
+/** Mark a dynamic entry as most recently used */
+static void
+etharp_lru_touch(s16_t i)
+{
+  if ((arp_lru_head != i)
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+      && (arp_table[i].state != ETHARP_STATE_STATIC)
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+     ) {
+    etharp_lru_unlink(i);
+    etharp_lru_push(i);
+  }
+}
+
+/**
+ * Choose a dynamic entry to recycle: the least recently used stable entry,
+ * else the least recently used pending entry, preferring one without
+ * queued packets.
+ *
+ * @return index of the entry, -1 if there are no dynamic entries
+ */
+static s16_t
+etharp_lru_victim(void)
+{
+  s16_t i;
+  s16_t old_pending = -1, old_queue = -1;
+
+  for (i = arp_lru_tail; i >= 0; i = arp_table[i].lru_prev) {
+    if (arp_table[i].state >= ETHARP_STATE_STABLE) {
+      return i;
+    }
+    if (arp_table[i].q == NULL) {
+      if (old_pending < 0) {
+        old_pending = i;
+      }
+    } else if (old_queue < 0) {
+      old_queue = i;
+    }
+  }
+  return (old_pending >= 0) ? old_pending : old_queue;
+}
+
+/** Get the lowest unused entry, -1 if the table is full */
+static s16_t
+etharp_alloc_index(void)
+{
+  for (; arp_free_word < ETHARP_USED_WORDS; arp_free_word++) {
+    u32_t used = arp_used[arp_free_word];
+    if (used != 0xffffffffUL) {
+      s16_t i = (s16_t)(arp_free_word * 32);
+      while (used & 1) {
+        used >>= 1;
+        i++;
+      }
+      return i;
+    }
+  }
+  return -1;
+}
+
+/** Add a new entry (with its IP address set) to the hash index and the LRU list */
+static void
+etharp_link_entry(s16_t i)
+{
+  u16_t bucket = etharp_hash(&arp_table[i].ipaddr);
+
+  arp_used[i / 32] |= (u32_t)1 << (i % 32);
+  arp_table[i].hash_next = arp_hash[bucket];
+  arp_hash[bucket] = i;
+  etharp_lru_push(i);
+}
+
+/** Remove an entry from the hash index and the LRU list */
+static void
+etharp_unlink_entry(s16_t i)
+{
+  s16_t *pi = &arp_hash[etharp_hash(&arp_table[i].ipaddr)];
+
+  while (*pi >= 0) {
+    if (*pi == i) {
+      *pi = arp_table[i].hash_next;
+      break;
+    }
+    pi = &arp_table[*pi].hash_next;
+  }
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+  if (arp_table[i].state != ETHARP_STATE_STATIC)
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+  {
+    etharp_lru_unlink(i);
+  }
+  arp_used[i / 32] &= ~((u32_t)1 << (i % 32));
+  if ((u16_t)(i / 32) < arp_free_word) {
+    arp_free_word = (u16_t)(i / 32);
+  }
+}
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 /** Clean up ARP table entries */
 static void
 etharp_free_entry(int i)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  LWIP_ASSERT("arp_table[i].state != ETHARP_STATE_EMPTY",
+              arp_table[i].state != ETHARP_STATE_EMPTY);
+  etharp_unlink_entry((s16_t)i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   /* remove from SNMP ARP index tree */
   mib2_remove_arp_entry(arp_table[i].netif, &arp_table[i].ipaddr);
   /* and empty packet queue */
@@ -177,6 +395,10 @@ etharp_free_entry(int i)
     free_etharp_q(arp_table[i].q);
     arp_table[i].q = NULL;
   }
+  if (arp_table[i].state >= ETHARP_STATE_STABLE) {
+    /* forwarded flows may use this entry */
+    ip_flow_flush();
+  }
   /* recycle entry for re-use */
   arp_table[i].state = ETHARP_STATE_EMPTY;
 #ifdef LWIP_DEBUG
@@ -197,12 +419,23 @@ etharp_free_entry(int i)
 void
 etharp_tmr(void)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  s16_t i, next;
+#else /* ETHARP_TABLE_HASH_SIZE */
   int i;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 
   LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer\n"));
   /* remove expired entries from the ARP table */
+#if ETHARP_TABLE_HASH_SIZE
+  /* static entries don't age, all others are in the LRU list */
+  for (i = arp_lru_head; i >= 0; i = next) {
+    u8_t state = arp_table[i].state;
+    next = arp_table[i].lru_next;
+#else /* ETHARP_TABLE_HASH_SIZE */
   for (i = 0; i < ARP_TABLE_SIZE; ++i) {
     u8_t state = arp_table[i].state;
+#endif /* ETHARP_TABLE_HASH_SIZE */
     if (state != ETHARP_STATE_EMPTY
 #if ETHARP_SUPPORT_STATIC_ENTRIES
         && (state != ETHARP_STATE_STATIC)
@@ -224,6 +457,13 @@ etharp_tmr(void)
         /* Reset state to stable, so that the next transmitted packet will
            re-send an ARP request. */
         arp_table[i].state = ETHARP_STATE_STABLE;
+#if IP_FLOW_CACHE_SIZE
+      } else if ((arp_table[i].state == ETHARP_STATE_STABLE) &&
+                 (arp_table[i].ctime == ARP_AGE_REREQUEST_USED_UNICAST)) {
+        /* forwarded flows have to go through etharp_output() again to
+           re-request the entry before it expires */
+        ip_flow_flush();
+#endif /* IP_FLOW_CACHE_SIZE */
       } else if (arp_table[i].state == ETHARP_STATE_PENDING) {
         /* still pending, resend an ARP query */
         etharp_request(arp_table[i].netif, &arp_table[i].ipaddr);
@@ -256,6 +496,40 @@ etharp_tmr(void)
 static s16_t
 etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  s16_t i;
+
+  /* a) look for a matching entry in the hash chain of this address */
+  if (ipaddr != NULL) {
+    i = etharp_hash_lookup(ipaddr, netif);
+    if (i >= 0) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: found matching entry %d\n", (int)i));
+      return i;
+    }
+  }
+  /* { we have no match } => try to create a new entry */
+
+  /* don't create new entry, only search? */
+  if ((flags & ETHARP_FLAG_FIND_ONLY) != 0) {
+    return (s16_t)ERR_MEM;
+  }
+
+  /* b) take the lowest unused entry or recycle the least recently used one */
+  i = etharp_alloc_index();
+  if (i < 0) {
+    if ((flags & ETHARP_FLAG_TRY_HARD) == 0) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: no empty entry found and not allowed to recycle\n"));
+      return (s16_t)ERR_MEM;
+    }
+    i = etharp_lru_victim();
+    if (i < 0) {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: no empty or recyclable entries found\n"));
+      return (s16_t)ERR_MEM;
+    }
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: recycling least recently used entry %d\n", (int)i));
+    etharp_free_entry(i);
+  }
+#else /* ETHARP_TABLE_HASH_SIZE */
   s16_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
   s16_t empty = ARP_TABLE_SIZE;
   s16_t i = 0;
@@ -384,6 +658,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
     LWIP_ASSERT("i < ARP_TABLE_SIZE", i < ARP_TABLE_SIZE);
     etharp_free_entry(i);
   }
+#endif /* ETHARP_TABLE_HASH_SIZE */
 
   LWIP_ASSERT("i < ARP_TABLE_SIZE", i < ARP_TABLE_SIZE);
   LWIP_ASSERT("arp_table[i].state == ETHARP_STATE_EMPTY",
@@ -398,6 +673,9 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
 #if ETHARP_TABLE_MATCH_NETIF
   arp_table[i].netif = netif;
 #endif /* ETHARP_TABLE_MATCH_NETIF */
+#if ETHARP_TABLE_HASH_SIZE
+  etharp_link_entry(i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   return (s16_t)i;
 }
 
@@ -444,6 +722,12 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
 
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   if (flags & ETHARP_FLAG_STATIC_ENTRY) {
+#if ETHARP_TABLE_HASH_SIZE
+    if (arp_table[i].state != ETHARP_STATE_STATIC) {
+      /* static entries are never recycled, so they are not in the LRU list */
+      etharp_lru_unlink(i);
+    }
+#endif /* ETHARP_TABLE_HASH_SIZE */
     /* record static type */
     arp_table[i].state = ETHARP_STATE_STATIC;
   } else if (arp_table[i].state == ETHARP_STATE_STATIC) {
@@ -454,8 +738,17 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
   {
     /* mark it stable */
     arp_table[i].state = ETHARP_STATE_STABLE;
+#if ETHARP_TABLE_HASH_SIZE
+    etharp_lru_touch(i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   }
 
+#if IP_FLOW_CACHE_SIZE
+  if ((arp_table[i].netif != netif) || !eth_addr_eq(&arp_table[i].ethaddr, ethaddr)) {
+    /* forwarded flows may use the old address */
+    ip_flow_flush();
+  }
+#endif /* IP_FLOW_CACHE_SIZE */
   /* record network interface */
   arp_table[i].netif = netif;
   /* insert in SNMP ARP index tree */
@@ -750,6 +1043,9 @@ etharp_output_to_arp_index(struct netif *netif, struct pbuf *q, netif_addr_idx_t
 {
   LWIP_ASSERT("arp_table[arp_idx].state >= ETHARP_STATE_STABLE",
               arp_table[arp_idx].state >= ETHARP_STATE_STABLE);
+#if ETHARP_TABLE_HASH_SIZE
+  etharp_lru_touch((s16_t)arp_idx);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   /* if arp table entry is about to expire: re-request it,
      but only if its state is ETHARP_STATE_STABLE to prevent flooding the
      network with ARP requests if this address is used frequently. */
@@ -834,21 +1130,46 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
       if (!ip4_addr_islinklocal(&iphdr->src))
 #endif /* LWIP_AUTOIP */
       {
+#if LWIP_IPV4_FIB
+        /* a route through this netif selects the gateway (or none for a
+           directly connected network) */
+        const struct ip4_fib_route *route = ip4_fib_lookup_usable(ipaddr, netif);
+        const struct ip4_fib_path *path = NULL;
+        if (route != NULL) {
+          u32_t flow_hash = 0;
+#if LWIP_FIB_MAX_PATHS > 1
+          if (route->num_paths > 1) {
+            /* several gateways on this netif: keep each flow on one */
+            struct ip_flow_key key;
+            ip4_flow_key(&key, q);
+            flow_hash = ip_flow_key_hash(&key);
+          }
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+          path = ip4_fib_select(route, flow_hash, netif);
+        }
+        if (path != NULL) {
+          if (!ip4_addr_isany_val(path->gw)) {
+            dst_addr = &path->gw;
+          }
+        } else
+#endif /* LWIP_IPV4_FIB */
+        {
 #ifdef LWIP_HOOK_ETHARP_GET_GW
-        /* For advanced routing, a single default gateway might not be enough, so get
-           the IP address of the gateway to handle the current destination address. */
-        dst_addr = LWIP_HOOK_ETHARP_GET_GW(netif, ipaddr);
-        if (dst_addr == NULL)
+          /* For advanced routing, a single default gateway might not be enough, so get
+             the IP address of the gateway to handle the current destination address. */
+          dst_addr = LWIP_HOOK_ETHARP_GET_GW(netif, ipaddr);
+          if (dst_addr == NULL)
 #endif /* LWIP_HOOK_ETHARP_GET_GW */
-        {
-          /* interface has default gateway? */
-          if (!ip4_addr_isany_val(*netif_ip4_gw(netif))) {
-            /* send to hardware address of default gateway IP address */
-            dst_addr = netif_ip4_gw(netif);
-            /* no default gateway available */
-          } else {
-            /* no route to destination error (default gateway missing) */
-            return ERR_RTE;
+          {
+            /* interface has default gateway? */
+            if (!ip4_addr_isany_val(*netif_ip4_gw(netif))) {
+              /* send to hardware address of default gateway IP address */
+              dst_addr = netif_ip4_gw(netif);
+              /* no default gateway available */
+            } else {
+              /* no route to destination error (default gateway missing) */
+              return ERR_RTE;
+            }
           }
         }
       }
@@ -873,6 +1194,17 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     }
 #endif /* LWIP_NETIF_HWADDRHINT */
 
+#if ETHARP_TABLE_HASH_SIZE
+    {
+      s16_t found = etharp_hash_lookup(dst_addr, netif);
+      if ((found >= 0) && (arp_table[found].state >= ETHARP_STATE_STABLE)) {
+        /* found an existing, stable entry */
+        i = (netif_addr_idx_t)found;
+        ETHARP_SET_ADDRHINT(netif, i);
+        return etharp_output_to_arp_index(netif, q, i);
+      }
+    }
+#else /* ETHARP_TABLE_HASH_SIZE */
     /* find stable entry: do this here since this is a critical path for
        throughput and etharp_find_entry() is kind of slow */
     for (i = 0; i < ARP_TABLE_SIZE; i++) {
@@ -886,6 +1218,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
         return etharp_output_to_arp_index(netif, q, i);
       }
     }
+#endif /* ETHARP_TABLE_HASH_SIZE */
     /* no stable entry found, use the (slower) query function:
        queue on destination Ethernet address belonging to ipaddr */
     return etharp_query(netif, dst_addr, q);
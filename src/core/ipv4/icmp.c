@@ -98,7 +98,7 @@ icmp_input(struct pbuf *p, struct netif *inp)
     goto lenerr;
   }
   if (p->len < sizeof(u16_t) * 2) {
-    LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: short ICMP (%"U16_F" bytes) received\n", p->tot_len));
+    LWIP_DEBUGF(ICMP_DEBUG, ("icmp_input: short ICMP (%"PBUFLEN_F" bytes) received\n", p->tot_len));
     goto lenerr;
   }
 
@@ -46,6 +46,8 @@
 #include "lwip/def.h"
 #include "lwip/mem.h"
 #include "lwip/ip4_frag.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip_flow.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
 #include "lwip/icmp.h"
@@ -56,6 +58,7 @@
 #include "lwip/autoip.h"
 #include "lwip/stats.h"
 #include "lwip/prot/iana.h"
+#include "netif/ethernet.h"
 
 #include <string.h>
 
@@ -139,20 +142,17 @@ ip4_route_src(const ip4_addr_t *src, const ip4_addr_t *dest)
 }
 #endif /* LWIP_HOOK_IP4_ROUTE_SRC */
 
-/**
- * Finds the appropriate network interface for a given IP address. It
- * searches the list of network interfaces linearly. A match is found
- * if the masked IP address of the network interface equals the masked
- * IP address given to the function.
- *
- * @param dest the destination IP address for which to find the route
- * @return the netif on which to send to reach dest
- */
-struct netif *
-ip4_route(const ip4_addr_t *dest)
+/** ip4_route() for a flow: the flow hash selects the path of a FIB route
+ * with several next hops, 0 selects it by the destination address */
+static struct netif *
+ip4_route_hash(const ip4_addr_t *dest, u32_t flow_hash)
 {
 #if !LWIP_SINGLE_NETIF
   struct netif *netif;
+#if LWIP_IPV4_FIB
+  const struct ip4_fib_route *route;
+  const struct ip4_fib_path *path = NULL;
+#endif /* LWIP_IPV4_FIB */
 
   LWIP_ASSERT_CORE_LOCKED();
 
@@ -166,12 +166,35 @@ ip4_route(const ip4_addr_t *dest)
   /* bug #54569: in case LWIP_SINGLE_NETIF=1 and LWIP_DEBUGF() disabled, the following loop is optimized away */
   LWIP_UNUSED_ARG(dest);
 
+#if LWIP_IPV4_FIB
+  /* a route whose next hops are all down leaves the way to shorter ones */
+  route = ip4_fib_lookup_usable(dest, NULL);
+  if (route != NULL) {
+#if LWIP_FIB_MAX_PATHS > 1
+    if ((route->num_paths > 1) && (flow_hash == 0)) {
+      /* no flow given: keep all packets to the destination on one path */
+      ip_addr_t dest_addr;
+      ip_addr_copy_from_ip4(dest_addr, *dest);
+      flow_hash = ip_flow_hash(NULL, &dest_addr, 0, 0, 0);
+    }
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+    path = ip4_fib_select(route, flow_hash, NULL);
+  }
+#endif /* LWIP_IPV4_FIB */
+
   /* iterate through netifs */
   NETIF_FOREACH(netif) {
     /* is the netif up, does it have a link and a valid address? */
     if (netif_is_up(netif) && netif_is_link_up(netif) && !ip4_addr_isany_val(*netif_ip4_addr(netif))) {
       /* network mask matches? */
       if (ip4_addr_net_eq(dest, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+#if LWIP_IPV4_FIB
+        /* a route to a longer prefix wins over the subnet of the netif */
+        if ((path != NULL) &&
+            (IP4_FIB_PREFIX_MASK(route->prefix_len) > lwip_ntohl(ip4_addr_get_u32(netif_ip4_netmask(netif))))) {
+          return path->netif;
+        }
+#endif /* LWIP_IPV4_FIB */
         /* return netif on which to forward IP packet */
         return netif;
       }
@@ -200,6 +223,12 @@ ip4_route(const ip4_addr_t *dest)
   }
 #endif /* LWIP_NETIF_LOOPBACK && !LWIP_HAVE_LOOPIF */
 
+#if LWIP_IPV4_FIB
+  if (path != NULL) {
+    return path->netif;
+  }
+#endif /* LWIP_IPV4_FIB */
+
 #ifdef LWIP_HOOK_IP4_ROUTE_SRC
   netif = LWIP_HOOK_IP4_ROUTE_SRC(NULL, dest);
   if (netif != NULL) {
@@ -212,6 +241,7 @@ ip4_route(const ip4_addr_t *dest)
   }
 #endif
 #endif /* !LWIP_SINGLE_NETIF */
+  LWIP_UNUSED_ARG(flow_hash);
 
   if ((netif_default == NULL) || !netif_is_up(netif_default) || !netif_is_link_up(netif_default) ||
       ip4_addr_isany_val(*netif_ip4_addr(netif_default)) || ip4_addr_isloopback(dest)) {
@@ -227,6 +257,50 @@ ip4_route(const ip4_addr_t *dest)
   return netif_default;
 }
 
+/**
+ * Finds the appropriate network interface for a given IP address. It
+ * searches the list of network interfaces linearly. A match is found
+ * if the masked IP address of the network interface equals the masked
+ * IP address given to the function.
+ *
+ * @param dest the destination IP address for which to find the route
+ * @return the netif on which to send to reach dest
+ */
+struct netif *
+ip4_route(const ip4_addr_t *dest)
+{
+  return ip4_route_hash(dest, 0);
+}
+
+#if LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1)
+/**
+ * Like ip4_route_src(), but a FIB route with several next hops sends the
+ * packets of a flow on the path selected by its hash, so that flows to the
+ * same destination are spread over the paths while every flow stays on one.
+ *
+ * @param src the source IP address (may be NULL, for source based routing)
+ * @param dest the destination IP address for which to find the route
+ * @param flow_hash hash of the flow (see ip_flow_hash()), 0 to select the
+ *                  path by the destination only
+ * @return the netif on which to send to reach dest
+ */
+struct netif *
+ip4_route_flow(const ip4_addr_t *src, const ip4_addr_t *dest, u32_t flow_hash)
+{
+#ifdef LWIP_HOOK_IP4_ROUTE_SRC
+  if (src != NULL) {
+    struct netif *netif = LWIP_HOOK_IP4_ROUTE_SRC(src, dest);
+    if (netif != NULL) {
+      return netif;
+    }
+  }
+#else /* LWIP_HOOK_IP4_ROUTE_SRC */
+  LWIP_UNUSED_ARG(src);
+#endif /* LWIP_HOOK_IP4_ROUTE_SRC */
+  return ip4_route_hash(dest, flow_hash);
+}
+#endif /* LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1) */
+
 #if IP_FORWARD
 /**
  * Determine whether an IP address is in a reserved set of addresses
@@ -281,6 +355,12 @@ static void
 ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
 {
   struct netif *netif;
+#if IP_FLOW_CACHE_SIZE || (LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1))
+  struct ip_flow_key key;
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1)) */
+#if IP_FLOW_CACHE_SIZE
+  const struct ip_flow *flow;
+#endif /* IP_FLOW_CACHE_SIZE */
 
   PERF_START;
   LWIP_UNUSED_ARG(inp);
@@ -298,7 +378,18 @@ ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
   }
 
   /* Find network interface where to forward this IP packet to. */
-  netif = ip4_route_src(ip4_current_src_addr(), ip4_current_dest_addr());
+#if IP_FLOW_CACHE_SIZE || (LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1))
+  ip4_flow_key(&key, p);
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1)) */
+#if IP_FLOW_CACHE_SIZE
+  flow = ip_flow_lookup(&key);
+  if (flow != NULL) {
+    netif = flow->netif;
+  } else
+#endif /* IP_FLOW_CACHE_SIZE */
+  {
+    netif = ip4_route_flow(ip4_current_src_addr(), ip4_current_dest_addr(), ip_flow_key_hash(&key));
+  }
   if (netif == NULL) {
     LWIP_DEBUGF(IP_DEBUG, ("ip4_forward: no forwarding route for %"U16_F".%"U16_F".%"U16_F".%"U16_F" found\n",
                            ip4_addr1_16(ip4_current_dest_addr()), ip4_addr2_16(ip4_current_dest_addr()),
@@ -396,7 +487,18 @@ ip4_forward(struct pbuf *p, struct ip_hdr *iphdr, struct netif *inp)
     return;
   }
   /* transmit pbuf on chosen interface */
+#if IP_FLOW_CACHE_SIZE
+  if (flow != NULL) {
+    /* the next hop of a cached flow is known, skip ARP */
+    ethernet_output(netif, p, (const struct eth_addr *)(netif->hwaddr), &flow->dhwaddr, ETHTYPE_IP);
+    return;
+  }
+  ip_flow_learn_start(&key, netif, p);
+  netif->output(netif, p, ip4_current_dest_addr());
+  ip_flow_learn_stop();
+#else /* IP_FLOW_CACHE_SIZE */
   netif->output(netif, p, ip4_current_dest_addr());
+#endif /* IP_FLOW_CACHE_SIZE */
   return;
 return_noroute:
   MIB2_STATS_INC(mib2.ipoutnoroutes);
@@ -472,6 +574,8 @@ ip4_input(struct pbuf *p, struct netif *inp)
 
   LWIP_ASSERT_CORE_LOCKED();
 
+  PERF_START;
+
   IP_STATS_INC(ip.recv);
   MIB2_STATS_INC(mib2.ipinreceives);
 
@@ -512,12 +616,12 @@ ip4_input(struct pbuf *p, struct netif *inp)
     }
     if (iphdr_hlen > p->len) {
       LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-                  ("IP header (len %"U16_F") does not fit in first pbuf (len %"U16_F"), IP packet dropped.\n",
+                  ("IP header (len %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IP packet dropped.\n",
                    iphdr_hlen, p->len));
     }
     if (iphdr_len > p->tot_len) {
       LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-                  ("IP (len %"U16_F") is longer than pbuf (len %"U16_F"), IP packet dropped.\n",
+                  ("IP (len %"U16_F") is longer than pbuf (len %"PBUFLEN_F"), IP packet dropped.\n",
                    iphdr_len, p->tot_len));
     }
     /* free (drop) packet pbufs */
@@ -670,7 +774,7 @@ ip4_input(struct pbuf *p, struct netif *inp)
   /* packet consists of multiple fragments? */
   if ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0) {
 #if IP_REASSEMBLY /* packet fragment reassembly code present? */
-    LWIP_DEBUGF(IP_DEBUG, ("IP packet is a fragment (id=0x%04"X16_F" tot_len=%"U16_F" len=%"U16_F" MF=%"U16_F" offset=%"U16_F"), calling ip4_reass()\n",
+    LWIP_DEBUGF(IP_DEBUG, ("IP packet is a fragment (id=0x%04"X16_F" tot_len=%"PBUFLEN_F" len=%"U16_F" MF=%"U16_F" offset=%"U16_F"), calling ip4_reass()\n",
                            lwip_ntohs(IPH_ID(iphdr)), p->tot_len, lwip_ntohs(IPH_LEN(iphdr)), (u16_t)!!(IPH_OFFSET(iphdr) & PP_HTONS(IP_MF)), (u16_t)((lwip_ntohs(IPH_OFFSET(iphdr)) & IP_OFFMASK) * 8)));
     /* reassemble the packet*/
     p = ip4_reass(p);
@@ -712,7 +816,7 @@ ip4_input(struct pbuf *p, struct netif *inp)
   /* send to upper layers */
   LWIP_DEBUGF(IP_DEBUG, ("ip4_input: \n"));
   ip4_debug_print(p);
-  LWIP_DEBUGF(IP_DEBUG, ("ip4_input: p->len %"U16_F" p->tot_len %"U16_F"\n", p->len, p->tot_len));
+  LWIP_DEBUGF(IP_DEBUG, ("ip4_input: p->len %"PBUFLEN_F" p->tot_len %"PBUFLEN_F"\n", p->len, p->tot_len));
 
   ip_data.current_netif = netif;
   ip_data.current_input_netif = inp;
@@ -789,6 +893,7 @@ ip4_input(struct pbuf *p, struct netif *inp)
   ip4_addr_set_any(ip4_current_src_addr());
   ip4_addr_set_any(ip4_current_dest_addr());
 
+  PERF_STOP("ip4_input");
   return ERR_OK;
 }
 
@@ -925,6 +1030,15 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
 #endif /* CHECKSUM_GEN_IP_INLINE */
     }
 #endif /* IP_OPTIONS_SEND */
+#if LWIP_PBUF_LEN32
+    if (p->tot_len > 0xFFFFU - IP_HLEN) {
+      /* the IP total length field is 16 bit (options already added) */
+      LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip4_output_if_opt: pbuf too long (%"PBUFLEN_F")\n", p->tot_len));
+      IP_STATS_INC(ip.err);
+      MIB2_STATS_INC(mib2.ipoutdiscards);
+      return ERR_VAL;
+    }
+#endif /* LWIP_PBUF_LEN32 */
     /* generate IP header */
     if (pbuf_add_header(p, IP_HLEN)) {
       LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip4_output: not enough room for IP header in pbuf\n"));
@@ -956,7 +1070,7 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
 #if CHECKSUM_GEN_IP_INLINE
     chk_sum += PP_NTOHS(tos | (iphdr->_v_hl << 8));
 #endif /* CHECKSUM_GEN_IP_INLINE */
-    IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+    IPH_LEN_SET(iphdr, lwip_htons((u16_t)p->tot_len));
 #if CHECKSUM_GEN_IP_INLINE
     chk_sum += iphdr->_len;
 #endif /* CHECKSUM_GEN_IP_INLINE */
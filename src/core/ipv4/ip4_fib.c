@@ -0,0 +1,561 @@
+/**
+ * @file
+ * IPv4 longest-prefix-match routing table (FIB)
+ *
+ * @defgroup ip4_fib FIB
+ * @ingroup ip4
+ * A routing table for IPv4 destinations that are not reachable through the
+ * subnet of a netif (@ref LWIP_IPV4_FIB).\n
+ * Routes map a prefix to a netif and an optional gateway. ip4_route() uses
+ * the longest matching prefix that has a next hop through a netif that is up
+ * (ip4_fib_lookup_usable()) if it is more specific than the subnet of a
+ * netif matching the destination, and etharp_output() sends to the gateway
+ * of that route instead of the default gateway of the netif.\n
+ * A route can have up to LWIP_FIB_MAX_PATHS next hops, each with a weight
+ * (ip4_fib_add_path()). A flow hash of the packet selects one of them
+ * (ip4_fib_select()), so the flows to a prefix are spread over the paths in
+ * proportion to their weights while every flow stays on its path.\n
+ * The routes are kept in a path-compressed binary trie: every node holds a
+ * prefix and branches on the first bit after it, nodes with one child and no
+ * route are never kept. A lookup therefore visits at most 33 nodes, no matter
+ * how many routes there are, and n routes need at most 2*n-1 nodes
+ * (MEMP_NUM_IP4_FIB_NODE).\n
+ * To be called from TCPIP thread
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV4 && LWIP_IPV4_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip4_fib.h"
+#include "lwip/ip_flow.h"
+#include "lwip/memp.h"
+#include "lwip/def.h"
+#include "lwip/debug.h"
+
+#include <string.h>
+
+/** Bit 'pos' of a key in host byte order, 0 being the most significant */
+#define IP4_FIB_BIT(key, pos) ((u8_t)(((key) >> (31 - (pos))) & 1))
+
+/** A path is usable if its netif is up (netif==NULL) or if it is the netif */
+#define IP4_FIB_PATH_USABLE(path, netif) (((netif) == NULL) ? \
+  (netif_is_up((path)->netif) && netif_is_link_up((path)->netif)) : ((path)->netif == (netif)))
+
+static struct ip4_fib_node *ip4_fib_root;
+static u16_t ip4_fib_routes;
+
+/** Length of the common prefix of two keys, not longer than max_len */
+static u8_t
+ip4_fib_common_len(u32_t a, u32_t b, u8_t max_len)
+{
+  u32_t diff = a ^ b;
+  u8_t len = 0;
+
+  while ((len < max_len) && ((diff & (0x80000000UL >> len)) == 0)) {
+    len++;
+  }
+  return len;
+}
+
+static struct ip4_fib_node *
+ip4_fib_node_new(u32_t key, u8_t len)
+{
+  struct ip4_fib_node *node = (struct ip4_fib_node *)memp_malloc(MEMP_IP4_FIB_NODE);
+  if (node != NULL) {
+    memset(node, 0, sizeof(struct ip4_fib_node));
+    node->key = key;
+    node->route.prefix_len = len;
+    ip4_addr_set_u32(&node->route.prefix, lwip_htonl(key));
+  }
+  return node;
+}
+
+/** Remove a node that has no route any more: it is freed if it has less than
+ * two children, its only child (if any) takes its place in the trie.
+ * @return the node now in the place of 'node'
+ */
+static struct ip4_fib_node *
+ip4_fib_node_compact(struct ip4_fib_node *node)
+{
+  struct ip4_fib_node *child;
+
+  if (node->has_route || ((node->child[0] != NULL) && (node->child[1] != NULL))) {
+    return node;
+  }
+  child = (node->child[0] != NULL) ? node->child[0] : node->child[1];
+  memp_free(MEMP_IP4_FIB_NODE, node);
+  return child;
+}
+
+/** Find the node of a prefix, create it if there is none.
+ * @return the node or NULL if MEMP_NUM_IP4_FIB_NODE is exhausted
+ */
+static struct ip4_fib_node *
+ip4_fib_node_get(u32_t key, u8_t prefix_len)
+{
+  struct ip4_fib_node **link = &ip4_fib_root;
+  struct ip4_fib_node *node, *new_node, *branch;
+  u8_t len = 0;
+
+  /* descend as long as the node's prefix is a prefix of the new one */
+  while ((node = *link) != NULL) {
+    len = ip4_fib_common_len(key, node->key, LWIP_MIN(prefix_len, node->route.prefix_len));
+    if (len < node->route.prefix_len) {
+      break;
+    }
+    if (node->route.prefix_len == prefix_len) {
+      /* route to this prefix (or a branching node) exists already */
+      return node;
+    }
+    link = &node->child[IP4_FIB_BIT(key, node->route.prefix_len)];
+  }
+
+  new_node = ip4_fib_node_new(key, prefix_len);
+  if (new_node == NULL) {
+    return NULL;
+  }
+  if (node == NULL) {
+    *link = new_node;
+  } else if (len == prefix_len) {
+    /* the new prefix contains 'node' */
+    new_node->child[IP4_FIB_BIT(node->key, len)] = node;
+    *link = new_node;
+  } else {
+    /* the prefixes diverge after 'len' bits: branch there */
+    branch = ip4_fib_node_new(key & IP4_FIB_PREFIX_MASK(len), len);
+    if (branch == NULL) {
+      memp_free(MEMP_IP4_FIB_NODE, new_node);
+      return NULL;
+    }
+    branch->child[IP4_FIB_BIT(key, len)] = new_node;
+    branch->child[IP4_FIB_BIT(node->key, len)] = node;
+    *link = branch;
+  }
+  return new_node;
+}
+
+/** Add a next hop to the route of a prefix (creating the route), or replace
+ * all next hops of the route if 'replace' is set */
+static err_t
+ip4_fib_insert(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw,
+               struct netif *netif, u8_t weight, u8_t replace)
+{
+  struct ip4_fib_node *node;
+  struct ip4_fib_path *path;
+  u8_t i;
+
+  node = ip4_fib_node_get(lwip_ntohl(ip4_addr_get_u32(prefix)) & IP4_FIB_PREFIX_MASK(prefix_len), prefix_len);
+  if (node == NULL) {
+    return ERR_MEM;
+  }
+  if (!node->has_route || replace) {
+    node->route.num_paths = 0;
+  }
+  for (i = 0; i < node->route.num_paths; i++) {
+    path = &node->route.path[i];
+    if ((path->netif == netif) &&
+        ((gw != NULL) ? ip4_addr_eq(&path->gw, gw) : ip4_addr_isany_val(path->gw))) {
+      break;
+    }
+  }
+  if (i == node->route.num_paths) {
+    if (i == LWIP_FIB_MAX_PATHS) {
+      /* an existing route is full: nothing was allocated */
+      return ERR_MEM;
+    }
+    node->route.num_paths++;
+  }
+  path = &node->route.path[i];
+  if (gw != NULL) {
+    ip4_addr_copy(path->gw, *gw);
+  } else {
+    ip4_addr_set_any(&path->gw);
+  }
+  path->netif = netif;
+  path->weight = weight;
+
+  if (!node->has_route) {
+    node->has_route = 1;
+    ip4_fib_routes++;
+  }
+  ip_flow_flush();
+  LWIP_DEBUGF(IP_DEBUG, ("ip4_fib_add: %"U16_F".%"U16_F".%"U16_F".%"U16_F"/%"U16_F", %"U16_F" paths\n",
+                         ip4_addr1_16(&node->route.prefix), ip4_addr2_16(&node->route.prefix),
+                         ip4_addr3_16(&node->route.prefix), ip4_addr4_16(&node->route.prefix),
+                         (u16_t)prefix_len, (u16_t)node->route.num_paths));
+  return ERR_OK;
+}
+
+/**
+ * @ingroup ip4_fib
+ * Add a route to the FIB. An existing route to the same prefix is replaced,
+ * including all of its next hops.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits (0 for a default route)
+ * @param gw next hop; NULL or IP_ADDR_ANY if the network is directly
+ *           connected to netif
+ * @param netif netif to send on
+ * @return ERR_OK on success, ERR_MEM if MEMP_NUM_IP4_FIB_NODE is exhausted
+ */
+err_t
+ip4_fib_add(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip4_fib_add: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+  LWIP_ERROR("ip4_fib_add: invalid netif", netif != NULL, return ERR_ARG;);
+
+  return ip4_fib_insert(prefix, prefix_len, gw, netif, 1, 1);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Add a next hop to the route to a prefix, the route is created if there is
+ * none. If the route already has this next hop, only its weight is changed.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits (0 for a default route)
+ * @param gw next hop; NULL or IP_ADDR_ANY if the network is directly
+ *           connected to netif
+ * @param netif netif to send on
+ * @param weight share of the flows to the prefix sent through this next hop,
+ *               relative to the weights of the other next hops (1..255)
+ * @return ERR_OK on success, ERR_MEM if MEMP_NUM_IP4_FIB_NODE is exhausted
+ *         or the route already has LWIP_FIB_MAX_PATHS next hops
+ */
+err_t
+ip4_fib_add_path(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw,
+                 struct netif *netif, u8_t weight)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip4_fib_add_path: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+  LWIP_ERROR("ip4_fib_add_path: invalid netif", netif != NULL, return ERR_ARG;);
+  LWIP_ERROR("ip4_fib_add_path: invalid weight", weight > 0, return ERR_ARG;);
+
+  return ip4_fib_insert(prefix, prefix_len, gw, netif, weight, 0);
+}
+
+/** Remove one next hop of the route to a prefix, or the whole route if
+ * 'all' is set. The route goes away with its last next hop. */
+static err_t
+ip4_fib_remove(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw,
+               const struct netif *netif, u8_t all)
+{
+  struct ip4_fib_node **link = &ip4_fib_root;
+  struct ip4_fib_node **parent_link = NULL;
+  struct ip4_fib_node *node;
+  struct ip4_fib_route *route;
+  u32_t key;
+  u8_t i;
+
+  key = lwip_ntohl(ip4_addr_get_u32(prefix)) & IP4_FIB_PREFIX_MASK(prefix_len);
+
+  while (((node = *link) != NULL) && (node->route.prefix_len < prefix_len)) {
+    if ((key & IP4_FIB_PREFIX_MASK(node->route.prefix_len)) != node->key) {
+      return ERR_VAL;
+    }
+    parent_link = link;
+    link = &node->child[IP4_FIB_BIT(key, node->route.prefix_len)];
+  }
+  if ((node == NULL) || (node->route.prefix_len != prefix_len) ||
+      (node->key != key) || !node->has_route) {
+    return ERR_VAL;
+  }
+
+  route = &node->route;
+  if (!all) {
+    for (i = 0; i < route->num_paths; i++) {
+      if ((route->path[i].netif == netif) &&
+          ((gw != NULL) ? ip4_addr_eq(&route->path[i].gw, gw) : ip4_addr_isany_val(route->path[i].gw))) {
+        break;
+      }
+    }
+    if (i == route->num_paths) {
+      return ERR_VAL;
+    }
+    route->num_paths--;
+    for (; i < route->num_paths; i++) {
+      route->path[i] = route->path[i + 1];
+    }
+  }
+  if (all || (route->num_paths == 0)) {
+    node->has_route = 0;
+    ip4_fib_routes--;
+    *link = ip4_fib_node_compact(node);
+    if (parent_link != NULL) {
+      /* the parent may have been left with one child */
+      *parent_link = ip4_fib_node_compact(*parent_link);
+    }
+  }
+  ip_flow_flush();
+  return ERR_OK;
+}
+
+/**
+ * @ingroup ip4_fib
+ * Remove the route to a prefix from the FIB, with all of its next hops.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits
+ * @return ERR_OK on success, ERR_VAL if there is no route to that prefix
+ */
+err_t
+ip4_fib_delete(const ip4_addr_t *prefix, u8_t prefix_len)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip4_fib_delete: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+
+  return ip4_fib_remove(prefix, prefix_len, NULL, NULL, 1);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Remove a next hop from the route to a prefix. The route is removed with
+ * its last next hop.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits
+ * @param gw next hop as passed to ip4_fib_add_path()
+ * @param netif netif as passed to ip4_fib_add_path()
+ * @return ERR_OK on success, ERR_VAL if the route has no such next hop
+ */
+err_t
+ip4_fib_delete_path(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip4_fib_delete_path: invalid prefix", (prefix != NULL) && (prefix_len <= 32), return ERR_ARG;);
+  LWIP_ERROR("ip4_fib_delete_path: invalid netif", netif != NULL, return ERR_ARG;);
+
+  return ip4_fib_remove(prefix, prefix_len, gw, netif, 0);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Find the route with the longest prefix matching a destination.
+ *
+ * @param dest destination address
+ * @return the route or NULL if no route matches. The route is only valid
+ *         until the FIB is changed.
+ */
+const struct ip4_fib_route *
+ip4_fib_lookup(const ip4_addr_t *dest)
+{
+  const struct ip4_fib_node *node = ip4_fib_root;
+  const struct ip4_fib_route *best = NULL;
+  u32_t key = lwip_ntohl(ip4_addr_get_u32(dest));
+
+  while ((node != NULL) && ((key & IP4_FIB_PREFIX_MASK(node->route.prefix_len)) == node->key)) {
+    if (node->has_route) {
+      best = &node->route;
+    }
+    if (node->route.prefix_len == 32) {
+      break;
+    }
+    node = node->child[IP4_FIB_BIT(key, node->route.prefix_len)];
+  }
+  return best;
+}
+
+/** Check if a route has a usable next hop (see IP4_FIB_PATH_USABLE) */
+static u8_t
+ip4_fib_route_usable(const struct ip4_fib_route *route, const struct netif *netif)
+{
+  u8_t i;
+
+  for (i = 0; i < route->num_paths; i++) {
+    if (IP4_FIB_PATH_USABLE(&route->path[i], netif)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @ingroup ip4_fib
+ * Find the route with the longest prefix matching a destination that has a
+ * next hop ip4_fib_select() can select. Routes whose next hops are all down
+ * are skipped, so that a shorter prefix (e.g. a default route through
+ * another netif) takes over.
+ *
+ * @param dest destination address
+ * @param netif NULL for routes with a next hop through a netif that is up and
+ *              has a link, else for routes with a next hop through this netif
+ * @return the route or NULL if no route matches. The route is only valid
+ *         until the FIB is changed.
+ */
+const struct ip4_fib_route *
+ip4_fib_lookup_usable(const ip4_addr_t *dest, const struct netif *netif)
+{
+  const struct ip4_fib_node *node = ip4_fib_root;
+  const struct ip4_fib_route *best = NULL;
+  u32_t key = lwip_ntohl(ip4_addr_get_u32(dest));
+
+  while ((node != NULL) && ((key & IP4_FIB_PREFIX_MASK(node->route.prefix_len)) == node->key)) {
+    if (node->has_route && ip4_fib_route_usable(&node->route, netif)) {
+      best = &node->route;
+    }
+    if (node->route.prefix_len == 32) {
+      break;
+    }
+    node = node->child[IP4_FIB_BIT(key, node->route.prefix_len)];
+  }
+  return best;
+}
+
+/**
+ * @ingroup ip4_fib
+ * Select the next hop of a route for a flow. The paths are weighted by
+ * hash-threshold (RFC 2992): the upper 16 bits of the flow hash pick a point
+ * in the sum of the weights of the usable paths. Adding or removing a path
+ * therefore only moves a part of the flows to other paths.
+ *
+ * @param route a route returned by ip4_fib_lookup() or ip4_fib_lookup_usable()
+ * @param flow_hash hash of the flow (see ip_flow_hash())
+ * @param netif NULL to select among the paths through netifs that are up and
+ *              have a link, else only among the paths through this netif
+ * @return the selected path or NULL if no path is usable
+ */
+const struct ip4_fib_path *
+ip4_fib_select(const struct ip4_fib_route *route, u32_t flow_hash, const struct netif *netif)
+{
+  const struct ip4_fib_path *path = NULL;
+  u32_t total = 0;
+  u32_t point;
+  u8_t i;
+
+  for (i = 0; i < route->num_paths; i++) {
+    path = &route->path[i];
+    if (IP4_FIB_PATH_USABLE(path, netif)) {
+      total += path->weight;
+    }
+  }
+  if (total == 0) {
+    return NULL;
+  }
+  /* at most 255 paths of weight 255 add up to less than 0x10000 */
+  point = ((flow_hash >> 16) * total) >> 16;
+  for (i = 0; i < route->num_paths; i++) {
+    path = &route->path[i];
+    if (IP4_FIB_PATH_USABLE(path, netif)) {
+      if (point < path->weight) {
+        break;
+      }
+      point -= path->weight;
+    }
+  }
+  LWIP_ASSERT("point beyond the weights", i < route->num_paths);
+  return path;
+}
+
+static void
+ip4_fib_walk(const struct ip4_fib_node *node, ip4_fib_foreach_fn fn, void *arg)
+{
+  /* the depth of the trie is limited to 33 nodes */
+  for (; node != NULL; node = node->child[1]) {
+    if (node->has_route) {
+      fn(&node->route, arg);
+    }
+    ip4_fib_walk(node->child[0], fn, arg);
+  }
+}
+
+/**
+ * @ingroup ip4_fib
+ * Call a function for every route in the FIB, in trie (address) order: a
+ * route is reported before the longer prefixes it contains. The FIB must
+ * not be changed from the callback.
+ *
+ * @param fn function to call
+ * @param arg argument passed to fn
+ */
+void
+ip4_fib_foreach(ip4_fib_foreach_fn fn, void *arg)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("fn != NULL", fn != NULL);
+
+  ip4_fib_walk(ip4_fib_root, fn, arg);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Number of routes in the FIB.
+ */
+u16_t
+ip4_fib_num_routes(void)
+{
+  return ip4_fib_routes;
+}
+
+static struct ip4_fib_node *
+ip4_fib_prune(struct ip4_fib_node *node, struct netif *netif)
+{
+  struct ip4_fib_route *route;
+  u8_t i, n;
+
+  if (node == NULL) {
+    return NULL;
+  }
+  node->child[0] = ip4_fib_prune(node->child[0], netif);
+  node->child[1] = ip4_fib_prune(node->child[1], netif);
+  if (node->has_route) {
+    route = &node->route;
+    for (i = 0, n = 0; i < route->num_paths; i++) {
+      if (route->path[i].netif != netif) {
+        route->path[n++] = route->path[i];
+      }
+    }
+    route->num_paths = n;
+    if (n == 0) {
+      node->has_route = 0;
+      ip4_fib_routes--;
+    }
+  }
+  return ip4_fib_node_compact(node);
+}
+
+/**
+ * @ingroup ip4_fib
+ * Remove all next hops through a netif, and the routes left without next
+ * hops. Called by netif_remove().
+ *
+ * @param netif the netif that goes away
+ */
+void
+ip4_fib_remove_netif(struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  ip4_fib_root = ip4_fib_prune(ip4_fib_root, netif);
+  ip_flow_flush();
+}
+
+#endif /* LWIP_IPV4 && LWIP_IPV4_FIB */
@@ -69,6 +69,11 @@
 #define IP_REASS_CHECK_OVERLAP 1
 #endif /* IP_REASS_CHECK_OVERLAP */
 
+#if IP_REASS_HASH_SIZE && !IP_REASS_CHECK_OVERLAP
+/* completion is detected by counting the received bytes */
+#error "IP_REASS_HASH_SIZE needs IP_REASS_CHECK_OVERLAP"
+#endif
+
 /** Set to 0 to prevent freeing the oldest datagram when the reassembly buffer is
  * full (IP_REASS_MAX_PBUFS pbufs are enqueued). The code gets a little smaller.
  * Datagrams will be freed by timeout only. Especially useful when MEMP_NUM_REASSDATA
@@ -108,16 +113,48 @@ PACK_STRUCT_END
 #define IP_ADDRESSES_AND_ID_MATCH(iphdrA, iphdrB)  \
   (ip4_addr_eq(&(iphdrA)->src, &(iphdrB)->src) && \
    ip4_addr_eq(&(iphdrA)->dest, &(iphdrB)->dest) && \
-   IPH_ID(iphdrA) == IPH_ID(iphdrB)) ? 1 : 0
+   IPH_ID(iphdrA) == IPH_ID(iphdrB) && \
+   IPH_PROTO(iphdrA) == IPH_PROTO(iphdrB)) ? 1 : 0
 
 /* global variables */
 static struct ip_reassdata *reassdatagrams;
 static u16_t ip_reass_pbufcount;
+#if IP_REASS_HASH_SIZE
+/* the oldest datagram (reassdatagrams is sorted by age) */
+static struct ip_reassdata *reassdatagrams_tail;
+static struct ip_reassdata *ip_reass_hash_table[IP_REASS_HASH_SIZE];
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/* pbufs enqueued per hash bucket of the source address */
+static u16_t ip_reass_src_pbufcount[IP_REASS_HASH_SIZE];
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 
 /* function prototypes */
 static void ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
 static int ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev);
 
+#if IP_REASS_HASH_SIZE
+/** Hash the fields identifying a datagram to its bucket */
+static u16_t
+ip_reass_hash(const struct ip_hdr *iphdr)
+{
+  u32_t h = (u32_t)(ip4_addr_get_u32(&iphdr->src) * 0x9E3779B1UL);
+  h = (u32_t)((h ^ ip4_addr_get_u32(&iphdr->dest)) * 0x9E3779B1UL);
+  h = (u32_t)((h ^ ((u32_t)IPH_ID(iphdr) << 8) ^ IPH_PROTO(iphdr)) * 0x9E3779B1UL);
+  return (u16_t)((h ^ (h >> 16)) & (IP_REASS_HASH_SIZE - 1));
+}
+
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/** Hash the source address to its bucket in ip_reass_src_pbufcount */
+static u16_t
+ip_reass_src_hash(const struct ip_hdr *iphdr)
+{
+  u32_t h = (u32_t)(ip4_addr_get_u32(&iphdr->src) * 0x9E3779B1UL);
+  return (u16_t)((h ^ (h >> 16)) & (IP_REASS_HASH_SIZE - 1));
+}
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
+
 /**
  * Reassembly timer base function
  * for both NO_SYS == 0 and 1 (!).
@@ -226,6 +263,24 @@ ip_reass_free_complete_datagram(struct ip_reassdata *ipr, struct ip_reassdata *p
 static int
 ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
 {
+#if IP_REASS_HASH_SIZE
+  /* the list is sorted by age: free from its tail */
+  struct ip_reassdata *oldest;
+  int pbufs_freed = 0;
+
+  do {
+    oldest = reassdatagrams_tail;
+    if ((oldest != NULL) && IP_ADDRESSES_AND_ID_MATCH(&oldest->iphdr, fraghdr)) {
+      /* don't free the datagram that 'fraghdr' belongs to */
+      oldest = oldest->prev;
+    }
+    if (oldest == NULL) {
+      break;
+    }
+    pbufs_freed += ip_reass_free_complete_datagram(oldest, oldest->prev);
+  } while (pbufs_freed < pbufs_needed);
+  return pbufs_freed;
+#else /* IP_REASS_HASH_SIZE */
   /* @todo Can't we simply remove the last datagram in the
    *       linked list behind reassdatagrams?
    */
@@ -265,9 +320,35 @@ ip_reass_remove_oldest_datagram(struct ip_hdr *fraghdr, int pbufs_needed)
     }
   } while ((pbufs_freed < pbufs_needed) && (other_datagrams > 1));
   return pbufs_freed;
+#endif /* IP_REASS_HASH_SIZE */
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/**
+ * Free the oldest datagrams of the source of a fragment until the fragment
+ * fits into IP_REASS_MAX_PBUFS_PER_SRC. The datagram 'fraghdr' belongs to is
+ * not freed!
+ *
+ * @param fraghdr IP header of the current fragment
+ * @param pbufs_needed number of pbufs needed to enqueue
+ */
+static void
+ip_reass_remove_oldest_of_source(struct ip_hdr *fraghdr, int pbufs_needed)
+{
+  struct ip_reassdata *r, *prev;
+  u16_t src_hash = ip_reass_src_hash(fraghdr);
+
+  for (r = reassdatagrams_tail; (r != NULL) &&
+       ((ip_reass_src_pbufcount[src_hash] + pbufs_needed) > IP_REASS_MAX_PBUFS_PER_SRC); r = prev) {
+    prev = r->prev;
+    if ((ip_reass_src_hash(&r->iphdr) == src_hash) && !IP_ADDRESSES_AND_ID_MATCH(&r->iphdr, fraghdr)) {
+      ip_reass_free_complete_datagram(r, prev);
+    }
+  }
+}
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
 /**
  * Enqueues a new fragment into the fragment queue
  * @param fraghdr points to the new fragments IP hdr
@@ -302,6 +383,16 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
 
   /* enqueue the new structure to the front of the list */
   ipr->next = reassdatagrams;
+#if IP_REASS_HASH_SIZE
+  if (reassdatagrams != NULL) {
+    reassdatagrams->prev = ipr;
+  } else {
+    reassdatagrams_tail = ipr;
+  }
+  ipr->hash = ip_reass_hash(fraghdr);
+  ipr->hash_next = ip_reass_hash_table[ipr->hash];
+  ip_reass_hash_table[ipr->hash] = ipr;
+#endif /* IP_REASS_HASH_SIZE */
   reassdatagrams = ipr;
   /* copy the ip header for later tests and input */
   /* @todo: no ip options supported? */
@@ -316,6 +407,29 @@ ip_reass_enqueue_new_datagram(struct ip_hdr *fraghdr, int clen)
 static void
 ip_reass_dequeue_datagram(struct ip_reassdata *ipr, struct ip_reassdata *prev)
 {
+#if IP_REASS_HASH_SIZE
+  struct ip_reassdata **pipr;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  u16_t src_hash;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
+  LWIP_ASSERT("prev == ipr->prev", prev == ipr->prev);
+  for (pipr = &ip_reass_hash_table[ipr->hash]; *pipr != ipr; pipr = &(*pipr)->hash_next) {
+    LWIP_ASSERT("datagram in its hash chain", *pipr != NULL);
+  }
+  *pipr = ipr->hash_next;
+  if (ipr->next != NULL) {
+    ipr->next->prev = prev;
+  } else {
+    reassdatagrams_tail = prev;
+  }
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  src_hash = ip_reass_src_hash(&ipr->iphdr);
+  LWIP_ASSERT("ip_reass_src_pbufcount >= clen", ip_reass_src_pbufcount[src_hash] >= ipr->clen);
+  ip_reass_src_pbufcount[src_hash] = (u16_t)(ip_reass_src_pbufcount[src_hash] - ipr->clen);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
+
   /* dequeue the reass struct  */
   if (reassdatagrams == ipr) {
     /* it was the first in the list */
@@ -375,9 +489,24 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
     return IP_REASS_VALIDATE_PBUF_DROPPED;
   }
 
+  q = ipr->p;
+#if IP_REASS_HASH_SIZE
+  if ((ipr->flags & IP_REASS_FLAG_LASTFRAG) ?
+      ((iprh->end > ipr->datagram_len) || (is_last && (iprh->end != ipr->datagram_len))) :
+      (is_last && (ipr->p_last != NULL) && (((struct ip_reass_helper *)ipr->p_last->payload)->end > iprh->end))) {
+    /* beyond the end of the datagram: would break counting the received bytes */
+    return IP_REASS_VALIDATE_PBUF_DROPPED;
+  }
+  if ((ipr->p_last != NULL) && (iprh->start >= ((struct ip_reass_helper *)ipr->p_last->payload)->end)) {
+    /* in order: append to the fragment with the highest offset */
+    iprh_prev = (struct ip_reass_helper *)ipr->p_last->payload;
+    q = NULL;
+  }
+#endif /* IP_REASS_HASH_SIZE */
+
   /* Iterate through until we either get to the end of the list (append),
    * or we find one with a larger offset (insert). */
-  for (q = ipr->p; q != NULL;) {
+  while (q != NULL) {
     iprh_tmp = (struct ip_reass_helper *)q->payload;
     if (iprh->start < iprh_tmp->start) {
       /* the new pbuf should be inserted before this */
@@ -449,11 +578,22 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
       /* this is the first fragment we ever received for this ip datagram */
       ipr->p = new_p;
     }
+#if IP_REASS_HASH_SIZE
+    ipr->p_last = new_p;
+#endif /* IP_REASS_HASH_SIZE */
   }
+#if IP_REASS_HASH_SIZE
+  ipr->recv_len = (u16_t)(ipr->recv_len + (iprh->end - iprh->start));
+#endif /* IP_REASS_HASH_SIZE */
 
   /* At this point, the validation part begins: */
   /* If we already received the last fragment */
   if (is_last || ((ipr->flags & IP_REASS_FLAG_LASTFRAG) != 0)) {
+#if IP_REASS_HASH_SIZE
+    /* fragments neither overlap nor exceed the datagram: it is complete when
+       all of its bytes were received */
+    valid = (ipr->recv_len == (is_last ? iprh->end : ipr->datagram_len));
+#else /* IP_REASS_HASH_SIZE */
     /* and had no holes so far */
     if (valid) {
       /* then check if the rest of the fragments is here */
@@ -484,6 +624,7 @@ ip_reass_chain_frag_into_datagram_and_validate(struct ip_reassdata *ipr, struct
         }
       }
     }
+#endif /* IP_REASS_HASH_SIZE */
     /* If valid is 0 here, there are some fragments missing in the middle
      * (since MF == 0 has already arrived). Such datagrams simply time out if
      * no more fragments are received... */
@@ -551,7 +692,11 @@ ip4_reass(struct pbuf *p)
 
   /* Look for the datagram the fragment belongs to in the current datagram queue,
    * remembering the previous in the queue for later dequeueing. */
+#if IP_REASS_HASH_SIZE
+  for (ipr = ip_reass_hash_table[ip_reass_hash(fraghdr)]; ipr != NULL; ipr = ipr->hash_next) {
+#else /* IP_REASS_HASH_SIZE */
   for (ipr = reassdatagrams; ipr != NULL; ipr = ipr->next) {
+#endif /* IP_REASS_HASH_SIZE */
     /* Check if the incoming fragment matches the one currently present
        in the reassembly buffer. If so, we proceed with copying the
        fragment into the buffer. */
@@ -563,6 +708,18 @@ ip4_reass(struct pbuf *p)
     }
   }
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  /* Check if the source is allowed to enqueue more. */
+  if ((ip_reass_src_pbufcount[ip_reass_src_hash(fraghdr)] + clen) > IP_REASS_MAX_PBUFS_PER_SRC) {
+    ip_reass_remove_oldest_of_source(fraghdr, clen);
+    if ((ip_reass_src_pbufcount[ip_reass_src_hash(fraghdr)] + clen) > IP_REASS_MAX_PBUFS_PER_SRC) {
+      LWIP_DEBUGF(IP_REASS_DEBUG, ("ip4_reass: source over IP_REASS_MAX_PBUFS_PER_SRC\n"));
+      IPFRAG_STATS_INC(ip_frag.memerr);
+      goto nullreturn;
+    }
+  }
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
   if (ipr == NULL) {
     /* Enqueue a new datagram into the datagram queue */
     ipr = ip_reass_enqueue_new_datagram(fraghdr, clen);
@@ -605,6 +762,13 @@ ip4_reass(struct pbuf *p)
      the number of fragments that may be enqueued at any one time
      (overflow checked by testing against IP_REASS_MAX_PBUFS) */
   ip_reass_pbufcount = (u16_t)(ip_reass_pbufcount + clen);
+#if IP_REASS_HASH_SIZE
+  ipr->clen = (u16_t)(ipr->clen + clen);
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  ip_reass_src_pbufcount[ip_reass_src_hash(fraghdr)] =
+    (u16_t)(ip_reass_src_pbufcount[ip_reass_src_hash(fraghdr)] + clen);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
   if (is_last) {
     u16_t datagram_len = (u16_t)(offset + len);
     ipr->datagram_len = datagram_len;
@@ -649,6 +813,9 @@ ip4_reass(struct pbuf *p)
     }
 
     /* find the previous entry in the linked list */
+#if IP_REASS_HASH_SIZE
+    ipr_prev = ipr->prev;
+#else /* IP_REASS_HASH_SIZE */
     if (ipr == reassdatagrams) {
       ipr_prev = NULL;
     } else {
@@ -658,6 +825,7 @@ ip4_reass(struct pbuf *p)
         }
       }
     }
+#endif /* IP_REASS_HASH_SIZE */
 
     /* release the sources allocate for the fragment queue entry */
     ip_reass_dequeue_datagram(ipr, ipr_prev);
@@ -50,6 +50,8 @@
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/ip6_frag.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/ip_flow.h"
 #include "lwip/icmp6.h"
 #include "lwip/priv/raw_priv.h"
 #include "lwip/udp.h"
@@ -59,38 +61,30 @@
 #include "lwip/mld6.h"
 #include "lwip/debug.h"
 #include "lwip/stats.h"
+#include "netif/ethernet.h"
 
 #ifdef LWIP_HOOK_FILENAME
 #include LWIP_HOOK_FILENAME
 #endif
 
-/**
- * Finds the appropriate network interface for a given IPv6 address. It tries to select
- * a netif following a sequence of heuristics:
- * 1) if there is only 1 netif, return it
- * 2) if the destination is a zoned address, match its zone to a netif
- * 3) if the either the source or destination address is a scoped address,
- *    match the source address's zone (if set) or address (if not) to a netif
- * 4) tries to match the destination subnet to a configured address
- * 5) tries to find a router-announced route
- * 6) tries to match the (unscoped) source address to the netif
- * 7) returns the default netif, if configured
- *
- * Note that each of the two given addresses may or may not be properly zoned.
- *
- * @param src the source IPv6 address, if known
- * @param dest the destination IPv6 address for which to find the route
- * @return the netif on which to send to reach dest
- */
-struct netif *
-ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
+/** ip6_route() for a flow: the flow hash selects the path of a FIB route
+ * with several next hops, 0 selects it by the destination address */
+static struct netif *
+ip6_route_hash(const ip6_addr_t *src, const ip6_addr_t *dest, u32_t flow_hash)
 {
 #if LWIP_SINGLE_NETIF
   LWIP_UNUSED_ARG(src);
   LWIP_UNUSED_ARG(dest);
+  LWIP_UNUSED_ARG(flow_hash);
 #else /* LWIP_SINGLE_NETIF */
   struct netif *netif;
   s8_t i;
+#if LWIP_IPV6_FIB
+  const struct ip6_fib_route *route;
+  const struct ip6_fib_path *path = NULL;
+#else /* LWIP_IPV6_FIB */
+  LWIP_UNUSED_ARG(flow_hash);
+#endif /* LWIP_IPV6_FIB */
 
   LWIP_ASSERT_CORE_LOCKED();
 
@@ -187,6 +181,26 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
   }
 #endif
 
+#if LWIP_IPV6_FIB
+  /* a route whose next hops are all down leaves the way to shorter ones */
+  route = ip6_fib_lookup_usable(dest, NULL);
+  if (route != NULL) {
+#if LWIP_FIB_MAX_PATHS > 1
+    if ((route->num_paths > 1) && (flow_hash == 0)) {
+      /* no flow given: keep all packets to the destination on one path */
+      ip_addr_t dest_addr;
+      ip_addr_copy_from_ip6(dest_addr, *dest);
+      flow_hash = ip_flow_hash(NULL, &dest_addr, 0, 0, 0);
+    }
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+    path = ip6_fib_select(route, flow_hash, NULL);
+  }
+  /* a route to a prefix longer than the implied /64 subnets wins over them */
+  if ((path != NULL) && (route->prefix_len > 64)) {
+    return path->netif;
+  }
+#endif /* LWIP_IPV6_FIB */
+
   /* See if the destination subnet matches a configured address. In accordance
    * with RFC 5942, dynamically configured addresses do not have an implied
    * local subnet, and thus should be considered /128 assignments. However, as
@@ -207,6 +221,12 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
     }
   }
 
+#if LWIP_IPV6_FIB
+  if (path != NULL) {
+    return path->netif;
+  }
+#endif /* LWIP_IPV6_FIB */
+
   /* Get the netif for a suitable router-announced route. */
   netif = nd6_find_route(dest);
   if (netif != NULL) {
@@ -254,6 +274,49 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
   return netif_default;
 }
 
+/**
+ * Finds the appropriate network interface for a given IPv6 address. It tries to select
+ * a netif following a sequence of heuristics:
+ * 1) if there is only 1 netif, return it
+ * 2) if the destination is a zoned address, match its zone to a netif
+ * 3) if the either the source or destination address is a scoped address,
+ *    match the source address's zone (if set) or address (if not) to a netif
+ * 4) tries to match the destination subnet to a configured address
+ * 5) tries to find a router-announced route
+ * 6) tries to match the (unscoped) source address to the netif
+ * 7) returns the default netif, if configured
+ *
+ * Note that each of the two given addresses may or may not be properly zoned.
+ *
+ * @param src the source IPv6 address, if known
+ * @param dest the destination IPv6 address for which to find the route
+ * @return the netif on which to send to reach dest
+ */
+struct netif *
+ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
+{
+  return ip6_route_hash(src, dest, 0);
+}
+
+#if LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1)
+/**
+ * Like ip6_route(), but a FIB route with several next hops sends the packets
+ * of a flow on the path selected by its hash, so that flows to the same
+ * destination are spread over the paths while every flow stays on one.
+ *
+ * @param src the source IPv6 address, if known
+ * @param dest the destination IPv6 address for which to find the route
+ * @param flow_hash hash of the flow (see ip_flow_hash()), 0 to select the
+ *                  path by the destination only
+ * @return the netif on which to send to reach dest
+ */
+struct netif *
+ip6_route_flow(const ip6_addr_t *src, const ip6_addr_t *dest, u32_t flow_hash)
+{
+  return ip6_route_hash(src, dest, flow_hash);
+}
+#endif /* LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1) */
+
 /**
  * @ingroup ip6
  * Select the best IPv6 source address for a given destination IPv6 address.
@@ -366,6 +429,12 @@ static void
 ip6_forward(struct pbuf *p, struct ip6_hdr *iphdr, struct netif *inp)
 {
   struct netif *netif;
+#if IP_FLOW_CACHE_SIZE || (LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1))
+  struct ip_flow_key key;
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1)) */
+#if IP_FLOW_CACHE_SIZE
+  const struct ip_flow *flow;
+#endif /* IP_FLOW_CACHE_SIZE */
 
   /* do not forward link-local or loopback addresses */
   if (ip6_addr_islinklocal(ip6_current_dest_addr()) ||
@@ -377,7 +446,18 @@ ip6_forward(struct pbuf *p, struct ip6_hdr *iphdr, struct netif *inp)
   }
 
   /* Find network interface where to forward this IP packet to. */
-  netif = ip6_route(IP6_ADDR_ANY6, ip6_current_dest_addr());
+#if IP_FLOW_CACHE_SIZE || (LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1))
+  ip6_flow_key(&key, p);
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1)) */
+#if IP_FLOW_CACHE_SIZE
+  flow = ip_flow_lookup(&key);
+  if (flow != NULL) {
+    netif = flow->netif;
+  } else
+#endif /* IP_FLOW_CACHE_SIZE */
+  {
+    netif = ip6_route_flow(IP6_ADDR_ANY6, ip6_current_dest_addr(), ip_flow_key_hash(&key));
+  }
   if (netif == NULL) {
     LWIP_DEBUGF(IP6_DEBUG, ("ip6_forward: no route for %"X16_F":%"X16_F":%"X16_F":%"X16_F":%"X16_F":%"X16_F":%"X16_F":%"X16_F"\n",
         IP6_ADDR_BLOCK1(ip6_current_dest_addr()),
@@ -457,7 +537,18 @@ ip6_forward(struct pbuf *p, struct ip6_hdr *iphdr, struct netif *inp)
       IP6_ADDR_BLOCK8(ip6_current_dest_addr())));
 
   /* transmit pbuf on chosen interface */
+#if IP_FLOW_CACHE_SIZE
+  if (flow != NULL) {
+    /* the next hop of a cached flow is known, skip ND */
+    ethernet_output(netif, p, (const struct eth_addr *)(netif->hwaddr), &flow->dhwaddr, ETHTYPE_IPV6);
+  } else {
+    ip_flow_learn_start(&key, netif, p);
+    netif->output_ip6(netif, p, ip6_current_dest_addr());
+    ip_flow_learn_stop();
+  }
+#else /* IP_FLOW_CACHE_SIZE */
   netif->output_ip6(netif, p, ip6_current_dest_addr());
+#endif /* IP_FLOW_CACHE_SIZE */
   IP6_STATS_INC(ip6.fw);
   IP6_STATS_INC(ip6.xmit);
   return;
@@ -522,6 +613,8 @@ ip6_input(struct pbuf *p, struct netif *inp)
 
   LWIP_ASSERT_CORE_LOCKED();
 
+  PERF_START;
+
   IP6_STATS_INC(ip6.recv);
 
   /* identify the IP header */
@@ -546,12 +639,12 @@ ip6_input(struct pbuf *p, struct netif *inp)
   if ((IP6_HLEN > p->len) || (IP6H_PLEN(ip6hdr) > (p->tot_len - IP6_HLEN))) {
     if (IP6_HLEN > p->len) {
       LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-        ("IPv6 header (len %"U16_F") does not fit in first pbuf (len %"U16_F"), IP packet dropped.\n",
+        ("IPv6 header (len %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IP packet dropped.\n",
             (u16_t)IP6_HLEN, p->len));
     }
-    if ((IP6H_PLEN(ip6hdr) + IP6_HLEN) > p->tot_len) {
+    if ((u32_t)(IP6H_PLEN(ip6hdr) + IP6_HLEN) > p->tot_len) {
       LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-        ("IPv6 (plen %"U16_F") is longer than pbuf (len %"U16_F"), IP packet dropped.\n",
+        ("IPv6 (plen %"U16_F") is longer than pbuf (len %"PBUFLEN_F"), IP packet dropped.\n",
             (u16_t)(IP6H_PLEN(ip6hdr) + IP6_HLEN), p->tot_len));
     }
     /* free (drop) packet pbufs */
@@ -705,7 +798,7 @@ netif_found:
 
   LWIP_DEBUGF(IP6_DEBUG, ("ip6_input: \n"));
   ip6_debug_print(p);
-  LWIP_DEBUGF(IP6_DEBUG, ("ip6_input: p->len %"U16_F" p->tot_len %"U16_F"\n", p->len, p->tot_len));
+  LWIP_DEBUGF(IP6_DEBUG, ("ip6_input: p->len %"PBUFLEN_F" p->tot_len %"PBUFLEN_F"\n", p->len, p->tot_len));
 
   /* Move to payload. */
   pbuf_remove_header(p, IP6_HLEN);
@@ -732,7 +825,7 @@ netif_found:
 
       if ((p->len < 8) || (hlen > p->len)) {
         LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"U16_F"), IPv6 packet dropped.\n",
+          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IPv6 packet dropped.\n",
               hlen, p->len));
         /* free (drop) packet pbufs */
         pbuf_free(p);
@@ -821,7 +914,7 @@ netif_found:
       hlen = 8 * (1 + dest_hdr->_hlen);
       if ((p->len < 8) || (hlen > p->len)) {
         LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"U16_F"), IPv6 packet dropped.\n",
+          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IPv6 packet dropped.\n",
               hlen, p->len));
         /* free (drop) packet pbufs */
         pbuf_free(p);
@@ -915,7 +1008,7 @@ netif_found:
 
       if ((p->len < 8) || (hlen > p->len)) {
         LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"U16_F"), IPv6 packet dropped.\n",
+          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IPv6 packet dropped.\n",
               hlen, p->len));
         /* free (drop) packet pbufs */
         pbuf_free(p);
@@ -975,7 +1068,7 @@ netif_found:
       /* Make sure this header fits in current pbuf. */
       if (hlen > p->len) {
         LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
-          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"U16_F"), IPv6 packet dropped.\n",
+          ("IPv6 options header (hlen %"U16_F") does not fit in first pbuf (len %"PBUFLEN_F"), IPv6 packet dropped.\n",
               hlen, p->len));
         /* free (drop) packet pbufs */
         pbuf_free(p);
@@ -1115,6 +1208,7 @@ ip6_input_cleanup:
   ip6_addr_set_zero(ip6_current_src_addr());
   ip6_addr_set_zero(ip6_current_dest_addr());
 
+  PERF_STOP("ip6_input");
   return ERR_OK;
 }
 
@@ -1196,6 +1290,15 @@ ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
     }
 #endif /* LWIP_IPV6_SCOPES */
 
+#if LWIP_PBUF_LEN32
+    if (p->tot_len > 0xFFFFU) {
+      /* jumbograms are not supported, the payload length field is 16 bit */
+      LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip6_output: pbuf too long (%"PBUFLEN_F")\n", p->tot_len));
+      IP6_STATS_INC(ip6.err);
+      return ERR_VAL;
+    }
+#endif /* LWIP_PBUF_LEN32 */
+
     /* generate IPv6 header */
     if (pbuf_add_header(p, IP6_HLEN)) {
       LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip6_output: not enough room for IPv6 header in pbuf\n"));
@@ -0,0 +1,626 @@
+/**
+ * @file
+ * IPv6 longest-prefix-match routing table (FIB)
+ *
+ * @defgroup ip6_fib FIB
+ * @ingroup ip6
+ * A routing table for IPv6 destinations (@ref LWIP_IPV6_FIB).\n
+ * Routes map a prefix of any length to a netif and an optional (usually
+ * link-local) gateway. ip6_route() uses the longest matching prefix that has
+ * a next hop through a netif that is up (ip6_fib_lookup_usable()) before the
+ * prefixes learned from router advertisements, and ND6 sends to the gateway
+ * of that route instead of a default router.\n
+ * A route can have up to LWIP_FIB_MAX_PATHS weighted next hops
+ * (ip6_fib_add_path()), ip6_fib_select() picks one of them by a flow hash.\n
+ * The routes are kept in a multibit trie: every node consumes
+ * LWIP_IPV6_FIB_STRIDE bits of the address and has a slot for each of their
+ * values. A route is stored in the node where its prefix ends and is
+ * expanded into all slots covered by the remaining bits of that node, so a
+ * lookup visits at most 128/LWIP_IPV6_FIB_STRIDE nodes and only reads one
+ * slot per node.\n
+ * To be called from TCPIP thread
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV6 && LWIP_IPV6_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip6_fib.h"
+#include "lwip/ip_flow.h"
+#include "lwip/memp.h"
+#include "lwip/nd6.h"
+#include "lwip/def.h"
+#include "lwip/debug.h"
+
+#include <string.h>
+
+/** Maximum number of nodes on the path of a lookup */
+#define IP6_FIB_LEVELS (128 / LWIP_IPV6_FIB_STRIDE)
+
+/** Depth of the node a route of the given prefix length is stored in */
+#define IP6_FIB_DEPTH(len) ((u8_t)(((len) == 0) ? 0 : ((len) - 1) / LWIP_IPV6_FIB_STRIDE))
+
+/** Number of slots a route is expanded into in its node */
+#define IP6_FIB_SPAN(depth, len) ((u16_t)(1U << (((depth) + 1) * LWIP_IPV6_FIB_STRIDE - (len))))
+
+/** A path is usable if its netif is up (netif==NULL) or if it is the netif */
+#define IP6_FIB_PATH_USABLE(path, netif) (((netif) == NULL) ? \
+  (netif_is_up((path)->netif) && netif_is_link_up((path)->netif)) : ((path)->netif == (netif)))
+
+/** The root node is never freed */
+static struct ip6_fib_node ip6_fib_root;
+static u16_t ip6_fib_routes;
+
+/** Slot index of an address in a node at a given depth */
+static u8_t
+ip6_fib_index(const ip6_addr_t *addr, u8_t depth)
+{
+  u8_t pos = (u8_t)(depth * LWIP_IPV6_FIB_STRIDE);
+  u32_t word = lwip_ntohl(addr->addr[pos >> 5]);
+
+  return (u8_t)((word >> (32 - LWIP_IPV6_FIB_STRIDE - (pos & 31))) & (IP6_FIB_NODE_SLOTS - 1));
+}
+
+/** Clear the host bits of a prefix */
+static void
+ip6_fib_mask(ip6_addr_t *prefix, const ip6_addr_t *addr, u8_t prefix_len)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    if (prefix_len >= 32 * (i + 1)) {
+      prefix->addr[i] = addr->addr[i];
+    } else if (prefix_len <= 32 * i) {
+      prefix->addr[i] = 0;
+    } else {
+      prefix->addr[i] = addr->addr[i] & lwip_htonl(0xffffffffUL << (32 * (i + 1) - prefix_len));
+    }
+  }
+  ip6_addr_clear_zone(prefix);
+}
+
+/** Free the empty nodes at the end of a path, deepest first */
+static void
+ip6_fib_release(struct ip6_fib_node **path, const ip6_addr_t *prefix, u8_t depth)
+{
+  struct ip6_fib_node *parent;
+
+  for (; (depth > 0) && (path[depth]->used == 0); depth--) {
+    parent = path[depth - 1];
+    parent->slot[ip6_fib_index(prefix, (u8_t)(depth - 1))].child = NULL;
+    parent->used--;
+    memp_free(MEMP_IP6_FIB_NODE, path[depth]);
+  }
+}
+
+/** Longest route of a node that covers a slot and is shorter than max_len */
+static struct ip6_fib_route *
+ip6_fib_best(const struct ip6_fib_node *node, u8_t depth, u16_t idx, u8_t max_len)
+{
+  struct ip6_fib_route *r, *best = NULL;
+  u8_t shift;
+
+  for (r = node->routes; r != NULL; r = r->next) {
+    if ((r->prefix_len < max_len) && ((best == NULL) || (r->prefix_len > best->prefix_len))) {
+      shift = (u8_t)((depth + 1) * LWIP_IPV6_FIB_STRIDE - r->prefix_len);
+      if ((idx >> shift) == (ip6_fib_index(&r->prefix, depth) >> shift)) {
+        best = r;
+      }
+    }
+  }
+  return best;
+}
+
+/** The gateway of a path as stored in the route: zoned to netif if needed */
+static void
+ip6_fib_gw(ip6_addr_t *gw_addr, const ip6_addr_t *gw, const struct netif *netif)
+{
+  if (gw != NULL) {
+    ip6_addr_copy(*gw_addr, *gw);
+    if (ip6_addr_lacks_zone(gw_addr, IP6_UNICAST)) {
+      ip6_addr_assign_zone(gw_addr, IP6_UNICAST, netif);
+    }
+  } else {
+    ip6_addr_set_any(gw_addr);
+  }
+}
+
+/** Take a route out of its node and free it */
+static void
+ip6_fib_node_remove(struct ip6_fib_node *node, u8_t depth, struct ip6_fib_route *route)
+{
+  struct ip6_fib_route **link;
+  u16_t idx, end;
+
+  for (link = &node->routes; *link != route; link = &(*link)->next) {
+    LWIP_ASSERT("route not in node", *link != NULL);
+  }
+  *link = route->next;
+  node->used--;
+
+  /* the slots fall back to the next shorter route of this node, if any */
+  idx = ip6_fib_index(&route->prefix, depth);
+  end = (u16_t)(idx + IP6_FIB_SPAN(depth, route->prefix_len));
+  for (; idx < end; idx++) {
+    if (node->slot[idx].route == route) {
+      node->slot[idx].route = ip6_fib_best(node, depth, idx, route->prefix_len);
+    }
+  }
+  memp_free(MEMP_IP6_FIB_ROUTE, route);
+  ip6_fib_routes--;
+}
+
+/** Add a next hop to the route of a prefix (creating the route), or replace
+ * all next hops of the route if 'replace' is set */
+static err_t
+ip6_fib_insert(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw,
+               struct netif *netif, u8_t weight, u8_t replace)
+{
+  struct ip6_fib_node *path[IP6_FIB_LEVELS];
+  struct ip6_fib_node *node = &ip6_fib_root;
+  struct ip6_fib_slot *slot;
+  struct ip6_fib_route *route;
+  struct ip6_fib_path *hop;
+  ip6_addr_t key, gw_addr;
+  u8_t depth, d, i;
+  u16_t idx, end;
+
+  ip6_fib_gw(&gw_addr, gw, netif);
+  ip6_fib_mask(&key, prefix, prefix_len);
+  depth = IP6_FIB_DEPTH(prefix_len);
+
+  path[0] = node;
+  for (d = 0; d < depth; d++) {
+    slot = &node->slot[ip6_fib_index(&key, d)];
+    if (slot->child == NULL) {
+      slot->child = (struct ip6_fib_node *)memp_malloc(MEMP_IP6_FIB_NODE);
+      if (slot->child == NULL) {
+        ip6_fib_release(path, &key, d);
+        return ERR_MEM;
+      }
+      memset(slot->child, 0, sizeof(struct ip6_fib_node));
+      node->used++;
+    }
+    node = slot->child;
+    path[d + 1] = node;
+  }
+
+  for (route = node->routes; route != NULL; route = route->next) {
+    if ((route->prefix_len == prefix_len) && ip6_addr_eq(&route->prefix, &key)) {
+      break;
+    }
+  }
+  if (route == NULL) {
+    route = (struct ip6_fib_route *)memp_malloc(MEMP_IP6_FIB_ROUTE);
+    if (route == NULL) {
+      ip6_fib_release(path, &key, depth);
+      return ERR_MEM;
+    }
+    memset(route, 0, sizeof(struct ip6_fib_route));
+    ip6_addr_copy(route->prefix, key);
+    route->prefix_len = prefix_len;
+    route->next = node->routes;
+    node->routes = route;
+    node->used++;
+    ip6_fib_routes++;
+
+    /* expand into the slots not taken by a longer prefix */
+    idx = ip6_fib_index(&key, depth);
+    end = (u16_t)(idx + IP6_FIB_SPAN(depth, prefix_len));
+    for (; idx < end; idx++) {
+      if ((node->slot[idx].route == NULL) || (node->slot[idx].route->prefix_len < prefix_len)) {
+        node->slot[idx].route = route;
+      }
+    }
+  }
+
+  if (replace) {
+    route->num_paths = 0;
+  }
+  for (i = 0; i < route->num_paths; i++) {
+    if ((route->path[i].netif == netif) && ip6_addr_eq(&route->path[i].gw, &gw_addr)) {
+      break;
+    }
+  }
+  if (i == route->num_paths) {
+    if (i == LWIP_FIB_MAX_PATHS) {
+      /* an existing route is full: nothing was allocated */
+      return ERR_MEM;
+    }
+    route->num_paths++;
+  }
+  hop = &route->path[i];
+  ip6_addr_copy(hop->gw, gw_addr);
+  hop->netif = netif;
+  hop->weight = weight;
+
+  /* next hops of cached destinations may have changed */
+  nd6_clear_destination_cache();
+  return ERR_OK;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Add a route to the FIB. An existing route to the same prefix is replaced,
+ * including all of its next hops.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits (0 for a default route)
+ * @param gw next hop, normally a link-local address of a router on netif;
+ *           NULL or IP6_ADDR_ANY if the network is directly connected
+ * @param netif netif to send on
+ * @return ERR_OK on success, ERR_MEM if MEMP_NUM_IP6_FIB_ROUTE or
+ *         MEMP_NUM_IP6_FIB_NODE is exhausted
+ */
+err_t
+ip6_fib_add(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip6_fib_add: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+  LWIP_ERROR("ip6_fib_add: invalid netif", netif != NULL, return ERR_ARG;);
+
+  return ip6_fib_insert(prefix, prefix_len, gw, netif, 1, 1);
+}
+
+/**
+ * @ingroup ip6_fib
+ * Add a next hop to the route to a prefix, the route is created if there is
+ * none. If the route already has this next hop, only its weight is changed.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits (0 for a default route)
+ * @param gw next hop, normally a link-local address of a router on netif;
+ *           NULL or IP6_ADDR_ANY if the network is directly connected
+ * @param netif netif to send on
+ * @param weight share of the flows to the prefix sent through this next hop,
+ *               relative to the weights of the other next hops (1..255)
+ * @return ERR_OK on success, ERR_MEM if MEMP_NUM_IP6_FIB_ROUTE or
+ *         MEMP_NUM_IP6_FIB_NODE is exhausted or the route already has
+ *         LWIP_FIB_MAX_PATHS next hops
+ */
+err_t
+ip6_fib_add_path(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw,
+                 struct netif *netif, u8_t weight)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip6_fib_add_path: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+  LWIP_ERROR("ip6_fib_add_path: invalid netif", netif != NULL, return ERR_ARG;);
+  LWIP_ERROR("ip6_fib_add_path: invalid weight", weight > 0, return ERR_ARG;);
+
+  return ip6_fib_insert(prefix, prefix_len, gw, netif, weight, 0);
+}
+
+/** Remove one next hop of the route to a prefix, or the whole route if
+ * 'all' is set. The route goes away with its last next hop. */
+static err_t
+ip6_fib_remove(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw,
+               const struct netif *netif, u8_t all)
+{
+  struct ip6_fib_node *path[IP6_FIB_LEVELS];
+  struct ip6_fib_node *node = &ip6_fib_root;
+  struct ip6_fib_route *route;
+  ip6_addr_t key, gw_addr;
+  u8_t depth, d, i;
+
+  ip6_fib_mask(&key, prefix, prefix_len);
+  depth = IP6_FIB_DEPTH(prefix_len);
+
+  path[0] = node;
+  for (d = 0; d < depth; d++) {
+    node = node->slot[ip6_fib_index(&key, d)].child;
+    if (node == NULL) {
+      return ERR_VAL;
+    }
+    path[d + 1] = node;
+  }
+  for (route = node->routes; route != NULL; route = route->next) {
+    if ((route->prefix_len == prefix_len) && ip6_addr_eq(&route->prefix, &key)) {
+      break;
+    }
+  }
+  if (route == NULL) {
+    return ERR_VAL;
+  }
+
+  if (!all) {
+    ip6_fib_gw(&gw_addr, gw, netif);
+    for (i = 0; i < route->num_paths; i++) {
+      if ((route->path[i].netif == netif) && ip6_addr_eq(&route->path[i].gw, &gw_addr)) {
+        break;
+      }
+    }
+    if (i == route->num_paths) {
+      return ERR_VAL;
+    }
+    route->num_paths--;
+    for (; i < route->num_paths; i++) {
+      route->path[i] = route->path[i + 1];
+    }
+  }
+  if (all || (route->num_paths == 0)) {
+    ip6_fib_node_remove(node, depth, route);
+    ip6_fib_release(path, &key, depth);
+  }
+  nd6_clear_destination_cache();
+  return ERR_OK;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Remove the route to a prefix from the FIB, with all of its next hops.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits
+ * @return ERR_OK on success, ERR_VAL if there is no route to that prefix
+ */
+err_t
+ip6_fib_delete(const ip6_addr_t *prefix, u8_t prefix_len)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip6_fib_delete: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+
+  return ip6_fib_remove(prefix, prefix_len, NULL, NULL, 1);
+}
+
+/**
+ * @ingroup ip6_fib
+ * Remove a next hop from the route to a prefix. The route is removed with
+ * its last next hop.
+ *
+ * @param prefix destination network, host bits are ignored
+ * @param prefix_len length of the prefix in bits
+ * @param gw next hop as passed to ip6_fib_add_path()
+ * @param netif netif as passed to ip6_fib_add_path()
+ * @return ERR_OK on success, ERR_VAL if the route has no such next hop
+ */
+err_t
+ip6_fib_delete_path(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("ip6_fib_delete_path: invalid prefix", (prefix != NULL) && (prefix_len <= 128), return ERR_ARG;);
+  LWIP_ERROR("ip6_fib_delete_path: invalid netif", netif != NULL, return ERR_ARG;);
+
+  return ip6_fib_remove(prefix, prefix_len, gw, netif, 0);
+}
+
+/**
+ * @ingroup ip6_fib
+ * Find the route with the longest prefix matching a destination.
+ *
+ * @param dest destination address (the zone is not looked at)
+ * @return the route or NULL if no route matches. The route is only valid
+ *         until the FIB is changed.
+ */
+const struct ip6_fib_route *
+ip6_fib_lookup(const ip6_addr_t *dest)
+{
+  const struct ip6_fib_node *node = &ip6_fib_root;
+  const struct ip6_fib_slot *slot;
+  const struct ip6_fib_route *best = NULL;
+  u8_t depth = 0;
+
+  do {
+    slot = &node->slot[ip6_fib_index(dest, depth)];
+    if (slot->route != NULL) {
+      /* deeper nodes only hold longer prefixes */
+      best = slot->route;
+    }
+    node = slot->child;
+    depth++;
+  } while (node != NULL);
+  return best;
+}
+
+/** Check if a route has a usable next hop (see IP6_FIB_PATH_USABLE) */
+static u8_t
+ip6_fib_route_usable(const struct ip6_fib_route *route, const struct netif *netif)
+{
+  u8_t i;
+
+  for (i = 0; i < route->num_paths; i++) {
+    if (IP6_FIB_PATH_USABLE(&route->path[i], netif)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Find the route with the longest prefix matching a destination that has a
+ * next hop ip6_fib_select() can select, see ip4_fib_lookup_usable().
+ *
+ * @param dest destination address (the zone is not looked at)
+ * @param netif NULL for routes with a next hop through a netif that is up and
+ *              has a link, else for routes with a next hop through this netif
+ * @return the route or NULL if no route matches. The route is only valid
+ *         until the FIB is changed.
+ */
+const struct ip6_fib_route *
+ip6_fib_lookup_usable(const ip6_addr_t *dest, const struct netif *netif)
+{
+  const struct ip6_fib_node *path[IP6_FIB_LEVELS];
+  const struct ip6_fib_node *node = &ip6_fib_root;
+  const struct ip6_fib_route *route;
+  u8_t depth = 0;
+  u16_t idx;
+
+  do {
+    path[depth] = node;
+    node = node->slot[ip6_fib_index(dest, depth)].child;
+    depth++;
+  } while (node != NULL);
+
+  /* deeper nodes only hold longer prefixes, a slot only holds the longest
+     route of its node: walk back up through the shorter ones */
+  while (depth-- > 0) {
+    idx = ip6_fib_index(dest, depth);
+    for (route = path[depth]->slot[idx].route; route != NULL;
+         route = ip6_fib_best(path[depth], depth, idx, route->prefix_len)) {
+      if (ip6_fib_route_usable(route, netif)) {
+        return route;
+      }
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Select the next hop of a route for a flow, see ip4_fib_select().
+ *
+ * @param route a route returned by ip6_fib_lookup() or ip6_fib_lookup_usable()
+ * @param flow_hash hash of the flow (see ip_flow_hash())
+ * @param netif NULL to select among the paths through netifs that are up and
+ *              have a link, else only among the paths through this netif
+ * @return the selected path or NULL if no path is usable
+ */
+const struct ip6_fib_path *
+ip6_fib_select(const struct ip6_fib_route *route, u32_t flow_hash, const struct netif *netif)
+{
+  const struct ip6_fib_path *path = NULL;
+  u32_t total = 0;
+  u32_t point;
+  u8_t i;
+
+  for (i = 0; i < route->num_paths; i++) {
+    path = &route->path[i];
+    if (IP6_FIB_PATH_USABLE(path, netif)) {
+      total += path->weight;
+    }
+  }
+  if (total == 0) {
+    return NULL;
+  }
+  point = ((flow_hash >> 16) * total) >> 16;
+  for (i = 0; i < route->num_paths; i++) {
+    path = &route->path[i];
+    if (IP6_FIB_PATH_USABLE(path, netif)) {
+      if (point < path->weight) {
+        break;
+      }
+      point -= path->weight;
+    }
+  }
+  LWIP_ASSERT("point beyond the weights", i < route->num_paths);
+  return path;
+}
+
+static void
+ip6_fib_walk(const struct ip6_fib_node *node, ip6_fib_foreach_fn fn, void *arg)
+{
+  const struct ip6_fib_route *route;
+  u16_t i;
+
+  /* the depth of the trie is limited to IP6_FIB_LEVELS nodes */
+  for (route = node->routes; route != NULL; route = route->next) {
+    fn(route, arg);
+  }
+  for (i = 0; i < IP6_FIB_NODE_SLOTS; i++) {
+    if (node->slot[i].child != NULL) {
+      ip6_fib_walk(node->slot[i].child, fn, arg);
+    }
+  }
+}
+
+/**
+ * @ingroup ip6_fib
+ * Call a function for every route in the FIB. A route is reported before
+ * the longer prefixes it contains. The FIB must not be changed from the
+ * callback.
+ *
+ * @param fn function to call
+ * @param arg argument passed to fn
+ */
+void
+ip6_fib_foreach(ip6_fib_foreach_fn fn, void *arg)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ASSERT("fn != NULL", fn != NULL);
+
+  ip6_fib_walk(&ip6_fib_root, fn, arg);
+}
+
+/**
+ * @ingroup ip6_fib
+ * Number of routes in the FIB.
+ */
+u16_t
+ip6_fib_num_routes(void)
+{
+  return ip6_fib_routes;
+}
+
+/** Remove the paths through netif below node, return 1 if node is empty */
+static u8_t
+ip6_fib_prune(struct ip6_fib_node *node, u8_t depth, struct netif *netif)
+{
+  struct ip6_fib_route *route, *next;
+  u16_t i, n;
+
+  for (i = 0; i < IP6_FIB_NODE_SLOTS; i++) {
+    if ((node->slot[i].child != NULL) && ip6_fib_prune(node->slot[i].child, (u8_t)(depth + 1), netif)) {
+      memp_free(MEMP_IP6_FIB_NODE, node->slot[i].child);
+      node->slot[i].child = NULL;
+      node->used--;
+    }
+  }
+  for (route = node->routes; route != NULL; route = next) {
+    next = route->next;
+    for (i = 0, n = 0; i < route->num_paths; i++) {
+      if (route->path[i].netif != netif) {
+        route->path[n++] = route->path[i];
+      }
+    }
+    route->num_paths = (u8_t)n;
+    if (n == 0) {
+      ip6_fib_node_remove(node, depth, route);
+    }
+  }
+  return node->used == 0;
+}
+
+/**
+ * @ingroup ip6_fib
+ * Remove all next hops through a netif, and the routes left without next
+ * hops. Called by netif_remove().
+ *
+ * @param netif the netif that goes away
+ */
+void
+ip6_fib_remove_netif(struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  ip6_fib_prune(&ip6_fib_root, 0, netif);
+  ip_flow_flush();
+}
+
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
@@ -62,6 +62,11 @@
 #define IP_REASS_CHECK_OVERLAP 1
 #endif /* IP_REASS_CHECK_OVERLAP */
 
+#if IP_REASS_HASH_SIZE && !IP_REASS_CHECK_OVERLAP
+/* completion is detected by counting the received bytes */
+#error "IP_REASS_HASH_SIZE needs IP_REASS_CHECK_OVERLAP"
+#endif
+
 /** Set to 0 to prevent freeing the oldest datagram when the reassembly buffer is
  * full (IP_REASS_MAX_PBUFS pbufs are enqueued). The code gets a little smaller.
  * Datagrams will be freed by timeout only. Especially useful when MEMP_NUM_REASSDATA
@@ -102,13 +107,55 @@ PACK_STRUCT_END
 /* static variables */
 static struct ip6_reassdata *reassdatagrams;
 static u16_t ip6_reass_pbufcount;
+#if IP_REASS_HASH_SIZE
+/* the oldest datagram (reassdatagrams is sorted by age) */
+static struct ip6_reassdata *reassdatagrams_tail;
+static struct ip6_reassdata *ip6_reass_hash_table[IP_REASS_HASH_SIZE];
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/* pbufs enqueued per hash bucket of the source address */
+static u16_t ip6_reass_src_pbufcount[IP_REASS_HASH_SIZE];
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 
 /* Forward declarations. */
 static void ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr);
+static void ip6_reass_dequeue_datagram(struct ip6_reassdata *ipr, struct ip6_reassdata *prev);
 #if IP_REASS_FREE_OLDEST
 static void ip6_reass_remove_oldest_datagram(struct ip6_reassdata *ipr, int pbufs_needed);
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_HASH_SIZE
+/** Hash an IPv6 address (the zone is not hashed) */
+static u32_t
+ip6_reass_hash_addr(u32_t h, const ip6_addr_p_t *addr)
+{
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    h = (u32_t)((h ^ addr->addr[i]) * 0x9E3779B1UL);
+  }
+  return h;
+}
+
+/** Hash the fields identifying a datagram to its bucket */
+static u16_t
+ip6_reass_hash(u32_t identification, const ip6_addr_p_t *src, const ip6_addr_p_t *dest)
+{
+  u32_t h = ip6_reass_hash_addr(ip6_reass_hash_addr((u32_t)(identification * 0x9E3779B1UL), src), dest);
+  return (u16_t)((h ^ (h >> 16)) & (IP_REASS_HASH_SIZE - 1));
+}
+
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/** Hash the source address to its bucket in ip6_reass_src_pbufcount */
+static u16_t
+ip6_reass_src_hash(const ip6_addr_p_t *src)
+{
+  u32_t h = ip6_reass_hash_addr(0, src);
+  return (u16_t)((h ^ (h >> 16)) & (IP_REASS_HASH_SIZE - 1));
+}
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
+
 void
 ip6_reass_tmr(void)
 {
@@ -147,7 +194,6 @@ ip6_reass_tmr(void)
 static void
 ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr)
 {
-  struct ip6_reassdata *prev;
   u16_t pbufs_freed = 0;
   u16_t clen;
   struct pbuf *p;
@@ -202,25 +248,57 @@ ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr)
   }
 
   /* Then, unchain the struct ip6_reassdata from the list and free it. */
+  ip6_reass_dequeue_datagram(ipr, NULL);
+
+  /* Finally, update number of pbufs in reassembly queue */
+  LWIP_ASSERT("ip_reass_pbufcount >= clen", ip6_reass_pbufcount >= pbufs_freed);
+  ip6_reass_pbufcount = (u16_t)(ip6_reass_pbufcount - pbufs_freed);
+}
+
+/**
+ * Dequeues a datagram from the datagram queue and frees it. Doesn't
+ * deallocate the pbufs.
+ *
+ * @param ipr datagram to dequeue
+ * @param prev the previous datagram in the list, NULL to search it
+ */
+static void
+ip6_reass_dequeue_datagram(struct ip6_reassdata *ipr, struct ip6_reassdata *prev)
+{
+#if IP_REASS_HASH_SIZE
+  struct ip6_reassdata **pipr;
+
+  for (pipr = &ip6_reass_hash_table[ipr->hash]; *pipr != ipr; pipr = &(*pipr)->hash_next) {
+    LWIP_ASSERT("datagram in its hash chain", *pipr != NULL);
+  }
+  *pipr = ipr->hash_next;
+  prev = ipr->prev;
+  if (ipr->next != NULL) {
+    ipr->next->prev = prev;
+  } else {
+    reassdatagrams_tail = prev;
+  }
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  LWIP_ASSERT("ip6_reass_src_pbufcount >= clen", ip6_reass_src_pbufcount[ipr->src_hash] >= ipr->clen);
+  ip6_reass_src_pbufcount[ipr->src_hash] = (u16_t)(ip6_reass_src_pbufcount[ipr->src_hash] - ipr->clen);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
+
   if (ipr == reassdatagrams) {
+    /* it was the first in the list */
     reassdatagrams = ipr->next;
   } else {
-    prev = reassdatagrams;
-    while (prev != NULL) {
-      if (prev->next == ipr) {
-        break;
+    if (prev == NULL) {
+      for (prev = reassdatagrams; prev != NULL; prev = prev->next) {
+        if (prev->next == ipr) {
+          break;
+        }
       }
-      prev = prev->next;
-    }
-    if (prev != NULL) {
-      prev->next = ipr->next;
     }
+    LWIP_ASSERT("sanity check linked list", prev != NULL);
+    prev->next = ipr->next;
   }
   memp_free(MEMP_IP6_REASSDATA, ipr);
-
-  /* Finally, update number of pbufs in reassembly queue */
-  LWIP_ASSERT("ip_reass_pbufcount >= clen", ip6_reass_pbufcount >= pbufs_freed);
-  ip6_reass_pbufcount = (u16_t)(ip6_reass_pbufcount - pbufs_freed);
 }
 
 #if IP_REASS_FREE_OLDEST
@@ -235,6 +313,22 @@ ip6_reass_free_complete_datagram(struct ip6_reassdata *ipr)
 static void
 ip6_reass_remove_oldest_datagram(struct ip6_reassdata *ipr, int pbufs_needed)
 {
+#if IP_REASS_HASH_SIZE
+  /* the list is sorted by age: free from its tail */
+  struct ip6_reassdata *oldest;
+
+  do {
+    oldest = reassdatagrams_tail;
+    if (oldest == ipr) {
+      /* don't free the current datagram */
+      oldest = oldest->prev;
+    }
+    if (oldest == NULL) {
+      return;
+    }
+    ip6_reass_free_complete_datagram(oldest);
+  } while ((ip6_reass_pbufcount + pbufs_needed) > IP_REASS_MAX_PBUFS);
+#else /* IP_REASS_HASH_SIZE */
   struct ip6_reassdata *r, *oldest;
 
   /* Free datagrams until being allowed to enqueue 'pbufs_needed' pbufs,
@@ -258,9 +352,34 @@ ip6_reass_remove_oldest_datagram(struct ip6_reassdata *ipr, int pbufs_needed)
       ip6_reass_free_complete_datagram(oldest);
     }
   } while (((ip6_reass_pbufcount + pbufs_needed) > IP_REASS_MAX_PBUFS) && (reassdatagrams != NULL));
+#endif /* IP_REASS_HASH_SIZE */
 }
 #endif /* IP_REASS_FREE_OLDEST */
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/**
+ * Free the oldest datagrams of a source until 'pbufs_needed' more pbufs fit
+ * into IP_REASS_MAX_PBUFS_PER_SRC. The datagram ipr is not freed!
+ *
+ * @param ipr ip6_reassdata for the current fragment (NULL if none yet)
+ * @param src_hash hash bucket of the source address
+ * @param pbufs_needed number of pbufs needed to enqueue
+ */
+static void
+ip6_reass_remove_oldest_of_source(struct ip6_reassdata *ipr, u16_t src_hash, int pbufs_needed)
+{
+  struct ip6_reassdata *r, *prev;
+
+  for (r = reassdatagrams_tail; (r != NULL) &&
+       ((ip6_reass_src_pbufcount[src_hash] + pbufs_needed) > IP_REASS_MAX_PBUFS_PER_SRC); r = prev) {
+    prev = r->prev;
+    if ((r->src_hash == src_hash) && (r != ipr)) {
+      ip6_reass_free_complete_datagram(r);
+    }
+  }
+}
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
 /**
  * Reassembles incoming IPv6 fragments into an IPv6 datagram.
  *
@@ -279,6 +398,12 @@ ip6_reass(struct pbuf *p)
   u16_t clen;
   u8_t valid = 1;
   struct pbuf *q, *next_pbuf;
+#if IP_REASS_HASH_SIZE
+  u16_t hash;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  u16_t src_hash;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 
   IP6_FRAG_STATS_INC(ip6_frag.recv);
 
@@ -315,7 +440,13 @@ ip6_reass(struct pbuf *p)
 
   /* Look for the datagram the fragment belongs to in the current datagram queue,
    * remembering the previous in the queue for later dequeueing. */
+#if IP_REASS_HASH_SIZE
+  hash = ip6_reass_hash(frag_hdr->_identification, &ip6_current_header()->src, &ip6_current_header()->dest);
+  ipr_prev = NULL;
+  for (ipr = ip6_reass_hash_table[hash]; ipr != NULL; ipr = ipr->hash_next) {
+#else /* IP_REASS_HASH_SIZE */
   for (ipr = reassdatagrams, ipr_prev = NULL; ipr != NULL; ipr = ipr->next) {
+#endif /* IP_REASS_HASH_SIZE */
     /* Check if the incoming fragment matches the one currently present
        in the reassembly buffer. If so, we proceed with copying the
        fragment into the buffer. */
@@ -325,9 +456,23 @@ ip6_reass(struct pbuf *p)
       IP6_FRAG_STATS_INC(ip6_frag.cachehit);
       break;
     }
+#if !IP_REASS_HASH_SIZE
     ipr_prev = ipr;
+#endif /* !IP_REASS_HASH_SIZE */
   }
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  /* Check if the source is allowed to enqueue more. */
+  src_hash = ip6_reass_src_hash(&ip6_current_header()->src);
+  if ((ip6_reass_src_pbufcount[src_hash] + clen) > IP_REASS_MAX_PBUFS_PER_SRC) {
+    ip6_reass_remove_oldest_of_source(ipr, src_hash, clen);
+    if ((ip6_reass_src_pbufcount[src_hash] + clen) > IP_REASS_MAX_PBUFS_PER_SRC) {
+      IP6_FRAG_STATS_INC(ip6_frag.memerr);
+      goto nullreturn;
+    }
+  }
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
   if (ipr == NULL) {
   /* Enqueue a new datagram into the datagram queue */
     ipr = (struct ip6_reassdata *)memp_malloc(MEMP_IP6_REASSDATA);
@@ -337,12 +482,14 @@ ip6_reass(struct pbuf *p)
       ip6_reass_remove_oldest_datagram(ipr, clen);
       ipr = (struct ip6_reassdata *)memp_malloc(MEMP_IP6_REASSDATA);
       if (ipr != NULL) {
+#if !IP_REASS_HASH_SIZE
         /* re-search ipr_prev since it might have been removed */
         for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
           if (ipr_prev->next == ipr) {
             break;
           }
         }
+#endif /* !IP_REASS_HASH_SIZE */
       } else
 #endif /* IP_REASS_FREE_OLDEST */
       {
@@ -356,6 +503,19 @@ ip6_reass(struct pbuf *p)
 
     /* enqueue the new structure to the front of the list */
     ipr->next = reassdatagrams;
+#if IP_REASS_HASH_SIZE
+    if (reassdatagrams != NULL) {
+      reassdatagrams->prev = ipr;
+    } else {
+      reassdatagrams_tail = ipr;
+    }
+    ipr->hash = hash;
+    ipr->hash_next = ip6_reass_hash_table[hash];
+    ip6_reass_hash_table[hash] = ipr;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+    ipr->src_hash = src_hash;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
     reassdatagrams = ipr;
 
     /* Use the current IPv6 header for src/dest address reference.
@@ -389,12 +549,14 @@ ip6_reass(struct pbuf *p)
 #if IP_REASS_FREE_OLDEST
     ip6_reass_remove_oldest_datagram(ipr, clen);
     if ((ip6_reass_pbufcount + clen) <= IP_REASS_MAX_PBUFS) {
+#if !IP_REASS_HASH_SIZE
       /* re-search ipr_prev since it might have been removed */
       for (ipr_prev = reassdatagrams; ipr_prev != NULL; ipr_prev = ipr_prev->next) {
         if (ipr_prev->next == ipr) {
           break;
         }
       }
+#endif /* !IP_REASS_HASH_SIZE */
     } else
 #endif /* IP_REASS_FREE_OLDEST */
     {
@@ -427,10 +589,27 @@ ip6_reass(struct pbuf *p)
   next_pbuf = NULL;
   end = (u16_t)(start + len);
 
+  q = ipr->p;
+#if IP_REASS_HASH_SIZE
+  if ((ipr->datagram_len != 0) ?
+      ((end > ipr->datagram_len) || (((offset & IP6_FRAG_MORE_FLAG) == 0) && (end != ipr->datagram_len))) :
+      (((offset & IP6_FRAG_MORE_FLAG) == 0) && (ipr->p_last != NULL) &&
+       (((struct ip6_reass_helper *)ipr->p_last->payload)->end > end))) {
+    /* beyond the end of the datagram: would break counting the received bytes */
+    IP6_FRAG_STATS_INC(ip6_frag.proterr);
+    goto nullreturn;
+  }
+  if ((ipr->p_last != NULL) && (start >= ((struct ip6_reass_helper *)ipr->p_last->payload)->end)) {
+    /* in order: append to the fragment with the highest offset */
+    iprh_prev = (struct ip6_reass_helper *)ipr->p_last->payload;
+    q = NULL;
+  }
+#endif /* IP_REASS_HASH_SIZE */
+
   /* find the right place to insert this pbuf */
   /* Iterate through until we either get to the end of the list (append),
    * or we find on with a larger offset (insert). */
-  for (q = ipr->p; q != NULL;) {
+  while (q != NULL) {
     iprh_tmp = (struct ip6_reass_helper*)q->payload;
     if (start < iprh_tmp->start) {
 #if IP_REASS_CHECK_OVERLAP
@@ -452,6 +631,11 @@ ip6_reass(struct pbuf *p)
       if (iprh_prev != NULL) {
         /* not the fragment with the lowest offset */
         iprh_prev->next_pbuf = p;
+        if (iprh_prev->end != start) {
+          /* There is a fragment missing between the current
+           * and the previous fragment */
+          valid = 0;
+        }
       } else {
         /* fragment with the lowest offset */
         ipr->p = p;
@@ -500,11 +684,21 @@ ip6_reass(struct pbuf *p)
       /* this is the first fragment we ever received for this ip datagram */
       ipr->p = p;
     }
+#if IP_REASS_HASH_SIZE
+    ipr->p_last = p;
+#endif /* IP_REASS_HASH_SIZE */
   }
 
   /* Track the current number of pbufs current 'in-flight', in order to limit
   the number of fragments that may be enqueued at any one time */
   ip6_reass_pbufcount = (u16_t)(ip6_reass_pbufcount + clen);
+#if IP_REASS_HASH_SIZE
+  ipr->clen = (u16_t)(ipr->clen + clen);
+  ipr->recv_len = (u16_t)(ipr->recv_len + len);
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  ip6_reass_src_pbufcount[src_hash] = (u16_t)(ip6_reass_src_pbufcount[src_hash] + clen);
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
 
   /* Remember IPv6 header if this is the first fragment. */
   if (start == 0) {
@@ -527,6 +721,11 @@ ip6_reass(struct pbuf *p)
     ipr->datagram_len = iprh->end;
   }
 
+#if IP_REASS_HASH_SIZE
+  /* fragments neither overlap nor exceed the datagram: it is complete when
+     all of its bytes were received */
+  valid = (ipr->datagram_len != 0) && (ipr->recv_len == ipr->datagram_len);
+#else /* IP_REASS_HASH_SIZE */
   /* Additional validity tests: we have received first and last fragment. */
   iprh_tmp = (struct ip6_reass_helper*)ipr->p->payload;
   if (iprh_tmp->start != 0) {
@@ -548,6 +747,7 @@ ip6_reass(struct pbuf *p)
     iprh_prev = iprh;
     q = iprh->next_pbuf;
   }
+#endif /* IP_REASS_HASH_SIZE */
 
   if (valid) {
     /* All fragments have been received */
@@ -635,15 +835,7 @@ ip6_reass(struct pbuf *p)
     }
 
     /* release the resources allocated for the fragment queue entry */
-    if (reassdatagrams == ipr) {
-      /* it was the first in the list */
-      reassdatagrams = ipr->next;
-    } else {
-      /* it wasn't the first, so it must have a valid 'prev' */
-      LWIP_ASSERT("sanity check linked list", ipr_prev != NULL);
-      ipr_prev->next = ipr->next;
-    }
-    memp_free(MEMP_IP6_REASSDATA, ipr);
+    ip6_reass_dequeue_datagram(ipr, ipr_prev);
 
     /* adjust the number of pbufs currently queued for reassembly. */
     clen = pbuf_clen(p);
@@ -788,8 +980,8 @@ ip6_frag(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
 
     /* Can just adjust p directly for needed offset. */
     p->payload = (u8_t *)p->payload + poff;
-    p->len = (u16_t)(p->len - poff);
-    p->tot_len = (u16_t)(p->tot_len - poff);
+    p->len = (pbuf_len_t)(p->len - poff);
+    p->tot_len = (pbuf_len_t)(p->tot_len - poff);
 
     left_to_copy = cop;
     while (left_to_copy) {
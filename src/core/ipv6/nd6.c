@@ -54,6 +54,8 @@
 #include "lwip/memp.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
+#include "lwip/ip6_fib.h"
+#include "lwip/ip_flow.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
 #include "lwip/icmp6.h"
@@ -102,6 +104,37 @@ u8_t nd6_queue_size = 0;
 /* Index for cache entries. */
 static netif_addr_idx_t nd6_cached_destination_index;
 
+/* Number of neighbor and destination cache entries in use, see nd6_set_cache_sizes() */
+static u8_t nd6_num_neighbors = LWIP_ND6_NUM_NEIGHBORS;
+static u16_t nd6_num_destinations = LWIP_ND6_NUM_DESTINATIONS;
+
+#if LWIP_ND6_CACHE_HASH_SIZE
+/** Links of a cache entry in the hash index (-1: none) */
+struct nd6_cache_link {
+  /** next entry in the same hash bucket, or in the free list */
+  s16_t next;
+  /** neighbours in the LRU list */
+  s16_t lru_prev;
+  s16_t lru_next;
+};
+
+/** Hash index, LRU list and free list of one cache (-1: none) */
+struct nd6_cache_index {
+  s16_t bucket[LWIP_ND6_CACHE_HASH_SIZE];
+  /** entries in use, most recently used first */
+  s16_t lru_head;
+  s16_t lru_tail;
+  /** unused entries below the current cache size */
+  s16_t free;
+  struct nd6_cache_link *link;
+};
+
+static struct nd6_cache_link nd6_neighbor_link[LWIP_ND6_NUM_NEIGHBORS];
+static struct nd6_cache_link nd6_destination_link[LWIP_ND6_NUM_DESTINATIONS];
+static struct nd6_cache_index nd6_neighbor_index;
+static struct nd6_cache_index nd6_destination_index;
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /* Multicast address holder. */
 static ip6_addr_t multicast_address;
 
@@ -120,10 +153,11 @@ static union ra_options nd6_ra_buffer;
 
 /* Forward declarations. */
 static s8_t nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr);
-static s8_t nd6_new_neighbor_cache_entry(void);
+static s8_t nd6_new_neighbor_cache_entry(const ip6_addr_t *ip6addr);
 static void nd6_free_neighbor_cache_entry(s8_t i);
 static s16_t nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr);
-static s16_t nd6_new_destination_cache_entry(void);
+static s16_t nd6_new_destination_cache_entry(const ip6_addr_t *ip6addr);
+static void nd6_free_destination_cache_entry(s16_t i);
 static int nd6_is_prefix_in_netif(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_select_router(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_get_router(const ip6_addr_t *router_addr, struct netif *netif);
@@ -387,6 +421,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
       if (i >= 0) {
         if (na_hdr->flags & ND6_FLAG_OVERRIDE) {
           MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
+          ip_flow_flush();
         }
       }
     } else {
@@ -425,6 +460,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
         }
 
         MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
+        ip_flow_flush();
       }
 
       neighbor_cache[i].netif = inp;
@@ -542,7 +578,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
         /* Add their IPv6 address and link-layer address to neighbor cache.
          * We will need it at least to send a unicast NA message, but most
          * likely we will also be communicating with this node soon. */
-        i = nd6_new_neighbor_cache_entry();
+        i = nd6_new_neighbor_cache_entry(ip6_current_src_addr());
         if (i < 0) {
           /* We couldn't assign a cache entry for this neighbor.
            * we won't be able to reply. drop it. */
@@ -552,7 +588,6 @@ nd6_input(struct pbuf *p, struct netif *inp)
         }
         neighbor_cache[i].netif = inp;
         MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
-        ip6_addr_set(&(neighbor_cache[i].next_hop_address), ip6_current_src_addr());
 
         /* Receiving a message does not prove reachability: only in one direction.
          * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
@@ -876,17 +911,17 @@ nd6_input(struct pbuf *p, struct netif *inp)
 
     /* Set the new target address. */
     ip6_addr_copy(destination_cache[dest_idx].next_hop_addr, target_address);
+    ip_flow_flush();
 
     /* If Link-layer address of other router is given, try to add to neighbor cache. */
     if (lladdr_opt != NULL) {
       if (lladdr_opt->type == ND6_OPTION_TYPE_TARGET_LLADDR) {
         i = nd6_find_neighbor_cache_entry(&target_address);
         if (i < 0) {
-          i = nd6_new_neighbor_cache_entry();
+          i = nd6_new_neighbor_cache_entry(&target_address);
           if (i >= 0) {
             neighbor_cache[i].netif = inp;
             MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
-            ip6_addr_copy(neighbor_cache[i].next_hop_address, target_address);
 
             /* Receiving a message does not prove reachability: only in one direction.
              * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
@@ -977,7 +1012,7 @@ nd6_tmr(void)
   struct netif *netif;
 
   /* Process neighbor entries. */
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     switch (neighbor_cache[i].state) {
     case ND6_INCOMPLETE:
       if ((neighbor_cache[i].counter.probes_sent >= LWIP_ND6_MAX_MULTICAST_SOLICIT) &&
@@ -999,6 +1034,8 @@ nd6_tmr(void)
         /* Change to stale state. */
         neighbor_cache[i].state = ND6_STALE;
         neighbor_cache[i].counter.stale_time = 0;
+        /* forwarded flows have to go through nd6 again to trigger NUD */
+        ip_flow_flush();
       } else {
         neighbor_cache[i].counter.reachable_time -= ND6_TMR_INTERVAL;
       }
@@ -1033,10 +1070,16 @@ nd6_tmr(void)
     }
   }
 
-  /* Process destination entries. */
-  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
-    destination_cache[i].age++;
+#if !LWIP_ND6_CACHE_HASH_SIZE
+  /* Process destination entries. With the hash index, their order in the LRU
+   * list takes the place of the age. */
+  {
+    s16_t j;
+    for (j = 0; j < nd6_num_destinations; j++) {
+      destination_cache[j].age++;
+    }
   }
+#endif /* !LWIP_ND6_CACHE_HASH_SIZE */
 
   /* Process router entries. */
   for (i = 0; i < LWIP_ND6_NUM_ROUTERS; i++) {
@@ -1045,17 +1088,19 @@ nd6_tmr(void)
       if (default_router_list[i].invalidation_timer <= ND6_TMR_INTERVAL / 1000) {
         /* No more than 1 second remaining. Clear this entry. Also clear any of
          * its destination cache entries, as per RFC 4861 Sec. 5.3 and 6.3.5. */
-        s8_t j;
-        for (j = 0; j < LWIP_ND6_NUM_DESTINATIONS; j++) {
-          if (ip6_addr_eq(&destination_cache[j].next_hop_addr,
+        s16_t j;
+        for (j = 0; j < nd6_num_destinations; j++) {
+          if (!ip6_addr_isany(&destination_cache[j].destination_addr) &&
+              ip6_addr_eq(&destination_cache[j].next_hop_addr,
                &default_router_list[i].neighbor_entry->next_hop_address)) {
-             ip6_addr_set_any(&destination_cache[j].destination_addr);
+             nd6_free_destination_cache_entry(j);
           }
         }
         default_router_list[i].neighbor_entry->isrouter = 0;
         default_router_list[i].neighbor_entry = NULL;
         default_router_list[i].invalidation_timer = 0;
         default_router_list[i].flags = 0;
+        ip_flow_flush();
       } else {
         default_router_list[i].invalidation_timer -= ND6_TMR_INTERVAL / 1000;
       }
@@ -1069,6 +1114,7 @@ nd6_tmr(void)
         /* Entry timed out, remove it */
         prefix_list[i].invalidation_timer = 0;
         prefix_list[i].netif = NULL;
+        ip_flow_flush();
       } else {
         prefix_list[i].invalidation_timer -= ND6_TMR_INTERVAL / 1000;
       }
@@ -1417,6 +1463,142 @@ nd6_send_rs(struct netif *netif)
 }
 #endif /* LWIP_IPV6_SEND_ROUTER_SOLICIT */
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+/**
+ * Reset the hash index of a cache whose entries are all unused.
+ *
+ * @param idx the cache index
+ * @param link the links of the cache entries
+ * @param num number of entries in use (all of them go to the free list)
+ */
+static void
+nd6_cache_reset(struct nd6_cache_index *idx, struct nd6_cache_link *link, s16_t num)
+{
+  s16_t i;
+
+  for (i = 0; i < LWIP_ND6_CACHE_HASH_SIZE; i++) {
+    idx->bucket[i] = -1;
+  }
+  idx->lru_head = -1;
+  idx->lru_tail = -1;
+  idx->link = link;
+  /* hand out the lowest entries first */
+  idx->free = -1;
+  for (i = num - 1; i >= 0; i--) {
+    link[i].next = idx->free;
+    idx->free = i;
+  }
+}
+
+/** Hash an IPv6 address to its bucket (the zone is not hashed) */
+static u16_t
+nd6_cache_hash(const ip6_addr_t *ip6addr)
+{
+  u32_t h = 0;
+  int i;
+
+  for (i = 0; i < 4; i++) {
+    h = (u32_t)((h ^ ip6addr->addr[i]) * 0x9E3779B1UL);
+  }
+  return (u16_t)((h ^ (h >> 16)) & (LWIP_ND6_CACHE_HASH_SIZE - 1));
+}
+
+/** Remove an entry from the LRU list */
+static void
+nd6_cache_lru_unlink(struct nd6_cache_index *idx, s16_t i)
+{
+  s16_t prev = idx->link[i].lru_prev;
+  s16_t next = idx->link[i].lru_next;
+
+  if (prev >= 0) {
+    idx->link[prev].lru_next = next;
+  } else {
+    idx->lru_head = next;
+  }
+  if (next >= 0) {
+    idx->link[next].lru_prev = prev;
+  } else {
+    idx->lru_tail = prev;
+  }
+}
+
+/** Insert an entry at the head (most recently used end) of the LRU list */
+static void
+nd6_cache_lru_push(struct nd6_cache_index *idx, s16_t i)
+{
+  idx->link[i].lru_prev = -1;
+  idx->link[i].lru_next = idx->lru_head;
+  if (idx->lru_head >= 0) {
+    idx->link[idx->lru_head].lru_prev = i;
+  } else {
+    idx->lru_tail = i;
+  }
+  idx->lru_head = i;
+}
+
+/** Mark an entry as most recently used */
+static void
+nd6_cache_touch(struct nd6_cache_index *idx, s16_t i)
+{
+  if (idx->lru_head != i) {
+    nd6_cache_lru_unlink(idx, i);
+    nd6_cache_lru_push(idx, i);
+  }
+}
+
+/** Take an entry off the free list, -1 if there is none */
+static s16_t
+nd6_cache_alloc(struct nd6_cache_index *idx)
+{
+  s16_t i = idx->free;
+
+  if (i >= 0) {
+    idx->free = idx->link[i].next;
+  }
+  return i;
+}
+
+/** Add a newly allocated entry to the hash index and the LRU list */
+static void
+nd6_cache_link_entry(struct nd6_cache_index *idx, s16_t i, const ip6_addr_t *ip6addr)
+{
+  u16_t bucket = nd6_cache_hash(ip6addr);
+
+  idx->link[i].next = idx->bucket[bucket];
+  idx->bucket[bucket] = i;
+  nd6_cache_lru_push(idx, i);
+}
+
+/** Move an entry from the hash index and the LRU list to the free list */
+static void
+nd6_cache_unlink_entry(struct nd6_cache_index *idx, s16_t i, const ip6_addr_t *ip6addr)
+{
+  s16_t *pi = &idx->bucket[nd6_cache_hash(ip6addr)];
+
+  while (*pi >= 0) {
+    if (*pi == i) {
+      *pi = idx->link[i].next;
+      break;
+    }
+    pi = &idx->link[*pi].next;
+  }
+  nd6_cache_lru_unlink(idx, i);
+  idx->link[i].next = idx->free;
+  idx->free = i;
+}
+
+/**
+ * Initialize the hash index of the neighbor and destination caches.
+ * Called from lwip_init().
+ */
+void
+nd6_init(void)
+{
+  nd6_cache_reset(&nd6_neighbor_index, nd6_neighbor_link, nd6_num_neighbors);
+  nd6_cache_reset(&nd6_destination_index, nd6_destination_link, (s16_t)nd6_num_destinations);
+}
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /**
  * Search for a neighbor cache entry
  *
@@ -1427,26 +1609,95 @@ nd6_send_rs(struct netif *netif)
 static s8_t
 nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr)
 {
+#if LWIP_ND6_CACHE_HASH_SIZE
+  s16_t i;
+  for (i = nd6_neighbor_index.bucket[nd6_cache_hash(ip6addr)]; i >= 0; i = nd6_neighbor_link[i].next) {
+    if (ip6_addr_eq(ip6addr, &(neighbor_cache[i].next_hop_address))) {
+      return (s8_t)i;
+    }
+  }
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
   s8_t i;
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if (ip6_addr_eq(ip6addr, &(neighbor_cache[i].next_hop_address))) {
       return i;
     }
   }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   return -1;
 }
 
+#if LWIP_ND6_CACHE_HASH_SIZE
 /**
- * Create a new neighbor cache entry.
+ * Get an unused neighbor cache entry.
+ *
+ * If no unused entry is left, recycle the least recently used entry
+ * that is not a router, in the same order of preference as the linear
+ * cache: stale, probe, delay, reachable, then incomplete entries
+ * (without queued packets first).
+ *
+ * @return The index of the unused entry, -1 if no entry could be found
+ */
+static s8_t
+nd6_alloc_neighbor_cache_entry(void)
+{
+  s16_t i, j;
+  u8_t rank, best_rank;
+
+  i = nd6_cache_alloc(&nd6_neighbor_index);
+  if (i >= 0) {
+    return (s8_t)i;
+  }
+
+  j = -1;
+  best_rank = 6;
+  for (i = nd6_neighbor_index.lru_tail; i >= 0; i = nd6_neighbor_link[i].lru_prev) {
+    if (neighbor_cache[i].isrouter) {
+      continue;
+    }
+    switch (neighbor_cache[i].state) {
+      case ND6_STALE:
+        rank = 0;
+        break;
+      case ND6_PROBE:
+        rank = 1;
+        break;
+      case ND6_DELAY:
+        rank = 2;
+        break;
+      case ND6_REACHABLE:
+        rank = 3;
+        break;
+      default:
+        rank = (neighbor_cache[i].q == NULL) ? 4 : 5;
+        break;
+    }
+    if (rank < best_rank) {
+      j = i;
+      best_rank = rank;
+      if (rank == 0) {
+        break;
+      }
+    }
+  }
+  if (j < 0) {
+    /* No more entries to try. */
+    return -1;
+  }
+  nd6_free_neighbor_cache_entry((s8_t)j);
+  return (s8_t)nd6_cache_alloc(&nd6_neighbor_index);
+}
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+/**
+ * Get an unused neighbor cache entry.
  *
  * If no unused entry is found, will try to recycle an old entry
  * according to ad-hoc "age" heuristic.
  *
- * @return The neighbor cache entry index that was created, -1 if no
- * entry could be created
+ * @return The index of the unused entry, -1 if no entry could be found
  */
 static s8_t
-nd6_new_neighbor_cache_entry(void)
+nd6_alloc_neighbor_cache_entry(void)
 {
   s8_t i;
   s8_t j;
@@ -1454,7 +1705,7 @@ nd6_new_neighbor_cache_entry(void)
 
 
   /* First, try to find an empty entry. */
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if (neighbor_cache[i].state == ND6_NO_ENTRY) {
       return i;
     }
@@ -1463,7 +1714,7 @@ nd6_new_neighbor_cache_entry(void)
   /* We need to recycle an entry. in general, do not recycle if it is a router. */
 
   /* Next, try to find a Stale entry. */
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if ((neighbor_cache[i].state == ND6_STALE) &&
         (!neighbor_cache[i].isrouter)) {
       nd6_free_neighbor_cache_entry(i);
@@ -1472,7 +1723,7 @@ nd6_new_neighbor_cache_entry(void)
   }
 
   /* Next, try to find a Probe entry. */
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if ((neighbor_cache[i].state == ND6_PROBE) &&
         (!neighbor_cache[i].isrouter)) {
       nd6_free_neighbor_cache_entry(i);
@@ -1481,7 +1732,7 @@ nd6_new_neighbor_cache_entry(void)
   }
 
   /* Next, try to find a Delayed entry. */
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if ((neighbor_cache[i].state == ND6_DELAY) &&
         (!neighbor_cache[i].isrouter)) {
       nd6_free_neighbor_cache_entry(i);
@@ -1492,7 +1743,7 @@ nd6_new_neighbor_cache_entry(void)
   /* Next, try to find the oldest reachable entry. */
   time = 0xfffffffful;
   j = -1;
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if ((neighbor_cache[i].state == ND6_REACHABLE) &&
         (!neighbor_cache[i].isrouter)) {
       if (neighbor_cache[i].counter.reachable_time < time) {
@@ -1509,7 +1760,7 @@ nd6_new_neighbor_cache_entry(void)
   /* Next, find oldest incomplete entry without queued packets. */
   time = 0;
   j = -1;
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if (
         (neighbor_cache[i].q == NULL) &&
         (neighbor_cache[i].state == ND6_INCOMPLETE) &&
@@ -1528,7 +1779,7 @@ nd6_new_neighbor_cache_entry(void)
   /* Next, find oldest incomplete entry with queued packets. */
   time = 0;
   j = -1;
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if ((neighbor_cache[i].state == ND6_INCOMPLETE) &&
         (!neighbor_cache[i].isrouter)) {
       if (neighbor_cache[i].counter.probes_sent >= time) {
@@ -1545,6 +1796,30 @@ nd6_new_neighbor_cache_entry(void)
   /* No more entries to try. */
   return -1;
 }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
+/**
+ * Create a new neighbor cache entry.
+ *
+ * The caller has to set the state (and all other fields) of the new entry.
+ *
+ * @param ip6addr the IPv6 address of the neighbor
+ * @return The neighbor cache entry index that was created, -1 if no
+ * entry could be created
+ */
+static s8_t
+nd6_new_neighbor_cache_entry(const ip6_addr_t *ip6addr)
+{
+  s8_t i = nd6_alloc_neighbor_cache_entry();
+
+  if (i >= 0) {
+    ip6_addr_set(&(neighbor_cache[i].next_hop_address), ip6addr);
+#if LWIP_ND6_CACHE_HASH_SIZE
+    nd6_cache_link_entry(&nd6_neighbor_index, i, ip6addr);
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+  }
+  return i;
+}
 
 /**
  * Will free any resources associated with a neighbor cache
@@ -1569,11 +1844,17 @@ nd6_free_neighbor_cache_entry(s8_t i)
     neighbor_cache[i].q = NULL;
   }
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+  if (neighbor_cache[i].state != ND6_NO_ENTRY) {
+    nd6_cache_unlink_entry(&nd6_neighbor_index, i, &neighbor_cache[i].next_hop_address);
+  }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   neighbor_cache[i].state = ND6_NO_ENTRY;
   neighbor_cache[i].isrouter = 0;
   neighbor_cache[i].netif = NULL;
   neighbor_cache[i].counter.reachable_time = 0;
   ip6_addr_set_zero(&(neighbor_cache[i].next_hop_address));
+  ip_flow_flush();
 }
 
 /**
@@ -1590,7 +1871,11 @@ nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
 
   IP6_ADDR_ZONECHECK(ip6addr);
 
-  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
+#if LWIP_ND6_CACHE_HASH_SIZE
+  for (i = nd6_destination_index.bucket[nd6_cache_hash(ip6addr)]; i >= 0; i = nd6_destination_link[i].next) {
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+  for (i = 0; i < nd6_num_destinations; i++) {
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
     if (ip6_addr_eq(ip6addr, &(destination_cache[i].destination_addr))) {
       return i;
     }
@@ -1600,34 +1885,67 @@ nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
 
 /**
  * Create a new destination cache entry. If no unused entry is found,
- * will recycle oldest entry.
+ * will recycle the least recently used (or oldest) entry.
  *
+ * @param ip6addr the IPv6 address of the destination
  * @return The destination cache entry index that was created, -1 if no
  * entry was created
  */
 static s16_t
-nd6_new_destination_cache_entry(void)
+nd6_new_destination_cache_entry(const ip6_addr_t *ip6addr)
 {
-  s16_t i, j;
+  s16_t i;
+#if LWIP_ND6_CACHE_HASH_SIZE
+
+  i = nd6_cache_alloc(&nd6_destination_index);
+  if (i < 0) {
+    nd6_free_destination_cache_entry(nd6_destination_index.lru_tail);
+    i = nd6_cache_alloc(&nd6_destination_index);
+  }
+  nd6_cache_link_entry(&nd6_destination_index, i, ip6addr);
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+  s16_t j;
   u32_t age;
 
   /* Find an empty entry. */
-  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
+  for (i = 0; i < nd6_num_destinations; i++) {
     if (ip6_addr_isany(&(destination_cache[i].destination_addr))) {
-      return i;
+      break;
     }
   }
 
-  /* Find oldest entry. */
-  age = 0;
-  j = LWIP_ND6_NUM_DESTINATIONS - 1;
-  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
-    if (destination_cache[i].age > age) {
-      j = i;
+  if (i == nd6_num_destinations) {
+    /* Find oldest entry. */
+    age = 0;
+    j = (s16_t)(nd6_num_destinations - 1);
+    for (i = 0; i < nd6_num_destinations; i++) {
+      if (destination_cache[i].age > age) {
+        j = i;
+        age = destination_cache[i].age;
+      }
     }
+    i = j;
   }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 
-  return j;
+  ip6_addr_set(&destination_cache[i].destination_addr, ip6addr);
+  return i;
+}
+
+/**
+ * Mark a destination cache entry as unused.
+ *
+ * @param i the destination cache entry index to free
+ */
+static void
+nd6_free_destination_cache_entry(s16_t i)
+{
+#if LWIP_ND6_CACHE_HASH_SIZE
+  if (!ip6_addr_isany(&destination_cache[i].destination_addr)) {
+    nd6_cache_unlink_entry(&nd6_destination_index, i, &destination_cache[i].destination_addr);
+  }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+  ip6_addr_set_any(&destination_cache[i].destination_addr);
 }
 
 /**
@@ -1639,11 +1957,84 @@ nd6_new_destination_cache_entry(void)
 void
 nd6_clear_destination_cache(void)
 {
-  int i;
+#if LWIP_ND6_CACHE_HASH_SIZE
+  /* only the entries in use are in the LRU list */
+  while (nd6_destination_index.lru_head >= 0) {
+    nd6_free_destination_cache_entry(nd6_destination_index.lru_head);
+  }
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+  s16_t i;
 
-  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
+  for (i = 0; i < nd6_num_destinations; i++) {
     ip6_addr_set_any(&destination_cache[i].destination_addr);
   }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+  ip_flow_flush();
+}
+
+/**
+ * Change the number of neighbor and destination cache entries in use.
+ *
+ * LWIP_ND6_NUM_NEIGHBORS and LWIP_ND6_NUM_DESTINATIONS set the initial
+ * sizes and the upper limits. Entries beyond a reduced size are dropped,
+ * including routers known through them (they are learned again from the
+ * next router advertisement).
+ *
+ * @param num_neighbors number of neighbor cache entries to use
+ * @param num_destinations number of destination cache entries to use
+ * @return ERR_OK, or ERR_VAL if a size is 0 or above its limit
+ */
+err_t
+nd6_set_cache_sizes(u8_t num_neighbors, u16_t num_destinations)
+{
+  s16_t i;
+  s8_t router_index;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("nd6_set_cache_sizes: invalid size",
+             (num_neighbors > 0) && (num_neighbors <= LWIP_ND6_NUM_NEIGHBORS) &&
+             (num_destinations > 0) && (num_destinations <= LWIP_ND6_NUM_DESTINATIONS),
+             return ERR_VAL;);
+
+  for (i = num_neighbors; i < nd6_num_neighbors; i++) {
+    if (neighbor_cache[i].state != ND6_NO_ENTRY) {
+      for (router_index = 0; router_index < LWIP_ND6_NUM_ROUTERS; router_index++) {
+        if (default_router_list[router_index].neighbor_entry == &neighbor_cache[i]) {
+          default_router_list[router_index].neighbor_entry = NULL;
+          default_router_list[router_index].flags = 0;
+        }
+      }
+      neighbor_cache[i].isrouter = 0;
+      nd6_free_neighbor_cache_entry((s8_t)i);
+    }
+  }
+  for (i = (s16_t)num_destinations; i < nd6_num_destinations; i++) {
+    nd6_free_destination_cache_entry(i);
+  }
+  nd6_num_neighbors = num_neighbors;
+  nd6_num_destinations = num_destinations;
+  if (nd6_cached_destination_index >= num_destinations) {
+    nd6_cached_destination_index = 0;
+  }
+
+#if LWIP_ND6_CACHE_HASH_SIZE
+  /* rebuild the free lists from the unused entries in range, lowest first */
+  nd6_neighbor_index.free = -1;
+  for (i = (s16_t)(num_neighbors - 1); i >= 0; i--) {
+    if (neighbor_cache[i].state == ND6_NO_ENTRY) {
+      nd6_neighbor_link[i].next = nd6_neighbor_index.free;
+      nd6_neighbor_index.free = i;
+    }
+  }
+  nd6_destination_index.free = -1;
+  for (i = (s16_t)(num_destinations - 1); i >= 0; i--) {
+    if (ip6_addr_isany(&destination_cache[i].destination_addr)) {
+      nd6_destination_link[i].next = nd6_destination_index.free;
+      nd6_destination_index.free = i;
+    }
+  }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+  return ERR_OK;
 }
 
 /**
@@ -1841,12 +2232,11 @@ nd6_new_router(const ip6_addr_t *router_addr, struct netif *netif)
   neighbor_index = nd6_find_neighbor_cache_entry(router_addr);
   if (neighbor_index < 0) {
     /* Create a neighbor entry for this router. */
-    neighbor_index = nd6_new_neighbor_cache_entry();
+    neighbor_index = nd6_new_neighbor_cache_entry(router_addr);
     if (neighbor_index < 0) {
       /* Could not create neighbor entry for this router. */
       return -1;
     }
-    ip6_addr_set(&(neighbor_cache[neighbor_index].next_hop_address), router_addr);
     neighbor_cache[neighbor_index].netif = netif;
     neighbor_cache[neighbor_index].q = NULL;
     neighbor_cache[neighbor_index].state = ND6_INCOMPLETE;
@@ -1947,12 +2337,35 @@ nd6_new_onlink_prefix(const ip6_addr_t *prefix, struct netif *netif)
  *         suitable next hop was found, ERR_MEM if no cache entry
  *         could be created
  */
+#if LWIP_IPV6_FIB
+/** Flow hash selecting the next hop of a route for a destination */
+static u32_t
+nd6_fib_hash(const struct ip6_fib_route *route, const ip6_addr_t *ip6addr)
+{
+#if LWIP_FIB_MAX_PATHS > 1
+  if (route->num_paths > 1) {
+    ip_addr_t dest_addr;
+    ip_addr_copy_from_ip6(dest_addr, *ip6addr);
+    return ip_flow_hash(NULL, &dest_addr, 0, 0, 0);
+  }
+#else /* LWIP_FIB_MAX_PATHS > 1 */
+  LWIP_UNUSED_ARG(route);
+  LWIP_UNUSED_ARG(ip6addr);
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+  return 0;
+}
+#endif /* LWIP_IPV6_FIB */
+
 static s8_t
 nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 {
 #ifdef LWIP_HOOK_ND6_GET_GW
   const ip6_addr_t *next_hop_addr;
 #endif /* LWIP_HOOK_ND6_GET_GW */
+#if LWIP_IPV6_FIB
+  const struct ip6_fib_route *route;
+  const struct ip6_fib_path *path = NULL;
+#endif /* LWIP_IPV6_FIB */
   s8_t i;
   s16_t dst_idx;
   struct nd6_destination_cache_entry *dest;
@@ -1963,13 +2376,13 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
   if (netif->hints != NULL) {
     /* per-pcb cached entry was given */
     netif_addr_idx_t addr_hint = netif->hints->addr_hint;
-    if (addr_hint < LWIP_ND6_NUM_DESTINATIONS) {
+    if (addr_hint < nd6_num_destinations) {
       nd6_cached_destination_index = addr_hint;
     }
   }
 #endif /* LWIP_NETIF_HWADDRHINT */
 
-  LWIP_ASSERT("sane cache index", nd6_cached_destination_index < LWIP_ND6_NUM_DESTINATIONS);
+  LWIP_ASSERT("sane cache index", nd6_cached_destination_index < nd6_num_destinations);
 
   /* Look for ip6addr in destination cache. */
   dest = &destination_cache[nd6_cached_destination_index];
@@ -1987,7 +2400,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
       dest = &destination_cache[dst_idx];
     } else {
       /* Not found. Create a new destination entry. */
-      dst_idx = nd6_new_destination_cache_entry();
+      dst_idx = nd6_new_destination_cache_entry(ip6addr);
       if (dst_idx >= 0) {
         /* got new destination entry. make it our new cached index. */
         LWIP_ASSERT("type overflow", (size_t)dst_idx < NETIF_ADDR_IDX_MAX);
@@ -1998,15 +2411,25 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
         return ERR_MEM;
       }
 
-      /* Copy dest address to destination cache. */
-      ip6_addr_set(&dest->destination_addr, ip6addr);
-
       /* Now find the next hop. is it a neighbor? */
       if (ip6_addr_islinklocal(ip6addr) ||
           nd6_is_prefix_in_netif(ip6addr, netif)) {
         /* Destination in local link. */
         dest->pmtu = netif_mtu6(netif);
         ip6_addr_copy(dest->next_hop_addr, dest->destination_addr);
+#if LWIP_IPV6_FIB
+      } else if (((route = ip6_fib_lookup_usable(ip6addr, netif)) != NULL) &&
+                 ((path = ip6_fib_select(route, nd6_fib_hash(route, ip6addr), netif)) != NULL)) {
+        /* Next hop from the routing table, none for a directly connected network.
+           Several gateways on this netif are selected per destination, as this
+           is what the destination cache remembers. */
+        dest->pmtu = netif_mtu6(netif);
+        if (ip6_addr_isany_val(path->gw)) {
+          ip6_addr_copy(dest->next_hop_addr, dest->destination_addr);
+        } else {
+          ip6_addr_copy(dest->next_hop_addr, path->gw);
+        }
+#endif /* LWIP_IPV6_FIB */
 #ifdef LWIP_HOOK_ND6_GET_GW
       } else if ((next_hop_addr = LWIP_HOOK_ND6_GET_GW(netif, ip6addr)) != NULL) {
         /* Next hop for destination provided by hook function. */
@@ -2018,7 +2441,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
         i = nd6_select_router(ip6addr, netif);
         if (i < 0) {
           /* No router found. */
-          ip6_addr_set_any(&dest->destination_addr);
+          nd6_free_destination_cache_entry(dst_idx);
           return ERR_RTE;
         }
         dest->pmtu = netif_mtu6(netif); /* Start with netif mtu, correct through ICMPv6 if necessary */
@@ -2046,7 +2469,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
       dest->cached_neighbor_idx = i;
     } else {
       /* Neighbor not in cache. Make a new entry. */
-      i = nd6_new_neighbor_cache_entry();
+      i = nd6_new_neighbor_cache_entry(&dest->next_hop_addr);
       if (i >= 0) {
         /* got new neighbor entry. make it our new cached index. */
         dest->cached_neighbor_idx = i;
@@ -2056,7 +2479,6 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
       }
 
       /* Initialize fields. */
-      ip6_addr_copy(neighbor_cache[i].next_hop_address, dest->next_hop_addr);
       neighbor_cache[i].isrouter = 0;
       neighbor_cache[i].netif = netif;
       neighbor_cache[i].state = ND6_INCOMPLETE;
@@ -2067,6 +2489,10 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 
   /* Reset this destination's age. */
   dest->age = 0;
+#if LWIP_ND6_CACHE_HASH_SIZE
+  nd6_cache_touch(&nd6_destination_index, (s16_t)(dest - destination_cache));
+  nd6_cache_touch(&nd6_neighbor_index, dest->cached_neighbor_idx);
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 
   return dest->cached_neighbor_idx;
 }
@@ -2408,7 +2834,7 @@ nd6_cleanup_netif(struct netif *netif)
       prefix_list[i].netif = NULL;
     }
   }
-  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+  for (i = 0; i < nd6_num_neighbors; i++) {
     if (neighbor_cache[i].netif == netif) {
       for (router_index = 0; router_index < LWIP_ND6_NUM_ROUTERS; router_index++) {
         if (default_router_list[router_index].neighbor_entry == &neighbor_cache[i]) {
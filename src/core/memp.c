@@ -59,6 +59,7 @@
 #include "lwip/priv/tcp_priv.h"
 #include "lwip/altcp.h"
 #include "lwip/ip4_frag.h"
+#include "lwip/ip4_fib.h"
 #include "lwip/netbuf.h"
 #include "lwip/api.h"
 #include "lwip/priv/tcpip_priv.h"
@@ -73,6 +74,7 @@
 #include "lwip/dns.h"
 #include "lwip/priv/nd6_priv.h"
 #include "lwip/ip6_frag.h"
+#include "lwip/ip6_fib.h"
 #include "lwip/mld6.h"
 
 #define LWIP_MEMPOOL(name,num,size,desc) LWIP_MEMPOOL_DECLARE(name,num,size,desc)
@@ -165,6 +167,536 @@ memp_overflow_check_all(void)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_ELASTIC
+/** Size of one element in pool memory, including the overflow check regions */
+#if MEMP_OVERFLOW_CHECK
+#define MEMP_ELEMENT_SIZE(desc) (MEMP_SIZE + (desc)->size + MEM_SANITY_REGION_AFTER_ALIGNED)
+#else /* MEMP_OVERFLOW_CHECK */
+#define MEMP_ELEMENT_SIZE(desc) (MEMP_SIZE + (desc)->size)
+#endif /* MEMP_OVERFLOW_CHECK */
+
+/** Space in front of each slab element for the pointer to its slab */
+#define MEMP_SLAB_LINK_SIZE LWIP_MEM_ALIGN_SIZE(sizeof(struct memp_slab *))
+/** Size of one slab element, including the slab pointer */
+#define MEMP_SLAB_ELEMENT_SIZE(desc) (MEMP_SLAB_LINK_SIZE + MEMP_ELEMENT_SIZE(desc))
+/** The slab a slab element was carved from */
+#define MEMP_SLAB_LINK(memp) (*(struct memp_slab **)(void *)((u8_t *)(memp) - MEMP_SLAB_LINK_SIZE))
+
+/** Number of memp_elastic_tmr() runs after which an unused slab is freed */
+#define MEMP_ELASTIC_DECAY_TICKS \
+  ((MEMP_ELASTIC_DECAY_MS + MEMP_ELASTIC_TMR_INTERVAL - 1) / MEMP_ELASTIC_TMR_INTERVAL)
+
+/**
+ * Append a slab to the list of slabs that have free elements.
+ * Must be called with the pool protected.
+ */
+static void
+memp_elastic_avail_append(struct memp_elastic *elastic, struct memp_slab *slab)
+{
+  slab->avail_next = NULL;
+  slab->avail_prev = elastic->avail_tail;
+  if (elastic->avail_tail != NULL) {
+    elastic->avail_tail->avail_next = slab;
+  } else {
+    elastic->avail = slab;
+  }
+  elastic->avail_tail = slab;
+}
+
+/**
+ * Remove a slab from the list of slabs that have free elements.
+ * Must be called with the pool protected.
+ */
+static void
+memp_elastic_avail_remove(struct memp_elastic *elastic, struct memp_slab *slab)
+{
+  if (slab->avail_prev != NULL) {
+    slab->avail_prev->avail_next = slab->avail_next;
+  } else {
+    elastic->avail = slab->avail_next;
+  }
+  if (slab->avail_next != NULL) {
+    slab->avail_next->avail_prev = slab->avail_prev;
+  } else {
+    elastic->avail_tail = slab->avail_prev;
+  }
+}
+
+/**
+ * Move one free slab element to the free list of the pool so that the
+ * regular allocation code can take it. The element is taken from the first
+ * slab that has free elements, so this is O(1).
+ * Must be called with the pool protected.
+ */
+static void
+memp_elastic_refill(const struct memp_desc *desc)
+{
+  struct memp_slab *slab = desc->elastic->avail;
+  struct memp *memp;
+
+  if (slab == NULL) {
+    return;
+  }
+  memp = slab->free;
+  slab->free = memp->next;
+  slab->used++;
+  slab->idle = 0;
+  if (slab->free == NULL) {
+    memp_elastic_avail_remove(desc->elastic, slab);
+  }
+  memp->next = *desc->tab;
+  *desc->tab = memp;
+}
+
+/**
+ * Allocate a new slab from the heap if the ceiling of the pool permits.
+ * Must be called with the pool unprotected (calls mem_malloc).
+ */
+static void
+memp_elastic_grow(const struct memp_desc *desc)
+{
+  struct memp_elastic *elastic = desc->elastic;
+  struct memp_slab *slab;
+  struct memp *memp;
+  u8_t *start;
+  u32_t capacity;
+  size_t len;
+  u16_t num, i;
+  SYS_ARCH_DECL_PROTECT(old_level);
+
+  SYS_ARCH_PROTECT(old_level);
+  capacity = (u32_t)desc->num + elastic->slab_elements;
+  num = 0;
+  if (capacity < elastic->ceiling) {
+    num = (u16_t)LWIP_MIN(elastic->ceiling - capacity, MEMP_ELASTIC_SLAB_NUM);
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+  if (num == 0) {
+    return;
+  }
+
+  len = LWIP_MEM_ALIGN_SIZE(sizeof(struct memp_slab)) + (size_t)num * MEMP_SLAB_ELEMENT_SIZE(desc);
+  if ((size_t)(mem_size_t)len != len) {
+    return;
+  }
+  slab = (struct memp_slab *)mem_malloc((mem_size_t)len);
+  if (slab == NULL) {
+    LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: cannot grow pool %s\n", desc->desc));
+    return;
+  }
+  slab->next = NULL;
+  slab->free = NULL;
+  slab->num = num;
+  slab->used = 0;
+  slab->idle = 0;
+  start = (u8_t *)slab + LWIP_MEM_ALIGN_SIZE(sizeof(struct memp_slab));
+#if MEMP_MEM_INIT
+  memset(start, 0, (size_t)num * MEMP_SLAB_ELEMENT_SIZE(desc));
+#endif
+  for (i = 0; i < num; i++) {
+    memp = (struct memp *)(void *)(start + (size_t)i * MEMP_SLAB_ELEMENT_SIZE(desc) + MEMP_SLAB_LINK_SIZE);
+    MEMP_SLAB_LINK(memp) = slab;
+    memp->next = slab->free;
+    slab->free = memp;
+#if MEMP_OVERFLOW_CHECK
+    memp_overflow_init_element(memp, desc);
+#endif /* MEMP_OVERFLOW_CHECK */
+  }
+
+  SYS_ARCH_PROTECT(old_level);
+  /* check again: another thread may have grown the pool meanwhile */
+  if ((u32_t)desc->num + elastic->slab_elements + num <= elastic->ceiling) {
+    slab->next = elastic->slabs;
+    elastic->slabs = slab;
+    memp_elastic_avail_append(elastic, slab);
+    elastic->slab_elements = (u16_t)(elastic->slab_elements + num);
+#if MEMP_STATS
+    desc->stats->avail = (mem_size_t)(desc->stats->avail + num);
+#endif /* MEMP_STATS */
+    slab = NULL;
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+  if (slab != NULL) {
+    mem_free(slab);
+  }
+}
+
+/**
+ * Give an element back to the slab it was carved from.
+ * Must be called with the pool protected.
+ *
+ * @return 1 if the element was taken by a slab, 0 if it is a static element
+ */
+static int
+memp_elastic_put(const struct memp_desc *desc, struct memp *memp)
+{
+  struct memp_slab *slab;
+  u8_t *base = (u8_t *)LWIP_MEM_ALIGN(desc->base);
+
+  if (((u8_t *)memp >= base) && ((u8_t *)memp < base + (size_t)desc->num * MEMP_ELEMENT_SIZE(desc))) {
+    return 0;
+  }
+  slab = MEMP_SLAB_LINK(memp);
+  LWIP_ASSERT("memp_free: element of another pool", slab->used > 0);
+  if (slab->free == NULL) {
+    /* the slab was fully used: use it last so that others can run empty */
+    memp_elastic_avail_append(desc->elastic, slab);
+  }
+  memp->next = slab->free;
+  slab->free = memp;
+  slab->used--;
+  return 1;
+}
+
+/**
+ * Change the maximum number of elements (static and heap) of an elastic pool.
+ * Lowering the ceiling does not free slabs in use; they decay once unused.
+ *
+ * @param desc the pool to change
+ * @param ceiling new maximum; values up to the static size disable growing
+ */
+void
+memp_set_ceiling_pool(const struct memp_desc *desc, u16_t ceiling)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+  LWIP_ERROR("invalid pool desc", desc != NULL, return;);
+
+  SYS_ARCH_PROTECT(old_level);
+  desc->elastic->ceiling = ceiling;
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * Change the maximum number of elements of a built-in pool.
+ *
+ * @param type the pool to change
+ * @param ceiling new maximum, see memp_set_ceiling_pool()
+ */
+void
+memp_set_ceiling(memp_t type, u16_t ceiling)
+{
+  LWIP_ERROR("memp_set_ceiling: type < MEMP_MAX", (type < MEMP_MAX), return;);
+  memp_set_ceiling_pool(memp_pools[type], ceiling);
+}
+
+/**
+ * Age the heap slabs of an elastic pool and give those back to the heap that
+ * have been unused for MEMP_ELASTIC_DECAY_MS.
+ * Called for built-in pools by memp_elastic_tmr(); private pools must call
+ * this every MEMP_ELASTIC_TMR_INTERVAL milliseconds themselves.
+ *
+ * @param desc the pool to shrink
+ */
+void
+memp_decay_pool(const struct memp_desc *desc)
+{
+  struct memp_slab *slab, **prev, *unused = NULL;
+  SYS_ARCH_DECL_PROTECT(old_level);
+  LWIP_ERROR("invalid pool desc", desc != NULL, return;);
+
+  SYS_ARCH_PROTECT(old_level);
+  prev = &desc->elastic->slabs;
+  while ((slab = *prev) != NULL) {
+    if ((slab->used == 0) && (++slab->idle >= MEMP_ELASTIC_DECAY_TICKS)) {
+      *prev = slab->next;
+      memp_elastic_avail_remove(desc->elastic, slab);
+      desc->elastic->slab_elements = (u16_t)(desc->elastic->slab_elements - slab->num);
+#if MEMP_STATS
+      desc->stats->avail = (mem_size_t)(desc->stats->avail - slab->num);
+#endif /* MEMP_STATS */
+      slab->next = unused;
+      unused = slab;
+    } else {
+      prev = &slab->next;
+    }
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+
+  while (unused != NULL) {
+    slab = unused;
+    unused = slab->next;
+    mem_free(slab);
+  }
+}
+
+/**
+ * Timer callback giving unused slabs of all built-in pools back to the heap.
+ */
+void
+memp_elastic_tmr(void)
+{
+  u16_t i;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(memp_pools); i++) {
+    memp_decay_pool(memp_pools[i]);
+  }
+}
+#endif /* MEMP_ELASTIC */
+
+#if MEMP_TELEMETRY
+#if MEMP_OVERFLOW_CHECK
+#define MEMP_TELEMETRY_NO_SITE 0xFFFF
+static struct memp_telemetry_site memp_telemetry_sites[MEMP_TELEMETRY_SITES];
+static u16_t memp_telemetry_num_sites;
+
+/**
+ * Find (or add) the call site table entry of an allocation.
+ * Entries without allocated elements can be replaced: free ones first, then
+ * (once the table is full) the one with the fewest allocations and failures.
+ * Must be called with the pools protected.
+ */
+static u16_t
+memp_telemetry_site(const struct memp_desc *desc, const char *file, int line)
+{
+  u16_t i, victim = MEMP_TELEMETRY_NO_SITE;
+  struct memp_telemetry_site *site;
+
+  for (i = 0; i < memp_telemetry_num_sites; i++) {
+    site = &memp_telemetry_sites[i];
+    if ((site->line == line) && (site->desc == desc) && (site->file == file)) {
+      return i;
+    }
+    if (site->used == 0) {
+      if ((victim == MEMP_TELEMETRY_NO_SITE) || (site->desc == NULL) ||
+          ((memp_telemetry_sites[victim].desc != NULL) &&
+           (site->allocs + site->fails < memp_telemetry_sites[victim].allocs + memp_telemetry_sites[victim].fails))) {
+        victim = i;
+      }
+    }
+  }
+  if (((victim == MEMP_TELEMETRY_NO_SITE) || (memp_telemetry_sites[victim].desc != NULL)) &&
+      (memp_telemetry_num_sites < MEMP_TELEMETRY_SITES)) {
+    victim = memp_telemetry_num_sites++;
+  }
+  if (victim == MEMP_TELEMETRY_NO_SITE) {
+    return MEMP_TELEMETRY_NO_SITE;
+  }
+  site = &memp_telemetry_sites[victim];
+  memset(site, 0, sizeof(*site));
+  site->desc = desc;
+  site->file = file;
+  site->line = line;
+  return victim;
+}
+#endif /* MEMP_OVERFLOW_CHECK */
+
+/**
+ * Close the rate window if it has expired.
+ * Must be called with the pool protected.
+ */
+static void
+memp_telemetry_window(struct memp_telemetry *t, u32_t now)
+{
+  u32_t elapsed = now - t->window_start;
+
+  if (elapsed >= MEMP_TELEMETRY_RATE_WINDOW) {
+    /* a window without allocations did not see any */
+    t->rate = (elapsed < 2 * MEMP_TELEMETRY_RATE_WINDOW) ? t->window_allocs : 0;
+    t->window_start = now;
+    t->window_allocs = 0;
+  }
+}
+
+/**
+ * Account a successful allocation.
+ * Must be called with the pool protected.
+ */
+static void
+memp_telemetry_alloc(const struct memp_desc *desc, struct memp *memp, u32_t now)
+{
+  struct memp_telemetry *t = desc->telemetry;
+
+  t->allocs++;
+  memp_telemetry_window(t, now);
+  t->window_allocs++;
+  memp->alloc_time = now;
+#if MEMP_OVERFLOW_CHECK
+  memp->site = memp_telemetry_site(desc, memp->file, memp->line);
+  if (memp->site != MEMP_TELEMETRY_NO_SITE) {
+    struct memp_telemetry_site *site = &memp_telemetry_sites[memp->site];
+    site->allocs++;
+    site->used++;
+    if (site->used > site->max) {
+      site->max = site->used;
+    }
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+}
+
+/**
+ * Account a failed allocation.
+ * Must be called with the pool protected.
+ */
+static void
+#if MEMP_OVERFLOW_CHECK
+memp_telemetry_fail(const struct memp_desc *desc, u32_t now, const char *file, int line)
+#else /* MEMP_OVERFLOW_CHECK */
+memp_telemetry_fail(const struct memp_desc *desc, u32_t now)
+#endif /* MEMP_OVERFLOW_CHECK */
+{
+  struct memp_telemetry *t = desc->telemetry;
+  struct memp_telemetry_burst *burst = &t->bursts[t->last_burst];
+
+  t->fails++;
+  memp_telemetry_window(t, now);
+  if ((burst->count == 0) || ((u32_t)(now - burst->end) >= MEMP_TELEMETRY_BURST_GAP)) {
+    if (burst->count != 0) {
+      t->last_burst = (u16_t)((t->last_burst + 1) % MEMP_TELEMETRY_BURSTS);
+      burst = &t->bursts[t->last_burst];
+    }
+    burst->start = now;
+    burst->count = 0;
+  }
+  burst->end = now;
+  burst->count++;
+#if MEMP_OVERFLOW_CHECK
+  {
+    u16_t i = memp_telemetry_site(desc, file, line);
+    if (i != MEMP_TELEMETRY_NO_SITE) {
+      memp_telemetry_sites[i].fails++;
+    }
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+}
+
+/**
+ * Account freeing an element.
+ * Must be called with the pool protected.
+ */
+static void
+memp_telemetry_free(const struct memp_desc *desc, const struct memp *memp, u32_t now)
+{
+  struct memp_telemetry *t = desc->telemetry;
+  u32_t lifetime = now - memp->alloc_time;
+  u16_t bucket = 0;
+
+  t->frees++;
+  while ((lifetime != 0) && (bucket < MEMP_TELEMETRY_HIST_BUCKETS - 1)) {
+    lifetime >>= 1;
+    bucket++;
+  }
+  t->lifetime[bucket]++;
+#if MEMP_OVERFLOW_CHECK
+  if (memp->site != MEMP_TELEMETRY_NO_SITE) {
+    memp_telemetry_sites[memp->site].used--;
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+}
+
+/**
+ * Get a copy of the allocation telemetry of a pool.
+ *
+ * @param desc the pool
+ * @param telemetry where to copy the telemetry to
+ */
+void
+memp_telemetry_get_pool(const struct memp_desc *desc, struct memp_telemetry *telemetry)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+  LWIP_ERROR("invalid pool desc", desc != NULL, return;);
+  LWIP_ERROR("invalid telemetry", telemetry != NULL, return;);
+
+  SYS_ARCH_PROTECT(old_level);
+  memp_telemetry_window(desc->telemetry, MEMP_TELEMETRY_NOW());
+  *telemetry = *desc->telemetry;
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * @ingroup mempool
+ * Get a copy of the allocation telemetry of a built-in pool.
+ *
+ * @param type the pool
+ * @param telemetry where to copy the telemetry to
+ */
+void
+memp_telemetry_get(memp_t type, struct memp_telemetry *telemetry)
+{
+  LWIP_ERROR("memp_telemetry_get: type < MEMP_MAX", (type < MEMP_MAX), return;);
+  memp_telemetry_get_pool(memp_pools[type], telemetry);
+}
+
+/**
+ * Reset the allocation telemetry of a pool.
+ * Elements allocated before still count into the lifetime histogram when freed.
+ *
+ * @param desc the pool
+ */
+void
+memp_telemetry_reset_pool(const struct memp_desc *desc)
+{
+  SYS_ARCH_DECL_PROTECT(old_level);
+  LWIP_ERROR("invalid pool desc", desc != NULL, return;);
+
+  SYS_ARCH_PROTECT(old_level);
+  memset(desc->telemetry, 0, sizeof(struct memp_telemetry));
+  desc->telemetry->window_start = MEMP_TELEMETRY_NOW();
+  SYS_ARCH_UNPROTECT(old_level);
+}
+
+/**
+ * @ingroup mempool
+ * Reset the allocation telemetry of all built-in pools. Call sites without
+ * allocated elements are removed, the others keep only their current count.
+ */
+void
+memp_telemetry_reset(void)
+{
+  u16_t i;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(memp_pools); i++) {
+    memp_telemetry_reset_pool(memp_pools[i]);
+  }
+#if MEMP_OVERFLOW_CHECK
+  {
+    SYS_ARCH_DECL_PROTECT(old_level);
+    SYS_ARCH_PROTECT(old_level);
+    for (i = 0; i < memp_telemetry_num_sites; i++) {
+      if (memp_telemetry_sites[i].used == 0) {
+        memset(&memp_telemetry_sites[i], 0, sizeof(struct memp_telemetry_site));
+      } else {
+        memp_telemetry_sites[i].allocs = 0;
+        memp_telemetry_sites[i].fails = 0;
+        memp_telemetry_sites[i].max = memp_telemetry_sites[i].used;
+      }
+    }
+    while ((memp_telemetry_num_sites > 0) &&
+           (memp_telemetry_sites[memp_telemetry_num_sites - 1].desc == NULL)) {
+      memp_telemetry_num_sites--;
+    }
+    SYS_ARCH_UNPROTECT(old_level);
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+}
+
+#if MEMP_OVERFLOW_CHECK
+/**
+ * @ingroup mempool
+ * Get a copy of the per call site allocation counters (all pools).
+ *
+ * @param sites where to copy the entries to
+ * @param num number of entries 'sites' can hold
+ * @return number of entries copied
+ */
+u16_t
+memp_telemetry_get_sites(struct memp_telemetry_site *sites, u16_t num)
+{
+  u16_t i, n = 0;
+  SYS_ARCH_DECL_PROTECT(old_level);
+  LWIP_ERROR("invalid sites", (sites != NULL) || (num == 0), return 0;);
+
+  SYS_ARCH_PROTECT(old_level);
+  for (i = 0; (i < memp_telemetry_num_sites) && (n < num); i++) {
+    if (memp_telemetry_sites[i].desc != NULL) {
+      sites[n++] = memp_telemetry_sites[i];
+    }
+  }
+  SYS_ARCH_UNPROTECT(old_level);
+  return n;
+}
+#endif /* MEMP_OVERFLOW_CHECK */
+#endif /* MEMP_TELEMETRY */
+
 /**
  * Initialize custom memory pool.
  * Related functions: memp_malloc_pool, memp_free_pool
@@ -212,6 +744,9 @@ memp_init_pool(const struct memp_desc *desc)
 #if MEMP_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY)
   desc->stats->name  = desc->desc;
 #endif /* MEMP_STATS && (defined(LWIP_DEBUG) || LWIP_STATS_DISPLAY) */
+#if MEMP_TELEMETRY
+  memp_telemetry_reset_pool(desc);
+#endif /* MEMP_TELEMETRY */
 }
 
 /**
@@ -248,6 +783,9 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
 #endif
 {
   struct memp *memp;
+#if MEMP_TELEMETRY
+  u32_t now = MEMP_TELEMETRY_NOW();
+#endif /* MEMP_TELEMETRY */
   SYS_ARCH_DECL_PROTECT(old_level);
 
 #if MEMP_MEM_MALLOC
@@ -256,6 +794,21 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
 #else /* MEMP_MEM_MALLOC */
   SYS_ARCH_PROTECT(old_level);
 
+#if MEMP_ELASTIC
+  if (*desc->tab == NULL) {
+    /* static elements used up: take one from a slab, growing if needed */
+    memp_elastic_refill(desc);
+    if (*desc->tab == NULL) {
+      SYS_ARCH_UNPROTECT(old_level);
+      memp_elastic_grow(desc);
+      SYS_ARCH_PROTECT(old_level);
+      if (*desc->tab == NULL) {
+        memp_elastic_refill(desc);
+      }
+    }
+  }
+#endif /* MEMP_ELASTIC */
+
   memp = *desc->tab;
 #endif /* MEMP_MEM_MALLOC */
 
@@ -285,6 +838,9 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
       desc->stats->max = desc->stats->used;
     }
 #endif
+#if MEMP_TELEMETRY
+    memp_telemetry_alloc(desc, memp, now);
+#endif /* MEMP_TELEMETRY */
     SYS_ARCH_UNPROTECT(old_level);
     /* cast through u8_t* to get rid of alignment warnings */
     return ((u8_t *)memp + MEMP_SIZE);
@@ -292,6 +848,11 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
 #if MEMP_STATS
     desc->stats->err++;
 #endif
+#if MEMP_TELEMETRY && MEMP_OVERFLOW_CHECK
+    memp_telemetry_fail(desc, now, file, line);
+#elif MEMP_TELEMETRY
+    memp_telemetry_fail(desc, now);
+#endif /* MEMP_TELEMETRY */
     SYS_ARCH_UNPROTECT(old_level);
     LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", desc->desc));
   }
@@ -359,6 +920,9 @@ static void
 do_memp_free_pool(const struct memp_desc *desc, void *mem)
 {
   struct memp *memp;
+#if MEMP_TELEMETRY
+  u32_t now = MEMP_TELEMETRY_NOW();
+#endif /* MEMP_TELEMETRY */
   SYS_ARCH_DECL_PROTECT(old_level);
 
   LWIP_ASSERT("memp_free: mem properly aligned",
@@ -376,14 +940,22 @@ do_memp_free_pool(const struct memp_desc *desc, void *mem)
 #if MEMP_STATS
   desc->stats->used--;
 #endif
+#if MEMP_TELEMETRY
+  memp_telemetry_free(desc, memp, now);
+#endif /* MEMP_TELEMETRY */
 
 #if MEMP_MEM_MALLOC
   LWIP_UNUSED_ARG(desc);
   SYS_ARCH_UNPROTECT(old_level);
   mem_free(memp);
 #else /* MEMP_MEM_MALLOC */
-  memp->next = *desc->tab;
-  *desc->tab = memp;
+#if MEMP_ELASTIC
+  if ((desc->elastic->slabs == NULL) || !memp_elastic_put(desc, memp))
+#endif /* MEMP_ELASTIC */
+  {
+    memp->next = *desc->tab;
+    *desc->tab = memp;
+  }
 
 #if MEMP_SANITY_CHECK
   LWIP_ASSERT("memp sanity", memp_sanity(desc));
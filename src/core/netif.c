@@ -63,6 +63,9 @@
 #include "lwip/snmp.h"
 #include "lwip/igmp.h"
 #include "lwip/etharp.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip_flow.h"
+#include "lwip/ip6_fib.h"
 #include "lwip/stats.h"
 #include "lwip/sys.h"
 #include "lwip/ip.h"
@@ -73,6 +76,7 @@
 #endif /* ENABLE_LOOPBACK */
 
 #include "netif/ethernet.h"
+#include "netif/vlanif.h"
 
 #if LWIP_AUTOIP
 #include "lwip/autoip.h"
@@ -368,6 +372,9 @@ netif_add(struct netif *netif,
 #if LWIP_ACD
   netif->acd_list = NULL;
 #endif /* LWIP_ACD */
+#if LWIP_VLANIF
+  netif->vlans = NULL;
+#endif /* LWIP_VLANIF */
   NETIF_RESET_HINTS(netif);
 #if ENABLE_LOOPBACK
   netif->loop_first = NULL;
@@ -498,6 +505,7 @@ netif_do_set_ipaddr(struct netif *netif, const ip4_addr_t *ipaddr, ip_addr_t *ol
     IP_SET_TYPE_VAL(netif->ip_addr, IPADDR_TYPE_V4);
     mib2_add_ip4(netif);
     mib2_add_route_ip4(0, netif);
+    ip_flow_flush();
 
     netif_issue_reports(netif, NETIF_REPORT_TYPE_IPV4);
 
@@ -556,6 +564,7 @@ netif_do_set_netmask(struct netif *netif, const ip4_addr_t *netmask, ip_addr_t *
     ip4_addr_set(ip_2_ip4(&netif->netmask), netmask);
     IP_SET_TYPE_VAL(netif->netmask, IPADDR_TYPE_V4);
     mib2_add_route_ip4(0, netif);
+    ip_flow_flush();
     LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("netif: netmask of interface %c%c set to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
                 netif->name[0], netif->name[1],
                 ip4_addr1_16(netif_ip4_netmask(netif)),
@@ -618,6 +627,7 @@ netif_do_set_gw(struct netif *netif, const ip4_addr_t *gw, ip_addr_t *old_gw)
 
     ip4_addr_set(ip_2_ip4(&netif->gw), gw);
     IP_SET_TYPE_VAL(netif->gw, IPADDR_TYPE_V4);
+    ip_flow_flush();
     LWIP_DEBUGF(NETIF_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("netif: GW address of interface %c%c set to %"U16_F".%"U16_F".%"U16_F".%"U16_F"\n",
                 netif->name[0], netif->name[1],
                 ip4_addr1_16(netif_ip4_gw(netif)),
@@ -786,6 +796,10 @@ netif_remove(struct netif *netif)
     igmp_stop(netif);
   }
 #endif /* LWIP_IGMP */
+#if LWIP_IPV4_FIB
+  /* routes through this netif are gone with it */
+  ip4_fib_remove_netif(netif);
+#endif /* LWIP_IPV4_FIB */
 #endif /* LWIP_IPV4*/
 
 #if LWIP_IPV6
@@ -798,11 +812,22 @@ netif_remove(struct netif *netif)
   /* stop MLD processing */
   mld6_stop(netif);
 #endif /* LWIP_IPV6_MLD */
+#if LWIP_IPV6_FIB
+  /* routes through this netif are gone with it */
+  ip6_fib_remove_netif(netif);
+#endif /* LWIP_IPV6_FIB */
 #endif /* LWIP_IPV6 */
+  /* flows cached through this netif are gone with it */
+  ip_flow_flush();
   if (netif_is_up(netif)) {
     /* set netif down before removing (call callback function) */
     netif_set_down(netif);
   }
+#if LWIP_VLANIF
+  /* detach from the parent or from the stacked sub-interfaces (after the
+     callbacks above, which may still send through them) */
+  vlanif_netif_removed(netif);
+#endif /* LWIP_VLANIF */
 
   mib2_remove_ip4(netif);
 
@@ -858,6 +883,7 @@ netif_set_default(struct netif *netif)
     mib2_add_route_ip4(1, netif);
   }
   netif_default = netif;
+  ip_flow_flush();
   LWIP_DEBUGF(NETIF_DEBUG, ("netif: setting default interface %c%c\n",
                             netif ? netif->name[0] : '\'', netif ? netif->name[1] : '\''));
 }
@@ -876,6 +902,7 @@ netif_set_up(struct netif *netif)
 
   if (!(netif->flags & NETIF_FLAG_UP)) {
     netif_set_flags(netif, NETIF_FLAG_UP);
+    ip_flow_flush();
 
     MIB2_COPY_SYSUPTIME_TO(&netif->ts);
 
@@ -962,6 +989,7 @@ netif_set_down(struct netif *netif)
 #endif
 
     netif_clear_flags(netif, NETIF_FLAG_UP);
+    ip_flow_flush();
     MIB2_COPY_SYSUPTIME_TO(&netif->ts);
 
 #if LWIP_IPV4 && LWIP_ARP
@@ -1023,6 +1051,7 @@ netif_set_link_up(struct netif *netif)
 
   if (!(netif->flags & NETIF_FLAG_LINK_UP)) {
     netif_set_flags(netif, NETIF_FLAG_LINK_UP);
+    ip_flow_flush();
 
 #if LWIP_DHCP
     dhcp_network_changed_link_up(netif);
@@ -1061,6 +1090,7 @@ netif_set_link_down(struct netif *netif)
 
   if (netif->flags & NETIF_FLAG_LINK_UP) {
     netif_clear_flags(netif, NETIF_FLAG_LINK_UP);
+    ip_flow_flush();
 
 #if LWIP_AUTOIP
     autoip_network_changed_link_down(netif);
@@ -1412,6 +1442,7 @@ netif_ip6_addr_set_parts(struct netif *netif, s8_t addr_idx, u32_t i0, u32_t i1,
     /* @todo: remove/readd mib2 ip6 entries? */
 
     ip_addr_copy(netif->ip6_addr[addr_idx], new_ipaddr);
+    ip_flow_flush();
 
     if (ip6_addr_isvalid(netif_ip6_addr_state(netif, addr_idx))) {
       netif_issue_reports(netif, NETIF_REPORT_TYPE_IPV6);
@@ -1471,6 +1502,9 @@ netif_ip6_addr_set_state(struct netif *netif, s8_t addr_idx, u8_t state)
       /* @todo: remove mib2 ip6 entries? */
     }
     netif->ip6_addr_state[addr_idx] = state;
+    if (old_valid != new_valid) {
+      ip_flow_flush();
+    }
 
     if (!old_valid && new_valid) {
       /* address added by setting valid */
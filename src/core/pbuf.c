@@ -92,7 +92,7 @@
 #define PBUF_POOL_BUFSIZE_ALIGNED LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE)
 
 static const struct pbuf *
-pbuf_skip_const(const struct pbuf *in, u16_t in_offset, u16_t *out_offset);
+pbuf_skip_const(const struct pbuf *in, pbuf_len_t in_offset, pbuf_len_t *out_offset);
 
 #if !LWIP_TCP || !TCP_QUEUE_OOSEQ || !PBUF_POOL_FREE_OOSEQ
 #define PBUF_POOL_IS_EMPTY()
@@ -176,7 +176,7 @@ pbuf_pool_is_empty(void)
 
 /* Initialize members of struct pbuf after allocation */
 static void
-pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, u16_t tot_len, u16_t len, pbuf_type type, u8_t flags)
+pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, pbuf_len_t tot_len, pbuf_len_t len, pbuf_type type, u8_t flags)
 {
   p->next = NULL;
   p->payload = payload;
@@ -221,11 +221,11 @@ pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, u16_t tot_len, u16_t len,
  * is the first pbuf of a pbuf chain.
  */
 struct pbuf *
-pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+pbuf_alloc(pbuf_layer layer, pbuf_len_t length, pbuf_type type)
 {
   struct pbuf *p;
   u16_t offset = (u16_t)layer;
-  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F")\n", length));
+  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"PBUFLEN_F")\n", length));
 
   switch (type) {
     case PBUF_REF: /* fall through */
@@ -234,12 +234,12 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       break;
     case PBUF_POOL: {
       struct pbuf *q, *last;
-      u16_t rem_len; /* remaining length */
+      pbuf_len_t rem_len; /* remaining length */
       p = NULL;
       last = NULL;
       rem_len = length;
       do {
-        u16_t qlen;
+        pbuf_len_t qlen;
         q = (struct pbuf *)memp_malloc(MEMP_PBUF_POOL);
         if (q == NULL) {
           PBUF_POOL_IS_EMPTY();
@@ -250,7 +250,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
           /* bail out unsuccessfully */
           return NULL;
         }
-        qlen = LWIP_MIN(rem_len, (u16_t)(PBUF_POOL_BUFSIZE_ALIGNED - LWIP_MEM_ALIGN_SIZE(offset)));
+        qlen = LWIP_MIN(rem_len, (pbuf_len_t)(PBUF_POOL_BUFSIZE_ALIGNED - LWIP_MEM_ALIGN_SIZE(offset)));
         pbuf_init_alloced_pbuf(q, LWIP_MEM_ALIGN((void *)((u8_t *)q + SIZEOF_STRUCT_PBUF + offset)),
                                rem_len, qlen, type, 0);
         LWIP_ASSERT("pbuf_alloc: pbuf q->payload properly aligned",
@@ -265,7 +265,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
           last->next = q;
         }
         last = q;
-        rem_len = (u16_t)(rem_len - qlen);
+        rem_len = (pbuf_len_t)(rem_len - qlen);
         offset = 0;
       } while (rem_len > 0);
       break;
@@ -295,7 +295,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
       LWIP_ASSERT("pbuf_alloc: erroneous type", 0);
       return NULL;
   }
-  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"U16_F") == %p\n", length, (void *)p));
+  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloc(length=%"PBUFLEN_F") == %p\n", length, (void *)p));
   return p;
 }
 
@@ -324,7 +324,7 @@ pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
  * @return the allocated pbuf.
  */
 struct pbuf *
-pbuf_alloc_reference(void *payload, u16_t length, pbuf_type type)
+pbuf_alloc_reference(void *payload, pbuf_len_t length, pbuf_type type)
 {
   struct pbuf *p;
   LWIP_ASSERT("invalid pbuf_type", (type == PBUF_REF) || (type == PBUF_ROM));
@@ -360,15 +360,15 @@ pbuf_alloc_reference(void *payload, u16_t length, pbuf_type type)
  *        big enough to hold 'length' plus the header size
  */
 struct pbuf *
-pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_custom *p,
-                    void *payload_mem, u16_t payload_mem_len)
+pbuf_alloced_custom(pbuf_layer l, pbuf_len_t length, pbuf_type type, struct pbuf_custom *p,
+                    void *payload_mem, pbuf_len_t payload_mem_len)
 {
   u16_t offset = (u16_t)l;
   void *payload;
-  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloced_custom(length=%"U16_F")\n", length));
+  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_alloced_custom(length=%"PBUFLEN_F")\n", length));
 
   if (LWIP_MEM_ALIGN_SIZE(offset) + length > payload_mem_len) {
-    LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_LEVEL_WARNING, ("pbuf_alloced_custom(length=%"U16_F") buffer too short\n", length));
+    LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_LEVEL_WARNING, ("pbuf_alloced_custom(length=%"PBUFLEN_F") buffer too short\n", length));
     return NULL;
   }
 
@@ -399,11 +399,11 @@ pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type, struct pbuf_cust
  * @note Despite its name, pbuf_realloc cannot grow the size of a pbuf (chain).
  */
 void
-pbuf_realloc(struct pbuf *p, u16_t new_len)
+pbuf_realloc(struct pbuf *p, pbuf_len_t new_len)
 {
   struct pbuf *q;
-  u16_t rem_len; /* remaining length */
-  u16_t shrink;
+  pbuf_len_t rem_len; /* remaining length */
+  pbuf_len_t shrink;
 
   LWIP_ASSERT("pbuf_realloc: p != NULL", p != NULL);
 
@@ -415,7 +415,7 @@ pbuf_realloc(struct pbuf *p, u16_t new_len)
 
   /* the pbuf chain grows by (new_len - p->tot_len) bytes
    * (which may be negative in case of shrinking) */
-  shrink = (u16_t)(p->tot_len - new_len);
+  shrink = (pbuf_len_t)(p->tot_len - new_len);
 
   /* first, step over any pbufs that should remain in the chain */
   rem_len = new_len;
@@ -423,9 +423,9 @@ pbuf_realloc(struct pbuf *p, u16_t new_len)
   /* should this pbuf be kept? */
   while (rem_len > q->len) {
     /* decrease remaining length by pbuf length */
-    rem_len = (u16_t)(rem_len - q->len);
+    rem_len = (pbuf_len_t)(rem_len - q->len);
     /* decrease total length indicator */
-    q->tot_len = (u16_t)(q->tot_len - shrink);
+    q->tot_len = (pbuf_len_t)(q->tot_len - shrink);
     /* proceed to next pbuf in chain */
     q = q->next;
     LWIP_ASSERT("pbuf_realloc: q != NULL", q != NULL);
@@ -489,7 +489,7 @@ pbuf_add_header_impl(struct pbuf *p, size_t header_size_increment, u8_t force)
 
   increment_magnitude = (u16_t)header_size_increment;
   /* Do not allow tot_len to wrap as a result. */
-  if ((u16_t)(increment_magnitude + p->tot_len) < increment_magnitude) {
+  if ((pbuf_len_t)(increment_magnitude + p->tot_len) < increment_magnitude) {
     return 1;
   }
 
@@ -523,8 +523,8 @@ pbuf_add_header_impl(struct pbuf *p, size_t header_size_increment, u8_t force)
 
   /* modify pbuf fields */
   p->payload = payload;
-  p->len = (u16_t)(p->len + increment_magnitude);
-  p->tot_len = (u16_t)(p->tot_len + increment_magnitude);
+  p->len = (pbuf_len_t)(p->len + increment_magnitude);
+  p->tot_len = (pbuf_len_t)(p->tot_len + increment_magnitude);
 
 
   return 0;
@@ -606,8 +606,8 @@ pbuf_remove_header(struct pbuf *p, size_t header_size_decrement)
   /* increase payload pointer (guarded by length check above) */
   p->payload = (u8_t *)p->payload + header_size_decrement;
   /* modify pbuf length fields */
-  p->len = (u16_t)(p->len - increment_magnitude);
-  p->tot_len = (u16_t)(p->tot_len - increment_magnitude);
+  p->len = (pbuf_len_t)(p->len - increment_magnitude);
+  p->tot_len = (pbuf_len_t)(p->tot_len - increment_magnitude);
 
   LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_remove_header: old %p new %p (%"U16_F")\n",
               (void *)payload, (void *)p->payload, increment_magnitude));
@@ -671,14 +671,14 @@ pbuf_header_force(struct pbuf *p, s16_t header_size_increment)
  * @return the new head pbuf
  */
 struct pbuf *
-pbuf_free_header(struct pbuf *q, u16_t size)
+pbuf_free_header(struct pbuf *q, pbuf_len_t size)
 {
   struct pbuf *p = q;
-  u16_t free_left = size;
+  pbuf_len_t free_left = size;
   while (free_left && p) {
     if (free_left >= p->len) {
       struct pbuf *f = p;
-      free_left = (u16_t)(free_left - p->len);
+      free_left = (pbuf_len_t)(free_left - p->len);
       p = p->next;
       f->next = 0;
       pbuf_free(f);
@@ -862,13 +862,13 @@ pbuf_cat(struct pbuf *h, struct pbuf *t)
   /* proceed to last pbuf of chain */
   for (p = h; p->next != NULL; p = p->next) {
     /* add total length of second chain to all totals of first chain */
-    p->tot_len = (u16_t)(p->tot_len + t->tot_len);
+    p->tot_len = (pbuf_len_t)(p->tot_len + t->tot_len);
   }
   /* { p is last pbuf of first h chain, p->next == NULL } */
   LWIP_ASSERT("p->tot_len == p->len (of last pbuf in chain)", p->tot_len == p->len);
   LWIP_ASSERT("p->next == NULL", p->next == NULL);
   /* add total length of second chain to last pbuf total of first chain */
-  p->tot_len = (u16_t)(p->tot_len + t->tot_len);
+  p->tot_len = (pbuf_len_t)(p->tot_len + t->tot_len);
   /* chain last pbuf of head (p) with first of tail (t) */
   p->next = t;
   /* p->next now references t, but the caller will drop its reference to t,
@@ -922,7 +922,7 @@ pbuf_dechain(struct pbuf *p)
     /* assert tot_len invariant: (p->tot_len == p->len + (p->next? p->next->tot_len: 0) */
     LWIP_ASSERT("p->tot_len == p->len + q->tot_len", q->tot_len == p->tot_len - p->len);
     /* enforce invariant if assertion is disabled */
-    q->tot_len = (u16_t)(p->tot_len - p->len);
+    q->tot_len = (pbuf_len_t)(p->tot_len - p->len);
     /* decouple pbuf from remainder */
     p->next = NULL;
     /* total length of pbuf p is its own length only */
@@ -983,11 +983,11 @@ pbuf_copy(struct pbuf *p_to, const struct pbuf *p_from)
  *         ERR_VAL if any of the pbufs are part of a queue
  */
 err_t
-pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, u16_t copy_len, u16_t offset)
+pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, pbuf_len_t copy_len, pbuf_len_t offset)
 {
   size_t offset_to = offset, offset_from = 0, len;
 
-  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_copy_partial_pbuf(%p, %p, %"U16_F", %"U16_F")\n",
+  LWIP_DEBUGF(PBUF_DEBUG | LWIP_DBG_TRACE, ("pbuf_copy_partial_pbuf(%p, %p, %"PBUFLEN_F", %"PBUFLEN_F")\n",
               (const void *)p_to, (const void *)p_from, copy_len, offset));
 
   /* is the copy_len in range? */
@@ -995,7 +995,7 @@ pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, u16_t copy_
              (p_from->tot_len >= copy_len)), return ERR_ARG;);
   /* is the target big enough to hold the source? */
   LWIP_ERROR("pbuf_copy_partial_pbuf: target not big enough", ((p_to != NULL) &&
-             (p_to->tot_len >= (offset + copy_len))), return ERR_ARG;);
+             (p_to->tot_len >= offset) && (p_to->tot_len - offset >= copy_len)), return ERR_ARG;);
 
   /* iterate through pbuf chain */
   do {
@@ -1054,13 +1054,13 @@ pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, u16_t copy_
  * @param offset offset into the packet buffer from where to begin copying len bytes
  * @return the number of bytes copied, or 0 on failure
  */
-u16_t
-pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset)
+pbuf_len_t
+pbuf_copy_partial(const struct pbuf *buf, void *dataptr, pbuf_len_t len, pbuf_len_t offset)
 {
   const struct pbuf *p;
-  u16_t left = 0;
-  u16_t buf_copy_len;
-  u16_t copied_total = 0;
+  pbuf_len_t left = 0;
+  pbuf_len_t buf_copy_len;
+  pbuf_len_t copied_total = 0;
 
   LWIP_ERROR("pbuf_copy_partial: invalid buf", (buf != NULL), return 0;);
   LWIP_ERROR("pbuf_copy_partial: invalid dataptr", (dataptr != NULL), return 0;);
@@ -1069,18 +1069,18 @@ pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset
   for (p = buf; len != 0 && p != NULL; p = p->next) {
     if ((offset != 0) && (offset >= p->len)) {
       /* don't copy from this buffer -> on to the next */
-      offset = (u16_t)(offset - p->len);
+      offset = (pbuf_len_t)(offset - p->len);
     } else {
       /* copy from this buffer. maybe only partially. */
-      buf_copy_len = (u16_t)(p->len - offset);
+      buf_copy_len = (pbuf_len_t)(p->len - offset);
       if (buf_copy_len > len) {
         buf_copy_len = len;
       }
       /* copy the necessary parts of the buffer */
       MEMCPY(&((char *)dataptr)[left], &((char *)p->payload)[offset], buf_copy_len);
-      copied_total = (u16_t)(copied_total + buf_copy_len);
-      left = (u16_t)(left + buf_copy_len);
-      len = (u16_t)(len - buf_copy_len);
+      copied_total = (pbuf_len_t)(copied_total + buf_copy_len);
+      left = (pbuf_len_t)(left + buf_copy_len);
+      len = (pbuf_len_t)(len - buf_copy_len);
       offset = 0;
     }
   }
@@ -1102,10 +1102,10 @@ pbuf_copy_partial(const struct pbuf *buf, void *dataptr, u16_t len, u16_t offset
  * @return the number of bytes copied, or 0 on failure
  */
 void *
-pbuf_get_contiguous(const struct pbuf *p, void *buffer, size_t bufsize, u16_t len, u16_t offset)
+pbuf_get_contiguous(const struct pbuf *p, void *buffer, size_t bufsize, pbuf_len_t len, pbuf_len_t offset)
 {
   const struct pbuf *q;
-  u16_t out_offset;
+  pbuf_len_t out_offset;
 
   LWIP_ERROR("pbuf_get_contiguous: invalid buf", (p != NULL), return NULL;);
   LWIP_ERROR("pbuf_get_contiguous: invalid dataptr", (buffer != NULL), return NULL;);
@@ -1113,7 +1113,7 @@ pbuf_get_contiguous(const struct pbuf *p, void *buffer, size_t bufsize, u16_t le
 
   q = pbuf_skip_const(p, offset, &out_offset);
   if (q != NULL) {
-    if (q->len >= (out_offset + len)) {
+    if ((q->len >= out_offset) && (q->len - out_offset >= len)) {
       /* all data in this pbuf, return zero-copy */
       return (u8_t *)q->payload + out_offset;
     }
@@ -1145,7 +1145,7 @@ void pbuf_split_64k(struct pbuf *p, struct pbuf **rest)
 {
   *rest = NULL;
   if ((p != NULL) && (p->next != NULL)) {
-    u16_t tot_len_front = p->len;
+    u16_t tot_len_front = (u16_t)p->len;
     struct pbuf *i = p;
     struct pbuf *r = p->next;
 
@@ -1162,7 +1162,7 @@ void pbuf_split_64k(struct pbuf *p, struct pbuf **rest)
     if (r != NULL) {
       /* Update the tot_len field in the first part */
       for (i = p; i != NULL; i = i->next) {
-        i->tot_len = (u16_t)(i->tot_len - r->tot_len);
+        i->tot_len = (pbuf_len_t)(i->tot_len - r->tot_len);
         LWIP_ASSERT("tot_len/len mismatch in last pbuf",
                     (i->next != NULL) || (i->tot_len == i->len));
       }
@@ -1180,14 +1180,14 @@ void pbuf_split_64k(struct pbuf *p, struct pbuf **rest)
 
 /* Actual implementation of pbuf_skip() but returning const pointer... */
 static const struct pbuf *
-pbuf_skip_const(const struct pbuf *in, u16_t in_offset, u16_t *out_offset)
+pbuf_skip_const(const struct pbuf *in, pbuf_len_t in_offset, pbuf_len_t *out_offset)
 {
-  u16_t offset_left = in_offset;
+  pbuf_len_t offset_left = in_offset;
   const struct pbuf *q = in;
 
   /* get the correct pbuf */
   while ((q != NULL) && (q->len <= offset_left)) {
-    offset_left = (u16_t)(offset_left - q->len);
+    offset_left = (pbuf_len_t)(offset_left - q->len);
     q = q->next;
   }
   if (out_offset != NULL) {
@@ -1206,7 +1206,7 @@ pbuf_skip_const(const struct pbuf *in, u16_t in_offset, u16_t *out_offset)
  * @return the pbuf in the queue where the offset is
  */
 struct pbuf *
-pbuf_skip(struct pbuf *in, u16_t in_offset, u16_t *out_offset)
+pbuf_skip(struct pbuf *in, pbuf_len_t in_offset, pbuf_len_t *out_offset)
 {
   const struct pbuf *out = pbuf_skip_const(in, in_offset, out_offset);
   return LWIP_CONST_CAST(struct pbuf *, out);
@@ -1224,7 +1224,7 @@ pbuf_skip(struct pbuf *in, u16_t in_offset, u16_t *out_offset)
  * @return ERR_OK if successful, ERR_MEM if the pbuf is not big enough
  */
 err_t
-pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+pbuf_take(struct pbuf *buf, const void *dataptr, pbuf_len_t len)
 {
   struct pbuf *p;
   size_t buf_copy_len;
@@ -1268,21 +1268,21 @@ pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
  * @return ERR_OK if successful, ERR_MEM if the pbuf is not big enough
  */
 err_t
-pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset)
+pbuf_take_at(struct pbuf *buf, const void *dataptr, pbuf_len_t len, pbuf_len_t offset)
 {
-  u16_t target_offset;
+  pbuf_len_t target_offset;
   struct pbuf *q = pbuf_skip(buf, offset, &target_offset);
 
   /* return requested data if pbuf is OK */
-  if ((q != NULL) && (q->tot_len >= target_offset + len)) {
-    u16_t remaining_len = len;
+  if ((q != NULL) && (q->tot_len >= target_offset) && (q->tot_len - target_offset >= len)) {
+    pbuf_len_t remaining_len = len;
     const u8_t *src_ptr = (const u8_t *)dataptr;
     /* copy the part that goes into the first pbuf */
-    u16_t first_copy_len;
+    pbuf_len_t first_copy_len;
     LWIP_ASSERT("check pbuf_skip result", target_offset < q->len);
-    first_copy_len = (u16_t)LWIP_MIN(q->len - target_offset, len);
+    first_copy_len = (pbuf_len_t)LWIP_MIN(q->len - target_offset, len);
     MEMCPY(((u8_t *)q->payload) + target_offset, dataptr, first_copy_len);
-    remaining_len = (u16_t)(remaining_len - first_copy_len);
+    remaining_len = (pbuf_len_t)(remaining_len - first_copy_len);
     src_ptr += first_copy_len;
     if (remaining_len > 0) {
       return pbuf_take(q->next, src_ptr, remaining_len);
@@ -1348,6 +1348,112 @@ pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p)
   return q;
 }
 
+#if LWIP_PBUF_SHARED
+/** Free function of the pbufs allocated by pbuf_share() */
+static void
+pbuf_free_shared_ref(struct pbuf *p)
+{
+  struct pbuf_shared_ref *sr = (struct pbuf_shared_ref *)p;
+  pbuf_free(sr->original);
+  memp_free(MEMP_PBUF_SHARED, sr);
+}
+
+/**
+ * @ingroup pbuf
+ * Creates a read-only reference to a pbuf (chain) without copying the data:
+ * each pbuf of 'p' gets a pbuf_custom from MEMP_PBUF_SHARED that points to
+ * its payload and holds a reference to it until freed.
+ * The new chain has its own payload pointers, so headers can be added or
+ * removed on it (pbuf_header_force() reaches back into the headers of the
+ * referenced pbuf) without disturbing other users of 'p'.
+ * The payload must not be modified through any of the references as long as
+ * the data is shared, see pbuf_unshare().
+ *
+ * @param p the pbuf (chain) to reference
+ * @return a new pbuf chain referencing the data of 'p' or NULL if no
+ *         MEMP_PBUF_SHARED element is available
+ */
+struct pbuf *
+pbuf_share(struct pbuf *p)
+{
+  struct pbuf *head = NULL;
+  struct pbuf *q;
+
+  LWIP_ERROR("pbuf_share: invalid pbuf", p != NULL, return NULL;);
+
+  for (q = p; q != NULL; q = q->next) {
+    struct pbuf_shared_ref *sr;
+    struct pbuf *r;
+
+    sr = (struct pbuf_shared_ref *)memp_malloc(MEMP_PBUF_SHARED);
+    if (sr == NULL) {
+      if (head != NULL) {
+        pbuf_free(head);
+      }
+      return NULL;
+    }
+    sr->pc.custom_free_function = pbuf_free_shared_ref;
+    r = pbuf_alloced_custom(PBUF_RAW, q->len, PBUF_REF, &sr->pc, q->payload, q->len);
+    LWIP_ASSERT("pbuf_alloced_custom failed", r != NULL);
+    r->flags |= (u8_t)(q->flags & ~PBUF_FLAG_IS_CUSTOM);
+    r->if_idx = q->if_idx;
+    pbuf_ref(q);
+    sr->original = q;
+    if (head == NULL) {
+      head = r;
+    } else {
+      pbuf_cat(head, r);
+    }
+  }
+  return head;
+}
+#endif /* LWIP_PBUF_SHARED */
+
+/**
+ * @ingroup pbuf
+ * Makes sure the payload of a pbuf (chain) can be modified without changing
+ * the data seen by others: if any pbuf of the chain is referenced more than
+ * once, is a reference created by pbuf_share() or points to ROM, the data is
+ * copied into a new PBUF_RAM pbuf and 'p' is freed.
+ *
+ * @remark: Either the source pbuf 'p' is freed by this function or the original
+ *          pbuf 'p' is returned, therefore the caller has to check the result!
+ *
+ * @param p the pbuf (chain) that is about to be modified
+ * @return 'p' if it may be modified in place, a copy of it (and 'p' is freed)
+ *         or NULL if the copy could not be allocated (then 'p' is unchanged)
+ */
+struct pbuf *
+pbuf_unshare(struct pbuf *p)
+{
+  struct pbuf *q;
+
+  LWIP_ERROR("pbuf_unshare: invalid pbuf", p != NULL, return NULL;);
+
+  for (q = p; q != NULL; q = q->next) {
+    if ((q->ref > 1) || (q->type_internal == PBUF_ROM)) {
+      break;
+    }
+#if LWIP_PBUF_SHARED
+    if ((q->flags & PBUF_FLAG_IS_CUSTOM) &&
+        (((struct pbuf_custom *)q)->custom_free_function == pbuf_free_shared_ref)) {
+      break;
+    }
+#endif /* LWIP_PBUF_SHARED */
+  }
+  if (q == NULL) {
+    return p;
+  }
+  q = pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+  if (q == NULL) {
+    return NULL;
+  }
+  q->flags = (u8_t)(p->flags & ~PBUF_FLAG_IS_CUSTOM);
+  q->if_idx = p->if_idx;
+  pbuf_free(p);
+  return q;
+}
+
 #if LWIP_CHECKSUM_ON_COPY
 /**
  * Copies data into a single pbuf (*not* into a pbuf queue!) and updates
@@ -1399,7 +1505,7 @@ pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
  * @return byte at an offset into p OR ZERO IF 'offset' >= p->tot_len
  */
 u8_t
-pbuf_get_at(const struct pbuf *p, u16_t offset)
+pbuf_get_at(const struct pbuf *p, pbuf_len_t offset)
 {
   int ret = pbuf_try_get_at(p, offset);
   if (ret >= 0) {
@@ -1417,9 +1523,9 @@ pbuf_get_at(const struct pbuf *p, u16_t offset)
  * @return byte at an offset into p [0..0xFF] OR negative if 'offset' >= p->tot_len
  */
 int
-pbuf_try_get_at(const struct pbuf *p, u16_t offset)
+pbuf_try_get_at(const struct pbuf *p, pbuf_len_t offset)
 {
-  u16_t q_idx;
+  pbuf_len_t q_idx;
   const struct pbuf *q = pbuf_skip_const(p, offset, &q_idx);
 
   /* return requested data if pbuf is OK */
@@ -1439,9 +1545,9 @@ pbuf_try_get_at(const struct pbuf *p, u16_t offset)
  * @param data byte to write at an offset into p
  */
 void
-pbuf_put_at(struct pbuf *p, u16_t offset, u8_t data)
+pbuf_put_at(struct pbuf *p, pbuf_len_t offset, u8_t data)
 {
-  u16_t q_idx;
+  pbuf_len_t q_idx;
   struct pbuf *q = pbuf_skip(p, offset, &q_idx);
 
   /* write requested data if pbuf is OK */
@@ -1464,7 +1570,7 @@ pbuf_put_at(struct pbuf *p, u16_t offset, u8_t data)
 u16_t
 pbuf_memcmp(const struct pbuf *p, u16_t offset, const void *s2, u16_t n)
 {
-  u16_t start = offset;
+  pbuf_len_t start = offset;
   const struct pbuf *q = p;
   u16_t i;
 
@@ -1475,14 +1581,14 @@ pbuf_memcmp(const struct pbuf *p, u16_t offset, const void *s2, u16_t n)
 
   /* get the correct pbuf from chain. We know it succeeds because of p->tot_len check above. */
   while ((q != NULL) && (q->len <= start)) {
-    start = (u16_t)(start - q->len);
+    start = (pbuf_len_t)(start - q->len);
     q = q->next;
   }
 
   /* return requested data if pbuf is OK */
   for (i = 0; i < n; i++) {
     /* We know pbuf_get_at() succeeds because of p->tot_len check above. */
-    u8_t a = pbuf_get_at(q, (u16_t)(start + i));
+    u8_t a = pbuf_get_at(q, (pbuf_len_t)(start + i));
     u8_t b = ((const u8_t *)s2)[i];
     if (a != b) {
       return (u16_t)LWIP_MIN(i + 1, 0xFFFF);
@@ -1496,8 +1602,8 @@ pbuf_memcmp(const struct pbuf *p, u16_t offset, const void *s2, u16_t n)
  * Find occurrence of mem (with length mem_len) in pbuf p, starting at offset
  * start_offset.
  *
- * @param p pbuf to search, maximum length is 0xFFFE since 0xFFFF is used as
- *        return value 'not found'
+ * @param p pbuf to search; since 0xFFFF is used as return value 'not found',
+ *        only matches starting at offsets up to 0xFFFE are found
  * @param mem search for the contents of this buffer
  * @param mem_len length of 'mem'
  * @param start_offset offset into p at which to start searching
@@ -1507,8 +1613,10 @@ u16_t
 pbuf_memfind(const struct pbuf *p, const void *mem, u16_t mem_len, u16_t start_offset)
 {
   u16_t i;
-  u16_t max_cmp_start = (u16_t)(p->tot_len - mem_len);
+  u16_t max_cmp_start;
   if (p->tot_len >= mem_len + start_offset) {
+    /* matches starting beyond 0xFFFE cannot be returned */
+    max_cmp_start = (u16_t)LWIP_MIN(p->tot_len - mem_len, 0xFFFE);
     for (i = start_offset; i <= max_cmp_start; i++) {
       u16_t plus = pbuf_memcmp(p, i, mem, mem_len);
       if (plus == 0) {
@@ -110,6 +110,7 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
+#include "lwip/ip_flow.h"
 #include "lwip/nd6.h"
 
 #include <string.h>
@@ -141,6 +142,38 @@
 #define INITIAL_MSS TCP_MSS
 #endif
 
+/* Layout checks for struct tcp_pcb:
+ * - listen pcbs are cast to struct tcp_pcb (e.g. in the pcb lists), so the
+ *   common part and ext_args must be at the same offsets
+ * - the members tcp_input() and tcp_output() touch for each segment must be
+ *   in the per-segment part (before snd_lbb), which must fit into
+ *   TCP_PCB_HOT_CACHE_LINES cache lines together with the pcb lookup part */
+LWIP_STATIC_ASSERT(tcp_pcb_common_next,
+                   offsetof(struct tcp_pcb, next) == offsetof(struct tcp_pcb_listen, next));
+LWIP_STATIC_ASSERT(tcp_pcb_common_state,
+                   offsetof(struct tcp_pcb, state) == offsetof(struct tcp_pcb_listen, state));
+LWIP_STATIC_ASSERT(tcp_pcb_common_local_port,
+                   offsetof(struct tcp_pcb, local_port) == offsetof(struct tcp_pcb_listen, local_port));
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+LWIP_STATIC_ASSERT(tcp_pcb_common_ext_args,
+                   offsetof(struct tcp_pcb, ext_args) == offsetof(struct tcp_pcb_listen, ext_args));
+#endif /* LWIP_TCP_PCB_NUM_EXT_ARGS */
+LWIP_STATIC_ASSERT(tcp_pcb_hot_size, TCP_PCB_HOT_END <= TCP_PCB_HOT_CACHE_LINES * LWIP_CACHE_LINE_SIZE);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_flags, offsetof(struct tcp_pcb, flags) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_rcv_nxt, offsetof(struct tcp_pcb, rcv_nxt) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_rcv_wnd, offsetof(struct tcp_pcb, rcv_wnd) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_snd_nxt, offsetof(struct tcp_pcb, snd_nxt) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_lastack, offsetof(struct tcp_pcb, lastack) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_snd_wnd, offsetof(struct tcp_pcb, snd_wnd) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_snd_buf, offsetof(struct tcp_pcb, snd_buf) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_cwnd, offsetof(struct tcp_pcb, cwnd) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_ssthresh, offsetof(struct tcp_pcb, ssthresh) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_rtime, offsetof(struct tcp_pcb, rtime) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_rttest, offsetof(struct tcp_pcb, rttest) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_dupacks, offsetof(struct tcp_pcb, dupacks) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_unsent, offsetof(struct tcp_pcb, unsent) < TCP_PCB_HOT_END);
+LWIP_STATIC_ASSERT(tcp_pcb_hot_unacked, offsetof(struct tcp_pcb, unacked) < TCP_PCB_HOT_END);
+
 static const char *const tcp_state_str[] = {
   "CLOSED",
   "LISTEN",
@@ -203,6 +236,9 @@ tcp_init(void)
 #ifdef LWIP_RAND
   tcp_port = TCP_ENSURE_LOCAL_PORT_RANGE(LWIP_RAND());
 #endif /* LWIP_RAND */
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_init: per-segment part of struct tcp_pcb ends at %"SZT_F" (%"SZT_F" cache lines)\n",
+                          (size_t)TCP_PCB_HOT_END,
+                          (size_t)((TCP_PCB_HOT_END + LWIP_CACHE_LINE_SIZE - 1) / LWIP_CACHE_LINE_SIZE)));
 }
 
 /** Free a tcp pcb */
@@ -723,6 +759,11 @@ tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
           if (!ip_get_option(pcb, SOF_REUSEADDR) ||
               !ip_get_option(cpcb, SOF_REUSEADDR))
 #endif /* SO_REUSE */
+#if SO_REUSE_PORT
+            /* SO_REUSEPORT: sharing the port is fine if both pcbs opted in */
+            if (!ip_get_option(pcb, SOF_REUSEPORT) ||
+                !ip_get_option(cpcb, SOF_REUSEPORT))
+#endif /* SO_REUSE_PORT */
           {
             /* @todo: check accept_any_ip_version */
             if ((IP_IS_V6(ipaddr) == IP_IS_V6_VAL(cpcb->local_ip)) &&
@@ -871,7 +912,11 @@ tcp_listen_with_backlog_and_err(struct tcp_pcb *pcb, u8_t backlog, err_t *err)
        this port is only used once for every local IP. */
     for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
       if ((lpcb->local_port == pcb->local_port) &&
-          ip_addr_eq(&lpcb->local_ip, &pcb->local_ip)) {
+          ip_addr_eq(&lpcb->local_ip, &pcb->local_ip)
+#if SO_REUSE_PORT
+          && (!ip_get_option(pcb, SOF_REUSEPORT) || !ip_get_option(lpcb, SOF_REUSEPORT))
+#endif /* SO_REUSE_PORT */
+         ) {
         /* this address/port is already used */
         lpcb = NULL;
         res = ERR_USE;
@@ -969,7 +1014,7 @@ tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb)
  * @param len the amount of bytes that have been read by the application
  */
 void
-tcp_recved(struct tcp_pcb *pcb, u16_t len)
+tcp_recved(struct tcp_pcb *pcb, pbuf_len_t len)
 {
   u32_t wnd_inflation;
   tcpwnd_size_t rcv_wnd;
@@ -1002,7 +1047,7 @@ tcp_recved(struct tcp_pcb *pcb, u16_t len)
     tcp_output(pcb);
   }
 
-  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: received %"U16_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
+  LWIP_DEBUGF(TCP_DEBUG, ("tcp_recved: received %"PBUFLEN_F" bytes, wnd %"TCPWNDSIZE_F" (%"TCPWNDSIZE_F").\n",
                           len, pcb->rcv_wnd, (u16_t)(TCP_WND_MAX(pcb) - pcb->rcv_wnd)));
 }
 
@@ -1087,14 +1132,25 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   ip_addr_set(&pcb->remote_ip, ipaddr);
   pcb->remote_port = port;
 
+  old_local_port = pcb->local_port;
+  if (pcb->local_port == 0) {
+    /* the port is part of the flow hash selecting the path of a route */
+    pcb->local_port = tcp_new_port();
+    if (pcb->local_port == 0) {
+      return ERR_BUF;
+    }
+  }
+
   if (pcb->netif_idx != NETIF_NO_INDEX) {
     netif = netif_get_by_index(pcb->netif_idx);
   } else {
     /* check if we have a route to the remote host */
-    netif = ip_route(&pcb->local_ip, &pcb->remote_ip);
+    netif = ip_route_flow(&pcb->local_ip, &pcb->remote_ip,
+                          ip_flow_hash(NULL, &pcb->remote_ip, IP_PROTO_TCP, pcb->local_port, port));
   }
   if (netif == NULL) {
     /* Don't even try to send a SYN packet if we have no route since that will fail. */
+    pcb->local_port = old_local_port;
     return ERR_RTE;
   }
 
@@ -1102,6 +1158,7 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   if (ip_addr_isany(&pcb->local_ip)) {
     const ip_addr_t *local_ip = ip_netif_get_local_ip(netif, ipaddr);
     if (local_ip == NULL) {
+      pcb->local_port = old_local_port;
       return ERR_RTE;
     }
     ip_addr_copy(pcb->local_ip, *local_ip);
@@ -1116,17 +1173,11 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   }
 #endif /* LWIP_IPV6 && LWIP_IPV6_SCOPES */
 
-  old_local_port = pcb->local_port;
-  if (pcb->local_port == 0) {
-    pcb->local_port = tcp_new_port();
-    if (pcb->local_port == 0) {
-      return ERR_BUF;
-    }
-  } else {
-#if SO_REUSE
-    if (ip_get_option(pcb, SOF_REUSEADDR)) {
-      /* Since SOF_REUSEADDR allows reusing a local address, we have to make sure
-         now that the 5-tuple is unique. */
+  if (old_local_port != 0) {
+#if SO_REUSE || SO_REUSE_PORT
+    if (ip_get_option(pcb, SOF_REUSEADDR | SOF_REUSEPORT)) {
+      /* Since SOF_REUSEADDR/SOF_REUSEPORT allow reusing a local address, we have
+         to make sure now that the 5-tuple is unique. */
       struct tcp_pcb *cpcb;
       int i;
       /* Don't check listen- and bound-PCBs, check active- and TIME-WAIT PCBs. */
@@ -1142,7 +1193,7 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
         }
       }
     }
-#endif /* SO_REUSE */
+#endif /* SO_REUSE || SO_REUSE_PORT */
   }
 
   iss = tcp_next_iss(pcb);
@@ -1542,36 +1593,36 @@ tcp_txnow(void)
 err_t
 tcp_process_refused_data(struct tcp_pcb *pcb)
 {
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
   struct pbuf *rest;
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
 
   LWIP_ERROR("tcp_process_refused_data: invalid pcb", pcb != NULL, return ERR_ARG);
 
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
   while (pcb->refused_data != NULL)
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
   {
     err_t err;
     u8_t refused_flags = pcb->refused_data->flags;
     /* set pcb->refused_data to NULL in case the callback frees it and then
        closes the pcb */
     struct pbuf *refused_data = pcb->refused_data;
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
     pbuf_split_64k(refused_data, &rest);
     pcb->refused_data = rest;
-#else /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#else /* TCP_RECV_SPLIT_64K */
     pcb->refused_data = NULL;
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
     /* Notify again application with data previously received. */
     LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: notify kept packet\n"));
     TCP_EVENT_RECV(pcb, refused_data, ERR_OK, err);
     if (err == ERR_OK) {
       /* did refused_data include a FIN? */
       if ((refused_flags & PBUF_FLAG_TCP_FIN)
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
           && (rest == NULL)
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
          ) {
         /* correct rcv_wnd as the application won't call tcp_recved()
            for the FIN's seqno */
@@ -1591,11 +1642,11 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
       return ERR_ABRT;
     } else {
       /* data is still refused, pbuf is still valid (go on for ACK-only packets) */
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
       if (rest != NULL) {
         pbuf_cat(refused_data, rest);
       }
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
       pcb->refused_data = refused_data;
       return ERR_INPROGRESS;
     }
@@ -105,6 +105,49 @@ static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 #endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
 #endif /* LWIP_TCP_SACK_OUT */
 
+#if SO_REUSE_PORT
+/** Two listen pcbs belong to the same SO_REUSEPORT group */
+#define TCP_LISTEN_REUSEPORT_PEER(a, b) \
+  (ip_get_option(b, SOF_REUSEPORT) && ((a)->local_port == (b)->local_port) && \
+   ((a)->netif_idx == (b)->netif_idx) && \
+   (IP_GET_TYPE(&(a)->local_ip) == IP_GET_TYPE(&(b)->local_ip)) && \
+   ip_addr_eq(&(a)->local_ip, &(b)->local_ip))
+
+/**
+ * Select the listen pcb of an SO_REUSEPORT group that handles the current
+ * segment: the group members are counted and the 4-tuple hash picks one.
+ *
+ * @param lpcb the first listen pcb matching the segment (must have SOF_REUSEPORT set)
+ * @return the group member to pass the segment to
+ */
+static struct tcp_pcb_listen *
+tcp_listen_reuseport_select(struct tcp_pcb_listen *lpcb)
+{
+  struct tcp_pcb_listen *cpcb;
+  u32_t n = 0;
+  u32_t idx;
+
+  for (cpcb = tcp_listen_pcbs.listen_pcbs; cpcb != NULL; cpcb = cpcb->next) {
+    if (TCP_LISTEN_REUSEPORT_PEER(lpcb, cpcb)) {
+      n++;
+    }
+  }
+  if (n <= 1) {
+    return lpcb;
+  }
+  idx = ip_current_flow_hash(lwip_ntohs(tcphdr->src), lwip_ntohs(tcphdr->dest)) % n;
+  for (cpcb = tcp_listen_pcbs.listen_pcbs; cpcb != NULL; cpcb = cpcb->next) {
+    if (TCP_LISTEN_REUSEPORT_PEER(lpcb, cpcb)) {
+      if (idx == 0) {
+        return cpcb;
+      }
+      idx--;
+    }
+  }
+  return lpcb;
+}
+#endif /* SO_REUSE_PORT */
+
 /**
  * The initial input processing of TCP. It verifies the TCP header, demultiplexes
  * the segment between the PCBs and passes it on to tcp_process(), which implements
@@ -144,7 +187,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
   /* Check that TCP header fits in payload */
   if (p->len < TCP_HLEN) {
     /* drop short packets */
-    LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: short packet (%"U16_F" bytes) discarded\n", p->tot_len));
+    LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: short packet (%"PBUFLEN_F" bytes) discarded\n", p->tot_len));
     TCP_STATS_INC(tcp.lenerr);
     goto dropped;
   }
@@ -158,15 +201,17 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
 #if CHECKSUM_CHECK_TCP
   IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
-    /* Verify TCP checksum. */
-    u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
-                                    ip_current_src_addr(), ip_current_dest_addr());
-    if (chksum != 0) {
-      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
-                                    chksum));
-      tcp_debug_print(tcphdr);
-      TCP_STATS_INC(tcp.chkerr);
-      goto dropped;
+    if ((p->flags & PBUF_FLAG_CSUM_VALID) == 0) {
+      /* Verify TCP checksum. */
+      u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
+                                      ip_current_src_addr(), ip_current_dest_addr());
+      if (chksum != 0) {
+        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packet discarded due to failing checksum 0x%04"X16_F"\n",
+                                      chksum));
+        tcp_debug_print(tcphdr);
+        TCP_STATS_INC(tcp.chkerr);
+        goto dropped;
+      }
     }
   }
 #endif /* CHECKSUM_CHECK_TCP */
@@ -207,7 +252,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
     /* check that the options fit in the second pbuf */
     if (opt2len > p->next->len) {
       /* drop short packets */
-      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: options overflow second pbuf (%"U16_F" bytes)\n", p->next->len));
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: options overflow second pbuf (%"PBUFLEN_F" bytes)\n", p->next->len));
       TCP_STATS_INC(tcp.lenerr);
       goto dropped;
     }
@@ -218,7 +263,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
     /* advance p->next to point after the options, and manually
         adjust p->tot_len to keep it consistent with the changed p->next */
     pbuf_remove_header(p->next, opt2len);
-    p->tot_len = (u16_t)(p->tot_len - opt2len);
+    p->tot_len = (pbuf_len_t)(p->tot_len - opt2len);
 
     LWIP_ASSERT("p->len == 0", p->len == 0);
     LWIP_ASSERT("p->tot_len == p->next->tot_len", p->tot_len == p->next->tot_len);
@@ -232,7 +277,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
   tcphdr->wnd = lwip_ntohs(tcphdr->wnd);
 
   flags = TCPH_FLAGS(tcphdr);
-  tcplen = p->tot_len;
+  tcplen = (u16_t)p->tot_len;
   if (flags & (TCP_FIN | TCP_SYN)) {
     tcplen++;
     if (tcplen < p->tot_len) {
@@ -358,6 +403,14 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
 #endif /* SO_REUSE */
     if (lpcb != NULL) {
+#if SO_REUSE_PORT
+      if (ip_get_option(lpcb, SOF_REUSEPORT)) {
+        /* Spread new connections across the SO_REUSEPORT group. The list is
+           not reordered here, as that would change which listener a flow
+           hashes to. */
+        lpcb = tcp_listen_reuseport_select(lpcb);
+      } else
+#endif /* SO_REUSE_PORT */
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
@@ -475,24 +528,24 @@ tcp_input(struct pbuf *p, struct netif *inp)
         if (tcp_input_delayed_close(pcb)) {
           goto aborted;
         }
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
         while (recv_data != NULL) {
           struct pbuf *rest = NULL;
           pbuf_split_64k(recv_data, &rest);
-#else /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#else /* TCP_RECV_SPLIT_64K */
         if (recv_data != NULL) {
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
 
           LWIP_ASSERT("pcb->refused_data == NULL", pcb->refused_data == NULL);
           if (pcb->flags & TF_RXCLOSED) {
             /* received data although already closed -> abort (send RST) to
                notify the remote host that not all data has been processed */
             pbuf_free(recv_data);
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
             if (rest != NULL) {
               pbuf_free(rest);
             }
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
             tcp_abort(pcb);
             goto aborted;
           }
@@ -500,29 +553,29 @@ tcp_input(struct pbuf *p, struct netif *inp)
           /* Notify application that data has been received. */
           TCP_EVENT_RECV(pcb, recv_data, ERR_OK, err);
           if (err == ERR_ABRT) {
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
             if (rest != NULL) {
               pbuf_free(rest);
             }
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
             goto aborted;
           }
 
           /* If the upper layer can't receive this data, store it */
           if (err != ERR_OK) {
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
             if (rest != NULL) {
               pbuf_cat(recv_data, rest);
             }
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
             pcb->refused_data = recv_data;
             LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: keep incoming packet, because pcb is \"full\"\n"));
-#if TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
+#if TCP_RECV_SPLIT_64K
             break;
           } else {
             /* Upper layer received the data, go on with the rest if > 64K */
             recv_data = rest;
-#endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
+#endif /* TCP_RECV_SPLIT_64K */
           }
         }
 
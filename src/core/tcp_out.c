@@ -74,6 +74,7 @@
 #include "lwip/stats.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
+#include "lwip/ip_flow.h"
 #if LWIP_TCP_TIMESTAMPS
 #include "lwip/sys.h"
 #endif
@@ -138,6 +139,10 @@ tcp_route(const struct tcp_pcb *pcb, const ip_addr_t *src, const ip_addr_t *dst)
 
   if ((pcb != NULL) && (pcb->netif_idx != NETIF_NO_INDEX)) {
     return netif_get_by_index(pcb->netif_idx);
+  } else if (pcb != NULL) {
+    /* the local address is left out of the hash, it may not be known yet
+       when tcp_connect() looks for a route */
+    return ip_route_flow(src, dst, ip_flow_hash(NULL, dst, IP_PROTO_TCP, pcb->local_port, pcb->remote_port));
   } else {
     return ip_route(src, dst);
   }
@@ -391,6 +396,52 @@ tcp_write_checks(struct tcp_pcb *pcb, u16_t len)
  */
 err_t
 tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
+{
+  return tcp_write_ref(pcb, arg, len, apiflags, NULL, NULL);
+}
+
+/** Allocate a pbuf referencing non-copied data for tcp_write_ref() */
+static struct pbuf *
+tcp_ref_pbuf_alloc(pbuf_layer layer, const u8_t *dataptr, u16_t len,
+                   tcp_ref_pbuf_fn ref_fn, void *ref_arg)
+{
+  struct pbuf *p;
+  if (ref_fn != NULL) {
+    p = ref_fn(ref_arg, dataptr, len);
+    LWIP_ASSERT("tcp_write_ref: invalid reference pbuf", (p == NULL) ||
+                ((p->len == len) && (p->next == NULL) && ((p->type_internal & PBUF_TYPE_FLAG_DATA_VOLATILE) == 0)));
+  } else {
+    p = pbuf_alloc(layer, len, PBUF_ROM);
+    if (p != NULL) {
+      /* reference the non-volatile payload data */
+      ((struct pbuf_rom *)p)->payload = dataptr;
+    }
+  }
+  return p;
+}
+
+/**
+ * @ingroup tcp_raw
+ * Like tcp_write(), but data that is not copied (TCP_WRITE_FLAG_COPY not set)
+ * is referenced through pbufs allocated by 'ref_fn' instead of plain PBUF_ROM
+ * pbufs. Using a pbuf_custom here, the application is notified when the stack
+ * has released the last reference to the data (i.e. it has been ACKed and all
+ * segments, including any retransmissions queued in netifs, are freed).
+ *
+ * Data referenced this way is never merged into pbufs of earlier writes, so
+ * every referencing pbuf belongs to exactly one call of this function.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param arg Pointer to the data to be enqueued for sending.
+ * @param len Data length in bytes
+ * @param apiflags see tcp_write()
+ * @param ref_fn function allocating the referencing pbufs (NULL behaves like tcp_write())
+ * @param ref_arg argument passed to ref_fn
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write_ref(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags,
+              tcp_ref_pbuf_fn ref_fn, void *ref_arg)
 {
   struct pbuf *concat_p = NULL;
   struct tcp_seg *last_unsent = NULL, *seg = NULL, *prev_seg = NULL, *queue = NULL;
@@ -559,18 +610,21 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
         /* If the last unsent pbuf is of type PBUF_ROM, try to extend it. */
         struct pbuf *p;
         for (p = last_unsent->p; p->next != NULL; p = p->next);
-        if (((p->type_internal & (PBUF_TYPE_FLAG_STRUCT_DATA_CONTIGUOUS | PBUF_TYPE_FLAG_DATA_VOLATILE)) == 0) &&
+        if ((ref_fn == NULL) &&
+#if LWIP_SUPPORT_CUSTOM_PBUF
+            /* custom pbufs track their own data, never extend them */
+            ((p->flags & PBUF_FLAG_IS_CUSTOM) == 0) &&
+#endif /* LWIP_SUPPORT_CUSTOM_PBUF */
+            ((p->type_internal & (PBUF_TYPE_FLAG_STRUCT_DATA_CONTIGUOUS | PBUF_TYPE_FLAG_DATA_VOLATILE)) == 0) &&
             (const u8_t *)p->payload + p->len == (const u8_t *)arg) {
           LWIP_ASSERT("tcp_write: ROM pbufs cannot be oversized", pos == 0);
           extendlen = seglen;
         } else {
-          if ((concat_p = pbuf_alloc(PBUF_RAW, seglen, PBUF_ROM)) == NULL) {
+          if ((concat_p = tcp_ref_pbuf_alloc(PBUF_RAW, (const u8_t *)arg + pos, seglen, ref_fn, ref_arg)) == NULL) {
             LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
                         ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
             goto memerr;
           }
-          /* reference the non-volatile payload data */
-          ((struct pbuf_rom *)concat_p)->payload = (const u8_t *)arg + pos;
           queuelen += pbuf_clen(concat_p);
         }
 #if TCP_CHECKSUM_ON_COPY
@@ -627,7 +681,7 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
 #if TCP_OVERSIZE
       LWIP_ASSERT("oversize == 0", oversize == 0);
 #endif /* TCP_OVERSIZE */
-      if ((p2 = pbuf_alloc(PBUF_TRANSPORT, seglen, PBUF_ROM)) == NULL) {
+      if ((p2 = tcp_ref_pbuf_alloc(PBUF_TRANSPORT, (const u8_t *)arg + pos, seglen, ref_fn, ref_arg)) == NULL) {
         LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write: could not allocate memory for zero-copy pbuf\n"));
         goto memerr;
       }
@@ -639,8 +693,6 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
         chksum = SWAP_BYTES_IN_WORD(chksum);
       }
 #endif /* TCP_CHECKSUM_ON_COPY */
-      /* reference the non-volatile payload data */
-      ((struct pbuf_rom *)p2)->payload = (const u8_t *)arg + pos;
 
       /* Second, allocate a pbuf for the headers. */
       if ((p = pbuf_alloc(PBUF_TRANSPORT, optlen, PBUF_RAM)) == NULL) {
@@ -1829,7 +1881,7 @@ tcp_output_alloc_header_common(u32_t ackno, u16_t optlen, u16_t datalen,
   p = pbuf_alloc(PBUF_IP, TCP_HLEN + optlen + datalen, PBUF_RAM);
   if (p != NULL) {
     LWIP_ASSERT("check that first pbuf can hold struct tcp_hdr",
-                (p->len >= TCP_HLEN + optlen));
+                (p->len >= (pbuf_len_t)(TCP_HLEN + optlen)));
     tcphdr = (struct tcp_hdr *)p->payload;
     tcphdr->src = lwip_htons(src_port);
     tcphdr->dest = lwip_htons(dst_port);
@@ -113,6 +113,9 @@ const struct lwip_cyclic_timer lwip_cyclic_timers[] = {
   {DHCP6_TIMER_MSECS, HANDLER(dhcp6_tmr)},
 #endif /* LWIP_IPV6_DHCP6 */
 #endif /* LWIP_IPV6 */
+#if MEMP_ELASTIC
+  {MEMP_ELASTIC_TMR_INTERVAL, HANDLER(memp_elastic_tmr)},
+#endif /* MEMP_ELASTIC */
 };
 const int lwip_num_cyclic_timers = LWIP_ARRAYSIZE(lwip_cyclic_timers);
 
@@ -56,6 +56,7 @@
 #include "lwip/ip_addr.h"
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
+#include "lwip/ip_flow.h"
 #include "lwip/netif.h"
 #include "lwip/icmp.h"
 #include "lwip/icmp6.h"
@@ -178,6 +179,53 @@ udp_input_local_match(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast)
   return 0;
 }
 
+#if SO_REUSE_PORT
+/** Two unconnected udp pcbs belong to the same SO_REUSEPORT group */
+#define UDP_REUSEPORT_PEER(a, b) \
+  (ip_get_option(b, SOF_REUSEPORT) && (((b)->flags & UDP_FLAGS_CONNECTED) == 0) && \
+   ((a)->local_port == (b)->local_port) && \
+   (IP_GET_TYPE(&(a)->local_ip) == IP_GET_TYPE(&(b)->local_ip)) && \
+   ip_addr_eq(&(a)->local_ip, &(b)->local_ip))
+
+/**
+ * Select the pcb of an SO_REUSEPORT group that receives the current datagram:
+ * the group members accepting it are counted and the 4-tuple hash picks one.
+ *
+ * @param pcb the unconnected pcb matching the datagram (must have SOF_REUSEPORT set)
+ * @param inp network interface on which the datagram was received
+ * @param broadcast 1 if the datagram was sent to a broadcast address
+ * @param src source port (host byte order)
+ * @param dest destination port (host byte order)
+ * @return the group member to pass the datagram to
+ */
+static struct udp_pcb *
+udp_reuseport_select(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast, u16_t src, u16_t dest)
+{
+  struct udp_pcb *cpcb;
+  u32_t n = 0;
+  u32_t idx;
+
+  for (cpcb = udp_pcbs; cpcb != NULL; cpcb = cpcb->next) {
+    if (UDP_REUSEPORT_PEER(pcb, cpcb) && udp_input_local_match(cpcb, inp, broadcast)) {
+      n++;
+    }
+  }
+  if (n <= 1) {
+    return pcb;
+  }
+  idx = ip_current_flow_hash(src, dest) % n;
+  for (cpcb = udp_pcbs; cpcb != NULL; cpcb = cpcb->next) {
+    if (UDP_REUSEPORT_PEER(pcb, cpcb) && udp_input_local_match(cpcb, inp, broadcast)) {
+      if (idx == 0) {
+        return cpcb;
+      }
+      idx--;
+    }
+  }
+  return pcb;
+}
+#endif /* SO_REUSE_PORT */
+
 /**
  * Process an incoming UDP datagram.
  *
@@ -215,7 +263,7 @@ udp_input(struct pbuf *p, struct netif *inp)
   if (p->len < UDP_HLEN) {
     /* drop short packets */
     LWIP_DEBUGF(UDP_DEBUG,
-                ("udp_input: short UDP datagram (%"U16_F" bytes) discarded\n", p->tot_len));
+                ("udp_input: short UDP datagram (%"PBUFLEN_F" bytes) discarded\n", p->tot_len));
     UDP_STATS_INC(udp.lenerr);
     UDP_STATS_INC(udp.drop);
     MIB2_STATS_INC(mib2.udpinerrors);
@@ -228,7 +276,7 @@ udp_input(struct pbuf *p, struct netif *inp)
   /* is broadcast packet ? */
   broadcast = ip_addr_isbroadcast(ip_current_dest_addr(), ip_current_netif());
 
-  LWIP_DEBUGF(UDP_DEBUG, ("udp_input: received datagram of length %"U16_F"\n", p->tot_len));
+  LWIP_DEBUGF(UDP_DEBUG, ("udp_input: received datagram of length %"PBUFLEN_F"\n", p->tot_len));
 
   /* convert src and dest ports to host byte order */
   src = lwip_ntohs(udphdr->src);
@@ -308,6 +356,12 @@ udp_input(struct pbuf *p, struct netif *inp)
   /* no fully matching pcb found? then look for an unconnected pcb */
   if (pcb == NULL) {
     pcb = uncon_pcb;
+#if SO_REUSE_PORT
+    if ((pcb != NULL) && ip_get_option(pcb, SOF_REUSEPORT)) {
+      /* spread flows across the SO_REUSEPORT group */
+      pcb = udp_reuseport_select(pcb, inp, broadcast, src, dest);
+    }
+#endif /* SO_REUSE_PORT */
   }
 
   /* Check checksum if this is a match or if it was directed at us. */
@@ -353,7 +407,7 @@ udp_input(struct pbuf *p, struct netif *inp)
       } else
 #endif /* LWIP_UDPLITE */
       {
-        if (udphdr->chksum != 0) {
+        if ((udphdr->chksum != 0) && ((p->flags & PBUF_FLAG_CSUM_VALID) == 0)) {
           if (ip_chksum_pseudo(p, IP_PROTO_UDP, p->tot_len,
                                ip_current_src_addr(),
                                ip_current_dest_addr()) != 0) {
@@ -388,7 +442,12 @@ udp_input(struct pbuf *p, struct netif *inp)
               /* pass a copy of the packet to all local matches */
               if (mpcb->recv != NULL) {
                 struct pbuf *q;
+#if LWIP_PBUF_SHARED
+                /* read-only reference instead of a copy */
+                q = pbuf_share(p);
+#else /* LWIP_PBUF_SHARED */
                 q = pbuf_clone(PBUF_RAW, PBUF_POOL, p);
+#endif /* LWIP_PBUF_SHARED */
                 if (q != NULL) {
                   mpcb->recv(mpcb->recv_arg, mpcb, q, ip_current_src_addr(), src);
                 }
@@ -427,10 +486,8 @@ udp_input(struct pbuf *p, struct netif *inp)
   } else {
     pbuf_free(p);
   }
-end:
-  PERF_STOP("udp_input");
-  return;
 #if CHECKSUM_CHECK_UDP
+  goto end;
 chkerr:
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_LEVEL_SERIOUS,
               ("udp_input: UDP (or UDP Lite) datagram discarded due to failing checksum\n"));
@@ -438,8 +495,9 @@ chkerr:
   UDP_STATS_INC(udp.drop);
   MIB2_STATS_INC(mib2.udpinerrors);
   pbuf_free(p);
-  PERF_STOP("udp_input");
 #endif /* CHECKSUM_CHECK_UDP */
+end:
+  PERF_STOP("udp_input");
 }
 
 /**
@@ -541,6 +599,17 @@ udp_sendto_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip,
     return ERR_VAL;
   }
 
+#if LWIP_FIB_MAX_PATHS > 1
+  /* the port is part of the flow hash selecting the path of a route, bind
+     before routing the first datagram */
+  if (pcb->local_port == 0) {
+    err_t err = udp_bind(pcb, &pcb->local_ip, pcb->local_port);
+    if (err != ERR_OK) {
+      return err;
+    }
+  }
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE, ("udp_send\n"));
 
   if (pcb->netif_idx != NETIF_NO_INDEX) {
@@ -581,7 +650,8 @@ udp_sendto_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip,
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
     {
       /* find the outgoing network interface for this packet */
-      netif = ip_route(&pcb->local_ip, dst_ip);
+      netif = ip_route_flow(&pcb->local_ip, dst_ip,
+                            ip_flow_hash(NULL, dst_ip, IP_PROTO_UDP, pcb->local_port, dst_port));
     }
   }
 
@@ -794,13 +864,13 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
   }
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 
-  LWIP_DEBUGF(UDP_DEBUG, ("udp_send: sending datagram of length %"U16_F"\n", q->tot_len));
+  LWIP_DEBUGF(UDP_DEBUG, ("udp_send: sending datagram of length %"PBUFLEN_F"\n", q->tot_len));
 
 #if LWIP_UDPLITE
   /* UDP Lite protocol? */
   if (pcb->flags & UDP_FLAGS_UDPLITE) {
     u16_t chklen, chklen_hdr;
-    LWIP_DEBUGF(UDP_DEBUG, ("udp_send: UDP LITE packet length %"U16_F"\n", q->tot_len));
+    LWIP_DEBUGF(UDP_DEBUG, ("udp_send: UDP LITE packet length %"PBUFLEN_F"\n", q->tot_len));
     /* set UDP message length in UDP header */
     chklen_hdr = chklen = pcb->chksum_len_tx;
     if ((chklen < sizeof(struct udp_hdr)) || (chklen > q->tot_len)) {
@@ -846,7 +916,7 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
   } else
 #endif /* LWIP_UDPLITE */
   {      /* UDP */
-    LWIP_DEBUGF(UDP_DEBUG, ("udp_send: UDP packet length %"U16_F"\n", q->tot_len));
+    LWIP_DEBUGF(UDP_DEBUG, ("udp_send: UDP packet length %"PBUFLEN_F"\n", q->tot_len));
     udphdr->len = lwip_htons(q->tot_len);
     /* calculate checksum */
 #if CHECKSUM_GEN_UDP
@@ -994,6 +1064,11 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
         if (!ip_get_option(pcb, SOF_REUSEADDR) ||
             !ip_get_option(ipcb, SOF_REUSEADDR))
 #endif /* SO_REUSE */
+#if SO_REUSE_PORT
+          /* SO_REUSEPORT: sharing the port is fine if both pcbs opted in */
+          if (!ip_get_option(pcb, SOF_REUSEPORT) ||
+              !ip_get_option(ipcb, SOF_REUSEPORT))
+#endif /* SO_REUSE_PORT */
         {
           /* port matches that of PCB in list and REUSEADDR not set -> reject */
           if ((ipcb->local_port == port) &&
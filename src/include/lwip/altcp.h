@@ -99,7 +99,7 @@ void altcp_sent(struct altcp_pcb *conn, altcp_sent_fn sent);
 void altcp_poll(struct altcp_pcb *conn, altcp_poll_fn poll, u8_t interval);
 void altcp_err(struct altcp_pcb *conn, altcp_err_fn err);
 
-void  altcp_recved(struct altcp_pcb *conn, u16_t len);
+void  altcp_recved(struct altcp_pcb *conn, pbuf_len_t len);
 err_t altcp_bind(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t port);
 err_t altcp_connect(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t port, altcp_connected_fn connected);
 
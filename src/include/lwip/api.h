@@ -48,6 +48,9 @@
 #include "lwip/sys.h"
 #include "lwip/ip_addr.h"
 #include "lwip/err.h"
+#if LWIP_SOCKET_ZEROCOPY
+#include "lwip/tcp.h"
+#endif /* LWIP_SOCKET_ZEROCOPY */
 
 #ifdef __cplusplus
 extern "C" {
@@ -212,7 +215,7 @@ struct netconn;
 struct api_msg;
 
 /** A callback prototype to inform about events for a netconn */
-typedef void (* netconn_callback)(struct netconn *, enum netconn_evt, u16_t len);
+typedef void (* netconn_callback)(struct netconn *, enum netconn_evt, pbuf_len_t len);
 
 /** A netconn descriptor */
 struct netconn {
@@ -340,10 +343,18 @@ err_t   netconn_tcp_recvd(struct netconn *conn, size_t len);
 err_t   netconn_sendto(struct netconn *conn, struct netbuf *buf,
                              const ip_addr_t *addr, u16_t port);
 err_t   netconn_send(struct netconn *conn, struct netbuf *buf);
+#if LWIP_SOCKET_MMSG
+err_t   netconn_send_multi(struct netconn *conn, struct netbuf *const *bufs, u16_t num, u16_t *sent);
+#endif /* LWIP_SOCKET_MMSG */
 err_t   netconn_write_partly(struct netconn *conn, const void *dataptr, size_t size,
                              u8_t apiflags, size_t *bytes_written);
 err_t   netconn_write_vectors_partly(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
                                      u8_t apiflags, size_t *bytes_written);
+#if LWIP_SOCKET_ZEROCOPY
+err_t   netconn_write_vectors_ref(struct netconn *conn, struct netvector *vectors, u16_t vectorcnt,
+                                  u8_t apiflags, size_t *bytes_written,
+                                  tcp_ref_pbuf_fn ref_fn, void *ref_arg);
+#endif /* LWIP_SOCKET_ZEROCOPY */
 /** @ingroup netconn_tcp */
 #define netconn_write(conn, dataptr, size, apiflags) \
           netconn_write_partly(conn, dataptr, size, apiflags, NULL)
@@ -294,6 +294,14 @@ typedef int ssize_t;
 #define LWIP_MEM_ALIGN(addr) ((void *)(((mem_ptr_t)(addr) + MEM_ALIGNMENT - 1) & ~(mem_ptr_t)(MEM_ALIGNMENT-1)))
 #endif
 
+/** Size of a data cache line of the target. Used to bound and report how
+ * many cache lines data accessed together (e.g. the per-segment part of
+ * struct tcp_pcb, see TCP_PCB_HOT_CACHE_LINES) takes.
+ */
+#ifndef LWIP_CACHE_LINE_SIZE
+#define LWIP_CACHE_LINE_SIZE 64
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -68,6 +68,9 @@ extern "C" {
 /* Get the number of entries in an array ('x' must NOT be a pointer!) */
 #define LWIP_ARRAYSIZE(x) (sizeof(x)/sizeof((x)[0]))
 
+/* Compile-time assertion: declares a negative-sized array type if 'cond' is false */
+#define LWIP_STATIC_ASSERT(name, cond) typedef char lwip_static_assert_ ## name[(cond) ? 1 : -1]
+
 /** Create u32_t value from bytes */
 #define LWIP_MAKEU32(a,b,c,d) (((u32_t)((a) & 0xff) << 24) | \
                                ((u32_t)((b) & 0xff) << 16) | \
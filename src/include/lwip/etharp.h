@@ -73,7 +73,11 @@ struct etharp_q_entry {
 };
 #endif /* ARP_QUEUEING */
 
+#if ETHARP_TABLE_HASH_SIZE
+void etharp_init(void);
+#else /* ETHARP_TABLE_HASH_SIZE */
 #define etharp_init() /* Compatibility define, no init needed. */
+#endif /* ETHARP_TABLE_HASH_SIZE */
 void etharp_tmr(void);
 ssize_t etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
          struct eth_addr **eth_ret, const ip4_addr_t **ip_ret);
@@ -99,9 +99,10 @@ struct ip_pcb {
 #define SOF_REUSEADDR     0x04U  /* allow local address reuse */
 #define SOF_KEEPALIVE     0x08U  /* keep connections alive */
 #define SOF_BROADCAST     0x20U  /* permit to send and to receive broadcast messages (see IP_SOF_BROADCAST option) */
+#define SOF_REUSEPORT     0x40U  /* allow several pcbs to share local address & port (SO_REUSEPORT does not fit into 8 bits) */
 
 /* These flags are inherited (e.g. from a listen-pcb to a connection-pcb): */
-#define SOF_INHERITED   (SOF_REUSEADDR|SOF_KEEPALIVE)
+#define SOF_INHERITED   (SOF_REUSEADDR|SOF_KEEPALIVE|SOF_REUSEPORT)
 
 /** Global variables of this module, kept in a struct for efficient access using base+index. */
 struct ip_globals
@@ -263,6 +264,16 @@ extern struct ip_globals ip_data;
         (IP_IS_V6(dest) ? \
         ip6_route(ip_2_ip6(src), ip_2_ip6(dest)) : \
         ip4_route_src(ip_2_ip4(src), ip_2_ip4(dest)))
+/**
+ * @ingroup ip
+ * Get netif for address combination, selecting among the next hops of a
+ * multipath route by a flow hash (see ip_flow_hash()). The hash is only
+ * evaluated if LWIP_FIB_MAX_PATHS > 1.
+ */
+#define ip_route_flow(src, dest, flow_hash) \
+        (IP_IS_V6(dest) ? \
+        ip6_route_flow(ip_2_ip6(src), ip_2_ip6(dest), flow_hash) : \
+        ip4_route_flow(ip_2_ip4(src), ip_2_ip4(dest), flow_hash))
 /**
  * @ingroup ip
  * Get netif for IP.
@@ -288,6 +299,8 @@ err_t ip_input(struct pbuf *p, struct netif *inp);
         ip4_output_if(p, src, LWIP_IP_HDRINCL, 0, 0, 0, netif)
 #define ip_route(src, dest) \
         ip4_route_src(src, dest)
+#define ip_route_flow(src, dest, flow_hash) \
+        ip4_route_flow(src, dest, flow_hash)
 #define ip_netif_get_local_ip(netif, dest) \
         ip4_netif_get_local_ip(netif)
 #define ip_debug_print(is_ipv6, p) ip4_debug_print(p)
@@ -308,6 +321,8 @@ err_t ip_input(struct pbuf *p, struct netif *inp);
         ip6_output_if(p, src, LWIP_IP_HDRINCL, 0, 0, 0, netif)
 #define ip_route(src, dest) \
         ip6_route(src, dest)
+#define ip_route_flow(src, dest, flow_hash) \
+        ip6_route_flow(src, dest, flow_hash)
 #define ip_netif_get_local_ip(netif, dest) \
         ip6_netif_get_local_ip(netif, dest)
 #define ip_debug_print(is_ipv6, p) ip6_debug_print(p)
@@ -321,6 +336,10 @@ err_t ip_input(struct pbuf *p, struct netif *inp);
   (ipaddr) = ip_netif_get_local_ip(netif, dest); \
 }while(0)
 
+#if SO_REUSE_PORT
+u32_t ip_current_flow_hash(u16_t src_port, u16_t dest_port);
+#endif /* SO_REUSE_PORT */
+
 #ifdef __cplusplus
 }
 #endif
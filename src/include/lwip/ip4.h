@@ -68,6 +68,11 @@ struct netif *ip4_route_src(const ip4_addr_t *src, const ip4_addr_t *dest);
 #else /* LWIP_IPV4_SRC_ROUTING */
 #define ip4_route_src(src, dest) ip4_route(dest)
 #endif /* LWIP_IPV4_SRC_ROUTING */
+#if LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1)
+struct netif *ip4_route_flow(const ip4_addr_t *src, const ip4_addr_t *dest, u32_t flow_hash);
+#else /* LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1) */
+#define ip4_route_flow(src, dest, flow_hash) ip4_route_src(src, dest)
+#endif /* LWIP_IPV4_FIB && (LWIP_FIB_MAX_PATHS > 1) */
 err_t ip4_input(struct pbuf *p, struct netif *inp);
 err_t ip4_output(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *dest,
        u8_t ttl, u8_t tos, u8_t proto);
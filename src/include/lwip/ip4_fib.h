@@ -0,0 +1,103 @@
+/**
+ * @file
+ * IPv4 longest-prefix-match routing table (FIB) API
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#ifndef LWIP_HDR_IP4_FIB_H
+#define LWIP_HDR_IP4_FIB_H
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV4 && LWIP_IPV4_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/err.h"
+#include "lwip/ip4_addr.h"
+#include "lwip/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Netmask (in host byte order) of a prefix length */
+#define IP4_FIB_PREFIX_MASK(len) (((len) == 0) ? 0 : (u32_t)(0xffffffffUL << (32 - (len))))
+
+/** A next hop of a route */
+struct ip4_fib_path {
+  /** next hop, IP_ADDR_ANY for routes to a directly connected network */
+  ip4_addr_t gw;
+  /** netif to send on */
+  struct netif *netif;
+  /** share of the flows relative to the other paths of the route (1..255) */
+  u8_t weight;
+};
+
+/** A route of the IPv4 FIB */
+struct ip4_fib_route {
+  /** destination prefix (host bits are zero) */
+  ip4_addr_t prefix;
+  /** next hops, the first num_paths are used */
+  struct ip4_fib_path path[LWIP_FIB_MAX_PATHS];
+  /** number of next hops (1..LWIP_FIB_MAX_PATHS) */
+  u8_t num_paths;
+  /** length of the prefix in bits (0..32) */
+  u8_t prefix_len;
+};
+
+/** Node of the path-compressed binary trie. Nodes without a route are only
+ * there to branch. This is exported because memp needs to know the size. */
+struct ip4_fib_node {
+  struct ip4_fib_route route;
+  struct ip4_fib_node *child[2];
+  /** prefix in host byte order (for the bit tests of the lookup) */
+  u32_t key;
+  u8_t has_route;
+};
+
+/** Function prototype for ip4_fib_foreach() */
+typedef void (*ip4_fib_foreach_fn)(const struct ip4_fib_route *route, void *arg);
+
+err_t ip4_fib_add(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif);
+err_t ip4_fib_add_path(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif, u8_t weight);
+err_t ip4_fib_delete(const ip4_addr_t *prefix, u8_t prefix_len);
+err_t ip4_fib_delete_path(const ip4_addr_t *prefix, u8_t prefix_len, const ip4_addr_t *gw, struct netif *netif);
+const struct ip4_fib_route *ip4_fib_lookup(const ip4_addr_t *dest);
+const struct ip4_fib_route *ip4_fib_lookup_usable(const ip4_addr_t *dest, const struct netif *netif);
+const struct ip4_fib_path *ip4_fib_select(const struct ip4_fib_route *route, u32_t flow_hash, const struct netif *netif);
+void ip4_fib_foreach(ip4_fib_foreach_fn fn, void *arg);
+u16_t ip4_fib_num_routes(void);
+void ip4_fib_remove_netif(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_IPV4 && LWIP_IPV4_FIB */
+
+#endif /* LWIP_HDR_IP4_FIB_H */
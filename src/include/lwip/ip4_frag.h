@@ -60,9 +60,23 @@ extern "C" {
  */
 struct ip_reassdata {
   struct ip_reassdata *next;
+#if IP_REASS_HASH_SIZE
+  /* the list is sorted by age, newest first */
+  struct ip_reassdata *prev;
+  struct ip_reassdata *hash_next;
+  /* fragment with the highest offset */
+  struct pbuf *p_last;
+#endif /* IP_REASS_HASH_SIZE */
   struct pbuf *p;
   struct ip_hdr iphdr;
   u16_t datagram_len;
+#if IP_REASS_HASH_SIZE
+  /* payload bytes received */
+  u16_t recv_len;
+  /* pbufs enqueued */
+  u16_t clen;
+  u16_t hash;
+#endif /* IP_REASS_HASH_SIZE */
   u8_t flags;
   u8_t timer;
 };
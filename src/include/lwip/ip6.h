@@ -58,6 +58,11 @@ extern "C" {
 #endif
 
 struct netif *ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest);
+#if LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1)
+struct netif *ip6_route_flow(const ip6_addr_t *src, const ip6_addr_t *dest, u32_t flow_hash);
+#else /* LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1) */
+#define ip6_route_flow(src, dest, flow_hash) ip6_route(src, dest)
+#endif /* LWIP_IPV6_FIB && (LWIP_FIB_MAX_PATHS > 1) */
 const ip_addr_t *ip6_select_source_address(struct netif *netif, const ip6_addr_t * dest);
 err_t         ip6_input(struct pbuf *p, struct netif *inp);
 err_t         ip6_output(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
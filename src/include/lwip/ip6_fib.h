@@ -0,0 +1,112 @@
+/**
+ * @file
+ * IPv6 longest-prefix-match routing table (FIB) API
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#ifndef LWIP_HDR_IP6_FIB_H
+#define LWIP_HDR_IP6_FIB_H
+
+#include "lwip/opt.h"
+
+#if LWIP_IPV6 && LWIP_IPV6_FIB /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/err.h"
+#include "lwip/ip6_addr.h"
+#include "lwip/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of slots of a trie node */
+#define IP6_FIB_NODE_SLOTS (1 << LWIP_IPV6_FIB_STRIDE)
+
+/** A next hop of a route */
+struct ip6_fib_path {
+  /** next hop, IP6_ADDR_ANY for routes to a directly connected network */
+  ip6_addr_t gw;
+  /** netif to send on */
+  struct netif *netif;
+  /** share of the flows relative to the other paths of the route (1..255) */
+  u8_t weight;
+};
+
+/** A route of the IPv6 FIB */
+struct ip6_fib_route {
+  /** next route stored in the same trie node */
+  struct ip6_fib_route *next;
+  /** destination prefix (host bits are zero) */
+  ip6_addr_t prefix;
+  /** next hops, the first num_paths are used */
+  struct ip6_fib_path path[LWIP_FIB_MAX_PATHS];
+  /** number of next hops (1..LWIP_FIB_MAX_PATHS) */
+  u8_t num_paths;
+  /** length of the prefix in bits (0..128) */
+  u8_t prefix_len;
+};
+
+/** Slot of a trie node: the longest route of the node covering the slot and
+ * the node for the next LWIP_IPV6_FIB_STRIDE bits */
+struct ip6_fib_slot {
+  struct ip6_fib_route *route;
+  struct ip6_fib_node *child;
+};
+
+/** Node of the multibit trie. This is exported because memp needs to know
+ * the size. */
+struct ip6_fib_node {
+  struct ip6_fib_slot slot[IP6_FIB_NODE_SLOTS];
+  /** routes whose prefix ends in the bits of this node */
+  struct ip6_fib_route *routes;
+  /** number of routes and children, the node is freed when this drops to 0 */
+  u16_t used;
+};
+
+/** Function prototype for ip6_fib_foreach() */
+typedef void (*ip6_fib_foreach_fn)(const struct ip6_fib_route *route, void *arg);
+
+err_t ip6_fib_add(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif);
+err_t ip6_fib_add_path(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif, u8_t weight);
+err_t ip6_fib_delete(const ip6_addr_t *prefix, u8_t prefix_len);
+err_t ip6_fib_delete_path(const ip6_addr_t *prefix, u8_t prefix_len, const ip6_addr_t *gw, struct netif *netif);
+const struct ip6_fib_route *ip6_fib_lookup(const ip6_addr_t *dest);
+const struct ip6_fib_route *ip6_fib_lookup_usable(const ip6_addr_t *dest, const struct netif *netif);
+const struct ip6_fib_path *ip6_fib_select(const struct ip6_fib_route *route, u32_t flow_hash, const struct netif *netif);
+void ip6_fib_foreach(ip6_fib_foreach_fn fn, void *arg);
+u16_t ip6_fib_num_routes(void);
+void ip6_fib_remove_netif(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
+
+#endif /* LWIP_HDR_IP6_FIB_H */
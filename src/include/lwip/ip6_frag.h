@@ -89,6 +89,21 @@ extern "C" {
  */
 struct ip6_reassdata {
   struct ip6_reassdata *next;
+#if IP_REASS_HASH_SIZE
+  /* the list is sorted by age, newest first */
+  struct ip6_reassdata *prev;
+  struct ip6_reassdata *hash_next;
+  /* fragment with the highest offset */
+  struct pbuf *p_last;
+  /* payload bytes received */
+  u16_t recv_len;
+  /* pbufs enqueued */
+  u16_t clen;
+  u16_t hash;
+#if IP_REASS_MAX_PBUFS_PER_SRC
+  u16_t src_hash;
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+#endif /* IP_REASS_HASH_SIZE */
   struct pbuf *p;
   struct ip6_hdr *iphdr; /* pointer to the first (original) IPv6 header */
 #if IPV6_FRAG_COPYHEADER
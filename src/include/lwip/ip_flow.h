@@ -0,0 +1,95 @@
+/**
+ * @file
+ * Flow hash and forwarding flow cache API
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#ifndef LWIP_HDR_IP_FLOW_H
+#define LWIP_HDR_IP_FLOW_H
+
+#include "lwip/opt.h"
+
+#if IP_FLOW_CACHE_SIZE || (LWIP_FIB_MAX_PATHS > 1) /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/ethernet.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** What identifies a flow. The ports are 0 for protocols without ports and
+ * for fragments. */
+struct ip_flow_key {
+  ip_addr_t src;
+  ip_addr_t dest;
+  u16_t sport;
+  u16_t dport;
+  u8_t proto;
+};
+
+u32_t ip_flow_hash(const ip_addr_t *src, const ip_addr_t *dest, u8_t proto, u16_t sport, u16_t dport);
+u32_t ip_flow_key_hash(const struct ip_flow_key *key);
+#if LWIP_IPV4
+void ip4_flow_key(struct ip_flow_key *key, const struct pbuf *p);
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6 && LWIP_IPV6_FORWARD
+void ip6_flow_key(struct ip_flow_key *key, const struct pbuf *p);
+#endif /* LWIP_IPV6 && LWIP_IPV6_FORWARD */
+
+#if IP_FLOW_CACHE_SIZE
+/** A cached forwarding decision */
+struct ip_flow {
+  struct ip_flow_key key;
+  /** netif to send on, NULL for an unused entry */
+  struct netif *netif;
+  /** hardware address of the next hop */
+  struct eth_addr dhwaddr;
+};
+
+const struct ip_flow *ip_flow_lookup(const struct ip_flow_key *key);
+void ip_flow_learn_start(const struct ip_flow_key *key, struct netif *netif, const struct pbuf *p);
+void ip_flow_learn_stop(void);
+void ip_flow_learn_hwaddr(struct netif *netif, const struct pbuf *p, const struct eth_addr *dst);
+void ip_flow_flush(void);
+#endif /* IP_FLOW_CACHE_SIZE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IP_FLOW_CACHE_SIZE || (LWIP_FIB_MAX_PATHS > 1) */
+
+#if !IP_FLOW_CACHE_SIZE
+#define ip_flow_flush()
+#endif /* !IP_FLOW_CACHE_SIZE */
+
+#endif /* LWIP_HDR_IP_FLOW_H */
@@ -70,10 +70,12 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
 
 #define LWIP_MEMPOOL_DECLARE(name,num,size,desc) \
   LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
+  LWIP_MEMPOOL_DECLARE_TELEMETRY_INSTANCE(memp_telemetry_ ## name) \
   const struct memp_desc memp_ ## name = { \
     DECLARE_LWIP_MEMPOOL_DESC(desc) \
     LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(memp_stats_ ## name) \
     LWIP_MEM_ALIGN_SIZE(size) \
+    LWIP_MEMPOOL_DECLARE_TELEMETRY_REFERENCE(memp_telemetry_ ## name) \
   };
 
 #else /* MEMP_MEM_MALLOC */
@@ -99,6 +101,9 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
     \
   static struct memp *memp_tab_ ## name; \
     \
+  LWIP_MEMPOOL_DECLARE_ELASTIC_INSTANCE(memp_elastic_ ## name, num) \
+  LWIP_MEMPOOL_DECLARE_TELEMETRY_INSTANCE(memp_telemetry_ ## name) \
+    \
   const struct memp_desc memp_ ## name = { \
     DECLARE_LWIP_MEMPOOL_DESC(desc) \
     LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(memp_stats_ ## name) \
@@ -106,6 +111,8 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
     (num), \
     memp_memory_ ## name ## _base, \
     &memp_tab_ ## name \
+    LWIP_MEMPOOL_DECLARE_ELASTIC_REFERENCE(memp_elastic_ ## name) \
+    LWIP_MEMPOOL_DECLARE_TELEMETRY_REFERENCE(memp_telemetry_ ## name) \
   };
 
 #endif /* MEMP_MEM_MALLOC */
@@ -148,6 +155,21 @@ void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
 
+#if MEMP_ELASTIC
+/** Interval of the timer giving unused slabs of elastic pools back to the heap */
+#define MEMP_ELASTIC_TMR_INTERVAL 1000
+void  memp_set_ceiling(memp_t type, u16_t ceiling);
+void  memp_elastic_tmr(void);
+#endif /* MEMP_ELASTIC */
+
+#if MEMP_TELEMETRY
+void  memp_telemetry_get(memp_t type, struct memp_telemetry *telemetry);
+void  memp_telemetry_reset(void);
+#if MEMP_OVERFLOW_CHECK
+u16_t memp_telemetry_get_sites(struct memp_telemetry_site *sites, u16_t num);
+#endif /* MEMP_OVERFLOW_CHECK */
+#endif /* MEMP_TELEMETRY */
+
 #ifdef __cplusplus
 }
 #endif
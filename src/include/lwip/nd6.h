@@ -66,12 +66,18 @@ extern "C" {
 struct pbuf;
 struct netif;
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+void nd6_init(void);
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+#define nd6_init() /* Compatibility define, no init needed. */
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 void nd6_tmr(void);
 void nd6_input(struct pbuf *p, struct netif *inp);
 void nd6_clear_destination_cache(void);
 struct netif *nd6_find_route(const ip6_addr_t *ip6addr);
 err_t nd6_get_next_hop_addr_or_queue(struct netif *netif, struct pbuf *q, const ip6_addr_t *ip6addr, const u8_t **hwaddrp);
 u16_t nd6_get_destination_mtu(const ip6_addr_t *ip6addr, struct netif *netif);
+err_t nd6_set_cache_sizes(u8_t num_neighbors, u16_t num_destinations);
 #if LWIP_ND6_TCP_REACHABILITY_HINTS
 void nd6_reachability_hint(const ip6_addr_t *ip6addr);
 #endif /* LWIP_ND6_TCP_REACHABILITY_HINTS */
@@ -73,14 +73,14 @@ struct netbuf {
 /* Network buffer functions: */
 struct netbuf *   netbuf_new      (void);
 void              netbuf_delete   (struct netbuf *buf);
-void *            netbuf_alloc    (struct netbuf *buf, u16_t size);
+void *            netbuf_alloc    (struct netbuf *buf, pbuf_len_t size);
 void              netbuf_free     (struct netbuf *buf);
 err_t             netbuf_ref      (struct netbuf *buf,
-                                   const void *dataptr, u16_t size);
+                                   const void *dataptr, pbuf_len_t size);
 void              netbuf_chain    (struct netbuf *head, struct netbuf *tail);
 
 err_t             netbuf_data     (struct netbuf *buf,
-                                   void **dataptr, u16_t *len);
+                                   void **dataptr, pbuf_len_t *len);
 s8_t              netbuf_next     (struct netbuf *buf);
 void              netbuf_first    (struct netbuf *buf);
 
@@ -153,6 +153,9 @@ enum lwip_internal_netif_client_data_index
 #endif /* LWIP_CHECKSUM_CTRL_PER_NETIF */
 
 struct netif;
+#if LWIP_VLANIF
+struct vlanif_table;
+#endif /* LWIP_VLANIF */
 
 /** MAC Filter Actions, these are passed to a netif's igmp_mac_filter or
  * mld_mac_filter callback function. */
@@ -388,6 +391,10 @@ struct netif {
 #if LWIP_ACD
   struct acd *acd_list;
 #endif /* LWIP_ACD */
+#if LWIP_VLANIF
+  /** VLAN sub-interfaces stacked on this netif, indexed by VID */
+  struct vlanif_table *vlans;
+#endif /* LWIP_VLANIF */
 #if LWIP_NETIF_USE_HINTS
   struct netif_hint *hints;
 #endif /* LWIP_NETIF_USE_HINTS */
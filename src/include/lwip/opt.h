@@ -273,6 +273,113 @@
 #define MEMP_MEM_INIT                   0
 #endif
 
+/**
+ * MEMP_ELASTIC==1: Let pools grow beyond their static size. Once the static
+ * elements of a pool are used up, further elements are carved from slabs
+ * allocated with mem_malloc(), up to a per-pool ceiling (see
+ * MEMP_ELASTIC_CEILING and memp_set_ceiling()). Slabs that stayed unused
+ * for MEMP_ELASTIC_DECAY_MS are given back to the heap.
+ * Allocating and freeing stay O(1), for slab elements too. Growing calls mem_malloc(),
+ * so pools used from interrupt context (e.g. PBUF_POOL in a netif driver)
+ * need a heap that is safe to use from there (or a ceiling equal to their size).
+ * Cannot be combined with MEMP_MEM_MALLOC or MEM_USE_POOLS.
+ */
+#if !defined MEMP_ELASTIC || defined __DOXYGEN__
+#define MEMP_ELASTIC                    0
+#endif
+
+/**
+ * MEMP_ELASTIC_CEILING(num): default ceiling (total number of elements) of
+ * an elastic pool that has 'num' static elements. Can be changed per pool at
+ * runtime via memp_set_ceiling().
+ */
+#if !defined MEMP_ELASTIC_CEILING || defined __DOXYGEN__
+#define MEMP_ELASTIC_CEILING(num)       (2 * (num))
+#endif
+
+/**
+ * MEMP_ELASTIC_SLAB_NUM: number of elements allocated at once when an elastic
+ * pool grows.
+ */
+#if !defined MEMP_ELASTIC_SLAB_NUM || defined __DOXYGEN__
+#define MEMP_ELASTIC_SLAB_NUM           8
+#endif
+
+/**
+ * MEMP_ELASTIC_DECAY_MS: time in milliseconds a slab must stay completely
+ * unused before it is given back to the heap.
+ */
+#if !defined MEMP_ELASTIC_DECAY_MS || defined __DOXYGEN__
+#define MEMP_ELASTIC_DECAY_MS           10000
+#endif
+
+/**
+ * MEMP_TELEMETRY==1: Record allocation telemetry for every pool, to be read
+ * with memp_telemetry_get(): allocation/free/failure counts, the allocation
+ * rate, the last failure bursts (with timestamps) and a histogram of how long
+ * elements stay allocated. With MEMP_OVERFLOW_CHECK, allocations are also
+ * counted per call site (memp_telemetry_get_sites()).
+ * Each pool element gets a small header (allocation time) and every
+ * allocation and free reads MEMP_TELEMETRY_NOW(), so this is meant for
+ * sizing pools, not for production builds.
+ */
+#if !defined MEMP_TELEMETRY || defined __DOXYGEN__
+#define MEMP_TELEMETRY                  0
+#endif
+
+/**
+ * MEMP_TELEMETRY_NOW(): time source of MEMP_TELEMETRY. All times (rate
+ * window, burst gap and timestamps, histogram buckets) are in its unit.
+ * Defaults to sys_now() (milliseconds); map it to a finer clock to resolve
+ * short element lifetimes.
+ */
+#if !defined MEMP_TELEMETRY_NOW || defined __DOXYGEN__
+#define MEMP_TELEMETRY_NOW()            sys_now()
+#endif
+
+/**
+ * MEMP_TELEMETRY_RATE_WINDOW: window over which the allocation rate is
+ * counted (1 second with the default time source).
+ */
+#if !defined MEMP_TELEMETRY_RATE_WINDOW || defined __DOXYGEN__
+#define MEMP_TELEMETRY_RATE_WINDOW      1000
+#endif
+
+/**
+ * MEMP_TELEMETRY_HIST_BUCKETS: number of buckets of the lifetime histogram.
+ * Bucket 0 counts lifetimes of 0, bucket n lifetimes in [2^(n-1), 2^n), the
+ * last bucket everything longer.
+ */
+#if !defined MEMP_TELEMETRY_HIST_BUCKETS || defined __DOXYGEN__
+#define MEMP_TELEMETRY_HIST_BUCKETS     16
+#endif
+
+/**
+ * MEMP_TELEMETRY_BURSTS: number of failure bursts kept per pool. Failures
+ * less than MEMP_TELEMETRY_BURST_GAP apart belong to the same burst.
+ */
+#if !defined MEMP_TELEMETRY_BURSTS || defined __DOXYGEN__
+#define MEMP_TELEMETRY_BURSTS           4
+#endif
+
+/**
+ * MEMP_TELEMETRY_BURST_GAP: time without failures that ends a burst.
+ */
+#if !defined MEMP_TELEMETRY_BURST_GAP || defined __DOXYGEN__
+#define MEMP_TELEMETRY_BURST_GAP        100
+#endif
+
+/**
+ * MEMP_TELEMETRY_SITES: number of call sites (file, line, pool) counted
+ * (MEMP_TELEMETRY with MEMP_OVERFLOW_CHECK only). When the table is full, a new
+ * site replaces the least-used one that has no elements allocated; if there is
+ * none, allocations from the new site are not broken down.
+ * memp_telemetry_reset() removes all sites without allocated elements.
+ */
+#if !defined MEMP_TELEMETRY_SITES || defined __DOXYGEN__
+#define MEMP_TELEMETRY_SITES            32
+#endif
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> \#define MEM_ALIGNMENT 4
@@ -463,6 +570,31 @@
 #define MEMP_NUM_REASSDATA              5
 #endif
 
+/**
+ * MEMP_NUM_IP4_FIB_NODE: the number of trie nodes of the IPv4 routing table
+ * (LWIP_IPV4_FIB). A table of n routes needs at most 2*n-1 nodes.
+ */
+#if !defined MEMP_NUM_IP4_FIB_NODE || defined __DOXYGEN__
+#define MEMP_NUM_IP4_FIB_NODE           64
+#endif
+
+/**
+ * MEMP_NUM_IP6_FIB_ROUTE: the number of routes of the IPv6 routing table
+ * (LWIP_IPV6_FIB).
+ */
+#if !defined MEMP_NUM_IP6_FIB_ROUTE || defined __DOXYGEN__
+#define MEMP_NUM_IP6_FIB_ROUTE          16
+#endif
+
+/**
+ * MEMP_NUM_IP6_FIB_NODE: the number of trie nodes of the IPv6 routing table
+ * (LWIP_IPV6_FIB). A route needs a node for every LWIP_IPV6_FIB_STRIDE bits
+ * of its prefix that it does not share with other routes.
+ */
+#if !defined MEMP_NUM_IP6_FIB_NODE || defined __DOXYGEN__
+#define MEMP_NUM_IP6_FIB_NODE           32
+#endif
+
 /**
  * MEMP_NUM_FRAG_PBUF: the number of IP fragments simultaneously sent
  * (fragments, not whole packets!).
@@ -474,6 +606,15 @@
 #define MEMP_NUM_FRAG_PBUF              15
 #endif
 
+/**
+ * MEMP_NUM_PBUF_SHARED: the number of shared references (per pbuf, not per
+ * chain) that may exist at the same time.
+ * (only needed if you use LWIP_PBUF_SHARED)
+ */
+#if !defined MEMP_NUM_PBUF_SHARED || defined __DOXYGEN__
+#define MEMP_NUM_PBUF_SHARED            16
+#endif
+
 /**
  * MEMP_NUM_ARP_QUEUE: the number of simultaneously queued outgoing
  * packets (pbufs) that are waiting for an ARP request (to resolve
@@ -498,7 +639,7 @@
  * The number of sys timeouts used by the core stack (not apps)
  * The default number of timeouts is calculated here for all enabled modules.
  */
-#define LWIP_NUM_SYS_TIMEOUT_INTERNAL   (LWIP_TCP + IP_REASSEMBLY + LWIP_ARP + (2*LWIP_DHCP) + LWIP_ACD + LWIP_IGMP + LWIP_DNS + PPP_NUM_TIMEOUTS + (LWIP_IPV6 * (1 + LWIP_IPV6_REASS + LWIP_IPV6_MLD + LWIP_IPV6_DHCP6)))
+#define LWIP_NUM_SYS_TIMEOUT_INTERNAL   (LWIP_TCP + MEMP_ELASTIC + IP_REASSEMBLY + LWIP_ARP + (2*LWIP_DHCP) + LWIP_ACD + LWIP_IGMP + LWIP_DNS + PPP_NUM_TIMEOUTS + (LWIP_IPV6 * (1 + LWIP_IPV6_REASS + LWIP_IPV6_MLD + LWIP_IPV6_DHCP6)))
 
 /**
  * MEMP_NUM_SYS_TIMEOUT: the number of simultaneously active timeouts.
@@ -534,6 +675,24 @@
 #define MEMP_NUM_SELECT_CB              4
 #endif
 
+/**
+ * MEMP_NUM_SOCKET_ZC_SEND: the number of MSG_ZEROCOPY send calls (over all
+ * sockets) that may be waiting for completion at the same time.
+ * (only needed if you use LWIP_SOCKET_ZEROCOPY)
+ */
+#if !defined MEMP_NUM_SOCKET_ZC_SEND || defined __DOXYGEN__
+#define MEMP_NUM_SOCKET_ZC_SEND         8
+#endif
+
+/**
+ * MEMP_NUM_SOCKET_ZC_PBUF: the number of pbuf_custom structs referencing
+ * MSG_ZEROCOPY data (over all sockets), one per enqueued segment.
+ * (only needed if you use LWIP_SOCKET_ZEROCOPY)
+ */
+#if !defined MEMP_NUM_SOCKET_ZC_PBUF || defined __DOXYGEN__
+#define MEMP_NUM_SOCKET_ZC_PBUF         TCP_SND_QUEUELEN
+#endif
+
 /**
  * MEMP_NUM_TCPIP_MSG_API: the number of struct tcpip_msg, which are used
  * for callback/timeout API communication.
@@ -682,6 +841,22 @@
 #define LWIP_VLAN_PCP                   0
 #endif
 
+/**
+ * LWIP_VLANIF==1: support IEEE 802.1Q VLAN sub-interfaces (see @ref vlanif):
+ * netifs stacked on a parent ethernet netif, each one terminating a VLAN of
+ * the parent. ethernet_input() passes tagged frames to the sub-interface of
+ * their VID through a table of the parent. Sub-interfaces are full netifs:
+ * netif_add() numbers netifs with a u8_t (at most 255, including the parent
+ * and the loopback netif), so only about 250 VLANs can be terminated, and
+ * ip4_route()/ip6_route() walk all of them.
+ * Sub-interfaces stacked on sub-interfaces terminate Q-in-Q (802.1ad).
+ * The tag is inserted into the header room of transmitted frames: add 4
+ * bytes per tag to PBUF_LINK_ENCAPSULATION_HLEN, else frames are copied.
+ */
+#if !defined LWIP_VLANIF || defined __DOXYGEN__
+#define LWIP_VLANIF                     0
+#endif
+
 /** LWIP_ETHERNET==1: enable ethernet support even though ARP might be disabled
  */
 #if !defined LWIP_ETHERNET || defined __DOXYGEN__
@@ -711,6 +886,15 @@
 #if !defined ETHARP_TABLE_MATCH_NETIF || defined __DOXYGEN__
 #define ETHARP_TABLE_MATCH_NETIF        !LWIP_SINGLE_NETIF
 #endif
+
+/** ETHARP_TABLE_HASH_SIZE: Number of hash buckets indexing the ARP table
+ * (a power of 2), or 0 to search the table linearly. With the hash index,
+ * a full table recycles its least recently used dynamic entry. Enable this
+ * for a large ARP_TABLE_SIZE, e.g. on a flat network with thousands of hosts.
+ */
+#if !defined ETHARP_TABLE_HASH_SIZE || defined __DOXYGEN__
+#define ETHARP_TABLE_HASH_SIZE          0
+#endif
 /**
  * @}
  */
@@ -759,6 +943,17 @@
 #define IP_FRAG                         1
 #endif
 
+/**
+ * LWIP_IPV4_FIB==1: Enable a longest-prefix-match routing table (FIB) for
+ * IPv4. Routes to prefixes are added at runtime (see ip4_fib.h) and are
+ * consulted by ip4_route() and by etharp_output() to select the gateway.
+ * The table is a path-compressed binary trie allocated from
+ * MEMP_NUM_IP4_FIB_NODE.
+ */
+#if !defined LWIP_IPV4_FIB || defined __DOXYGEN__
+#define LWIP_IPV4_FIB                   0
+#endif
+
 #if !LWIP_IPV4
 /* disable IPv4 extensions when IPv4 is disabled */
 #undef IP_FORWARD
@@ -767,6 +962,8 @@
 #define IP_REASSEMBLY                   0
 #undef IP_FRAG
 #define IP_FRAG                         0
+#undef LWIP_IPV4_FIB
+#define LWIP_IPV4_FIB                   0
 #endif /* !LWIP_IPV4 */
 
 /**
@@ -799,6 +996,30 @@
 #define IP_REASS_MAX_PBUFS              10
 #endif
 
+/**
+ * IP_REASS_HASH_SIZE: Number of hash buckets indexing the IPv4 and IPv6
+ * datagrams being reassembled (a power of 2), or 0 to search them linearly.
+ * With the index, the oldest datagram is found without a search and a
+ * datagram is complete once all of its bytes were received, without walking
+ * its fragments. Enable this for a large MEMP_NUM_REASSDATA or
+ * MEMP_NUM_IP6_REASSDATA.
+ */
+#if !defined IP_REASS_HASH_SIZE || defined __DOXYGEN__
+#define IP_REASS_HASH_SIZE              0
+#endif
+
+/**
+ * IP_REASS_MAX_PBUFS_PER_SRC: Maximum amount of pbufs waiting to be
+ * reassembled per source address, or 0 for no limit but IP_REASS_MAX_PBUFS.
+ * A fragment exceeding it first frees the oldest datagrams of its own source,
+ * so that one source cannot take up the whole reassembly buffer.
+ * The sources are counted per bucket of a hash (IP_REASS_HASH_SIZE buckets),
+ * so this needs IP_REASS_HASH_SIZE != 0.
+ */
+#if !defined IP_REASS_MAX_PBUFS_PER_SRC || defined __DOXYGEN__
+#define IP_REASS_MAX_PBUFS_PER_SRC      0
+#endif
+
 /**
  * IP_DEFAULT_TTL: Default value for Time-To-Live used by transport layers.
  */
@@ -833,6 +1054,31 @@
 #if !defined IP_FORWARD_ALLOW_TX_ON_RX_NETIF || defined __DOXYGEN__
 #define IP_FORWARD_ALLOW_TX_ON_RX_NETIF 0
 #endif
+
+/**
+ * IP_FLOW_CACHE_SIZE: Number of entries (a power of 2) of a cache of
+ * forwarding decisions for IP_FORWARD and LWIP_IPV6_FORWARD, or 0 to route
+ * every forwarded packet. Flows are keyed by addresses, protocol and ports;
+ * packets of a cached flow skip route selection and ARP/ND and go to
+ * ethernet_output() with the hardware address of the next hop (see ip_flow.c).
+ * Needs LWIP_ETHERNET.
+ */
+#if !defined IP_FLOW_CACHE_SIZE || defined __DOXYGEN__
+#define IP_FLOW_CACHE_SIZE              0
+#endif
+
+/**
+ * LWIP_FIB_MAX_PATHS: Maximum number of next hops of a route of the IPv4 and
+ * IPv6 FIB (LWIP_IPV4_FIB, LWIP_IPV6_FIB), at most 255. With more than one,
+ * routes can spread their traffic over several gateways and netifs (equal-
+ * or weighted-cost multipath): the path of a packet is picked by a hash of
+ * its addresses, protocol and ports, so all packets of a TCP connection or
+ * UDP flow take the same path. Every path costs a gateway address, a netif
+ * pointer and a weight in each route.
+ */
+#if !defined LWIP_FIB_MAX_PATHS || defined __DOXYGEN__
+#define LWIP_FIB_MAX_PATHS              1
+#endif
 /**
  * @}
  */
@@ -1511,6 +1757,17 @@
 #define LWIP_TCP_PCB_NUM_EXT_ARGS       0
 #endif
 
+/**
+ * TCP_PCB_HOT_CACHE_LINES: number of cache lines (of LWIP_CACHE_LINE_SIZE
+ * bytes) the part of struct tcp_pcb touched for each segment (up to
+ * TCP_PCB_HOT_END, including the pcb lookup part) may take. Checked at
+ * compile time, so members added to it must be traded against others.
+ * The default is 256 bytes plus the ext_args (LWIP_TCP_PCB_NUM_EXT_ARGS).
+ */
+#if !defined TCP_PCB_HOT_CACHE_LINES || defined __DOXYGEN__
+#define TCP_PCB_HOT_CACHE_LINES         ((256 + LWIP_TCP_PCB_NUM_EXT_ARGS * 2 * sizeof(void *) + LWIP_CACHE_LINE_SIZE - 1) / LWIP_CACHE_LINE_SIZE)
+#endif
+
 /** LWIP_ALTCP==1: enable the altcp API.
  * altcp is an abstraction layer that prevents applications linking against the
  * tcp.h functions but provides the same functionality. It is used to e.g. add
@@ -1588,6 +1845,31 @@
 #define LWIP_PBUF_REF_T                 u8_t
 #endif
 
+/**
+ * LWIP_PBUF_LEN32==1: Use 32-bit pbuf lengths (tot_len, len) and offsets into
+ * pbuf chains instead of 16-bit ones. This allows single pbufs and chains
+ * bigger than 64 KByte (e.g. coalesced receive or large TCP receive windows
+ * handed to the application in one chain) at the cost of 4 more bytes per pbuf.
+ * Protocol limits still apply: IPv4 and IPv6 packets stay below 64 KByte.
+ */
+#if !defined LWIP_PBUF_LEN32 || defined __DOXYGEN__
+#define LWIP_PBUF_LEN32                 0
+#endif
+
+/**
+ * LWIP_PBUF_SHARED==1: Enable pbuf_share() and use it where one received
+ * packet is handed to several consumers: broadcast/multicast UDP delivered
+ * to all matching pcbs (SO_REUSE_RXTOALL). Instead of a copy, each
+ * additional consumer then gets a read-only reference (one pbuf_custom per
+ * pbuf of the chain, from MEMP_PBUF_SHARED) with its own payload pointer
+ * onto the same buffer. Consumers that modify
+ * the payload have to call pbuf_unshare() first.
+ * Needs LWIP_SUPPORT_CUSTOM_PBUF.
+ */
+#if !defined LWIP_PBUF_SHARED || defined __DOXYGEN__
+#define LWIP_PBUF_SHARED                0
+#endif
+
 /**
  * LWIP_PBUF_CUSTOM_DATA: Store private data on pbufs (e.g. timestamps)
  * This extends struct pbuf so user can store custom data on every pbuf.
@@ -2009,6 +2291,47 @@
 #define LWIP_SOCKET_OFFSET              0
 #endif
 
+/**
+ * LWIP_NUM_SOCKETS: maximum number of sockets (and size of fd_set). Socket
+ * descriptors are LWIP_SOCKET_OFFSET .. LWIP_SOCKET_OFFSET + LWIP_NUM_SOCKETS - 1.
+ * Each socket needs a netconn, so raising this above MEMP_NUM_NETCONN only
+ * makes sense with MEMP_MEM_MALLOC or a larger netconn pool.
+ */
+#if !defined LWIP_NUM_SOCKETS || defined __DOXYGEN__
+#define LWIP_NUM_SOCKETS                MEMP_NUM_NETCONN
+#endif
+
+/**
+ * LWIP_SOCKET_DYNAMIC==1: Allocate the socket table in chunks of
+ * LWIP_SOCKET_CHUNK_SIZE sockets when they are first needed instead of
+ * statically reserving LWIP_NUM_SOCKETS sockets. Chunks are never freed, so
+ * the table only grows up to the number of sockets used at the same time.
+ * Each chunk also brings LWIP_SOCKET_CHUNK_SIZE IPv4 and IPv6 multicast
+ * membership slots (LWIP_SOCKET_MAX_MEMBERSHIPS is not used then).
+ */
+#if !defined LWIP_SOCKET_DYNAMIC || defined __DOXYGEN__
+#define LWIP_SOCKET_DYNAMIC             0
+#endif
+
+/**
+ * LWIP_SOCKET_CHUNK_SIZE: number of sockets allocated at once with
+ * LWIP_SOCKET_DYNAMIC==1.
+ */
+#if !defined LWIP_SOCKET_CHUNK_SIZE || defined __DOXYGEN__
+#define LWIP_SOCKET_CHUNK_SIZE          8
+#endif
+
+/**
+ * LWIP_SOCKET_CHUNK_MALLOC/LWIP_SOCKET_CHUNK_FREE: allocator used for socket
+ * table chunks with LWIP_SOCKET_DYNAMIC==1.
+ */
+#if !defined LWIP_SOCKET_CHUNK_MALLOC || defined __DOXYGEN__
+#define LWIP_SOCKET_CHUNK_MALLOC(size)  mem_malloc(size)
+#endif
+#if !defined LWIP_SOCKET_CHUNK_FREE || defined __DOXYGEN__
+#define LWIP_SOCKET_CHUNK_FREE(ptr)     mem_free(ptr)
+#endif
+
 /**
  * LWIP_SOCKET_EXTERNAL_HEADERS==1: Use external headers instead of sockets.h
  * and inet.h. In this case, user must provide its own headers by setting the
@@ -2097,6 +2420,17 @@
 #define SO_REUSE_RXTOALL                0
 #endif
 
+/**
+ * SO_REUSE_PORT==1: Enable SO_REUSEPORT option. Several TCP listen pcbs or
+ * unconnected UDP pcbs may then bind the same local address and port (all of
+ * them must set the option). New TCP connections and UDP datagrams are
+ * distributed among them by a hash over the 4-tuple, so one flow always
+ * reaches the same pcb.
+ */
+#if !defined SO_REUSE_PORT || defined __DOXYGEN__
+#define SO_REUSE_PORT                   0
+#endif
+
 /**
  * LWIP_FIONREAD_LINUXMODE==0 (default): ioctl/FIONREAD returns the amount of
  * pending data in the network buffer. This is the way windows does it. It's
@@ -2126,6 +2460,54 @@
 #if !defined LWIP_SOCKET_POLL || defined __DOXYGEN__
 #define LWIP_SOCKET_POLL                1
 #endif
+
+/**
+ * LWIP_SOCKET_MMSG==1: enable lwip_recvmmsg() and lwip_sendmmsg() to move
+ * several datagrams per call on UDP and RAW sockets (also enables
+ * netconn_send_multi()).
+ */
+#if !defined LWIP_SOCKET_MMSG || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG                0
+#endif
+
+/**
+ * LWIP_SOCKET_MMSG_BATCH: maximum number of datagrams lwip_sendmmsg() passes
+ * to the tcpip_thread in one message (one netbuf per datagram is kept on the
+ * calling thread's stack).
+ */
+#if !defined LWIP_SOCKET_MMSG_BATCH || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG_BATCH          8
+#endif
+
+/**
+ * LWIP_SOCKET_ZEROCOPY==1: enable the MSG_ZEROCOPY send flag for TCP sockets.
+ * The stack then references the application's buffer through pbuf_custom
+ * instead of copying it, and reports when every referencing pbuf has been
+ * freed via lwip_recvmsg(MSG_ERRQUEUE). Requires LWIP_TCP and
+ * LWIP_SUPPORT_CUSTOM_PBUF.
+ */
+#if !defined LWIP_SOCKET_ZEROCOPY || defined __DOXYGEN__
+#define LWIP_SOCKET_ZEROCOPY            0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL==1: enable an epoll()-style readiness API for sockets
+ * (lwip_epoll_create/lwip_epoll_ctl/lwip_epoll_wait). Sockets are kept in a
+ * persistent interest set and the netconn event callback appends ready sockets
+ * to a per-instance ready list, so waiting does not need to rescan all sockets.
+ * Requires LWIP_SOCKET_SELECT or LWIP_SOCKET_POLL (for the event callback).
+ */
+#if !defined LWIP_SOCKET_EPOLL || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL               0
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL_MAX: maximum number of concurrently open epoll instances.
+ * Every socket reserves one registration slot per instance, so keep this small.
+ */
+#if !defined LWIP_SOCKET_EPOLL_MAX || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL_MAX           1
+#endif
 /**
  * @}
  */
@@ -2475,6 +2857,26 @@
 #define LWIP_IPV6_FORWARD               0
 #endif
 
+/**
+ * LWIP_IPV6_FIB==1: Enable a longest-prefix-match routing table (FIB) for
+ * IPv6. Routes to prefixes of any length are added at runtime (see
+ * ip6_fib.h) and are consulted by ip6_route() and by ND6 to select the next
+ * hop. The table is a multibit trie allocated from MEMP_NUM_IP6_FIB_NODE and
+ * MEMP_NUM_IP6_FIB_ROUTE.
+ */
+#if !defined LWIP_IPV6_FIB || defined __DOXYGEN__
+#define LWIP_IPV6_FIB                   0
+#endif
+
+/**
+ * LWIP_IPV6_FIB_STRIDE: Number of address bits consumed per level of the
+ * IPv6 FIB trie (1, 2, 4 or 8). A lookup visits at most 128/stride nodes, a
+ * node has 2^stride slots of two pointers each.
+ */
+#if !defined LWIP_IPV6_FIB_STRIDE || defined __DOXYGEN__
+#define LWIP_IPV6_FIB_STRIDE            4
+#endif
+
 /**
  * LWIP_IPV6_FRAG==1: Fragment outgoing IPv6 packets that are too big.
  */
@@ -2606,6 +3008,7 @@
 
 /**
  * LWIP_ND6_NUM_NEIGHBORS: Number of entries in IPv6 neighbor cache
+ * (the limit for nd6_set_cache_sizes())
  */
 #if !defined LWIP_ND6_NUM_NEIGHBORS || defined __DOXYGEN__
 #define LWIP_ND6_NUM_NEIGHBORS          10
@@ -2613,11 +3016,22 @@
 
 /**
  * LWIP_ND6_NUM_DESTINATIONS: number of entries in IPv6 destination cache
+ * (the limit for nd6_set_cache_sizes())
  */
 #if !defined LWIP_ND6_NUM_DESTINATIONS || defined __DOXYGEN__
 #define LWIP_ND6_NUM_DESTINATIONS       10
 #endif
 
+/**
+ * LWIP_ND6_CACHE_HASH_SIZE: Number of hash buckets indexing the IPv6
+ * neighbor and destination caches (a power of 2), or 0 to search them
+ * linearly. With the hash index, a full cache recycles its least recently
+ * used entry. Enable this for a large LWIP_ND6_NUM_DESTINATIONS.
+ */
+#if !defined LWIP_ND6_CACHE_HASH_SIZE || defined __DOXYGEN__
+#define LWIP_ND6_CACHE_HASH_SIZE        0
+#endif
+
 /**
  * LWIP_ND6_NUM_PREFIXES: number of entries in IPv6 on-link prefixes cache
  */
@@ -50,9 +50,10 @@ extern "C" {
  * pbuf_alloced_custom()) and when pbuf_free gives up their last reference, they
  * are freed by calling pbuf_custom->custom_free_function().
  * Currently, the pbuf_custom code is only needed for one specific configuration
- * of IP_FRAG, unless required by external driver/application code. */
+ * of IP_FRAG and for LWIP_PBUF_SHARED, unless required by external
+ * driver/application code. */
 #ifndef LWIP_SUPPORT_CUSTOM_PBUF
-#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG))
+#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG) || LWIP_PBUF_SHARED)
 #endif
 
 /** @ingroup pbuf
@@ -72,6 +73,16 @@ extern "C" {
 #define PBUF_NEEDS_COPY(p)  ((p)->type_internal & PBUF_TYPE_FLAG_DATA_VOLATILE)
 #endif /* PBUF_NEEDS_COPY */
 
+/** Type of pbuf lengths (tot_len, len) and offsets into pbuf chains,
+ * see @ref LWIP_PBUF_LEN32 */
+#if LWIP_PBUF_LEN32
+typedef u32_t pbuf_len_t;
+#define PBUFLEN_F           U32_F
+#else /* LWIP_PBUF_LEN32 */
+typedef u16_t pbuf_len_t;
+#define PBUFLEN_F           U16_F
+#endif /* LWIP_PBUF_LEN32 */
+
 /* @todo: We need a mechanism to prevent wasting memory in every pbuf
    (TCP vs. UDP, IPv4 vs. IPv6: UDP/IPv4 packets may waste up to 28 bytes) */
 
@@ -181,6 +192,9 @@ typedef enum {
 #define PBUF_FLAG_LLMCAST   0x10U
 /** indicates this pbuf includes a TCP FIN flag */
 #define PBUF_FLAG_TCP_FIN   0x20U
+/** indicates the transport checksum of this received packet was already
+    verified (e.g. by a driver with checksum offload): tcp/udp input skip it */
+#define PBUF_FLAG_CSUM_VALID 0x40U
 
 /** Main packet buffer struct */
 struct pbuf {
@@ -197,10 +211,10 @@ struct pbuf {
    * For non-queue packet chains this is the invariant:
    * p->tot_len == p->len + (p->next? p->next->tot_len: 0)
    */
-  u16_t tot_len;
+  pbuf_len_t tot_len;
 
   /** length of this buffer */
-  u16_t len;
+  pbuf_len_t len;
 
   /** a bit field indicating pbuf type and allocation sources
       (see PBUF_TYPE_FLAG_*, PBUF_ALLOC_FLAG_* and PBUF_TYPE_ALLOC_SRC_MASK)
@@ -250,6 +264,15 @@ struct pbuf_custom {
 };
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
 
+#if LWIP_PBUF_SHARED
+/** A read-only reference onto the payload of another pbuf (see pbuf_share()) */
+struct pbuf_shared_ref {
+  struct pbuf_custom pc;
+  /** the referenced pbuf (one reference held) */
+  struct pbuf *original;
+};
+#endif /* LWIP_PBUF_SHARED */
+
 /** Define this to 0 to prevent freeing ooseq pbufs when the PBUF_POOL is empty */
 #ifndef PBUF_POOL_FREE_OOSEQ
 #define PBUF_POOL_FREE_OOSEQ 1
@@ -272,14 +295,14 @@ void pbuf_free_ooseq(void);
 /* Initializes the pbuf module. This call is empty for now, but may not be in future. */
 #define pbuf_init()
 
-struct pbuf *pbuf_alloc(pbuf_layer l, u16_t length, pbuf_type type);
-struct pbuf *pbuf_alloc_reference(void *payload, u16_t length, pbuf_type type);
+struct pbuf *pbuf_alloc(pbuf_layer l, pbuf_len_t length, pbuf_type type);
+struct pbuf *pbuf_alloc_reference(void *payload, pbuf_len_t length, pbuf_type type);
 #if LWIP_SUPPORT_CUSTOM_PBUF
-struct pbuf *pbuf_alloced_custom(pbuf_layer l, u16_t length, pbuf_type type,
+struct pbuf *pbuf_alloced_custom(pbuf_layer l, pbuf_len_t length, pbuf_type type,
                                  struct pbuf_custom *p, void *payload_mem,
-                                 u16_t payload_mem_len);
+                                 pbuf_len_t payload_mem_len);
 #endif /* LWIP_SUPPORT_CUSTOM_PBUF */
-void pbuf_realloc(struct pbuf *p, u16_t size);
+void pbuf_realloc(struct pbuf *p, pbuf_len_t size);
 #define pbuf_get_allocsrc(p)          ((p)->type_internal & PBUF_TYPE_ALLOC_SRC_MASK)
 #define pbuf_match_allocsrc(p, type)  (pbuf_get_allocsrc(p) == ((type) & PBUF_TYPE_ALLOC_SRC_MASK))
 #define pbuf_match_type(p, type)      pbuf_match_allocsrc(p, type)
@@ -288,7 +311,7 @@ u8_t pbuf_header_force(struct pbuf *p, s16_t header_size);
 u8_t pbuf_add_header(struct pbuf *p, size_t header_size_increment);
 u8_t pbuf_add_header_force(struct pbuf *p, size_t header_size_increment);
 u8_t pbuf_remove_header(struct pbuf *p, size_t header_size);
-struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+struct pbuf *pbuf_free_header(struct pbuf *q, pbuf_len_t size);
 void pbuf_ref(struct pbuf *p);
 u8_t pbuf_free(struct pbuf *p);
 u16_t pbuf_clen(const struct pbuf *p);
@@ -296,14 +319,18 @@ void pbuf_cat(struct pbuf *head, struct pbuf *tail);
 void pbuf_chain(struct pbuf *head, struct pbuf *tail);
 struct pbuf *pbuf_dechain(struct pbuf *p);
 err_t pbuf_copy(struct pbuf *p_to, const struct pbuf *p_from);
-err_t pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, u16_t copy_len, u16_t offset);
-u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset);
-void *pbuf_get_contiguous(const struct pbuf *p, void *buffer, size_t bufsize, u16_t len, u16_t offset);
-err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len);
-err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, u16_t len, u16_t offset);
-struct pbuf *pbuf_skip(struct pbuf* in, u16_t in_offset, u16_t* out_offset);
+err_t pbuf_copy_partial_pbuf(struct pbuf *p_to, const struct pbuf *p_from, pbuf_len_t copy_len, pbuf_len_t offset);
+pbuf_len_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, pbuf_len_t len, pbuf_len_t offset);
+void *pbuf_get_contiguous(const struct pbuf *p, void *buffer, size_t bufsize, pbuf_len_t len, pbuf_len_t offset);
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, pbuf_len_t len);
+err_t pbuf_take_at(struct pbuf *buf, const void *dataptr, pbuf_len_t len, pbuf_len_t offset);
+struct pbuf *pbuf_skip(struct pbuf* in, pbuf_len_t in_offset, pbuf_len_t* out_offset);
 struct pbuf *pbuf_coalesce(struct pbuf *p, pbuf_layer layer);
 struct pbuf *pbuf_clone(pbuf_layer l, pbuf_type type, struct pbuf *p);
+#if LWIP_PBUF_SHARED
+struct pbuf *pbuf_share(struct pbuf *p);
+#endif /* LWIP_PBUF_SHARED */
+struct pbuf *pbuf_unshare(struct pbuf *p);
 #if LWIP_CHECKSUM_ON_COPY
 err_t pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
                        u16_t len, u16_t *chksum);
@@ -312,9 +339,9 @@ err_t pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
 void pbuf_split_64k(struct pbuf *p, struct pbuf **rest);
 #endif /* LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
 
-u8_t pbuf_get_at(const struct pbuf* p, u16_t offset);
-int pbuf_try_get_at(const struct pbuf* p, u16_t offset);
-void pbuf_put_at(struct pbuf* p, u16_t offset, u8_t data);
+u8_t pbuf_get_at(const struct pbuf* p, pbuf_len_t offset);
+int pbuf_try_get_at(const struct pbuf* p, pbuf_len_t offset);
+void pbuf_put_at(struct pbuf* p, pbuf_len_t offset, u8_t data);
 u16_t pbuf_memcmp(const struct pbuf* p, u16_t offset, const void* s2, u16_t n);
 u16_t pbuf_memfind(const struct pbuf* p, const void* mem, u16_t mem_len, u16_t start_offset);
 u16_t pbuf_strstr(const struct pbuf* p, const char* substr);
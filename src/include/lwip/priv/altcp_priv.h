@@ -57,7 +57,7 @@ void altcp_free(struct altcp_pcb *conn);
 
 /* Function prototypes for application layers */
 typedef void (*altcp_set_poll_fn)(struct altcp_pcb *conn, u8_t interval);
-typedef void (*altcp_recved_fn)(struct altcp_pcb *conn, u16_t len);
+typedef void (*altcp_recved_fn)(struct altcp_pcb *conn, pbuf_len_t len);
 typedef err_t (*altcp_bind_fn)(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t port);
 typedef err_t (*altcp_connect_fn)(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t port, altcp_connected_fn connected);
 
@@ -126,7 +126,7 @@ struct altcp_functions {
 };
 
 void  altcp_default_set_poll(struct altcp_pcb *conn, u8_t interval);
-void  altcp_default_recved(struct altcp_pcb *conn, u16_t len);
+void  altcp_default_recved(struct altcp_pcb *conn, pbuf_len_t len);
 err_t altcp_default_bind(struct altcp_pcb *conn, const ip_addr_t *ipaddr, u16_t port);
 err_t altcp_default_shutdown(struct altcp_pcb *conn, int shut_rx, int shut_tx);
 err_t altcp_default_write(struct altcp_pcb *conn, const void *dataptr, u16_t len, u8_t apiflags);
@@ -86,6 +86,17 @@ struct api_msg {
   union {
     /** used for lwip_netconn_do_send */
     struct netbuf *b;
+#if LWIP_SOCKET_MMSG
+    /** used for lwip_netconn_do_send_multi */
+    struct {
+      /** array of netbufs to send */
+      struct netbuf *const *bufs;
+      /** number of netbufs in bufs */
+      u16_t num;
+      /** output: number of netbufs sent before an error occurred */
+      u16_t sent;
+    } bm;
+#endif /* LWIP_SOCKET_MMSG */
     /** used for lwip_netconn_do_newconn */
     struct {
       u8_t proto;
@@ -115,6 +126,11 @@ struct api_msg {
       /** offset into total length/output of bytes written when err == ERR_OK */
       size_t offset;
       u8_t apiflags;
+#if LWIP_SOCKET_ZEROCOPY
+      /** allocates the pbufs referencing the data (NULL: plain PBUF_ROM) */
+      tcp_ref_pbuf_fn ref_fn;
+      void *ref_arg;
+#endif /* LWIP_SOCKET_ZEROCOPY */
 #if LWIP_SO_SNDTIMEO
       u32_t time_started;
 #endif /* LWIP_SO_SNDTIMEO */
@@ -199,6 +215,9 @@ void lwip_netconn_do_connect         (void *m);
 void lwip_netconn_do_disconnect      (void *m);
 void lwip_netconn_do_listen          (void *m);
 void lwip_netconn_do_send            (void *m);
+#if LWIP_SOCKET_MMSG
+void lwip_netconn_do_send_multi      (void *m);
+#endif /* LWIP_SOCKET_MMSG */
 void lwip_netconn_do_recv            (void *m);
 #if TCP_LISTEN_BACKLOG
 void lwip_netconn_do_accepted        (void *m);
@@ -54,6 +54,12 @@ extern "C" {
 #define MEMP_SIZE          (LWIP_MEM_ALIGN_SIZE(sizeof(struct memp)) + MEM_SANITY_REGION_BEFORE_ALIGNED)
 #define MEMP_ALIGN_SIZE(x) (LWIP_MEM_ALIGN_SIZE(x) + MEM_SANITY_REGION_AFTER_ALIGNED)
 
+#elif MEMP_TELEMETRY /* MEMP_OVERFLOW_CHECK */
+
+/* MEMP_SIZE: save space for struct memp (allocation time) */
+#define MEMP_SIZE          (LWIP_MEM_ALIGN_SIZE(sizeof(struct memp)))
+#define MEMP_ALIGN_SIZE(x) (LWIP_MEM_ALIGN_SIZE(x))
+
 #else /* MEMP_OVERFLOW_CHECK */
 
 /* No sanity checks
@@ -65,15 +71,23 @@ extern "C" {
 
 #endif /* MEMP_OVERFLOW_CHECK */
 
-#if !MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK
+#if !MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK || MEMP_TELEMETRY
 struct memp {
   struct memp *next;
 #if MEMP_OVERFLOW_CHECK
   const char *file;
   int line;
 #endif /* MEMP_OVERFLOW_CHECK */
+#if MEMP_TELEMETRY
+  /** MEMP_TELEMETRY_NOW() when allocated */
+  u32_t alloc_time;
+#if MEMP_OVERFLOW_CHECK
+  /** index into the call site table or 0xFFFF */
+  u16_t site;
+#endif /* MEMP_OVERFLOW_CHECK */
+#endif /* MEMP_TELEMETRY */
 };
-#endif /* !MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK */
+#endif /* !MEMP_MEM_MALLOC || MEMP_OVERFLOW_CHECK || MEMP_TELEMETRY */
 
 #if MEM_USE_POOLS && MEMP_USE_CUSTOM_POOLS
 /* Use a helper type to get the start and end of the user "memory pools" for mem_malloc */
@@ -104,6 +118,82 @@ typedef enum {
 #define MEMP_POOL_LAST   ((memp_t) MEMP_POOL_HELPER_LAST)
 #endif /* MEM_USE_POOLS && MEMP_USE_CUSTOM_POOLS */
 
+#if MEMP_ELASTIC
+/** A block of pool elements allocated from the heap when a pool grows.
+ * Each element is preceded by a pointer back to its slab. */
+struct memp_slab {
+  /** next slab of the same pool */
+  struct memp_slab *next;
+  /** neighbours in the list of slabs that have free elements */
+  struct memp_slab *avail_next;
+  struct memp_slab *avail_prev;
+  /** free elements of this slab */
+  struct memp *free;
+  /** number of elements in this slab and how many are in use */
+  u16_t num;
+  u16_t used;
+  /** number of decay timer runs this slab has been completely unused */
+  u16_t idle;
+};
+
+/** Runtime state of an elastic pool */
+struct memp_elastic {
+  /** all heap slabs */
+  struct memp_slab *slabs;
+  /** slabs that have free elements, allocated from the head (refilled
+      slabs are appended so that partially used ones can run empty) */
+  struct memp_slab *avail;
+  struct memp_slab *avail_tail;
+  /** maximum number of elements (static + slabs) */
+  u16_t ceiling;
+  /** number of elements in slabs */
+  u16_t slab_elements;
+};
+#endif /* MEMP_ELASTIC */
+
+#if MEMP_TELEMETRY
+/** A series of allocation failures (see MEMP_TELEMETRY_BURST_GAP) */
+struct memp_telemetry_burst {
+  /** time of the first and the last failure */
+  u32_t start;
+  u32_t end;
+  /** number of failures */
+  u32_t count;
+};
+
+/** Allocation telemetry of one pool (see memp_telemetry_get()) */
+struct memp_telemetry {
+  u32_t allocs;
+  u32_t frees;
+  u32_t fails;
+  /** allocations in the last complete MEMP_TELEMETRY_RATE_WINDOW */
+  u32_t rate;
+  /** start of and allocations in the current window */
+  u32_t window_start;
+  u32_t window_allocs;
+  /** the last failure bursts, bursts[last_burst] is the newest one */
+  struct memp_telemetry_burst bursts[MEMP_TELEMETRY_BURSTS];
+  u16_t last_burst;
+  /** element lifetimes (allocation to free): bucket 0 for 0, bucket n for
+      [2^(n-1), 2^n), the last one for everything longer */
+  u32_t lifetime[MEMP_TELEMETRY_HIST_BUCKETS];
+};
+
+#if MEMP_OVERFLOW_CHECK
+/** Allocations from one call site (see memp_telemetry_get_sites()) */
+struct memp_telemetry_site {
+  const struct memp_desc *desc;
+  const char *file;
+  int line;
+  u32_t allocs;
+  u32_t fails;
+  /** elements currently allocated and their maximum */
+  u32_t used;
+  u32_t max;
+};
+#endif /* MEMP_OVERFLOW_CHECK */
+#endif /* MEMP_TELEMETRY */
+
 /** Memory pool descriptor */
 struct memp_desc {
 #if defined(LWIP_DEBUG) || MEMP_OVERFLOW_CHECK || LWIP_STATS_DISPLAY
@@ -127,7 +217,17 @@ struct memp_desc {
 
   /** First free element of each pool. Elements form a linked list. */
   struct memp **tab;
+
+#if MEMP_ELASTIC
+  /** Heap slabs and ceiling */
+  struct memp_elastic *elastic;
+#endif /* MEMP_ELASTIC */
 #endif /* MEMP_MEM_MALLOC */
+
+#if MEMP_TELEMETRY
+  /** Allocation telemetry */
+  struct memp_telemetry *telemetry;
+#endif /* MEMP_TELEMETRY */
 };
 
 #if defined(LWIP_DEBUG) || MEMP_OVERFLOW_CHECK || LWIP_STATS_DISPLAY
@@ -136,6 +236,22 @@ struct memp_desc {
 #define DECLARE_LWIP_MEMPOOL_DESC(desc)
 #endif
 
+#if MEMP_ELASTIC
+#define LWIP_MEMPOOL_DECLARE_ELASTIC_INSTANCE(name, num) static struct memp_elastic name = { NULL, NULL, NULL, (u16_t)((MEMP_ELASTIC_CEILING(num)) < 0xFFFF ? (MEMP_ELASTIC_CEILING(num)) : 0xFFFF), 0 };
+#define LWIP_MEMPOOL_DECLARE_ELASTIC_REFERENCE(name) , &name
+#else
+#define LWIP_MEMPOOL_DECLARE_ELASTIC_INSTANCE(name, num)
+#define LWIP_MEMPOOL_DECLARE_ELASTIC_REFERENCE(name)
+#endif
+
+#if MEMP_TELEMETRY
+#define LWIP_MEMPOOL_DECLARE_TELEMETRY_INSTANCE(name) static struct memp_telemetry name;
+#define LWIP_MEMPOOL_DECLARE_TELEMETRY_REFERENCE(name) , &name
+#else
+#define LWIP_MEMPOOL_DECLARE_TELEMETRY_INSTANCE(name)
+#define LWIP_MEMPOOL_DECLARE_TELEMETRY_REFERENCE(name)
+#endif
+
 #if MEMP_STATS
 #define LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(name) static struct stats_mem name;
 #define LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(name) &name,
@@ -153,6 +269,14 @@ void *memp_malloc_pool_fn(const struct memp_desc* desc, const char* file, const
 void *memp_malloc_pool(const struct memp_desc *desc);
 #endif
 void  memp_free_pool(const struct memp_desc* desc, void *mem);
+#if MEMP_ELASTIC
+void  memp_set_ceiling_pool(const struct memp_desc *desc, u16_t ceiling);
+void  memp_decay_pool(const struct memp_desc *desc);
+#endif /* MEMP_ELASTIC */
+#if MEMP_TELEMETRY
+void  memp_telemetry_get_pool(const struct memp_desc *desc, struct memp_telemetry *telemetry);
+void  memp_telemetry_reset_pool(const struct memp_desc *desc);
+#endif /* MEMP_TELEMETRY */
 
 #ifdef __cplusplus
 }
@@ -59,14 +59,24 @@ LWIP_MEMPOOL(ALTCP_PCB,      MEMP_NUM_ALTCP_PCB,       sizeof(struct altcp_pcb),
 #if LWIP_IPV4 && IP_REASSEMBLY
 LWIP_MEMPOOL(REASSDATA,      MEMP_NUM_REASSDATA,       sizeof(struct ip_reassdata),   "REASSDATA")
 #endif /* LWIP_IPV4 && IP_REASSEMBLY */
+#if LWIP_IPV4_FIB
+LWIP_MEMPOOL(IP4_FIB_NODE,   MEMP_NUM_IP4_FIB_NODE,    sizeof(struct ip4_fib_node),   "IP4_FIB_NODE")
+#endif /* LWIP_IPV4_FIB */
 #if (IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG)
 LWIP_MEMPOOL(FRAG_PBUF,      MEMP_NUM_FRAG_PBUF,       sizeof(struct pbuf_custom_ref),"FRAG_PBUF")
 #endif /* IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF || (LWIP_IPV6 && LWIP_IPV6_FRAG) */
+#if LWIP_PBUF_SHARED
+LWIP_MEMPOOL(PBUF_SHARED,    MEMP_NUM_PBUF_SHARED,     sizeof(struct pbuf_shared_ref),"PBUF_SHARED")
+#endif /* LWIP_PBUF_SHARED */
 
 #if LWIP_NETCONN || LWIP_SOCKET
 LWIP_MEMPOOL(NETBUF,         MEMP_NUM_NETBUF,          sizeof(struct netbuf),         "NETBUF")
 LWIP_MEMPOOL(NETCONN,        MEMP_NUM_NETCONN,         sizeof(struct netconn),        "NETCONN")
 #endif /* LWIP_NETCONN || LWIP_SOCKET */
+#if LWIP_SOCKET && LWIP_SOCKET_ZEROCOPY
+LWIP_MEMPOOL(SOCKET_ZC_SEND, MEMP_NUM_SOCKET_ZC_SEND,  sizeof(struct lwip_zc_send),   "SOCKET_ZC_SEND")
+LWIP_MEMPOOL(SOCKET_ZC_PBUF, MEMP_NUM_SOCKET_ZC_PBUF,  sizeof(struct lwip_zc_pbuf),   "SOCKET_ZC_PBUF")
+#endif /* LWIP_SOCKET && LWIP_SOCKET_ZEROCOPY */
 
 #if NO_SYS==0
 LWIP_MEMPOOL(TCPIP_MSG_API,  MEMP_NUM_TCPIP_MSG_API,   sizeof(struct tcpip_msg),      "TCPIP_MSG_API")
@@ -117,6 +127,11 @@ LWIP_MEMPOOL(ND6_QUEUE,      MEMP_NUM_ND6_QUEUE,       sizeof(struct nd6_q_entry
 LWIP_MEMPOOL(IP6_REASSDATA,  MEMP_NUM_REASSDATA,       sizeof(struct ip6_reassdata),  "IP6_REASSDATA")
 #endif /* LWIP_IPV6 && LWIP_IPV6_REASS */
 
+#if LWIP_IPV6 && LWIP_IPV6_FIB
+LWIP_MEMPOOL(IP6_FIB_ROUTE,  MEMP_NUM_IP6_FIB_ROUTE,   sizeof(struct ip6_fib_route),  "IP6_FIB_ROUTE")
+LWIP_MEMPOOL(IP6_FIB_NODE,   MEMP_NUM_IP6_FIB_NODE,    sizeof(struct ip6_fib_node),   "IP6_FIB_NODE")
+#endif /* LWIP_IPV6 && LWIP_IPV6_FIB */
+
 #if LWIP_IPV6 && LWIP_IPV6_MLD
 LWIP_MEMPOOL(MLD6_GROUP,     MEMP_NUM_MLD6_GROUP,      sizeof(struct mld_group),      "MLD6_GROUP")
 #endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
@@ -44,12 +44,13 @@
 #include "lwip/err.h"
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
+#include "lwip/pbuf.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#define NUM_SOCKETS MEMP_NUM_NETCONN
+#define NUM_SOCKETS LWIP_NUM_SOCKETS
 
 /** This is overridable for the rare case where more than 255 threads
  * select on the same socket...
@@ -63,12 +64,39 @@ union lwip_sock_lastdata {
   struct pbuf *pbuf;
 };
 
+#if LWIP_SOCKET_EPOLL
+struct lwip_sock;
+
+/** Registration of one socket in one epoll instance */
+struct lwip_epoll_item {
+  /** next entry in the ready list of the epoll instance */
+  struct lwip_epoll_item *next;
+  /** previous entry in the ready list of the epoll instance */
+  struct lwip_epoll_item *prev;
+  /** the socket this item belongs to */
+  struct lwip_sock *sock;
+  /** events passed to epoll_ctl (including EPOLLET/EPOLLONESHOT) */
+  u32_t events;
+  /** user data passed to epoll_ctl, returned by epoll_wait */
+  epoll_data_t data;
+  /** LWIP_EPOLL_ITEM_* flags */
+  u8_t flags;
+#define LWIP_EPOLL_ITEM_REGISTERED 0x01
+#define LWIP_EPOLL_ITEM_READY      0x02
+#define LWIP_EPOLL_ITEM_DISARMED   0x04
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** Contains all internal pointers and states used for a socket */
 struct lwip_sock {
   /** sockets currently are built on netconns, each socket has one netconn */
   struct netconn *conn;
   /** data that was left from the previous read */
   union lwip_sock_lastdata lastdata;
+  /** index of this socket in the socket table (fd - LWIP_SOCKET_OFFSET) */
+  int idx;
+  /** next entry of the free-index stack while this socket is unused (-1: none) */
+  int free_next;
 #if LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL
   /** number of times data was received, set by event_callback(),
       tested by the receive and select functions */
@@ -81,6 +109,26 @@ struct lwip_sock {
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+  /** number of epoll instances this socket is registered with */
+  u8_t epoll_refs;
+  /** registrations of this socket, indexed by epoll instance */
+  struct lwip_epoll_item epoll_items[LWIP_SOCKET_EPOLL_MAX];
+#endif /* LWIP_SOCKET_EPOLL */
+#if LWIP_SOCKET_ZEROCOPY
+  /** MSG_ZEROCOPY sends not reported yet, oldest first */
+  struct lwip_zc_send *zc_head;
+  struct lwip_zc_send *zc_tail;
+  /** id assigned to the next MSG_ZEROCOPY send */
+  u32_t zc_next_id;
+  /** completed ids not yet read via MSG_ERRQUEUE: zc_lo..zc_hi */
+  u32_t zc_lo;
+  u32_t zc_hi;
+  /** LWIP_SOCK_ZC_* flags */
+  u8_t zc_flags;
+#define LWIP_SOCK_ZC_DONE   0x01 /* zc_lo..zc_hi is valid */
+#define LWIP_SOCK_ZC_COPIED 0x02 /* data of a send in zc_lo..zc_hi was copied */
+#endif /* LWIP_SOCKET_ZEROCOPY */
 #if LWIP_NETCONN_FULLDUPLEX
   /* counter of how many threads are using a struct lwip_sock (not the 'int') */
   u8_t fd_used;
@@ -127,6 +175,31 @@ struct lwip_setgetsockopt_data {
 };
 #endif /* !LWIP_TCPIP_CORE_LOCKING */
 
+#if LWIP_SOCKET_ZEROCOPY
+/** One MSG_ZEROCOPY send call: completes when all pbufs referencing its data
+ * are freed (plus one reference held by the sending thread while queueing) */
+struct lwip_zc_send {
+  /** next send of the same socket (in id order) */
+  struct lwip_zc_send *next;
+  /** socket to report the completion to, NULL once the socket is closed */
+  struct lwip_sock *sock;
+  /** per-socket id reported through MSG_ERRQUEUE */
+  u32_t id;
+  /** number of pbufs (plus the sender) still referencing the data */
+  u16_t refs;
+  /** set when refs has dropped to 0 */
+  u8_t done;
+  /** set once a pbuf referencing the data has been allocated (not copied) */
+  u8_t referenced;
+};
+
+/** pbuf_custom referencing (part of) the data of a MSG_ZEROCOPY send */
+struct lwip_zc_pbuf {
+  struct pbuf_custom pc;
+  struct lwip_zc_send *send;
+};
+#endif /* LWIP_SOCKET_ZEROCOPY */
+
 #ifdef __cplusplus
 }
 #endif
@@ -319,6 +319,15 @@ struct tcp_seg {
 #define TCPWND_MIN16(x)    x
 #endif /* LWIP_WND_SCALE */
 
+/** End of the per-segment part of struct tcp_pcb (offset of the first member
+ * after it), bounded by TCP_PCB_HOT_CACHE_LINES and reported by tcp_init()
+ * with TCP_DEBUG */
+#define TCP_PCB_HOT_END offsetof(struct tcp_pcb, snd_lbb)
+
+/** With a scaled window, ooseq data passed to the application may exceed the
+ * 64K a pbuf chain can hold (unless LWIP_PBUF_LEN32 is set), so it is split */
+#define TCP_RECV_SPLIT_64K (TCP_QUEUE_OOSEQ && LWIP_WND_SCALE && !LWIP_PBUF_LEN32)
+
 /* Global variables: */
 extern struct tcp_pcb *tcp_input_pcb;
 extern u32_t tcp_ticks;
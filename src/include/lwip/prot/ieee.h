@@ -72,6 +72,8 @@ enum lwip_ieee_eth_type {
   ETHTYPE_PROFINET  = 0x8892U,
   /** Ethernet for control automation technology */
   ETHTYPE_ETHERCAT  = 0x88A4U,
+  /** Service VLAN tag (outer tag of Q-in-Q), 802.1ad */
+  ETHTYPE_SVLAN     = 0x88A8U,
   /** Link layer discovery protocol */
   ETHTYPE_LLDP      = 0x88CCU,
   /** Serial real-time communication system */
@@ -143,6 +143,14 @@ struct msghdr {
   int           msg_flags;
 };
 
+#if LWIP_SOCKET_MMSG
+/** Message header used by lwip_recvmmsg() and lwip_sendmmsg() */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len;  /* number of bytes transmitted/received */
+};
+#endif /* LWIP_SOCKET_MMSG */
+
 /* struct msghdr->msg_flags bit field values */
 #define MSG_TRUNC   0x04
 #define MSG_CTRUNC  0x08
@@ -216,7 +224,7 @@ struct ifreq {
 #define SO_LINGER       0x0080 /* linger on close if data present */
 #define SO_DONTLINGER   ((int)(~SO_LINGER))
 #define SO_OOBINLINE    0x0100 /* Unimplemented: leave received OOB data in line */
-#define SO_REUSEPORT    0x0200 /* Unimplemented: allow local address & port reuse */
+#define SO_REUSEPORT    0x0200 /* allow local address & port reuse (needs SO_REUSE_PORT) */
 #define SO_SNDBUF       0x1001 /* Unimplemented: send buffer size */
 #define SO_RCVBUF       0x1002 /* receive buffer size */
 #define SO_SNDLOWAT     0x1003 /* Unimplemented: send low-water mark */
@@ -272,6 +280,9 @@ struct linger {
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
 #define MSG_NOSIGNAL   0x20    /* Uninmplemented: Requests not to send the SIGPIPE signal if an attempt to send is made on a stream-oriented socket that is no longer connected. */
+#define MSG_WAITFORONE 0x40    /* recvmmsg: Turns on MSG_DONTWAIT after the first message has been received */
+#define MSG_ERRQUEUE   0x80    /* recvmsg: Fetch MSG_ZEROCOPY completion notifications (never blocks) */
+#define MSG_ZEROCOPY   0x100   /* TCP send: Reference the data instead of copying it, see struct sock_extended_err */
 
 
 /*
@@ -280,6 +291,7 @@ struct linger {
 #define IP_TOS             1
 #define IP_TTL             2
 #define IP_PKTINFO         8
+#define IP_RECVERR         11
 
 #if LWIP_TCP
 /*
@@ -297,6 +309,7 @@ struct linger {
  * Options for level IPPROTO_IPV6
  */
 #define IPV6_CHECKSUM       7  /* RFC3542: calculate and insert the ICMPv6 checksum for raw sockets. */
+#define IPV6_RECVERR        25 /* cmsg type of MSG_ERRQUEUE notifications on AF_INET6 sockets */
 #define IPV6_V6ONLY         27 /* RFC3493: boolean control to restrict AF_INET6 sockets to IPv6 communications only. */
 #endif /* LWIP_IPV6 */
 
@@ -338,6 +351,24 @@ struct in_pktinfo {
 };
 #endif /* LWIP_IPV4 */
 
+#if LWIP_SOCKET_ZEROCOPY
+/** Ancillary data returned by recvmsg(MSG_ERRQUEUE) (cmsg level/type
+ * IPPROTO_IP/IP_RECVERR or IPPROTO_IPV6/IPV6_RECVERR): MSG_ZEROCOPY sends with
+ * ids ee_info..ee_data (counted per socket, starting at 0) have completed and
+ * their buffers may be reused. */
+struct sock_extended_err {
+  u32_t ee_errno;  /* always 0 for completions */
+  u8_t  ee_origin; /* SO_EE_ORIGIN_ZEROCOPY */
+  u8_t  ee_type;
+  u8_t  ee_code;   /* SO_EE_CODE_ZEROCOPY_COPIED if data has been copied */
+  u8_t  ee_pad;
+  u32_t ee_info;   /* first completed id */
+  u32_t ee_data;   /* last completed id */
+};
+#define SO_EE_ORIGIN_ZEROCOPY      5
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif /* LWIP_SOCKET_ZEROCOPY */
+
 #if LWIP_IPV6_MLD
 /*
  * Options and types related to IPv6 multicast membership
@@ -475,12 +506,12 @@ typedef struct ipv6_mreq {
 #ifndef FD_SET
 #undef  FD_SETSIZE
 /* Make FD_SETSIZE match NUM_SOCKETS in socket.c */
-#define FD_SETSIZE    MEMP_NUM_NETCONN
+#define FD_SETSIZE    LWIP_NUM_SOCKETS
 #define LWIP_SELECT_MAXNFDS (FD_SETSIZE + LWIP_SOCKET_OFFSET)
 #define FDSETSAFESET(n, code) do { \
-  if (((n) - LWIP_SOCKET_OFFSET < MEMP_NUM_NETCONN) && (((int)(n) - LWIP_SOCKET_OFFSET) >= 0)) { \
+  if (((n) - LWIP_SOCKET_OFFSET < LWIP_NUM_SOCKETS) && (((int)(n) - LWIP_SOCKET_OFFSET) >= 0)) { \
   code; }} while(0)
-#define FDSETSAFEGET(n, code) (((n) - LWIP_SOCKET_OFFSET < MEMP_NUM_NETCONN) && (((int)(n) - LWIP_SOCKET_OFFSET) >= 0) ?\
+#define FDSETSAFEGET(n, code) (((n) - LWIP_SOCKET_OFFSET < LWIP_NUM_SOCKETS) && (((int)(n) - LWIP_SOCKET_OFFSET) >= 0) ?\
   (code) : 0)
 #define FD_SET(n, p)  FDSETSAFESET(n, (p)->fd_bits[((n)-LWIP_SOCKET_OFFSET)/8] = (u8_t)((p)->fd_bits[((n)-LWIP_SOCKET_OFFSET)/8] |  (1 << (((n)-LWIP_SOCKET_OFFSET) & 7))))
 #define FD_CLR(n, p)  FDSETSAFESET(n, (p)->fd_bits[((n)-LWIP_SOCKET_OFFSET)/8] = (u8_t)((p)->fd_bits[((n)-LWIP_SOCKET_OFFSET)/8] & ~(1 << (((n)-LWIP_SOCKET_OFFSET) & 7))))
@@ -492,7 +523,7 @@ typedef struct fd_set
   unsigned char fd_bits [(FD_SETSIZE+7)/8];
 } fd_set;
 
-#elif FD_SETSIZE < (LWIP_SOCKET_OFFSET + MEMP_NUM_NETCONN)
+#elif FD_SETSIZE < (LWIP_SOCKET_OFFSET + LWIP_NUM_SOCKETS)
 #error "external FD_SETSIZE too small for number of sockets"
 #else
 #define LWIP_SELECT_MAXNFDS FD_SETSIZE
@@ -521,6 +552,38 @@ struct pollfd
 };
 #endif
 
+/* epoll-related defines and types (values match Linux) */
+#if LWIP_SOCKET_EPOLL && !defined(EPOLLIN) && !defined(EPOLLOUT)
+#define EPOLLIN      0x001U
+#define EPOLLOUT     0x004U
+#define EPOLLERR     0x008U
+/* Below values are unimplemented (accepted but never reported) */
+#define EPOLLPRI     0x002U
+#define EPOLLHUP     0x010U
+#define EPOLLRDHUP   0x2000U
+/* Registration flags */
+#define EPOLLONESHOT (1U << 30)
+#define EPOLLET      (1U << 31)
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+typedef union epoll_data {
+  void *ptr;
+  int fd;
+  u32_t u32;
+#if LWIP_HAVE_INT64
+  u64_t u64;
+#endif
+} epoll_data_t;
+
+struct epoll_event {
+  u32_t events;
+  epoll_data_t data;
+};
+#endif /* LWIP_SOCKET_EPOLL && !defined(EPOLLIN) && !defined(EPOLLOUT) */
+
 /** LWIP_TIMEVAL_PRIVATE: if you want to use the struct timeval provided
  * by your system, set this to 0 and include <sys/time.h> in cc.h */
 #ifndef LWIP_TIMEVAL_PRIVATE
@@ -573,6 +636,15 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #if LWIP_SOCKET_POLL
 #define lwip_poll         poll
 #endif
+#if LWIP_SOCKET_MMSG
+#define lwip_recvmmsg     recvmmsg
+#define lwip_sendmmsg     sendmmsg
+#endif
+#if LWIP_SOCKET_EPOLL
+#define lwip_epoll_create epoll_create
+#define lwip_epoll_ctl    epoll_ctl
+#define lwip_epoll_wait   epoll_wait
+#endif
 #define lwip_ioctl        ioctlsocket
 #define lwip_inet_ntop    inet_ntop
 #define lwip_inet_pton    inet_pton
@@ -622,6 +694,15 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
 #if LWIP_SOCKET_POLL
 int lwip_poll(struct pollfd *fds, nfds_t nfds, int timeout);
 #endif
+#if LWIP_SOCKET_MMSG
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+#endif
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
 const char *lwip_inet_ntop(int af, const void *src, char *dst, socklen_t size);
@@ -671,6 +752,20 @@ int lwip_inet_pton(int af, const char *src, void *dst);
 /** @ingroup socket */
 #define poll(fds,nfds,timeout)                    lwip_poll(fds,nfds,timeout)
 #endif
+#if LWIP_SOCKET_MMSG
+/** @ingroup socket */
+#define recvmmsg(s,msgvec,vlen,flags)             lwip_recvmmsg(s,msgvec,vlen,flags)
+/** @ingroup socket */
+#define sendmmsg(s,msgvec,vlen,flags)             lwip_sendmmsg(s,msgvec,vlen,flags)
+#endif
+#if LWIP_SOCKET_EPOLL
+/** @ingroup socket */
+#define epoll_create(size)                        lwip_epoll_create(size)
+/** @ingroup socket */
+#define epoll_ctl(epfd,op,fd,event)               lwip_epoll_ctl(epfd,op,fd,event)
+/** @ingroup socket */
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif
 /** @ingroup socket */
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl(s,cmd,argp)
 /** @ingroup socket */
@@ -450,6 +450,12 @@ u32_t sys_jiffies(void);
 extern u32_t sys_now_offset;
 #endif
 
+#ifdef LWIP_VIRTUAL_SYS_NOW
+/* From now on, 'sys_now()' returns 'now' instead of the system time
+   (e.g. to replay recorded traffic with its recorded timestamps) */
+void sys_now_set_virtual(u32_t now);
+#endif
+
 /**
  * @ingroup sys_time
  * Returns the current time in milliseconds,
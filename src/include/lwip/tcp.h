@@ -133,6 +133,21 @@ typedef void  (*tcp_err_fn)(void *arg, err_t err);
  */
 typedef err_t (*tcp_connected_fn)(void *arg, struct tcp_pcb *tpcb, err_t err);
 
+/** Function prototype for allocating the pbufs that reference application
+ * data enqueued by tcp_write_ref(). Called once for every pbuf tcp_write_ref()
+ * needs to reference (part of) the data.
+ *
+ * The returned pbuf must have 'len' bytes of non-volatile payload at 'dataptr',
+ * typically a PBUF_ROM type pbuf_custom whose free function tells the
+ * application when the stack does not reference the data any more.
+ *
+ * @param arg Additional argument passed to tcp_write_ref()
+ * @param dataptr Start of the data to reference
+ * @param len Number of bytes to reference
+ * @return the referencing pbuf or NULL if out of memory
+ */
+typedef struct pbuf *(*tcp_ref_pbuf_fn)(void *arg, const void *dataptr, u16_t len);
+
 #if LWIP_WND_SCALE
 #define RCV_WND_SCALE(pcb, wnd) (((wnd) >> (pcb)->rcv_scale))
 #define SND_WND_SCALE(pcb, wnd) (((wnd) << (pcb)->snd_scale))
@@ -197,10 +212,6 @@ struct tcp_pcb_ext_args {
   const struct tcp_ext_arg_callbacks *callbacks;
   void *data;
 };
-/* This is a helper define to prevent zero size arrays if disabled */
-#define TCP_PCB_EXTARGS struct tcp_pcb_ext_args ext_args[LWIP_TCP_PCB_NUM_EXT_ARGS];
-#else
-#define TCP_PCB_EXTARGS
 #endif
 
 typedef u16_t tcpflags_t;
@@ -212,7 +223,6 @@ typedef u16_t tcpflags_t;
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
   void *callback_arg; \
-  TCP_PCB_EXTARGS \
   enum tcp_state state; /* TCP state */ \
   u8_t prio; \
   /* ports are in host byte order */ \
@@ -226,6 +236,11 @@ struct tcp_pcb_listen {
 /** Protocol specific PCB members */
   TCP_PCB_COMMON(struct tcp_pcb_listen);
 
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+  /* at the same offset as in struct tcp_pcb */
+  struct tcp_pcb_ext_args ext_args[LWIP_TCP_PCB_NUM_EXT_ARGS];
+#endif /* LWIP_TCP_PCB_NUM_EXT_ARGS */
+
 #if LWIP_CALLBACK_API
   /* Function to call when a listener has been connected. */
   tcp_accept_fn accept;
@@ -238,16 +253,29 @@ struct tcp_pcb_listen {
 };
 
 
-/** the TCP protocol control block */
+/** the TCP protocol control block
+ * The members are split in two parts: everything tcp_input(), tcp_receive()
+ * and tcp_output() touch for each segment or ACK of an established
+ * connection comes first, right after the common part used to look the pcb
+ * up; members only used by the application API, timers or rare events
+ * follow (starting at snd_lbb, see TCP_PCB_HOT_END).
+ */
 struct tcp_pcb {
 /** common PCB members */
   IP_PCB;
 /** protocol specific PCB members */
   TCP_PCB_COMMON(struct tcp_pcb);
 
+#if LWIP_TCP_PCB_NUM_EXT_ARGS
+  /* at the same offset as in struct tcp_pcb_listen */
+  struct tcp_pcb_ext_args ext_args[LWIP_TCP_PCB_NUM_EXT_ARGS];
+#endif /* LWIP_TCP_PCB_NUM_EXT_ARGS */
+
   /* ports are in host byte order */
   u16_t remote_port;
 
+  /* --- per-segment part --- */
+
   tcpflags_t flags;
 #define TF_ACK_DELAY   0x01U   /* Delayed ACK. */
 #define TF_ACK_NOW     0x02U   /* Immediate ACK. */
@@ -271,55 +299,22 @@ struct tcp_pcb {
 #define TF_SACK        0x1000U /* Selective ACKs enabled */
 #endif
 
+  u16_t mss;   /* maximum segment size */
+
   /* the rest of the fields are in host byte order
      as we have to do some math with them */
 
-  /* Timers */
-  u8_t polltmr, pollinterval;
-  u8_t last_timer;
-  u32_t tmr;
-
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
   tcpwnd_size_t rcv_wnd;   /* receiver window available */
   tcpwnd_size_t rcv_ann_wnd; /* receiver window to announce */
   u32_t rcv_ann_right_edge; /* announced right edge of window */
 
-#if LWIP_TCP_SACK_OUT
-  /* SACK ranges to include in ACK packets (entry is invalid if left==right) */
-  struct tcp_sack_range rcv_sacks[LWIP_TCP_MAX_SACK_NUM];
-#define LWIP_TCP_SACK_VALID(pcb, idx) ((pcb)->rcv_sacks[idx].left != (pcb)->rcv_sacks[idx].right)
-#endif /* LWIP_TCP_SACK_OUT */
-
-  /* Retransmission timer. */
-  s16_t rtime;
-
-  u16_t mss;   /* maximum segment size */
-
-  /* RTT (round trip time) estimation variables */
-  u32_t rttest; /* RTT estimate in 500ms ticks */
-  u32_t rtseq;  /* sequence number being timed */
-  s16_t sa, sv; /* @see "Congestion Avoidance and Control" by Van Jacobson and Karels */
-
-  s16_t rto;    /* retransmission time-out (in ticks of TCP_SLOW_INTERVAL) */
-  u8_t nrtx;    /* number of retransmissions */
-
-  /* fast retransmit/recovery */
-  u8_t dupacks;
-  u32_t lastack; /* Highest acknowledged seqno. */
-
-  /* congestion avoidance/control variables */
-  tcpwnd_size_t cwnd;
-  tcpwnd_size_t ssthresh;
-
-  /* first byte following last rto byte */
-  u32_t rto_end;
-
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
+  u32_t lastack; /* Highest acknowledged seqno. */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
                              window update. */
-  u32_t snd_lbb;       /* Sequence number of next byte to be buffered. */
   tcpwnd_size_t snd_wnd;   /* sender window */
   tcpwnd_size_t snd_wnd_max; /* the maximum sender window announced by the remote host */
 
@@ -332,8 +327,44 @@ struct tcp_pcb {
   u16_t unsent_oversize;
 #endif /* TCP_OVERSIZE */
 
+  /* congestion avoidance/control variables */
+  tcpwnd_size_t cwnd;
+  tcpwnd_size_t ssthresh;
   tcpwnd_size_t bytes_acked;
 
+  /* Retransmission timer. */
+  s16_t rtime;
+
+  s16_t rto;    /* retransmission time-out (in ticks of TCP_SLOW_INTERVAL) */
+
+  /* RTT (round trip time) estimation variables */
+  s16_t sa, sv; /* @see "Congestion Avoidance and Control" by Van Jacobson and Karels */
+  u32_t rttest; /* RTT estimate in 500ms ticks */
+  u32_t rtseq;  /* sequence number being timed */
+
+  /* Timers */
+  u32_t tmr;
+
+  u8_t nrtx;    /* number of retransmissions */
+
+  /* fast retransmit/recovery */
+  u8_t dupacks;
+
+  /* reset for every received segment */
+  u8_t polltmr;
+  u8_t persist_probe; /* Number of persist probes */
+  u8_t keep_cnt_sent; /* KEEPALIVE counter */
+
+#if LWIP_WND_SCALE
+  u8_t snd_scale;
+  u8_t rcv_scale;
+#endif
+
+#if LWIP_TCP_TIMESTAMPS
+  u32_t ts_lastacksent;
+  u32_t ts_recent;
+#endif /* LWIP_TCP_TIMESTAMPS */
+
   /* These are ordered by sequence number: */
   struct tcp_seg *unsent;   /* Unsent (queued) segments. */
   struct tcp_seg *unacked;  /* Sent but unacknowledged segments. */
@@ -343,27 +374,19 @@ struct tcp_pcb {
 
   struct pbuf *refused_data; /* Data previously received but not yet taken by upper layer */
 
-#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
-  struct tcp_pcb_listen* listener;
-#endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
-
 #if LWIP_CALLBACK_API
   /* Function to be called when more send buffer space is available. */
   tcp_sent_fn sent;
   /* Function to be called when (in-sequence) data has arrived. */
   tcp_recv_fn recv;
-  /* Function to be called when a connection has been set up. */
-  tcp_connected_fn connected;
-  /* Function which is called periodically. */
-  tcp_poll_fn poll;
-  /* Function to be called whenever a fatal error occurs. */
-  tcp_err_fn errf;
 #endif /* LWIP_CALLBACK_API */
 
-#if LWIP_TCP_TIMESTAMPS
-  u32_t ts_lastacksent;
-  u32_t ts_recent;
-#endif /* LWIP_TCP_TIMESTAMPS */
+  /* --- application API, timers and rare events --- */
+
+  u32_t snd_lbb;       /* Sequence number of next byte to be buffered. */
+
+  /* first byte following last rto byte */
+  u32_t rto_end;
 
   /* idle time before KEEPALIVE is sent */
   u32_t keep_idle;
@@ -372,20 +395,32 @@ struct tcp_pcb {
   u32_t keep_cnt;
 #endif /* LWIP_TCP_KEEPALIVE */
 
+  u8_t pollinterval;
+  u8_t last_timer;
+
   /* Persist timer counter */
   u8_t persist_cnt;
   /* Persist timer back-off */
   u8_t persist_backoff;
-  /* Number of persist probes */
-  u8_t persist_probe;
 
-  /* KEEPALIVE counter */
-  u8_t keep_cnt_sent;
+#if LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG
+  struct tcp_pcb_listen* listener;
+#endif /* LWIP_CALLBACK_API || TCP_LISTEN_BACKLOG */
 
-#if LWIP_WND_SCALE
-  u8_t snd_scale;
-  u8_t rcv_scale;
-#endif
+#if LWIP_CALLBACK_API
+  /* Function to be called when a connection has been set up. */
+  tcp_connected_fn connected;
+  /* Function which is called periodically. */
+  tcp_poll_fn poll;
+  /* Function to be called whenever a fatal error occurs. */
+  tcp_err_fn errf;
+#endif /* LWIP_CALLBACK_API */
+
+#if LWIP_TCP_SACK_OUT
+  /* SACK ranges to include in ACK packets (entry is invalid if left==right) */
+  struct tcp_sack_range rcv_sacks[LWIP_TCP_MAX_SACK_NUM];
+#define LWIP_TCP_SACK_VALID(pcb, idx) ((pcb)->rcv_sacks[idx].left != (pcb)->rcv_sacks[idx].right)
+#endif /* LWIP_TCP_SACK_OUT */
 };
 
 #if LWIP_EVENT_API
@@ -454,7 +489,7 @@ void             tcp_backlog_accepted(struct tcp_pcb* pcb);
 #endif /* TCP_LISTEN_BACKLOG */
 #define          tcp_accepted(pcb) do { LWIP_UNUSED_ARG(pcb); } while(0) /* compatibility define, not needed any more */
 
-void             tcp_recved  (struct tcp_pcb *pcb, u16_t len);
+void             tcp_recved  (struct tcp_pcb *pcb, pbuf_len_t len);
 err_t            tcp_bind    (struct tcp_pcb *pcb, const ip_addr_t *ipaddr,
                               u16_t port);
 void             tcp_bind_netif(struct tcp_pcb *pcb, const struct netif *netif);
@@ -472,6 +507,8 @@ err_t            tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
 
 err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t len,
                               u8_t apiflags);
+err_t            tcp_write_ref(struct tcp_pcb *pcb, const void *dataptr, u16_t len,
+                               u8_t apiflags, tcp_ref_pbuf_fn ref_fn, void *ref_arg);
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
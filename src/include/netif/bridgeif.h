@@ -97,11 +97,20 @@ err_t bridgeif_fdb_add(struct netif *bridgeif, const struct eth_addr *addr, brid
 err_t bridgeif_fdb_remove(struct netif *bridgeif, const struct eth_addr *addr);
 
 /* FDB interface, can be replaced by own implementation */
+#if BRIDGEIF_FDB_VLAN
+void                bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_addr, u16_t vid, u8_t port_idx);
+bridgeif_portmask_t bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr, u16_t vid);
+#else /* BRIDGEIF_FDB_VLAN */
 void                bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_addr, u8_t port_idx);
 bridgeif_portmask_t bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr);
+#endif /* BRIDGEIF_FDB_VLAN */
 void*               bridgeif_fdb_init(u16_t max_fdb_entries);
 
-#if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#if !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#include "lwip/tcpip.h"
+#endif /* !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+
+#if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_PORT_NETIFS_FAST_PATH
 #ifndef BRIDGEIF_DECL_PROTECT
 /* define bridgeif protection to sys_arch_protect... */
 #include "lwip/sys.h"
@@ -111,14 +120,13 @@ void*               bridgeif_fdb_init(u16_t max_fdb_entries);
 #define BRIDGEIF_WRITE_PROTECT(lev)
 #define BRIDGEIF_WRITE_UNPROTECT(lev)
 #endif
-#else /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
-#include "lwip/tcpip.h"
+#else /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_PORT_NETIFS_FAST_PATH */
 #define BRIDGEIF_DECL_PROTECT(lev)
 #define BRIDGEIF_READ_PROTECT(lev)
 #define BRIDGEIF_READ_UNPROTECT(lev)
 #define BRIDGEIF_WRITE_PROTECT(lev)
 #define BRIDGEIF_WRITE_UNPROTECT(lev)
-#endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+#endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_PORT_NETIFS_FAST_PATH */
 
 #ifdef __cplusplus
 }
@@ -58,6 +58,23 @@
 #define BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT  NO_SYS
 #endif
 
+/** BRIDGEIF_PORT_NETIFS_FAST_PATH==1: with BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT==0,
+ * set port netif's 'input' function to switch unicast frames to a station
+ * known on another port right in the context of the port driver (e.g. its
+ * RX thread), by directly calling the 'linkoutput' function of that port.
+ * Only frames for the bridge itself, group addresses and frames to unknown
+ * stations (flooding) get into tcpip_thread, so switching does not compete
+ * with the stack and multiple RX threads forward in parallel.
+ * The FDB is protected by SYS_ARCH_PROTECT (see BRIDGEIF_DECL_PROTECT), but
+ * *all* bridge port netif's drivers must correctly handle concurrent calls
+ * to 'linkoutput'!
+ * ATTENTION: frames of a flow may be reordered while its destination is
+ * being learnt (the first frames are flooded via tcpip_thread).
+ */
+#ifndef BRIDGEIF_PORT_NETIFS_FAST_PATH
+#define BRIDGEIF_PORT_NETIFS_FAST_PATH      0
+#endif
+
 /** BRIDGEIF_MAX_PORTS: this is used to create a typedef used for forwarding
  * bit-fields: the number of bits required is this + 1 (for the internal/cpu port)
  * (63 is the maximum, resulting in an u64_t for the bit mask)
@@ -68,6 +85,17 @@
 #define BRIDGEIF_MAX_PORTS                  7
 #endif
 
+/** BRIDGEIF_FDB_VLAN==1: learn auto-learnt FDB entries per VLAN (independent
+ * VLAN learning): the VID of 802.1Q tagged frames (0 for untagged frames) is
+ * part of the key, so a MAC address may be learnt on different ports in
+ * different VLANs. Static entries still apply to all VLANs.
+ * ATTENTION: this adds a 'vid' parameter to bridgeif_fdb_update_src() and
+ * bridgeif_fdb_get_dst_ports(), an own FDB implementation has to follow!
+ */
+#ifndef BRIDGEIF_FDB_VLAN
+#define BRIDGEIF_FDB_VLAN                   0
+#endif
+
 /** BRIDGEIF_DEBUG: Enable generic debugging in bridgeif.c. */
 #ifndef BRIDGEIF_DEBUG
 #define BRIDGEIF_DEBUG                      LWIP_DBG_OFF
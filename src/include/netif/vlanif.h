@@ -0,0 +1,90 @@
+/**
+ * @file
+ * lwIP netif implementing IEEE 802.1Q VLAN sub-interfaces
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#ifndef LWIP_HDR_NETIF_VLANIF_H
+#define LWIP_HDR_NETIF_VLANIF_H
+
+#include "lwip/opt.h"
+
+#if LWIP_VLANIF /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/netif.h"
+#include "lwip/prot/ethernet.h"
+#include "lwip/prot/ieee.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @ingroup vlanif
+ * Initialisation data for @ref vlanif_init.
+ * An instance of this type must be passed as parameter 'state' to @ref netif_add
+ * when the sub-interface is added. Every sub-interface takes one of the
+ * (at most 255) netif numbers.
+ */
+typedef struct vlanif_initdata_s {
+  /** the ethernet netif (or sub-interface, for Q-in-Q) carrying the VLAN */
+  struct netif *parent;
+  /** VLAN ID (1..4094) */
+  u16_t vid;
+  /** tag protocol identifier: ETHTYPE_VLAN, or ETHTYPE_SVLAN (ETHTYPE_QINQ)
+   * for the outer tag of Q-in-Q */
+  u16_t tpid;
+  /** priority code point of transmitted frames (0..7) */
+  u8_t pcp;
+} vlanif_initdata_t;
+
+/** @ingroup vlanif
+ * Use this for constant initialization of a vlanif_initdata_t
+ * (802.1Q customer VLAN 'vid' on 'parent')
+ */
+#define VLANIF_INITDATA(parent, vid) {(parent), (vid), ETHTYPE_VLAN, 0}
+/** @ingroup vlanif
+ * Use this for constant initialization of a vlanif_initdata_t
+ * (802.1ad service VLAN 'vid' on 'parent', the outer tag of Q-in-Q)
+ */
+#define VLANIF_INITDATA_SVLAN(parent, vid) {(parent), (vid), ETHTYPE_SVLAN, 0}
+
+err_t vlanif_init(struct netif *netif);
+struct netif *vlanif_get(struct netif *parent, u16_t vid);
+
+/* for ethernet_input() and netif_remove() */
+struct netif *vlanif_input_netif(struct netif *parent, u16_t type, const struct eth_vlan_hdr *vlan);
+void vlanif_netif_removed(struct netif *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_VLANIF */
+
+#endif /* LWIP_HDR_NETIF_VLANIF_H */
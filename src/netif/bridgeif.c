@@ -191,12 +191,30 @@ bridgeif_fdb_remove(struct netif *bridgeif, const struct eth_addr *addr)
   return ERR_VAL;
 }
 
+#if BRIDGEIF_FDB_VLAN
+/** VLAN of a frame for the FDB: the VID of its 802.1Q tag, 0 if untagged */
+static u16_t
+bridgeif_frame_vid(const struct pbuf *p)
+{
+  const u8_t *type = (const u8_t *)p->payload + 2 * sizeof(struct eth_addr);
+
+  if ((p->len >= 2 * sizeof(struct eth_addr) + 2 + SIZEOF_VLAN_HDR) &&
+      (type[0] == (ETHTYPE_VLAN >> 8)) && (type[1] == (ETHTYPE_VLAN & 0xff))) {
+    return (u16_t)(((type[2] << 8) | type[3]) & 0xFFF);
+  }
+  return 0;
+}
+#endif /* BRIDGEIF_FDB_VLAN */
+
 /** Get the forwarding port(s) (as bit mask) for the specified destination mac address */
 static bridgeif_portmask_t
-bridgeif_find_dst_ports(bridgeif_private_t *br, struct eth_addr *dst_addr)
+bridgeif_find_dst_ports(bridgeif_private_t *br, struct eth_addr *dst_addr, u16_t vid)
 {
   int i;
   BRIDGEIF_DECL_PROTECT(lev);
+#if !BRIDGEIF_FDB_VLAN
+  LWIP_UNUSED_ARG(vid);
+#endif /* !BRIDGEIF_FDB_VLAN */
   BRIDGEIF_READ_PROTECT(lev);
   /* first check for static entries */
   for (i = 0; i < br->max_fdbs_entries; i++) {
@@ -215,7 +233,11 @@ bridgeif_find_dst_ports(bridgeif_private_t *br, struct eth_addr *dst_addr)
   }
   BRIDGEIF_READ_UNPROTECT(lev);
   /* no match found: check dynamic fdb for port or fall back to flooding */
+#if BRIDGEIF_FDB_VLAN
+  return bridgeif_fdb_get_dst_ports(br->fdbd, dst_addr, vid);
+#else /* BRIDGEIF_FDB_VLAN */
   return bridgeif_fdb_get_dst_ports(br->fdbd, dst_addr);
+#endif /* BRIDGEIF_FDB_VLAN */
 }
 
 /** Helper function to see if a destination mac belongs to the bridge
@@ -300,8 +322,13 @@ bridgeif_output(struct netif *netif, struct pbuf *p)
   err_t err;
   bridgeif_private_t *br = (bridgeif_private_t *)netif->state;
   struct eth_addr *dst = (struct eth_addr *)(p->payload);
+#if BRIDGEIF_FDB_VLAN
+  u16_t vid = bridgeif_frame_vid(p);
+#else /* BRIDGEIF_FDB_VLAN */
+  u16_t vid = 0;
+#endif /* BRIDGEIF_FDB_VLAN */
 
-  bridgeif_portmask_t dstports = bridgeif_find_dst_ports(br, dst);
+  bridgeif_portmask_t dstports = bridgeif_find_dst_ports(br, dst, vid);
   err = bridgeif_send_to_ports(br, p, dstports);
 
   MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
@@ -326,6 +353,7 @@ static err_t
 bridgeif_input(struct pbuf *p, struct netif *netif)
 {
   u8_t rx_idx;
+  u16_t vid = 0;
   bridgeif_portmask_t dstports;
   struct eth_addr *src, *dst;
   bridgeif_private_t *br;
@@ -346,14 +374,22 @@ bridgeif_input(struct pbuf *p, struct netif *netif)
   dst = (struct eth_addr *)p->payload;
   src = (struct eth_addr *)(((u8_t *)p->payload) + sizeof(struct eth_addr));
 
+#if BRIDGEIF_FDB_VLAN
+  vid = bridgeif_frame_vid(p);
+#endif /* BRIDGEIF_FDB_VLAN */
+
   if ((src->addr[0] & 1) == 0) {
     /* update src for all non-group addresses */
+#if BRIDGEIF_FDB_VLAN
+    bridgeif_fdb_update_src(br->fdbd, src, vid, port->port_num);
+#else /* BRIDGEIF_FDB_VLAN */
     bridgeif_fdb_update_src(br->fdbd, src, port->port_num);
+#endif /* BRIDGEIF_FDB_VLAN */
   }
 
   if (dst->addr[0] & 1) {
     /* group address -> flood + cpu? */
-    dstports = bridgeif_find_dst_ports(br, dst);
+    dstports = bridgeif_find_dst_ports(br, dst, vid);
     bridgeif_send_to_ports(br, p, dstports);
     if (dstports & (1 << BRIDGEIF_MAX_PORTS)) {
       /* we pass the reference to ->input or have to free it */
@@ -376,7 +412,7 @@ bridgeif_input(struct pbuf *p, struct netif *netif)
     }
 
     /* get dst port */
-    dstports = bridgeif_find_dst_ports(br, dst);
+    dstports = bridgeif_find_dst_ports(br, dst, vid);
     bridgeif_send_to_ports(br, p, dstports);
     /* no need to send to cpu, flooding is for external ports only */
     /* by  this, we consumed the pbuf */
@@ -394,6 +430,70 @@ bridgeif_tcpip_input(struct pbuf *p, struct netif *netif)
 {
   return tcpip_inpkt(p, netif, bridgeif_input);
 }
+
+#if BRIDGEIF_PORT_NETIFS_FAST_PATH
+/** Input function for port netifs with BRIDGEIF_PORT_NETIFS_FAST_PATH, called
+ * in the context of the port driver: unicast frames to a station known on
+ * another port are switched here, everything else is passed to tcpip_thread.
+ */
+static err_t
+bridgeif_fast_input(struct pbuf *p, struct netif *netif)
+{
+  u8_t i;
+  u16_t vid = 0;
+  bridgeif_portmask_t dstports;
+  struct eth_addr *src, *dst;
+  bridgeif_private_t *br;
+  bridgeif_port_t *port;
+
+  if ((p == NULL) || (netif == NULL)) {
+    return ERR_VAL;
+  }
+  port = (bridgeif_port_t *)netif_get_client_data(netif, bridgeif_netif_client_id);
+  if ((port == NULL) || (port->bridge == NULL) || (p->len < SIZEOF_ETH_HDR)) {
+    return bridgeif_tcpip_input(p, netif);
+  }
+  br = (bridgeif_private_t *)port->bridge;
+
+  dst = (struct eth_addr *)p->payload;
+  src = (struct eth_addr *)(((u8_t *)p->payload) + sizeof(struct eth_addr));
+  if ((dst->addr[0] & 1) || bridgeif_is_local_mac(br, dst)) {
+    /* group address or for the cpu port */
+    return bridgeif_tcpip_input(p, netif);
+  }
+
+#if BRIDGEIF_FDB_VLAN
+  vid = bridgeif_frame_vid(p);
+#endif /* BRIDGEIF_FDB_VLAN */
+  dstports = bridgeif_find_dst_ports(br, dst, vid);
+  if ((dstports & ((bridgeif_portmask_t)1 << BRIDGEIF_MAX_PORTS)) ||
+      ((dstports & (bridgeif_portmask_t)(dstports - 1)) != 0)) {
+    /* flooding (unknown station), cpu port or more than one destination */
+    return bridgeif_tcpip_input(p, netif);
+  }
+
+  if ((src->addr[0] & 1) == 0) {
+#if BRIDGEIF_FDB_VLAN
+    bridgeif_fdb_update_src(br->fdbd, src, vid, port->port_num);
+#else /* BRIDGEIF_FDB_VLAN */
+    bridgeif_fdb_update_src(br->fdbd, src, port->port_num);
+#endif /* BRIDGEIF_FDB_VLAN */
+  }
+
+  /* store receive index in pbuf to prevent sending back to the rx port */
+  p->if_idx = netif_get_index(netif);
+  for (i = 0; i < BRIDGEIF_MAX_PORTS; i++) {
+    if (dstports & ((bridgeif_portmask_t)1 << i)) {
+      LWIP_DEBUGF(BRIDGEIF_FW_DEBUG, ("br -> fast(%p:%d) -> %d\n", (void *)p, p->if_idx, i));
+      bridgeif_send_to_port(br, p, i);
+      break;
+    }
+  }
+  /* sent or dropped (static entry without ports): we consumed the pbuf */
+  pbuf_free(p);
+  return ERR_OK;
+}
+#endif /* BRIDGEIF_PORT_NETIFS_FAST_PATH */
 #endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
 
 /**
@@ -549,6 +649,8 @@ bridgeif_add_port(struct netif *bridgeif, struct netif *portif)
   /* let the port call us on input */
 #if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
   portif->input = bridgeif_input;
+#elif BRIDGEIF_PORT_NETIFS_FAST_PATH
+  portif->input = bridgeif_fast_input;
 #else
   portif->input = bridgeif_tcpip_input;
 #endif
@@ -39,6 +39,12 @@
  * @defgroup bridgeif_fdb FDB example code
  * @ingroup bridgeif
  * This file implements an example for an FDB (Forwarding DataBase)
+ *
+ * Auto-learnt entries are indexed by a hash over their MAC address (and VID
+ * with @ref BRIDGEIF_FDB_VLAN), so learning and lookup take the same time for
+ * a few and for tens of thousands of entries. Entries remember when they were
+ * last seen; expired entries are ignored at once and returned to the free list
+ * by a sweep over a part of the table every second.
  */
 
 #include "netif/bridgeif.h"
@@ -51,127 +57,210 @@
 
 #define BR_FDB_TIMEOUT_SEC  (60*5) /* 5 minutes FDB timeout */
 
+/* expired entries are freed within this many seconds */
+#define BR_FDB_SWEEP_SEC    16
+
+/* end of a hash chain or the free list */
+#define BR_FDB_NONE         0xffff
+
 typedef struct bridgeif_dfdb_entry_s {
+  struct eth_addr addr;
+  u16_t vid;
+  /* next entry in the hash chain or in the free list */
+  u16_t next;
   u8_t used;
   u8_t port;
+  /* bridgeif_dfdb_t.now when the address was last seen */
   u32_t ts;
-  struct eth_addr addr;
 } bridgeif_dfdb_entry_t;
 
 typedef struct bridgeif_dfdb_s {
   u16_t max_fdb_entries;
+  u16_t hash_mask;
+  u16_t free_list;
+  u16_t sweep;
+  /* seconds since bridgeif_fdb_init() */
+  u32_t now;
+  u16_t *hash;
   bridgeif_dfdb_entry_t *fdb;
 } bridgeif_dfdb_t;
 
+static u16_t
+bridgeif_fdb_hash(const bridgeif_dfdb_t *fdb, const struct eth_addr *addr, u16_t vid)
+{
+  /* the last bytes differ most between the stations of one vendor */
+  u32_t h = ((u32_t)addr->addr[0] << 8) | addr->addr[1] | ((u32_t)vid << 16);
+  h *= 0x9e3779b1UL;
+  h ^= ((u32_t)addr->addr[2] << 24) | ((u32_t)addr->addr[3] << 16) |
+       ((u32_t)addr->addr[4] << 8) | addr->addr[5];
+  h *= 0x9e3779b1UL;
+  return (u16_t)((h >> 16) & fdb->hash_mask);
+}
+
+static int
+bridgeif_fdb_expired(const bridgeif_dfdb_t *fdb, const bridgeif_dfdb_entry_t *e)
+{
+  return (u32_t)(fdb->now - e->ts) >= BR_FDB_TIMEOUT_SEC;
+}
+
+/** Walk one hash chain, returns the entry index or BR_FDB_NONE */
+static u16_t
+bridgeif_fdb_find(const bridgeif_dfdb_t *fdb, u16_t h, const struct eth_addr *addr, u16_t vid)
+{
+  u16_t i;
+  for (i = fdb->hash[h]; i != BR_FDB_NONE; i = fdb->fdb[i].next) {
+    const bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
+    if ((e->vid == vid) && !memcmp(&e->addr, addr, sizeof(struct eth_addr))) {
+      return i;
+    }
+  }
+  return BR_FDB_NONE;
+}
+
+/** Remove an entry from its hash chain and put it on the free list */
+static void
+bridgeif_fdb_free_entry(bridgeif_dfdb_t *fdb, u16_t i)
+{
+  bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
+  u16_t *prev = &fdb->hash[bridgeif_fdb_hash(fdb, &e->addr, e->vid)];
+
+  while (*prev != i) {
+    LWIP_ASSERT("entry not in its hash chain", *prev != BR_FDB_NONE);
+    prev = &fdb->fdb[*prev].next;
+  }
+  *prev = e->next;
+  e->used = 0;
+  e->next = fdb->free_list;
+  fdb->free_list = i;
+}
+
 /**
  * @ingroup bridgeif_fdb
- * A real simple and slow implementation of an auto-learning forwarding database that
- * remembers known src mac addresses to know which port to send frames destined for that
- * mac address.
- *
- * ATTENTION: This is meant as an example only, in real-world use, you should
- * provide a better implementation :-)
+ * Remember the port a source mac address was seen on to know where to send
+ * frames destined for that mac address. A station seen again on the same port
+ * within the same second only needs the read protection.
  */
+#if BRIDGEIF_FDB_VLAN
+void
+bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_addr, u16_t vid, u8_t port_idx)
+#else /* BRIDGEIF_FDB_VLAN */
 void
 bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_addr, u8_t port_idx)
+#endif /* BRIDGEIF_FDB_VLAN */
 {
-  int i;
+  u16_t h, i;
+  bridgeif_dfdb_entry_t *e;
   bridgeif_dfdb_t *fdb = (bridgeif_dfdb_t *)fdb_ptr;
+#if !BRIDGEIF_FDB_VLAN
+  const u16_t vid = 0;
+#endif /* !BRIDGEIF_FDB_VLAN */
   BRIDGEIF_DECL_PROTECT(lev);
+
+  h = bridgeif_fdb_hash(fdb, src_addr, vid);
   BRIDGEIF_READ_PROTECT(lev);
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
-      if (!memcmp(&e->addr, src_addr, sizeof(struct eth_addr))) {
-        LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: update src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
-                                         src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
-                                         port_idx, i));
-        BRIDGEIF_WRITE_PROTECT(lev);
-        e->ts = BR_FDB_TIMEOUT_SEC;
-        e->port = port_idx;
-        BRIDGEIF_WRITE_UNPROTECT(lev);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return;
-      }
-    }
-  }
-  /* not found, allocate new entry from free */
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (!e->used || !e->ts) {
+  i = bridgeif_fdb_find(fdb, h, src_addr, vid);
+  if (i != BR_FDB_NONE) {
+    e = &fdb->fdb[i];
+    if ((e->port != port_idx) || (e->ts != fdb->now)) {
+      LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: update src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
+                                       src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
+                                       port_idx, i));
       BRIDGEIF_WRITE_PROTECT(lev);
-      /* check again when protected */
-      if (!e->used || !e->ts) {
-        LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: create src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
-                                         src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
-                                         port_idx, i));
-        memcpy(&e->addr, src_addr, sizeof(struct eth_addr));
-        e->ts = BR_FDB_TIMEOUT_SEC;
-        e->port = port_idx;
-        e->used = 1;
-        BRIDGEIF_WRITE_UNPROTECT(lev);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return;
-      }
+      e->ts = fdb->now;
+      e->port = port_idx;
       BRIDGEIF_WRITE_UNPROTECT(lev);
     }
+    BRIDGEIF_READ_UNPROTECT(lev);
+    return;
+  }
+  /* not found, allocate new entry from free */
+  BRIDGEIF_WRITE_PROTECT(lev);
+  /* check again when protected */
+  if ((bridgeif_fdb_find(fdb, h, src_addr, vid) == BR_FDB_NONE) && (fdb->free_list != BR_FDB_NONE)) {
+    i = fdb->free_list;
+    e = &fdb->fdb[i];
+    LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: create src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
+                                     src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
+                                     port_idx, i));
+    fdb->free_list = e->next;
+    memcpy(&e->addr, src_addr, sizeof(struct eth_addr));
+    e->vid = vid;
+    e->ts = fdb->now;
+    e->port = port_idx;
+    e->used = 1;
+    e->next = fdb->hash[h];
+    fdb->hash[h] = i;
   }
+  /* else: no free entry -> flood */
+  BRIDGEIF_WRITE_UNPROTECT(lev);
   BRIDGEIF_READ_UNPROTECT(lev);
-  /* not found, no free entry -> flood */
 }
 
 /**
  * @ingroup bridgeif_fdb
- * Walk our list of auto-learnt fdb entries and return a port to forward or BR_FLOOD if unknown
+ * Look up the auto-learnt port of a mac address, returns the port to forward
+ * to or BR_FLOOD if unknown
  */
+#if BRIDGEIF_FDB_VLAN
+bridgeif_portmask_t
+bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr, u16_t vid)
+#else /* BRIDGEIF_FDB_VLAN */
 bridgeif_portmask_t
 bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr)
+#endif /* BRIDGEIF_FDB_VLAN */
 {
-  int i;
+  u16_t h, i;
+  bridgeif_portmask_t ret = BR_FLOOD;
   bridgeif_dfdb_t *fdb = (bridgeif_dfdb_t *)fdb_ptr;
+#if !BRIDGEIF_FDB_VLAN
+  const u16_t vid = 0;
+#endif /* !BRIDGEIF_FDB_VLAN */
   BRIDGEIF_DECL_PROTECT(lev);
+
+  h = bridgeif_fdb_hash(fdb, dst_addr, vid);
   BRIDGEIF_READ_PROTECT(lev);
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
-      if (!memcmp(&e->addr, dst_addr, sizeof(struct eth_addr))) {
-        bridgeif_portmask_t ret = (bridgeif_portmask_t)(1 << e->port);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return ret;
-      }
-    }
+  i = bridgeif_fdb_find(fdb, h, dst_addr, vid);
+  if ((i != BR_FDB_NONE) && !bridgeif_fdb_expired(fdb, &fdb->fdb[i])) {
+    ret = (bridgeif_portmask_t)(1 << fdb->fdb[i].port);
   }
   BRIDGEIF_READ_UNPROTECT(lev);
-  return BR_FLOOD;
+  return ret;
 }
 
 /**
  * @ingroup bridgeif_fdb
- * Aging implementation of our simple fdb
+ * Aging implementation of our simple fdb: advance the clock and free the
+ * expired entries in the next part of the table
  */
 static void
 bridgeif_fdb_age_one_second(void *fdb_ptr)
 {
-  int i;
+  u16_t n, i;
   bridgeif_dfdb_t *fdb;
   BRIDGEIF_DECL_PROTECT(lev);
 
   fdb = (bridgeif_dfdb_t *)fdb_ptr;
   BRIDGEIF_READ_PROTECT(lev);
+  BRIDGEIF_WRITE_PROTECT(lev);
+  fdb->now++;
+  BRIDGEIF_WRITE_UNPROTECT(lev);
 
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
+  i = fdb->sweep;
+  for (n = (u16_t)((fdb->max_fdb_entries + BR_FDB_SWEEP_SEC - 1) / BR_FDB_SWEEP_SEC); n > 0; n--) {
     bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
+    if (e->used && bridgeif_fdb_expired(fdb, e)) {
       BRIDGEIF_WRITE_PROTECT(lev);
       /* check again when protected */
-      if (e->used && e->ts) {
-        if (--e->ts == 0) {
-          e->used = 0;
-        }
+      if (e->used && bridgeif_fdb_expired(fdb, e)) {
+        bridgeif_fdb_free_entry(fdb, i);
       }
       BRIDGEIF_WRITE_UNPROTECT(lev);
     }
+    if (++i == fdb->max_fdb_entries) {
+      i = 0;
+    }
   }
+  fdb->sweep = i;
   BRIDGEIF_READ_UNPROTECT(lev);
 }
 
@@ -195,8 +284,22 @@ void *
 bridgeif_fdb_init(u16_t max_fdb_entries)
 {
   bridgeif_dfdb_t *fdb;
-  size_t alloc_len_sizet = sizeof(bridgeif_dfdb_t) + (max_fdb_entries * sizeof(bridgeif_dfdb_entry_t));
-  mem_size_t alloc_len = (mem_size_t)alloc_len_sizet;
+  u32_t hash_size = 1;
+  u16_t i;
+  size_t alloc_len_sizet;
+  mem_size_t alloc_len;
+
+  LWIP_ASSERT("max_fdb_entries < BR_FDB_NONE", max_fdb_entries < BR_FDB_NONE);
+  if (max_fdb_entries == 0) {
+    max_fdb_entries = 1;
+  }
+  /* one hash chain per entry */
+  while (hash_size < max_fdb_entries) {
+    hash_size <<= 1;
+  }
+  alloc_len_sizet = sizeof(bridgeif_dfdb_t) + (max_fdb_entries * sizeof(bridgeif_dfdb_entry_t)) +
+                    (hash_size * sizeof(u16_t));
+  alloc_len = (mem_size_t)alloc_len_sizet;
   LWIP_ASSERT("alloc_len == alloc_len_sizet", alloc_len == alloc_len_sizet);
   LWIP_DEBUGF(BRIDGEIF_DEBUG, ("bridgeif_fdb_init: allocating %d bytes for private FDB data\n", (int)alloc_len));
   fdb = (bridgeif_dfdb_t *)mem_calloc(1, alloc_len);
@@ -204,7 +307,16 @@ bridgeif_fdb_init(u16_t max_fdb_entries)
     return NULL;
   }
   fdb->max_fdb_entries = max_fdb_entries;
+  fdb->hash_mask = (u16_t)(hash_size - 1);
   fdb->fdb = (bridgeif_dfdb_entry_t *)(fdb + 1);
+  fdb->hash = (u16_t *)(fdb->fdb + max_fdb_entries);
+  /* all chains empty: BR_FDB_NONE */
+  memset(fdb->hash, 0xff, hash_size * sizeof(u16_t));
+  for (i = 0; i < max_fdb_entries - 1; i++) {
+    fdb->fdb[i].next = (u16_t)(i + 1);
+  }
+  fdb->fdb[i].next = BR_FDB_NONE;
+  fdb->free_list = 0;
 
   sys_timeout(BRIDGEIF_AGE_TIMER_MS, bridgeif_age_tmr, fdb);
 
@@ -43,10 +43,12 @@
 #if LWIP_ARP || LWIP_ETHERNET
 
 #include "netif/ethernet.h"
+#include "netif/vlanif.h"
 #include "lwip/def.h"
 #include "lwip/stats.h"
 #include "lwip/etharp.h"
 #include "lwip/ip.h"
+#include "lwip/ip_flow.h"
 #include "lwip/snmp.h"
 
 #include <string.h>
@@ -82,12 +84,14 @@ ethernet_input(struct pbuf *p, struct netif *netif)
 {
   struct eth_hdr *ethhdr;
   u16_t type;
-#if LWIP_ARP || ETHARP_SUPPORT_VLAN || LWIP_IPV6
+#if LWIP_ARP || ETHARP_SUPPORT_VLAN || LWIP_IPV6 || LWIP_VLANIF
   u16_t next_hdr_offset = SIZEOF_ETH_HDR;
-#endif /* LWIP_ARP || ETHARP_SUPPORT_VLAN */
+#endif /* LWIP_ARP || ETHARP_SUPPORT_VLAN || LWIP_IPV6 || LWIP_VLANIF */
 
   LWIP_ASSERT_CORE_LOCKED();
 
+  PERF_START;
+
   if (p->len <= SIZEOF_ETH_HDR) {
     /* a packet with only an ethernet header (or less) is not valid for us */
     ETHARP_STATS_INC(etharp.proterr);
@@ -111,11 +115,30 @@ ethernet_input(struct pbuf *p, struct netif *netif)
                lwip_htons(ethhdr->type)));
 
   type = ethhdr->type;
+#if LWIP_VLANIF
+  /* pass tagged frames on to the sub-interface of their VLAN, one tag per
+     stacked sub-interface (Q-in-Q) */
+  while ((netif->vlans != NULL) && (p->len > (u16_t)(next_hdr_offset + SIZEOF_VLAN_HDR))) {
+    struct eth_vlan_hdr *vlan = (struct eth_vlan_hdr *)(((char *)ethhdr) + next_hdr_offset);
+    struct netif *vlan_netif = vlanif_input_netif(netif, type, vlan);
+    if (vlan_netif == NULL) {
+      break;
+    }
+    if (!netif_is_up(vlan_netif)) {
+      /* silently ignore this packet: VLAN is down */
+      goto free_and_return;
+    }
+    netif = vlan_netif;
+    p->if_idx = netif_get_index(netif);
+    type = vlan->tpid;
+    next_hdr_offset = (u16_t)(next_hdr_offset + SIZEOF_VLAN_HDR);
+  }
+#endif /* LWIP_VLANIF */
 #if ETHARP_SUPPORT_VLAN
   if (type == PP_HTONS(ETHTYPE_VLAN)) {
-    struct eth_vlan_hdr *vlan = (struct eth_vlan_hdr *)(((char *)ethhdr) + SIZEOF_ETH_HDR);
-    next_hdr_offset = SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR;
-    if (p->len <= SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR) {
+    struct eth_vlan_hdr *vlan = (struct eth_vlan_hdr *)(((char *)ethhdr) + next_hdr_offset);
+    next_hdr_offset = (u16_t)(next_hdr_offset + SIZEOF_VLAN_HDR);
+    if (p->len <= next_hdr_offset) {
       /* a packet with only an ethernet/vlan header (or less) is not valid for us */
       ETHARP_STATS_INC(etharp.proterr);
       ETHARP_STATS_INC(etharp.drop);
@@ -177,7 +200,7 @@ ethernet_input(struct pbuf *p, struct netif *netif)
       /* skip Ethernet header (min. size checked above) */
       if (pbuf_remove_header(p, next_hdr_offset)) {
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_WARNING,
-                    ("ethernet_input: IPv4 packet dropped, too short (%"U16_F"/%"U16_F")\n",
+                    ("ethernet_input: IPv4 packet dropped, too short (%"PBUFLEN_F"/%"U16_F")\n",
                      p->tot_len, next_hdr_offset));
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("Can't move over header in packet"));
         goto free_and_return;
@@ -194,7 +217,7 @@ ethernet_input(struct pbuf *p, struct netif *netif)
       /* skip Ethernet header (min. size checked above) */
       if (pbuf_remove_header(p, next_hdr_offset)) {
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_WARNING,
-                    ("ethernet_input: ARP response packet dropped, too short (%"U16_F"/%"U16_F")\n",
+                    ("ethernet_input: ARP response packet dropped, too short (%"PBUFLEN_F"/%"U16_F")\n",
                      p->tot_len, next_hdr_offset));
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("Can't move over header in packet"));
         ETHARP_STATS_INC(etharp.lenerr);
@@ -221,7 +244,7 @@ ethernet_input(struct pbuf *p, struct netif *netif)
       /* skip Ethernet header */
       if ((p->len < next_hdr_offset) || pbuf_remove_header(p, next_hdr_offset)) {
         LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_WARNING,
-                    ("ethernet_input: IPv6 packet dropped, too short (%"U16_F"/%"U16_F")\n",
+                    ("ethernet_input: IPv6 packet dropped, too short (%"PBUFLEN_F"/%"U16_F")\n",
                      p->tot_len, next_hdr_offset));
         goto free_and_return;
       } else {
@@ -245,10 +268,13 @@ ethernet_input(struct pbuf *p, struct netif *netif)
 
   /* This means the pbuf is freed or consumed,
      so the caller doesn't have to free it again */
-  return ERR_OK;
+  p = NULL;
 
 free_and_return:
-  pbuf_free(p);
+  if (p != NULL) {
+    pbuf_free(p);
+  }
+  PERF_STOP("ethernet_input");
   return ERR_OK;
 }
 
@@ -316,6 +342,11 @@ ethernet_output(struct netif * netif, struct pbuf * p,
   LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE,
               ("ethernet_output: sending packet %p\n", (void *)p));
 
+#if IP_FLOW_CACHE_SIZE
+  /* a forwarded packet may teach the flow cache its next hop */
+  ip_flow_learn_hwaddr(netif, p, dst);
+#endif /* IP_FLOW_CACHE_SIZE */
+
   /* send the packet */
   return netif->linkoutput(netif, p);
 
@@ -0,0 +1,432 @@
+/**
+ * @file
+ * lwIP netif implementing IEEE 802.1Q VLAN sub-interfaces
+ *
+ * @defgroup vlanif VLAN sub-interfaces
+ * @ingroup netifs
+ * A VLAN sub-interface is a netif stacked on a parent ethernet netif (e.g. a
+ * trunk port) which terminates one VLAN of it (@ref LWIP_VLANIF): it has
+ * its own addresses and routes, frames it sends are tagged with its VID and
+ * ethernet_input() of the parent passes received frames tagged with its VID
+ * to it, with the tag still in front of the ethernet payload.\n
+ * The parent keeps a table of its sub-interfaces indexed by VID, so the
+ * sub-interface of a frame is found in constant time. Frames for VLANs
+ * without a sub-interface stay on the parent (see @ref ETHARP_SUPPORT_VLAN).\n
+ * Each sub-interface is a netif and netifs are numbered with a u8_t:
+ * netif_add() fails an assertion beyond 255 netifs (parent and loopback
+ * netif included), so at most about 250 VLANs can have a sub-interface.
+ * Routing (ip4_route(), ip6_route()) walks the netif list, its cost grows
+ * with the number of sub-interfaces.\n
+ * Q-in-Q (802.1ad): a service VLAN sub-interface (tag protocol
+ * ETHTYPE_SVLAN or ETHTYPE_QINQ) on the physical netif with customer VLAN
+ * sub-interfaces stacked on it terminates double tagged frames.\n
+ * The tag is inserted into the header room in front of the ethernet header:
+ * configure PBUF_LINK_ENCAPSULATION_HLEN to 4 bytes per tag (8 for Q-in-Q)
+ * so frames sent by the stack have room for it. Frames without room (e.g.
+ * forwarded frames) are copied.\n
+ * Usage:
+ * - add the parent (ethernet) netif
+ * - add sub-interfaces with @ref vlanif_init as init function and a
+ *   @ref vlanif_initdata_t as state, e.g.:
+ * @code{.c}
+ *   vlanif_initdata_t vlan10 = VLANIF_INITDATA(&eth_netif, 10);
+ *   netif_add(&vlan10_netif, &ip, &mask, &gw, &vlan10, vlanif_init, ethernet_input);
+ * @endcode
+ * - the link state of a sub-interface is the one of its parent when it is
+ *   added; later changes have to be passed on by the application
+ *   (netif_set_link_up()/netif_set_link_down()).
+ * - multicast MAC filter changes are passed on to the parent.
+ *
+ * Removing the parent leaves its sub-interfaces detached: they drop all
+ * frames sent on them.\n
+ * To be called from TCPIP thread
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "netif/vlanif.h"
+
+#if LWIP_VLANIF /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/def.h"
+#include "lwip/etharp.h"
+#include "lwip/ethip6.h"
+#include "lwip/mem.h"
+#include "lwip/snmp.h"
+#include "lwip/stats.h"
+#include "netif/ethernet.h"
+
+#include <string.h>
+
+/* Define those to better describe your network interface. */
+#define IFNAME0 'v'
+#define IFNAME1 'l'
+
+/** The table of a parent has two levels so that only the ranges of VIDs in
+ * use take memory: a chunk of VLANIF_CHUNK_SIZE netif pointers is allocated
+ * when its first sub-interface is added */
+#define VLANIF_CHUNK_BITS   6
+#define VLANIF_CHUNK_SIZE   (1 << VLANIF_CHUNK_BITS)
+#define VLANIF_NUM_VIDS     4096
+#define VLANIF_NUM_CHUNKS   (VLANIF_NUM_VIDS >> VLANIF_CHUNK_BITS)
+
+struct vlanif_table {
+  struct netif **chunks[VLANIF_NUM_CHUNKS];
+  u16_t count;
+};
+
+typedef struct vlanif_private_s {
+  struct netif *parent;
+  u16_t vid;
+  /** tag protocol identifier in network byte order */
+  u16_t tpid_be;
+  /** tag control information (PCP and VID) in network byte order */
+  u16_t tci_be;
+} vlanif_private_t;
+
+/** Slot of a VID in the table of a parent, NULL if its chunk is not allocated */
+static struct netif **
+vlanif_slot(const struct netif *parent, u16_t vid)
+{
+  struct netif **chunk;
+
+  if (parent->vlans == NULL) {
+    return NULL;
+  }
+  chunk = parent->vlans->chunks[vid >> VLANIF_CHUNK_BITS];
+  if (chunk == NULL) {
+    return NULL;
+  }
+  return &chunk[vid & (VLANIF_CHUNK_SIZE - 1)];
+}
+
+/**
+ * @ingroup vlanif
+ * Get the sub-interface of a VLAN.
+ *
+ * @param parent the netif carrying the VLAN
+ * @param vid VLAN ID
+ * @return the sub-interface or NULL if there is none for this VID
+ */
+struct netif *
+vlanif_get(struct netif *parent, u16_t vid)
+{
+  struct netif **slot;
+
+  LWIP_ASSERT("invalid netif", parent != NULL);
+  slot = vlanif_slot(parent, (u16_t)(vid & (VLANIF_NUM_VIDS - 1)));
+  if (slot == NULL) {
+    return NULL;
+  }
+  return *slot;
+}
+
+/**
+ * Called by ethernet_input() for every frame received on a netif with
+ * sub-interfaces: find the sub-interface of a tagged frame.
+ *
+ * @param parent the netif the frame was received on
+ * @param type the ethernet type in front of the tag (network byte order)
+ * @param vlan the tag
+ * @return the sub-interface to pass the frame to or NULL if the frame is not
+ *         tagged or there is no sub-interface for its tag
+ */
+struct netif *
+vlanif_input_netif(struct netif *parent, u16_t type, const struct eth_vlan_hdr *vlan)
+{
+  struct netif *netif;
+
+  if ((type != PP_HTONS(ETHTYPE_VLAN)) && (type != PP_HTONS(ETHTYPE_SVLAN)) &&
+      (type != PP_HTONS(ETHTYPE_QINQ))) {
+    return NULL;
+  }
+  netif = vlanif_get(parent, (u16_t)VLAN_ID(vlan));
+  if ((netif != NULL) && (((vlanif_private_t *)netif->state)->tpid_be == type)) {
+    return netif;
+  }
+  return NULL;
+}
+
+/** linkoutput function of sub-interfaces: insert the tag and send the frame
+ * on the parent */
+static err_t
+vlanif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  vlanif_private_t *vif = (vlanif_private_t *)netif->state;
+  struct netif *parent;
+  struct pbuf *q = p;
+  u8_t *hdr;
+  err_t err;
+
+  if (vif == NULL) {
+    /* sub-interface is being removed */
+    LINK_STATS_INC(link.drop);
+    MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+    return ERR_IF;
+  }
+  parent = vif->parent;
+  if ((parent == NULL) || (parent->linkoutput == NULL)) {
+    /* parent has been removed */
+    LINK_STATS_INC(link.drop);
+    MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+    return ERR_IF;
+  }
+  if (p->len < SIZEOF_ETH_HDR) {
+    LINK_STATS_INC(link.err);
+    MIB2_STATS_NETIF_INC(netif, ifouterrors);
+    return ERR_VAL;
+  }
+
+  if (pbuf_add_header(p, SIZEOF_VLAN_HDR) == 0) {
+    /* move the addresses to the front, the ethernet type now follows the tag */
+    hdr = (u8_t *)p->payload + ETH_PAD_SIZE;
+    memmove(hdr, hdr + SIZEOF_VLAN_HDR, 2 * ETH_HWADDR_LEN);
+  } else {
+    /* no header room: copy */
+    q = pbuf_alloc(PBUF_RAW, (u16_t)(p->tot_len + SIZEOF_VLAN_HDR), PBUF_RAM);
+    if (q == NULL) {
+      LINK_STATS_INC(link.memerr);
+      MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+      return ERR_MEM;
+    }
+    hdr = (u8_t *)q->payload + ETH_PAD_SIZE;
+    pbuf_copy_partial(p, q->payload, ETH_PAD_SIZE + 2 * ETH_HWADDR_LEN, 0);
+    pbuf_copy_partial(p, hdr + 2 * ETH_HWADDR_LEN + SIZEOF_VLAN_HDR,
+                      (u16_t)(p->tot_len - ETH_PAD_SIZE - 2 * ETH_HWADDR_LEN),
+                      ETH_PAD_SIZE + 2 * ETH_HWADDR_LEN);
+  }
+  /* the tag: protocol identifier and control information */
+  SMEMCPY(hdr + 2 * ETH_HWADDR_LEN, &vif->tpid_be, sizeof(u16_t));
+  SMEMCPY(hdr + 2 * ETH_HWADDR_LEN + 2, &vif->tci_be, sizeof(u16_t));
+
+  MIB2_STATS_NETIF_ADD(netif, ifoutoctets, q->tot_len);
+  if (hdr[0] & 1) {
+    MIB2_STATS_NETIF_INC(netif, ifoutnucastpkts);
+  } else {
+    MIB2_STATS_NETIF_INC(netif, ifoutucastpkts);
+  }
+  LINK_STATS_INC(link.xmit);
+
+  err = parent->linkoutput(parent, q);
+  if (q != p) {
+    pbuf_free(q);
+  }
+  return err;
+}
+
+#if LWIP_IPV4 && LWIP_IGMP
+/** Pass multicast filter changes on to the parent */
+static err_t
+vlanif_igmp_mac_filter(struct netif *netif, const ip4_addr_t *group, enum netif_mac_filter_action action)
+{
+  vlanif_private_t *vif = (vlanif_private_t *)netif->state;
+  struct netif *parent;
+
+  if (vif == NULL) {
+    return ERR_IF;
+  }
+  parent = vif->parent;
+  if ((parent != NULL) && (parent->igmp_mac_filter != NULL)) {
+    return parent->igmp_mac_filter(parent, group, action);
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_IPV4 && LWIP_IGMP */
+
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+/** Pass multicast filter changes on to the parent */
+static err_t
+vlanif_mld_mac_filter(struct netif *netif, const ip6_addr_t *group, enum netif_mac_filter_action action)
+{
+  vlanif_private_t *vif = (vlanif_private_t *)netif->state;
+  struct netif *parent;
+
+  if (vif == NULL) {
+    return ERR_IF;
+  }
+  parent = vif->parent;
+  if ((parent != NULL) && (parent->mld_mac_filter != NULL)) {
+    return parent->mld_mac_filter(parent, group, action);
+  }
+  return ERR_OK;
+}
+#endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
+
+/**
+ * @ingroup vlanif
+ * Initialization function passed to netif_add().
+ *
+ * ATTENTION: A pointer to a @ref vlanif_initdata_t must be passed as 'state'
+ *            to @ref netif_add when adding the sub-interface. It is only
+ *            used during this call.
+ *
+ * @param netif the lwip network interface structure for this vlanif
+ * @return ERR_OK if the sub-interface is added\n
+ *         ERR_ARG for invalid init data\n
+ *         ERR_VAL if the parent already has a sub-interface for this VID\n
+ *         ERR_MEM if memory could not be allocated
+ */
+err_t
+vlanif_init(struct netif *netif)
+{
+  vlanif_initdata_t *init_data;
+  vlanif_private_t *vif;
+  struct netif *parent;
+  struct netif **chunk;
+  u16_t chunk_idx;
+
+  LWIP_ASSERT("netif != NULL", (netif != NULL));
+  init_data = (vlanif_initdata_t *)netif->state;
+  LWIP_ERROR("vlanif_init: invalid init data", (init_data != NULL) &&
+             (init_data->parent != NULL) && (init_data->vid > 0) &&
+             (init_data->vid < VLANIF_NUM_VIDS - 1) && (init_data->pcp < 8) &&
+             (init_data->parent->hwaddr_len == ETH_HWADDR_LEN), return ERR_ARG;);
+  parent = init_data->parent;
+
+  if (vlanif_get(parent, init_data->vid) != NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("vlanif_init: VID %"U16_F" already in use\n", init_data->vid));
+    return ERR_VAL;
+  }
+
+  vif = (vlanif_private_t *)mem_malloc(sizeof(vlanif_private_t));
+  if (vif == NULL) {
+    LWIP_DEBUGF(NETIF_DEBUG, ("vlanif_init: out of memory\n"));
+    return ERR_MEM;
+  }
+  if (parent->vlans == NULL) {
+    parent->vlans = (struct vlanif_table *)mem_calloc(1, sizeof(struct vlanif_table));
+    if (parent->vlans == NULL) {
+      mem_free(vif);
+      LWIP_DEBUGF(NETIF_DEBUG, ("vlanif_init: out of memory\n"));
+      return ERR_MEM;
+    }
+  }
+  chunk_idx = (u16_t)(init_data->vid >> VLANIF_CHUNK_BITS);
+  chunk = parent->vlans->chunks[chunk_idx];
+  if (chunk == NULL) {
+    chunk = (struct netif **)mem_calloc(VLANIF_CHUNK_SIZE, sizeof(struct netif *));
+    if (chunk == NULL) {
+      if (parent->vlans->count == 0) {
+        mem_free(parent->vlans);
+        parent->vlans = NULL;
+      }
+      mem_free(vif);
+      LWIP_DEBUGF(NETIF_DEBUG, ("vlanif_init: out of memory\n"));
+      return ERR_MEM;
+    }
+    parent->vlans->chunks[chunk_idx] = chunk;
+  }
+  chunk[init_data->vid & (VLANIF_CHUNK_SIZE - 1)] = netif;
+  parent->vlans->count++;
+
+  vif->parent = parent;
+  vif->vid = init_data->vid;
+  vif->tpid_be = lwip_htons(init_data->tpid);
+  vif->tci_be = lwip_htons((u16_t)((init_data->pcp << 13) | init_data->vid));
+  netif->state = vif;
+
+  MIB2_INIT_NETIF(netif, snmp_ifType_ethernet_csmacd, 0);
+
+  netif->name[0] = IFNAME0;
+  netif->name[1] = IFNAME1;
+#if LWIP_IPV4
+  netif->output = etharp_output;
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+  netif->output_ip6 = ethip6_output;
+#endif /* LWIP_IPV6 */
+  netif->linkoutput = vlanif_linkoutput;
+#if LWIP_IPV4 && LWIP_IGMP
+  netif->igmp_mac_filter = vlanif_igmp_mac_filter;
+#endif /* LWIP_IPV4 && LWIP_IGMP */
+#if LWIP_IPV6 && LWIP_IPV6_MLD
+  netif->mld_mac_filter = vlanif_mld_mac_filter;
+#endif /* LWIP_IPV6 && LWIP_IPV6_MLD */
+
+  SMEMCPY(netif->hwaddr, parent->hwaddr, ETH_HWADDR_LEN);
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->mtu = parent->mtu;
+  netif->flags = (u8_t)(NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET |
+                        (parent->flags & (NETIF_FLAG_IGMP | NETIF_FLAG_MLD6 | NETIF_FLAG_LINK_UP)));
+
+  return ERR_OK;
+}
+
+/**
+ * Called by netif_remove(): a removed sub-interface leaves the table of its
+ * parent, the sub-interfaces of a removed parent are detached.
+ *
+ * @param netif the netif being removed
+ */
+void
+vlanif_netif_removed(struct netif *netif)
+{
+  u16_t i, j;
+
+  if (netif->linkoutput == vlanif_linkoutput) {
+    vlanif_private_t *vif = (vlanif_private_t *)netif->state;
+    if (vif != NULL) {
+      if (vif->parent != NULL) {
+        struct netif **slot = vlanif_slot(vif->parent, vif->vid);
+        LWIP_ASSERT("sub-interface not in parent table", (slot != NULL) && (*slot == netif));
+        *slot = NULL;
+        vif->parent->vlans->count--;
+        if (vif->parent->vlans->count == 0) {
+          /* keep the parent fast when its last VLAN is gone */
+          for (i = 0; i < VLANIF_NUM_CHUNKS; i++) {
+            if (vif->parent->vlans->chunks[i] != NULL) {
+              mem_free(vif->parent->vlans->chunks[i]);
+            }
+          }
+          mem_free(vif->parent->vlans);
+          vif->parent->vlans = NULL;
+        }
+      }
+      mem_free(vif);
+      netif->state = NULL;
+    }
+  }
+
+  if (netif->vlans != NULL) {
+    for (i = 0; i < VLANIF_NUM_CHUNKS; i++) {
+      struct netif **chunk = netif->vlans->chunks[i];
+      if (chunk != NULL) {
+        for (j = 0; j < VLANIF_CHUNK_SIZE; j++) {
+          if (chunk[j] != NULL) {
+            ((vlanif_private_t *)chunk[j]->state)->parent = NULL;
+          }
+        }
+        mem_free(chunk);
+      }
+    }
+    mem_free(netif->vlans);
+    netif->vlans = NULL;
+  }
+}
+
+#endif /* LWIP_VLANIF */
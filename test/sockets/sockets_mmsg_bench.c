@@ -0,0 +1,250 @@
+/**
+ * @file
+ * Sockets recvmmsg/sendmmsg benchmark
+ *
+ * This file compares the per-datagram cost of lwip_sendto()/lwip_recvfrom()
+ * with lwip_sendmmsg()/lwip_recvmmsg() by sending small UDP datagrams to
+ * itself over the loopback netif and printing datagrams per second and the
+ * time per datagram.
+ *
+ * - datagrams are sent in bursts that must fit into the socket's receive
+ *   queue (MEMP_NUM_NETBUF, DEFAULT_UDP_RECVMBOX_SIZE)
+ * - LWIP_SO_RCVTIMEO should be enabled so that lost datagrams only cost
+ *   one timeout instead of blocking the benchmark
+ */
+
+/*
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+#include "sockets_mmsg_bench.h"
+
+#include "lwip/sockets.h"
+#include "lwip/sys.h"
+
+#include "lwip/mem.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if LWIP_SOCKET && LWIP_SOCKET_MMSG && LWIP_IPV4 /* this uses IPv4 loopback sockets, currently */
+
+#ifndef TEST_SOCKETS_MMSG_BENCH
+#define TEST_SOCKETS_MMSG_BENCH   LWIP_DBG_OFF
+#endif
+
+/** Size of each datagram (small telemetry-like datagrams) */
+#define TEST_DATAGRAM_SIZE  64
+/** Number of datagrams sent before receiving them again */
+#define TEST_BURST          LWIP_MIN(16, MEMP_NUM_NETBUF)
+#define TEST_RXTIMEOUT_MS   100
+
+struct test_settings {
+  struct sockaddr_storage addr;
+  u32_t num_datagrams;
+};
+
+static u8_t test_txbuf[TEST_BURST][TEST_DATAGRAM_SIZE];
+static u8_t test_rxbuf[TEST_BURST][TEST_DATAGRAM_SIZE];
+
+static int
+sockets_mmsg_bench_open(struct sockaddr_storage *addr, socklen_t *addr_size)
+{
+  int s, ret;
+#if LWIP_SO_RCVTIMEO
+#if LWIP_SO_SNDRCVTIMEO_NONSTANDARD
+  int tv = TEST_RXTIMEOUT_MS;
+#else
+  struct timeval tv;
+  tv.tv_sec = 0;
+  tv.tv_usec = TEST_RXTIMEOUT_MS * 1000;
+#endif
+#endif /* LWIP_SO_RCVTIMEO */
+
+  s = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  LWIP_ASSERT("s >= 0", s >= 0);
+
+  memset(addr, 0, sizeof(*addr));
+  ((struct sockaddr_in *)addr)->sin_family = AF_INET;
+  ((struct sockaddr_in *)addr)->sin_addr.s_addr = PP_HTONL(INADDR_LOOPBACK);
+  *addr_size = sizeof(struct sockaddr_in);
+  ret = lwip_bind(s, (struct sockaddr *)addr, *addr_size);
+  LWIP_ASSERT("bind failed", ret == 0);
+  ret = lwip_getsockname(s, (struct sockaddr *)addr, addr_size);
+  LWIP_ASSERT("getsockname failed", ret == 0);
+#if LWIP_SO_RCVTIMEO
+  ret = lwip_setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  LWIP_ASSERT("setsockopt failed", ret == 0);
+#endif /* LWIP_SO_RCVTIMEO */
+  LWIP_UNUSED_ARG(ret);
+  return s;
+}
+
+/* one datagram per call */
+static u32_t
+sockets_mmsg_bench_single(int s, const struct sockaddr_storage *addr, socklen_t addr_size, u32_t num)
+{
+  u32_t done = 0, lost = 0;
+  while (done + lost < num) {
+    int i;
+    for (i = 0; i < TEST_BURST; i++) {
+      ssize_t ret = lwip_sendto(s, test_txbuf[i], TEST_DATAGRAM_SIZE, 0, (const struct sockaddr *)addr, addr_size);
+      LWIP_ASSERT("sendto failed", ret == TEST_DATAGRAM_SIZE);
+      LWIP_UNUSED_ARG(ret);
+    }
+    for (i = 0; i < TEST_BURST; i++) {
+      ssize_t ret = lwip_recvfrom(s, test_rxbuf[i], TEST_DATAGRAM_SIZE, 0, NULL, NULL);
+      if (ret != TEST_DATAGRAM_SIZE) {
+        lost += (u32_t)(TEST_BURST - i);
+        break;
+      }
+      done++;
+    }
+  }
+  return lost;
+}
+
+/* a whole burst per call */
+static u32_t
+sockets_mmsg_bench_batch(int s, struct sockaddr_storage *addr, socklen_t addr_size, u32_t num)
+{
+  struct mmsghdr smsgs[TEST_BURST];
+  struct mmsghdr rmsgs[TEST_BURST];
+  struct iovec siovs[TEST_BURST];
+  struct iovec riovs[TEST_BURST];
+  u32_t done = 0, lost = 0;
+  int i;
+
+  memset(smsgs, 0, sizeof(smsgs));
+  memset(rmsgs, 0, sizeof(rmsgs));
+  for (i = 0; i < TEST_BURST; i++) {
+    siovs[i].iov_base = test_txbuf[i];
+    siovs[i].iov_len = TEST_DATAGRAM_SIZE;
+    smsgs[i].msg_hdr.msg_iov = &siovs[i];
+    smsgs[i].msg_hdr.msg_iovlen = 1;
+    smsgs[i].msg_hdr.msg_name = addr;
+    smsgs[i].msg_hdr.msg_namelen = addr_size;
+    riovs[i].iov_base = test_rxbuf[i];
+    riovs[i].iov_len = TEST_DATAGRAM_SIZE;
+    rmsgs[i].msg_hdr.msg_iov = &riovs[i];
+    rmsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  while (done + lost < num) {
+    int received = 0;
+    int ret = lwip_sendmmsg(s, smsgs, TEST_BURST, 0);
+    LWIP_ASSERT("sendmmsg failed", ret == TEST_BURST);
+    while (received < TEST_BURST) {
+      ret = lwip_recvmmsg(s, &rmsgs[received], (unsigned int)(TEST_BURST - received), MSG_WAITFORONE);
+      if (ret <= 0) {
+        lost += (u32_t)(TEST_BURST - received);
+        break;
+      }
+      received += ret;
+    }
+    done += (u32_t)received;
+  }
+  return lost;
+}
+
+static void
+sockets_mmsg_bench_report(const char *name, u32_t num, u32_t ms, u32_t lost)
+{
+  u32_t received = num - lost;
+  printf("%-18s %"U32_F" datagrams in %"U32_F" ms (%"U32_F" lost): %"U32_F" datagrams/s, %"U32_F" ns/datagram\n",
+         name, num, ms, lost, (u32_t)((u64_t)received * 1000 / ms),
+         received ? (u32_t)((u64_t)ms * 1000000 / received) : 0);
+}
+
+void
+sockets_mmsg_bench_loopback(u32_t num_datagrams)
+{
+  struct sockaddr_storage addr;
+  socklen_t addr_size;
+  u32_t start, ms, lost;
+  int s, i;
+
+  for (i = 0; i < TEST_BURST; i++) {
+    memset(test_txbuf[i], i, TEST_DATAGRAM_SIZE);
+  }
+  s = sockets_mmsg_bench_open(&addr, &addr_size);
+
+  start = sys_now();
+  lost = sockets_mmsg_bench_single(s, &addr, addr_size, num_datagrams);
+  ms = LWIP_MAX(sys_now() - start, 1);
+  sockets_mmsg_bench_report("sendto/recvfrom:", num_datagrams, ms, lost);
+
+  start = sys_now();
+  lost = sockets_mmsg_bench_batch(s, &addr, addr_size, num_datagrams);
+  ms = LWIP_MAX(sys_now() - start, 1);
+  sockets_mmsg_bench_report("sendmmsg/recvmmsg:", num_datagrams, ms, lost);
+
+  lwip_close(s);
+}
+
+static void
+sockets_mmsg_bench_thread(void *arg)
+{
+  struct test_settings *settings = (struct test_settings *)arg;
+
+  sockets_mmsg_bench_loopback(settings->num_datagrams);
+  mem_free(settings);
+}
+
+void
+sockets_mmsg_bench_init_loopback(int addr_family, u32_t num_datagrams)
+{
+  sys_thread_t t;
+  struct test_settings *settings = (struct test_settings *)mem_malloc(sizeof(struct test_settings));
+
+  LWIP_ASSERT("OOM", settings != NULL);
+  LWIP_ASSERT("invalid addr_family", addr_family == AF_INET);
+  LWIP_UNUSED_ARG(addr_family);
+  memset(settings, 0, sizeof(struct test_settings));
+  settings->num_datagrams = num_datagrams;
+
+  t = sys_thread_new("sockets_mmsg_bench", sockets_mmsg_bench_thread, settings, 0, 0);
+  LWIP_ASSERT("thread != NULL", t != 0);
+  LWIP_UNUSED_ARG(t);
+}
+
+#else /* LWIP_SOCKET && LWIP_SOCKET_MMSG && LWIP_IPV4 */
+
+void
+sockets_mmsg_bench_loopback(u32_t num_datagrams)
+{
+  LWIP_UNUSED_ARG(num_datagrams);
+}
+
+void
+sockets_mmsg_bench_init_loopback(int addr_family, u32_t num_datagrams)
+{
+  LWIP_UNUSED_ARG(addr_family);
+  LWIP_UNUSED_ARG(num_datagrams);
+}
+
+#endif /* LWIP_SOCKET && LWIP_SOCKET_MMSG && LWIP_IPV4 */
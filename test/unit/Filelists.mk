@@ -33,9 +33,11 @@ TESTDIR=$(LWIPDIR)/../test/unit
 TESTFILES=$(TESTDIR)/lwip_unittests.c \
 	$(TESTDIR)/api/test_sockets.c \
 	$(TESTDIR)/arch/sys_arch.c \
+	$(TESTDIR)/bridgeif/test_bridgeif.c \
 	$(TESTDIR)/core/test_def.c \
 	$(TESTDIR)/core/test_dns.c \
 	$(TESTDIR)/core/test_mem.c \
+	$(TESTDIR)/core/test_memp.c \
 	$(TESTDIR)/core/test_netif.c \
 	$(TESTDIR)/core/test_pbuf.c \
 	$(TESTDIR)/core/test_timers.c \
@@ -104,6 +104,40 @@ START_TEST(test_sockets_basics)
 }
 END_TEST
 
+/* Verify the socket table reuses freed descriptors last-in first-out */
+START_TEST(test_sockets_table)
+{
+  int s[NUM_SOCKETS];
+  int i, j, ret;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    s[i] = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    fail_unless(s[i] >= LWIP_SOCKET_OFFSET);
+    fail_unless(s[i] < LWIP_SOCKET_OFFSET + NUM_SOCKETS);
+    fail_unless(lwip_socket_dbg_get_socket(s[i]) != NULL);
+    for (j = 0; j < i; j++) {
+      fail_unless(s[i] != s[j]);
+    }
+  }
+
+  /* the most recently freed descriptor is handed out first */
+  ret = lwip_close(s[1]);
+  fail_unless(ret == 0);
+  ret = lwip_close(s[NUM_SOCKETS - 1]);
+  fail_unless(ret == 0);
+  ret = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  fail_unless(ret == s[NUM_SOCKETS - 1]);
+  ret = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+  fail_unless(ret == s[1]);
+
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    ret = lwip_close(s[i]);
+    fail_unless(ret == 0);
+  }
+}
+END_TEST
+
 static void test_sockets_allfunctions_basic_domain(int domain)
 {
   int s, s2, s3, ret;
@@ -649,6 +683,253 @@ START_TEST(test_sockets_msgapis)
 }
 END_TEST
 
+START_TEST(test_sockets_mmsg)
+{
+#if LWIP_SOCKET_MMSG && LWIP_IPV4
+  int s, ret, i;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct mmsghdr smsgs[LWIP_SOCKET_MMSG_BATCH + 2];
+  struct mmsghdr rmsgs[LWIP_SOCKET_MMSG_BATCH + 4];
+  struct iovec siovs[LWIP_SOCKET_MMSG_BATCH + 2];
+  struct iovec riovs[LWIP_SOCKET_MMSG_BATCH + 4];
+  u8_t snd_buf[LWIP_SOCKET_MMSG_BATCH + 2][16];
+  u8_t rcv_buf[LWIP_SOCKET_MMSG_BATCH + 4][16];
+  const int num = LWIP_SOCKET_MMSG_BATCH + 2;
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+
+  s = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s >= 0);
+  ret = lwip_bind(s, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  /* more datagrams than fit into one batch, each with a different length */
+  memset(smsgs, 0, sizeof(smsgs));
+  for (i = 0; i < num; i++) {
+    memset(snd_buf[i], i, sizeof(snd_buf[i]));
+    siovs[i].iov_base = snd_buf[i];
+    siovs[i].iov_len = (size_t)(i + 1);
+    smsgs[i].msg_hdr.msg_iov = &siovs[i];
+    smsgs[i].msg_hdr.msg_iovlen = 1;
+    smsgs[i].msg_hdr.msg_name = &addr_storage;
+    smsgs[i].msg_hdr.msg_namelen = addr_size;
+  }
+  ret = lwip_sendmmsg(s, smsgs, (unsigned int)num, 0);
+  fail_unless(ret == num);
+  for (i = 0; i < num; i++) {
+    fail_unless(smsgs[i].msg_len == (unsigned int)(i + 1));
+  }
+  while (tcpip_thread_poll_one());
+
+  memset(rmsgs, 0, sizeof(rmsgs));
+  memset(rcv_buf, 0xff, sizeof(rcv_buf));
+  for (i = 0; i < num + 2; i++) {
+    riovs[i].iov_base = rcv_buf[i];
+    riovs[i].iov_len = sizeof(rcv_buf[i]);
+    rmsgs[i].msg_hdr.msg_iov = &riovs[i];
+    rmsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ret = lwip_recvmmsg(s, rmsgs, (unsigned int)(num + 2), MSG_DONTWAIT);
+  fail_unless(ret == num);
+  for (i = 0; i < num; i++) {
+    fail_unless(rmsgs[i].msg_len == (unsigned int)(i + 1));
+    fail_unless(!memcmp(rcv_buf[i], snd_buf[i], (size_t)(i + 1)));
+  }
+
+  /* nothing left: fails like recvmsg */
+  ret = lwip_recvmmsg(s, rmsgs, 1, MSG_DONTWAIT);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+
+  ret = lwip_close(s);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif
+}
+END_TEST
+
+#if LWIP_SOCKET_ZEROCOPY && LWIP_IPV4
+/* read one MSG_ERRQUEUE notification, returns 0 if there was one */
+static int
+test_sockets_zerocopy_notification(int s, u32_t *lo, u32_t *hi, u8_t *code)
+{
+  struct msghdr msg;
+  u8_t ctrl[CMSG_SPACE(sizeof(struct sock_extended_err))];
+  struct cmsghdr *chdr;
+  struct sock_extended_err ee;
+  int ret;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = ctrl;
+  msg.msg_controllen = sizeof(ctrl);
+  ret = lwip_recvmsg(s, &msg, MSG_ERRQUEUE);
+  if (ret != 0) {
+    fail_unless(ret == -1);
+    fail_unless(errno == EAGAIN);
+    return -1;
+  }
+  fail_unless(msg.msg_flags == MSG_ERRQUEUE);
+  chdr = CMSG_FIRSTHDR(&msg);
+  fail_unless(chdr != NULL);
+  fail_unless(chdr->cmsg_level == IPPROTO_IP);
+  fail_unless(chdr->cmsg_type == IP_RECVERR);
+  memcpy(&ee, CMSG_DATA(chdr), sizeof(ee));
+  fail_unless(ee.ee_errno == 0);
+  fail_unless(ee.ee_origin == SO_EE_ORIGIN_ZEROCOPY);
+  *lo = ee.ee_info;
+  *hi = ee.ee_data;
+  *code = ee.ee_code;
+  return 0;
+}
+
+/* receive everything s2 has and let the ACKs reach s1 */
+static void
+test_sockets_zerocopy_drain(int s2, u8_t *rcv_buf, size_t len)
+{
+  ssize_t ret;
+  size_t off = 0;
+
+  while (tcpip_thread_poll_one());
+  while (off < len) {
+    ret = lwip_recv(s2, rcv_buf + off, len - off, MSG_DONTWAIT);
+    fail_unless(ret > 0);
+    off += (size_t)ret;
+    while (tcpip_thread_poll_one());
+  }
+  /* flush delayed ACKs */
+  tcp_fasttmr();
+  while (tcpip_thread_poll_one());
+}
+#endif /* LWIP_SOCKET_ZEROCOPY && LWIP_IPV4 */
+
+/* Test MSG_ZEROCOPY sends and their MSG_ERRQUEUE completion notifications */
+START_TEST(test_sockets_zerocopy)
+{
+#if LWIP_SOCKET_ZEROCOPY && LWIP_IPV4
+  #define ZC_SZ (4 * TCP_MSS)
+  int listnr, s1, s2, ret, i;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  u8_t *snd_buf, *rcv_buf;
+  u32_t lo, hi;
+  u8_t code;
+  struct msghdr msg;
+  u8_t small_ctrl[sizeof(struct cmsghdr)];
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+
+  listnr = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(listnr >= 0);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_STREAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(listnr, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_listen(listnr, 0);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(listnr, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_connect(s1, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == -1);
+  fail_unless(errno == EINPROGRESS);
+  while (tcpip_thread_poll_one());
+  s2 = lwip_accept(listnr, NULL, NULL);
+  fail_unless(s2 >= 0);
+  ret = lwip_close(listnr);
+  fail_unless(ret == 0);
+
+  snd_buf = (u8_t*)mem_malloc(ZC_SZ);
+  fail_unless(snd_buf != NULL);
+  rcv_buf = (u8_t*)mem_malloc(ZC_SZ);
+  fail_unless(rcv_buf != NULL);
+  for (i = 0; i < ZC_SZ; i++) {
+    snd_buf[i] = (u8_t)i;
+  }
+
+  /* nothing sent yet */
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == -1);
+
+  /* the data is referenced by the queued segments until they are acked */
+  ret = lwip_send(s1, snd_buf, ZC_SZ, MSG_ZEROCOPY);
+  fail_unless(ret == ZC_SZ);
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == -1);
+
+  memset(rcv_buf, 0, ZC_SZ);
+  test_sockets_zerocopy_drain(s2, rcv_buf, ZC_SZ);
+  fail_unless(!memcmp(snd_buf, rcv_buf, ZC_SZ));
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == 0);
+  fail_unless(lo == 0);
+  fail_unless(hi == 0);
+  fail_unless(code == 0);
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == -1);
+
+  /* completions of consecutive sends are merged into one range */
+  ret = lwip_send(s1, snd_buf, ZC_SZ / 2, MSG_ZEROCOPY);
+  fail_unless(ret == ZC_SZ / 2);
+  ret = lwip_send(s1, snd_buf + ZC_SZ / 2, ZC_SZ / 2, MSG_ZEROCOPY);
+  fail_unless(ret == ZC_SZ / 2);
+  memset(rcv_buf, 0, ZC_SZ);
+  test_sockets_zerocopy_drain(s2, rcv_buf, ZC_SZ);
+  fail_unless(!memcmp(snd_buf, rcv_buf, ZC_SZ));
+
+  /* too little control space: the notification is kept */
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_control = small_ctrl;
+  msg.msg_controllen = sizeof(small_ctrl);
+  ret = lwip_recvmsg(s1, &msg, MSG_ERRQUEUE);
+  fail_unless(ret == 0);
+  fail_unless(msg.msg_flags == (MSG_ERRQUEUE | MSG_CTRUNC));
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == 0);
+  fail_unless(lo == 1);
+  fail_unless(hi == 2);
+
+  /* a send failing after part of the data has been enqueued still gets an
+     id: the queued part references the buffer (no route: tcp_output fails) */
+  netif_set_down(netif_get_loopif());
+  ret = lwip_send(s1, snd_buf, ZC_SZ / 2, MSG_ZEROCOPY);
+  fail_unless(ret == -1);
+  fail_unless(errno == EHOSTUNREACH);
+  netif_set_up(netif_get_loopif());
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == -1);
+  ret = lwip_send(s1, snd_buf + ZC_SZ / 2, ZC_SZ / 2, MSG_ZEROCOPY);
+  fail_unless(ret == ZC_SZ / 2);
+  memset(rcv_buf, 0, ZC_SZ);
+  test_sockets_zerocopy_drain(s2, rcv_buf, ZC_SZ);
+  fail_unless(!memcmp(snd_buf, rcv_buf, ZC_SZ));
+  ret = test_sockets_zerocopy_notification(s1, &lo, &hi, &code);
+  fail_unless(ret == 0);
+  fail_unless(lo == 3);
+  fail_unless(hi == 4);
+
+  /* closing with data in flight must not leak the completion state */
+  ret = lwip_send(s1, snd_buf, ZC_SZ, MSG_ZEROCOPY);
+  fail_unless(ret == ZC_SZ);
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+  while (tcpip_thread_poll_one());
+
+  mem_free(snd_buf);
+  mem_free(rcv_buf);
+  #undef ZC_SZ
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif
+}
+END_TEST
+
 START_TEST(test_sockets_select)
 {
 #if LWIP_SOCKET_SELECT
@@ -685,6 +966,127 @@ START_TEST(test_sockets_select)
 }
 END_TEST
 
+START_TEST(test_sockets_epoll)
+{
+#if LWIP_SOCKET_EPOLL && LWIP_IPV4
+  int s, ep, ret;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct epoll_event ev;
+  struct epoll_event events[4];
+  u8_t buf[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+  LWIP_UNUSED_ARG(_i);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr_storage, &addr_size);
+
+  s = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s >= 0);
+  ret = lwip_bind(s, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  ep = lwip_epoll_create(1);
+  fail_unless(ep >= 0);
+
+  /* level-triggered: reported as long as data is pending */
+  ev.events = EPOLLIN;
+  ev.data.fd = s;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s, &ev);
+  fail_unless(ret == -1);
+  fail_unless(errno == EEXIST);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  ret = lwip_sendto(s, buf, sizeof(buf), 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLIN);
+  fail_unless(events[0].data.fd == s);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_recv(s, buf, sizeof(buf), 0);
+  fail_unless(ret == sizeof(buf));
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  /* edge-triggered: reported once per arriving datagram */
+  ev.events = EPOLLIN | EPOLLET;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_sendto(s, buf, sizeof(buf), 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_sendto(s, buf, sizeof(buf), 0, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_recv(s, buf, sizeof(buf), 0);
+  fail_unless(ret == sizeof(buf));
+  ret = lwip_recv(s, buf, sizeof(buf), 0);
+  fail_unless(ret == sizeof(buf));
+
+  /* oneshot: disarmed after the first report until EPOLL_CTL_MOD */
+  ev.events = EPOLLOUT | EPOLLONESHOT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless(events[0].events == EPOLLOUT);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 1);
+
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s, NULL);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == ENOENT);
+
+  /* closing a socket removes it from the interest set */
+  ev.events = EPOLLOUT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_close(s);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+
+  ret = lwip_close(ep);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+  ret = lwip_close(ep);
+  fail_unless(ret == -1);
+  fail_unless(errno == EBADF);
+
+  /* the closed instance is free again */
+  ret = lwip_epoll_create(1);
+  fail_unless(ret == ep);
+  ret = lwip_epoll_wait(ep, events, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_close(ep);
+  fail_unless(ret == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif
+}
+END_TEST
+
 START_TEST(test_sockets_recv_after_rst)
 {
   int sl, sact;
@@ -834,9 +1236,13 @@ sockets_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_sockets_basics),
+    TESTFUNC(test_sockets_table),
     TESTFUNC(test_sockets_allfunctions_basic),
     TESTFUNC(test_sockets_msgapis),
+    TESTFUNC(test_sockets_mmsg),
+    TESTFUNC(test_sockets_zerocopy),
     TESTFUNC(test_sockets_select),
+    TESTFUNC(test_sockets_epoll),
     TESTFUNC(test_sockets_recv_after_rst),
   };
   return create_suite("SOCKETS", tests, sizeof(tests)/sizeof(testfunc), sockets_setup, sockets_teardown);
@@ -0,0 +1,399 @@
+#include "test_bridgeif.h"
+
+#include "netif/bridgeif.h"
+#include "lwip/mem.h"
+#include "lwip/timeouts.h"
+#include "lwip/tcpip.h"
+#include "netif/ethernet.h"
+#include "arch/sys_arch.h"
+
+/* BR_FDB_TIMEOUT_SEC of bridgeif_fdb.c */
+#define TEST_FDB_TIMEOUT_SEC (60*5)
+
+/* Setups/teardown functions */
+
+static struct sys_timeo *old_list_head;
+/* the FDB under test, freed after each test */
+static void *fdb;
+
+#if BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#define TEST_NUM_PORTS 3
+static struct netif test_br, test_ports[TEST_NUM_PORTS];
+static int test_br_added;
+static int test_port_tx[TEST_NUM_PORTS];
+static int test_br_rx;
+#endif /* BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+
+static void
+bridgeif_setup(void)
+{
+  /* run the FDB aging timer alone */
+  struct sys_timeo **list_head = sys_timeouts_get_next_timeout();
+  old_list_head = *list_head;
+  *list_head = NULL;
+  lwip_sys_now = 0;
+}
+
+static void
+bridgeif_teardown(void)
+{
+  struct sys_timeo **list_head = sys_timeouts_get_next_timeout();
+  while (*list_head != NULL) {
+    sys_untimeout((*list_head)->h, (*list_head)->arg);
+  }
+  *list_head = old_list_head;
+  lwip_sys_now = 0;
+#if BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+  if (test_br_added) {
+    int i;
+    for (i = 0; i < TEST_NUM_PORTS; i++) {
+      netif_remove(&test_ports[i]);
+    }
+    netif_remove(&test_br);
+    /* bridgeif cannot be removed: free its private data, the FDB is 'fdb' */
+    mem_free(test_br.state);
+    test_br_added = 0;
+  }
+#endif /* BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+  if (fdb != NULL) {
+    mem_free(fdb);
+    fdb = NULL;
+  }
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+/* Helper functions */
+
+/* station 'n' (02:00:00:00:xx:xx) */
+static struct eth_addr *
+test_fdb_station(u16_t n)
+{
+  static struct eth_addr addr;
+  addr.addr[0] = 0x02;
+  addr.addr[1] = addr.addr[2] = addr.addr[3] = 0;
+  addr.addr[4] = (u8_t)(n >> 8);
+  addr.addr[5] = (u8_t)n;
+  return &addr;
+}
+
+static void
+test_fdb_learn(u16_t n, u16_t vid, u8_t port)
+{
+#if BRIDGEIF_FDB_VLAN
+  bridgeif_fdb_update_src(fdb, test_fdb_station(n), vid, port);
+#else /* BRIDGEIF_FDB_VLAN */
+  LWIP_UNUSED_ARG(vid);
+  bridgeif_fdb_update_src(fdb, test_fdb_station(n), port);
+#endif /* BRIDGEIF_FDB_VLAN */
+}
+
+static bridgeif_portmask_t
+test_fdb_lookup(u16_t n, u16_t vid)
+{
+#if BRIDGEIF_FDB_VLAN
+  return bridgeif_fdb_get_dst_ports(fdb, test_fdb_station(n), vid);
+#else /* BRIDGEIF_FDB_VLAN */
+  LWIP_UNUSED_ARG(vid);
+  return bridgeif_fdb_get_dst_ports(fdb, test_fdb_station(n));
+#endif /* BRIDGEIF_FDB_VLAN */
+}
+
+/* let the aging timer run for 'sec' seconds */
+static void
+test_fdb_age(u32_t sec)
+{
+  for (; sec > 0; sec--) {
+    lwip_sys_now += 1000;
+    sys_check_timeouts();
+  }
+}
+
+/* Test functions */
+
+START_TEST(test_bridgeif_fdb_learn)
+{
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(64);
+  fail_unless(fdb != NULL);
+
+  fail_unless(test_fdb_lookup(1, 0) == BR_FLOOD);
+  /* more stations than one per hash chain on average */
+  for (i = 0; i < 64; i++) {
+    test_fdb_learn(i, 0, (u8_t)(i % BRIDGEIF_MAX_PORTS));
+  }
+  for (i = 0; i < 64; i++) {
+    fail_unless(test_fdb_lookup(i, 0) == (bridgeif_portmask_t)(1 << (i % BRIDGEIF_MAX_PORTS)));
+  }
+  fail_unless(test_fdb_lookup(64, 0) == BR_FLOOD);
+
+  /* a station moving to another port is found there, without a new entry */
+  test_fdb_learn(5, 0, 3);
+  fail_unless(test_fdb_lookup(5, 0) == (1 << 3));
+  test_fdb_learn(5, 0, 5);
+  fail_unless(test_fdb_lookup(5, 0) == (1 << 5));
+  for (i = 0; i < 64; i++) {
+    if (i != 5) {
+      fail_unless(test_fdb_lookup(i, 0) == (bridgeif_portmask_t)(1 << (i % BRIDGEIF_MAX_PORTS)));
+    }
+  }
+
+}
+END_TEST
+
+START_TEST(test_bridgeif_fdb_full)
+{
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(4);
+  fail_unless(fdb != NULL);
+
+  for (i = 0; i < 4; i++) {
+    test_fdb_learn(i, 0, 1);
+  }
+  /* a moved station keeps its entry */
+  test_fdb_learn(0, 0, 2);
+  /* no free entry: unknown stations are flooded, the known ones stay */
+  test_fdb_learn(4, 0, 1);
+  fail_unless(test_fdb_lookup(4, 0) == BR_FLOOD);
+  fail_unless(test_fdb_lookup(0, 0) == (1 << 2));
+  for (i = 1; i < 4; i++) {
+    fail_unless(test_fdb_lookup(i, 0) == (1 << 1));
+  }
+
+  /* once expired entries are swept, there is room again */
+  test_fdb_age(TEST_FDB_TIMEOUT_SEC + 16);
+  test_fdb_learn(4, 0, 3);
+  fail_unless(test_fdb_lookup(4, 0) == (1 << 3));
+
+}
+END_TEST
+
+START_TEST(test_bridgeif_fdb_expire)
+{
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* 64 entries: the sweep frees expired ones from 4 entries per second */
+  fdb = bridgeif_fdb_init(64);
+  fail_unless(fdb != NULL);
+
+  for (i = 0; i < 64; i++) {
+    test_fdb_learn(i, 0, 1);
+  }
+  /* seen again later: station 40 expires after the others */
+  test_fdb_age(10);
+  test_fdb_learn(40, 0, 2);
+
+  test_fdb_age(TEST_FDB_TIMEOUT_SEC - 10 - 1);
+  for (i = 0; i < 64; i++) {
+    fail_unless(test_fdb_lookup(i, 0) != BR_FLOOD);
+  }
+  /* expired entries are ignored at once, before the sweep frees them */
+  test_fdb_age(1);
+  for (i = 0; i < 64; i++) {
+    fail_unless(test_fdb_lookup(i, 0) == ((i == 40) ? (1 << 2) : BR_FLOOD));
+  }
+  /* an expired station seen again before the sweep is back */
+  test_fdb_learn(63, 0, 3);
+  fail_unless(test_fdb_lookup(63, 0) == (1 << 3));
+  test_fdb_age(10);
+  fail_unless(test_fdb_lookup(40, 0) == BR_FLOOD);
+
+  /* after a full sweep, all expired entries are free again */
+  test_fdb_age(16);
+  for (i = 100; i < 163; i++) {
+    test_fdb_learn(i, 0, 4);
+  }
+  for (i = 100; i < 163; i++) {
+    fail_unless(test_fdb_lookup(i, 0) == (1 << 4));
+  }
+  fail_unless(test_fdb_lookup(63, 0) == (1 << 3));
+  test_fdb_learn(163, 0, 4);
+  fail_unless(test_fdb_lookup(163, 0) == BR_FLOOD);
+
+}
+END_TEST
+
+#if BRIDGEIF_FDB_VLAN
+START_TEST(test_bridgeif_fdb_vlan)
+{
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(8);
+  fail_unless(fdb != NULL);
+
+  /* the same station is learnt independently per VLAN */
+  test_fdb_learn(1, 10, 1);
+  test_fdb_learn(1, 20, 2);
+  fail_unless(test_fdb_lookup(1, 10) == (1 << 1));
+  fail_unless(test_fdb_lookup(1, 20) == (1 << 2));
+  fail_unless(test_fdb_lookup(1, 0) == BR_FLOOD);
+  fail_unless(test_fdb_lookup(1, 30) == BR_FLOOD);
+
+  /* moving in one VLAN leaves the other one alone */
+  test_fdb_learn(1, 10, 3);
+  fail_unless(test_fdb_lookup(1, 10) == (1 << 3));
+  fail_unless(test_fdb_lookup(1, 20) == (1 << 2));
+
+}
+END_TEST
+#endif /* BRIDGEIF_FDB_VLAN */
+
+#if BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+static err_t
+test_port_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(p);
+  fail_unless((netif >= &test_ports[0]) && (netif < &test_ports[TEST_NUM_PORTS]));
+  test_port_tx[netif - test_ports]++;
+  return ERR_OK;
+}
+
+static err_t
+test_port_init(struct netif *netif)
+{
+  netif->linkoutput = test_port_linkoutput;
+  netif->mtu = 1500;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_LINK_UP;
+  return ERR_OK;
+}
+
+/* input function of the bridge netif: frames for the cpu port */
+static err_t
+test_br_input(struct pbuf *p, struct netif *netif)
+{
+  LWIP_UNUSED_ARG(netif);
+  test_br_rx++;
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/* Pass a frame from 'src' to 'dst' to the input function of port 'port' */
+static void
+test_port_input(int port, const struct eth_addr *dst, const struct eth_addr *src)
+{
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+  u8_t *frame;
+
+  fail_unless(p != NULL);
+  frame = (u8_t *)p->payload;
+  memset(frame, 0, p->len);
+  SMEMCPY(frame, dst, ETH_HWADDR_LEN);
+  SMEMCPY(frame + ETH_HWADDR_LEN, src, ETH_HWADDR_LEN);
+  frame[12] = 0x08;
+  memset(test_port_tx, 0, sizeof(test_port_tx));
+  test_br_rx = 0;
+  fail_unless(test_ports[port].input(p, &test_ports[port]) == ERR_OK);
+}
+
+static int
+test_port_tx_mask(void)
+{
+  int i, mask = 0;
+  for (i = 0; i < TEST_NUM_PORTS; i++) {
+    fail_unless(test_port_tx[i] <= 1);
+    if (test_port_tx[i]) {
+      mask |= 1 << i;
+    }
+  }
+  return mask;
+}
+
+START_TEST(test_bridgeif_fast_path)
+{
+  static const struct eth_addr sta_a = ETH_ADDR(0x02, 0, 0, 0, 0, 0x0a);
+  static const struct eth_addr sta_b = ETH_ADDR(0x02, 0, 0, 0, 0, 0x0b);
+  static const struct eth_addr sta_c = ETH_ADDR(0x02, 0, 0, 0, 0, 0x0c);
+  static const struct eth_addr group = ETH_ADDR(0x01, 0x00, 0x5e, 0, 0, 0x01);
+  bridgeif_initdata_t br_init = BRIDGEIF_INITDATA1(TEST_NUM_PORTS, 16, 1, ETH_ADDR(0x02, 0, 0, 0, 0, 0xb0));
+  struct sys_timeo **list_head = sys_timeouts_get_next_timeout();
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(netif_add_noaddr(&test_br, &br_init, bridgeif_init, test_br_input) == &test_br);
+  test_br_added = 1;
+  /* the only timeout is the aging timer of the bridge FDB */
+  fail_unless((*list_head != NULL) && ((*list_head)->next == NULL));
+  fdb = (*list_head)->arg;
+  for (i = 0; i < TEST_NUM_PORTS; i++) {
+    fail_unless(netif_add_noaddr(&test_ports[i], NULL, test_port_init, netif_input) == &test_ports[i]);
+    fail_unless(bridgeif_add_port(&test_br, &test_ports[i]) == ERR_OK);
+  }
+
+  /* unknown station: flooded to the other ports by tcpip_thread */
+  test_port_input(0, &sta_a, &sta_b);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(test_port_tx_mask() == ((1 << 1) | (1 << 2)));
+  fail_unless(test_br_rx == 0);
+
+  /* known unicast (b learnt on port 0) is switched right away */
+  test_port_input(2, &sta_b, &sta_a);
+  fail_unless(test_port_tx_mask() == (1 << 0));
+  fail_unless(!tcpip_thread_poll_one());
+  /* ... both ways (a learnt on port 2 by the fast path) */
+  test_port_input(0, &sta_a, &sta_b);
+  fail_unless(test_port_tx_mask() == (1 << 2));
+  fail_unless(!tcpip_thread_poll_one());
+
+  /* known on the RX port: not sent back */
+  test_port_input(0, &sta_b, &sta_c);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(!tcpip_thread_poll_one());
+  fail_unless(test_br_rx == 0);
+
+  /* group addresses are flooded and passed to the cpu port by tcpip_thread */
+  test_port_input(1, &group, &sta_c);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(test_port_tx_mask() == ((1 << 0) | (1 << 2)));
+  fail_unless(test_br_rx == 1);
+  test_port_input(1, &ethbroadcast, &sta_c);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(test_port_tx_mask() == ((1 << 0) | (1 << 2)));
+  fail_unless(test_br_rx == 1);
+  /* ... also with a static entry for one port */
+  fail_unless(bridgeif_fdb_add(&test_br, &group, 1 << 2) == ERR_OK);
+  test_port_input(1, &group, &sta_c);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(test_port_tx_mask() == (1 << 2));
+  fail_unless(test_br_rx == 0);
+
+  /* frames for the bridge itself go to the cpu port only, even when its
+     address was seen on a port (a frame looped back) */
+  test_port_input(2, &sta_a, (const struct eth_addr *)test_br.hwaddr);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(!tcpip_thread_poll_one());
+  test_port_input(1, (const struct eth_addr *)test_br.hwaddr, &sta_c);
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(test_br_rx == 0);
+  fail_unless(tcpip_thread_poll_one());
+  fail_unless(test_port_tx_mask() == 0);
+  fail_unless(test_br_rx == 1);
+}
+END_TEST
+#endif /* BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+
+/** Create the suite including all tests for this module */
+Suite *
+bridgeif_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_bridgeif_fdb_learn),
+    TESTFUNC(test_bridgeif_fdb_full),
+    TESTFUNC(test_bridgeif_fdb_expire),
+#if BRIDGEIF_FDB_VLAN
+    TESTFUNC(test_bridgeif_fdb_vlan),
+#endif /* BRIDGEIF_FDB_VLAN */
+#if BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+    TESTFUNC(test_bridgeif_fast_path),
+#endif /* BRIDGEIF_PORT_NETIFS_FAST_PATH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+  };
+  return create_suite("BRIDGEIF", tests, sizeof(tests)/sizeof(testfunc), bridgeif_setup, bridgeif_teardown);
+}
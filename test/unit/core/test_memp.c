@@ -0,0 +1,318 @@
+#include "test_memp.h"
+
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "arch/sys_arch.h"
+
+#if !LWIP_STATS || !MEM_STATS || !MEMP_STATS
+#error "This tests needs MEM- and MEMP-statistics enabled"
+#endif
+#if !MEMP_ELASTIC || !MEMP_TELEMETRY
+#error "This tests needs MEMP_ELASTIC and MEMP_TELEMETRY enabled"
+#endif
+
+#define TEST_POOL_NUM   4
+#define TEST_POOL_DECAY_TICKS \
+  ((MEMP_ELASTIC_DECAY_MS + MEMP_ELASTIC_TMR_INTERVAL - 1) / MEMP_ELASTIC_TMR_INTERVAL)
+
+LWIP_MEMPOOL_DECLARE(TEST_ELASTIC, TEST_POOL_NUM, 32, "TEST_ELASTIC")
+
+/* Setups/teardown functions */
+
+static void
+memp_setup(void)
+{
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+  lwip_sys_now = 1000;
+  LWIP_MEMPOOL_INIT(TEST_ELASTIC);
+  memp_set_ceiling_pool(&memp_TEST_ELASTIC, TEST_POOL_NUM);
+}
+
+static void
+memp_teardown(void)
+{
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+
+/* Test functions */
+
+/** Grow a pool up to its ceiling and let the slabs decay again */
+START_TEST(test_memp_elastic_grow_decay)
+{
+  void *elem[3 * TEST_POOL_NUM];
+  mem_size_t heap_used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  heap_used = lwip_stats.mem.used;
+
+  /* the default ceiling of this test config does not allow growing */
+  for (i = 0; i < TEST_POOL_NUM; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+  }
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ELASTIC) == NULL);
+  fail_unless(lwip_stats.mem.used == heap_used);
+
+  /* raise the ceiling: the pool grows in slabs, the last one is partial */
+  memp_set_ceiling_pool(&memp_TEST_ELASTIC, 3 * TEST_POOL_NUM - 1);
+  for (i = TEST_POOL_NUM; i < 3 * TEST_POOL_NUM - 1; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+    memset(elem[i], 0xab, 32);
+  }
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ELASTIC) == NULL);
+  fail_unless(memp_TEST_ELASTIC.stats->avail == 3 * TEST_POOL_NUM - 1);
+  fail_unless(memp_TEST_ELASTIC.stats->used == 3 * TEST_POOL_NUM - 1);
+  fail_unless(lwip_stats.mem.used > heap_used);
+
+  for (i = 0; i < 3 * TEST_POOL_NUM - 1; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->used == 0);
+
+  /* slabs are kept until they were unused for MEMP_ELASTIC_DECAY_MS */
+  for (i = 0; i < TEST_POOL_DECAY_TICKS - 1; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == 3 * TEST_POOL_NUM - 1);
+  memp_decay_pool(&memp_TEST_ELASTIC);
+  fail_unless(memp_TEST_ELASTIC.stats->avail == TEST_POOL_NUM);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+/** Freed elements go back to the slab they came from */
+START_TEST(test_memp_elastic_free_to_slab)
+{
+  void *elem[4 * TEST_POOL_NUM];
+  mem_size_t heap_used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  heap_used = lwip_stats.mem.used;
+  memp_set_ceiling_pool(&memp_TEST_ELASTIC, 4 * TEST_POOL_NUM);
+  for (i = 0; i < 4 * TEST_POOL_NUM; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == 4 * TEST_POOL_NUM);
+
+  /* free the elements of the second slab (the slabs are used oldest first):
+     only that slab runs empty and decays */
+  for (i = 2 * TEST_POOL_NUM; i < 3 * TEST_POOL_NUM; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == 3 * TEST_POOL_NUM);
+
+  for (i = 0; i < 2 * TEST_POOL_NUM; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  for (i = 3 * TEST_POOL_NUM; i < 4 * TEST_POOL_NUM; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == TEST_POOL_NUM);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+/** Static elements are preferred so that slabs can run empty */
+START_TEST(test_memp_elastic_static_first)
+{
+  void *elem[2 * TEST_POOL_NUM];
+  void *slab_elem;
+  mem_size_t heap_used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  heap_used = lwip_stats.mem.used;
+  memp_set_ceiling_pool(&memp_TEST_ELASTIC, 2 * TEST_POOL_NUM);
+
+  for (i = 0; i < TEST_POOL_NUM + 1; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+  }
+  slab_elem = elem[TEST_POOL_NUM];
+
+  /* free one static element and the slab element: the static one is reused */
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[0]);
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, slab_elem);
+  elem[0] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+  fail_unless(elem[0] != NULL);
+  fail_unless(elem[0] != slab_elem);
+
+  /* the unused slab decays while the static elements are still in use */
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == TEST_POOL_NUM);
+  fail_unless(lwip_stats.mem.used == heap_used);
+
+  /* using a slab element resets its idle time */
+  elem[TEST_POOL_NUM] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+  fail_unless(elem[TEST_POOL_NUM] != NULL);
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail > TEST_POOL_NUM);
+
+  for (i = 0; i < TEST_POOL_NUM + 1; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == TEST_POOL_NUM);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+/** A slab that was fully used is taken last once it has free elements again */
+START_TEST(test_memp_elastic_refilled_slab_last)
+{
+  void *elem[2 * TEST_POOL_NUM + 1];
+  void *freed;
+  mem_size_t heap_used;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  heap_used = lwip_stats.mem.used;
+  memp_set_ceiling_pool(&memp_TEST_ELASTIC, 3 * TEST_POOL_NUM);
+
+  /* static elements, the first slab completely and one of the second slab */
+  for (i = 0; i < 2 * TEST_POOL_NUM + 1; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+  }
+
+  /* the first slab gets an element back, but the second one is used first */
+  freed = elem[TEST_POOL_NUM];
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, freed);
+  elem[TEST_POOL_NUM] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+  fail_unless(elem[TEST_POOL_NUM] != NULL);
+  fail_unless(elem[TEST_POOL_NUM] != freed);
+
+  for (i = 0; i < 2 * TEST_POOL_NUM + 1; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  for (i = 0; i < TEST_POOL_DECAY_TICKS; i++) {
+    memp_decay_pool(&memp_TEST_ELASTIC);
+  }
+  fail_unless(memp_TEST_ELASTIC.stats->avail == TEST_POOL_NUM);
+  fail_unless(lwip_stats.mem.used == heap_used);
+}
+END_TEST
+
+/** Counters, failure bursts and the lifetime histogram */
+START_TEST(test_memp_telemetry)
+{
+  void *elem[TEST_POOL_NUM];
+  struct memp_telemetry t;
+#if MEMP_OVERFLOW_CHECK
+  struct memp_telemetry_site sites[MEMP_TELEMETRY_SITES];
+  u32_t allocs = 0, fails = 0, used = 0;
+  u16_t num_sites;
+#endif /* MEMP_OVERFLOW_CHECK */
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memp_telemetry_reset();
+
+  for (i = 0; i < TEST_POOL_NUM; i++) {
+    elem[i] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+    fail_unless(elem[i] != NULL);
+  }
+
+  /* two bursts of failures */
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ELASTIC) == NULL);
+  lwip_sys_now += MEMP_TELEMETRY_BURST_GAP - 1;
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ELASTIC) == NULL);
+  lwip_sys_now += MEMP_TELEMETRY_BURST_GAP;
+  fail_unless(LWIP_MEMPOOL_ALLOC(TEST_ELASTIC) == NULL);
+
+  /* lifetimes: 2 * BURST_GAP - 1, then 0 and 1 (the last two reused) */
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[0]);
+  elem[0] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[0]);
+  elem[0] = LWIP_MEMPOOL_ALLOC(TEST_ELASTIC);
+  lwip_sys_now++;
+  LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[0]);
+
+  memp_telemetry_get_pool(&memp_TEST_ELASTIC, &t);
+  fail_unless(t.allocs == TEST_POOL_NUM + 2);
+  fail_unless(t.frees == 3);
+  fail_unless(t.fails == 3);
+  fail_unless(t.bursts[0].start == 1000);
+  fail_unless(t.bursts[0].end == 1000 + MEMP_TELEMETRY_BURST_GAP - 1);
+  fail_unless(t.bursts[0].count == 2);
+  fail_unless(t.last_burst == 1);
+  fail_unless(t.bursts[1].start == 1000 + 2 * MEMP_TELEMETRY_BURST_GAP - 1);
+  fail_unless(t.bursts[1].count == 1);
+  fail_unless(t.lifetime[0] == 1);
+  fail_unless(t.lifetime[1] == 1);
+  /* 199: [128, 256) */
+  fail_unless(t.lifetime[8] == 1);
+
+  /* the rate counts the allocations of the last complete window */
+  fail_unless(t.rate == 0);
+  lwip_sys_now += MEMP_TELEMETRY_RATE_WINDOW;
+  memp_telemetry_get_pool(&memp_TEST_ELASTIC, &t);
+  fail_unless(t.rate == TEST_POOL_NUM + 2);
+  lwip_sys_now += MEMP_TELEMETRY_RATE_WINDOW;
+  memp_telemetry_get_pool(&memp_TEST_ELASTIC, &t);
+  fail_unless(t.rate == 0);
+
+#if MEMP_OVERFLOW_CHECK
+  /* the same counts, by call site */
+  num_sites = memp_telemetry_get_sites(sites, MEMP_TELEMETRY_SITES);
+  for (i = 0; i < num_sites; i++) {
+    if (sites[i].desc == &memp_TEST_ELASTIC) {
+      allocs += sites[i].allocs;
+      fails += sites[i].fails;
+      used += sites[i].used;
+    }
+  }
+  fail_unless(allocs == TEST_POOL_NUM + 2);
+  fail_unless(fails == 3);
+  fail_unless(used == TEST_POOL_NUM - 1);
+#endif /* MEMP_OVERFLOW_CHECK */
+
+  for (i = 1; i < TEST_POOL_NUM; i++) {
+    LWIP_MEMPOOL_FREE(TEST_ELASTIC, elem[i]);
+  }
+  memp_telemetry_reset_pool(&memp_TEST_ELASTIC);
+  memp_telemetry_get_pool(&memp_TEST_ELASTIC, &t);
+  fail_unless((t.allocs == 0) && (t.frees == 0) && (t.fails == 0));
+
+#if MEMP_OVERFLOW_CHECK
+  /* resetting all pools removes the sites without allocated elements */
+  memp_telemetry_reset();
+  num_sites = memp_telemetry_get_sites(sites, MEMP_TELEMETRY_SITES);
+  for (i = 0; i < num_sites; i++) {
+    fail_unless(sites[i].used > 0);
+    fail_unless(sites[i].desc != &memp_TEST_ELASTIC);
+  }
+#endif /* MEMP_OVERFLOW_CHECK */
+}
+END_TEST
+
+/** Create the suite including all tests for this module */
+Suite *
+memp_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_memp_elastic_grow_decay),
+    TESTFUNC(test_memp_elastic_static_first),
+    TESTFUNC(test_memp_elastic_refilled_slab_last),
+    TESTFUNC(test_memp_elastic_free_to_slab),
+    TESTFUNC(test_memp_telemetry)
+  };
+  return create_suite("MEMP", tests, sizeof(tests)/sizeof(testfunc), memp_setup, memp_teardown);
+}
@@ -4,6 +4,7 @@
 #include "lwip/stats.h"
 #include "lwip/etharp.h"
 #include "netif/ethernet.h"
+#include "netif/vlanif.h"
 
 #if !LWIP_NETIF_EXT_STATUS_CALLBACK
 #error "This tests needs LWIP_NETIF_EXT_STATUS_CALLBACK enabled"
@@ -272,6 +273,231 @@ START_TEST(test_netif_find)
 }
 END_TEST
 
+#if LWIP_VLANIF
+static u8_t vlan_tx_frame[128];
+static u16_t vlan_tx_len;
+
+static err_t
+vlan_trunk_tx_func(struct netif *netif, struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(netif);
+  vlan_tx_len = pbuf_copy_partial(p, vlan_tx_frame, sizeof(vlan_tx_frame), 0);
+  return ERR_OK;
+}
+
+static err_t
+vlan_trunk_init(struct netif *netif)
+{
+  netif->name[0] = 't';
+  netif->name[1] = 'r';
+  netif->output = etharp_output;
+  netif->linkoutput = vlan_trunk_tx_func;
+  netif->mtu = 1500;
+  netif->hwaddr_len = 6;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_LINK_UP;
+  netif->hwaddr[0] = 0x02;
+  netif->hwaddr[5] = 0x01;
+  return ERR_OK;
+}
+
+/* Pass a broadcast ARP request for 10.x.y.1 with 'num_tags' tags (TPID, VID
+   pairs) to ethernet_input of 'netif' */
+static void
+vlan_arp_request_input(struct netif *netif, const u16_t *tags, int num_tags, u8_t x, u8_t y)
+{
+  struct pbuf *p;
+  u8_t *frame;
+  int i, off;
+
+  p = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+  fail_unless(p != NULL);
+  frame = (u8_t *)p->payload;
+  memset(frame, 0, 64);
+  memset(frame, 0xff, 6);
+  frame[6] = 0x02;
+  frame[11] = 0x99;
+  off = 12;
+  for (i = 0; i < num_tags; i++) {
+    frame[off++] = (u8_t)(tags[2 * i] >> 8);
+    frame[off++] = (u8_t)tags[2 * i];
+    frame[off++] = (u8_t)(tags[2 * i + 1] >> 8);
+    frame[off++] = (u8_t)tags[2 * i + 1];
+  }
+  /* ethernet type, hardware/protocol type and length, request */
+  frame[off++] = 0x08; frame[off++] = 0x06;
+  frame[off++] = 0x00; frame[off++] = 0x01;
+  frame[off++] = 0x08; frame[off++] = 0x00;
+  frame[off++] = 6; frame[off++] = 4;
+  frame[off++] = 0x00; frame[off++] = 0x01;
+  /* sender 02:00:00:00:00:99, 10.x.y.99 */
+  frame[off++] = 0x02; off += 4; frame[off++] = 0x99;
+  frame[off++] = 10; frame[off++] = x; frame[off++] = y; frame[off++] = 99;
+  /* target 10.x.y.1 */
+  off += 6;
+  frame[off++] = 10; frame[off++] = x; frame[off++] = y; frame[off++] = 1;
+
+  vlan_tx_len = 0;
+  fail_unless(ethernet_input(p, netif) == ERR_OK);
+}
+
+/* Check that the last frame sent on the trunk is an ARP reply with the tags */
+static int
+vlan_arp_reply_sent(const u16_t *tags, int num_tags)
+{
+  int i, off = 12;
+
+  if ((vlan_tx_len < 12 + 4 * num_tags + 2 + 28) || (vlan_tx_frame[0] != 0x02) ||
+      (vlan_tx_frame[5] != 0x99) || (vlan_tx_frame[6] != 0x02) || (vlan_tx_frame[11] != 0x01)) {
+    return 0;
+  }
+  for (i = 0; i < num_tags; i++, off += 4) {
+    if ((vlan_tx_frame[off] != (u8_t)(tags[2 * i] >> 8)) || (vlan_tx_frame[off + 1] != (u8_t)tags[2 * i]) ||
+        (vlan_tx_frame[off + 2] != (u8_t)(tags[2 * i + 1] >> 8)) || (vlan_tx_frame[off + 3] != (u8_t)tags[2 * i + 1])) {
+      return 0;
+    }
+  }
+  /* ARP reply */
+  return (vlan_tx_frame[off] == 0x08) && (vlan_tx_frame[off + 1] == 0x06) && (vlan_tx_frame[off + 9] == 0x02);
+}
+
+/* Sends a frame through 'vlan_down_netif' from its callback for going down */
+static struct netif *vlan_down_netif;
+static err_t vlan_down_err;
+
+static void
+vlan_down_callback(struct netif *netif, netif_nsc_reason_t reason, const netif_ext_callback_args_t *args)
+{
+  struct pbuf *p;
+
+  if ((netif != vlan_down_netif) || !(reason & LWIP_NSC_STATUS_CHANGED) || args->status_changed.state) {
+    return;
+  }
+  p = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  vlan_tx_len = 0;
+  vlan_down_err = netif->linkoutput(netif, p);
+  pbuf_free(p);
+}
+
+NETIF_DECLARE_EXT_CALLBACK(vlan_down_cb)
+
+START_TEST(test_netif_vlanif)
+{
+  struct netif trunk, vlan10, vlan20, svlan100, cvlan10;
+  vlanif_initdata_t vlan10_init = VLANIF_INITDATA(&trunk, 10);
+  vlanif_initdata_t vlan20_init = VLANIF_INITDATA(&trunk, 20);
+  vlanif_initdata_t svlan100_init = VLANIF_INITDATA_SVLAN(&trunk, 100);
+  vlanif_initdata_t cvlan10_init = VLANIF_INITDATA(&svlan100, 10);
+  vlanif_initdata_t dup_init = VLANIF_INITDATA(&trunk, 20);
+  vlanif_initdata_t bad_init = VLANIF_INITDATA(&trunk, 4095);
+  static const u16_t tag10[] = {ETHTYPE_VLAN, 10};
+  static const u16_t tag20[] = {ETHTYPE_VLAN, 20};
+  static const u16_t tag30[] = {ETHTYPE_VLAN, 30};
+  static const u16_t qinq[] = {ETHTYPE_SVLAN, 100, ETHTYPE_VLAN, 10};
+  struct netif dup;
+  ip4_addr_t addr, mask;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  IP4_ADDR(&mask, 255, 255, 255, 0);
+  IP4_ADDR(&addr, 192, 168, 0, 1);
+  fail_unless(netif_add(&trunk, &addr, &mask, NULL, NULL, vlan_trunk_init, ethernet_input) == &trunk);
+  IP4_ADDR(&addr, 10, 0, 10, 1);
+  fail_unless(netif_add(&vlan10, &addr, &mask, NULL, &vlan10_init, vlanif_init, ethernet_input) == &vlan10);
+  IP4_ADDR(&addr, 10, 0, 20, 1);
+  fail_unless(netif_add(&vlan20, &addr, &mask, NULL, &vlan20_init, vlanif_init, ethernet_input) == &vlan20);
+  fail_unless(netif_add_noaddr(&svlan100, &svlan100_init, vlanif_init, ethernet_input) == &svlan100);
+  IP4_ADDR(&addr, 10, 1, 10, 1);
+  fail_unless(netif_add(&cvlan10, &addr, &mask, NULL, &cvlan10_init, vlanif_init, ethernet_input) == &cvlan10);
+  /* one sub-interface per VID, no reserved VIDs */
+  fail_unless(netif_add_noaddr(&dup, &dup_init, vlanif_init, ethernet_input) == NULL);
+  fail_unless(netif_add_noaddr(&dup, &bad_init, vlanif_init, ethernet_input) == NULL);
+  fail_unless(vlanif_get(&trunk, 10) == &vlan10);
+  fail_unless(vlanif_get(&trunk, 11) == NULL);
+  fail_unless(vlanif_get(&svlan100, 10) == &cvlan10);
+  fail_unless(netif_is_link_up(&vlan10));
+  fail_unless(!memcmp(vlan10.hwaddr, trunk.hwaddr, ETH_HWADDR_LEN));
+
+  netif_set_up(&trunk);
+  netif_set_up(&vlan10);
+  netif_set_up(&vlan20);
+  netif_set_up(&svlan100);
+
+  /* tagged frames are answered by their sub-interface, tagged */
+  vlan_arp_request_input(&trunk, tag10, 1, 0, 10);
+  fail_unless(vlan_arp_reply_sent(tag10, 1));
+  vlan_arp_request_input(&trunk, tag20, 1, 0, 20);
+  fail_unless(vlan_arp_reply_sent(tag20, 1));
+  /* not in the VLAN of the address, no sub-interface or untagged */
+  vlan_arp_request_input(&trunk, tag20, 1, 0, 10);
+  fail_unless(vlan_tx_len == 0);
+  vlan_arp_request_input(&trunk, tag30, 1, 0, 10);
+  fail_unless(vlan_tx_len == 0);
+  vlan_arp_request_input(&trunk, NULL, 0, 0, 10);
+  fail_unless(vlan_tx_len == 0);
+  /* Q-in-Q, only while the inner sub-interface is up */
+  vlan_arp_request_input(&trunk, qinq, 2, 1, 10);
+  fail_unless(vlan_tx_len == 0);
+  netif_set_up(&cvlan10);
+  vlan_arp_request_input(&trunk, qinq, 2, 1, 10);
+  fail_unless(vlan_arp_reply_sent(qinq, 2));
+
+  /* the tag goes into the header room of the frame if there is room */
+  p = pbuf_alloc(PBUF_TRANSPORT, 46, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(pbuf_add_header(p, SIZEOF_ETH_HDR) == 0);
+  memset(p->payload, 0, p->len);
+  ((u8_t *)p->payload)[0] = 0x02;
+  ((u8_t *)p->payload)[5] = 0x99;
+  ((u8_t *)p->payload)[6] = 0x02;
+  ((u8_t *)p->payload)[11] = 0x01;
+  ((u8_t *)p->payload)[12] = 0x08;
+  ((u8_t *)p->payload)[13] = 0x06;
+  ((u8_t *)p->payload)[21] = 0x02;
+  vlan_tx_len = 0;
+  fail_unless(vlan10.linkoutput(&vlan10, p) == ERR_OK);
+  fail_unless(p->tot_len == 46 + SIZEOF_ETH_HDR + SIZEOF_VLAN_HDR);
+  fail_unless(vlan_arp_reply_sent(tag10, 1));
+  pbuf_free(p);
+
+  /* a removed sub-interface leaves the table of its parent, after the
+     callbacks for going down could still send through it */
+  vlan_down_netif = &vlan20;
+  vlan_down_err = ERR_ARG;
+  netif_add_ext_callback(&vlan_down_cb, vlan_down_callback);
+  netif_remove(&vlan20);
+  netif_remove_ext_callback(&vlan_down_cb);
+  fail_unless(vlan_down_err == ERR_OK);
+  fail_unless((vlan_tx_len == 60 + SIZEOF_VLAN_HDR) && (vlan_tx_frame[15] == 20));
+  fail_unless(vlanif_get(&trunk, 20) == NULL);
+  vlan_arp_request_input(&trunk, tag20, 1, 0, 20);
+  fail_unless(vlan_tx_len == 0);
+  /* its functions must not be called any more, but fail if they are */
+  p = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  fail_unless(vlan20.linkoutput(&vlan20, p) == ERR_IF);
+  pbuf_free(p);
+#if LWIP_IGMP
+  fail_unless(vlan20.igmp_mac_filter(&vlan20, &addr, NETIF_DEL_MAC_FILTER) == ERR_IF);
+#endif /* LWIP_IGMP */
+
+  /* sub-interfaces of a removed parent are detached */
+  netif_remove(&trunk);
+  p = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  fail_unless(vlan10.linkoutput(&vlan10, p) == ERR_IF);
+  pbuf_free(p);
+
+  netif_remove(&vlan10);
+  netif_remove(&cvlan10);
+  netif_remove(&svlan100);
+}
+END_TEST
+#endif /* LWIP_VLANIF */
+
 /** Create the suite including all tests for this module */
 Suite *
 netif_suite(void)
@@ -279,7 +505,10 @@ netif_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_netif_extcallbacks),
     TESTFUNC(test_netif_flag_set),
-    TESTFUNC(test_netif_find)
+    TESTFUNC(test_netif_find),
+#if LWIP_VLANIF
+    TESTFUNC(test_netif_vlanif),
+#endif /* LWIP_VLANIF */
   };
   return create_suite("NETIF", tests, sizeof(tests)/sizeof(testfunc), netif_setup, netif_teardown);
 }
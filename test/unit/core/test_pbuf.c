@@ -239,7 +239,7 @@ START_TEST(test_pbuf_queueing_bigger_than_64k)
 
   pbuf_split_64k(p1, &rest2);
   fail_unless(p1->tot_len == TESTBUFSIZE_1);
-  fail_unless(rest2->tot_len == (u16_t)((TESTBUFSIZE_2+TESTBUFSIZE_3) & 0xFFFF));
+  fail_unless(rest2->tot_len == (pbuf_len_t)(TESTBUFSIZE_2+TESTBUFSIZE_3));
   pbuf_split_64k(rest2, &rest3);
   fail_unless(rest2->tot_len == TESTBUFSIZE_2);
   fail_unless(rest3->tot_len == TESTBUFSIZE_3);
@@ -341,6 +341,160 @@ START_TEST(test_pbuf_get_put_at_edge)
 }
 END_TEST
 
+#if LWIP_PBUF_LEN32
+/* Verify a chain longer than 64K is handled without splitting */
+START_TEST(test_pbuf_len32_chain)
+{
+  err_t err;
+  u8_t getdata;
+  pbuf_len_t off;
+  struct pbuf *p, *q;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for(i = 0; i < TESTBUFSIZE_1; i++) {
+    testbuf_1[i] = (u8_t)rand();
+  }
+  for(i = 0; i < TESTBUFSIZE_3; i++) {
+    testbuf_3[i] = (u8_t)rand();
+  }
+
+  p = pbuf_alloc(PBUF_RAW, TESTBUFSIZE_1 + TESTBUFSIZE_3, PBUF_POOL);
+  fail_unless(p != NULL);
+  fail_unless(p->tot_len == TESTBUFSIZE_1 + TESTBUFSIZE_3);
+  fail_unless(pbuf_clen(p) > 1);
+
+  err = pbuf_take(p, testbuf_1, TESTBUFSIZE_1);
+  fail_unless(err == ERR_OK);
+  err = pbuf_take_at(p, testbuf_3, TESTBUFSIZE_3, TESTBUFSIZE_1);
+  fail_unless(err == ERR_OK);
+  /* writing beyond the end must fail */
+  err = pbuf_take_at(p, testbuf_3, TESTBUFSIZE_3, TESTBUFSIZE_1 + 1);
+  fail_unless(err == ERR_MEM);
+
+  getdata = pbuf_get_at(p, TESTBUFSIZE_1 + 1000);
+  fail_unless(getdata == testbuf_3[1000]);
+  q = pbuf_skip(p, TESTBUFSIZE_1 + 1000, &off);
+  fail_unless(q != NULL);
+  fail_unless(((u8_t *)q->payload)[off] == testbuf_3[1000]);
+
+  fail_unless(pbuf_copy_partial(p, testbuf_3a, TESTBUFSIZE_3, TESTBUFSIZE_1) == TESTBUFSIZE_3);
+  fail_if(memcmp(testbuf_3, testbuf_3a, TESTBUFSIZE_3));
+
+  p = pbuf_free_header(p, TESTBUFSIZE_1);
+  fail_unless(p != NULL);
+  fail_unless(p->tot_len == TESTBUFSIZE_3);
+  fail_unless(pbuf_get_at(p, 0) == testbuf_3[0]);
+
+  pbuf_free(p);
+}
+END_TEST
+
+/* pbuf_memfind() in a chain longer than 64K finds matches up to offset 0xFFFE */
+START_TEST(test_pbuf_len32_memfind)
+{
+  static const u8_t needle[4] = {1, 2, 3, 4};
+  struct pbuf *p, *q;
+  LWIP_UNUSED_ARG(_i);
+
+  p = pbuf_alloc(PBUF_RAW, 70000, PBUF_POOL);
+  fail_unless(p != NULL);
+  for (q = p; q != NULL; q = q->next) {
+    memset(q->payload, 0, q->len);
+  }
+
+  fail_unless(pbuf_take_at(p, needle, sizeof(needle), 60000) == ERR_OK);
+  fail_unless(pbuf_memfind(p, needle, sizeof(needle), 0) == 60000);
+  fail_unless(pbuf_memfind(p, needle, sizeof(needle), 60001) == 0xFFFF);
+  fail_unless(pbuf_memcmp(p, 60000, needle, sizeof(needle)) == 0);
+
+  /* the last offset that can be returned, the match ends beyond 64K */
+  fail_unless(pbuf_take_at(p, needle, sizeof(needle), 0xFFFE) == ERR_OK);
+  fail_unless(pbuf_memfind(p, needle, sizeof(needle), 60001) == 0xFFFE);
+  fail_unless(pbuf_memcmp(p, 0xFFFE, needle, sizeof(needle)) == 0);
+
+  /* matches beyond 0xFFFE are not reported */
+  fail_unless(pbuf_take_at(p, "\0\0\0\0", 4, 0xFFFE) == ERR_OK);
+  fail_unless(pbuf_take_at(p, needle, sizeof(needle), 68000) == ERR_OK);
+  fail_unless(pbuf_memfind(p, needle, sizeof(needle), 60001) == 0xFFFF);
+
+  pbuf_free(p);
+}
+END_TEST
+#endif /* LWIP_PBUF_LEN32 */
+
+#if LWIP_PBUF_SHARED
+/* Shared references keep the original alive, have their own header offsets
+   and are copied by pbuf_unshare() */
+START_TEST(test_pbuf_share)
+{
+  struct pbuf *p, *p2, *s1, *s2, *q;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  for(i = 0; i < 150; i++) {
+    testbuf_1[i] = (u8_t)rand();
+  }
+  p = pbuf_alloc(PBUF_RAW, 100, PBUF_RAM);
+  fail_unless(p != NULL);
+  p2 = pbuf_alloc(PBUF_RAW, 50, PBUF_RAM);
+  fail_unless(p2 != NULL);
+  pbuf_cat(p, p2);
+  fail_unless(pbuf_take(p, testbuf_1, 150) == ERR_OK);
+
+  s1 = pbuf_share(p);
+  fail_unless(s1 != NULL);
+  fail_unless(s1->tot_len == 150);
+  fail_unless(pbuf_clen(s1) == 2);
+  fail_unless(s1->payload == p->payload);
+  fail_unless(s1->next->payload == p2->payload);
+  fail_unless(p->ref == 2);
+  fail_unless(p2->ref == 2);
+  fail_unless(lwip_stats.memp[MEMP_PBUF_SHARED]->used == 2);
+
+  /* header offsets are independent */
+  fail_unless(pbuf_remove_header(s1, 10) == 0);
+  fail_unless(s1->payload == (u8_t *)p->payload + 10);
+  fail_unless(s1->tot_len == 140);
+  fail_unless(pbuf_header_force(s1, 10) == 0);
+  fail_unless(s1->payload == p->payload);
+
+  s2 = pbuf_share(p);
+  fail_unless(s2 != NULL);
+
+  /* the data stays valid after the original is freed */
+  pbuf_free(p);
+  fail_unless(pbuf_copy_partial(s1, testbuf_1a, 150, 0) == 150);
+  fail_if(memcmp(testbuf_1, testbuf_1a, 150));
+
+  /* a shared reference is copied before modification */
+  q = pbuf_unshare(s1);
+  fail_unless(q != NULL);
+  fail_unless(q != s1);
+  fail_unless(q->next == NULL);
+  fail_unless(lwip_stats.memp[MEMP_PBUF_SHARED]->used == 2);
+  pbuf_put_at(q, 0, (u8_t)(testbuf_1[0] + 1));
+  fail_unless(pbuf_get_at(s2, 0) == testbuf_1[0]);
+  /* an unshared pbuf is returned as it is */
+  fail_unless(pbuf_unshare(q) == q);
+  pbuf_free(q);
+
+  /* so is a pbuf referenced more than once */
+  p2 = s2->next;
+  pbuf_ref(p2);
+  q = pbuf_unshare(s2);
+  fail_unless(q != NULL);
+  fail_unless(q != s2);
+  fail_unless(lwip_stats.memp[MEMP_PBUF_SHARED]->used == 1);
+  fail_unless(pbuf_copy_partial(q, testbuf_1a, 150, 0) == 150);
+  fail_if(memcmp(testbuf_1, testbuf_1a, 150));
+  pbuf_free(q);
+  pbuf_free(p2);
+  fail_unless(lwip_stats.memp[MEMP_PBUF_SHARED]->used == 0);
+}
+END_TEST
+#endif /* LWIP_PBUF_SHARED */
+
 /** Create the suite including all tests for this module */
 Suite *
 pbuf_suite(void)
@@ -353,7 +507,14 @@ pbuf_suite(void)
     TESTFUNC(test_pbuf_split_64k_on_small_pbufs),
     TESTFUNC(test_pbuf_queueing_bigger_than_64k),
     TESTFUNC(test_pbuf_take_at_edge),
-    TESTFUNC(test_pbuf_get_put_at_edge)
+    TESTFUNC(test_pbuf_get_put_at_edge),
+#if LWIP_PBUF_LEN32
+    TESTFUNC(test_pbuf_len32_chain),
+    TESTFUNC(test_pbuf_len32_memfind),
+#endif /* LWIP_PBUF_LEN32 */
+#if LWIP_PBUF_SHARED
+    TESTFUNC(test_pbuf_share),
+#endif /* LWIP_PBUF_SHARED */
   };
   return create_suite("PBUF", tests, sizeof(tests)/sizeof(testfunc), pbuf_setup, pbuf_teardown);
 }
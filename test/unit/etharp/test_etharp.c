@@ -261,13 +261,89 @@ START_TEST(test_etharp_table)
 }
 END_TEST
 
+#if ETHARP_TABLE_HASH_SIZE
+static void
+send_udp(struct udp_pcb *pcb, ip4_addr_t *adr)
+{
+  err_t err;
+  ip_addr_t dst;
+  struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+  if (p == NULL) {
+    FAIL_RET();
+  }
+  ip_addr_copy_from_ip4(dst, *adr);
+  err = udp_sendto(pcb, p, &dst, 123);
+  fail_unless(err == ERR_OK);
+  pbuf_free(p);
+}
+
+/** A full hashed table recycles its least recently used entry */
+START_TEST(test_etharp_lru)
+{
+  ssize_t idx;
+  const ip4_addr_t *unused_ipaddr;
+  struct eth_addr *unused_ethaddr;
+  struct udp_pcb* pcb;
+  ip4_addr_t adrs[ARP_TABLE_SIZE + 1];
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  if (pcb == NULL) {
+    return;
+  }
+  for(i = 0; i < ARP_TABLE_SIZE + 1; i++) {
+    IP4_ADDR(&adrs[i], 192,168,1,i+2);
+  }
+  /* fill ARP-table with dynamic entries, lowest index first */
+  for(i = 0; i < ARP_TABLE_SIZE; i++) {
+    send_udp(pcb, &adrs[i]);
+    create_arp_response(&adrs[i]);
+    idx = etharp_find_addr(NULL, &adrs[i], &unused_ethaddr, &unused_ipaddr);
+    fail_unless(idx == i);
+  }
+
+  /* using the first entry makes the second one the least recently used */
+  linkoutput_ctr = 0;
+  send_udp(pcb, &adrs[0]);
+  fail_unless(linkoutput_ctr == 1);
+
+  send_udp(pcb, &adrs[ARP_TABLE_SIZE]);
+  create_arp_response(&adrs[ARP_TABLE_SIZE]);
+  idx = etharp_find_addr(NULL, &adrs[ARP_TABLE_SIZE], &unused_ethaddr, &unused_ipaddr);
+  fail_unless(idx == 1);
+  idx = etharp_find_addr(NULL, &adrs[0], &unused_ethaddr, &unused_ipaddr);
+  fail_unless(idx == 0);
+  idx = etharp_find_addr(NULL, &adrs[1], &unused_ethaddr, &unused_ipaddr);
+  fail_unless(idx == -1);
+  for(i = 2; i < ARP_TABLE_SIZE; i++) {
+    idx = etharp_find_addr(NULL, &adrs[i], &unused_ethaddr, &unused_ipaddr);
+    fail_unless(idx == i);
+  }
+
+  /* freed entries are reused lowest index first */
+  etharp_cleanup_netif(&test_netif);
+  send_udp(pcb, &adrs[1]);
+  create_arp_response(&adrs[1]);
+  idx = etharp_find_addr(NULL, &adrs[1], &unused_ethaddr, &unused_ipaddr);
+  fail_unless(idx == 0);
+
+  udp_remove(pcb);
+}
+END_TEST
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 
 /** Create the suite including all tests for this module */
 Suite *
 etharp_suite(void)
 {
   testfunc tests[] = {
-    TESTFUNC(test_etharp_table)
+    TESTFUNC(test_etharp_table),
+#if ETHARP_TABLE_HASH_SIZE
+    TESTFUNC(test_etharp_lru),
+#endif /* ETHARP_TABLE_HASH_SIZE */
   };
   return create_suite("ETHARP", tests, sizeof(tests)/sizeof(testfunc), etharp_setup, etharp_teardown);
 }
@@ -2,16 +2,20 @@
 
 #include "lwip/icmp.h"
 #include "lwip/ip4.h"
+#include "lwip/ip4_frag.h"
+#include "lwip/ip4_fib.h"
+#include "lwip/ip_flow.h"
 #include "lwip/etharp.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/stats.h"
 #include "lwip/prot/ip.h"
 #include "lwip/prot/ip4.h"
+#include "netif/ethernet.h"
 
 #include "lwip/tcpip.h"
 
-#if !LWIP_IPV4 || !IP_REASSEMBLY || !MIB2_STATS || !IPFRAG_STATS
-#error "This tests needs LWIP_IPV4, IP_REASSEMBLY; MIB2- and IPFRAG-statistics enabled"
+#if !LWIP_IPV4 || !IP_REASSEMBLY || !MIB2_STATS || !IPFRAG_STATS || !LWIP_IPV4_FIB
+#error "This tests needs LWIP_IPV4, IP_REASSEMBLY, LWIP_IPV4_FIB; MIB2- and IPFRAG-statistics enabled"
 #endif
 
 static struct netif test_netif;
@@ -71,7 +75,7 @@ test_netif_remove(void)
 
 /* Helper functions */
 static void
-create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
+create_ip4_input_fragment_from(u8_t src, u16_t ip_id, u16_t start, u16_t len, int last)
 {
   struct pbuf *p;
   struct netif *input_netif = netif_list; /* just use any netif */
@@ -97,7 +101,7 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
     IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
     IPH_CHKSUM_SET(iphdr, 0);
     ip4_addr_copy(iphdr->src, *netif_ip4_addr(input_netif));
-    iphdr->src.addr = lwip_htonl(lwip_htonl(iphdr->src.addr) + 1);
+    iphdr->src.addr = lwip_htonl(lwip_htonl(iphdr->src.addr) + src);
     ip4_addr_copy(iphdr->dest, *netif_ip4_addr(input_netif));
     IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, sizeof(struct ip_hdr)));
 
@@ -109,6 +113,12 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
   }
 }
 
+static void
+create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
+{
+  create_ip4_input_fragment_from(1, ip_id, start, len, last);
+}
+
 static err_t arpless_output(struct netif *netif, struct pbuf *p,
                             const ip4_addr_t *ipaddr) {
   LWIP_UNUSED_ARG(ipaddr);
@@ -234,6 +244,55 @@ START_TEST(test_ip4_reass)
 }
 END_TEST
 
+#if IP_REASS_MAX_PBUFS_PER_SRC
+/** A source exceeding IP_REASS_MAX_PBUFS_PER_SRC loses its oldest datagrams */
+START_TEST(test_ip4_reass_source_limit)
+{
+  u16_t offset;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  memset(&lwip_stats.mib2, 0, sizeof(lwip_stats.mib2));
+  memset(&lwip_stats.ip_frag, 0, sizeof(lwip_stats.ip_frag));
+
+  /* no first fragments in the datagrams that are freed: no ICMP */
+  for (offset = 200; offset <= 800; offset += 200) {
+    create_ip4_input_fragment_from(1, 1, offset, 200, 0);
+  }
+  for (offset = 200; offset <= 1000; offset += 200) {
+    create_ip4_input_fragment_from(1, 2, offset, 200, 0);
+  }
+  fail_unless(lwip_stats.mib2.ipreasmfails == 0);
+
+  /* source 1 is full: its oldest datagram is freed */
+  create_ip4_input_fragment_from(1, 2, 1200, 200, 0);
+  fail_unless(lwip_stats.mib2.ipreasmfails == 1);
+  fail_unless(lwip_stats.ip_frag.memerr == 0);
+
+  /* another source can still reassemble */
+  create_ip4_input_fragment_from(2, 1, 0, 200, 0);
+  create_ip4_input_fragment_from(2, 1, 200, 200, 1);
+  fail_unless(lwip_stats.mib2.ipreasmoks == 1);
+
+  create_ip4_input_fragment_from(1, 3, 200, 200, 0);
+  for (offset = 1400; offset <= 1800; offset += 200) {
+    create_ip4_input_fragment_from(1, 2, offset, 200, 0);
+  }
+  fail_unless(lwip_stats.mib2.ipreasmfails == 2);
+
+  /* a single datagram cannot exceed the limit */
+  create_ip4_input_fragment_from(1, 2, 2000, 200, 0);
+  fail_unless(lwip_stats.ip_frag.memerr == 1);
+  fail_unless(lwip_stats.ip_frag.drop == 1);
+
+  for (i = 0; i <= IP_REASS_MAXAGE; i++) {
+    ip_reass_tmr();
+  }
+  fail_unless(lwip_stats.mib2.ipreasmfails == 3);
+}
+END_TEST
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
+
 /* packets to 127.0.0.1 shall not be sent out to netif_default */
 START_TEST(test_127_0_0_1)
 {
@@ -326,6 +385,446 @@ START_TEST(test_ip4_icmp_replylen_first_8)
 }
 END_TEST
 
+static void
+test_ip4_fib_collect(const struct ip4_fib_route *route, void *arg)
+{
+  u8_t **len = (u8_t **)arg;
+  **len = route->prefix_len;
+  (*len)++;
+}
+
+static u8_t
+test_ip4_fib_lookup_len(u8_t a, u8_t b, u8_t c, u8_t d)
+{
+  ip4_addr_t dest;
+  const struct ip4_fib_route *route;
+
+  IP4_ADDR(&dest, a, b, c, d);
+  route = ip4_fib_lookup(&dest);
+  return (route != NULL) ? route->prefix_len : 0xff;
+}
+
+/** Longest prefix match, replacing and deleting routes */
+START_TEST(test_ip4_fib_lpm)
+{
+  static const u8_t prefixes[][5] = {
+    {10, 1, 2, 0, 24}, {10, 0, 0, 0, 8}, {10, 1, 2, 3, 32}, {10, 1, 0, 0, 16},
+    {10, 1, 3, 0, 24}, {10, 128, 0, 0, 9}
+  };
+  ip4_addr_t addr, gw;
+  u8_t lens[8];
+  u8_t *next = lens;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  IP4_ADDR(&gw, 192, 168, 0, 254);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(prefixes); i++) {
+    /* host bits are ignored */
+    IP4_ADDR(&addr, prefixes[i][0], prefixes[i][1], prefixes[i][2], prefixes[i][3] | 1);
+    fail_unless(ip4_fib_add(&addr, prefixes[i][4], &gw, &test_netif) == ERR_OK);
+  }
+  fail_unless(ip4_fib_num_routes() == LWIP_ARRAYSIZE(prefixes));
+
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 2, 3) == 32);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 2, 4) == 24);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 3, 3) == 24);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 4, 3) == 16);
+  fail_unless(test_ip4_fib_lookup_len(10, 2, 0, 1) == 8);
+  fail_unless(test_ip4_fib_lookup_len(10, 200, 0, 1) == 9);
+  fail_unless(test_ip4_fib_lookup_len(11, 0, 0, 1) == 0xff);
+
+  /* a default route catches the rest, replacing it changes the gateway */
+  ip4_addr_set_zero(&addr);
+  fail_unless(ip4_fib_add(&addr, 0, &gw, &test_netif) == ERR_OK);
+  fail_unless(ip4_fib_add(&addr, 0, NULL, &test_netif) == ERR_OK);
+  fail_unless(ip4_fib_num_routes() == LWIP_ARRAYSIZE(prefixes) + 1);
+  fail_unless(test_ip4_fib_lookup_len(11, 0, 0, 1) == 0);
+  IP4_ADDR(&addr, 11, 0, 0, 1);
+  fail_unless(ip4_addr_isany_val(ip4_fib_lookup(&addr)->path[0].gw));
+
+  /* routes are walked in address order, covering prefixes first */
+  ip4_fib_foreach(test_ip4_fib_collect, &next);
+  fail_unless(next == &lens[7]);
+  fail_unless((lens[0] == 0) && (lens[1] == 8) && (lens[2] == 16) && (lens[3] == 24) &&
+              (lens[4] == 32) && (lens[5] == 24) && (lens[6] == 9));
+
+  /* deleting a route uncovers the next shorter prefix */
+  IP4_ADDR(&addr, 10, 1, 0, 0);
+  fail_unless(ip4_fib_delete(&addr, 16) == ERR_OK);
+  fail_unless(ip4_fib_delete(&addr, 16) == ERR_VAL);
+  fail_unless(ip4_fib_delete(&addr, 17) == ERR_VAL);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 4, 3) == 8);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 2, 3) == 32);
+  IP4_ADDR(&addr, 10, 1, 2, 3);
+  fail_unless(ip4_fib_delete(&addr, 32) == ERR_OK);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 2, 3) == 24);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(prefixes); i++) {
+    IP4_ADDR(&addr, prefixes[i][0], prefixes[i][1], prefixes[i][2], prefixes[i][3]);
+    ip4_fib_delete(&addr, prefixes[i][4]);
+  }
+  fail_unless(ip4_fib_num_routes() == 1);
+  ip4_addr_set_zero(&addr);
+  fail_unless(ip4_fib_delete(&addr, 0) == ERR_OK);
+  fail_unless(ip4_fib_num_routes() == 0);
+  fail_unless(test_ip4_fib_lookup_len(10, 1, 2, 3) == 0xff);
+}
+END_TEST
+
+/** ip4_route() and etharp_output() use the FIB, netif_remove() cleans it */
+START_TEST(test_ip4_fib_route)
+{
+  ip4_addr_t prefix, gw, dest;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  linkoutput_ctr = 0;
+  test_netif_add();
+  netif_set_default(NULL);
+
+  IP4_ADDR(&dest, 10, 1, 2, 3);
+  fail_unless(ip4_route(&dest) == NULL);
+
+  IP4_ADDR(&prefix, 10, 0, 0, 0);
+  IP4_ADDR(&gw, 192, 168, 0, 254);
+  fail_unless(ip4_fib_add(&prefix, 8, &gw, &test_netif) == ERR_OK);
+  fail_unless(ip4_route(&dest) == &test_netif);
+
+  /* the subnet of the netif wins over a shorter prefix */
+  IP4_ADDR(&prefix, 192, 0, 0, 0);
+  fail_unless(ip4_fib_add(&prefix, 8, &gw, netif_get_loopif()) == ERR_OK);
+  IP4_ADDR(&dest, 192, 168, 3, 3);
+  fail_unless(ip4_route(&dest) == &test_netif);
+  /* ...but not over a longer one */
+  IP4_ADDR(&prefix, 192, 168, 3, 0);
+  fail_unless(ip4_fib_add(&prefix, 24, &gw, netif_get_loopif()) == ERR_OK);
+  fail_unless(ip4_route(&dest) == netif_get_loopif());
+
+  /* packets to 10/8 are sent to the gateway of the route */
+  IP4_ADDR(&dest, 10, 1, 2, 3);
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(ip4_output_if(p, netif_ip4_addr(&test_netif), &dest, 64, 0, IP_PROTO_UDP, &test_netif) == ERR_OK);
+  pbuf_free(p);
+  /* ARP request for the gateway: target protocol address at offset 38 */
+  fail_unless(linkoutput_ctr == 1);
+  fail_unless(linkoutput_pkt_len >= 42);
+  fail_if(memcmp(&linkoutput_pkt[38], &gw, sizeof(gw)));
+
+  netif_remove(&test_netif);
+  fail_unless(ip4_fib_num_routes() == 2);
+  ip4_fib_remove_netif(netif_get_loopif());
+  fail_unless(ip4_fib_num_routes() == 0);
+}
+END_TEST
+
+/** A route without a usable next hop leaves the way to a shorter one */
+START_TEST(test_ip4_fib_fallback)
+{
+  ip4_addr_t prefix, gw, default_gw, dest;
+  struct netif *loop = netif_get_loopif();
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  linkoutput_ctr = 0;
+  test_netif_add();
+  netif_set_default(NULL);
+
+  IP4_ADDR(&prefix, 10, 0, 0, 0);
+  IP4_ADDR(&gw, 127, 0, 0, 2);
+  fail_unless(ip4_fib_add(&prefix, 8, &gw, loop) == ERR_OK);
+  ip4_addr_set_zero(&prefix);
+  IP4_ADDR(&default_gw, 192, 168, 0, 254);
+  fail_unless(ip4_fib_add(&prefix, 0, &default_gw, &test_netif) == ERR_OK);
+
+  IP4_ADDR(&dest, 10, 1, 2, 3);
+  fail_unless(ip4_route(&dest) == loop);
+  netif_set_down(loop);
+  fail_unless(ip4_route(&dest) == &test_netif);
+
+  /* etharp_output() sends to the gateway of the default route, not to the
+     one of the netif */
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(ip4_output_if(p, netif_ip4_addr(&test_netif), &dest, 64, 0, IP_PROTO_UDP, &test_netif) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(linkoutput_ctr == 1);
+  fail_unless(linkoutput_pkt_len >= 42);
+  fail_if(memcmp(&linkoutput_pkt[38], &default_gw, sizeof(default_gw)));
+
+  netif_set_up(loop);
+  fail_unless(ip4_route(&dest) == loop);
+  netif_remove(&test_netif);
+  ip4_fib_remove_netif(loop);
+  fail_unless(ip4_fib_num_routes() == 0);
+}
+END_TEST
+
+#if LWIP_FIB_MAX_PATHS > 1
+/** Send a UDP packet from port 'sport' to 10.1.2.3, return the destination
+ * hardware address it is sent to */
+static u8_t
+test_ip4_fib_multipath_send(u16_t sport)
+{
+  ip4_addr_t dest;
+  struct pbuf *p;
+  u8_t *ports;
+
+  IP4_ADDR(&dest, 10, 1, 2, 3);
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  ports = (u8_t *)p->payload;
+  ports[0] = (u8_t)(sport >> 8);
+  ports[1] = (u8_t)sport;
+  ports[3] = 53;
+  linkoutput_ctr = 0;
+  fail_unless(ip4_output_if(p, netif_ip4_addr(&test_netif), &dest, 64, 0, IP_PROTO_UDP, &test_netif) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(linkoutput_ctr == 1);
+  return linkoutput_pkt[5];
+}
+
+/** Routes with several next hops spread the flows by weight, every flow
+ * stays on its path */
+START_TEST(test_ip4_fib_multipath)
+{
+  ip4_addr_t prefix, gw1, gw2, gw3, dest;
+  struct eth_addr mac1 = {{0x02, 0, 0, 0, 0, 0x01}};
+  struct eth_addr mac2 = {{0x02, 0, 0, 0, 0, 0x02}};
+  const struct ip4_fib_route *route;
+  const struct ip4_fib_path *path;
+  struct netif *loop = netif_get_loopif();
+  u32_t h, count;
+  u16_t sport;
+  u8_t seen[3], mac;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  netif_set_default(NULL);
+
+  IP4_ADDR(&prefix, 10, 0, 0, 0);
+  IP4_ADDR(&dest, 10, 1, 2, 3);
+  IP4_ADDR(&gw1, 192, 168, 0, 254);
+  IP4_ADDR(&gw2, 192, 168, 0, 253);
+  IP4_ADDR(&gw3, 127, 0, 0, 2);
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw1, &test_netif, 1) == ERR_OK);
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw2, &test_netif, 3) == ERR_OK);
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw2, &test_netif, 0) == ERR_ARG);
+  fail_unless(ip4_fib_num_routes() == 1);
+  route = ip4_fib_lookup(&dest);
+  fail_unless(route != NULL);
+  fail_unless(route->num_paths == 2);
+
+  /* hash-threshold: the upper 16 bits of the hash are split by weight */
+  count = 0;
+  for (h = 0; h <= 0xffff; h++) {
+    path = ip4_fib_select(route, h << 16, NULL);
+    fail_unless(path != NULL);
+    if (path == &route->path[0]) {
+      count++;
+    }
+  }
+  fail_unless(count == 0x4000);
+
+  /* adding a path again only changes its weight */
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw2, &test_netif, 1) == ERR_OK);
+  fail_unless(route->num_paths == 2);
+  fail_unless(route->path[1].weight == 1);
+
+  /* a path through another netif gets its share of the flows, unless the
+     netif is down */
+  fail_unless(ip4_fib_add_path(&prefix, 8, NULL, loop, 2) == ERR_OK);
+  count = 0;
+  for (h = 0; h <= 0xffff; h++) {
+    struct netif *netif = ip4_route_flow(NULL, &dest, (h << 16) | 1);
+    fail_unless((netif == &test_netif) || (netif == loop));
+    if (netif == loop) {
+      count++;
+    }
+    /* the same flow always takes the same path */
+    fail_unless(ip4_route_flow(NULL, &dest, (h << 16) | 1) == netif);
+  }
+  fail_unless(count == 0x8000);
+  netif_set_down(loop);
+  for (h = 0; h <= 0xffff; h += 0x100) {
+    fail_unless(ip4_route_flow(NULL, &dest, (h << 16) | 1) == &test_netif);
+  }
+  netif_set_up(loop);
+  /* without a flow, all packets to a destination take one path */
+  fail_unless(ip4_route(&dest) == ip4_route(&dest));
+
+  /* etharp_output() selects among the gateways on its netif by the flow of
+     the packet */
+  fail_unless(etharp_add_static_entry(&gw1, &mac1) == ERR_OK);
+  fail_unless(etharp_add_static_entry(&gw2, &mac2) == ERR_OK);
+  memset(seen, 0, sizeof(seen));
+  for (sport = 1000; sport < 1064; sport++) {
+    mac = test_ip4_fib_multipath_send(sport);
+    fail_unless((mac == 1) || (mac == 2));
+    seen[mac]++;
+    fail_unless(test_ip4_fib_multipath_send(sport) == mac);
+  }
+  fail_unless((seen[1] > 0) && (seen[2] > 0));
+
+  /* paths are removed one by one, a route is full at LWIP_FIB_MAX_PATHS */
+  fail_unless(ip4_fib_delete_path(&prefix, 8, NULL, loop) == ERR_OK);
+  fail_unless(ip4_fib_delete_path(&prefix, 8, NULL, loop) == ERR_VAL);
+  fail_unless(route->num_paths == 2);
+  for (h = route->num_paths; h < LWIP_FIB_MAX_PATHS; h++) {
+    gw3.addr = lwip_htonl(0x7f000002UL + h);
+    fail_unless(ip4_fib_add_path(&prefix, 8, &gw3, loop, 1) == ERR_OK);
+  }
+  fail_unless(ip4_fib_add_path(&prefix, 8, NULL, loop, 1) == ERR_MEM);
+  fail_unless(route->num_paths == LWIP_FIB_MAX_PATHS);
+  ip4_fib_remove_netif(loop);
+  fail_unless(ip4_fib_num_routes() == 1);
+  fail_unless(route->num_paths == 2);
+  fail_unless(ip4_fib_delete_path(&prefix, 8, &gw1, &test_netif) == ERR_OK);
+  fail_unless(ip4_fib_delete_path(&prefix, 8, &gw2, &test_netif) == ERR_OK);
+  fail_unless(ip4_fib_num_routes() == 0);
+
+  /* ip4_fib_add() replaces all paths */
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw1, &test_netif, 1) == ERR_OK);
+  fail_unless(ip4_fib_add_path(&prefix, 8, &gw2, &test_netif, 1) == ERR_OK);
+  fail_unless(ip4_fib_add(&prefix, 8, &gw2, &test_netif) == ERR_OK);
+  route = ip4_fib_lookup(&dest);
+  fail_unless(route->num_paths == 1);
+  fail_unless(ip4_addr_eq(&route->path[0].gw, &gw2));
+  netif_remove(&test_netif);
+  fail_unless(ip4_fib_num_routes() == 0);
+}
+END_TEST
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+
+#if IP_FORWARD && IP_FLOW_CACHE_SIZE
+static struct netif test_fwd_netif;
+static int fwd_linkoutput_ctr;
+static struct eth_addr fwd_linkoutput_dst;
+
+static err_t
+test_fwd_netif_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  fail_unless(netif == &test_fwd_netif);
+  fwd_linkoutput_ctr++;
+  pbuf_copy_partial(p, &fwd_linkoutput_dst, sizeof(fwd_linkoutput_dst), 0);
+  return ERR_OK;
+}
+
+static err_t
+test_fwd_netif_init(struct netif *netif)
+{
+  fail_unless(test_netif_init(netif) == ERR_OK);
+  netif->linkoutput = test_fwd_netif_linkoutput;
+  netif->hwaddr[5] = 1;
+  return ERR_OK;
+}
+
+/** Send a UDP packet from 192.168.0.5:1000 to 10.0.0.2:2000 into test_netif */
+static void
+test_ip4_forward_udp(void)
+{
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  u8_t *ports;
+
+  p = pbuf_alloc(PBUF_LINK, sizeof(struct ip_hdr) + 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_VHL_SET(iphdr, 4, sizeof(struct ip_hdr) / 4);
+  IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+  IPH_TTL_SET(iphdr, 5);
+  IPH_PROTO_SET(iphdr, IP_PROTO_UDP);
+  IP4_ADDR(&iphdr->src, 192, 168, 0, 5);
+  IP4_ADDR(&iphdr->dest, 10, 0, 0, 2);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, sizeof(struct ip_hdr)));
+  ports = (u8_t *)p->payload + sizeof(struct ip_hdr);
+  ports[0] = 1000 >> 8;
+  ports[1] = 1000 & 0xff;
+  ports[2] = 2000 >> 8;
+  ports[3] = 2000 & 0xff;
+  fail_unless(ip4_input(p, &test_netif) == ERR_OK);
+}
+
+/** The flow of test_ip4_forward_udp() as cached */
+static const struct ip_flow *
+test_ip4_forward_flow(void)
+{
+  struct ip_flow_key key;
+
+  memset(&key, 0, sizeof(key));
+  IP_ADDR4(&key.src, 192, 168, 0, 5);
+  IP_ADDR4(&key.dest, 10, 0, 0, 2);
+  key.sport = 1000;
+  key.dport = 2000;
+  key.proto = IP_PROTO_UDP;
+  return ip_flow_lookup(&key);
+}
+
+/** Forwarded flows are cached and flushed when ARP or routes change */
+START_TEST(test_ip4_forward_flow_cache)
+{
+  ip4_addr_t addr, netmask;
+  struct eth_addr mac1 = {{0x02, 0, 0, 0, 0, 0x11}};
+  struct eth_addr mac2 = {{0x02, 0, 0, 0, 0, 0x22}};
+  const struct ip_flow *flow;
+  LWIP_UNUSED_ARG(_i);
+
+  test_netif_add();
+  IP4_ADDR(&addr, 10, 0, 0, 1);
+  IP4_ADDR(&netmask, 255, 0, 0, 0);
+  netif_add(&test_fwd_netif, &addr, &netmask, IP4_ADDR_ANY4, NULL, test_fwd_netif_init, NULL);
+  netif_set_up(&test_fwd_netif);
+  IP4_ADDR(&addr, 10, 0, 0, 2);
+  fail_unless(etharp_add_static_entry(&addr, &mac1) == ERR_OK);
+  fwd_linkoutput_ctr = 0;
+
+  /* the first packet takes the slow path and teaches the cache */
+  fail_unless(test_ip4_forward_flow() == NULL);
+  test_ip4_forward_udp();
+  fail_unless(fwd_linkoutput_ctr == 1);
+  fail_unless(eth_addr_eq(&fwd_linkoutput_dst, &mac1));
+  flow = test_ip4_forward_flow();
+  fail_unless(flow != NULL);
+  fail_unless(flow->netif == &test_fwd_netif);
+  fail_unless(eth_addr_eq(&flow->dhwaddr, &mac1));
+  test_ip4_forward_udp();
+  fail_unless(fwd_linkoutput_ctr == 2);
+  fail_unless(eth_addr_eq(&fwd_linkoutput_dst, &mac1));
+
+  /* a new hardware address of the next hop flushes the cache */
+  fail_unless(etharp_add_static_entry(&addr, &mac2) == ERR_OK);
+  fail_unless(test_ip4_forward_flow() == NULL);
+  test_ip4_forward_udp();
+  fail_unless(fwd_linkoutput_ctr == 3);
+  fail_unless(eth_addr_eq(&fwd_linkoutput_dst, &mac2));
+  fail_unless(test_ip4_forward_flow() != NULL);
+
+  /* so does a route */
+  IP4_ADDR(&addr, 10, 0, 0, 0);
+  fail_unless(ip4_fib_add(&addr, 24, NULL, &test_fwd_netif) == ERR_OK);
+  fail_unless(test_ip4_forward_flow() == NULL);
+  test_ip4_forward_udp();
+  fail_unless(test_ip4_forward_flow() != NULL);
+  fail_unless(ip4_fib_delete(&addr, 24) == ERR_OK);
+  fail_unless(test_ip4_forward_flow() == NULL);
+
+  /* a next hop that is not resolved yet is not cached */
+  IP4_ADDR(&addr, 10, 0, 0, 2);
+  fail_unless(etharp_remove_static_entry(&addr) == ERR_OK);
+  test_ip4_forward_udp();
+  fail_unless(fwd_linkoutput_ctr == 5);
+  fail_unless(eth_addr_eq(&fwd_linkoutput_dst, &ethbroadcast));
+  fail_unless(test_ip4_forward_flow() == NULL);
+
+  netif_remove(&test_fwd_netif);
+}
+END_TEST
+#endif /* IP_FORWARD && IP_FLOW_CACHE_SIZE */
+
 /** Create the suite including all tests for this module */
 Suite *
 ip4_suite(void)
@@ -333,10 +832,22 @@ ip4_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_ip4_frag),
     TESTFUNC(test_ip4_reass),
+#if IP_REASS_MAX_PBUFS_PER_SRC
+    TESTFUNC(test_ip4_reass_source_limit),
+#endif /* IP_REASS_MAX_PBUFS_PER_SRC */
     TESTFUNC(test_127_0_0_1),
     TESTFUNC(test_ip4addr_aton),
     TESTFUNC(test_ip4_icmp_replylen_short),
     TESTFUNC(test_ip4_icmp_replylen_first_8),
+    TESTFUNC(test_ip4_fib_lpm),
+    TESTFUNC(test_ip4_fib_route),
+    TESTFUNC(test_ip4_fib_fallback),
+#if LWIP_FIB_MAX_PATHS > 1
+    TESTFUNC(test_ip4_fib_multipath),
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+#if IP_FORWARD && IP_FLOW_CACHE_SIZE
+    TESTFUNC(test_ip4_forward_flow_cache),
+#endif /* IP_FORWARD && IP_FLOW_CACHE_SIZE */
   };
   return create_suite("IPv4", tests, sizeof(tests)/sizeof(testfunc), ip4_setup, ip4_teardown);
 }
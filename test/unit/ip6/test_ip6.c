@@ -2,6 +2,7 @@
 
 #include "lwip/ethip6.h"
 #include "lwip/ip6.h"
+#include "lwip/ip6_fib.h"
 #include "lwip/icmp6.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/nd6.h"
@@ -9,14 +10,20 @@
 #include "lwip/prot/ethernet.h"
 #include "lwip/prot/ip.h"
 #include "lwip/prot/ip6.h"
+#include "lwip/priv/nd6_priv.h"
 
 #include "lwip/tcpip.h"
 
 #if LWIP_IPV6 /* allow to build the unit tests without IPv6 support */
 
+#if !LWIP_IPV6_FIB
+#error "This tests needs LWIP_IPV6_FIB enabled"
+#endif
+
 static struct netif test_netif6;
 static int linkoutput_ctr;
 static int linkoutput_byte_ctr;
+static u8_t linkoutput_pkt[80];
 
 static err_t
 default_netif_linkoutput(struct netif *netif, struct pbuf *p)
@@ -25,6 +32,8 @@ default_netif_linkoutput(struct netif *netif, struct pbuf *p)
   fail_unless(p != NULL);
   linkoutput_ctr++;
   linkoutput_byte_ctr += p->tot_len;
+  /* Copy start of packet into buffer */
+  pbuf_copy_partial(p, linkoutput_pkt, sizeof(linkoutput_pkt), 0);
   return ERR_OK;
 }
 
@@ -432,6 +441,376 @@ START_TEST(test_ip6_frag)
 }
 END_TEST
 
+static void
+test_ip6_input_fragment(const ip6_addr_t *src, const ip6_addr_t *dest, u16_t start, int last)
+{
+  struct pbuf *p;
+  struct ip6_hdr *ip6hdr;
+  struct ip6_frag_hdr *fraghdr;
+
+  p = pbuf_alloc(PBUF_RAW, IP6_HLEN + IP6_FRAG_HLEN + 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  ip6hdr = (struct ip6_hdr *)p->payload;
+  IP6H_VTCFL_SET(ip6hdr, 6, 0, 0);
+  IP6H_PLEN_SET(ip6hdr, IP6_FRAG_HLEN + 8);
+  IP6H_NEXTH_SET(ip6hdr, IP6_NEXTH_FRAGMENT);
+  IP6H_HOPLIM_SET(ip6hdr, 64);
+  ip6_addr_copy_to_packed(ip6hdr->src, *src);
+  ip6_addr_copy_to_packed(ip6hdr->dest, *dest);
+  fraghdr = (struct ip6_frag_hdr *)((u8_t *)p->payload + IP6_HLEN);
+  /* an unknown next header gets a parameter problem reply once reassembled */
+  fraghdr->_nexth = 253;
+  fraghdr->_fragment_offset = lwip_htons((u16_t)(start | (last ? 0 : IP6_FRAG_MORE_FLAG)));
+  fraghdr->_identification = lwip_htonl(0x1234);
+  fail_unless(ip6_input(p, &test_netif6) == ERR_OK);
+}
+
+/** A fragment inserted before a later one must not hide a gap in front of it */
+START_TEST(test_ip6_reass_gap)
+{
+  ip_addr_t my_addr = IPADDR6_INIT_HOST(0x20010db8, 0x0, 0x0, 0x1);
+  ip_addr_t peer_addr = IPADDR6_INIT_HOST(0x20010db8, 0x0, 0x0, 0x4);
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_ip6_addr_set(&test_netif6, 0, ip_2_ip6(&my_addr));
+  netif_ip6_addr_set_state(&test_netif6, 0, IP6_ADDR_VALID);
+  test_netif6.output_ip6 = clone_output;
+  cloned_pbuf = NULL;
+
+  /* [0,8) [24,32) [16,24): [8,16) is still missing */
+  test_ip6_input_fragment(ip_2_ip6(&peer_addr), ip_2_ip6(&my_addr), 0, 0);
+  test_ip6_input_fragment(ip_2_ip6(&peer_addr), ip_2_ip6(&my_addr), 24, 1);
+  test_ip6_input_fragment(ip_2_ip6(&peer_addr), ip_2_ip6(&my_addr), 16, 0);
+  fail_unless(cloned_pbuf == NULL);
+
+  test_ip6_input_fragment(ip_2_ip6(&peer_addr), ip_2_ip6(&my_addr), 8, 0);
+  fail_unless(cloned_pbuf != NULL);
+  if (cloned_pbuf != NULL) {
+    pbuf_free(cloned_pbuf);
+    cloned_pbuf = NULL;
+  }
+}
+END_TEST
+
+static u8_t
+test_ip6_fib_lookup_len(const char *addr)
+{
+  ip6_addr_t dest;
+  const struct ip6_fib_route *route;
+
+  fail_unless(ip6addr_aton(addr, &dest));
+  route = ip6_fib_lookup(&dest);
+  return (route != NULL) ? route->prefix_len : 0xff;
+}
+
+static void
+test_ip6_fib_count(const struct ip6_fib_route *route, void *arg)
+{
+  LWIP_UNUSED_ARG(route);
+  (*(int *)arg)++;
+}
+
+/** Longest prefix match with prefixes of any length, deleting routes */
+START_TEST(test_ip6_fib_lpm)
+{
+  static const struct {
+    const char *prefix;
+    u8_t len;
+  } routes[] = {
+    {"2001:db8::", 32}, {"2001:db8:1:2::1", 128}, {"2001:db8:1::", 48},
+    {"2001:db8:1:2::", 64}, {"2001:db8:1:2:8000::", 65}, {"2001:db8:8000::", 33},
+    {"2001:db8:1:6::", 63}, {"::", 0}
+  };
+  ip6_addr_t prefix, gw;
+  size_t i;
+  int count = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(ip6addr_aton("fe80::1", &gw));
+  for (i = 0; i < LWIP_ARRAYSIZE(routes); i++) {
+    fail_unless(ip6addr_aton(routes[i].prefix, &prefix));
+    fail_unless(ip6_fib_add(&prefix, routes[i].len, &gw, &test_netif6) == ERR_OK);
+  }
+  /* adding again replaces */
+  fail_unless(ip6_fib_add(&prefix, 0, NULL, &test_netif6) == ERR_OK);
+  fail_unless(ip6_fib_num_routes() == LWIP_ARRAYSIZE(routes));
+  ip6_fib_foreach(test_ip6_fib_count, &count);
+  fail_unless(count == (int)LWIP_ARRAYSIZE(routes));
+
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2::1") == 128);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2::2") == 64);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2:8000::2") == 65);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:3::1") == 48);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:6::1") == 63);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:7::1") == 63);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:8::1") == 48);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:2::1") == 32);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:8001::1") == 33);
+  fail_unless(test_ip6_fib_lookup_len("2001:db9::1") == 0);
+
+  /* deleting a route uncovers the next shorter prefix */
+  fail_unless(ip6addr_aton("2001:db8:1:2::", &prefix));
+  fail_unless(ip6_fib_delete(&prefix, 64) == ERR_OK);
+  fail_unless(ip6_fib_delete(&prefix, 64) == ERR_VAL);
+  fail_unless(ip6_fib_delete(&prefix, 96) == ERR_VAL);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2::2") == 48);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2:8000::2") == 65);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:1:2::1") == 128);
+  fail_unless(ip6addr_aton("2001:db8::", &prefix));
+  fail_unless(ip6_fib_delete(&prefix, 32) == ERR_OK);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:2::1") == 0);
+  fail_unless(test_ip6_fib_lookup_len("2001:db8:8001::1") == 33);
+
+  /* netif_remove() in the teardown frees the rest */
+  fail_unless(ip6_fib_num_routes() == LWIP_ARRAYSIZE(routes) - 2);
+}
+END_TEST
+
+/** ip6_route() and the next hop of ND6 use the FIB */
+START_TEST(test_ip6_fib_route)
+{
+  ip6_addr_t my_addr, prefix, gw, dest;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  /* the link-local address is the source of neighbor solicitations */
+  netif_create_ip6_linklocal_address(&test_netif6, 1);
+  netif_ip6_addr_set_state(&test_netif6, 0, IP6_ADDR_VALID);
+  fail_unless(ip6addr_aton("2001:db8:1::1", &my_addr));
+  netif_ip6_addr_set(&test_netif6, 1, &my_addr);
+  netif_ip6_addr_set_state(&test_netif6, 1, IP6_ADDR_VALID);
+  netif_set_default(NULL);
+
+  fail_unless(ip6addr_aton("2001:db8:5::1", &dest));
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == NULL);
+  fail_unless(ip6addr_aton("2001:db8:5::", &prefix));
+  fail_unless(ip6addr_aton("fe80::1", &gw));
+  fail_unless(ip6_fib_add(&prefix, 48, &gw, &test_netif6) == ERR_OK);
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == &test_netif6);
+
+  /* the /64 of the netif address wins over a shorter prefix... */
+  fail_unless(ip6addr_aton("2001:db8::", &prefix));
+  fail_unless(ip6_fib_add(&prefix, 32, NULL, netif_get_loopif()) == ERR_OK);
+  fail_unless(ip6addr_aton("2001:db8:1::5", &dest));
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == &test_netif6);
+  /* ...but not over a longer one */
+  fail_unless(ip6_fib_add(&dest, 128, NULL, netif_get_loopif()) == ERR_OK);
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == netif_get_loopif());
+  ip6_fib_remove_netif(netif_get_loopif());
+  fail_unless(ip6_fib_num_routes() == 1);
+
+  /* packets to 2001:db8:5::/48 go to the gateway: neighbor solicitation for it */
+  linkoutput_ctr = 0;
+  fail_unless(ip6addr_aton("2001:db8:5::1", &dest));
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(ip6_output_if(p, &my_addr, &dest, 64, 0, IP6_NEXTH_UDP, &test_netif6) == ERR_OK);
+  pbuf_free(p);
+  fail_unless(linkoutput_ctr == 1);
+  fail_unless(linkoutput_pkt[SIZEOF_ETH_HDR + 6] == IP6_NEXTH_ICMP6);
+  fail_unless(linkoutput_pkt[SIZEOF_ETH_HDR + IP6_HLEN] == ICMP6_TYPE_NS);
+  fail_if(memcmp(&linkoutput_pkt[SIZEOF_ETH_HDR + IP6_HLEN + 8], &gw.addr, 16));
+
+  netif_set_default(&test_netif6);
+}
+END_TEST
+
+/** A route without a usable next hop leaves the way to shorter ones */
+START_TEST(test_ip6_fib_fallback)
+{
+  ip6_addr_t prefix, gw, dest;
+  const struct ip6_fib_route *route;
+  struct netif *loop = netif_get_loopif();
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  netif_set_default(NULL);
+
+  fail_unless(ip6addr_aton("fe80::1", &gw));
+  fail_unless(ip6_fib_add(IP6_ADDR_ANY6, 0, &gw, &test_netif6) == ERR_OK);
+  fail_unless(ip6addr_aton("2001:db8:5::", &prefix));
+  fail_unless(ip6_fib_add(&prefix, 44, &gw, &test_netif6) == ERR_OK);
+  fail_unless(ip6_fib_add(&prefix, 48, NULL, loop) == ERR_OK);
+  fail_unless(ip6_fib_add(&prefix, 64, NULL, loop) == ERR_OK);
+  fail_unless(ip6addr_aton("2001:db8:5::1", &dest));
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == loop);
+
+  /* the shorter prefix may share the node (and slot) of the longer ones */
+  netif_set_down(loop);
+  route = ip6_fib_lookup_usable(&dest, NULL);
+  fail_unless((route != NULL) && (route->prefix_len == 44));
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == &test_netif6);
+  fail_unless(ip6_fib_delete(&prefix, 44) == ERR_OK);
+  route = ip6_fib_lookup_usable(&dest, NULL);
+  fail_unless((route != NULL) && (route->prefix_len == 0));
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == &test_netif6);
+
+  /* ND6 only looks at the routes of its netif */
+  route = ip6_fib_lookup_usable(&dest, loop);
+  fail_unless((route != NULL) && (route->prefix_len == 64));
+  route = ip6_fib_lookup(&dest);
+  fail_unless((route != NULL) && (route->prefix_len == 64));
+
+  netif_set_up(loop);
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == loop);
+  ip6_fib_remove_netif(loop);
+  fail_unless(ip6_fib_num_routes() == 1);
+
+  netif_set_default(&test_netif6);
+}
+END_TEST
+
+#if LWIP_FIB_MAX_PATHS > 1
+/** Routes with several next hops spread the flows by weight */
+START_TEST(test_ip6_fib_multipath)
+{
+  ip6_addr_t prefix, gw, dest;
+  const struct ip6_fib_route *route;
+  const struct ip6_fib_path *path;
+  struct netif *loop = netif_get_loopif();
+  struct netif *netif;
+  u32_t h, count;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  netif_set_default(NULL);
+
+  fail_unless(ip6addr_aton("2001:db8:5::", &prefix));
+  fail_unless(ip6addr_aton("2001:db8:5::1", &dest));
+  fail_unless(ip6addr_aton("fe80::1", &gw));
+  fail_unless(ip6_fib_add_path(&prefix, 48, &gw, &test_netif6, 1) == ERR_OK);
+  fail_unless(ip6_fib_add_path(&prefix, 48, NULL, loop, 1) == ERR_OK);
+  route = ip6_fib_lookup(&dest);
+  fail_unless(route != NULL);
+  fail_unless(route->num_paths == 2);
+
+  count = 0;
+  for (h = 0; h <= 0xffff; h++) {
+    netif = ip6_route_flow(IP6_ADDR_ANY6, &dest, (h << 16) | 1);
+    fail_unless((netif == &test_netif6) || (netif == loop));
+    if (netif == loop) {
+      count++;
+    }
+    /* the same flow always takes the same path */
+    fail_unless(ip6_route_flow(IP6_ADDR_ANY6, &dest, (h << 16) | 1) == netif);
+    /* selecting for a netif only looks at its paths */
+    path = ip6_fib_select(route, (h << 16) | 1, &test_netif6);
+    fail_unless((path != NULL) && (path->netif == &test_netif6));
+  }
+  fail_unless(count == 0x8000);
+
+  /* the gateway is zoned when stored, adding it again changes its weight */
+  fail_unless(ip6_fib_add_path(&prefix, 48, &gw, &test_netif6, 3) == ERR_OK);
+  fail_unless(route->num_paths == 2);
+  count = 0;
+  for (h = 0; h <= 0xffff; h++) {
+    if (ip6_route_flow(IP6_ADDR_ANY6, &dest, (h << 16) | 1) == loop) {
+      count++;
+    }
+  }
+  fail_unless(count == 0x4000);
+
+  fail_unless(ip6_fib_delete_path(&prefix, 48, &gw, &test_netif6) == ERR_OK);
+  fail_unless(ip6_fib_delete_path(&prefix, 48, &gw, &test_netif6) == ERR_VAL);
+  fail_unless(route->num_paths == 1);
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == loop);
+  ip6_fib_remove_netif(loop);
+  fail_unless(ip6_fib_num_routes() == 0);
+
+  netif_set_default(&test_netif6);
+}
+END_TEST
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+
+#if LWIP_ND6_CACHE_HASH_SIZE
+/** Count the destination and neighbor cache entries for an address */
+static int
+test_ip6_nd6_cached(const char *addr)
+{
+  ip6_addr_t a;
+  int i, count = 0;
+
+  fail_unless(ip6addr_aton(addr, &a));
+  for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
+    if (ip6_addr_eq(&a, &destination_cache[i].destination_addr)) {
+      count++;
+    }
+  }
+  for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+    if ((neighbor_cache[i].state != ND6_NO_ENTRY) &&
+        ip6_addr_eq(&a, &neighbor_cache[i].next_hop_address)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static void
+test_ip6_nd6_send(const ip6_addr_t *src, const char *addr)
+{
+  ip6_addr_t dest;
+  struct pbuf *p;
+
+  fail_unless(ip6addr_aton(addr, &dest));
+  p = pbuf_alloc(PBUF_IP, 8, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(ip6_output_if(p, src, &dest, 64, 0, IP6_NEXTH_UDP, &test_netif6) == ERR_OK);
+  pbuf_free(p);
+}
+
+/** Full hashed ND6 caches recycle their least recently used entries */
+START_TEST(test_ip6_nd6_cache_lru)
+{
+  ip6_addr_t my_addr;
+  int i, used;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  netif_create_ip6_linklocal_address(&test_netif6, 1);
+  netif_ip6_addr_set_state(&test_netif6, 0, IP6_ADDR_VALID);
+  fail_unless(ip6addr_aton("2001:db8:1::1", &my_addr));
+  netif_ip6_addr_set(&test_netif6, 1, &my_addr);
+  netif_ip6_addr_set_state(&test_netif6, 1, IP6_ADDR_VALID);
+  nd6_clear_destination_cache();
+
+  fail_unless(nd6_set_cache_sizes(3, 3) == ERR_OK);
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::10");
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::11");
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::12");
+  /* using ::10 again makes ::11 the least recently used */
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::10");
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::13");
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::10") == 2);
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::11") == 0);
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::12") == 2);
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::13") == 2);
+
+  /* shrinking drops the entries beyond the new size */
+  fail_unless(nd6_set_cache_sizes(1, 1) == ERR_OK);
+  used = test_ip6_nd6_cached("2001:db8:1::10") + test_ip6_nd6_cached("2001:db8:1::12") +
+         test_ip6_nd6_cached("2001:db8:1::13");
+  fail_unless(used == 2);
+  for (i = 1; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
+    fail_unless(neighbor_cache[i].state == ND6_NO_ENTRY);
+  }
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::14");
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::14") == 2);
+
+  fail_unless(nd6_set_cache_sizes(LWIP_ND6_NUM_NEIGHBORS, LWIP_ND6_NUM_DESTINATIONS) == ERR_OK);
+  test_ip6_nd6_send(&my_addr, "2001:db8:1::15");
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::14") == 2);
+  fail_unless(test_ip6_nd6_cached("2001:db8:1::15") == 2);
+}
+END_TEST
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /** Create the suite including all tests for this module */
 Suite *
 ip6_suite(void)
@@ -444,7 +823,17 @@ ip6_suite(void)
     TESTFUNC(test_ip6_lladdr),
     TESTFUNC(test_ip6_dest_unreachable_chained_pbuf),
     TESTFUNC(test_ip6_frag_pbuf_len_assert),
-    TESTFUNC(test_ip6_frag)
+    TESTFUNC(test_ip6_frag),
+    TESTFUNC(test_ip6_reass_gap),
+    TESTFUNC(test_ip6_fib_lpm),
+    TESTFUNC(test_ip6_fib_route),
+    TESTFUNC(test_ip6_fib_fallback),
+#if LWIP_FIB_MAX_PATHS > 1
+    TESTFUNC(test_ip6_fib_multipath),
+#endif /* LWIP_FIB_MAX_PATHS > 1 */
+#if LWIP_ND6_CACHE_HASH_SIZE
+    TESTFUNC(test_ip6_nd6_cache_lru),
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   };
   return create_suite("IPv6", tests, sizeof(tests)/sizeof(testfunc), ip6_setup, ip6_teardown);
 }
@@ -8,6 +8,7 @@
 #include "core/test_def.h"
 #include "core/test_dns.h"
 #include "core/test_mem.h"
+#include "core/test_memp.h"
 #include "core/test_netif.h"
 #include "core/test_pbuf.h"
 #include "core/test_timers.h"
@@ -16,6 +17,7 @@
 #include "mdns/test_mdns.h"
 #include "mqtt/test_mqtt.h"
 #include "api/test_sockets.h"
+#include "bridgeif/test_bridgeif.h"
 
 #include "lwip/init.h"
 #if !NO_SYS
@@ -81,6 +83,7 @@ int main(void)
     def_suite,
     dns_suite,
     mem_suite,
+    memp_suite,
     netif_suite,
     pbuf_suite,
     timers_suite,
@@ -88,7 +91,8 @@ int main(void)
     dhcp_suite,
     mdns_suite,
     mqtt_suite,
-    sockets_suite
+    sockets_suite,
+    bridgeif_suite
   };
   size_t num = sizeof(suites)/sizeof(void*);
   LWIP_ASSERT("No suites defined", num > 0);
@@ -48,8 +48,22 @@
 #define LWIP_NETCONN_FULLDUPLEX         LWIP_SOCKET
 #define LWIP_NETCONN_SEM_PER_THREAD     1
 #define LWIP_NETBUF_RECVINFO            1
+#define LWIP_SOCKET_MMSG                1
+#define LWIP_SOCKET_EPOLL               1
+#define LWIP_SOCKET_ZEROCOPY            1
+/* Grow the socket table at runtime (with a partial last chunk). Chunks are
+   never freed, so take them from the C library to keep the per-test heap
+   checks working */
+#define LWIP_SOCKET_DYNAMIC             1
+#define LWIP_SOCKET_CHUNK_SIZE          3
+#include <stdlib.h>
+#define LWIP_SOCKET_CHUNK_MALLOC(size)  malloc(size)
+#define LWIP_SOCKET_CHUNK_FREE(ptr)     free(ptr)
 #define LWIP_HAVE_LOOPIF                1
 #define TCPIP_THREAD_TEST
+#define SO_REUSE_PORT                   1
+#define SO_REUSE                        1
+#define SO_REUSE_RXTOALL                1
 
 /* Enable DHCP to test it */
 #define LWIP_DHCP                       1
@@ -67,17 +81,57 @@
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
+#define LWIP_PBUF_SHARED                1
 
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
 #define LWIP_MDNS_RESPONDER             1
-#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_MDNS_RESPONDER)
+#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_MDNS_RESPONDER + 1) /* + bridgeif */
 
 /* Minimal changes to opt.h required for etharp unit tests: */
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
+#define ETHARP_TABLE_HASH_SIZE          4
+
+/* Hashed IPv6 neighbor and destination caches */
+#define LWIP_ND6_CACHE_HASH_SIZE        4
+
+/* Hashed IP reassembly with a per-source limit */
+#define IP_REASS_HASH_SIZE              4
+#define IP_REASS_MAX_PBUFS_PER_SRC      9
+
+/* The IPv6 reassembly helper does not fit into the fragment header on 64-bit hosts */
+#define IPV6_FRAG_COPYHEADER            1
+
+/* VLAN sub-interfaces */
+#define LWIP_VLANIF                     1
+
+/* Bridge FDB with independent VLAN learning, switching in the port driver */
+#define BRIDGEIF_FDB_VLAN               1
+#define BRIDGEIF_PORT_NETIFS_FAST_PATH  1
+
+/* Forwarding with the flow cache */
+#define IP_FORWARD                      1
+#define LWIP_IPV6_FORWARD               1
+#define IP_FLOW_CACHE_SIZE              4
 
 #define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 8)
 
+/* Elastic pools are tested with a private pool: keep the built-in pools at
+   their static size so that the tests running them empty still work */
+#define MEMP_ELASTIC                    1
+#define MEMP_ELASTIC_CEILING(num)       (num)
+#define MEMP_ELASTIC_SLAB_NUM           4
+#define MEMP_ELASTIC_DECAY_MS           3000
+#define MEMP_TELEMETRY                  1
+
+/* Routing table tests */
+#define LWIP_IPV4_FIB                   1
+#define LWIP_IPV6_FIB                   1
+#define LWIP_FIB_MAX_PATHS              4
+
+/* Queue enough datagrams on a socket for the recvmmsg/sendmmsg tests */
+#define MEMP_NUM_NETBUF                 16
+
 /* MIB2 stats are required to check IPv4 reassembly results */
 #define MIB2_STATS                      1
 
@@ -156,6 +156,74 @@ START_TEST(test_tcp_listen_passive_open)
 }
 END_TEST
 
+#if SO_REUSE_PORT
+/** Listen twice on one port with SO_REUSEPORT and check that SYNs of different
+ * flows are spread across both listeners, a given flow always hitting the same */
+START_TEST(test_tcp_listen_reuseport)
+{
+  struct tcp_pcb *pcb, *pcbl[2];
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct pbuf *p;
+  ip_addr_t src_addr;
+  int hits[2] = {0, 0};
+  int first = -1;
+  int i, j;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+
+  for (i = 0; i < 2; i++) {
+    pcb = tcp_new();
+    EXPECT_RET(pcb != NULL);
+    ip_set_option(pcb, SOF_REUSEPORT);
+    err = tcp_bind(pcb, &netif.ip_addr, 1234);
+    EXPECT(err == ERR_OK);
+    tcp_arg(pcb, &hits[i]);
+    pcbl[i] = tcp_listen(pcb);
+    EXPECT_RET(pcbl[i] != NULL);
+  }
+  /* a pcb without the option cannot join the group */
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  err = tcp_bind(pcb, &netif.ip_addr, 1234);
+  EXPECT(err == ERR_USE);
+  tcp_close(pcb);
+
+  ip_addr_set_ip4_u32_val(src_addr, lwip_htonl(lwip_ntohl(ip_addr_get_ip4_u32(&netif.ip_addr)) + 1));
+
+  for (i = 0; i < 40; i++) {
+    /* the first 8 SYNs belong to the same flow */
+    u16_t src_port = (u16_t)((i < 8) ? 12345 : 20000 + i);
+    p = tcp_create_segment(&src_addr, &netif.ip_addr, src_port, 1234, NULL, 0, 12345, 0, TCP_SYN);
+    EXPECT_RET(p != NULL);
+    test_tcp_input(p, &netif);
+    /* the new pcb inherits its callback arg from the listener that took the SYN */
+    pcb = tcp_active_pcbs;
+    EXPECT_RET(pcb != NULL);
+    EXPECT_RET(pcb->state == SYN_RCVD);
+    for (j = 0; j < 2; j++) {
+      if (pcb->callback_arg == &hits[j]) {
+        hits[j]++;
+        if (i < 8) {
+          EXPECT(first == -1 || first == j);
+          first = j;
+        }
+      }
+    }
+    tcp_abort(pcb);
+  }
+  EXPECT(hits[0] + hits[1] == 40);
+  EXPECT(hits[0] > 0);
+  EXPECT(hits[1] > 0);
+
+  tcp_close(pcbl[0]);
+  tcp_close(pcbl[1]);
+}
+END_TEST
+#endif /* SO_REUSE_PORT */
+
 /** Create an ESTABLISHED pcb and check if receive callback is called */
 START_TEST(test_tcp_recv_inseq)
 {
@@ -1676,6 +1744,9 @@ tcp_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_tcp_new_abort),
     TESTFUNC(test_tcp_listen_passive_open),
+#if SO_REUSE_PORT
+    TESTFUNC(test_tcp_listen_reuseport),
+#endif /* SO_REUSE_PORT */
     TESTFUNC(test_tcp_recv_inseq),
     TESTFUNC(test_tcp_recv_inseq_trim),
     TESTFUNC(test_tcp_passive_close),
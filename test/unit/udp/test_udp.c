@@ -14,6 +14,9 @@ struct test_udp_rxdata {
   struct udp_pcb *pcb;
 };
 
+/* with SO_REUSEADDR set, broadcasts are passed to all pcbs bound to the port */
+#define TEST_UDP_RXTOALL (SO_REUSE && SO_REUSE_RXTOALL)
+
 static struct netif test_netif1, test_netif2;
 static ip4_addr_t test_gw1, test_ipaddr1, test_netmask1;
 static ip4_addr_t test_gw2, test_ipaddr2, test_netmask2;
@@ -290,7 +293,9 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
   fail_unless(ctr1.rx_bytes == 16);
   fail_unless(ctr2.rx_cnt == 0);
 #if SO_REUSE
-  fail_unless(ctr_any.rx_cnt == 0);
+  /* with SO_REUSE_RXTOALL, broadcasts are passed to pcb_any, too */
+  fail_unless(ctr_any.rx_cnt == TEST_UDP_RXTOALL);
+  ctr_any.rx_cnt = ctr_any.rx_bytes = 0;
 #endif
   ctr1.rx_cnt = ctr1.rx_bytes = 0;
 
@@ -303,7 +308,9 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
   fail_unless(ctr2.rx_bytes == 16);
   fail_unless(ctr1.rx_cnt == 0);
 #if SO_REUSE
-  fail_unless(ctr_any.rx_cnt == 0);
+  /* with SO_REUSE_RXTOALL, broadcasts are passed to pcb_any, too */
+  fail_unless(ctr_any.rx_cnt == TEST_UDP_RXTOALL);
+  ctr_any.rx_cnt = ctr_any.rx_bytes = 0;
 #endif
   ctr2.rx_cnt = ctr2.rx_bytes = 0;
 
@@ -314,11 +321,13 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
   fail_unless(err == ERR_OK);
   fail_unless(ctr1.rx_cnt == 1);
   fail_unless(ctr1.rx_bytes == 16);
-  fail_unless(ctr2.rx_cnt == 0);
+  fail_unless(ctr2.rx_cnt == TEST_UDP_RXTOALL);
 #if SO_REUSE
-  fail_unless(ctr_any.rx_cnt == 0);
+  fail_unless(ctr_any.rx_cnt == TEST_UDP_RXTOALL);
+  ctr_any.rx_cnt = ctr_any.rx_bytes = 0;
 #endif
   ctr1.rx_cnt = ctr1.rx_bytes = 0;
+  ctr2.rx_cnt = ctr2.rx_bytes = 0;
 
   /* broadcast to global-broadcast, input to netif2 */
   p = test_udp_create_test_packet(16, port, 0xffffffff);
@@ -327,10 +336,12 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
   fail_unless(err == ERR_OK);
   fail_unless(ctr2.rx_cnt == 1);
   fail_unless(ctr2.rx_bytes == 16);
-  fail_unless(ctr1.rx_cnt == 0);
+  fail_unless(ctr1.rx_cnt == TEST_UDP_RXTOALL);
 #if SO_REUSE
-  fail_unless(ctr_any.rx_cnt == 0);
+  fail_unless(ctr_any.rx_cnt == TEST_UDP_RXTOALL);
+  ctr_any.rx_cnt = ctr_any.rx_bytes = 0;
 #endif
+  ctr1.rx_cnt = ctr1.rx_bytes = 0;
   ctr2.rx_cnt = ctr2.rx_bytes = 0;
 }
 END_TEST
@@ -459,6 +470,175 @@ START_TEST(test_udp_bind)
 }
 END_TEST
 
+#if SO_REUSE_PORT
+/* bind 2 pcbs to the same port with SO_REUSEPORT and check that flows are
+   spread between them, each flow sticking to one pcb */
+START_TEST(test_udp_reuseport)
+{
+  err_t err;
+  struct udp_pcb *pcb1, *pcb2, *pcb3;
+  const u16_t port = 12345;
+  struct test_udp_rxdata ctr1, ctr2;
+  struct pbuf *p;
+  u16_t i;
+  u32_t first_flow_cnt;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb1 = udp_new();
+  fail_unless(pcb1 != NULL);
+  pcb2 = udp_new();
+  fail_unless(pcb2 != NULL);
+  pcb3 = udp_new();
+  fail_unless(pcb3 != NULL);
+
+  ip_set_option(pcb1, SOF_REUSEPORT);
+  ip_set_option(pcb2, SOF_REUSEPORT);
+
+  err = udp_bind(pcb1, &test_netif1.ip_addr, port);
+  fail_unless(err == ERR_OK);
+  err = udp_bind(pcb2, &test_netif1.ip_addr, port);
+  fail_unless(err == ERR_OK);
+  /* all pcbs sharing the port must have the option set */
+  err = udp_bind(pcb3, &test_netif1.ip_addr, port);
+  fail_unless(err == ERR_USE);
+  udp_remove(pcb3);
+
+  memset(&ctr1, 0, sizeof(ctr1));
+  ctr1.pcb = pcb1;
+  memset(&ctr2, 0, sizeof(ctr2));
+  ctr2.pcb = pcb2;
+  udp_recv(pcb1, test_recv, &ctr1);
+  udp_recv(pcb2, test_recv, &ctr2);
+
+  /* the same flow always reaches the same pcb */
+  for (i = 0; i < 8; i++) {
+    p = test_udp_create_test_packet(16, port, test_ipaddr1.addr);
+    EXPECT_RET(p != NULL);
+    err = ip4_input(p, &test_netif1);
+    fail_unless(err == ERR_OK);
+  }
+  fail_unless(ctr1.rx_cnt + ctr2.rx_cnt == 8);
+  fail_unless((ctr1.rx_cnt == 0) || (ctr2.rx_cnt == 0));
+  first_flow_cnt = ctr1.rx_cnt;
+
+  /* different source ports get spread across the group */
+  for (i = 0; i < 64; i++) {
+    struct udp_hdr *uh;
+    p = test_udp_create_test_packet(16, port, test_ipaddr1.addr);
+    EXPECT_RET(p != NULL);
+    uh = (struct udp_hdr *)((u8_t *)p->payload + sizeof(struct ip_hdr));
+    uh->src = lwip_htons((u16_t)(40000 + i));
+    err = ip4_input(p, &test_netif1);
+    fail_unless(err == ERR_OK);
+  }
+  fail_unless(ctr1.rx_cnt + ctr2.rx_cnt == 72);
+  fail_unless(ctr1.rx_cnt > first_flow_cnt);
+  fail_unless(ctr2.rx_cnt > 8 - first_flow_cnt);
+}
+END_TEST
+#endif /* SO_REUSE_PORT */
+
+#if TEST_UDP_RXTOALL
+static void test_recv_keep(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+    const ip_addr_t *addr, u16_t port)
+{
+  struct pbuf **rx = (struct pbuf **)arg;
+
+  LWIP_UNUSED_ARG(pcb);
+  LWIP_UNUSED_ARG(addr);
+  LWIP_UNUSED_ARG(port);
+
+  fail_unless(*rx == NULL);
+  *rx = p;
+}
+
+/* 2 pcbs receive the same broadcast: each one gets its own view of the data
+   (with LWIP_PBUF_SHARED a reference instead of a copy) */
+START_TEST(test_udp_rxtoall)
+{
+  err_t err;
+  struct udp_pcb *pcb1, *pcb2;
+  const u16_t port = 12346;
+  struct pbuf *p, *rx1 = NULL, *rx2 = NULL;
+  struct pbuf *q;
+#if LWIP_PBUF_SHARED
+  struct udp_hdr *uh;
+#endif /* LWIP_PBUF_SHARED */
+  u8_t ret;
+  u16_t i, hlen = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb1 = udp_new();
+  fail_unless(pcb1 != NULL);
+  pcb2 = udp_new();
+  fail_unless(pcb2 != NULL);
+  ip_set_option(pcb1, SOF_REUSEADDR);
+  ip_set_option(pcb2, SOF_REUSEADDR);
+  err = udp_bind(pcb1, NULL, port);
+  fail_unless(err == ERR_OK);
+  err = udp_bind(pcb2, NULL, port);
+  fail_unless(err == ERR_OK);
+  udp_recv(pcb1, test_recv_keep, &rx1);
+  udp_recv(pcb2, test_recv_keep, &rx2);
+
+  p = test_udp_create_test_packet(16, port, test_ipaddr1.addr | ~test_netmask1.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif1);
+  fail_unless(err == ERR_OK);
+  EXPECT_RET((rx1 != NULL) && (rx2 != NULL));
+  fail_unless(rx1 != rx2);
+
+  /* both start at the UDP payload and move their payload pointers
+     independently */
+  for (i = 0; i < 16; i++) {
+    fail_unless(pbuf_get_at(rx1, i) == i);
+    fail_unless(pbuf_get_at(rx2, i) == i);
+  }
+#if LWIP_PBUF_SHARED
+  /* a reference (unlike a copy) still covers the headers in front of it */
+  ret = pbuf_header_force(rx1, UDP_HLEN);
+  fail_unless(!ret);
+  uh = (struct udp_hdr *)rx1->payload;
+  fail_unless(uh->dest == lwip_htons(port));
+  hlen = UDP_HLEN;
+#endif /* LWIP_PBUF_SHARED */
+  fail_unless(rx1->tot_len - hlen == 16);
+  fail_unless(rx2->tot_len == 16);
+  ret = pbuf_remove_header(rx2, 4);
+  fail_unless(!ret);
+  fail_unless(pbuf_get_at(rx2, 0) == 4);
+  fail_unless(rx1->tot_len - hlen == 16);
+  fail_unless(pbuf_get_at(rx1, hlen) == 0);
+
+  /* a recipient modifying the data does not change what the other one sees */
+  q = pbuf_unshare(rx1);
+  EXPECT_RET(q != NULL);
+#if LWIP_PBUF_SHARED
+  /* the payload was referenced by both recipients: copied */
+  fail_unless(q != rx1);
+#endif /* LWIP_PBUF_SHARED */
+  rx1 = q;
+  fail_unless(rx1->tot_len - hlen == 16);
+  fail_unless(pbuf_get_at(rx1, hlen) == 0);
+  for (i = 0; i < rx1->tot_len; i++) {
+    pbuf_put_at(rx1, i, 0xff);
+  }
+  for (i = 0; i < 12; i++) {
+    fail_unless(pbuf_get_at(rx2, i) == i + 4);
+  }
+
+  /* the other one is now the only user: modified in place */
+  q = pbuf_unshare(rx2);
+  fail_unless(q == rx2);
+  pbuf_put_at(rx2, 0, 0xaa);
+  fail_unless(pbuf_get_at(rx1, hlen + 4) == 0xff);
+
+  pbuf_free(rx1);
+  pbuf_free(rx2);
+}
+END_TEST
+#endif /* TEST_UDP_RXTOALL */
+
 /** Create the suite including all tests for this module */
 Suite *
 udp_suite(void)
@@ -466,7 +646,13 @@ udp_suite(void)
   testfunc tests[] = {
     TESTFUNC(test_udp_new_remove),
     TESTFUNC(test_udp_broadcast_rx_with_2_netifs),
-    TESTFUNC(test_udp_bind)
+    TESTFUNC(test_udp_bind),
+#if SO_REUSE_PORT
+    TESTFUNC(test_udp_reuseport),
+#endif /* SO_REUSE_PORT */
+#if TEST_UDP_RXTOALL
+    TESTFUNC(test_udp_rxtoall),
+#endif /* TEST_UDP_RXTOALL */
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(testfunc), udp_setup, udp_teardown);
 }